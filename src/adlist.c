@@ -0,0 +1,283 @@
+#include <stdlib.h>
+#include "adlist.h"
+#include "zmalloc.h"
+
+/* Create a new list. The created list can be freed with
+ * AlFreeList(), but private value of every node need to be freed
+ * by the user before to call AlFreeList().
+ *
+ * 创建一个新的链表，创建成功返回链表，失败返回 NULL 。
+ *
+ * T = O(1)
+ */
+list *listCreate(void)
+{
+    struct list *list;
+
+    // 分配内存
+    if ((list = zmalloc(sizeof(*list))) == NULL)
+        return NULL;
+
+    // 初始化属性
+    list->head = list->tail = NULL;
+    list->len = 0;
+    list->dup = NULL;
+    list->free = NULL;
+    list->match = NULL;
+
+    return list;
+}
+
+/* Free the whole list.
+ *
+ * 释放整个链表，以及链表中所有节点
+ *
+ * T = O(N)
+ */
+void listRelease(list *list)
+{
+    unsigned long len;
+    listNode *current, *next;
+
+    // 指向头指针
+    current = list->head;
+    // 遍历整个链表
+    len = list->len;
+    while(len--) {
+        next = current->next;
+
+        // 如果有设置值释放函数，那么调用它
+        if (list->free) list->free(current->value);
+
+        // 释放节点结构
+        zfree(current);
+
+        current = next;
+    }
+
+    // 释放链表结构
+    zfree(list);
+}
+
+/* Add a new node to the list, to head, contaning the specified 'value'
+ * pointer as value.
+ *
+ * 将一个包含有给定值指针 value 的新节点添加到链表的表头
+ *
+ * T = O(1)
+ */
+list *listAddNodeHead(list *list, void *value)
+{
+    listNode *node;
+
+    // 为节点分配内存
+    if ((node = zmalloc(sizeof(*node))) == NULL)
+        return NULL;
+
+    // 保存值指针
+    node->value = value;
+
+    // 添加节点到空链表
+    if (list->len == 0) {
+        list->head = list->tail = node;
+        node->prev = node->next = NULL;
+    // 添加节点到非空链表
+    } else {
+        node->prev = NULL;
+        node->next = list->head;
+        list->head->prev = node;
+        list->head = node;
+    }
+
+    // 更新链表节点数
+    list->len++;
+
+    return list;
+}
+
+/* Add a new node to the list, to tail, containing the specified 'value'
+ * pointer as value.
+ *
+ * 将一个包含有给定值指针 value 的新节点添加到链表的表尾
+ *
+ * T = O(1)
+ */
+list *listAddNodeTail(list *list, void *value)
+{
+    listNode *node;
+
+    // 为新节点分配内存
+    if ((node = zmalloc(sizeof(*node))) == NULL)
+        return NULL;
+
+    // 保存值指针
+    node->value = value;
+
+    // 目标链表为空
+    if (list->len == 0) {
+        list->head = list->tail = node;
+        node->prev = node->next = NULL;
+    // 目标链表非空
+    } else {
+        node->prev = list->tail;
+        node->next = NULL;
+        list->tail->next = node;
+        list->tail = node;
+    }
+
+    // 更新链表节点数
+    list->len++;
+
+    return list;
+}
+
+/* Remove the specified node from the specified list.
+ * It's up to the caller to free the private value of the node.
+ *
+ * 从链表 list 中删除给定节点 node
+ *
+ * 对节点私有值(private value of the node)的释放工作由调用者进行。
+ *
+ * T = O(1)
+ */
+void listDelNode(list *list, listNode *node)
+{
+    // 调整前置节点的指针
+    if (node->prev)
+        node->prev->next = node->next;
+    else
+        list->head = node->next;
+
+    // 调整后置节点的指针
+    if (node->next)
+        node->next->prev = node->prev;
+    else
+        list->tail = node->prev;
+
+    // 释放值
+    if (list->free) list->free(node->value);
+
+    // 释放节点
+    zfree(node);
+
+    // 链表数减一
+    list->len--;
+}
+
+/* Returns a list iterator 'iter'. After the initialization every
+ * call to listNext() will return the next element of the list.
+ *
+ * 为给定链表创建一个迭代器，
+ * 之后每次对这个迭代器调用 listNext 都返回被迭代到的链表节点
+ *
+ * T = O(1)
+ */
+listIter *listGetIterator(list *list, int direction)
+{
+    // 为迭代器分配内存
+    listIter *iter;
+    if ((iter = zmalloc(sizeof(*iter))) == NULL) return NULL;
+
+    // 根据迭代方向，设置迭代器的起始节点
+    if (direction == AL_START_HEAD)
+        iter->next = list->head;
+    else
+        iter->next = list->tail;
+
+    // 记录迭代方向
+    iter->direction = direction;
+
+    return iter;
+}
+
+/* Release the iterator memory
+ *
+ * 释放迭代器
+ *
+ * T = O(1)
+ */
+void listReleaseIterator(listIter *iter) {
+    zfree(iter);
+}
+
+/* Create an iterator in the list private iterator structure
+ *
+ * 将迭代器的方向设置为 AL_START_HEAD ，
+ * 并将迭代指针重新指向表头节点。
+ *
+ * T = O(1)
+ */
+void listRewind(list *list, listIter *li) {
+    li->next = list->head;
+    li->direction = AL_START_HEAD;
+}
+
+/* Return the next element of an iterator.
+ * It's valid to remove the currently returned element using
+ * listDelNode(), but not to remove other elements.
+ *
+ * 返回迭代器当前所指向的节点。
+ *
+ * 删除当前节点是允许的，但不能修改链表里的其他节点。
+ *
+ * T = O(1)
+ */
+listNode *listNext(listIter *iter)
+{
+    listNode *current = iter->next;
+
+    if (current != NULL) {
+        // 根据方向选择下一个节点
+        if (iter->direction == AL_START_HEAD)
+            // 保存下一个节点，防止当前节点被删除而造成指针丢失
+            iter->next = current->next;
+        else
+            // 保存下一个节点，防止当前节点被删除而造成指针丢失
+            iter->next = current->prev;
+    }
+
+    return current;
+}
+
+/* Search the list for a node matching a given key.
+ * The match is performed using the 'match' method
+ * set with listSetMatchMethod(). If no 'match' method
+ * is set, the 'value' pointer of every node is directly
+ * compared with the 'key' pointer.
+ *
+ * 查找链表 list 中值和 key 匹配的节点。
+ *
+ * 如果找到，返回第一个匹配的节点；否则返回 NULL 。
+ *
+ * T = O(N)
+ */
+listNode *listSearchKey(list *list, void *key)
+{
+    listIter *iter;
+    listNode *node;
+
+    // 迭代整个链表
+    iter = listGetIterator(list, AL_START_HEAD);
+    while((node = listNext(iter)) != NULL) {
+
+        // 对比
+        if (list->match) {
+            if (list->match(node->value, key)) {
+                listReleaseIterator(iter);
+                // 找到
+                return node;
+            }
+        } else {
+            if (key == node->value) {
+                listReleaseIterator(iter);
+                // 找到
+                return node;
+            }
+        }
+    }
+
+    listReleaseIterator(iter);
+
+    // 未找到
+    return NULL;
+}
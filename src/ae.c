@@ -1,4 +1,6 @@
 #include "redis.h"
+#include <sys/time.h>
+#include <poll.h>
 #include "ae_epoll.c"
 
 /*
@@ -48,6 +50,12 @@ aeEventLoop *aeCreateEventLoop(int setsize) {
     eventLoop->setsize = setsize;
     
     eventLoop->stop = 0;
+    eventLoop->beforesleep = NULL;
+
+    // 初始化时间事件结构
+    eventLoop->timeEventHead = NULL;
+    eventLoop->timeEventNextId = 0;
+    eventLoop->lastTime = time(NULL);
     
     if (aeApiCreate(eventLoop) == -1) goto err;
 
@@ -69,12 +77,277 @@ err:
     return NULL;
 }
 
+/*
+ * 取出当前时间的秒和毫秒，
+ * 并分别将它们保存到 seconds 和 milliseconds 参数中
+ */
+static void aeGetTime(long *seconds, long *milliseconds)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    *seconds = tv.tv_sec;
+    *milliseconds = tv.tv_usec/1000;
+}
+
+/*
+ * 在当前时间上加上 milliseconds 毫秒，
+ * 并且将加上之后的秒数和毫秒数分别保存在 sec 和 ms 指针中。
+ */
+static void aeAddMillisecondsToNow(long long milliseconds, long *sec, long *ms) {
+    long cur_sec, cur_ms, when_sec, when_ms;
+
+    // 获取当前时间
+    aeGetTime(&cur_sec, &cur_ms);
+
+    // 计算增加 milliseconds 之后的秒数和毫秒数
+    when_sec = cur_sec + milliseconds/1000;
+    when_ms = cur_ms + milliseconds%1000;
+
+    // 进位：
+    // 如果 when_ms 大于等于 1000
+    // 那么将 when_sec 增大一秒
+    if (when_ms >= 1000) {
+        when_sec ++;
+        when_ms -= 1000;
+    }
+
+    // 保存到指针中
+    *sec = when_sec;
+    *ms = when_ms;
+}
+
+/*
+ * 创建时间事件
+ */
+long long aeCreateTimeEvent(aeEventLoop *eventLoop, long long milliseconds,
+        aeTimeProc *proc, void *clientData,
+        aeEventFinalizerProc *finalizerProc)
+{
+    // 更新时间计数器
+    long long id = eventLoop->timeEventNextId++;
+
+    // 创建时间事件结构
+    aeTimeEvent *te;
+
+    te = zmalloc(sizeof(*te));
+    if (te == NULL) return AE_ERR;
+
+    // 设置 ID
+    te->id = id;
+
+    // 设定处理事件的时间
+    aeAddMillisecondsToNow(milliseconds,&te->when_sec,&te->when_ms);
+    // 设置事件处理器
+    te->timeProc = proc;
+    te->finalizerProc = finalizerProc;
+    // 设置私有数据
+    te->clientData = clientData;
+
+    // 将新事件放入表头
+    te->next = eventLoop->timeEventHead;
+    eventLoop->timeEventHead = te;
+
+    return id;
+}
+
+/*
+ * 删除给定 id 的时间事件
+ */
+int aeDeleteTimeEvent(aeEventLoop *eventLoop, long long id)
+{
+    aeTimeEvent *te, *prev = NULL;
+
+    // 遍历链表
+    te = eventLoop->timeEventHead;
+    while(te) {
+
+        // 发现目标事件，删除
+        if (te->id == id) {
+
+            if (prev == NULL)
+                eventLoop->timeEventHead = te->next;
+            else
+                prev->next = te->next;
+
+            // 执行清理处理器
+            if (te->finalizerProc)
+                te->finalizerProc(eventLoop, te->clientData);
+
+            // 释放时间事件
+            zfree(te);
+
+            return AE_OK;
+        }
+        prev = te;
+        te = te->next;
+    }
+
+    return AE_ERR; /* NO event with the specified ID found */
+}
+
+/* Search the first timer to fire.
+ * This operation is useful to know how many time the select can be
+ * put in sleep without to delay any event.
+ * If there are no timers NULL is returned.
+ *
+ * 寻找里目前时间最近的时间事件
+ * 因为链表是乱序的，所以查找复杂度为 O（N）
+ */
+static aeTimeEvent *aeSearchNearestTimer(aeEventLoop *eventLoop)
+{
+    aeTimeEvent *te = eventLoop->timeEventHead;
+    aeTimeEvent *nearest = NULL;
+
+    while(te) {
+        if (!nearest || te->when_sec < nearest->when_sec ||
+                (te->when_sec == nearest->when_sec &&
+                 te->when_ms < nearest->when_ms))
+            nearest = te;
+        te = te->next;
+    }
+    return nearest;
+}
+
+/* Process time events
+ *
+ * 处理所有已到达的时间事件
+ */
+static int processTimeEvents(aeEventLoop *eventLoop) {
+    int processed = 0;
+    aeTimeEvent *te;
+    long long maxId;
+    time_t now = time(NULL);
+
+    /* If the system clock is moved to the future, and then set back to the
+     * right value, time events may be delayed in a random way. Often this
+     * means that scheduled operations will not be performed soon enough.
+     *
+     * Here we try to detect system clock skews, and force all the time
+     * events to be processed ASAP when this happens: the idea is that
+     * processing events earlier is less dangerous than delaying them
+     * indefinitely, and practice suggests it is. */
+    // 通过重置事件的运行时间，
+    // 防止因时间穿插（skew）而造成的事件处理混乱
+    if (now < eventLoop->lastTime) {
+        te = eventLoop->timeEventHead;
+        while(te) {
+            te->when_sec = 0;
+            te = te->next;
+        }
+    }
+    // 更新最后一次处理时间事件的时间
+    eventLoop->lastTime = now;
+
+    // 遍历链表
+    // 执行那些已经到达的事件
+    te = eventLoop->timeEventHead;
+    maxId = eventLoop->timeEventNextId-1;
+    while(te) {
+        long now_sec, now_ms;
+        long long id;
+
+        // 跳过无效事件
+        if (te->id > maxId) {
+            te = te->next;
+            continue;
+        }
+
+        // 获取当前时间
+        aeGetTime(&now_sec, &now_ms);
+
+        // 如果当前时间等于或等于事件的执行时间，那么说明事件已到达，执行这个事件
+        if (now_sec > te->when_sec ||
+            (now_sec == te->when_sec && now_ms >= te->when_ms))
+        {
+            int retval;
+
+            id = te->id;
+            // 执行事件处理器，并获取返回值
+            retval = te->timeProc(eventLoop, id, te->clientData);
+            processed++;
+
+            // 记录是否有需要循环执行这个事件时间
+            if (retval != AE_NOMORE) {
+                // 是的， retval 毫秒之后继续执行这个时间事件
+                aeAddMillisecondsToNow(retval,&te->when_sec,&te->when_ms);
+            } else {
+                // 不，将这个事件删除
+                aeDeleteTimeEvent(eventLoop, id);
+            }
+
+            // 因为执行事件之后，事件列表可能已经被改变了
+            // 因此需要将 te 放回表头，继续开始执行事件
+            te = eventLoop->timeEventHead;
+        } else {
+            te = te->next;
+        }
+    }
+    return processed;
+}
+
+/* Process every pending time event, then every pending file event
+ * (that may be registered by time event callbacks just processed).
+ *
+ * 处理所有已到达的时间事件，以及所有已就绪的文件事件。
+ *
+ * 函数的返回值为已处理事件的数量
+ */
 int aeProcessEvents(aeEventLoop *eventLoop, int flags)
 {
-    int numevents;
+    int processed = 0, numevents;
+
+    /* Nothing to do? return ASAP */
+    if (!(flags & AE_TIME_EVENTS) && !(flags & AE_FILE_EVENTS)) return 0;
+
+    aeTimeEvent *shortest = NULL;
+    struct timeval tv, *tvp;
+
+    // 获取最近的时间事件
+    if (flags & AE_TIME_EVENTS && !(flags & AE_DONT_WAIT))
+        shortest = aeSearchNearestTimer(eventLoop);
+    if (shortest) {
+        // 如果时间事件存在的话
+        // 那么根据最近可执行时间事件和现在时间的时间差来决定文件事件的阻塞时间
+        long now_sec, now_ms;
+
+        /* Calculate the time missing for the nearest
+         * timer to fire. */
+        // 计算距今最近的时间事件还要多久才能达到
+        // 并将该时间距保存在 tv 结构中
+        aeGetTime(&now_sec, &now_ms);
+        tvp = &tv;
+        tvp->tv_sec = shortest->when_sec - now_sec;
+        if (shortest->when_ms < now_ms) {
+            tvp->tv_usec = ((shortest->when_ms+1000) - now_ms)*1000;
+            tvp->tv_sec --;
+        } else {
+            tvp->tv_usec = (shortest->when_ms - now_ms)*1000;
+        }
+
+        // 时间差小于 0 ，说明事件已经可以执行了，将秒和毫秒设为 0 （不阻塞）
+        if (tvp->tv_sec < 0) tvp->tv_sec = 0;
+        if (tvp->tv_usec < 0) tvp->tv_usec = 0;
+    } else {
+        // 执行到这一步，说明没有时间事件
+        // 那么根据 AE_DONT_WAIT 是否设置来决定是否阻塞，以及阻塞的时间长度
+
+        /* If we have to check for events but need to return
+         * ASAP because of AE_DONT_WAIT we need to set the timeout
+         * to zero */
+        if (flags & AE_DONT_WAIT) {
+            // 设置文件事件不阻塞
+            tv.tv_sec = tv.tv_usec = 0;
+            tvp = &tv;
+        } else {
+            /* Otherwise we can block */
+            // 文件事件可以阻塞直到有事件到达为止
+            tvp = NULL; /* wait forever */
+        }
+    }
 
     // 处理文件事件，阻塞时间由 tvp 决定
-    numevents = aeApiPoll(eventLoop, NULL);
+    numevents = aeApiPoll(eventLoop, tvp);
 
     for (int j = 0; j < numevents; j++) {
         // 从已就绪数组中获取事件
@@ -98,7 +371,16 @@ int aeProcessEvents(aeEventLoop *eventLoop, int flags)
             if (!rfired || fe->wfileProc != fe->rfileProc)
                 fe->wfileProc(eventLoop,fd,fe->clientData,mask);
         }
+
+        processed++;
     }
+
+    /* Check time events */
+    // 执行时间事件
+    if (flags & AE_TIME_EVENTS)
+        processed += processTimeEvents(eventLoop);
+
+    return processed; /* return the number of processed file/time events */
 }
 
 /*
@@ -111,14 +393,21 @@ void aeMain(aeEventLoop *eventLoop) {
     while (!eventLoop->stop) {
 
         // 如果有需要在事件处理前执行的函数，那么运行它
-        // if (eventLoop->beforesleep != NULL)
-        //     eventLoop->beforesleep(eventLoop);
+        if (eventLoop->beforesleep != NULL)
+            eventLoop->beforesleep(eventLoop);
 
         // 开始处理事件
         aeProcessEvents(eventLoop, AE_ALL_EVENTS);
     }
 }
 
+/*
+ * 设置处理事件前需要被执行的函数
+ */
+void aeSetBeforeSleepProc(aeEventLoop *eventLoop, aeBeforeSleepProc *beforesleep) {
+    eventLoop->beforesleep = beforesleep;
+}
+
 /*
  * 将 fd 从 mask 指定的监听队列中删除
  */
@@ -137,4 +426,28 @@ void aeDeleteFileEvent(aeEventLoop *eventLoop, int fd, int mask)
 
     // 取消对给定 fd 的给定事件的监视
     aeApiDelEvent(eventLoop, fd, mask);
-}
\ No newline at end of file
+}
+/* Wait for milliseconds until the given file descriptor becomes
+ * writable/readable/exception
+ *
+ * 在给定毫秒内等待，直到 fd 变成可写、可读或异常
+ */
+int aeWait(int fd, int mask, long long milliseconds) {
+    struct pollfd pfd;
+    int retmask = 0, retval;
+
+    memset(&pfd, 0, sizeof(pfd));
+    pfd.fd = fd;
+    if (mask & AE_READABLE) pfd.events |= POLLIN;
+    if (mask & AE_WRITABLE) pfd.events |= POLLOUT;
+
+    if ((retval = poll(&pfd, 1, milliseconds))== 1) {
+        if (pfd.revents & POLLIN) retmask |= AE_READABLE;
+        if (pfd.revents & POLLOUT) retmask |= AE_WRITABLE;
+        if (pfd.revents & POLLERR) retmask |= AE_WRITABLE;
+        if (pfd.revents & POLLHUP) retmask |= AE_WRITABLE;
+        return retmask;
+    } else {
+        return retval;
+    }
+}
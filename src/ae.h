@@ -1,6 +1,8 @@
 #ifndef __AE_H__
 #define __AE_H__
 
+#include <time.h>
+
 
 /*
  * 事件执行状态
@@ -33,6 +35,11 @@
 // 不阻塞，也不进行等待
 #define AE_DONT_WAIT 4
 
+/*
+ * 决定时间事件是否要持续执行的 flag
+ */
+#define AE_NOMORE -1
+
 
 /*
  * 事件处理器状态
@@ -44,6 +51,9 @@ struct aeEventLoop;
  * 事件接口
  */
 typedef void aeFileProc(struct aeEventLoop *eventLoop, int fd, void *clientData, int mask);
+typedef int aeTimeProc(struct aeEventLoop *eventLoop, long long id, void *clientData);
+typedef void aeEventFinalizerProc(struct aeEventLoop *eventLoop, void *clientData);
+typedef void aeBeforeSleepProc(struct aeEventLoop *eventLoop);
 
 
 /* File event structure
@@ -68,6 +78,33 @@ typedef struct aeFileEvent {
 
 } aeFileEvent;
 
+/* Time event structure
+ *
+ * 时间事件结构
+ */
+typedef struct aeTimeEvent {
+
+    // 时间事件的唯一标识符
+    long long id; /* time event identifier. */
+
+    // 事件的到达时间
+    long when_sec; /* seconds */
+    long when_ms; /* milliseconds */
+
+    // 事件处理函数
+    aeTimeProc *timeProc;
+
+    // 事件释放函数
+    aeEventFinalizerProc *finalizerProc;
+
+    // 多路复用库的私有数据
+    void *clientData;
+
+    // 指向下个时间事件结构，形成链表
+    struct aeTimeEvent *next;
+
+} aeTimeEvent;
+
 /* A fired event
  *
  * 已就绪事件
@@ -98,6 +135,15 @@ typedef struct aeEventLoop {
     // 已就绪的文件事件
     aeFiredEvent *fired; /* Fired events */
 
+    // 用于生成时间事件 id
+    long long timeEventNextId;
+
+    // 最后一次执行时间事件的时间
+    time_t lastTime;     /* Used to detect system clock skew */
+
+    // 时间事件
+    aeTimeEvent *timeEventHead;
+
 
     // 事件处理器的开关
     int stop;
@@ -106,7 +152,7 @@ typedef struct aeEventLoop {
     void *apidata; /* This is used for polling API specific data */
 
     // 在处理事件前要执行的函数
-    // aeBeforeSleepProc *beforesleep;
+    aeBeforeSleepProc *beforesleep;
 
     // 目前已追踪的最大描述符
     int setsize; /* max number of file descriptors tracked */
@@ -121,5 +167,12 @@ aeEventLoop *aeCreateEventLoop(int setsize);
 void aeMain(aeEventLoop *eventLoop);
 
 void aeDeleteFileEvent(aeEventLoop *eventLoop, int fd, int mask);
+int aeWait(int fd, int mask, long long milliseconds);
+
+long long aeCreateTimeEvent(aeEventLoop *eventLoop, long long milliseconds,
+        aeTimeProc *proc, void *clientData,
+        aeEventFinalizerProc *finalizerProc);
+int aeDeleteTimeEvent(aeEventLoop *eventLoop, long long id);
+void aeSetBeforeSleepProc(aeEventLoop *eventLoop, aeBeforeSleepProc *beforesleep);
 
 #endif
\ No newline at end of file
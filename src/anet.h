@@ -6,7 +6,13 @@
 #define ANET_ERR_LEN 256
 
 int anetNonBlock(char *err, int fd);
+int anetBlock(char *err, int fd);
+int anetSendTimeout(char *err, int fd, long long ms);
+int anetEnableTcpNoDelay(char *err, int fd);
+int anetTcpNonBlockConnect(char *err, char *addr, int port);
 int anetTcpAccept(char *err, int s, char *ip, size_t ip_len, int *port);
+int anetPeerToString(int fd, char *ip, size_t ip_len, int *port);
+int anetSockName(int fd, char *ip, size_t ip_len, int *port);
 
 int anetTcpServer(char *err, int port, char *bindaddr, int backlog);
 
@@ -0,0 +1,2036 @@
+/* Append only file persistence.
+ *
+ * AOF 持久化
+ *
+ * Every command that modified the dataset is appended, in the same format
+ * of the Redis protocol, to server.aof_buf by feedAppendOnlyFile(). The
+ * buffer is written to the file by flushAppendOnlyFile() from beforeSleep(),
+ * that is once per event loop iteration: all the writes served in the same
+ * iteration share a single write() and, when appendfsync is always, a single
+ * fsync() (group commit). Replies are sent only in the next iteration, so a
+ * client never sees the reply of a write that is not in the file yet.
+ *
+ * 所有修改数据库的命令都以协议格式追加到 server.aof_buf 中，
+ * beforeSleep() 在每次事件循环中调用一次 flushAppendOnlyFile() ，
+ * 用一次 write() （以及 appendfsync always 时的一次 fsync() ）
+ * 写入这次循环中执行的所有写命令（group commit）。
+ * 命令回复要到下次事件循环才会被发送，
+ * 所以客户端收到回复时，命令已经写入到文件中了。
+ *
+ * The log is made of a base file plus incremental files, listed by a
+ * manifest, so that BGREWRITEAOF can compact it in a child process without
+ * ever stalling the parent. See the manifest section below.
+ *
+ * 日志由一个基础文件和若干增量文件组成，由清单记录，
+ * 这样 BGREWRITEAOF 可以在子进程中压缩日志，而不会阻塞父进程。详见下面的清单部分。
+ */
+#include "redis.h"
+#include "bio.h"
+#include "rio.h"
+#include "rdb.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+/* ----------------------------------------------------------------------------
+ * AOF file implementation
+ * ------------------------------------------------------------------------- */
+
+/* Record the duration of a fsync() of the AOF. This is called both from the
+ * main thread (appendfsync always) and from the bio thread (everysec) so
+ * the stats are only accessed atomically.
+ *
+ * 记录一次 fsync 的耗时。
+ * 主线程和后台线程都会调用这个函数，所以统计数据只通过原子操作访问。 */
+static void aofRecordFsync(long long usec) {
+    long long max = __atomic_load_n(&server.stat_aof_fsync_usec_max,
+                                    __ATOMIC_RELAXED);
+
+    __atomic_add_fetch(&server.stat_aof_fsyncs,1,__ATOMIC_RELAXED);
+    __atomic_add_fetch(&server.stat_aof_fsync_usec,usec,__ATOMIC_RELAXED);
+    __atomic_store_n(&server.stat_aof_fsync_usec_last,usec,__ATOMIC_RELAXED);
+    while (usec > max &&
+           !__atomic_compare_exchange_n(&server.stat_aof_fsync_usec_max,
+                &max,usec,0,__ATOMIC_RELAXED,__ATOMIC_RELAXED));
+}
+
+/*
+ * 对 AOF 文件执行 fsync ，并记录耗时
+ *
+ * Only the data is flushed (fdatasync), the file metadata like the
+ * modification time is not needed to read the log back.
+ */
+void aofFsync(int fd) {
+    long long start = ustime();
+
+    if (fdatasync(fd) == -1) {
+        redisLog(REDIS_WARNING,"Error syncing the AOF file: %s",
+            strerror(errno));
+        return;
+    }
+    aofRecordFsync(ustime()-start);
+}
+
+/* Starts a background task that performs fsync() against the specified
+ * file descriptor (the one of the AOF file) in another thread.
+ *
+ * 在另一个线程中，对给定的描述符 fd （指向 AOF 文件）执行一个后台 fsync() 操作。
+ */
+static void aofBackgroundFsync(int fd) {
+    bioCreateBackgroundJob(BIO_AOF_FSYNC,(void*)(long)fd,NULL,NULL);
+}
+
+/* ----------------------------------------------------------------------------
+ * AOF manifest implementation
+ * ------------------------------------------------------------------------- */
+
+/* The AOF is split in a base file, written by the latest rewrite from the
+ * keyspace, and a list of incremental files holding the commands appended
+ * after it. A rewrite never has to copy the commands received while the
+ * child is running: the parent simply appends them to a new incremental
+ * file opened at fork() time, and when the child is done the manifest is
+ * replaced atomically with one listing the new base plus that file.
+ *
+ * AOF 被分为一个基础文件（由最近一次重写根据数据库生成），
+ * 以及保存之后追加的命令的增量文件。
+ * 重写期间父进程收到的命令直接写入到 fork() 时新打开的增量文件中，
+ * 不需要重写缓冲区，也不需要在重写结束时复制这些命令：
+ * 子进程完成之后，只需要原子地替换清单，让它指向新的基础文件和这个增量文件。
+ *
+ * The manifest has one line per file, for instance:
+ *
+ * 清单中每个文件占一行，例如：
+ *
+ *   file appendonly.aof.2.base.aof seq 2 type b
+ *   file appendonly.aof.3.incr.aof seq 3 type i
+ *
+ * Files replaced by a rewrite are kept as history ('h') until they are
+ * deleted, so they can never be loaded again.
+ *
+ * 被重写替换的文件在删除之前被记录为历史文件（'h'），不会再被载入。
+ */
+
+/*
+ * 创建一个新的 aofInfo
+ */
+static aofInfo *aofInfoCreate(void) {
+    return zcalloc(sizeof(aofInfo));
+}
+
+/*
+ * 释放 aofInfo
+ */
+static void aofInfoFree(aofInfo *ai) {
+    if (ai->file_name) sdsfree(ai->file_name);
+    zfree(ai);
+}
+
+/*
+ * 复制 aofInfo
+ */
+static aofInfo *aofInfoDup(aofInfo *orig) {
+    aofInfo *ai = aofInfoCreate();
+
+    ai->file_name = sdsdup(orig->file_name);
+    ai->file_seq = orig->file_seq;
+    ai->file_type = orig->file_type;
+    return ai;
+}
+
+/* Method to free AOF list elements. */
+static void aofListFree(void *item) {
+    aofInfoFree(item);
+}
+
+/*
+ * 创建一个空的清单
+ */
+static aofManifest *aofManifestCreate(void) {
+    aofManifest *am = zcalloc(sizeof(aofManifest));
+
+    am->incr_aof_list = listCreate();
+    am->history_aof_list = listCreate();
+    listSetFreeMethod(am->incr_aof_list,aofListFree);
+    listSetFreeMethod(am->history_aof_list,aofListFree);
+    return am;
+}
+
+/*
+ * 释放清单
+ */
+static void aofManifestFree(aofManifest *am) {
+    if (am->base_aof_info) aofInfoFree(am->base_aof_info);
+    listRelease(am->incr_aof_list);
+    listRelease(am->history_aof_list);
+    zfree(am);
+}
+
+/*
+ * 复制 src 中的所有文件到 dst 的末尾
+ */
+static void aofListCopy(list *dst, list *src) {
+    listIter li;
+    listNode *ln;
+
+    listRewind(src,&li);
+    while((ln = listNext(&li)) != NULL)
+        listAddNodeTail(dst,aofInfoDup(listNodeValue(ln)));
+}
+
+/* Return a copy of the manifest. The changes made by a rewrite are first
+ * applied to a copy, so that the manifest in use is left untouched if
+ * persisting the new one fails.
+ *
+ * 返回清单的一个副本。重写对清单的修改先作用在副本上，
+ * 这样在新清单保存失败时，正在使用的清单不受影响。
+ */
+static aofManifest *aofManifestDup(aofManifest *orig) {
+    aofManifest *am = aofManifestCreate();
+
+    if (orig->base_aof_info)
+        am->base_aof_info = aofInfoDup(orig->base_aof_info);
+    aofListCopy(am->incr_aof_list,orig->incr_aof_list);
+    aofListCopy(am->history_aof_list,orig->history_aof_list);
+    am->curr_base_file_seq = orig->curr_base_file_seq;
+    am->curr_incr_file_seq = orig->curr_incr_file_seq;
+    return am;
+}
+
+/*
+ * 将一个文件的描述追加到清单字符串中
+ */
+static sds catAofInfo(sds buf, aofInfo *ai) {
+    buf = sdscat(buf,"file ");
+    // 带有空格或者引号的文件名需要转义，才能被 sdssplitargs() 正确分析
+    if (strpbrk(ai->file_name," \t\r\n\"'\\"))
+        buf = sdscatrepr(buf,ai->file_name,sdslen(ai->file_name));
+    else
+        buf = sdscatlen(buf,ai->file_name,sdslen(ai->file_name));
+    return sdscatprintf(buf," seq %lld type %c\n",ai->file_seq,ai->file_type);
+}
+
+/*
+ * 返回清单的文本表示：基础文件，历史文件，然后按顺序排列的增量文件
+ */
+static sds getAofManifestAsString(aofManifest *am) {
+    sds buf = sdsempty();
+    listIter li;
+    listNode *ln;
+
+    if (am->base_aof_info) buf = catAofInfo(buf,am->base_aof_info);
+    listRewind(am->history_aof_list,&li);
+    while((ln = listNext(&li)) != NULL) buf = catAofInfo(buf,listNodeValue(ln));
+    listRewind(am->incr_aof_list,&li);
+    while((ln = listNext(&li)) != NULL) buf = catAofInfo(buf,listNodeValue(ln));
+    return buf;
+}
+
+/*
+ * 返回清单文件的名字
+ */
+static sds getAofManifestFileName(void) {
+    return sdscat(sdsnew(server.aof_filename),REDIS_AOF_MANIFEST_SUFFIX);
+}
+
+/* While the AOF is being turned on, the commands are appended to a temp
+ * incremental file, that is only added to the manifest once the first
+ * base file is written.
+ *
+ * 在 AOF 开启的过程中，命令被写入到一个临时增量文件，
+ * 第一个基础文件写入完成之后，这个文件才被加入到清单中。
+ */
+static sds getTempIncrAofName(void) {
+    return sdscatprintf(sdsempty(),"%s%s%s",REDIS_AOF_TEMP_PREFIX,
+        server.aof_filename,REDIS_AOF_INCR_SUFFIX);
+}
+
+/* Load the manifest from disk into server.aof_manifest. This is called
+ * at startup, any error in the manifest is fatal.
+ *
+ * 在启动时从磁盘载入清单到 server.aof_manifest ，清单中的任何错误都是致命的。
+ *
+ * When there is no manifest but the append only file exists, the file
+ * was written by a previous version with a single AOF: it becomes the
+ * base file, so that the next rewrite replaces it.
+ *
+ * 如果清单不存在，但 AOF 文件存在，那么这是旧版本写入的单个 AOF 文件：
+ * 它被当作基础文件，下次重写之后就会被替换。
+ */
+void aofLoadManifestFromDisk(void) {
+    aofManifest *am = aofManifestCreate();
+    sds am_name = getAofManifestFileName();
+    char buf[1024];
+    int linenum = 0;
+    char *err = NULL;
+    FILE *fp;
+
+    server.aof_manifest = am;
+
+    fp = fopen(am_name,"r");
+    if (fp == NULL) {
+        struct stat sb;
+
+        if (errno != ENOENT) {
+            redisLog(REDIS_WARNING,"Fatal error: can't open the AOF manifest "
+                "%s for reading: %s",am_name,strerror(errno));
+            exit(1);
+        }
+        // 旧版本的单个 AOF 文件
+        if (stat(server.aof_filename,&sb) == 0) {
+            am->base_aof_info = aofInfoCreate();
+            am->base_aof_info->file_name = sdsnew(server.aof_filename);
+            am->base_aof_info->file_seq = 0;
+            am->base_aof_info->file_type = AOF_FILE_TYPE_BASE;
+            redisLog(REDIS_NOTICE,"Using the legacy append only file %s "
+                "as the AOF base file",server.aof_filename);
+        }
+        sdsfree(am_name);
+        return;
+    }
+
+    while(fgets(buf,sizeof(buf),fp) != NULL) {
+        sds *argv;
+        int argc, j;
+        aofInfo *ai;
+
+        linenum++;
+        if (buf[0] == '#' || buf[0] == '\n') continue;
+        if (strchr(buf,'\n') == NULL) {
+            err = "Line too long";
+            goto loaderr;
+        }
+
+        argv = sdssplitargs(buf,&argc);
+        if (argv == NULL || argc == 0 || argc % 2) {
+            if (argv) sdsfreesplitres(argv,argc);
+            err = "Invalid number of arguments";
+            goto loaderr;
+        }
+
+        // 分析 key value 对
+        ai = aofInfoCreate();
+        for (j = 0; j < argc; j += 2) {
+            if (!strcasecmp(argv[j],"file")) {
+                if (ai->file_name) sdsfree(ai->file_name);
+                ai->file_name = sdsdup(argv[j+1]);
+            } else if (!strcasecmp(argv[j],"seq")) {
+                ai->file_seq = strtoll(argv[j+1],NULL,10);
+            } else if (!strcasecmp(argv[j],"type")) {
+                ai->file_type = argv[j+1][0];
+            }
+            /* Unknown keys are ignored. */
+        }
+        sdsfreesplitres(argv,argc);
+
+        if (ai->file_name == NULL || strchr(ai->file_name,'/') ||
+            ai->file_seq < 0 || ai->file_type == 0)
+        {
+            aofInfoFree(ai);
+            err = "Invalid AOF file description";
+            goto loaderr;
+        }
+
+        // 将文件放入对应的位置
+        if (ai->file_type == AOF_FILE_TYPE_BASE) {
+            if (am->base_aof_info) {
+                aofInfoFree(ai);
+                err = "Found a duplicate base file";
+                goto loaderr;
+            }
+            am->base_aof_info = ai;
+            am->curr_base_file_seq = ai->file_seq;
+        } else if (ai->file_type == AOF_FILE_TYPE_HIST) {
+            listAddNodeTail(am->history_aof_list,ai);
+        } else if (ai->file_type == AOF_FILE_TYPE_INCR) {
+            if (ai->file_seq <= am->curr_incr_file_seq) {
+                aofInfoFree(ai);
+                err = "Found a non-monotonic incr file sequence";
+                goto loaderr;
+            }
+            listAddNodeTail(am->incr_aof_list,ai);
+            am->curr_incr_file_seq = ai->file_seq;
+        } else {
+            aofInfoFree(ai);
+            err = "Unknown AOF file type";
+            goto loaderr;
+        }
+    }
+    if (ferror(fp)) {
+        err = strerror(errno);
+        goto loaderr;
+    }
+    fclose(fp);
+    sdsfree(am_name);
+    return;
+
+loaderr:
+    redisLog(REDIS_WARNING,"*** FATAL AOF MANIFEST FILE ERROR ***");
+    redisLog(REDIS_WARNING,"Reading %s at line %d: %s",am_name,linenum,err);
+    exit(1);
+}
+
+/* Write the manifest to a temp file and rename it over the current one,
+ * so that a crash leaves either the old or the new manifest on disk.
+ *
+ * 将清单写入临时文件，再改名覆盖当前的清单，
+ * 这样即使崩溃，磁盘上留下的也是完整的旧清单或者新清单。
+ */
+static int persistAofManifest(aofManifest *am) {
+    sds am_name = getAofManifestFileName();
+    sds tmp_am_name = sdscatprintf(sdsempty(),"%s%s",
+        REDIS_AOF_TEMP_PREFIX,am_name);
+    sds buf = getAofManifestAsString(am);
+    char *p = buf;
+    size_t len = sdslen(buf);
+    int fd, retval = REDIS_ERR;
+
+    fd = open(tmp_am_name,O_WRONLY|O_TRUNC|O_CREAT,0644);
+    if (fd == -1) {
+        redisLog(REDIS_WARNING,"Can't open the AOF manifest file %s: %s",
+            tmp_am_name,strerror(errno));
+        goto cleanup;
+    }
+
+    while(len) {
+        ssize_t nwritten = write(fd,p,len);
+
+        if (nwritten < 0) {
+            if (errno == EINTR) continue;
+            redisLog(REDIS_WARNING,"Error trying to write the temporary AOF "
+                "manifest file %s: %s",tmp_am_name,strerror(errno));
+            close(fd);
+            goto cleanup;
+        }
+        p += nwritten;
+        len -= nwritten;
+    }
+
+    if (fsync(fd) == -1 || close(fd) == -1) {
+        redisLog(REDIS_WARNING,"Fail to fsync the temp AOF manifest file "
+            "%s: %s",tmp_am_name,strerror(errno));
+        goto cleanup;
+    }
+
+    // 原子地替换清单，然后 fsync 目录，确保改名被持久化
+    if (rename(tmp_am_name,am_name) == -1) {
+        redisLog(REDIS_WARNING,"Error trying to rename the temporary AOF "
+            "manifest file %s into %s: %s",tmp_am_name,am_name,
+            strerror(errno));
+        goto cleanup;
+    }
+    rdbFsyncFileDir(am_name);
+    retval = REDIS_OK;
+
+cleanup:
+    if (retval == REDIS_ERR) unlink(tmp_am_name);
+    sdsfree(am_name);
+    sdsfree(tmp_am_name);
+    sdsfree(buf);
+    return retval;
+}
+
+/* Mark the current base file as history and add a new base file to the
+ * manifest, returning its name.
+ *
+ * 将当前的基础文件标记为历史文件，并向清单添加一个新的基础文件，返回它的名字。
+ */
+static sds getNewBaseFileNameAndMarkPreAsHistory(aofManifest *am) {
+    aofInfo *ai;
+
+    if (am->base_aof_info) {
+        am->base_aof_info->file_type = AOF_FILE_TYPE_HIST;
+        listAddNodeHead(am->history_aof_list,am->base_aof_info);
+    }
+
+    ai = aofInfoCreate();
+    ai->file_seq = ++am->curr_base_file_seq;
+    ai->file_name = sdscatprintf(sdsempty(),"%s.%lld%s",
+        server.aof_filename,ai->file_seq,REDIS_AOF_BASE_SUFFIX);
+    ai->file_type = AOF_FILE_TYPE_BASE;
+    am->base_aof_info = ai;
+    return sdsdup(ai->file_name);
+}
+
+/*
+ * 向清单的末尾添加一个新的增量文件，返回它的名字
+ */
+static sds getNewIncrAofName(aofManifest *am) {
+    aofInfo *ai = aofInfoCreate();
+
+    ai->file_seq = ++am->curr_incr_file_seq;
+    ai->file_name = sdscatprintf(sdsempty(),"%s.%lld%s",
+        server.aof_filename,ai->file_seq,REDIS_AOF_INCR_SUFFIX);
+    ai->file_type = AOF_FILE_TYPE_INCR;
+    listAddNodeTail(am->incr_aof_list,ai);
+    return sdsdup(ai->file_name);
+}
+
+/* Called when a rewrite succeeds: the incremental files older than the
+ * fork() are covered by the new base file and become history. When the
+ * AOF is on, the last incremental file was opened at fork() time and is
+ * kept, otherwise all of them are stale.
+ *
+ * 重写成功时调用： fork() 之前的增量文件已经被新的基础文件覆盖，成为历史文件。
+ * AOF 开启时，最后一个增量文件是在 fork() 时打开的，需要保留；
+ * 否则所有的增量文件都已经过时。
+ */
+static void markRewrittenIncrAofAsHistory(aofManifest *am) {
+    listNode *ln;
+    listIter li;
+
+    listRewind(am->incr_aof_list,&li);
+    while((ln = listNext(&li)) != NULL) {
+        aofInfo *ai = listNodeValue(ln);
+
+        if (server.aof_state == REDIS_AOF_ON &&
+            ln == listLast(am->incr_aof_list)) break;
+
+        ai = aofInfoDup(ai);
+        ai->file_type = AOF_FILE_TYPE_HIST;
+        listAddNodeTail(am->history_aof_list,ai);
+        listDelNode(am->incr_aof_list,ln);
+    }
+}
+
+/* Unlink a file without blocking: if the file is open, the unlink only
+ * removes the name, and the space is reclaimed by the close(2) of the
+ * last reference, that is performed by a background thread.
+ *
+ * 以不阻塞的方式删除文件：文件打开时， unlink 只是移除文件名，
+ * 文件空间要到最后一个引用被 close(2) 时才会被回收，而这由后台线程执行。
+ */
+static void bgUnlink(const char *filename) {
+    int fd = open(filename,O_RDONLY|O_NONBLOCK);
+
+    if (fd == -1) {
+        unlink(filename);
+    } else if (unlink(filename) == -1) {
+        close(fd);
+    } else {
+        bioCreateBackgroundJob(BIO_CLOSE_FILE,(void*)(long)fd,NULL,NULL);
+    }
+}
+
+/*
+ * 删除清单中所有的历史文件，然后保存清单
+ */
+static void aofDelHistoryFiles(void) {
+    list *history = server.aof_manifest->history_aof_list;
+    listNode *ln;
+
+    if (listLength(history) == 0) return;
+
+    while((ln = listFirst(history)) != NULL) {
+        aofInfo *ai = listNodeValue(ln);
+
+        redisLog(REDIS_NOTICE,"Removing the history file %s in the "
+            "background",ai->file_name);
+        bgUnlink(ai->file_name);
+        listDelNode(history,ln);
+    }
+    persistAofManifest(server.aof_manifest);
+}
+
+/*
+ * 返回文件的大小，出错时返回 0
+ */
+static off_t getAppendOnlyFileSize(const char *filename) {
+    struct stat sb;
+
+    return stat(filename,&sb) == -1 ? 0 : sb.st_size;
+}
+
+/* Called at startup, after the dataset was loaded: open the last
+ * incremental file for appending, or create the first one (when the AOF
+ * is new, or is a legacy single file) and record it in the manifest.
+ *
+ * 在启动并载入数据之后调用：打开最后一个增量文件用于追加，
+ * 或者（新的 AOF ，或者旧版本的单个 AOF 文件）创建第一个增量文件，并记录到清单中。
+ */
+void aofOpenIfNeededOnServerStart(void) {
+    aofManifest *am = server.aof_manifest;
+    sds incr_name;
+
+    if (server.aof_state != REDIS_AOF_ON) return;
+
+    if (listLength(am->incr_aof_list) == 0) {
+        incr_name = getNewIncrAofName(am);
+    } else {
+        aofInfo *ai = listNodeValue(listLast(am->incr_aof_list));
+        incr_name = sdsdup(ai->file_name);
+    }
+
+    server.aof_fd = open(incr_name,O_WRONLY|O_APPEND|O_CREAT,0644);
+    if (server.aof_fd == -1) {
+        redisLog(REDIS_WARNING,"Can't open the append-only file %s: %s",
+            incr_name,strerror(errno));
+        exit(1);
+    }
+    if (persistAofManifest(am) == REDIS_ERR) exit(1);
+
+    server.aof_last_incr_size = getAppendOnlyFileSize(incr_name);
+    server.aof_fsync_offset = server.aof_last_incr_size;
+    sdsfree(incr_name);
+}
+
+/* Switch the appends to a new incremental file. This is called just before
+ * the fork() of a rewrite, so that the new file holds exactly the commands
+ * the child will not see.
+ *
+ * 将追加切换到一个新的增量文件。
+ * 这个函数在重写 fork() 之前调用，这样新文件保存的正好是子进程看不到的那些命令。
+ *
+ * When the AOF is on the new file is recorded in the manifest right away:
+ * if the rewrite fails, the manifest is still a complete log. The old file
+ * is synced and closed by a background thread.
+ *
+ * AOF 开启时，新文件立即被记录到清单中，即使重写失败，清单仍然是一个完整的日志。
+ * 旧文件由后台线程 fsync 并关闭。
+ */
+static int openNewIncrAofForAppend(void) {
+    aofManifest *temp_am = NULL;
+    sds new_name;
+    int newfd;
+
+    if (server.aof_state == REDIS_AOF_OFF) return REDIS_OK;
+
+    if (server.aof_state == REDIS_AOF_WAIT_REWRITE) {
+        // 新的快照包含了缓冲区中的命令，所以之前写入的内容可以丢弃
+        new_name = getTempIncrAofName();
+        newfd = open(new_name,O_WRONLY|O_TRUNC|O_CREAT,0644);
+        sdsclear(server.aof_buf);
+    } else {
+        // 旧文件中的内容必须先写完
+        flushAppendOnlyFile(1);
+        temp_am = aofManifestDup(server.aof_manifest);
+        new_name = getNewIncrAofName(temp_am);
+        newfd = open(new_name,O_WRONLY|O_APPEND|O_CREAT,0644);
+    }
+
+    if (newfd == -1) {
+        redisLog(REDIS_WARNING,"Can't open the append-only file %s: %s",
+            new_name,strerror(errno));
+        goto werr;
+    }
+
+    if (temp_am) {
+        if (persistAofManifest(temp_am) == REDIS_ERR) {
+            close(newfd);
+            unlink(new_name);
+            goto werr;
+        }
+        aofManifestFree(server.aof_manifest);
+        server.aof_manifest = temp_am;
+    }
+
+    // 在后台关闭旧文件，正常追加时先执行 fsync
+    if (server.aof_fd != -1) {
+        int need_fsync = server.aof_state == REDIS_AOF_ON &&
+                         server.aof_fsync != AOF_FSYNC_NO;
+        bioCreateBackgroundJob(BIO_CLOSE_FILE,(void*)(long)server.aof_fd,
+            (void*)(long)need_fsync,NULL);
+    }
+
+    server.aof_fd = newfd;
+    server.aof_last_incr_size = 0;
+    server.aof_fsync_offset = 0;
+    server.aof_selected_db = -1; /* Every incr file starts with a SELECT. */
+    sdsfree(new_name);
+    return REDIS_OK;
+
+werr:
+    if (temp_am) aofManifestFree(temp_am);
+    sdsfree(new_name);
+    return REDIS_ERR;
+}
+
+/* Kill the rewriting child, waiting for it to exit, and remove its temp
+ * files.
+ *
+ * 杀死正在执行重写的子进程，等待它退出，并删除它的临时文件。
+ */
+void killAppendOnlyChild(void) {
+    char tmpfile[256];
+    int statloc;
+
+    if (server.aof_child_pid == -1) return;
+
+    redisLog(REDIS_NOTICE,"Killing running AOF rewrite child: %ld",
+        (long) server.aof_child_pid);
+    if (kill(server.aof_child_pid,SIGUSR1) != -1) {
+        while(waitpid(server.aof_child_pid,&statloc,0) == -1 &&
+              errno == EINTR);
+    }
+
+    // 删除重写的临时文件
+    snprintf(tmpfile,256,"temp-rewriteaof-bg-%d.aof",
+        (int) server.aof_child_pid);
+    unlink(tmpfile);
+    snprintf(tmpfile,256,"temp-rewriteaof-%d.aof",
+        (int) server.aof_child_pid);
+    unlink(tmpfile);
+
+    server.aof_child_pid = -1;
+    server.aof_rewrite_time_start = -1;
+    closeChildInfoPipe();
+    updateDictResizePolicy();
+}
+
+/* Called when the user switches from "appendonly yes" to "appendonly no"
+ * at runtime using the CONFIG command.
+ *
+ * 在用户通过 CONFIG 命令在运行时关闭 AOF 持久化时调用
+ */
+void stopAppendOnly(void) {
+
+    // AOF 必须正在启用，才能调用这个函数
+    redisAssert(server.aof_state != REDIS_AOF_OFF);
+
+    // 将 AOF 缓存的内容写入并冲洗到 AOF 文件中
+    // 参数 1 表示强制模式
+    if (server.aof_state == REDIS_AOF_ON) {
+        flushAppendOnlyFile(1);
+        aofFsync(server.aof_fd);
+    }
+
+    // 如果重写正在进行，那么杀死子进程
+    killAppendOnlyChild();
+
+    // 关闭 AOF 文件，还没有完成开启的 AOF 的临时增量文件没有用了
+    if (server.aof_fd != -1) {
+        close(server.aof_fd);
+        if (server.aof_state == REDIS_AOF_WAIT_REWRITE) {
+            sds temp_incr_name = getTempIncrAofName();
+            unlink(temp_incr_name);
+            sdsfree(temp_incr_name);
+        }
+    }
+
+    // 清空 AOF 状态
+    server.aof_fd = -1;
+    server.aof_selected_db = -1;
+    server.aof_state = REDIS_AOF_OFF;
+    server.aof_rewrite_scheduled = 0;
+    sdsclear(server.aof_buf);
+}
+
+/* Called when the user switches from "appendonly no" to "appendonly yes"
+ * at runtime using the CONFIG command.
+ *
+ * 当用户在运行时使用 CONFIG 命令，
+ * 从 appendonly no 切换到 appendonly yes 时执行
+ *
+ * A background rewrite writes the first base file, meanwhile the commands
+ * are appended to a temp incremental file. The AOF is really on only when
+ * the rewrite succeeds (REDIS_AOF_WAIT_REWRITE until then).
+ *
+ * 后台重写负责写入第一个基础文件，同时命令被追加到临时增量文件中。
+ * 要等到重写成功之后， AOF 才真正开启（在此之前状态为 REDIS_AOF_WAIT_REWRITE ）。
+ */
+int startAppendOnly(void) {
+
+    redisAssert(server.aof_state == REDIS_AOF_OFF);
+
+    server.aof_state = REDIS_AOF_WAIT_REWRITE;
+
+    // 有其他子进程正在运行，等它退出之后再开始重写
+    if (hasActiveChildProcess()) {
+        server.aof_rewrite_scheduled = 1;
+        redisLog(REDIS_WARNING,"AOF was enabled but there is already a child "
+            "process. An AOF background rewrite was scheduled to start "
+            "when possible.");
+    } else if (rewriteAppendOnlyFileBackground() == REDIS_ERR) {
+        if (server.aof_fd != -1) {
+            sds temp_incr_name = getTempIncrAofName();
+            close(server.aof_fd);
+            unlink(temp_incr_name);
+            sdsfree(temp_incr_name);
+            server.aof_fd = -1;
+        }
+        server.aof_state = REDIS_AOF_OFF;
+        redisLog(REDIS_WARNING,"Redis needs to enable the AOF but can't "
+            "trigger a background AOF rewrite operation. Check the above "
+            "logs for more info about the error.");
+        return REDIS_ERR;
+    }
+
+    // 更新 AOF 状态
+    server.aof_last_fsync = time(NULL);
+    server.aof_last_write_status = REDIS_OK;
+    return REDIS_OK;
+}
+
+/* Write the append only file buffer on disk.
+ *
+ * 将 AOF 缓存写入到文件中。
+ *
+ * Since we are required to write the AOF before replying to the client,
+ * and the only way the client socket can get a write is entering when the
+ * the event loop, we accumulate all the AOF writes in a memory
+ * buffer and write it on disk using this function just before entering
+ * the event loop again.
+ *
+ * 因为程序需要在回复客户端之前对 AOF 执行写操作。
+ * 而客户端能执行写操作的唯一机会就是在事件 loop 中，
+ * 因此，程序将所有 AOF 写累积到缓存中，
+ * 并在重新进入事件 loop 之前，将缓存写入到文件中。
+ *
+ * About the 'force' argument:
+ *
+ * 关于 force 参数：
+ *
+ * When the fsync policy is set to 'everysec' we may delay the flush if there
+ * is still an fsync() going on in the background thread, since for instance
+ * on Linux write(2) will be blocked by the background fsync anyway.
+ *
+ * 当 fsync 策略为每秒钟保存一次时，如果后台线程仍然有 fsync 在执行，
+ * 那么我们可能会延迟执行冲洗（flush）操作，
+ * 因为 Linux 上的 write(2) 会被后台的 fsync 阻塞。
+ *
+ * When this happens we remember that there is some aof buffer to be
+ * flushed ASAP, and will try again from the next beforeSleep() call.
+ *
+ * 当这种情况发生时，说明需要尽快冲洗 aof 缓存，
+ * 程序会在下次调用 beforeSleep() 时再次尝试对缓存进行冲洗。
+ *
+ * However if force is set to 1 we'll write regardless of the background
+ * fsync.
+ *
+ * 不过，如果 force 为 1 的话，那么不管后台是否正在 fsync ，
+ * 程序都直接进行写入。
+ */
+void flushAppendOnlyFile(int force) {
+    ssize_t nwritten;
+    int sync_in_progress = 0;
+    long long start, duration;
+    time_t now = time(NULL);
+
+    // 缓冲区中没有任何内容，直接返回
+    // 不过如果 everysec 策略下有已经写入、但还没有 fsync 的内容，
+    // 那么仍然需要按时执行 fsync
+    if (sdslen(server.aof_buf) == 0) {
+        if (server.aof_fsync == AOF_FSYNC_EVERYSEC &&
+            server.aof_fsync_offset != server.aof_last_incr_size &&
+            now > server.aof_last_fsync &&
+            bioPendingJobsOfType(BIO_AOF_FSYNC) == 0)
+        {
+            goto try_fsync;
+        }
+        return;
+    }
+
+    // 策略为每秒 FSYNC ，检查是否有后台 fsync 正在运行
+    if (server.aof_fsync == AOF_FSYNC_EVERYSEC)
+        sync_in_progress = bioPendingJobsOfType(BIO_AOF_FSYNC) != 0;
+
+    // 每秒 fsync ，并且强制写入为假
+    if (server.aof_fsync == AOF_FSYNC_EVERYSEC && !force) {
+
+        /* With this append fsync policy we do background fsyncing.
+         *
+         * 当 fsync 策略为每秒钟一次时， fsync 在后台执行。
+         *
+         * If the fsync is still in progress we can try to delay
+         * the write for a couple of seconds.
+         *
+         * 如果后台仍在执行 FSYNC ，那么我们可以延迟写操作一两秒
+         * （如果强制执行 write 的话，服务器主线程将阻塞在 write 上面）
+         */
+        if (sync_in_progress) {
+
+            // 有 fsync 正在后台进行 。。。
+
+            if (server.aof_flush_postponed_start == 0) {
+                /* No previous write postponinig, remember that we are
+                 * postponing the flush and return.
+                 *
+                 * 前面没有推迟过 write 操作，这里将推迟写操作的时间记录下来
+                 * 然后就返回，不执行 write 或者 fsync
+                 */
+                server.aof_flush_postponed_start = now;
+                return;
+
+            } else if (now - server.aof_flush_postponed_start <
+                       REDIS_AOF_MAX_FLUSH_DELAY) {
+                /* We were already waiting for fsync to finish, but for less
+                 * than two seconds this is still ok. Postpone again.
+                 *
+                 * 如果之前已经因为 fsync 而推迟了 write 操作
+                 * 但是推迟的时间不超过 2 秒，那么直接返回
+                 * 不执行 write 或者 fsync
+                 */
+                return;
+
+            }
+
+            /* Otherwise fall trough, and go write since we can't wait
+             * over two seconds.
+             *
+             * 如果后台还有 fsync 在执行，并且 write 已经推迟 >= 2 秒
+             * 那么执行写操作（write 将被阻塞）
+             */
+            server.aof_delayed_fsync++;
+            redisLog(REDIS_NOTICE,"Asynchronous AOF fsync is taking too long (disk is busy?). Writing the AOF buffer without waiting for fsync to complete, this may slow down Redis.");
+        }
+    }
+
+    /* If you are following this code path, then we are going to write so
+     * set reset the postponed flush sentinel to zero.
+     *
+     * 执行到这里，程序会对 AOF 文件进行写入。
+     *
+     * 清零延迟 write 的时间记录
+     */
+    server.aof_flush_postponed_start = 0;
+
+    /* We want to perform a single write. This should be guaranteed atomic
+     * at least if the filesystem we are writing is a real physical one.
+     *
+     * 执行单个 write 操作，如果写入设备是物理的话，那么这个操作应该是原子的
+     *
+     * While this will save us against the server being killed I don't think
+     * there is much to do about the whole server stopping for power problems
+     * or alike
+     *
+     * 当然，如果出现像电源中断这样的不可抗现象，那么 AOF 文件也是可能会出现问题的
+     * 这时就要用 aof-load-truncated 选项来进行修复。
+     */
+    start = ustime();
+    nwritten = write(server.aof_fd,server.aof_buf,sdslen(server.aof_buf));
+    duration = ustime()-start;
+
+    // 记录 write 的次数和耗时
+    server.stat_aof_writes++;
+    server.stat_aof_write_usec += duration;
+    server.stat_aof_write_usec_last = duration;
+    if (duration > server.stat_aof_write_usec_max)
+        server.stat_aof_write_usec_max = duration;
+
+    if (nwritten != (signed)sdslen(server.aof_buf)) {
+
+        /* Log the AOF write error and record the error code. */
+        if (nwritten == -1) {
+            redisLog(REDIS_WARNING,"Error writing to the AOF file: %s",
+                strerror(errno));
+            server.aof_last_write_errno = errno;
+        } else {
+            redisLog(REDIS_WARNING,"Short write while writing to "
+                                   "the AOF file: (nwritten=%lld, "
+                                   "expected=%lld)",
+                                   (long long)nwritten,
+                                   (long long)sdslen(server.aof_buf));
+
+            // 尝试移除新追加的不完整内容
+            if (ftruncate(server.aof_fd, server.aof_last_incr_size) == -1) {
+                redisLog(REDIS_WARNING, "Could not remove short write "
+                         "from the append-only file.  Redis may refuse "
+                         "to load the AOF the next time it starts.  "
+                         "ftruncate: %s", strerror(errno));
+            } else {
+                /* If the ftruncate() succeeded we can set nwritten to
+                 * -1 since there is no longer partial data into the AOF. */
+                nwritten = -1;
+            }
+            server.aof_last_write_errno = ENOSPC;
+        }
+
+        /* Handle the AOF write error. */
+        if (server.aof_fsync == AOF_FSYNC_ALWAYS) {
+            /* We can't recover when the fsync policy is ALWAYS since the
+             * reply for the client is already in the output buffers, and we
+             * have the contract with the user that on acknowledged write data
+             * is synched on disk. */
+            // 写入的数据已经有回复等待发送，无法恢复，只能退出
+            redisLog(REDIS_WARNING,"Can't recover from AOF write error when the AOF fsync policy is 'always'. Exiting...");
+            exit(1);
+        } else {
+            /* Recover from failed write leaving data into the buffer. However
+             * set an error to stop accepting writes as long as the error
+             * condition is not cleared. */
+            // 数据留在缓冲区中，等待下次重试，在此之前拒绝写命令
+            server.aof_last_write_status = REDIS_ERR;
+
+            /* Trim the sds buffer if there was a partial write, and there
+             * was no way to undo it with ftruncate(2). */
+            if (nwritten > 0) {
+                server.aof_current_size += nwritten;
+                server.aof_last_incr_size += nwritten;
+                sdsrange(server.aof_buf,nwritten,-1);
+            }
+            return; /* We'll try again on the next call... */
+        }
+    } else {
+        /* Successful write(2). If AOF was in error state, restore the
+         * OK state and log the event. */
+        if (server.aof_last_write_status == REDIS_ERR) {
+            redisLog(REDIS_WARNING,
+                "AOF write error looks solved, Redis can write again.");
+            server.aof_last_write_status = REDIS_OK;
+        }
+    }
+
+    // 更新写入后的 AOF 文件大小
+    server.aof_current_size += nwritten;
+    server.aof_last_incr_size += nwritten;
+
+    /* Re-use AOF buffer when it is small enough. The maximum comes from the
+     * arena size of 4k minus some overhead (but is otherwise arbitrary).
+     *
+     * 如果 AOF 缓存的大小足够小的话，那么重用这个缓存，
+     * 否则的话，释放 AOF 缓存。
+     */
+    if ((sdslen(server.aof_buf)+sdsavail(server.aof_buf)) < 4000) {
+        // 清空缓存中的内容，等待重用
+        sdsclear(server.aof_buf);
+    } else {
+        // 释放缓存
+        sdsfree(server.aof_buf);
+        server.aof_buf = sdsempty();
+    }
+
+try_fsync:
+    /* Perform the fsync if needed. */
+    // 总是执行 fsnyc
+    if (server.aof_fsync == AOF_FSYNC_ALWAYS) {
+        aofFsync(server.aof_fd); /* Let's try to get this data on the disk */
+
+        // 更新最后一次执行 fsnyc 的时间
+        server.aof_last_fsync = now;
+        server.aof_fsync_offset = server.aof_last_incr_size;
+
+    // 策略为每秒 fsnyc ，并且距离上次 fsync 已经超过 1 秒
+    } else if ((server.aof_fsync == AOF_FSYNC_EVERYSEC &&
+                now > server.aof_last_fsync)) {
+        // 放到后台执行，主线程不会因为磁盘慢而阻塞
+        if (!sync_in_progress) {
+            aofBackgroundFsync(server.aof_fd);
+            server.aof_fsync_offset = server.aof_last_incr_size;
+        }
+        // 更新最后一次执行 fsync 的时间
+        server.aof_last_fsync = now;
+    }
+}
+
+/*
+ * 根据传入的参数，计算并生成协议格式的命令
+ */
+sds catAppendOnlyGenericCommand(sds dst, int argc, robj **argv) {
+    char buf[32];
+    int len, j;
+    robj *o;
+
+    // 重建命令的个数，格式为 *<count>\r\n
+    // 例如 *3\r\n
+    buf[0] = '*';
+    len = 1+ll2string(buf+1,sizeof(buf)-1,argc);
+    buf[len++] = '\r';
+    buf[len++] = '\n';
+    dst = sdscatlen(dst,buf,len);
+
+    // 重建命令和命令参数，格式为 $<length>\r\n<content>\r\n
+    // 例如 $3\r\nSET\r\n$3\r\nKEY\r\n$5\r\nVALUE\r\n
+    for (j = 0; j < argc; j++) {
+        o = getDecodedObject(argv[j]);
+
+        // 组合 $<length>\r\n
+        buf[0] = '$';
+        len = 1+ll2string(buf+1,sizeof(buf)-1,sdslen(o->ptr));
+        buf[len++] = '\r';
+        buf[len++] = '\n';
+        dst = sdscatlen(dst,buf,len);
+
+        // 组合 <content>\r\n
+        dst = sdscatlen(dst,o->ptr,sdslen(o->ptr));
+        dst = sdscatlen(dst,"\r\n",2);
+
+        decrRefCount(o);
+    }
+
+    // 返回重建后的协议内容
+    return dst;
+}
+
+/* Create the sds representation of an PEXPIREAT command, using
+ * 'seconds' as time to live and 'cmd' to understand what command
+ * we are translating into a PEXPIREAT.
+ *
+ * 创建 PEXPIREAT 命令的 sds 表示，
+ * cmd 参数用于指定转换的源指令， seconds 为 TTL （剩余生存时间）。
+ *
+ * This command is used in order to translate EXPIRE and PEXPIRE commands
+ * into PEXPIREAT command so that we retain precision in the append only
+ * file, and the time is always absolute and not relative.
+ *
+ * 这个函数用于将 EXPIRE 、 PEXPIRE 和 EXPIREAT 转换为 PEXPIREAT
+ * 从而在保证精确度不变的情况下，将过期时间从相对值转换为绝对值（一个 UNIX 时间戳）。
+ *
+ * （过期时间必须是绝对值，这样不管 AOF 文件何时被载入，该过期的 key 都会正确地过期。）
+ */
+sds catAppendOnlyExpireAtCommand(sds buf, struct redisCommand *cmd, robj *key, robj *seconds) {
+    long long when;
+    robj *argv[3];
+
+    /* Make sure we can use strtol */
+    // 取出过期值
+    seconds = getDecodedObject(seconds);
+    when = strtoll(seconds->ptr,NULL,10);
+
+    /* Convert argument into milliseconds for EXPIRE, SETEX, EXPIREAT */
+    // 如果过期值的格式为秒，那么将它转换为毫秒
+    if (cmd->proc == expireCommand || cmd->proc == setexCommand ||
+        cmd->proc == expireatCommand)
+    {
+        when *= 1000;
+    }
+
+    /* Convert into absolute time for EXPIRE, PEXPIRE, SETEX, PSETEX */
+    // 如果过期值的格式为相对值，那么将它转换为绝对值
+    if (cmd->proc == expireCommand || cmd->proc == pexpireCommand ||
+        cmd->proc == setexCommand || cmd->proc == psetexCommand)
+    {
+        when += mstime();
+    }
+
+    decrRefCount(seconds);
+
+    // 构建 PEXPIREAT 命令
+    argv[0] = createStringObject("PEXPIREAT",9);
+    argv[1] = key;
+    argv[2] = createStringObjectFromLongLong(when);
+
+    // 追加到 AOF 缓存中
+    buf = catAppendOnlyGenericCommand(buf, 3, argv);
+
+    decrRefCount(argv[0]);
+    decrRefCount(argv[2]);
+
+    return buf;
+}
+
+/*
+ * 将命令追加到 AOF 缓存中
+ *
+ * Relative expires (EXPIRE, SETEX, SET ... EX) are translated into an
+ * absolute PEXPIREAT, so the keys expire at the same time no matter when
+ * the file is loaded.
+ *
+ * 相对的过期时间被转换为绝对的 PEXPIREAT ，不管何时载入，键都在同样的时间过期。
+ */
+void feedAppendOnlyFile(struct redisCommand *cmd, int dictid, robj **argv, int argc) {
+    sds buf = sdsempty();
+    robj *tmpargv[3];
+
+    /* The DB this command was targeting is not the same as the last command
+     * we appendend. To issue a SELECT command is needed.
+     *
+     * 使用 SELECT 命令，显式设置数据库，确保之后的命令被设置到正确的数据库
+     */
+    if (dictid != server.aof_selected_db) {
+        char seldb[64];
+
+        snprintf(seldb,sizeof(seldb),"%d",dictid);
+        buf = sdscatprintf(buf,"*2\r\n$6\r\nSELECT\r\n$%lu\r\n%s\r\n",
+            (unsigned long)strlen(seldb),seldb);
+
+        server.aof_selected_db = dictid;
+    }
+
+    // EXPIRE 、 PEXPIRE 和 EXPIREAT 命令
+    if (cmd->proc == expireCommand || cmd->proc == pexpireCommand ||
+        cmd->proc == expireatCommand) {
+        /* Translate EXPIRE/PEXPIRE/EXPIREAT into PEXPIREAT */
+        // 将 EXPIRE 、 PEXPIRE 和 EXPIREAT 都翻译成 PEXPIREAT
+        buf = catAppendOnlyExpireAtCommand(buf,cmd,argv[1],argv[2]);
+
+    // SETEX 和 PSETEX 命令
+    } else if (cmd->proc == setexCommand || cmd->proc == psetexCommand) {
+        /* Translate SETEX/PSETEX to SET and PEXPIREAT */
+        // 将两个命令都翻译成 SET 和 PEXPIREAT
+
+        // SET
+        tmpargv[0] = createStringObject("SET",3);
+        tmpargv[1] = argv[1];
+        tmpargv[2] = argv[3];
+        buf = catAppendOnlyGenericCommand(buf,3,tmpargv);
+
+        // PEXPIREAT
+        decrRefCount(tmpargv[0]);
+        buf = catAppendOnlyExpireAtCommand(buf,cmd,argv[1],argv[2]);
+
+    // SET 命令带有 EX 或者 PX 选项
+    } else if (cmd->proc == setCommand && argc > 3) {
+        /* Translate SET [EX seconds][PX milliseconds] to SET and PEXPIREAT.
+         * NX and XX are dropped: the command was executed, so the condition
+         * held. */
+        // NX 和 XX 可以被丢弃：命令已经执行了，说明条件是成立的
+        robj *exarg = NULL, *pxarg = NULL;
+        int j;
+
+        buf = catAppendOnlyGenericCommand(buf,3,argv);
+        for (j = 3; j < argc-1; j++) {
+            if (!strcasecmp(argv[j]->ptr,"ex")) exarg = argv[++j];
+            else if (!strcasecmp(argv[j]->ptr,"px")) pxarg = argv[++j];
+        }
+        if (exarg)
+            buf = catAppendOnlyExpireAtCommand(buf,server.expireCommand,
+                                               argv[1],exarg);
+        else if (pxarg)
+            buf = catAppendOnlyExpireAtCommand(buf,server.pexpireCommand,
+                                               argv[1],pxarg);
+
+    // 其他命令
+    } else {
+        /* All the other commands don't need translation or need the
+         * same translation already operated in the command vector
+         * for the replication itself. */
+        buf = catAppendOnlyGenericCommand(buf,argc,argv);
+    }
+
+    /* Append to the AOF buffer. This will be flushed on disk just before
+     * of re-entering the event loop, so before the client will get a
+     * positive reply about the operation performed.
+     *
+     * 将命令追加到 AOF 缓存中，
+     * 在重新进入事件循环之前，这些命令会被冲洗到磁盘上，
+     * 并向客户端返回一个回复。
+     */
+    /* While the AOF is being turned on the commands go to the temp incr
+     * file, but only once the child was forked: before, the dataset the
+     * child will see already includes them.
+     *
+     * AOF 开启的过程中，子进程 fork 之后命令才写入到临时增量文件中，
+     * 在此之前执行的命令都已经包含在子进程看到的数据库中了。 */
+    if (server.aof_state == REDIS_AOF_ON ||
+        (server.aof_state == REDIS_AOF_WAIT_REWRITE &&
+         server.aof_child_pid != -1))
+        server.aof_buf = sdscatlen(server.aof_buf,buf,sdslen(buf));
+
+    // 释放
+    sdsfree(buf);
+}
+
+/* ----------------------------------------------------------------------------
+ * AOF loading
+ * ------------------------------------------------------------------------- */
+
+/* In Redis commands are always executed in the context of a client, so in
+ * order to load the append only file we need to create a fake client.
+ *
+ * Redis 命令必须由客户端执行，
+ * 所以 AOF 装载程序需要创建一个无网络连接的客户端来执行 AOF 文件中的命令。
+ */
+static redisClient *createFakeClient(void) {
+    // 描述符为 -1 的客户端不会被加入客户端链表，也不会收到回复
+    return createClient(-1);
+}
+
+/* ----------------------------------------------------------------------------
+ * AOF replay
+ *
+ * The file is mapped in memory and parsed in place: the parser only returns
+ * pointers into the mapping and lengths, the argument objects are created
+ * straight from the mapped bytes, and the argv array is reused from one
+ * command to the next. Commands are dispatched directly to their proc with
+ * a fake client that generates no reply.
+ *
+ * AOF 文件被映射到内存中并就地分析：分析器只返回指向映射区域的指针和长度，
+ * 参数对象直接从映射的字节创建，参数数组在命令之间重复使用。
+ * 命令直接交给实现函数执行，执行命令的伪客户端不会生成回复。
+ * ------------------------------------------------------------------------- */
+
+#define AOF_PARSE_OK 0          /* A whole command was parsed */
+#define AOF_PARSE_TRUNCATED 1   /* The file ends in the middle of a command */
+#define AOF_PARSE_ERR 2         /* Protocol format error */
+
+/*
+ * 一个命令参数在映射区域中的位置
+ */
+typedef struct aofArg {
+    const char *ptr;
+    size_t len;
+} aofArg;
+
+/*
+ * AOF 分析器的状态
+ */
+typedef struct aofParser {
+    const char *p;          /* Start of the next command */
+    const char *end;        /* End of the mapping */
+    aofArg *args;           /* Arguments of the last parsed command */
+    int argc;
+    int cap;                /* Slots allocated in 'args' */
+} aofParser;
+
+/* Parse <prefix><number>\r\n at '*pp', advancing '*pp' past it.
+ *
+ * 分析 '*pp' 处的 <prefix><number>\r\n ，并将 '*pp' 移动到它之后。 */
+static int aofParseNumber(const char **pp, const char *end, char prefix,
+                          long long *value)
+{
+    const char *p = *pp, *nl;
+
+    if (p == end) return AOF_PARSE_TRUNCATED;
+    if (*p != prefix) return AOF_PARSE_ERR;
+    nl = memchr(p,'\r',end-p);
+    if (nl == NULL || nl+1 >= end) return AOF_PARSE_TRUNCATED;
+    if (nl[1] != '\n' || !string2ll(p+1,nl-(p+1),value))
+        return AOF_PARSE_ERR;
+    *pp = nl+2;
+    return AOF_PARSE_OK;
+}
+
+/* Parse the next command into ap->args without copying anything. On
+ * success ap->p is moved past the command, otherwise it is left at its
+ * start, so it is the offset of the last well-formed command.
+ *
+ * 在不复制任何内容的情况下，将下一个命令分析到 ap->args 中。
+ * 成功时 ap->p 被移动到命令之后，否则保持在命令的开头，
+ * 也即是最后一个完整命令的结束位置。 */
+static int aofParseCommand(aofParser *ap) {
+    const char *p = ap->p;
+    long long argc, len;
+    int j, retval;
+
+    if ((retval = aofParseNumber(&p,ap->end,'*',&argc)) != AOF_PARSE_OK)
+        return retval;
+    if (argc < 1 || argc > INT_MAX) return AOF_PARSE_ERR;
+    /* Every argument takes at least 6 bytes ("$0\r\n\r\n"): don't grow
+     * ap->args for a count the rest of the file can't hold. */
+    // 每个参数至少占用 6 字节，剩下的内容放不下这么多参数时不分配数组
+    if (argc > (ap->end-p)/6) return AOF_PARSE_TRUNCATED;
+
+    if (argc > ap->cap) {
+        ap->cap = argc;
+        ap->args = zrealloc(ap->args,sizeof(aofArg)*ap->cap);
+    }
+
+    for (j = 0; j < argc; j++) {
+        if ((retval = aofParseNumber(&p,ap->end,'$',&len)) != AOF_PARSE_OK)
+            return retval;
+        if (len < 0) return AOF_PARSE_ERR;
+        if (ap->end-p < len+2) return AOF_PARSE_TRUNCATED;
+        if (p[len] != '\r' || p[len+1] != '\n') return AOF_PARSE_ERR;
+        ap->args[j].ptr = p;
+        ap->args[j].len = len;
+        p += len+2;
+    }
+    ap->argc = argc;
+    ap->p = p;
+    return AOF_PARSE_OK;
+}
+
+/*
+ * 检查参数是否为给定的命令名（不区分大小写）
+ */
+static int aofArgIs(aofArg *arg, const char *name, size_t len) {
+    return arg->len == len && !strncasecmp(arg->ptr,name,len);
+}
+
+/* Presize the dicts before replaying a base file. A base file holds each
+ * key exactly once, as a SET followed by a PEXPIREAT when it has an expire,
+ * so counting the commands per DB gives the exact size of the keyspace and
+ * the dicts are never rehashed while loading. This is a scan of the length
+ * prefixes only, no object is created.
+ *
+ * 在载入基础文件之前，预先调整字典的大小。
+ * 基础文件中每个键只出现一次（一个 SET ，带有过期时间时再加上一个 PEXPIREAT ），
+ * 所以统计每个数据库的命令数量，就能得到键空间的准确大小，载入期间字典不会 rehash 。
+ * 这只是对长度前缀的扫描，不会创建任何对象。 */
+static void aofPresizeDbs(const char *map, size_t size) {
+    unsigned long *keys = zcalloc(sizeof(unsigned long)*server.dbnum);
+    unsigned long *expires = zcalloc(sizeof(unsigned long)*server.dbnum);
+    aofParser ap = { map, map+size, NULL, 0, 0 };
+    long long dbid = 0;
+    int j;
+
+    while(ap.p < ap.end && aofParseCommand(&ap) == AOF_PARSE_OK) {
+        if (aofArgIs(&ap.args[0],"select",6) && ap.argc == 2) {
+            if (!string2ll(ap.args[1].ptr,ap.args[1].len,&dbid)) dbid = -1;
+        } else if (dbid >= 0 && dbid < server.dbnum) {
+            if (aofArgIs(&ap.args[0],"set",3)) keys[dbid]++;
+            else if (aofArgIs(&ap.args[0],"pexpireat",9)) expires[dbid]++;
+        }
+    }
+
+    for (j = 0; j < server.dbnum; j++) {
+        redisDb *db = server.db+j;
+
+        if (keys[j] && dictSize(db->dict) == 0) dictExpand(db->dict,keys[j]);
+        if (expires[j] && dictSize(db->expires) == 0)
+            dictExpand(db->expires,expires[j]);
+    }
+    zfree(ap.args);
+    zfree(keys);
+    zfree(expires);
+}
+
+/* Replay a single file of the AOF. On success REDIS_OK is returned, an
+ * empty file is fine. If the file does not exist REDIS_ERR is returned.
+ * On fatal error an error message is logged and the program exists.
+ *
+ * 执行 AOF 中一个文件的命令。
+ *
+ * 成功时返回 REDIS_OK ，空文件也是成功的。文件不存在时返回 REDIS_ERR 。
+ *
+ * 出现致命错误时打印信息到日志，并且程序退出。
+ *
+ * Only the last file may be truncated, since it is the only one that was
+ * being written when the server stopped.
+ *
+ * 只有最后一个文件可以被截断，因为服务器停止时只有它正在被写入。
+ */
+static int loadSingleAppendOnlyFile(char *filename, int last_file,
+                                    int presize)
+{
+    // 伪客户端
+    redisClient *fakeClient;
+    aofParser ap = { NULL, NULL, NULL, 0, 0 };
+    robj **argv = NULL;
+    int argv_cap = 0, retval = AOF_PARSE_OK;
+    long long commands = 0;
+    off_t valid_up_to, valid_before_multi = 0;
+    struct stat sb;
+    char *map;
+    int fd;
+
+    // 打开并映射 AOF 文件
+    if ((fd = open(filename,O_RDONLY)) == -1) return REDIS_ERR;
+    if (fstat(fd,&sb) == -1) {
+        close(fd);
+        return REDIS_ERR;
+    }
+
+    // 空文件
+    if (sb.st_size == 0) {
+        close(fd);
+        return REDIS_OK;
+    }
+
+    map = mmap(NULL,sb.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        redisLog(REDIS_WARNING,"Unrecoverable error mapping the append only "
+            "file %s: %s",filename,strerror(errno));
+        exit(1);
+    }
+    madvise(map,sb.st_size,MADV_SEQUENTIAL);
+
+    // 预先调整字典大小
+    if (presize) aofPresizeDbs(map,sb.st_size);
+
+    // 创建伪客户端
+    fakeClient = createFakeClient();
+
+    ap.p = map;
+    ap.end = map+sb.st_size;
+    while(ap.p < ap.end) {
+        struct redisCommand *cmd;
+        const char *cmd_start = ap.p;
+        int j;
+
+        // 分析下一个命令
+        if ((retval = aofParseCommand(&ap)) != AOF_PARSE_OK) break;
+
+        /* Command lookup */
+        // 查找命令
+        cmd = lookupCommandByPerfectHash(ap.args[0].ptr,ap.args[0].len);
+        if (!cmd) {
+            sds name = sdsnewlen(ap.args[0].ptr,ap.args[0].len);
+
+            cmd = lookupCommand(name);
+            if (!cmd) {
+                redisLog(REDIS_WARNING,"Unknown command '%s' reading the "
+                    "append only file %s", name, filename);
+                exit(1);
+            }
+            sdsfree(name);
+        }
+
+        // 直接从映射区域创建参数对象
+        if (ap.argc > argv_cap) {
+            argv_cap = ap.argc;
+            argv = zrealloc(argv,sizeof(robj*)*argv_cap);
+        }
+        for (j = 0; j < ap.argc; j++)
+            argv[j] = createStringObject((char*)ap.args[j].ptr,
+                                         ap.args[j].len);
+        fakeClient->argv = argv;
+        fakeClient->argc = ap.argc;
+
+        /* Run the command in the context of a fake client. Inside a
+         * MULTI the commands are queued like processCommand() does, so
+         * that a transaction cut by the end of the file is not applied
+         * at all. */
+        // 调用伪客户端，执行命令
+        // 事务中的命令和 processCommand() 一样被放入队列，
+        // 这样被文件末尾截断的事务不会被执行
+        fakeClient->cmd = cmd;
+        if (cmd->proc == multiCommand && !(fakeClient->flags & REDIS_MULTI))
+            valid_before_multi = cmd_start-map;
+        if (fakeClient->flags & REDIS_MULTI && cmd->proc != execCommand)
+            queueMultiCommand(fakeClient);
+        else
+            cmd->proc(fakeClient);
+        commands++;
+
+        /* The fake client should not have a reply */
+        redisAssert(fakeClient->bufpos == 0 && listLength(fakeClient->reply) == 0);
+
+        /* Clean up. Command code may have changed argv/argc so we use the
+         * argv/argc of the client instead of the local variables. The
+         * argv array is kept for the next command. */
+        // 清理命令参数对象，参数数组留给下一个命令使用
+        for (j = 0; j < fakeClient->argc; j++)
+            decrRefCount(fakeClient->argv[j]);
+        if (fakeClient->argv != argv) {
+            // 命令替换了参数数组，旧数组已经被释放
+            argv = fakeClient->argv;
+            argv_cap = fakeClient->argc;
+        }
+    }
+
+    // 最后一个完整命令的结束位置
+    valid_up_to = ap.p-map;
+
+    /* A MULTI without the matching EXEC at the end of the file is handled
+     * like a truncated command: the valid part ends before the MULTI. */
+    // 没有 EXEC 的事务被当作不完整的命令处理，有效部分在 MULTI 之前结束
+    if (fakeClient->flags & REDIS_MULTI && retval != AOF_PARSE_ERR) {
+        valid_up_to = valid_before_multi;
+        retval = AOF_PARSE_TRUNCATED;
+    }
+
+    munmap(map,sb.st_size);
+    fakeClient->argv = NULL;
+    fakeClient->argc = 0;
+    freeClient(fakeClient);
+    zfree(argv);
+    zfree(ap.args);
+    server.stat_aof_load_commands += commands;
+    server.stat_aof_load_bytes += sb.st_size;
+
+    if (retval == AOF_PARSE_OK) return REDIS_OK;
+    if (retval == AOF_PARSE_ERR) goto fmterr;
+
+    /* Unexpected AOF end of file: the tail of the file holds a command that
+     * was only partially written, for instance because the server crashed
+     * in the middle of a write(). */
+    // 文件的末尾是一个不完整的命令，比如服务器在 write() 的过程中崩溃
+    if (server.aof_load_truncated && last_file) {
+        redisLog(REDIS_WARNING,"!!! Warning: short read while loading the AOF file %s!!!", filename);
+        redisLog(REDIS_WARNING,"!!! Truncating the AOF at offset %llu !!!",
+            (unsigned long long) valid_up_to);
+        if (truncate(filename,valid_up_to) == -1) {
+            redisLog(REDIS_WARNING,"Error truncating the AOF file: %s",
+                strerror(errno));
+        } else {
+            redisLog(REDIS_WARNING,
+                "AOF loaded anyway because aof-load-truncated is enabled");
+            return REDIS_OK;
+        }
+    }
+    redisLog(REDIS_WARNING,"Unexpected end of file reading the append only file %s. You can: 1) Make a backup of your AOF file, then remove the incomplete command at its end. 2) Alternatively you can set the 'aof-load-truncated' configuration option to yes and restart the server.", filename);
+    exit(1);
+
+fmterr: /* Format error. */
+    redisLog(REDIS_WARNING,"Bad file format reading the append only file %s at offset %llu: make a backup of your AOF file, then fix the command at the reported offset.", filename, (unsigned long long) valid_up_to);
+    exit(1);
+}
+
+/* Replay all the files listed by the manifest: the base file first, then
+ * the incremental files in order. On success REDIS_OK is returned. If the
+ * manifest lists no file REDIS_ERR is returned with errno set to ENOENT.
+ * On fatal error, including a listed file that is missing, an error
+ * message is logged and the program exists.
+ *
+ * 按顺序执行清单中的所有文件：首先是基础文件，然后是各个增量文件。
+ *
+ * 成功时返回 REDIS_OK 。清单中没有任何文件时返回 REDIS_ERR ，并将 errno 设为 ENOENT 。
+ *
+ * 出现致命错误（包括清单中的某个文件不存在）时打印信息到日志，并且程序退出。
+ */
+int loadAppendOnlyFiles(aofManifest *am) {
+    int old_aof_state = server.aof_state;
+    int total_num = listLength(am->incr_aof_list) +
+                    (am->base_aof_info != NULL);
+    int num = 0;
+    long long start = ustime();
+    char *filename;
+    listIter li;
+    listNode *ln;
+
+    if (total_num == 0) {
+        errno = ENOENT;
+        return REDIS_ERR;
+    }
+
+    /* Temporarily disable AOF, to prevent the commands we are replaying
+     * from being fed to the same file we're about to read. */
+    // 暂时性地关闭 AOF ，防止在执行命令时，被执行的命令又写入到 AOF 文件中
+    server.aof_state = REDIS_AOF_OFF;
+
+    // 设置服务器的状态为：正在载入
+    server.loading = 1;
+
+    server.aof_current_size = 0;
+    server.aof_rewrite_base_size = 0;
+    server.aof_last_incr_size = 0;
+    server.stat_aof_load_commands = 0;
+    server.stat_aof_load_bytes = 0;
+
+    /* Load the base file. Only a base produced by a rewrite is known to
+     * hold each key once, a legacy file adopted as base (seq 0) may be an
+     * arbitrary log, so it is not used to presize the dicts. */
+    // 载入基础文件，只有重写产生的基础文件才用来预先调整字典大小
+    if (am->base_aof_info) {
+        aofInfo *base = am->base_aof_info;
+
+        filename = base->file_name;
+        if (loadSingleAppendOnlyFile(filename,++num == total_num,
+                                     base->file_seq > 0) != REDIS_OK)
+            goto missing;
+        server.aof_rewrite_base_size = getAppendOnlyFileSize(filename);
+        server.aof_current_size = server.aof_rewrite_base_size;
+    }
+
+    // 按顺序载入增量文件
+    listRewind(am->incr_aof_list,&li);
+    while((ln = listNext(&li)) != NULL) {
+        filename = ((aofInfo*)listNodeValue(ln))->file_name;
+        if (loadSingleAppendOnlyFile(filename,++num == total_num,0) != REDIS_OK)
+            goto missing;
+        server.aof_last_incr_size = getAppendOnlyFileSize(filename);
+        server.aof_current_size += server.aof_last_incr_size;
+    }
+
+    // 复原 AOF 状态
+    server.aof_state = old_aof_state;
+
+    // 停止载入
+    server.loading = 0;
+
+    // 最后一个增量文件在载入之前已经 fsync 过了
+    server.aof_fsync_offset = server.aof_last_incr_size;
+
+    // 记录载入耗时
+    server.stat_aof_load_usec = ustime()-start;
+    return REDIS_OK;
+
+missing:
+    redisLog(REDIS_WARNING,"The AOF file %s listed by the manifest can't "
+        "be opened: %s",filename,strerror(errno));
+    exit(1);
+}
+
+/* ----------------------------------------------------------------------------
+ * AOF rewrite
+ * ------------------------------------------------------------------------- */
+
+/* Write a sequence of commands able to fully rebuild the dataset into
+ * "filename".
+ *
+ * 将一个足以还原当前数据集的命令序列写入到 filename 指定的文件中。
+ *
+ * Every string key is written as a SET, followed by a PEXPIREAT when it
+ * has an expire. The file is written to a temp file, synced, and renamed
+ * over the target, like rdbSave() does.
+ *
+ * 每个字符串键被写成一个 SET 命令，带有过期时间的键再加上一个 PEXPIREAT 命令。
+ * 和 rdbSave() 一样，先写入临时文件，fsync 之后再改名为目标文件。
+ */
+int rewriteAppendOnlyFile(char *filename) {
+    dictIterator *di = NULL;
+    dictEntry *de;
+    rio aof;
+    FILE *fp;
+    char tmpfile[256];
+    char *iobuf;
+    int j;
+    long long now = mstime();
+
+    // 创建临时文件
+    snprintf(tmpfile,256,"temp-rewriteaof-%d.aof", (int) getpid());
+    fp = fopen(tmpfile,"w");
+    if (!fp) {
+        redisLog(REDIS_WARNING, "Opening the temp file for AOF rewrite in rewriteAppendOnlyFile(): %s", strerror(errno));
+        return REDIS_ERR;
+    }
+
+    // 使用更大的 stdio 缓冲区，减少 write() 调用的次数
+    iobuf = zmalloc(REDIS_RDB_IOBUF_LEN);
+    setvbuf(fp,iobuf,_IOFBF,REDIS_RDB_IOBUF_LEN);
+
+    // 初始化文件 io
+    rioInitWithFile(&aof,fp);
+    // 每写入一定数量的字节就执行一次 fsync ，分散磁盘压力
+    rioSetAutoSync(&aof,REDIS_AUTOSYNC_BYTES);
+
+    // 遍历所有数据库
+    for (j = 0; j < server.dbnum; j++) {
+
+        char selectcmd[] = "*2\r\n$6\r\nSELECT\r\n";
+
+        redisDb *db = server.db+j;
+
+        // 指向键空间
+        dict *d = db->dict;
+        if (dictSize(d) == 0) continue;
+
+        // 创建键空间迭代器
+        di = dictGetSafeIterator(d);
+        if (!di) {
+            fclose(fp);
+            zfree(iobuf);
+            return REDIS_ERR;
+        }
+
+        /* SELECT the new DB */
+        // 首先写入 SELECT 命令，确保之后的数据会被插入到正确的数据库上
+        if (rioWrite(&aof,selectcmd,sizeof(selectcmd)-1) == 0) goto werr;
+        if (rioWriteBulkLongLong(&aof,j) == 0) goto werr;
+
+        /* Iterate this DB writing every entry */
+        // 遍历数据库所有键，并通过命令将它们的当前状态（值）记录到新 AOF 文件中
+        while((de = dictNext(di)) != NULL) {
+            sds keystr;
+            robj key, *o;
+            long long expiretime;
+
+            // 取出键
+            keystr = dictGetKey(de);
+
+            // 取出值
+            o = dictGetVal(de);
+            initStaticStringObject(key,keystr);
+
+            // 取出过期时间
+            expiretime = getExpire(db,&key);
+
+            /* If this key is already expired skip it */
+            // 如果键已经过期，那么跳过它，不保存
+            if (expiretime != -1 && expiretime < now) continue;
+
+            /* Save the key and associated value */
+            // 根据值的类型，选择适当的命令来保存值
+            if (o->type == REDIS_STRING) {
+                /* Emit a SET command */
+                char cmd[]="*3\r\n$3\r\nSET\r\n";
+
+                if (rioWrite(&aof,cmd,sizeof(cmd)-1) == 0) goto werr;
+                /* Key and value */
+                if (rioWriteBulkString(&aof,keystr,sdslen(keystr)) == 0)
+                    goto werr;
+                if (o->encoding == REDIS_ENCODING_INT) {
+                    if (rioWriteBulkLongLong(&aof,(long)o->ptr) == 0)
+                        goto werr;
+                } else {
+                    if (rioWriteBulkString(&aof,o->ptr,sdslen(o->ptr)) == 0)
+                        goto werr;
+                }
+            } else {
+                redisPanic("Unknown object type");
+            }
+
+            /* Save the expire time */
+            // 保存键的过期时间
+            if (expiretime != -1) {
+                char cmd[]="*3\r\n$9\r\nPEXPIREAT\r\n";
+
+                // 写入 PEXPIREAT expiretime 命令
+                if (rioWrite(&aof,cmd,sizeof(cmd)-1) == 0) goto werr;
+                if (rioWriteBulkString(&aof,keystr,sdslen(keystr)) == 0)
+                    goto werr;
+                if (rioWriteBulkLongLong(&aof,expiretime) == 0) goto werr;
+            }
+        }
+
+        // 释放迭代器
+        dictReleaseIterator(di);
+        di = NULL;
+    }
+
+    /* Make sure data will not remain on the OS's output buffers */
+    // 冲洗并关闭新 AOF 文件
+    if (fflush(fp) == EOF) goto werr;
+    if (fsync(fileno(fp)) == -1) goto werr;
+    if (fclose(fp) == EOF) { fp = NULL; goto werr; }
+    fp = NULL;
+    zfree(iobuf);
+    iobuf = NULL;
+
+    /* Use RENAME to make sure the DB file is changed atomically only
+     * if the generate DB file is ok. */
+    // 原子地改名，用重写后的新 AOF 文件覆盖旧 AOF 文件
+    if (rename(tmpfile,filename) == -1) {
+        redisLog(REDIS_WARNING,"Error moving temp append only file on the final destination: %s", strerror(errno));
+        unlink(tmpfile);
+        return REDIS_ERR;
+    }
+    rdbFsyncFileDir(filename);
+
+    redisLog(REDIS_NOTICE,"SYNC append only file rewrite performed");
+
+    return REDIS_OK;
+
+werr:
+    redisLog(REDIS_WARNING,"Write error writing append only file on disk: %s", strerror(errno));
+    if (fp) fclose(fp);
+    unlink(tmpfile);
+    if (iobuf) zfree(iobuf);
+    if (di) dictReleaseIterator(di);
+    return REDIS_ERR;
+}
+
+/* This is how rewriting of the append only file in background works:
+ *
+ * 以下是后台重写 AOF 文件（BGREWRITEAOF）的工作步骤：
+ *
+ * 1) The user calls BGREWRITEAOF, or the AOF grew enough to be rewritten.
+ *    用户调用 BGREWRITEAOF ，或者 AOF 增长到需要重写的大小。
+ *
+ * 2) The parent opens a new incremental file, records it in the manifest
+ *    and appends to it from now on, then calls fork():
+ *    父进程打开一个新的增量文件，将它记录到清单中，之后的命令都追加到这个文件，
+ *    然后调用 fork() ：
+ *
+ *    2a) the child rewrites the dataset as it was at fork() time in a
+ *        temp file.
+ *        子进程将 fork() 时的数据库重写到一个临时文件中。
+ *
+ *    2b) the parent keeps serving clients. Nothing is buffered for the
+ *        child: the commands it will not see are already in the new
+ *        incremental file.
+ *        父进程继续处理客户端。不需要为子进程缓存任何东西：
+ *        子进程看不到的命令已经在新的增量文件中了。
+ *
+ * 3) When the child is done, the parent renames the temp file as the new
+ *    base file and replaces the manifest with one listing the new base
+ *    plus the incremental file opened in 2. The old files are deleted in
+ *    background. This is a constant amount of work, whatever the number
+ *    of writes served during the rewrite.
+ *    子进程完成之后，父进程将临时文件改名为新的基础文件，
+ *    并将清单替换为新的基础文件加上步骤 2 打开的增量文件。
+ *    旧文件在后台删除。不管重写期间处理了多少写命令，这一步的工作量都是固定的。
+ */
+int rewriteAppendOnlyFileBackground(void) {
+    pid_t childpid;
+    long long start;
+
+    // 已经有子进程在运行
+    if (hasActiveChildProcess()) return REDIS_ERR;
+
+    // 最近一次尝试执行 BGREWRITEAOF 的时间
+    server.aof_lastbgrewrite_try = time(NULL);
+
+    // 之后的命令写入到新的增量文件中
+    if (openNewIncrAofForAppend() == REDIS_ERR) {
+        server.aof_lastbgrewrite_status = REDIS_ERR;
+        return REDIS_ERR;
+    }
+
+    // 子进程用来报告写时复制内存数量的管道
+    openChildInfoPipe();
+
+    // 记录 fork 开始前的时间，计算 fork 耗时用
+    start = ustime();
+
+    if ((childpid = fork()) == 0) {
+        char tmpfile[256];
+
+        /* Child */
+
+        // 关闭网络连接 fd
+        closeListeningSockets();
+
+        // 创建临时文件，并进行 AOF 重写
+        snprintf(tmpfile,256,"temp-rewriteaof-bg-%d.aof", (int) getpid());
+        if (rewriteAppendOnlyFile(tmpfile) == REDIS_OK) {
+            size_t private_dirty = zmalloc_get_private_dirty();
+
+            if (private_dirty) {
+                redisLog(REDIS_NOTICE,
+                    "AOF rewrite: %zu MB of memory used by copy-on-write",
+                    private_dirty/(1024*1024));
+            }
+            server.child_info_data.cow_size = private_dirty;
+            sendChildInfo(CHILD_INFO_TYPE_AOF);
+
+            // 发送重写成功信号
+            exitFromChild(0);
+        } else {
+            // 发送重写失败信号
+            exitFromChild(1);
+        }
+    } else {
+        /* Parent */
+
+        // 记录执行 fork 所消耗的时间
+        server.stat_fork_time = ustime()-start;
+
+        if (childpid == -1) {
+            closeChildInfoPipe();
+            server.aof_lastbgrewrite_status = REDIS_ERR;
+            redisLog(REDIS_WARNING,
+                "Can't rewrite append only file in background: fork: %s",
+                strerror(errno));
+            return REDIS_ERR;
+        }
+
+        redisLog(REDIS_NOTICE,
+            "Background append only file rewriting started by pid %d",childpid);
+
+        // 记录 AOF 重写的信息
+        server.aof_rewrite_scheduled = 0;
+        server.aof_rewrite_time_start = time(NULL);
+        server.aof_child_pid = childpid;
+
+        // 关闭自动 rehash
+        updateDictResizePolicy();
+
+        return REDIS_OK;
+    }
+
+    return REDIS_OK; /* unreached */
+}
+
+/*
+ * BGREWRITEAOF
+ */
+void bgrewriteaofCommand(redisClient *c) {
+
+    // 不能重复运行 BGREWRITEAOF
+    if (server.aof_child_pid != -1) {
+        addReplyError(c,"Background append only file rewriting already in progress");
+
+    // 如果正在执行 BGSAVE ，那么预定 BGREWRITEAOF
+    // 等 BGSAVE 完成之后， BGREWRITEAOF 就会开始执行
+    } else if (hasActiveChildProcess()) {
+        server.aof_rewrite_scheduled = 1;
+        addReplyStatus(c,"Background append only file rewriting scheduled");
+
+    // 执行 BGREWRITEAOF
+    } else if (rewriteAppendOnlyFileBackground() == REDIS_OK) {
+        addReplyStatus(c,"Background append only file rewriting started");
+
+    } else {
+        addReply(c,shared.err);
+    }
+}
+
+/* A background append only file rewriting (BGREWRITEAOF) terminated its work.
+ * Handle this.
+ *
+ * 处理 BGREWRITEAOF 子进程的退出。
+ *
+ * Every change is applied to a copy of the manifest first: if anything
+ * fails the files in use are untouched and the rewrite is simply lost.
+ *
+ * 所有修改都先作用在清单的副本上：如果有任何步骤失败，
+ * 正在使用的文件不受影响，只是这次重写的结果被丢弃。
+ */
+void backgroundRewriteDoneHandler(int exitcode, int bysignal) {
+    char tmpfile[256];
+
+    snprintf(tmpfile,256,"temp-rewriteaof-bg-%d.aof",
+        (int)server.aof_child_pid);
+
+    if (!bysignal && exitcode == 0) {
+        aofManifest *temp_am = aofManifestDup(server.aof_manifest);
+        sds new_base_name, new_incr_name = NULL, temp_incr_name = NULL;
+
+        redisLog(REDIS_NOTICE,
+            "Background AOF rewrite terminated with success");
+
+        // 将子进程写入的临时文件改名为新的基础文件
+        new_base_name = getNewBaseFileNameAndMarkPreAsHistory(temp_am);
+        if (rename(tmpfile,new_base_name) == -1) {
+            redisLog(REDIS_WARNING,"Error trying to rename the temporary AOF "
+                "file %s into %s: %s",tmpfile,new_base_name,strerror(errno));
+            goto cleanup;
+        }
+
+        // fork() 之前的增量文件已经被新的基础文件覆盖
+        markRewrittenIncrAofAsHistory(temp_am);
+
+        // 正在开启 AOF ：临时增量文件成为第一个增量文件
+        if (server.aof_state == REDIS_AOF_WAIT_REWRITE) {
+            temp_incr_name = getTempIncrAofName();
+            new_incr_name = getNewIncrAofName(temp_am);
+            if (rename(temp_incr_name,new_incr_name) == -1) {
+                redisLog(REDIS_WARNING,"Error trying to rename the temporary "
+                    "AOF incr file %s into %s: %s",temp_incr_name,
+                    new_incr_name,strerror(errno));
+                unlink(new_base_name);
+                goto cleanup;
+            }
+        }
+
+        // 原子地替换清单，从这里开始，新的基础文件生效
+        if (persistAofManifest(temp_am) == REDIS_ERR) {
+            unlink(new_base_name);
+            if (new_incr_name) rename(new_incr_name,temp_incr_name);
+            goto cleanup;
+        }
+        aofManifestFree(server.aof_manifest);
+        server.aof_manifest = temp_am;
+        temp_am = NULL;
+
+        // 更新 AOF 文件的大小
+        server.aof_rewrite_base_size = getAppendOnlyFileSize(new_base_name);
+        server.aof_current_size =
+            server.aof_rewrite_base_size + server.aof_last_incr_size;
+
+        if (server.aof_state == REDIS_AOF_WAIT_REWRITE) {
+            server.aof_state = REDIS_AOF_ON;
+            redisLog(REDIS_NOTICE,"AOF rewrite successful, the append only "
+                "file is now enabled");
+        }
+
+        // 在后台删除被替换的旧文件
+        aofDelHistoryFiles();
+
+        server.aof_lastbgrewrite_status = REDIS_OK;
+        redisLog(REDIS_NOTICE,
+            "Background AOF rewrite finished successfully");
+
+cleanup:
+        if (temp_am) {
+            aofManifestFree(temp_am);
+            server.aof_lastbgrewrite_status = REDIS_ERR;
+        }
+        sdsfree(new_base_name);
+        if (new_incr_name) sdsfree(new_incr_name);
+        if (temp_incr_name) sdsfree(temp_incr_name);
+
+    // BGREWRITEAOF 重写出错
+    } else if (!bysignal && exitcode != 0) {
+        server.aof_lastbgrewrite_status = REDIS_ERR;
+        redisLog(REDIS_WARNING,
+            "Background AOF rewrite terminated with error");
+
+    // 未知错误
+    } else {
+        /* SIGUSR1 is whitelisted, so we have a way to kill a child without
+         * tirggering an error conditon. */
+        if (bysignal != SIGUSR1)
+            server.aof_lastbgrewrite_status = REDIS_ERR;
+        redisLog(REDIS_WARNING,
+            "Background AOF rewrite terminated by signal %d", bysignal);
+    }
+
+    // 移除临时文件（重写成功时它已经被改名了）
+    unlink(tmpfile);
+
+    // 重置默认属性
+    server.aof_child_pid = -1;
+    server.aof_rewrite_time_last = time(NULL)-server.aof_rewrite_time_start;
+    server.aof_rewrite_time_start = -1;
+
+    /* Schedule a new rewrite if we are waiting for it to switch the AOF ON. */
+    // 正在开启 AOF 但是重写失败了，预定一次新的重写
+    if (server.aof_state == REDIS_AOF_WAIT_REWRITE)
+        server.aof_rewrite_scheduled = 1;
+}
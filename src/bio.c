@@ -0,0 +1,226 @@
+/* Background I/O service for Redis.
+ *
+ * 后台任务服务
+ *
+ * This file implements operations that we need to perform in the background.
+ * Currently there are three operations: a background free of objects
+ * (lazyfree), the fsync() of the append only file when appendfsync is
+ * set to everysec, and the close(2) of files, that may block for a long
+ * time when it is the last reference of an unlinked big file.
+ *
+ * 这个文件实现了需要在后台执行的操作，目前有三种：
+ * 在后台释放对象（lazyfree），appendfsync everysec 时对 AOF 文件执行 fsync ，
+ * 以及关闭文件（关闭一个已被删除的大文件的最后引用时， close(2) 可能阻塞很久）。
+ *
+ * DESIGN
+ * ------
+ *
+ * The design is trivial, we have a structure representing a job to perform
+ * and a different thread and job queue for every job type.
+ * Every thread waits for new jobs in its queue, and process every job
+ * sequentially.
+ *
+ * 每种任务类型有自己的线程和任务队列，线程按顺序处理队列中的任务。
+ *
+ * Jobs are only ever created by the main thread, and every queue has a
+ * single consumer, its own thread. So the queue is a single producer /
+ * single consumer linked list that needs no lock at all: the producer
+ * only touches the tail, the consumer only touches the head, and the
+ * two meet on the 'next' pointer of the last job, which is published
+ * with a release store. A POSIX semaphore counts the queued jobs, so the
+ * thread sleeps while there is nothing to do and the main thread never
+ * blocks when it queues a job.
+ *
+ * 任务只由主线程创建，每个队列也只有一个消费者（自己的线程），
+ * 所以队列是无锁的单生产者/单消费者链表：
+ * 生产者只修改表尾，消费者只修改表头，两者只通过最后一个任务的 next 指针交接。
+ * 信号量记录队列中的任务数量，线程在没有任务时睡眠，
+ * 而主线程添加任务时永远不会阻塞。
+ *
+ * The head of the queue is always a dummy node: the job that was processed
+ * last. When the consumer moves to the next job the old dummy is freed.
+ *
+ * 队列的头部总是一个哑节点（上一个处理完的任务），
+ * 消费者前进到下一个任务时，释放旧的哑节点。
+ *
+ * Currently there is no way for the creator of the job to be notified about
+ * the completion of the operation, this will only be added when/if needed.
+ */
+#include "redis.h"
+#include "bio.h"
+
+#include <pthread.h>
+#include <semaphore.h>
+
+/* This structure represents a background Job. It is only used locally to this
+ * file as the API does not expose the internals at all. */
+struct bio_job {
+    // 队列中的下一个任务，由生产者以 release 语义发布
+    struct bio_job *next;
+    // 任务创建的时间
+    time_t time; /* Time at which the job was created. */
+    /* Job specific arguments pointers. If we need to pass more than three
+     * arguments we can just pass a pointer to a structure or alike. */
+    void *arg1, *arg2, *arg3;
+};
+
+/*
+ * 无锁任务队列
+ */
+static struct bio_queue {
+    // 消费者端：哑节点，它的 next 是下一个要处理的任务
+    struct bio_job *head;
+    // 生产者端：最后一个入队的任务
+    struct bio_job *tail;
+    // 队列中任务的数量
+    sem_t jobs;
+} bio_queues[BIO_NUM_OPS];
+
+static pthread_t bio_threads[BIO_NUM_OPS];
+// 每种类型的未完成任务数量（包括正在处理的任务）
+static unsigned long long bio_pending[BIO_NUM_OPS];
+
+void *bioProcessBackgroundJobs(void *arg);
+void lazyfreeFreeObjectFromBioThread(robj *o);
+void lazyfreeFreeDatabaseFromBioThread(dict *ht1, dict *ht2);
+void aofFsync(int fd);
+
+/* Make sure we have enough stack to perform all the things we do in the
+ * main thread. */
+#define REDIS_THREAD_STACK_SIZE (1024*1024*4)
+
+/* Initialize the background system, spawning the thread.
+ *
+ * 初始化后台任务系统，生成线程
+ */
+void bioInit(void) {
+    pthread_attr_t attr;
+    pthread_t thread;
+    size_t stacksize;
+    int j;
+
+    /* Initialization of state vars and objects */
+    for (j = 0; j < BIO_NUM_OPS; j++) {
+        struct bio_job *dummy = zmalloc(sizeof(*dummy));
+
+        dummy->next = NULL;
+        bio_queues[j].head = bio_queues[j].tail = dummy;
+        sem_init(&bio_queues[j].jobs,0,0);
+        bio_pending[j] = 0;
+    }
+
+    /* Set the stack size as by default it may be small in some system */
+    // 设置栈大小
+    pthread_attr_init(&attr);
+    pthread_attr_getstacksize(&attr,&stacksize);
+    if (!stacksize) stacksize = 1; /* The world is full of Solaris Fixes */
+    while (stacksize < REDIS_THREAD_STACK_SIZE) stacksize *= 2;
+    pthread_attr_setstacksize(&attr, stacksize);
+
+    /* Ready to spawn our threads. We use the single argument the thread
+     * function accepts in order to pass the job ID the thread is
+     * responsible of. */
+    // 创建线程
+    for (j = 0; j < BIO_NUM_OPS; j++) {
+        void *arg = (void*)(unsigned long) j;
+        if (pthread_create(&thread,&attr,bioProcessBackgroundJobs,arg) != 0) {
+            redisLog(REDIS_WARNING,"Fatal: Can't initialize Background Jobs.");
+            exit(1);
+        }
+        bio_threads[j] = thread;
+    }
+}
+
+/*
+ * 创建后台任务
+ *
+ * Must be called from the main thread: the queue has a single producer.
+ *
+ * 只能在主线程中调用：队列只有一个生产者。
+ */
+void bioCreateBackgroundJob(int type, void *arg1, void *arg2, void *arg3) {
+    struct bio_job *job = zmalloc(sizeof(*job));
+    struct bio_queue *q = &bio_queues[type];
+    struct bio_job *prev;
+
+    job->next = NULL;
+    job->time = time(NULL);
+    job->arg1 = arg1;
+    job->arg2 = arg2;
+    job->arg3 = arg3;
+
+    // 先增加计数，保证任务被处理之前 bioPendingJobsOfType() 不会返回 0
+    __atomic_add_fetch(&bio_pending[type],1,__ATOMIC_RELAXED);
+
+    // 将任务链接到表尾，release 保证消费者看到 next 时任务的内容已经写好
+    prev = q->tail;
+    q->tail = job;
+    __atomic_store_n(&prev->next,job,__ATOMIC_RELEASE);
+
+    // 唤醒线程
+    sem_post(&q->jobs);
+}
+
+/*
+ * 处理后台任务
+ */
+void *bioProcessBackgroundJobs(void *arg) {
+    struct bio_job *job, *dummy;
+    unsigned long type = (unsigned long) arg;
+    struct bio_queue *q;
+
+    /* Check that the type is within the right interval. */
+    if (type >= BIO_NUM_OPS) {
+        redisLog(REDIS_WARNING,
+            "Warning: bio thread started with wrong type %lu",type);
+        return NULL;
+    }
+    q = &bio_queues[type];
+
+    while(1) {
+        /* Wait for a job: the semaphore counts the queued jobs. */
+        // 等待任务
+        if (sem_wait(&q->jobs) == -1) continue; /* EINTR */
+
+        // 取出下一个任务，它成为新的哑节点
+        dummy = q->head;
+        job = __atomic_load_n(&dummy->next,__ATOMIC_ACQUIRE);
+        q->head = job;
+
+        /* The old dummy is not referenced by the producer anymore: it was
+         * the tail only until 'job' was linked after it. */
+        zfree(dummy);
+
+        /* Process the job accordingly to its type. */
+        // 执行任务
+        if (type == BIO_LAZY_FREE) {
+            /* What we free changes depending on what arguments are set:
+             * arg1 -> free the object at pointer.
+             * arg2 & arg3 -> free two dictionaries (a Redis DB). */
+            if (job->arg1)
+                lazyfreeFreeObjectFromBioThread(job->arg1);
+            else if (job->arg2 && job->arg3)
+                lazyfreeFreeDatabaseFromBioThread(job->arg2,job->arg3);
+        } else if (type == BIO_AOF_FSYNC) {
+            // arg1 是 AOF 文件的描述符
+            aofFsync((long)job->arg1);
+        } else if (type == BIO_CLOSE_FILE) {
+            // arg1 是要关闭的描述符，arg2 非空时先执行 fsync
+            if (job->arg2) aofFsync((long)job->arg1);
+            close((long)job->arg1);
+        } else {
+            redisPanic("Wrong job type in bioProcessBackgroundJobs().");
+        }
+        job->arg1 = job->arg2 = job->arg3 = NULL;
+
+        __atomic_sub_fetch(&bio_pending[type],1,__ATOMIC_RELAXED);
+    }
+}
+
+/* Return the number of pending jobs of the specified type.
+ *
+ * 返回等待中的 type 类型的任务的数量
+ */
+unsigned long long bioPendingJobsOfType(int type) {
+    return __atomic_load_n(&bio_pending[type],__ATOMIC_RELAXED);
+}
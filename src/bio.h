@@ -0,0 +1,16 @@
+#ifndef __BIO_H
+#define __BIO_H
+
+/* Exported API */
+void bioInit(void);
+void bioCreateBackgroundJob(int type, void *arg1, void *arg2, void *arg3);
+unsigned long long bioPendingJobsOfType(int type);
+
+/* Background job opcodes */
+// 后台任务的类型
+#define BIO_LAZY_FREE     0 /* Deferred objects freeing. */
+#define BIO_AOF_FSYNC     1 /* Deferred AOF fsync. */
+#define BIO_CLOSE_FILE    2 /* Deferred close(2) syscall. */
+#define BIO_NUM_OPS       3
+
+#endif /* __BIO_H */
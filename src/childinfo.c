@@ -0,0 +1,65 @@
+#include "redis.h"
+#include <fcntl.h>
+
+/* Child info: a pipe the saving child uses to report back to the parent
+ * the amount of copy-on-write memory it caused, which is only known by
+ * the child itself (it is its private dirty memory).
+ *
+ * 子进程通过这个管道把写时复制的内存数量报告给父进程，
+ * 这个数量只有子进程自己能够测量（它的私有脏页）。 */
+
+/* Open a child-parent channel used in order to move information about the
+ * RDB process to the parent. The reading side is non blocking, so that
+ * the parent never waits on a child that died before writing. */
+void openChildInfoPipe(void) {
+    if (pipe(server.child_info_pipe) == -1) {
+        /* On error our two file descriptors should be still set to -1,
+         * but we call closeChildInfoPipe() anyway since it can't hurt. */
+        closeChildInfoPipe();
+    } else if (fcntl(server.child_info_pipe[0],F_SETFL,O_NONBLOCK) == -1) {
+        closeChildInfoPipe();
+    } else {
+        memset(&server.child_info_data,0,sizeof(server.child_info_data));
+    }
+}
+
+/* Close the pipes opened with openChildInfoPipe(). */
+void closeChildInfoPipe(void) {
+    if (server.child_info_pipe[0] != -1 ||
+        server.child_info_pipe[1] != -1)
+    {
+        close(server.child_info_pipe[0]);
+        close(server.child_info_pipe[1]);
+        server.child_info_pipe[0] = -1;
+        server.child_info_pipe[1] = -1;
+    }
+}
+
+/* Send COW data to parent. The child should call this function after
+ * populating the corresponding fields it wants to send (according to the
+ * process type). */
+void sendChildInfo(int ptype) {
+    if (server.child_info_pipe[1] == -1) return;
+    server.child_info_data.magic = CHILD_INFO_MAGIC;
+    server.child_info_data.process_type = ptype;
+    ssize_t wlen = sizeof(server.child_info_data);
+    if (write(server.child_info_pipe[1],&server.child_info_data,wlen) !=
+        wlen)
+    {
+        /* Nothing to do on error, this will be detected by the other side. */
+    }
+}
+
+/* Receive COW data from the child. */
+void receiveChildInfo(void) {
+    if (server.child_info_pipe[0] == -1) return;
+    ssize_t wlen = sizeof(server.child_info_data);
+    if (read(server.child_info_pipe[0],&server.child_info_data,wlen) ==
+        wlen && server.child_info_data.magic == CHILD_INFO_MAGIC)
+    {
+        if (server.child_info_data.process_type == CHILD_INFO_TYPE_RDB)
+            server.stat_rdb_cow_bytes = server.child_info_data.cow_size;
+        else if (server.child_info_data.process_type == CHILD_INFO_TYPE_AOF)
+            server.stat_aof_cow_bytes = server.child_info_data.cow_size;
+    }
+}
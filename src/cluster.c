@@ -0,0 +1,1651 @@
+/* Redis Cluster implementation.
+ *
+ * 集群
+ *
+ * The keyspace is partitioned into 16384 hash slots: the slot of a key is
+ * CRC16(key) modulo 16384, and only the part of the key inside the first
+ * {...} is hashed when present, so that related keys can be forced in the
+ * same slot. Every slot is served by one node. A node that receives a
+ * command about a slot it does not serve replies with a -MOVED redirection
+ * to the right node, or with -ASK while the slot is being migrated.
+ *
+ * 键空间被划分为 16384 个哈希槽，键所在的槽为 CRC16(key) 对 16384 取模，
+ * 如果键中含有 {...} ，那么只计算第一个 {...} 之内的部分，
+ * 从而可以让相关的键被分配到同一个槽中。
+ * 每个槽由一个节点负责处理，节点收到不属于自己的槽的命令时，
+ * 回复 -MOVED 将客户端重定向到正确的节点，槽正在迁移时则回复 -ASK 。
+ *
+ * There is no cluster bus: the slot map of every node is configured with
+ * the CLUSTER command. CLUSTER MEET connects to another node and learns its
+ * name and the slots it serves, CLUSTER SETSLOT assigns a single slot.
+ *
+ * 没有集群总线，各个节点的槽分布由 CLUSTER 命令配置：
+ * CLUSTER MEET 连接另一个节点，获取它的名字以及它负责的槽，
+ * CLUSTER SETSLOT 指派单个槽。
+ */
+
+#include "redis.h"
+#include "cluster.h"
+#include "crc16.h"
+#include "crc64.h"
+#include "rdb.h"
+
+static void clusterUpdateState(void);
+
+/* Nodes table: the key is the node name, the value a clusterNode owned by
+ * the cluster code.
+ *
+ * 节点字典，键为节点的名字，值为 clusterNode 结构 */
+static dictType clusterNodesDictType = {
+    dictSdsHash,                /* hash function */
+    NULL,                       /* key dup */
+    NULL,                       /* val dup */
+    dictSdsKeyCompare,          /* key compare */
+    dictSdsDestructor,          /* key destructor */
+    NULL                        /* val destructor */
+};
+
+/* -----------------------------------------------------------------------------
+ * Initialization
+ * -------------------------------------------------------------------------- */
+
+/*
+ * 创建一个新的节点，name 为 NULL 时随机生成节点的名字
+ */
+static clusterNode *createClusterNode(char *nodename, int flags) {
+    clusterNode *node = zmalloc(sizeof(*node));
+
+    if (nodename)
+        memcpy(node->name, nodename, REDIS_CLUSTER_NAMELEN);
+    else
+        getRandomHexChars(node->name, REDIS_CLUSTER_NAMELEN);
+    node->flags = flags;
+    memset(node->slots,0,sizeof(node->slots));
+    node->numslots = 0;
+    node->ip[0] = '\0';
+    node->port = 0;
+    return node;
+}
+
+/*
+ * 将给定节点添加到节点字典中
+ */
+static void clusterAddNode(clusterNode *node) {
+    int retval;
+
+    retval = dictAdd(server.cluster->nodes,
+            sdsnewlen(node->name,REDIS_CLUSTER_NAMELEN), node);
+    redisAssert(retval == DICT_OK);
+}
+
+/*
+ * 根据名字，查找给定的节点，没找到返回 NULL
+ */
+static clusterNode *clusterLookupNode(char *name, size_t len) {
+    sds s = sdsnewlen(name, len);
+    dictEntry *de;
+
+    de = dictFind(server.cluster->nodes,s);
+    sdsfree(s);
+    if (de == NULL) return NULL;
+    return dictGetVal(de);
+}
+
+/*
+ * 初始化集群状态，只有 cluster-enabled 为 yes 时调用
+ */
+void clusterInit(void) {
+    int j;
+
+    // 集群节点不能同时是从服务器
+    if (server.masterhost) {
+        redisLog(REDIS_WARNING,
+            "Configuring a replica is not allowed in cluster mode. Exiting.");
+        exit(1);
+    }
+
+    server.cluster = zmalloc(sizeof(clusterState));
+    server.cluster->state = REDIS_CLUSTER_FAIL;
+    server.cluster->nodes = dictCreate(&clusterNodesDictType,NULL);
+    for (j = 0; j < REDIS_CLUSTER_SLOTS; j++) {
+        server.cluster->migrating_slots_to[j] = NULL;
+        server.cluster->importing_slots_from[j] = NULL;
+        server.cluster->slots[j] = NULL;
+        server.cluster->slots_to_keys[j] = NULL;
+        server.cluster->slots_keys_count[j] = 0;
+    }
+
+    // 创建代表当前节点的 myself
+    server.cluster->myself = createClusterNode(NULL,REDIS_NODE_MYSELF);
+    server.cluster->myself->port = server.port;
+    clusterAddNode(server.cluster->myself);
+    redisLog(REDIS_NOTICE,"No cluster configuration found, I'm %.40s",
+        server.cluster->myself->name);
+}
+
+/* -----------------------------------------------------------------------------
+ * Key space handling
+ * -------------------------------------------------------------------------- */
+
+/* We have 16384 hash slots. The hash slot of a given key is obtained
+ * as the least significant 14 bits of the crc16 of the key.
+ *
+ * However if the key contains the {...} pattern, only the part between
+ * { and } is hashed. This may be useful in the future to force certain
+ * keys to be in the same node (assuming no resharding is in progress).
+ *
+ * 计算给定键应该被分配到哪个槽。
+ * 如果键中含有 {...} ，那么只对 { 和 } 之间的内容进行计算，
+ * 空的 {} 不算在内。 */
+unsigned int keyHashSlot(char *key, int keylen) {
+    int s, e; /* start-end indexes of { and } */
+
+    for (s = 0; s < keylen; s++)
+        if (key[s] == '{') break;
+
+    /* No '{' ? Hash the whole key. This is the base case. */
+    if (s == keylen) return crc16(key,keylen) & 0x3FFF;
+
+    /* '{' found? Check if we have the corresponding '}'. */
+    for (e = s+1; e < keylen; e++)
+        if (key[e] == '}') break;
+
+    /* No '}' or nothing betweeen {} ? Hash the whole key. */
+    if (e == keylen || e == s+1) return crc16(key,keylen) & 0x3FFF;
+
+    /* If we are here there is both a { and a } on its right. Hash
+     * what is in the middle between { and }. */
+    return crc16(key+s+1,e-s-1) & 0x3FFF;
+}
+
+/* Add the key to the index of its slot. 'key' must be the sds string owned
+ * by the keyspace: the index does not copy it.
+ *
+ * 将键添加到它所在槽的索引中。
+ * key 必须是键空间中的 sds ，索引不会复制它。 */
+void slotToKeyAdd(sds key) {
+    unsigned int hashslot = keyHashSlot(key,sdslen(key));
+    dict *d = server.cluster->slots_to_keys[hashslot];
+
+    if (d == NULL) {
+        d = dictCreate(&keyptrDictType,NULL);
+        server.cluster->slots_to_keys[hashslot] = d;
+    }
+    if (dictAdd(d,key,NULL) == DICT_OK)
+        server.cluster->slots_keys_count[hashslot]++;
+}
+
+/* Remove the key from the index of its slot. Must be called before the key
+ * is deleted from the keyspace, since the index references its sds.
+ *
+ * 从槽的索引中删除键。
+ * 因为索引引用了键空间中的 sds ，所以必须在从键空间删除键之前调用。 */
+void slotToKeyDel(sds key) {
+    unsigned int hashslot = keyHashSlot(key,sdslen(key));
+    dict *d = server.cluster->slots_to_keys[hashslot];
+
+    if (d && dictDelete(d,key) == DICT_OK)
+        server.cluster->slots_keys_count[hashslot]--;
+}
+
+/*
+ * 清空所有槽的索引，在清空 0 号数据库时调用
+ */
+void slotToKeyFlush(void) {
+    int j;
+
+    for (j = 0; j < REDIS_CLUSTER_SLOTS; j++) {
+        if (server.cluster->slots_to_keys[j]) {
+            dictRelease(server.cluster->slots_to_keys[j]);
+            server.cluster->slots_to_keys[j] = NULL;
+        }
+        server.cluster->slots_keys_count[j] = 0;
+    }
+}
+
+/*
+ * 返回槽中的键数量
+ */
+unsigned int countKeysInSlot(unsigned int hashslot) {
+    return server.cluster->slots_keys_count[hashslot];
+}
+
+/* Populate 'keys' with up to 'count' key objects of the slot. Returns the
+ * number of keys stored, the caller must release them.
+ *
+ * 记录槽中最多 count 个键到 keys 中，返回记录的键数量，
+ * 调用者负责释放这些键对象。 */
+unsigned int getKeysInSlot(unsigned int hashslot, robj **keys, unsigned int count) {
+    dict *d = server.cluster->slots_to_keys[hashslot];
+    unsigned int j = 0;
+    dictIterator *di;
+    dictEntry *de;
+
+    if (d == NULL || count == 0) return 0;
+    di = dictGetIterator(d);
+    while(j < count && (de = dictNext(di)) != NULL) {
+        sds key = dictGetKey(de);
+        keys[j++] = createStringObject(key,sdslen(key));
+    }
+    dictReleaseIterator(di);
+    return j;
+}
+
+/* -----------------------------------------------------------------------------
+ * Slots assignment
+ * -------------------------------------------------------------------------- */
+
+/* Test bit 'pos' in a generic bitmap. Return 1 if the bit is set,
+ * otherwise 0. */
+static int clusterNodeGetSlotBit(clusterNode *n, int slot) {
+    return (n->slots[slot/8] & (1<<(slot&7))) != 0;
+}
+
+/* Add the specified slot to the list of slots that node 'n' will
+ * serve. Return REDIS_OK if the operation ended with success.
+ * If the slot is already assigned to another instance this is considered
+ * an error and REDIS_ERR is returned.
+ *
+ * 将槽 slot 指派给节点 n ，槽已经被指派时返回 REDIS_ERR 。 */
+static int clusterAddSlot(clusterNode *n, int slot) {
+    if (server.cluster->slots[slot]) return REDIS_ERR;
+    n->slots[slot/8] |= 1<<(slot&7);
+    n->numslots++;
+    server.cluster->slots[slot] = n;
+    return REDIS_OK;
+}
+
+/* Delete the specified slot marking it as unassigned.
+ * Returns REDIS_OK if the slot was assigned, otherwise if the slot was
+ * already unassigned REDIS_ERR is returned.
+ *
+ * 撤销槽 slot 的指派，槽本来就没有被指派时返回 REDIS_ERR 。 */
+static int clusterDelSlot(int slot) {
+    clusterNode *n = server.cluster->slots[slot];
+
+    if (!n) return REDIS_ERR;
+    n->slots[slot/8] &= ~(1<<(slot&7));
+    n->numslots--;
+    server.cluster->slots[slot] = NULL;
+    return REDIS_OK;
+}
+
+/* Remove a node from the cluster, unassigning its slots and clearing the
+ * migrations that involve it.
+ *
+ * 从集群中移除节点，撤销它的槽，并且清除和它有关的迁移状态。 */
+static void clusterDelNode(clusterNode *delnode) {
+    int j;
+    sds nodename;
+
+    for (j = 0; j < REDIS_CLUSTER_SLOTS; j++) {
+        if (server.cluster->importing_slots_from[j] == delnode)
+            server.cluster->importing_slots_from[j] = NULL;
+        if (server.cluster->migrating_slots_to[j] == delnode)
+            server.cluster->migrating_slots_to[j] = NULL;
+        if (server.cluster->slots[j] == delnode)
+            clusterDelSlot(j);
+    }
+
+    nodename = sdsnewlen(delnode->name, REDIS_CLUSTER_NAMELEN);
+    redisAssert(dictDelete(server.cluster->nodes,nodename) == DICT_OK);
+    sdsfree(nodename);
+    zfree(delnode);
+}
+
+/* The cluster can serve queries only when all the slots are assigned.
+ *
+ * 只有所有槽都已经指派时，集群才处于在线状态。 */
+static void clusterUpdateState(void) {
+    int j, new_state = REDIS_CLUSTER_OK;
+
+    for (j = 0; j < REDIS_CLUSTER_SLOTS; j++) {
+        if (server.cluster->slots[j] == NULL) {
+            new_state = REDIS_CLUSTER_FAIL;
+            break;
+        }
+    }
+
+    if (new_state != server.cluster->state) {
+        redisLog(REDIS_WARNING,"Cluster state changed: %s",
+            new_state == REDIS_CLUSTER_OK ? "ok" : "fail");
+        server.cluster->state = new_state;
+    }
+}
+
+/* -----------------------------------------------------------------------------
+ * CLUSTER MEET
+ * -------------------------------------------------------------------------- */
+
+/* Parse the slots of a CLUSTER NODES line, "<slot>" or "<start>-<end>"
+ * tokens starting at argv[8], into the bitmap of 'n'. Migration tokens
+ * like "[<slot>->-<node>]" are skipped.
+ *
+ * 解析 CLUSTER NODES 一行中的槽，保存到节点 n 的槽位图中。 */
+static int clusterParseNodeSlots(clusterNode *n, sds *argv, int argc) {
+    int j;
+
+    memset(n->slots,0,sizeof(n->slots));
+    for (j = 8; j < argc; j++) {
+        char *p;
+        int start, stop;
+
+        if (argv[j][0] == '[') continue;
+        if ((p = strchr(argv[j],'-')) != NULL) {
+            *p = '\0';
+            start = atoi(argv[j]);
+            stop = atoi(p+1);
+        } else {
+            start = stop = atoi(argv[j]);
+        }
+        if (start < 0 || stop >= REDIS_CLUSTER_SLOTS || start > stop)
+            return REDIS_ERR;
+        while(start <= stop) {
+            n->slots[start/8] |= 1<<(start&7);
+            start++;
+        }
+    }
+    return REDIS_OK;
+}
+
+/* Connect to the node at ip:port and read its CLUSTER NODES output, filling
+ * 'n' with the name and the slots the node claims for itself. The
+ * connection is synchronous with a short timeout, like the handshake of a
+ * replica with its master. On error an error string is returned.
+ *
+ * 连接 ip:port 上的节点，读取它的 CLUSTER NODES 输出，
+ * 将节点的名字和它负责的槽记录到 n 中。
+ * 和从服务器的握手一样，连接是同步的，并且有较短的超时时间。
+ * 出错时返回错误信息。 */
+static char *clusterFetchNode(char *ip, int port, clusterNode *n) {
+    char *cmd = "*2\r\n$7\r\nCLUSTER\r\n$5\r\nNODES\r\n";
+    long long timeout = REDIS_CLUSTER_MEET_TIMEOUT;
+    char buf[256], *err = NULL;
+    sds payload = NULL, *lines = NULL;
+    int fd, j, numlines = 0;
+    long len;
+
+    fd = anetTcpNonBlockConnect(server.neterr,ip,port);
+    if (fd == ANET_ERR) return "Can't connect to the node";
+    if ((aeWait(fd,AE_WRITABLE,timeout) & AE_WRITABLE) == 0) {
+        err = "Timeout connecting to the node";
+        goto done;
+    }
+
+    // 发送 CLUSTER NODES 并读取回复
+    if (syncWrite(fd,cmd,strlen(cmd),timeout) == -1 ||
+        syncReadLine(fd,buf,sizeof(buf),timeout) == -1)
+    {
+        err = "I/O error talking with the node";
+        goto done;
+    }
+    if (buf[0] != '$') {
+        err = "The node replied with an error to CLUSTER NODES";
+        goto done;
+    }
+    len = strtol(buf+1,NULL,10);
+    if (len <= 0) {
+        err = "The node replied with an error to CLUSTER NODES";
+        goto done;
+    }
+    payload = sdsnewlen(NULL,len+2);
+    if (syncRead(fd,payload,len+2,timeout) == -1) {
+        err = "I/O error talking with the node";
+        goto done;
+    }
+
+    // 找到节点描述它自己的那一行
+    err = "The node did not describe itself";
+    lines = sdssplitlen(payload,len,"\n",1,&numlines);
+    for (j = 0; j < numlines; j++) {
+        int argc;
+        sds *argv = sdssplitlen(lines[j],sdslen(lines[j])," ",1,&argc);
+
+        if (argc >= 8 && strstr(argv[2],"myself") &&
+            sdslen(argv[0]) == REDIS_CLUSTER_NAMELEN)
+        {
+            memcpy(n->name,argv[0],REDIS_CLUSTER_NAMELEN);
+            err = (clusterParseNodeSlots(n,argv,argc) == REDIS_OK) ? NULL :
+                  "Invalid slots in the CLUSTER NODES reply";
+            sdsfreesplitres(argv,argc);
+            break;
+        }
+        sdsfreesplitres(argv,argc);
+    }
+
+done:
+    if (lines) sdsfreesplitres(lines,numlines);
+    sdsfree(payload);
+    close(fd);
+    return err;
+}
+
+/* CLUSTER MEET <ip> <port>: add the node to the nodes table, or update it,
+ * and take the slots it claims that are not served by this node.
+ *
+ * 将节点添加到节点字典中，或者更新已有的节点，
+ * 并且将节点声明负责、但不由当前节点负责的槽指派给它。 */
+static void clusterMeetCommand(redisClient *c) {
+    clusterNode *fetched, *n;
+    long long port;
+    char *err;
+    int j;
+
+    if (getLongLongFromObject(c->argv[3], &port) != REDIS_OK ||
+        port <= 0 || port > 65535)
+    {
+        addReplyErrorFormat(c,"Invalid TCP port specified: %s",
+                            (char*)c->argv[3]->ptr);
+        return;
+    }
+
+    fetched = createClusterNode(NULL,0);
+    if ((err = clusterFetchNode(c->argv[2]->ptr,port,fetched)) != NULL) {
+        zfree(fetched);
+        addReplyErrorFormat(c,"%s %s:%lld", err,
+            (char*)c->argv[2]->ptr, port);
+        return;
+    }
+    if (memcmp(fetched->name,server.cluster->myself->name,
+               REDIS_CLUSTER_NAMELEN) == 0)
+    {
+        zfree(fetched);
+        addReplyError(c,"I tried hard but I can't meet myself!");
+        return;
+    }
+
+    // 新的节点直接加入节点字典，已知的节点只更新地址和槽
+    n = clusterLookupNode(fetched->name,REDIS_CLUSTER_NAMELEN);
+    if (n == NULL) {
+        n = createClusterNode(fetched->name,0);
+        clusterAddNode(n);
+    }
+    strncpy(n->ip,c->argv[2]->ptr,sizeof(n->ip));
+    n->ip[sizeof(n->ip)-1] = '\0';
+    n->port = port;
+
+    for (j = 0; j < REDIS_CLUSTER_SLOTS; j++) {
+        clusterNode *owner = server.cluster->slots[j];
+
+        if (clusterNodeGetSlotBit(fetched,j)) {
+            if (owner == n) continue;
+            if (owner == server.cluster->myself) {
+                redisLog(REDIS_WARNING,
+                    "Node %.40s claims slot %d, served by myself", n->name, j);
+                continue;
+            }
+            if (owner) clusterDelSlot(j);
+            clusterAddSlot(n,j);
+        } else if (owner == n) {
+            clusterDelSlot(j);
+        }
+    }
+    zfree(fetched);
+    clusterUpdateState();
+    addReply(c,shared.ok);
+}
+
+/* -----------------------------------------------------------------------------
+ * CLUSTER command
+ * -------------------------------------------------------------------------- */
+
+/* Fill 'ip' with the address to show for node 'n' to the client 'c'. The
+ * address of myself is the one the client used to connect.
+ *
+ * 获取展示给客户端的节点地址，myself 节点使用客户端连接时的地址。 */
+static char *clusterNodeIp(redisClient *c, clusterNode *n, char *ip, size_t len) {
+    if (n != server.cluster->myself) return n->ip;
+    if (anetSockName(c->fd,ip,len,NULL) == -1) return n->ip;
+    return ip;
+}
+
+/* Generate a csv-alike representation of the nodes we are aware of,
+ * one node per line:
+ *
+ * <name> <ip>:<port> <flags> - 0 0 0 connected <slot> <start>-<end> ...
+ *
+ * The unused fields keep the layout of the standard cluster nodes output.
+ *
+ * 以每个节点一行的格式描述已知的所有节点。 */
+static sds clusterGenNodesDescription(redisClient *c) {
+    sds ci = sdsempty();
+    dictIterator *di;
+    dictEntry *de;
+    int j, start;
+
+    di = dictGetIterator(server.cluster->nodes);
+    while((de = dictNext(di)) != NULL) {
+        clusterNode *node = dictGetVal(de);
+        char ip[REDIS_IP_STR_LEN];
+
+        // 节点的名字，地址和标识
+        ci = sdscatlen(ci,node->name,REDIS_CLUSTER_NAMELEN);
+        ci = sdscatprintf(ci," %s:%d %s - 0 0 0 connected",
+            clusterNodeIp(c,node,ip,sizeof(ip)), node->port,
+            (node->flags & REDIS_NODE_MYSELF) ? "myself,master" : "master");
+
+        // 节点负责的槽，连续的槽合并为一个区间
+        start = -1;
+        for (j = 0; j < REDIS_CLUSTER_SLOTS; j++) {
+            int bit;
+
+            if ((bit = clusterNodeGetSlotBit(node,j)) != 0) {
+                if (start == -1) start = j;
+            }
+            if (start != -1 && (!bit || j == REDIS_CLUSTER_SLOTS-1)) {
+                if (bit && j == REDIS_CLUSTER_SLOTS-1) j++;
+
+                if (start == j-1) {
+                    ci = sdscatprintf(ci," %d",start);
+                } else {
+                    ci = sdscatprintf(ci," %d-%d",start,j-1);
+                }
+                start = -1;
+            }
+        }
+
+        // 当前节点正在迁移和导入的槽
+        if (node->flags & REDIS_NODE_MYSELF) {
+            for (j = 0; j < REDIS_CLUSTER_SLOTS; j++) {
+                if (server.cluster->migrating_slots_to[j]) {
+                    ci = sdscatprintf(ci," [%d->-%.40s]",j,
+                        server.cluster->migrating_slots_to[j]->name);
+                } else if (server.cluster->importing_slots_from[j]) {
+                    ci = sdscatprintf(ci," [%d-<-%.40s]",j,
+                        server.cluster->importing_slots_from[j]->name);
+                }
+            }
+        }
+        ci = sdscatlen(ci,"\n",1);
+    }
+    dictReleaseIterator(di);
+    return ci;
+}
+
+/* CLUSTER SLOTS: for every range of contiguous slots served by the same
+ * node reply with [start, end, [ip, port, name]].
+ *
+ * 为每个由同一节点负责的连续槽区间回复 [start, end, [ip, port, name]] 。 */
+static void clusterReplySlots(redisClient *c) {
+    int j, start, pass;
+    long numranges = 0;
+
+    /* First pass counts the ranges, the second one emits them. */
+    // 第一遍计算区间的数量，第二遍回复区间
+    for (pass = 0; pass < 2; pass++) {
+        if (pass == 1) addReplyMultiBulkLen(c,numranges);
+        for (start = 0; start < REDIS_CLUSTER_SLOTS; start = j) {
+            clusterNode *n = server.cluster->slots[start];
+            char ip[REDIS_IP_STR_LEN];
+
+            for (j = start+1; j < REDIS_CLUSTER_SLOTS; j++)
+                if (server.cluster->slots[j] != n) break;
+            if (n == NULL) continue;
+            if (pass == 0) {
+                numranges++;
+                continue;
+            }
+            addReplyMultiBulkLen(c,3);
+            addReplyLongLong(c,start);
+            addReplyLongLong(c,j-1);
+            addReplyMultiBulkLen(c,3);
+            addReplyBulkCString(c,clusterNodeIp(c,n,ip,sizeof(ip)));
+            addReplyLongLong(c,n->port);
+            addReplyBulkSds(c,sdsnewlen(n->name,REDIS_CLUSTER_NAMELEN));
+        }
+    }
+}
+
+/*
+ * 从对象 o 中取出槽号，出错时向客户端回复错误并返回 -1
+ */
+static int getSlotOrReply(redisClient *c, robj *o) {
+    long long slot;
+
+    if (getLongLongFromObject(o,&slot) != REDIS_OK ||
+        slot < 0 || slot >= REDIS_CLUSTER_SLOTS)
+    {
+        addReplyError(c,"Invalid or out of range slot");
+        return -1;
+    }
+    return (int) slot;
+}
+
+/* CLUSTER ADDSLOTS/DELSLOTS <slot> ... and the ADDSLOTSRANGE/DELSLOTSRANGE
+ * <start> <end> ... forms. All the slots are checked before changing
+ * anything, so that the command is atomic.
+ *
+ * 先检查所有给定的槽，再进行修改，所以命令是原子的。 */
+static void clusterAddDelSlotsCommand(redisClient *c, int del, int range) {
+    unsigned char *slots = zcalloc(REDIS_CLUSTER_SLOTS);
+    int j, k;
+
+    if ((c->argc == 2) || (range && c->argc % 2)) {
+        addReplyErrorFormat(c,"wrong number of arguments for CLUSTER %s",
+            (char*)c->argv[1]->ptr);
+        zfree(slots);
+        return;
+    }
+
+    // 检查槽号，以及槽是否已经被指派
+    for (j = 2; j < c->argc; j += range ? 2 : 1) {
+        int start, end;
+
+        if ((start = getSlotOrReply(c,c->argv[j])) == -1) goto err;
+        end = start;
+        if (range) {
+            if ((end = getSlotOrReply(c,c->argv[j+1])) == -1) goto err;
+            if (start > end) {
+                addReplyErrorFormat(c,"start slot number %d is greater than end slot number %d", start, end);
+                goto err;
+            }
+        }
+        for (k = start; k <= end; k++) {
+            if (del && server.cluster->slots[k] == NULL) {
+                addReplyErrorFormat(c,"Slot %d is already unassigned", k);
+                goto err;
+            } else if (!del && server.cluster->slots[k]) {
+                addReplyErrorFormat(c,"Slot %d is already busy", k);
+                goto err;
+            }
+            if (slots[k]++ == 1) {
+                addReplyErrorFormat(c,"Slot %d specified multiple times",k);
+                goto err;
+            }
+        }
+    }
+
+    // 指派或者撤销指派
+    for (j = 0; j < REDIS_CLUSTER_SLOTS; j++) {
+        if (!slots[j]) continue;
+
+        /* If this slot was set as importing we can clear this
+         * state as now we are the real owner of the slot. */
+        if (server.cluster->importing_slots_from[j])
+            server.cluster->importing_slots_from[j] = NULL;
+        if (del) {
+            server.cluster->migrating_slots_to[j] = NULL;
+            clusterDelSlot(j);
+        } else {
+            clusterAddSlot(server.cluster->myself,j);
+        }
+    }
+    zfree(slots);
+    clusterUpdateState();
+    addReply(c,shared.ok);
+    return;
+
+err:
+    zfree(slots);
+}
+
+/* CLUSTER SETSLOT <slot> MIGRATING|IMPORTING|STABLE|NODE [<node>]
+ *
+ * 设置槽的迁移状态，或者将槽指派给给定的节点 */
+static void clusterSetSlotCommand(redisClient *c) {
+    clusterNode *myself = server.cluster->myself;
+    clusterNode *n = NULL;
+    char *action;
+    int slot;
+
+    if (c->argc < 4) {
+        addReplyError(c,"wrong number of arguments for CLUSTER SETSLOT");
+        return;
+    }
+    if ((slot = getSlotOrReply(c,c->argv[2])) == -1) return;
+    action = c->argv[3]->ptr;
+
+    // 除了 STABLE ，其他动作都需要一个已知的节点
+    if (strcasecmp(action,"stable")) {
+        if (c->argc != 5) {
+            addReply(c,shared.syntaxerr);
+            return;
+        }
+        n = clusterLookupNode(c->argv[4]->ptr,sdslen(c->argv[4]->ptr));
+        if (n == NULL) {
+            addReplyErrorFormat(c,"I don't know about node %s",
+                (char*)c->argv[4]->ptr);
+            return;
+        }
+    } else if (c->argc != 4) {
+        addReply(c,shared.syntaxerr);
+        return;
+    }
+
+    if (!strcasecmp(action,"migrating")) {
+        // 只能迁移自己负责的槽
+        if (server.cluster->slots[slot] != myself) {
+            addReplyErrorFormat(c,"I'm not the owner of hash slot %u",slot);
+            return;
+        }
+        if (n == myself) {
+            addReplyError(c,"Can't MIGRATE a slot to myself");
+            return;
+        }
+        server.cluster->migrating_slots_to[slot] = n;
+    } else if (!strcasecmp(action,"importing")) {
+        // 不能导入自己已经负责的槽
+        if (server.cluster->slots[slot] == myself) {
+            addReplyErrorFormat(c,
+                "I'm already the owner of hash slot %u",slot);
+            return;
+        }
+        if (n == myself) {
+            addReplyError(c,"Can't IMPORT a slot from myself");
+            return;
+        }
+        server.cluster->importing_slots_from[slot] = n;
+    } else if (!strcasecmp(action,"stable")) {
+        server.cluster->importing_slots_from[slot] = NULL;
+        server.cluster->migrating_slots_to[slot] = NULL;
+    } else if (!strcasecmp(action,"node")) {
+        /* If this hash slot was served by 'myself' before to switch
+         * make sure there are no longer local keys for this hash slot. */
+        // 槽原本由当前节点负责时，必须先将槽中的键全部迁移出去
+        if (server.cluster->slots[slot] == myself && n != myself &&
+            countKeysInSlot(slot) != 0)
+        {
+            addReplyErrorFormat(c,
+                "Can't assign hashslot %d to a different node "
+                "while I still hold keys for this hash slot.", slot);
+            return;
+        }
+
+        /* If this slot is in migrating status but we have no keys
+         * for it assigning the slot to another node will clear
+         * the migrating status. */
+        if (countKeysInSlot(slot) == 0 &&
+            server.cluster->migrating_slots_to[slot])
+            server.cluster->migrating_slots_to[slot] = NULL;
+
+        /* If this node was importing this slot, assigning the slot to
+         * itself also clears the importing status. */
+        if (n == myself && server.cluster->importing_slots_from[slot])
+            server.cluster->importing_slots_from[slot] = NULL;
+
+        clusterDelSlot(slot);
+        clusterAddSlot(n,slot);
+        clusterUpdateState();
+    } else {
+        addReplyError(c,
+            "Invalid CLUSTER SETSLOT action or number of arguments");
+        return;
+    }
+    addReply(c,shared.ok);
+}
+
+/*
+ * CLUSTER 命令的实现
+ */
+void clusterCommand(redisClient *c) {
+    if (server.cluster_enabled == 0) {
+        addReplyError(c,"This instance has cluster support disabled");
+        return;
+    }
+
+    if (!strcasecmp(c->argv[1]->ptr,"meet") && c->argc == 4) {
+        /* CLUSTER MEET <ip> <port> */
+        clusterMeetCommand(c);
+    } else if (!strcasecmp(c->argv[1]->ptr,"forget") && c->argc == 3) {
+        /* CLUSTER FORGET <NODE ID> */
+        clusterNode *n = clusterLookupNode(c->argv[2]->ptr,
+                                           sdslen(c->argv[2]->ptr));
+        if (!n) {
+            addReplyErrorFormat(c,"Unknown node %s", (char*)c->argv[2]->ptr);
+            return;
+        } else if (n == server.cluster->myself) {
+            addReplyError(c,"I tried hard but I can't forget myself...");
+            return;
+        }
+        clusterDelNode(n);
+        clusterUpdateState();
+        addReply(c,shared.ok);
+    } else if (!strcasecmp(c->argv[1]->ptr,"nodes") && c->argc == 2) {
+        /* CLUSTER NODES */
+        addReplyBulkSds(c,clusterGenNodesDescription(c));
+    } else if (!strcasecmp(c->argv[1]->ptr,"myid") && c->argc == 2) {
+        /* CLUSTER MYID */
+        addReplyBulkSds(c,sdsnewlen(server.cluster->myself->name,
+                                    REDIS_CLUSTER_NAMELEN));
+    } else if (!strcasecmp(c->argv[1]->ptr,"slots") && c->argc == 2) {
+        /* CLUSTER SLOTS */
+        clusterReplySlots(c);
+    } else if (!strcasecmp(c->argv[1]->ptr,"addslots") ||
+               !strcasecmp(c->argv[1]->ptr,"delslots"))
+    {
+        /* CLUSTER ADDSLOTS <slot> [slot] ... */
+        /* CLUSTER DELSLOTS <slot> [slot] ... */
+        clusterAddDelSlotsCommand(c,
+            !strcasecmp(c->argv[1]->ptr,"delslots"),0);
+    } else if (!strcasecmp(c->argv[1]->ptr,"addslotsrange") ||
+               !strcasecmp(c->argv[1]->ptr,"delslotsrange"))
+    {
+        /* CLUSTER ADDSLOTSRANGE <start> <end> [<start> <end>] ... */
+        /* CLUSTER DELSLOTSRANGE <start> <end> [<start> <end>] ... */
+        clusterAddDelSlotsCommand(c,
+            !strcasecmp(c->argv[1]->ptr,"delslotsrange"),1);
+    } else if (!strcasecmp(c->argv[1]->ptr,"setslot")) {
+        /* SETSLOT 10 MIGRATING <node ID> */
+        /* SETSLOT 10 IMPORTING <node ID> */
+        /* SETSLOT 10 STABLE */
+        /* SETSLOT 10 NODE <node ID> */
+        clusterSetSlotCommand(c);
+    } else if (!strcasecmp(c->argv[1]->ptr,"info") && c->argc == 2) {
+        /* CLUSTER INFO */
+        int j, slots_assigned = 0, cluster_size = 0;
+        dictIterator *di;
+        dictEntry *de;
+        sds info;
+
+        for (j = 0; j < REDIS_CLUSTER_SLOTS; j++)
+            if (server.cluster->slots[j]) slots_assigned++;
+
+        // 负责至少一个槽的节点数量
+        di = dictGetIterator(server.cluster->nodes);
+        while((de = dictNext(di)) != NULL) {
+            clusterNode *node = dictGetVal(de);
+            if (node->numslots) cluster_size++;
+        }
+        dictReleaseIterator(di);
+
+        info = sdscatprintf(sdsempty(),
+            "cluster_state:%s\r\n"
+            "cluster_slots_assigned:%d\r\n"
+            "cluster_known_nodes:%lu\r\n"
+            "cluster_size:%d\r\n"
+            , server.cluster->state == REDIS_CLUSTER_OK ? "ok" : "fail",
+            slots_assigned,
+            dictSize(server.cluster->nodes),
+            cluster_size
+        );
+        addReplyBulkSds(c,info);
+    } else if (!strcasecmp(c->argv[1]->ptr,"keyslot") && c->argc == 3) {
+        /* CLUSTER KEYSLOT <key> */
+        sds key = c->argv[2]->ptr;
+
+        addReplyLongLong(c,keyHashSlot(key,sdslen(key)));
+    } else if (!strcasecmp(c->argv[1]->ptr,"countkeysinslot") && c->argc == 3) {
+        /* CLUSTER COUNTKEYSINSLOT <slot> */
+        int slot;
+
+        if ((slot = getSlotOrReply(c,c->argv[2])) == -1) return;
+        addReplyLongLong(c,countKeysInSlot(slot));
+    } else if (!strcasecmp(c->argv[1]->ptr,"getkeysinslot") && c->argc == 4) {
+        /* CLUSTER GETKEYSINSLOT <slot> <count> */
+        long long maxkeys;
+        unsigned int numkeys, j;
+        robj **keys;
+        int slot;
+
+        if ((slot = getSlotOrReply(c,c->argv[2])) == -1) return;
+        if (getLongLongFromObjectOrReply(c,c->argv[3],&maxkeys,NULL)
+            != REDIS_OK)
+            return;
+        if (maxkeys < 0 || maxkeys > UINT_MAX) {
+            addReplyError(c,"Invalid number of keys");
+            return;
+        }
+
+        // 最多返回槽中已有的键数量
+        if (maxkeys > countKeysInSlot(slot)) maxkeys = countKeysInSlot(slot);
+        keys = zmalloc(sizeof(robj*)*(maxkeys ? maxkeys : 1));
+        numkeys = getKeysInSlot(slot, keys, maxkeys);
+        addReplyMultiBulkLen(c,numkeys);
+        for (j = 0; j < numkeys; j++) {
+            addReplyBulk(c,keys[j]);
+            decrRefCount(keys[j]);
+        }
+        zfree(keys);
+    } else {
+        addReplyError(c,"Wrong CLUSTER subcommand or number of arguments");
+    }
+}
+
+/* -----------------------------------------------------------------------------
+ * DUMP, RESTORE and MIGRATE commands
+ * -------------------------------------------------------------------------- */
+
+/* Generates a DUMP-format representation of the object 'o', adding it to the
+ * io stream pointed by 'rio'. This function can't fail.
+ *
+ * 生成对象 o 的 DUMP 格式表示，保存到 payload 的缓存中。 */
+static void createDumpPayload(rio *payload, robj *o) {
+    unsigned char buf[2];
+    uint64_t crc;
+
+    /* Serialize the object in a RDB-like format. It consist of an object type
+     * byte followed by the serialized object. This is understood by RESTORE. */
+    // 和 RDB 一样，先写入对象的类型，再写入对象
+    rioInitWithBuffer(payload,sdsempty());
+    redisAssert(rdbSaveObjectType(payload,o));
+    redisAssert(rdbSaveObject(payload,o));
+
+    /* Write the footer, this is how it looks like:
+     * ----------------+---------------------+---------------+
+     * ... RDB payload | 2 bytes RDB version | 8 bytes CRC64 |
+     * ----------------+---------------------+---------------+
+     * RDB version and CRC are both in little endian.
+     */
+
+    /* RDB version */
+    buf[0] = REDIS_RDB_VERSION & 0xff;
+    buf[1] = (REDIS_RDB_VERSION >> 8) & 0xff;
+    payload->io.buffer.ptr = sdscatlen(payload->io.buffer.ptr,buf,2);
+
+    /* CRC64 */
+    crc = crc64(0,(unsigned char*)payload->io.buffer.ptr,
+                sdslen(payload->io.buffer.ptr));
+    crc = rdbLittleEndian64(crc);
+    payload->io.buffer.ptr = sdscatlen(payload->io.buffer.ptr,&crc,8);
+}
+
+/* Verify that the RDB version of the dump payload matches the one of this Redis
+ * instance and that the checksum is ok.
+ * If the DUMP payload looks valid REDIS_OK is returned, otherwise REDIS_ERR
+ * is returned.
+ *
+ * 检查 DUMP 数据的 RDB 版本和校验和。 */
+static int verifyDumpPayload(unsigned char *p, size_t len) {
+    unsigned char *footer;
+    uint16_t rdbver;
+    uint64_t crc;
+
+    /* At least 2 bytes of RDB version and 8 of CRC64 should be present. */
+    if (len < 10) return REDIS_ERR;
+    footer = p+(len-10);
+
+    /* Verify RDB version */
+    rdbver = (footer[1] << 8) | footer[0];
+    if (rdbver > REDIS_RDB_VERSION) return REDIS_ERR;
+
+    /* Verify CRC64 */
+    crc = crc64(0,p,len-8);
+    crc = rdbLittleEndian64(crc);
+    return (memcmp(&crc,footer+2,8) == 0) ? REDIS_OK : REDIS_ERR;
+}
+
+/* DUMP keyname
+ * DUMP is actually not used by Redis Cluster but it is the obvious
+ * complement of RESTORE and can be useful for different applications. */
+void dumpCommand(redisClient *c) {
+    robj *o, *dumpobj;
+    rio payload;
+
+    /* Check if the key is here. */
+    if ((o = lookupKeyRead(c,c->argv[1])) == NULL) {
+        addReply(c,shared.nullbulk);
+        return;
+    }
+
+    /* Create the DUMP encoded representation. */
+    createDumpPayload(&payload,o);
+
+    /* Transfer to the client */
+    dumpobj = createObject(REDIS_STRING,payload.io.buffer.ptr);
+    addReplyBulk(c,dumpobj);
+    decrRefCount(dumpobj);
+}
+
+/* RESTORE key ttl serialized-value [REPLACE]
+ *
+ * RESTORE-ASKING is the same command with the ASKING semantic implied, so
+ * that MIGRATE can write the keys of a slot being imported by the target
+ * without an extra ASKING round for every key.
+ *
+ * RESTORE-ASKING 和 RESTORE 相同，只是隐含了 ASKING ，
+ * 这样 MIGRATE 就不需要在每个键之前发送一次 ASKING 。 */
+void restoreCommand(redisClient *c) {
+    long long ttl;
+    rio payload;
+    int j, type, replace = 0;
+    robj *obj;
+
+    /* Parse additional options */
+    for (j = 4; j < c->argc; j++) {
+        if (!strcasecmp(c->argv[j]->ptr,"replace")) {
+            replace = 1;
+        } else {
+            addReply(c,shared.syntaxerr);
+            return;
+        }
+    }
+
+    /* Make sure this key does not already exist here... */
+    if (!replace && lookupKeyWrite(c->db,c->argv[1]) != NULL) {
+        addReplySds(c,sdsnew("-BUSYKEY Target key name already exists.\r\n"));
+        return;
+    }
+
+    /* Check if the TTL value makes sense */
+    if (getLongLongFromObjectOrReply(c,c->argv[2],&ttl,NULL) != REDIS_OK) {
+        return;
+    } else if (ttl < 0) {
+        addReplyError(c,"Invalid TTL value, must be >= 0");
+        return;
+    }
+
+    /* Verify RDB version and data checksum. */
+    if (verifyDumpPayload(c->argv[3]->ptr,sdslen(c->argv[3]->ptr)) == REDIS_ERR)
+    {
+        addReplyError(c,"DUMP payload version or checksum are wrong");
+        return;
+    }
+
+    rioInitWithBuffer(&payload,c->argv[3]->ptr);
+    if (((type = rdbLoadObjectType(&payload)) == -1) ||
+        ((obj = rdbLoadObject(type,&payload)) == NULL))
+    {
+        addReplyError(c,"Bad data format");
+        return;
+    }
+
+    /* Remove the old key if needed. */
+    if (replace) dbDelete(c->db,c->argv[1]);
+
+    /* Create the key and set the TTL if any */
+    dbAdd(c->db,c->argv[1],obj);
+    if (ttl) setExpire(c->db,c->argv[1],mstime()+ttl);
+    signalModifiedKey(c->db,c->argv[1]);
+    addReply(c,shared.ok);
+    server.dirty++;
+}
+
+/* MIGRATE socket cache implementation.
+ *
+ * We take a map between host:ip and a TCP socket that we used to connect
+ * to this instance in recent time. Moving a slot takes many MIGRATE calls
+ * to the same target, that reuse the connection and its selected DB.
+ * This sockets are closed when the max number we cache is reached, and also
+ * in serverCron() when they are around for more than a few seconds.
+ *
+ * MIGRATE 使用的连接缓存。
+ * 迁移一个槽需要对同一个目标执行多次 MIGRATE ，
+ * 缓存连接可以省去每次的连接和 SELECT 。 */
+#define MIGRATE_SOCKET_CACHE_ITEMS 64 /* max num of items in the cache. */
+#define MIGRATE_SOCKET_CACHE_TTL 10 /* close cached sockets after 10 sec. */
+
+typedef struct migrateCachedSocket {
+    int fd;
+    long long last_dbid;
+    time_t last_use_time;
+} migrateCachedSocket;
+
+/* Return a migrateCachedSocket containing a TCP socket connected with the
+ * target instance, possibly returning a cached one.
+ *
+ * This function is responsible of sending errors to the client if a
+ * connection can't be established. In this case NULL is returned.
+ * Otherwise on success the socket is returned, and the caller should not
+ * attempt to free it after usage.
+ *
+ * If the caller detects an error while using the socket, migrateCloseSocket()
+ * should be called so that the connection will be created from scratch
+ * the next time.
+ *
+ * 返回连接到目标节点的套接字，可能是缓存中的套接字。
+ * 无法连接时向客户端回复错误，并返回 NULL 。 */
+static migrateCachedSocket* migrateGetSocket(redisClient *c, robj *host, robj *port, long long timeout) {
+    int fd;
+    sds name = sdsempty();
+    migrateCachedSocket *cs;
+
+    /* Check if we have an already cached socket for this ip:port pair. */
+    name = sdscatlen(name,host->ptr,sdslen(host->ptr));
+    name = sdscatlen(name,":",1);
+    name = sdscatlen(name,port->ptr,sdslen(port->ptr));
+    cs = dictFetchValue(server.migrate_cached_sockets,name);
+    if (cs) {
+        sdsfree(name);
+        cs->last_use_time = time(NULL);
+        return cs;
+    }
+
+    /* No cached socket, create one. */
+    if (dictSize(server.migrate_cached_sockets) == MIGRATE_SOCKET_CACHE_ITEMS) {
+        /* Too many items, drop one at random. */
+        dictEntry *de = dictGetRandomKey(server.migrate_cached_sockets);
+        cs = dictGetVal(de);
+        close(cs->fd);
+        zfree(cs);
+        dictDelete(server.migrate_cached_sockets,dictGetKey(de));
+    }
+
+    /* Create the socket */
+    fd = anetTcpNonBlockConnect(server.neterr,c->argv[1]->ptr,
+                                atoi(c->argv[2]->ptr));
+    if (fd == -1) {
+        sdsfree(name);
+        addReplyErrorFormat(c,"Can't connect to target node: %s",
+            server.neterr);
+        return NULL;
+    }
+    anetEnableTcpNoDelay(server.neterr,fd);
+
+    /* Check if it connects within the specified timeout. */
+    if ((aeWait(fd,AE_WRITABLE,timeout) & AE_WRITABLE) == 0) {
+        sdsfree(name);
+        addReplySds(c,
+            sdsnew("-IOERR error or timeout connecting to the client\r\n"));
+        close(fd);
+        return NULL;
+    }
+
+    /* Add to the cache and return it to the caller. */
+    cs = zmalloc(sizeof(*cs));
+    cs->fd = fd;
+    cs->last_dbid = -1;
+    cs->last_use_time = time(NULL);
+    dictAdd(server.migrate_cached_sockets,name,cs);
+    return cs;
+}
+
+/* Free a migrate cached connection.
+ *
+ * 关闭并删除缓存的连接 */
+static void migrateCloseSocket(robj *host, robj *port) {
+    sds name = sdsempty();
+    migrateCachedSocket *cs;
+
+    name = sdscatlen(name,host->ptr,sdslen(host->ptr));
+    name = sdscatlen(name,":",1);
+    name = sdscatlen(name,port->ptr,sdslen(port->ptr));
+    cs = dictFetchValue(server.migrate_cached_sockets,name);
+    if (!cs) {
+        sdsfree(name);
+        return;
+    }
+
+    close(cs->fd);
+    zfree(cs);
+    dictDelete(server.migrate_cached_sockets,name);
+    sdsfree(name);
+}
+
+/*
+ * 关闭空闲超过 MIGRATE_SOCKET_CACHE_TTL 秒的缓存连接，由 serverCron() 调用
+ */
+void migrateCloseTimedoutSockets(void) {
+    dictIterator *di = dictGetSafeIterator(server.migrate_cached_sockets);
+    dictEntry *de;
+    time_t now = time(NULL);
+
+    while((de = dictNext(di)) != NULL) {
+        migrateCachedSocket *cs = dictGetVal(de);
+
+        if ((now - cs->last_use_time) > MIGRATE_SOCKET_CACHE_TTL) {
+            close(cs->fd);
+            zfree(cs);
+            dictDelete(server.migrate_cached_sockets,dictGetKey(de));
+        }
+    }
+    dictReleaseIterator(di);
+}
+
+/* MIGRATE host port key dbid timeout [COPY | REPLACE]
+ *
+ * Or in the multiple keys form:
+ *
+ * MIGRATE host port "" dbid timeout [COPY | REPLACE] KEYS key1 key2 ... keyN
+ *
+ * All the keys are serialized into a single stream of RESTORE commands that
+ * is written to the target at once, then the replies are read back in order:
+ * the Nth reply acknowledges the Nth key. Once the whole batch was read the
+ * acknowledged keys are deleted from the source in a single pass and the
+ * command is propagated as one DEL, so a slot is moved with a round trip per
+ * batch instead of one per key. The batch size is chosen by the caller, which
+ * bounds the time the server is blocked by a single call.
+ *
+ * 所有键被序列化为一个 RESTORE 命令流，一次性写入到目标节点，
+ * 之后按顺序读取回复，第 N 个回复确认第 N 个键。
+ * 整批回复读取完毕之后，在一次遍历中从源节点删除所有已确认的键，
+ * 并且以单个 DEL 命令传播。
+ * 迁移一个槽时，每一批键只需要一次往返，而不是每个键一次。
+ * 批的大小由调用者决定，从而限制了单次调用阻塞服务器的时间。 */
+void migrateCommand(redisClient *c) {
+    migrateCachedSocket *cs;
+    int copy = 0, replace = 0, j;
+    long long timeout;
+    long long dbid;
+    robj **ov = NULL; /* Objects to migrate. */
+    robj **kv = NULL; /* Key names. */
+    char *acked = NULL; /* Keys acknowledged by the target. */
+    rio cmd, payload;
+    int may_retry = 1;
+    int first_key = 3; /* Argument index of the first key. */
+    int num_keys = 1;  /* By default only migrate the 'key' argument. */
+    int select, replies, write_error, socket_error, error_from_target;
+    char buf1[1024]; /* Select reply. */
+    char buf2[1024]; /* Restore reply. */
+
+    /* Parse additional options */
+    for (j = 6; j < c->argc; j++) {
+        if (!strcasecmp(c->argv[j]->ptr,"copy")) {
+            copy = 1;
+        } else if (!strcasecmp(c->argv[j]->ptr,"replace")) {
+            replace = 1;
+        } else if (!strcasecmp(c->argv[j]->ptr,"keys")) {
+            if (sdslen(c->argv[3]->ptr) != 0) {
+                addReplyError(c,
+                    "When using MIGRATE KEYS option, the key argument"
+                    " must be set to the empty string");
+                return;
+            }
+            first_key = j+1;
+            num_keys = c->argc - j - 1;
+            break; /* All the remaining args are keys. */
+        } else {
+            addReply(c,shared.syntaxerr);
+            return;
+        }
+    }
+
+    /* Sanity check */
+    if (getLongLongFromObjectOrReply(c,c->argv[5],&timeout,NULL) != REDIS_OK ||
+        getLongLongFromObjectOrReply(c,c->argv[4],&dbid,NULL) != REDIS_OK)
+    {
+        return;
+    }
+    if (timeout <= 0) timeout = 1000;
+
+    /* Check if the keys are here. If at least one key is to migrate, do it
+     * otherwise if all the keys are missing reply with "NOKEY" to signal
+     * the caller there was nothing to migrate. We don't return an error in
+     * this case, since often this is due to a normal condition like the key
+     * expiring in the meantime.
+     *
+     * 只迁移存在的键，所有键都不存在时回复 NOKEY 。 */
+    ov = zmalloc(sizeof(robj*)*(num_keys ? num_keys : 1));
+    kv = zmalloc(sizeof(robj*)*(num_keys ? num_keys : 1));
+    for (j = 0, select = 0; j < num_keys; j++) {
+        if ((ov[select] = lookupKeyRead(c,c->argv[first_key+j])) != NULL) {
+            kv[select] = c->argv[first_key+j];
+            select++;
+        }
+    }
+    num_keys = select;
+    if (num_keys == 0) {
+        zfree(ov); zfree(kv);
+        addReplySds(c,sdsnew("+NOKEY\r\n"));
+        return;
+    }
+    acked = zmalloc(num_keys);
+
+try_again:
+    memset(acked,0,num_keys);
+    replies = write_error = socket_error = error_from_target = 0;
+
+    /* Connect */
+    cs = migrateGetSocket(c,c->argv[1],c->argv[2],timeout);
+    if (cs == NULL) {
+        zfree(ov); zfree(kv); zfree(acked);
+        return; /* error sent to the client by migrateGetSocket() */
+    }
+
+    rioInitWithBuffer(&cmd,sdsempty());
+
+    /* Send the SELECT command if the current DB is not already selected. */
+    // 只有连接当前的数据库不是 dbid 时才发送 SELECT
+    select = cs->last_dbid != dbid; /* Should we emit SELECT? */
+    if (select) {
+        redisAssertWithInfo(c,NULL,rioWriteBulkCount(&cmd,'*',2));
+        redisAssertWithInfo(c,NULL,rioWriteBulkString(&cmd,"SELECT",6));
+        redisAssertWithInfo(c,NULL,rioWriteBulkLongLong(&cmd,dbid));
+    }
+
+    /* Create RESTORE payload and generate the protocol to call the command. */
+    // 为每个键生成一个 RESTORE 命令，所有命令被写入同一个缓存中
+    for (j = 0; j < num_keys; j++) {
+        long long ttl = 0;
+        long long expireat = getExpire(c->db,kv[j]);
+
+        if (expireat != -1) {
+            ttl = expireat-mstime();
+            if (ttl < 1) ttl = 1;
+        }
+        redisAssertWithInfo(c,NULL,
+            rioWriteBulkCount(&cmd,'*',replace ? 5 : 4));
+        if (server.cluster_enabled)
+            redisAssertWithInfo(c,NULL,
+                rioWriteBulkString(&cmd,"RESTORE-ASKING",14));
+        else
+            redisAssertWithInfo(c,NULL,rioWriteBulkString(&cmd,"RESTORE",7));
+        redisAssertWithInfo(c,NULL,
+            rioWriteBulkString(&cmd,kv[j]->ptr,sdslen(kv[j]->ptr)));
+        redisAssertWithInfo(c,NULL,rioWriteBulkLongLong(&cmd,ttl));
+
+        /* Emit the payload argument, that is the serialized object using
+         * the DUMP format. */
+        createDumpPayload(&payload,ov[j]);
+        redisAssertWithInfo(c,NULL,
+            rioWriteBulkString(&cmd,payload.io.buffer.ptr,
+                               sdslen(payload.io.buffer.ptr)));
+        sdsfree(payload.io.buffer.ptr);
+
+        /* Add the REPLACE option to the RESTORE command if it was specified
+         * as a MIGRATE option. */
+        if (replace)
+            redisAssertWithInfo(c,NULL,rioWriteBulkString(&cmd,"REPLACE",7));
+    }
+
+    /* Transfer the query to the other node in 64K chunks. */
+    // 以 64 KB 为单位，将整个命令流写入到目标节点
+    errno = 0;
+    {
+        sds buf = cmd.io.buffer.ptr;
+        size_t pos = 0, towrite;
+        ssize_t nwritten = 0;
+
+        while ((towrite = sdslen(buf)-pos) > 0) {
+            towrite = (towrite > (64*1024) ? (64*1024) : towrite);
+            nwritten = syncWrite(cs->fd,buf+pos,towrite,timeout);
+            if (nwritten != (ssize_t)towrite) {
+                write_error = socket_error = 1;
+                goto read_done;
+            }
+            pos += nwritten;
+        }
+    }
+
+    /* Read the SELECT reply if needed. */
+    if (select) {
+        if (syncReadLine(cs->fd,buf1,sizeof(buf1),timeout) <= 0) {
+            socket_error = 1;
+            goto read_done;
+        }
+        replies++;
+        cs->last_dbid = (buf1[0] == '-') ? -1 : dbid;
+    }
+
+    /* Read the RESTORE replies: the Nth one acknowledges the Nth key. */
+    // 按顺序读取 RESTORE 的回复，第 N 个回复确认第 N 个键
+    for (j = 0; j < num_keys; j++) {
+        if (syncReadLine(cs->fd,buf2,sizeof(buf2),timeout) <= 0) {
+            socket_error = 1;
+            break;
+        }
+        replies++;
+        if ((select && buf1[0] == '-') || buf2[0] == '-') {
+            if (!error_from_target) {
+                addReplyErrorFormat(c,"Target instance replied with error: %s",
+                    (select && buf1[0] == '-') ? buf1+1 : buf2+1);
+                error_from_target = 1;
+            }
+        } else {
+            acked[j] = 1;
+        }
+    }
+
+read_done:
+    sdsfree(cmd.io.buffer.ptr);
+
+    if (socket_error) {
+        migrateCloseSocket(c->argv[1],c->argv[2]);
+
+        /* The cached connection may have been closed by the target in the
+         * meantime: retry once from scratch, unless it was a timeout or the
+         * target already replied to part of the stream.
+         *
+         * 缓存的连接可能已经被目标节点关闭，此时重试一次，
+         * 除非是超时，或者目标节点已经执行了部分命令。 */
+        if (errno != ETIMEDOUT && may_retry && replies == 0) {
+            may_retry = 0;
+            goto try_again;
+        }
+    }
+
+    /* Delete the acknowledged keys in one pass, and propagate them as a
+     * single DEL instead of the MIGRATE itself.
+     *
+     * 在一次遍历中删除所有已确认的键，并以单个 DEL 命令代替 MIGRATE 传播 */
+    if (!copy) {
+        robj **newargv = zmalloc(sizeof(robj*)*(num_keys+1));
+        int del_idx = 1;
+
+        for (j = 0; j < num_keys; j++) {
+            if (!acked[j] || !dbDelete(c->db,kv[j])) continue;
+            signalModifiedKey(c->db,kv[j]);
+            server.dirty++;
+            newargv[del_idx++] = kv[j];
+            incrRefCount(kv[j]);
+        }
+        if (del_idx > 1) {
+            newargv[0] = createStringObject("DEL",3);
+            replaceClientCommandVector(c,del_idx,newargv);
+        } else {
+            zfree(newargv);
+        }
+    }
+
+    if (!error_from_target) {
+        if (socket_error)
+            addReplySds(c,sdscatprintf(sdsempty(),
+                "-IOERR error or timeout %s to target instance\r\n",
+                write_error ? "writing" : "reading"));
+        else
+            addReply(c,shared.ok);
+    }
+    zfree(ov); zfree(kv); zfree(acked);
+}
+
+/* -----------------------------------------------------------------------------
+ * Cluster functions related to serving / redirecting clients
+ * -------------------------------------------------------------------------- */
+
+/* The ASKING command is required after a -ASK redirection.
+ * The client should issue ASKING before to actually send the command to
+ * the target instance. See the Redis Cluster specification for more
+ * information.
+ *
+ * 客户端收到 -ASK 重定向之后，在目标节点上执行命令之前要先发送 ASKING 。 */
+void askingCommand(redisClient *c) {
+    if (server.cluster_enabled == 0) {
+        addReplyError(c,"This instance has cluster support disabled");
+        return;
+    }
+    c->flags |= REDIS_ASKING;
+    addReply(c,shared.ok);
+}
+
+/* Return the pointer to the cluster node that is able to serve the command.
+ * For the function to succeed the command should only target a single
+ * hash slot: keys hashing to different slots are a -CROSSSLOT error.
+ *
+ * 返回能够执行命令的节点，命令的所有键必须在同一个槽中。
+ *
+ * If the returned node is not myself, or NULL, the reason is stored in
+ * '*error_code' (REDIS_CLUSTER_REDIR_*):
+ *
+ * 返回的节点不是 myself ，或者返回 NULL 时，原因被记录在 *error_code 中：
+ *
+ * MOVED: the slot is served by another node.
+ *        槽由另一个节点负责。
+ * ASK: the slot is migrating to another node and some key is not here.
+ *      槽正在迁移到另一个节点，并且有键不在当前节点。
+ * TRYAGAIN: a multi-key command in a slot being imported with keys that
+ *           are not all here yet.
+ *           正在导入的槽中的多键命令，并且不是所有的键都已经导入。
+ * CLUSTERDOWN: the slot is not assigned, or the cluster is down.
+ *              槽没有被指派，或者集群处于下线状态。
+ */
+clusterNode *getNodeByQuery(redisClient *c, struct redisCommand *cmd, robj **argv, int argc, int *hashslot, int *error_code) {
+    clusterNode *n = NULL;
+    robj *firstkey = NULL;
+    int multiple_keys = 0;
+    multiState *ms, _ms;
+    multiCmd mc;
+    int i, slot = 0, migrating_slot = 0, importing_slot = 0, missing_keys = 0;
+
+    if (error_code) *error_code = REDIS_CLUSTER_REDIR_NONE;
+
+    /* We handle all the cases as if they were EXEC commands, so we have
+     * a common code path for everything */
+    // 所有的命令都被当作 EXEC 处理，从而共用同一条代码路径
+    if (cmd->proc == execCommand) {
+        /* If REDIS_MULTI flag is not set EXEC is just going to return an
+         * error. */
+        if (!(c->flags & REDIS_MULTI)) return server.cluster->myself;
+        ms = &c->mstate;
+    } else {
+        /* In order to have a single codepath create a fake Multi State
+         * structure if the client is not in MULTI/EXEC state, this way
+         * we have a single codepath below. */
+        ms = &_ms;
+        _ms.commands = &mc;
+        _ms.count = 1;
+        mc.argv = argv;
+        mc.argc = argc;
+        mc.cmd = cmd;
+    }
+
+    /* Check that all the keys are in the same hash slot, and obtain this
+     * slot and the node associated. */
+    // 检查所有命令的所有键都在同一个槽中
+    for (i = 0; i < ms->count; i++) {
+        struct redisCommand *mcmd;
+        robj **margv;
+        int margc, *keyindex, numkeys, j;
+
+        mcmd = ms->commands[i].cmd;
+        margc = ms->commands[i].argc;
+        margv = ms->commands[i].argv;
+
+        keyindex = getKeysFromCommand(mcmd,margv,margc,&numkeys);
+        for (j = 0; j < numkeys; j++) {
+            robj *thiskey = margv[keyindex[j]];
+            int thisslot = keyHashSlot((char*)thiskey->ptr,
+                                       sdslen(thiskey->ptr));
+
+            if (firstkey == NULL) {
+                /* This is the first key we see. Check what is the slot
+                 * and node. */
+                firstkey = thiskey;
+                slot = thisslot;
+                n = server.cluster->slots[slot];
+
+                /* Error: If a slot is not served, we are in "cluster down"
+                 * state. However the state is yet to be updated, so this was
+                 * not trapped earlier in processCommand(). Report the same
+                 * error to the client. */
+                if (n == NULL) {
+                    getKeysFreeResult(keyindex);
+                    if (error_code)
+                        *error_code = REDIS_CLUSTER_REDIR_DOWN_UNBOUND;
+                    return NULL;
+                }
+
+                /* If we are migrating or importing this slot, we need to check
+                 * if we have all the keys in the request (the only way we
+                 * can safely serve the request, otherwise we return a TRYAGAIN
+                 * error). To do so we set the importing/migrating state and
+                 * increment a counter for every missing key. */
+                if (n == server.cluster->myself &&
+                    server.cluster->migrating_slots_to[slot] != NULL)
+                {
+                    migrating_slot = 1;
+                } else if (server.cluster->importing_slots_from[slot] != NULL) {
+                    importing_slot = 1;
+                }
+            } else {
+                /* If it is not the first key, make sure it is exactly
+                 * the same key as the first we saw. */
+                if (sdslen(firstkey->ptr) != sdslen(thiskey->ptr) ||
+                    memcmp(firstkey->ptr,thiskey->ptr,sdslen(thiskey->ptr)))
+                {
+                    if (slot != thisslot) {
+                        /* Error: multiple keys from different slots. */
+                        getKeysFreeResult(keyindex);
+                        if (error_code)
+                            *error_code = REDIS_CLUSTER_REDIR_CROSS_SLOT;
+                        return NULL;
+                    } else {
+                        /* Flag this request as one with multiple different
+                         * keys. */
+                        multiple_keys = 1;
+                    }
+                }
+            }
+
+            /* Migarting / Improrting slot? Count keys we don't have. */
+            if ((migrating_slot || importing_slot) &&
+                lookupKey(&server.db[0],thiskey) == NULL)
+            {
+                missing_keys++;
+            }
+        }
+        getKeysFreeResult(keyindex);
+    }
+
+    /* No key at all in command? then we can serve the request
+     * without redirections or errors. */
+    if (n == NULL) return server.cluster->myself;
+
+    /* Cluster is globally down but we got keys? We can't serve the request. */
+    if (server.cluster->state != REDIS_CLUSTER_OK) {
+        if (error_code) *error_code = REDIS_CLUSTER_REDIR_DOWN_STATE;
+        return NULL;
+    }
+
+    /* Return the hashslot by reference. */
+    if (hashslot) *hashslot = slot;
+
+    /* If we don't have all the keys and we are migrating the slot, send
+     * an ASK redirection. */
+    if (migrating_slot && missing_keys) {
+        if (error_code) *error_code = REDIS_CLUSTER_REDIR_ASK;
+        return server.cluster->migrating_slots_to[slot];
+    }
+
+    /* If we are receiving the slot, and the client correctly flagged the
+     * request as "ASKING", we can serve the request. However if the request
+     * involves multiple keys and we don't have them all, the only option is
+     * to send a TRYAGAIN error. */
+    if (importing_slot &&
+        (c->flags & REDIS_ASKING || cmd->flags & REDIS_CMD_ASKING))
+    {
+        if (multiple_keys && missing_keys) {
+            if (error_code) *error_code = REDIS_CLUSTER_REDIR_UNSTABLE;
+            return NULL;
+        } else {
+            return server.cluster->myself;
+        }
+    }
+
+    /* Base case: just return the right node. However if this node is not
+     * myself, set error_code to MOVED since we need to issue a rediretion. */
+    if (n != server.cluster->myself && error_code)
+        *error_code = REDIS_CLUSTER_REDIR_MOVED;
+    return n;
+}
+
+/* Send the client the right redirection code, according to error_code
+ * that should be set to one of REDIS_CLUSTER_REDIR_* macros.
+ *
+ * If REDIS_CLUSTER_REDIR_ASK or REDIS_CLUSTER_REDIR_MOVED error codes
+ * are used, then the node 'n' should not be NULL, but should be the
+ * node we want to mention in the redirection. Moreover hashslot should
+ * be set to the hash slot that caused the redirection.
+ *
+ * 根据 error_code 向客户端发送重定向或者错误 */
+void clusterRedirectClient(redisClient *c, clusterNode *n, int hashslot, int error_code) {
+    if (error_code == REDIS_CLUSTER_REDIR_CROSS_SLOT) {
+        addReplySds(c,sdsnew("-CROSSSLOT Keys in request don't hash to the same slot\r\n"));
+    } else if (error_code == REDIS_CLUSTER_REDIR_UNSTABLE) {
+        /* The request spawns mutliple keys in the same slot,
+         * but the slot is not "stable" currently as there is
+         * a migration or import in progress. */
+        addReplySds(c,sdsnew("-TRYAGAIN Multiple keys request during rehashing of slot\r\n"));
+    } else if (error_code == REDIS_CLUSTER_REDIR_DOWN_STATE) {
+        addReplySds(c,sdsnew("-CLUSTERDOWN The cluster is down\r\n"));
+    } else if (error_code == REDIS_CLUSTER_REDIR_DOWN_UNBOUND) {
+        addReplySds(c,sdsnew("-CLUSTERDOWN Hash slot not served\r\n"));
+    } else if (error_code == REDIS_CLUSTER_REDIR_MOVED ||
+               error_code == REDIS_CLUSTER_REDIR_ASK)
+    {
+        addReplySds(c,sdscatprintf(sdsempty(),
+            "-%s %d %s:%d\r\n",
+            (error_code == REDIS_CLUSTER_REDIR_ASK) ? "ASK" : "MOVED",
+            hashslot,n->ip,n->port));
+    } else {
+        redisPanic("getNodeByQuery() unknown error.");
+    }
+}
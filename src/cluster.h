@@ -0,0 +1,108 @@
+#ifndef __REDIS_CLUSTER_H
+#define __REDIS_CLUSTER_H
+
+/*-----------------------------------------------------------------------------
+ * Redis cluster data structures, defines, exported API.
+ *
+ * 集群的数据结构，宏定义，以及对外的 API
+ *----------------------------------------------------------------------------*/
+
+// 槽的数量
+#define REDIS_CLUSTER_SLOTS 16384
+
+// 集群状态
+#define REDIS_CLUSTER_OK 0          /* Everything looks ok */
+#define REDIS_CLUSTER_FAIL 1        /* The cluster can't work */
+
+// 节点名字的长度
+#define REDIS_CLUSTER_NAMELEN 40    /* sha1 hex length */
+
+// CLUSTER MEET 使用的同步连接的超时时间，以毫秒为单位
+#define REDIS_CLUSTER_MEET_TIMEOUT 1000
+
+/* Redirection errors returned by getNodeByQuery().
+ *
+ * getNodeByQuery() 返回的重定向错误 */
+#define REDIS_CLUSTER_REDIR_NONE 0          /* Node can serve the request. */
+#define REDIS_CLUSTER_REDIR_CROSS_SLOT 1    /* -CROSSSLOT request. */
+#define REDIS_CLUSTER_REDIR_UNSTABLE 2      /* -TRYAGAIN redirection required */
+#define REDIS_CLUSTER_REDIR_ASK 3           /* -ASK redirection required. */
+#define REDIS_CLUSTER_REDIR_MOVED 4         /* -MOVED redirection required. */
+#define REDIS_CLUSTER_REDIR_DOWN_STATE 5    /* -CLUSTERDOWN, global state. */
+#define REDIS_CLUSTER_REDIR_DOWN_UNBOUND 6  /* -CLUSTERDOWN, unbound slot. */
+
+// 节点标识
+#define REDIS_NODE_MYSELF 1     /* This node is myself */
+
+/*
+ * 集群中的一个节点
+ */
+typedef struct clusterNode {
+
+    // 节点的名字，由 40 个十六进制字符组成
+    char name[REDIS_CLUSTER_NAMELEN]; /* Node name, hex string, sha1-size */
+
+    // 节点标识
+    int flags;      /* REDIS_NODE_... */
+
+    // 节点负责处理的槽，每个槽占用一个二进制位
+    unsigned char slots[REDIS_CLUSTER_SLOTS/8]; /* slots handled by this node */
+
+    // 节点负责处理的槽数量
+    int numslots;   /* Number of slots handled by this node */
+
+    // 节点的 IP 地址和端口，客户端被重定向到这个地址
+    char ip[REDIS_IP_STR_LEN];  /* Latest known IP address of this node */
+    int port;                   /* Latest known port of this node */
+} clusterNode;
+
+/*
+ * 集群状态，每个节点都保存着一个这样的状态，记录了它眼中的集群的样子。
+ */
+typedef struct clusterState {
+
+    // 指向当前节点的指针
+    clusterNode *myself;  /* This node */
+
+    // 集群当前的状态：是在线还是下线
+    int state;            /* REDIS_CLUSTER_OK, REDIS_CLUSTER_FAIL, ... */
+
+    // 集群节点名单（包括 myself 节点）
+    // 字典的键为节点的名字，字典的值为 clusterNode 结构
+    dict *nodes;          /* Hash table of name -> clusterNode structures */
+
+    // 记录要从当前节点迁移到目标节点的槽，以及迁移的目标节点
+    // migrating_slots_to[i] = NULL 表示槽 i 未被迁移
+    clusterNode *migrating_slots_to[REDIS_CLUSTER_SLOTS];
+
+    // 记录要从源节点迁移到本节点的槽，以及进行迁移的源节点
+    // importing_slots_from[i] = NULL 表示槽 i 未进行导入
+    clusterNode *importing_slots_from[REDIS_CLUSTER_SLOTS];
+
+    // 负责处理各个槽的节点，slots[i] = NULL 表示槽 i 未指派
+    clusterNode *slots[REDIS_CLUSTER_SLOTS];
+
+    /* The keys of DB 0 grouped by hash slot, so that a slot can be counted
+     * and migrated without scanning the whole keyspace. The dicts share the
+     * key sds strings with the keyspace and are created on demand. */
+    // 按槽分组的 0 号数据库的键，迁移槽时不需要扫描整个键空间。
+    // 字典和键空间共用键的 sds ，在槽中第一次添加键时创建。
+    dict *slots_to_keys[REDIS_CLUSTER_SLOTS];
+
+    // 每个槽中的键数量
+    unsigned int slots_keys_count[REDIS_CLUSTER_SLOTS];
+} clusterState;
+
+/* ---------------------- API exported outside cluster.c -------------------- */
+void clusterInit(void);
+unsigned int keyHashSlot(char *key, int keylen);
+void slotToKeyAdd(sds key);
+void slotToKeyDel(sds key);
+void slotToKeyFlush(void);
+unsigned int countKeysInSlot(unsigned int hashslot);
+unsigned int getKeysInSlot(unsigned int hashslot, robj **keys, unsigned int count);
+clusterNode *getNodeByQuery(redisClient *c, struct redisCommand *cmd, robj **argv, int argc, int *hashslot, int *ask);
+void clusterRedirectClient(redisClient *c, clusterNode *n, int hashslot, int error_code);
+void migrateCloseTimedoutSockets(void);
+
+#endif /* __REDIS_CLUSTER_H */
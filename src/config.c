@@ -0,0 +1,745 @@
+/* Configuration file parsing.
+ *
+ * 配置文件的解析
+ */
+#include "redis.h"
+
+#include <stdint.h>
+
+/*-----------------------------------------------------------------------------
+ * Config file name-value maps.
+ *----------------------------------------------------------------------------*/
+
+typedef struct configEnum {
+    const char *name;
+    const int val;
+} configEnum;
+
+// 日志等级
+configEnum loglevel_enum[] = {
+    {"debug", REDIS_DEBUG},
+    {"verbose", REDIS_VERBOSE},
+    {"notice", REDIS_NOTICE},
+    {"warning", REDIS_WARNING},
+    {NULL, 0}
+};
+
+// 内存淘汰策略
+configEnum maxmemory_policy_enum[] = {
+    {"volatile-lru", MAXMEMORY_VOLATILE_LRU},
+    {"volatile-lfu", MAXMEMORY_VOLATILE_LFU},
+    {"volatile-random",MAXMEMORY_VOLATILE_RANDOM},
+    {"volatile-ttl",MAXMEMORY_VOLATILE_TTL},
+    {"allkeys-lru",MAXMEMORY_ALLKEYS_LRU},
+    {"allkeys-lfu",MAXMEMORY_ALLKEYS_LFU},
+    {"allkeys-random",MAXMEMORY_ALLKEYS_RANDOM},
+    {"noeviction",MAXMEMORY_NO_EVICTION},
+    {NULL, 0}
+};
+
+// AOF fsync 策略
+configEnum aof_fsync_enum[] = {
+    {"everysec", AOF_FSYNC_EVERYSEC},
+    {"always", AOF_FSYNC_ALWAYS},
+    {"no", AOF_FSYNC_NO},
+    {NULL, 0}
+};
+
+// 从服务器载入全量同步数据的方式
+configEnum repl_diskless_load_enum[] = {
+    {"disabled", REPL_DISKLESS_LOAD_DISABLED},
+    {"swapdb", REPL_DISKLESS_LOAD_SWAPDB},
+    {NULL, 0}
+};
+
+/* Get enum value from name. If there is no match INT_MIN is returned. */
+int configEnumGetValue(configEnum *ce, char *name) {
+    while(ce->name != NULL) {
+        if (!strcasecmp(ce->name,name)) return ce->val;
+        ce++;
+    }
+    return INT_MIN;
+}
+
+/* Get enum name from value. If no match is found NULL is returned. */
+const char *configEnumGetName(configEnum *ce, int val) {
+    while(ce->name != NULL) {
+        if (ce->val == val) return ce->name;
+        ce++;
+    }
+    return NULL;
+}
+
+/* Wrapper for configEnumGetName() returning "unknown" insetad of NULL if
+ * there is no match. */
+const char *configEnumGetNameOrUnknown(configEnum *ce, int val) {
+    const char *name = configEnumGetName(ce,val);
+    return name ? name : "unknown";
+}
+
+/* Used for INFO generation. */
+// 返回当前内存淘汰策略的名字
+const char *evictPolicyToString(void) {
+    return configEnumGetNameOrUnknown(maxmemory_policy_enum,server.maxmemory_policy);
+}
+
+// 返回当前 AOF fsync 策略的名字
+const char *aofFsyncPolicyToString(void) {
+    return configEnumGetNameOrUnknown(aof_fsync_enum,server.aof_fsync);
+}
+
+/*-----------------------------------------------------------------------------
+ * Config file parsing
+ *----------------------------------------------------------------------------*/
+
+/*
+ * 将 yes/no 转换为 1/0 ，其他输入返回 -1
+ */
+int yesnotoi(char *s) {
+    if (!strcasecmp(s,"yes")) return 1;
+    else if (!strcasecmp(s,"no")) return 0;
+    else return -1;
+}
+
+/*
+ * 添加一个 RDB 保存条件：seconds 秒之内至少发生 changes 次修改
+ */
+void appendServerSaveParams(time_t seconds, int changes) {
+    server.saveparams = zrealloc(server.saveparams,sizeof(struct saveparam)*(server.saveparamslen+1));
+    server.saveparams[server.saveparamslen].seconds = seconds;
+    server.saveparams[server.saveparamslen].changes = changes;
+    server.saveparamslen++;
+}
+
+/*
+ * 清空所有 RDB 保存条件
+ */
+void resetServerSaveParams(void) {
+    zfree(server.saveparams);
+    server.saveparams = NULL;
+    server.saveparamslen = 0;
+}
+
+/*
+ * 解析配置字符串 config ，每行一个选项：<选项名> <参数> ...
+ *
+ * Every error is fatal: the offending line is reported and the server
+ * exits, as a server running with a half applied configuration is worse
+ * than a server that does not start.
+ */
+void loadServerConfigFromString(char *config) {
+    char *err = NULL;
+    int linenum = 0, totlines, i;
+    int save_loaded = 0;
+    sds *lines;
+
+    // 按行分割
+    lines = sdssplitlen(config,strlen(config),"\n",1,&totlines);
+
+    for (i = 0; i < totlines; i++) {
+        sds *argv;
+        int argc;
+
+        linenum = i+1;
+        lines[i] = sdstrim(lines[i]," \t\r\n");
+
+        /* Skip comments and blank lines */
+        // 跳过注释和空行
+        if (lines[i][0] == '#' || lines[i][0] == '\0') continue;
+
+        /* Split into arguments */
+        argv = sdssplitargs(lines[i],&argc);
+        if (argv == NULL) {
+            err = "Unbalanced quotes in configuration line";
+            goto loaderr;
+        }
+
+        /* Skip this line if the resulting command vector is empty. */
+        if (argc == 0) {
+            sdsfreesplitres(argv,argc);
+            continue;
+        }
+        sdstolower(argv[0]);
+
+        /* Execute config directives */
+        if (!strcasecmp(argv[0],"port") && argc == 2) {
+            server.port = atoi(argv[1]);
+            if (server.port < 0 || server.port > 65535) {
+                err = "Invalid port"; goto loaderr;
+            }
+        } else if (!strcasecmp(argv[0],"hz") && argc == 2) {
+            server.hz = atoi(argv[1]);
+            if (server.hz < REDIS_MIN_HZ) server.hz = REDIS_MIN_HZ;
+            if (server.hz > REDIS_MAX_HZ) server.hz = REDIS_MAX_HZ;
+        } else if (!strcasecmp(argv[0],"databases") && argc == 2) {
+            server.dbnum = atoi(argv[1]);
+            if (server.dbnum < 1) {
+                err = "Invalid number of databases"; goto loaderr;
+            }
+        } else if (!strcasecmp(argv[0],"maxclients") && argc == 2) {
+            server.maxclients = atoi(argv[1]);
+            if (server.maxclients < 1) {
+                err = "Invalid max clients limit"; goto loaderr;
+            }
+        } else if (!strcasecmp(argv[0],"loglevel") && argc == 2) {
+            server.verbosity = configEnumGetValue(loglevel_enum,argv[1]);
+            if (server.verbosity == INT_MIN) {
+                err = "Invalid log level. "
+                      "Must be one of debug, verbose, notice, warning";
+                goto loaderr;
+            }
+        } else if (!strcasecmp(argv[0],"maxmemory") && argc == 2) {
+            server.maxmemory = memtoll(argv[1],NULL);
+        } else if (!strcasecmp(argv[0],"maxmemory-policy") && argc == 2) {
+            server.maxmemory_policy =
+                configEnumGetValue(maxmemory_policy_enum,argv[1]);
+            if (server.maxmemory_policy == INT_MIN) {
+                err = "Invalid maxmemory policy";
+                goto loaderr;
+            }
+        } else if (!strcasecmp(argv[0],"maxmemory-samples") && argc == 2) {
+            server.maxmemory_samples = atoi(argv[1]);
+            if (server.maxmemory_samples <= 0) {
+                err = "maxmemory-samples must be 1 or greater";
+                goto loaderr;
+            }
+        } else if (!strcasecmp(argv[0],"tracking-table-max-keys") &&
+                   argc == 2)
+        {
+            server.tracking_table_max_keys = strtoll(argv[1],NULL,10);
+            if (server.tracking_table_max_keys < 0) {
+                err = "tracking-table-max-keys must be 0 or greater";
+                goto loaderr;
+            }
+        } else if (!strcasecmp(argv[0],"lfu-log-factor") && argc == 2) {
+            server.lfu_log_factor = atoi(argv[1]);
+            if (server.lfu_log_factor < 0) {
+                err = "lfu-log-factor must be 0 or greater";
+                goto loaderr;
+            }
+        } else if (!strcasecmp(argv[0],"lfu-decay-time") && argc == 2) {
+            server.lfu_decay_time = atoi(argv[1]);
+            if (server.lfu_decay_time < 0) {
+                err = "lfu-decay-time must be 0 or greater";
+                goto loaderr;
+            }
+        } else if (!strcasecmp(argv[0],"lazyfree-lazy-expire") && argc == 2) {
+            if ((server.lazyfree_lazy_expire = yesnotoi(argv[1])) == -1) {
+                err = "argument must be 'yes' or 'no'"; goto loaderr;
+            }
+        } else if (!strcasecmp(argv[0],"lazyfree-lazy-server-del") && argc == 2) {
+            if ((server.lazyfree_lazy_server_del = yesnotoi(argv[1])) == -1) {
+                err = "argument must be 'yes' or 'no'"; goto loaderr;
+            }
+        } else if (!strcasecmp(argv[0],"lazyfree-lazy-user-del") && argc == 2) {
+            if ((server.lazyfree_lazy_user_del = yesnotoi(argv[1])) == -1) {
+                err = "argument must be 'yes' or 'no'"; goto loaderr;
+            }
+        } else if (!strcasecmp(argv[0],"save")) {
+            /* The first "save" directive replaces the default save points
+             * instead of adding to them. */
+            // 第一个 save 选项会清除默认的保存条件
+            if (!save_loaded) {
+                save_loaded = 1;
+                resetServerSaveParams();
+            }
+            if (argc == 3) {
+                int seconds = atoi(argv[1]);
+                int changes = atoi(argv[2]);
+                if (seconds < 1 || changes < 0) {
+                    err = "Invalid save parameters"; goto loaderr;
+                }
+                appendServerSaveParams(seconds,changes);
+            } else if (argc != 2 || argv[1][0] != '\0') {
+                err = "Invalid save parameters"; goto loaderr;
+            }
+        } else if (!strcasecmp(argv[0],"dir") && argc == 2) {
+            if (chdir(argv[1]) == -1) {
+                redisLog(REDIS_WARNING,"Can't chdir to '%s': %s",
+                    argv[1], strerror(errno));
+                exit(1);
+            }
+        } else if (!strcasecmp(argv[0],"dbfilename") && argc == 2) {
+            if (strchr(argv[1],'/') != NULL) {
+                err = "dbfilename can't be a path, just a filename";
+                goto loaderr;
+            }
+            zfree(server.rdb_filename);
+            server.rdb_filename = zstrdup(argv[1]);
+        } else if (!strcasecmp(argv[0],"rdbchecksum") && argc == 2) {
+            if ((server.rdb_checksum = yesnotoi(argv[1])) == -1) {
+                err = "argument must be 'yes' or 'no'"; goto loaderr;
+            }
+        } else if (!strcasecmp(argv[0],"rdb-load-threads") && argc == 2) {
+            server.rdb_load_threads = atoi(argv[1]);
+            if (server.rdb_load_threads < 0 ||
+                server.rdb_load_threads > REDIS_RDB_LOAD_THREADS_MAX)
+            {
+                err = "Invalid number of RDB loader threads"; goto loaderr;
+            }
+        } else if (!strcasecmp(argv[0],"appendonly") && argc == 2) {
+            int yes;
+
+            if ((yes = yesnotoi(argv[1])) == -1) {
+                err = "argument must be 'yes' or 'no'"; goto loaderr;
+            }
+            server.aof_state = yes ? REDIS_AOF_ON : REDIS_AOF_OFF;
+        } else if (!strcasecmp(argv[0],"appendfilename") && argc == 2) {
+            if (strchr(argv[1],'/') != NULL) {
+                err = "appendfilename can't be a path, just a filename";
+                goto loaderr;
+            }
+            zfree(server.aof_filename);
+            server.aof_filename = zstrdup(argv[1]);
+        } else if (!strcasecmp(argv[0],"appendfsync") && argc == 2) {
+            server.aof_fsync = configEnumGetValue(aof_fsync_enum,argv[1]);
+            if (server.aof_fsync == INT_MIN) {
+                err = "argument must be 'no', 'always' or 'everysec'";
+                goto loaderr;
+            }
+        } else if (!strcasecmp(argv[0],"aof-load-truncated") && argc == 2) {
+            if ((server.aof_load_truncated = yesnotoi(argv[1])) == -1) {
+                err = "argument must be 'yes' or 'no'"; goto loaderr;
+            }
+        } else if (!strcasecmp(argv[0],"auto-aof-rewrite-percentage") &&
+                   argc == 2)
+        {
+            server.aof_rewrite_perc = atoi(argv[1]);
+            if (server.aof_rewrite_perc < 0) {
+                err = "Invalid negative percentage for AOF auto rewrite";
+                goto loaderr;
+            }
+        } else if (!strcasecmp(argv[0],"auto-aof-rewrite-min-size") &&
+                   argc == 2)
+        {
+            server.aof_rewrite_min_size = memtoll(argv[1],NULL);
+        } else if ((!strcasecmp(argv[0],"replicaof") ||
+                    !strcasecmp(argv[0],"slaveof")) && argc == 3) {
+            server.masterhost = sdsnew(argv[1]);
+            server.masterport = atoi(argv[2]);
+            server.repl_state = REDIS_REPL_CONNECT;
+        } else if (!strcasecmp(argv[0],"repl-backlog-size") && argc == 2) {
+            long long size = memtoll(argv[1],NULL);
+            if (size <= 0) {
+                err = "repl-backlog-size must be 1 or greater.";
+                goto loaderr;
+            }
+            resizeReplicationBacklog(size);
+        } else if (!strcasecmp(argv[0],"repl-timeout") && argc == 2) {
+            server.repl_timeout = atoi(argv[1]);
+            if (server.repl_timeout <= 0) {
+                err = "repl-timeout must be 1 or greater";
+                goto loaderr;
+            }
+        } else if (!strcasecmp(argv[0],"repl-ping-replica-period") &&
+                   argc == 2) {
+            server.repl_ping_slave_period = atoi(argv[1]);
+            if (server.repl_ping_slave_period <= 0) {
+                err = "repl-ping-replica-period must be 1 or greater";
+                goto loaderr;
+            }
+        } else if (!strcasecmp(argv[0],"replica-read-only") && argc == 2) {
+            if ((server.repl_slave_ro = yesnotoi(argv[1])) == -1) {
+                err = "argument must be 'yes' or 'no'"; goto loaderr;
+            }
+        } else if (!strcasecmp(argv[0],"repl-diskless-load") && argc == 2) {
+            server.repl_diskless_load =
+                configEnumGetValue(repl_diskless_load_enum,argv[1]);
+            if (server.repl_diskless_load == INT_MIN) {
+                err = "argument must be 'disabled' or 'swapdb'";
+                goto loaderr;
+            }
+        } else if (!strcasecmp(argv[0],"cluster-enabled") && argc == 2) {
+            if ((server.cluster_enabled = yesnotoi(argv[1])) == -1) {
+                err = "argument must be 'yes' or 'no'"; goto loaderr;
+            }
+        } else if (!strcasecmp(argv[0],"stop-writes-on-bgsave-error") &&
+                   argc == 2) {
+            if ((server.stop_writes_on_bgsave_err = yesnotoi(argv[1])) == -1) {
+                err = "argument must be 'yes' or 'no'"; goto loaderr;
+            }
+        } else if (!strcasecmp(argv[0],"shared-bulkhdr-len") && argc == 2) {
+            server.shared_bulkhdr_len = atoi(argv[1]);
+            if (server.shared_bulkhdr_len < 1 ||
+                server.shared_bulkhdr_len > REDIS_SHARED_BULKHDR_MAX_LEN)
+            {
+                err = "Invalid shared-bulkhdr-len"; goto loaderr;
+            }
+        } else {
+            err = "Bad directive or wrong number of arguments"; goto loaderr;
+        }
+        sdsfreesplitres(argv,argc);
+    }
+
+    sdsfreesplitres(lines,totlines);
+    return;
+
+loaderr:
+    fprintf(stderr, "\n*** FATAL CONFIG FILE ERROR ***\n");
+    fprintf(stderr, "Reading the configuration file, at line %d\n", linenum);
+    fprintf(stderr, ">>> '%s'\n", lines[i]);
+    fprintf(stderr, "%s\n", err);
+    exit(1);
+}
+
+/* Load the server configuration from the specified filename.
+ * The function appends the additional configuration directives stored
+ * in the 'options' string to the config file before loading.
+ *
+ * 从给定文件中载入服务器配置，
+ * options 中的选项（来自命令行）追加在文件内容之后，因此会覆盖文件中的设置。
+ *
+ * Both filename and options can be NULL, in such a case are considered
+ * empty. This way loadServerConfig can be used to just load a file or
+ * just load a string. */
+void loadServerConfig(char *filename, char *options) {
+    sds config = sdsempty();
+    char buf[REDIS_CONFIGLINE_MAX+1];
+
+    /* Load the file content */
+    if (filename) {
+        FILE *fp;
+
+        if (filename[0] == '-' && filename[1] == '\0') {
+            fp = stdin;
+        } else {
+            if ((fp = fopen(filename,"r")) == NULL) {
+                redisLog(REDIS_WARNING,
+                    "Fatal error, can't open config file '%s'", filename);
+                exit(1);
+            }
+        }
+        while(fgets(buf,REDIS_CONFIGLINE_MAX+1,fp) != NULL)
+            config = sdscat(config,buf);
+        if (fp != stdin) fclose(fp);
+    }
+
+    /* Append the additional options */
+    if (options) {
+        config = sdscat(config,"\n");
+        config = sdscat(config,options);
+    }
+    loadServerConfigFromString(config);
+    sdsfree(config);
+}
+
+/*-----------------------------------------------------------------------------
+ * CONFIG SET implementation
+ *----------------------------------------------------------------------------*/
+
+/*
+ * CONFIG SET <parameter> <value>
+ *
+ * 在运行时修改配置选项，目前只支持内存相关的选项
+ */
+void configSetCommand(redisClient *c) {
+    robj *o;
+    long long ll;
+    int err;
+
+    redisAssertWithInfo(c,c->argv[2],sdsEncodedObject(c->argv[2]));
+    redisAssertWithInfo(c,c->argv[3],sdsEncodedObject(c->argv[3]));
+    o = c->argv[3];
+
+    if (!strcasecmp(c->argv[2]->ptr,"maxmemory")) {
+        ll = memtoll(o->ptr,&err);
+        if (err || ll < 0) goto badfmt;
+        server.maxmemory = ll;
+        // 新的上限比当前内存使用少时，立即开始淘汰
+        if (server.maxmemory) {
+            if (server.maxmemory < zmalloc_used_memory()) {
+                redisLog(REDIS_WARNING,"WARNING: the new maxmemory value set via CONFIG SET is smaller than the current memory usage. This will result in keys eviction and/or inability to accept new write commands depending on the maxmemory-policy.");
+            }
+            freeMemoryIfNeeded();
+        }
+    } else if (!strcasecmp(c->argv[2]->ptr,"maxmemory-policy")) {
+        int policy = configEnumGetValue(maxmemory_policy_enum,o->ptr);
+        if (policy == INT_MIN) goto badfmt;
+        server.maxmemory_policy = policy;
+    } else if (!strcasecmp(c->argv[2]->ptr,"maxmemory-samples")) {
+        if (getLongLongFromObject(o,&ll) == REDIS_ERR ||
+            ll <= 0 || ll > INT_MAX) goto badfmt;
+        server.maxmemory_samples = ll;
+    } else if (!strcasecmp(c->argv[2]->ptr,"tracking-table-max-keys")) {
+        if (getLongLongFromObject(o,&ll) == REDIS_ERR || ll < 0) goto badfmt;
+        server.tracking_table_max_keys = ll;
+    } else if (!strcasecmp(c->argv[2]->ptr,"lfu-log-factor")) {
+        if (getLongLongFromObject(o,&ll) == REDIS_ERR ||
+            ll < 0 || ll > INT_MAX) goto badfmt;
+        server.lfu_log_factor = ll;
+    } else if (!strcasecmp(c->argv[2]->ptr,"lfu-decay-time")) {
+        if (getLongLongFromObject(o,&ll) == REDIS_ERR ||
+            ll < 0 || ll > INT_MAX) goto badfmt;
+        server.lfu_decay_time = ll;
+    } else if (!strcasecmp(c->argv[2]->ptr,"lazyfree-lazy-expire")) {
+        int yn = yesnotoi(o->ptr);
+        if (yn == -1) goto badfmt;
+        server.lazyfree_lazy_expire = yn;
+    } else if (!strcasecmp(c->argv[2]->ptr,"lazyfree-lazy-server-del")) {
+        int yn = yesnotoi(o->ptr);
+        if (yn == -1) goto badfmt;
+        server.lazyfree_lazy_server_del = yn;
+    } else if (!strcasecmp(c->argv[2]->ptr,"lazyfree-lazy-user-del")) {
+        int yn = yesnotoi(o->ptr);
+        if (yn == -1) goto badfmt;
+        server.lazyfree_lazy_user_del = yn;
+    } else if (!strcasecmp(c->argv[2]->ptr,"save")) {
+        int vlen, j;
+        sds *v = sdssplitlen(o->ptr,sdslen(o->ptr)," ",1,&vlen);
+
+        /* Perform sanity check before setting the new config:
+         * - Even number of args
+         * - Seconds >= 1, changes >= 0 */
+        // 先检查所有参数，全部合法之后才替换原来的保存条件
+        if (vlen & 1) {
+            sdsfreesplitres(v,vlen);
+            goto badfmt;
+        }
+        for (j = 0; j < vlen; j++) {
+            char *eptr;
+            long val;
+
+            val = strtoll(v[j], &eptr, 10);
+            if (eptr[0] != '\0' ||
+                ((j & 1) == 0 && val < 1) ||
+                ((j & 1) == 1 && val < 0)) {
+                sdsfreesplitres(v,vlen);
+                goto badfmt;
+            }
+        }
+
+        /* Finally set the new config */
+        resetServerSaveParams();
+        for (j = 0; j < vlen; j += 2) {
+            time_t seconds;
+            int changes;
+
+            seconds = strtoll(v[j],NULL,10);
+            changes = strtoll(v[j+1],NULL,10);
+            appendServerSaveParams(seconds, changes);
+        }
+        sdsfreesplitres(v,vlen);
+    } else if (!strcasecmp(c->argv[2]->ptr,"dir")) {
+        if (chdir((char*)o->ptr) == -1) {
+            addReplyErrorFormat(c,"Changing directory: %s", strerror(errno));
+            return;
+        }
+    } else if (!strcasecmp(c->argv[2]->ptr,"dbfilename")) {
+        if (strchr(o->ptr,'/') != NULL) {
+            addReplyError(c,"dbfilename can't be a path, just a filename");
+            return;
+        }
+        zfree(server.rdb_filename);
+        server.rdb_filename = zstrdup(o->ptr);
+    } else if (!strcasecmp(c->argv[2]->ptr,"rdbchecksum")) {
+        int yn = yesnotoi(o->ptr);
+        if (yn == -1) goto badfmt;
+        server.rdb_checksum = yn;
+    } else if (!strcasecmp(c->argv[2]->ptr,"rdb-load-threads")) {
+        if (getLongLongFromObject(o,&ll) == REDIS_ERR ||
+            ll < 0 || ll > REDIS_RDB_LOAD_THREADS_MAX) goto badfmt;
+        server.rdb_load_threads = ll;
+    } else if (!strcasecmp(c->argv[2]->ptr,"appendonly")) {
+        int enable = yesnotoi(o->ptr);
+
+        if (enable == -1) goto badfmt;
+        // 关闭 AOF 或者打开 AOF
+        if (enable == 0 && server.aof_state != REDIS_AOF_OFF) {
+            stopAppendOnly();
+        } else if (enable && server.aof_state == REDIS_AOF_OFF) {
+            if (startAppendOnly() == REDIS_ERR) {
+                addReplyError(c,
+                    "Unable to turn on AOF. Check server logs.");
+                return;
+            }
+        }
+    } else if (!strcasecmp(c->argv[2]->ptr,"appendfsync")) {
+        int policy = configEnumGetValue(aof_fsync_enum,o->ptr);
+        if (policy == INT_MIN) goto badfmt;
+        server.aof_fsync = policy;
+    } else if (!strcasecmp(c->argv[2]->ptr,"aof-load-truncated")) {
+        int yn = yesnotoi(o->ptr);
+        if (yn == -1) goto badfmt;
+        server.aof_load_truncated = yn;
+    } else if (!strcasecmp(c->argv[2]->ptr,"auto-aof-rewrite-percentage")) {
+        if (getLongLongFromObject(o,&ll) == REDIS_ERR ||
+            ll < 0 || ll > INT_MAX) goto badfmt;
+        server.aof_rewrite_perc = ll;
+    } else if (!strcasecmp(c->argv[2]->ptr,"auto-aof-rewrite-min-size")) {
+        ll = memtoll(o->ptr,&err);
+        if (err || ll < 0) goto badfmt;
+        server.aof_rewrite_min_size = ll;
+    } else if (!strcasecmp(c->argv[2]->ptr,"repl-backlog-size")) {
+        ll = memtoll(o->ptr,&err);
+        if (err || ll <= 0) goto badfmt;
+        resizeReplicationBacklog(ll);
+    } else if (!strcasecmp(c->argv[2]->ptr,"repl-timeout")) {
+        if (getLongLongFromObject(o,&ll) == REDIS_ERR ||
+            ll <= 0 || ll > INT_MAX) goto badfmt;
+        server.repl_timeout = ll;
+    } else if (!strcasecmp(c->argv[2]->ptr,"repl-ping-replica-period")) {
+        if (getLongLongFromObject(o,&ll) == REDIS_ERR ||
+            ll <= 0 || ll > INT_MAX) goto badfmt;
+        server.repl_ping_slave_period = ll;
+    } else if (!strcasecmp(c->argv[2]->ptr,"replica-read-only")) {
+        int yn = yesnotoi(o->ptr);
+        if (yn == -1) goto badfmt;
+        server.repl_slave_ro = yn;
+    } else if (!strcasecmp(c->argv[2]->ptr,"repl-diskless-load")) {
+        int mode = configEnumGetValue(repl_diskless_load_enum,o->ptr);
+        if (mode == INT_MIN) goto badfmt;
+        server.repl_diskless_load = mode;
+    } else if (!strcasecmp(c->argv[2]->ptr,"stop-writes-on-bgsave-error")) {
+        int yn = yesnotoi(o->ptr);
+        if (yn == -1) goto badfmt;
+        server.stop_writes_on_bgsave_err = yn;
+    } else {
+        addReplyErrorFormat(c,"Unsupported CONFIG parameter: %s",
+            (char*)c->argv[2]->ptr);
+        return;
+    }
+    addReply(c,shared.ok);
+    return;
+
+badfmt: /* Bad format errors */
+    addReplyErrorFormat(c,"Invalid argument '%s' for CONFIG SET '%s'",
+            (char*)o->ptr,
+            (char*)c->argv[2]->ptr);
+}
+
+/*-----------------------------------------------------------------------------
+ * CONFIG GET implementation
+ *----------------------------------------------------------------------------*/
+
+/*
+ * CONFIG GET <parameter>
+ *
+ * 参数名必须完整给出（不支持通配符），返回 [参数名, 值] 两个元素
+ */
+void configGetCommand(redisClient *c) {
+    char *name = c->argv[2]->ptr;
+    char buf[PATH_MAX];
+    const char *value = NULL;
+
+    if (!strcasecmp(name,"maxmemory")) {
+        ll2string(buf,sizeof(buf),server.maxmemory);
+        value = buf;
+    } else if (!strcasecmp(name,"maxmemory-policy")) {
+        value = evictPolicyToString();
+    } else if (!strcasecmp(name,"maxmemory-samples")) {
+        ll2string(buf,sizeof(buf),server.maxmemory_samples);
+        value = buf;
+    } else if (!strcasecmp(name,"tracking-table-max-keys")) {
+        ll2string(buf,sizeof(buf),server.tracking_table_max_keys);
+        value = buf;
+    } else if (!strcasecmp(name,"lfu-log-factor")) {
+        ll2string(buf,sizeof(buf),server.lfu_log_factor);
+        value = buf;
+    } else if (!strcasecmp(name,"lfu-decay-time")) {
+        ll2string(buf,sizeof(buf),server.lfu_decay_time);
+        value = buf;
+    } else if (!strcasecmp(name,"lazyfree-lazy-expire")) {
+        value = server.lazyfree_lazy_expire ? "yes" : "no";
+    } else if (!strcasecmp(name,"lazyfree-lazy-server-del")) {
+        value = server.lazyfree_lazy_server_del ? "yes" : "no";
+    } else if (!strcasecmp(name,"lazyfree-lazy-user-del")) {
+        value = server.lazyfree_lazy_user_del ? "yes" : "no";
+    } else if (!strcasecmp(name,"dir")) {
+        if (getcwd(buf,sizeof(buf)) == NULL) buf[0] = '\0';
+        value = buf;
+    } else if (!strcasecmp(name,"dbfilename")) {
+        value = server.rdb_filename;
+    } else if (!strcasecmp(name,"rdbchecksum")) {
+        value = server.rdb_checksum ? "yes" : "no";
+    } else if (!strcasecmp(name,"rdb-load-threads")) {
+        ll2string(buf,sizeof(buf),server.rdb_load_threads);
+        value = buf;
+    } else if (!strcasecmp(name,"appendonly")) {
+        value = server.aof_state == REDIS_AOF_OFF ? "no" : "yes";
+    } else if (!strcasecmp(name,"appendfilename")) {
+        value = server.aof_filename;
+    } else if (!strcasecmp(name,"appendfsync")) {
+        value = aofFsyncPolicyToString();
+    } else if (!strcasecmp(name,"aof-load-truncated")) {
+        value = server.aof_load_truncated ? "yes" : "no";
+    } else if (!strcasecmp(name,"auto-aof-rewrite-percentage")) {
+        ll2string(buf,sizeof(buf),server.aof_rewrite_perc);
+        value = buf;
+    } else if (!strcasecmp(name,"auto-aof-rewrite-min-size")) {
+        ll2string(buf,sizeof(buf),server.aof_rewrite_min_size);
+        value = buf;
+    } else if (!strcasecmp(name,"replicaof")) {
+        if (server.masterhost) {
+            snprintf(buf,sizeof(buf),"%s %d",
+                server.masterhost,server.masterport);
+            value = buf;
+        } else {
+            value = "";
+        }
+    } else if (!strcasecmp(name,"repl-backlog-size")) {
+        ll2string(buf,sizeof(buf),server.repl_backlog_size);
+        value = buf;
+    } else if (!strcasecmp(name,"repl-timeout")) {
+        ll2string(buf,sizeof(buf),server.repl_timeout);
+        value = buf;
+    } else if (!strcasecmp(name,"repl-ping-replica-period")) {
+        ll2string(buf,sizeof(buf),server.repl_ping_slave_period);
+        value = buf;
+    } else if (!strcasecmp(name,"replica-read-only")) {
+        value = server.repl_slave_ro ? "yes" : "no";
+    } else if (!strcasecmp(name,"repl-diskless-load")) {
+        value = configEnumGetNameOrUnknown(repl_diskless_load_enum,
+                                           server.repl_diskless_load);
+    } else if (!strcasecmp(name,"cluster-enabled")) {
+        value = server.cluster_enabled ? "yes" : "no";
+    } else if (!strcasecmp(name,"stop-writes-on-bgsave-error")) {
+        value = server.stop_writes_on_bgsave_err ? "yes" : "no";
+    } else if (!strcasecmp(name,"save")) {
+        // 保存条件的数量不定，格式为 "<seconds> <changes> ..."
+        sds sp = sdsempty();
+        int j;
+
+        for (j = 0; j < server.saveparamslen; j++) {
+            sp = sdscatprintf(sp,"%jd %d",
+                    (intmax_t)server.saveparams[j].seconds,
+                    server.saveparams[j].changes);
+            if (j != server.saveparamslen-1)
+                sp = sdscatlen(sp," ",1);
+        }
+        addReplyMultiBulkLen(c,2);
+        addReplyBulkCString(c,name);
+        addReplyBulkCString(c,sp);
+        sdsfree(sp);
+        return;
+    }
+
+    // 未知的参数返回空列表
+    if (value == NULL) {
+        addReplyMultiBulkLen(c,0);
+        return;
+    }
+    addReplyMultiBulkLen(c,2);
+    addReplyBulkCString(c,name);
+    addReplyBulkCString(c,(char*)value);
+}
+
+/*
+ * CONFIG 命令的实现函数
+ */
+void configCommand(redisClient *c) {
+    if (!strcasecmp(c->argv[1]->ptr,"set")) {
+        if (c->argc != 4) goto badarity;
+        configSetCommand(c);
+    } else if (!strcasecmp(c->argv[1]->ptr,"get")) {
+        if (c->argc != 3) goto badarity;
+        configGetCommand(c);
+    } else {
+        addReplyError(c,
+            "CONFIG subcommand must be one of GET, SET");
+    }
+    return;
+
+badarity:
+    addReplyErrorFormat(c,"Wrong number of arguments for CONFIG %s",
+        (char*) c->argv[1]->ptr);
+}
@@ -0,0 +1,143 @@
+/* CRC64 used to checksum RDB files.
+ *
+ * RDB 文件使用的 CRC64 校验和
+ *
+ * Specification of this CRC64 variant follows:
+ * Name: crc-64-jones
+ * Width: 64 bites
+ * Poly: 0xad93d23594c935a9
+ * Reflected In: True
+ * Xor_In: 0xffffffffffffffff
+ * Reflected_Out: True
+ * Xor_Out: 0x0
+ * Check("123456789"): 0xe9c6d914c4b8d9ca
+ *
+ * The implementation is table driven and processes eight bytes per step
+ * ("slicing by 8"): eight tables of 256 entries, where table k gives the
+ * CRC of a byte followed by k zero bytes. The RDB writer checksums every
+ * byte it produces, so one table lookup per byte would cost more than the
+ * buffered write itself.
+ *
+ * 使用查表法，每次处理 8 个字节（slicing by 8）：
+ * 第 k 张表保存一个字节后面跟着 k 个零字节时的 CRC 。
+ * RDB 写入器要对写入的每个字节计算校验和，逐字节查表的开销会比写入本身还大。
+ *
+ * The tables are built by crc64_init(), that must be called once at
+ * startup before any thread (or forked child) computes a checksum. */
+
+#include "crc64.h"
+#include <string.h>
+
+/* Reflected form of the Jones polynomial. */
+#define CRC64_POLY_REFLECTED 0x95ac9329ac4bc9b5ULL
+
+static uint64_t crc64_table[8][256];
+
+void crc64_init(void) {
+    int j, k;
+
+    for (j = 0; j < 256; j++) {
+        uint64_t crc = j;
+        for (k = 0; k < 8; k++)
+            crc = (crc & 1) ? (crc >> 1) ^ CRC64_POLY_REFLECTED : crc >> 1;
+        crc64_table[0][j] = crc;
+    }
+    for (j = 0; j < 256; j++) {
+        uint64_t crc = crc64_table[0][j];
+        for (k = 1; k < 8; k++) {
+            crc = crc64_table[0][crc & 0xff] ^ (crc >> 8);
+            crc64_table[k][j] = crc;
+        }
+    }
+}
+
+/*
+ * 计算 s 的前 l 个字节的 CRC64 ， crc 是之前的数据的 CRC64 （或者 0 ）
+ */
+uint64_t crc64(uint64_t crc, const unsigned char *s, uint64_t l) {
+    /* Byte at a time until the pointer is aligned. */
+    while (l && ((uintptr_t)s & 7)) {
+        crc = crc64_table[0][(crc ^ *s++) & 0xff] ^ (crc >> 8);
+        l--;
+    }
+
+    /* Eight bytes at a time. The tables assume little endian words. */
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    while (l >= 8) {
+        uint64_t w;
+
+        memcpy(&w,s,8);
+        crc ^= w;
+        crc = crc64_table[7][crc & 0xff] ^
+              crc64_table[6][(crc >> 8) & 0xff] ^
+              crc64_table[5][(crc >> 16) & 0xff] ^
+              crc64_table[4][(crc >> 24) & 0xff] ^
+              crc64_table[3][(crc >> 32) & 0xff] ^
+              crc64_table[2][(crc >> 40) & 0xff] ^
+              crc64_table[1][(crc >> 48) & 0xff] ^
+              crc64_table[0][crc >> 56];
+        s += 8;
+        l -= 8;
+    }
+#endif
+
+    /* Tail. */
+    while (l--) crc = crc64_table[0][(crc ^ *s++) & 0xff] ^ (crc >> 8);
+    return crc;
+}
+
+#ifdef REDIS_TEST
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+/* Reference implementation, one bit at a time. */
+static uint64_t crc64Bitwise(uint64_t crc, const unsigned char *s, uint64_t l) {
+    int k;
+
+    while (l--) {
+        crc ^= *s++;
+        for (k = 0; k < 8; k++)
+            crc = (crc & 1) ? (crc >> 1) ^ CRC64_POLY_REFLECTED : crc >> 1;
+    }
+    return crc;
+}
+
+/*
+ * CRC64 的正确性检查和微基准测试
+ *
+ * Build with 'make REDIS_CFLAGS=-DREDIS_TEST' and run with
+ * './redis-server test crc64 [iterations]'.
+ */
+int crc64Test(long long iterations) {
+    unsigned char buf[4096+7];
+    uint64_t crc = 0;
+    struct timeval start, end;
+    long long j, elapsed;
+    int failed = 0, len, off;
+
+    crc64_init();
+    crc = crc64(0,(unsigned char*)"123456789",9);
+    printf("crc64(\"123456789\"): %016llx\n", (unsigned long long)crc);
+    if (crc != 0xe9c6d914c4b8d9caULL) failed = 1;
+
+    /* Random lengths and alignments against the bitwise version. */
+    for (j = 0; j < (long long)sizeof(buf); j++) buf[j] = rand();
+    for (j = 0; j < 1000; j++) {
+        off = rand() % 8;
+        len = rand() % 4096;
+        if (crc64(j,buf+off,len) != crc64Bitwise(j,buf+off,len)) failed = 1;
+    }
+
+    gettimeofday(&start,NULL);
+    for (j = 0; j < iterations; j++) crc = crc64(crc,buf,4096);
+    gettimeofday(&end,NULL);
+    elapsed = (end.tv_sec-start.tv_sec)*1000000LL+(end.tv_usec-start.tv_usec);
+    printf("crc64: %.2f MB/s (%016llx)\n",
+        elapsed ? (double)iterations*4096/elapsed : 0,
+        (unsigned long long)crc);
+
+    printf("%s\n", failed ? "FAILED" : "OK");
+    return failed;
+}
+#endif
@@ -1,4 +1,8 @@
 #include "redis.h"
+#include "rdb.h"
+#include "cluster.h"
+
+#include <signal.h>
 
 void setKey(redisDb *db, robj *key, robj *val) {
     //添加或覆写数据库中的键值对
@@ -9,6 +13,12 @@ void setKey(redisDb *db, robj *key, robj *val) {
     }
 
     incrRefCount(val);
+
+    // 移除键的过期时间
+    removeExpire(db,key);
+
+    // 通知监视这个键的客户端
+    signalModifiedKey(db,key);
 }
 
 void dbAdd(redisDb *db, robj *key, robj *val) {
@@ -20,6 +30,9 @@ void dbAdd(redisDb *db, robj *key, robj *val) {
 
     // 如果键已经存在，那么停止
     redisAssertWithInfo(NULL,key,retval == REDIS_OK);
+
+    // 集群模式下，将键添加到它所在槽的索引中
+    if (server.cluster_enabled && db->id == 0) slotToKeyAdd(copy);
 }
 
 void dbOverwrite(redisDb *db, robj *key, robj *val) {
@@ -28,15 +41,114 @@ void dbOverwrite(redisDb *db, robj *key, robj *val) {
     // 节点必须存在，否则中止
     redisAssertWithInfo(NULL,key,de != NULL);
 
+    // 覆写时保留旧值的访问频率
+    if (server.maxmemory_policy & MAXMEMORY_FLAG_LFU) {
+        robj *old = dictGetVal(de);
+        int saved_lru = old->lru;
+        val->lru = saved_lru;
+    }
+
     // 覆写旧值
-    dictReplace(db->dict, key->ptr, val);
+    if (server.lazyfree_lazy_server_del) {
+        /* Swap the value in place and hand the old one to freeObjAsync(),
+         * instead of letting dictReplace() free it synchronously. */
+        // 原地替换值，旧值交给 freeObjAsync() 释放
+        robj *old = dictGetVal(de);
+        dictSetVal(db->dict,de,val);
+        freeObjAsync(old);
+    } else {
+        dictReplace(db->dict, key->ptr, val);
+    }
 }
 
+/*
+ * 为执行写入操作而取出键 key 在数据库 db 中的值。
+ *
+ * 和 lookupKeyRead 不同，这个函数不会更新服务器的命中/不命中信息。
+ *
+ * 找到时返回值对象，没找到返回 NULL 。
+ */
 robj *lookupKeyWrite(redisDb *db, robj *key) {
+
+    // 删除过期键
+    expireIfNeeded(db,key);
+
     // 查找并返回 key 的值对象
     return lookupKey(db,key);
 }
 
+/* Delete a key, value, and associated expiration entry if any, from the DB
+ *
+ * 从数据库中删除给定的键，键的值，以及键的过期时间。
+ *
+ * 删除成功返回 1 ，因为键不存在而导致删除失败时，返回 0 。
+ */
+int dbSyncDelete(redisDb *db, robj *key) {
+
+    /* Deleting an entry from the expires dict will not free the sds of
+     * the key, because it is shared with the main dictionary. */
+    // 删除键的过期时间
+    if (dictSize(db->expires) > 0) dictDelete(db->expires,key->ptr);
+
+    // 槽的索引引用了键的 sds ，所以要在删除键值对之前更新
+    if (server.cluster_enabled && db->id == 0) slotToKeyDel(key->ptr);
+
+    // 删除键值对
+    if (dictDelete(db->dict,key->ptr) == DICT_OK) {
+        return 1;
+    } else {
+        // 键不存在
+        return 0;
+    }
+}
+
+/* This is a wrapper whose behavior depends on the Redis lazy free
+ * configuration. Deletes the key synchronously or asynchronously.
+ *
+ * 根据 lazyfree-lazy-server-del 选项，同步或者异步地删除键
+ */
+int dbDelete(redisDb *db, robj *key) {
+    return server.lazyfree_lazy_server_del ? dbAsyncDelete(db,key) :
+                                             dbSyncDelete(db,key);
+}
+
+/*
+ * 清空服务器的所有数据，返回被删除键的数量
+ *
+ * If 'async' is true the old dictionaries are released by the bio thread.
+ *
+ * 如果 async 为真，那么旧的字典由后台线程释放。
+ */
+long long emptyDb(int async, void(callback)(void*)) {
+    int j;
+    long long removed = 0;
+
+    // 通知开启追踪的客户端清空它们的缓存
+    trackingInvalidateKeysOnFlush();
+
+    // 清空所有数据库
+    for (j = 0; j < server.dbnum; j++) {
+
+        // 记录被删除键的数量
+        removed += dictSize(server.db[j].dict);
+
+        if (async) {
+            emptyDbAsync(&server.db[j]);
+        } else {
+            // 触碰被清空的键的监视者
+            touchWatchedKeysOnFlush(&server.db[j],NULL);
+            // 槽的索引引用了键的 sds ，所以先于键空间清空
+            if (server.cluster_enabled && j == 0) slotToKeyFlush();
+            // 删除所有键值对
+            dictEmpty(server.db[j].dict,callback);
+            // 删除所有键的过期时间
+            dictEmpty(server.db[j].expires,callback);
+        }
+    }
+
+    return removed;
+}
+
 /*
  * 从数据库 db 中取出键 key 的值（对象）
  *
@@ -52,6 +164,20 @@ robj *lookupKey(redisDb *db, robj *key) {
         // 取出值
         robj *val = dictGetVal(de);
 
+        /* Update the access time for the ageing algorithm.
+         * Don't do it if we have a saving child, as this will trigger
+         * a copy on write madness. */
+        // 更新对象的 LRU 时间，或者 LFU 访问频率
+        // 如果有子进程正在保存数据库，那么不更新，
+        // 否则每次读取都会让子进程共享的内存页被复制
+        if (!hasActiveChildProcess()) {
+            if (server.maxmemory_policy & MAXMEMORY_FLAG_LFU) {
+                updateLFU(val);
+            } else {
+                val->lru = LRU_CLOCK();
+            }
+        }
+
         // 返回值
         return val;
     } else {
@@ -76,6 +202,33 @@ int selectDb(redisClient *c, int id) {
     return REDIS_OK;
 }
 
+/*
+ * SELECT index
+ *
+ * 切换客户端的目标数据库
+ */
+void selectCommand(redisClient *c) {
+    long long id;
+
+    // 不合法的数据库号码
+    if (getLongLongFromObjectOrReply(c,c->argv[1],&id,
+        "invalid DB index") != REDIS_OK)
+        return;
+
+    // 集群模式下只能使用 0 号数据库
+    if (server.cluster_enabled && id != 0) {
+        addReplyError(c,"SELECT is not allowed in cluster mode");
+        return;
+    }
+
+    // 切换数据库
+    if (id < INT_MIN || id > INT_MAX || selectDb(c,id) == REDIS_ERR) {
+        addReplyError(c,"invalid DB index");
+    } else {
+        addReply(c,shared.ok);
+    }
+}
+
 /*
  * 为执行读取操作而从数据库中查找返回 key 的值。
  *
@@ -100,9 +253,541 @@ robj *lookupKeyRead(redisClient *c, robj *key) {
 robj *lookupKeyRead_(redisDb *db, robj *key) {
     robj *val;
 
+    // 检查 key 释放已经过期
+    // 从服务器不删除过期键，但对读操作来说它已经不存在了
+    if (expireIfNeeded(db,key)) return NULL;
+
     // 从数据库中取出键的值
     val = lookupKey(db,key);
 
     // 返回值
     return val;
 }
+
+/*-----------------------------------------------------------------------------
+ * Type agnostic commands operating on the key space
+ *----------------------------------------------------------------------------*/
+
+/* Return the set of flags to use for the emptyDb() call for FLUSHALL
+ * and FLUSHDB commands.
+ *
+ * Currently the command just attempts to parse the "ASYNC" option. It
+ * also checks if the command arity is wrong.
+ *
+ * On success REDIS_OK is returned and the flags are stored in *async,
+ * otherwise REDIS_ERR is returned and the function sends an error to the
+ * client.
+ *
+ * 解析 FLUSHDB 和 FLUSHALL 的 ASYNC 选项
+ */
+int getFlushCommandFlags(redisClient *c, int *async) {
+    /* Parse the optional ASYNC option. */
+    if (c->argc > 1) {
+        if (c->argc > 2 || strcasecmp(c->argv[1]->ptr,"async")) {
+            addReply(c,shared.syntaxerr);
+            return REDIS_ERR;
+        }
+        *async = 1;
+    } else {
+        *async = 0;
+    }
+    return REDIS_OK;
+}
+
+/* FLUSHDB [ASYNC]
+ *
+ * 清空客户端指定的数据库
+ */
+void flushdbCommand(redisClient *c) {
+    int async;
+
+    if (getFlushCommandFlags(c,&async) == REDIS_ERR) return;
+
+    server.dirty += dictSize(c->db->dict);
+
+    // 通知开启追踪的客户端清空它们的缓存
+    trackingInvalidateKeysOnFlush();
+
+    if (async) {
+        emptyDbAsync(c->db);
+    } else {
+        touchWatchedKeysOnFlush(c->db,NULL);
+        if (server.cluster_enabled && c->db->id == 0) slotToKeyFlush();
+        // 清空数据库中的所有键值对
+        dictEmpty(c->db->dict,NULL);
+        // 清空数据库中的所有键的过期时间
+        dictEmpty(c->db->expires,NULL);
+    }
+
+    addReply(c,shared.ok);
+}
+
+/* FLUSHALL [ASYNC]
+ *
+ * 清空服务器中的所有数据库
+ */
+void flushallCommand(redisClient *c) {
+    int async;
+
+    if (getFlushCommandFlags(c,&async) == REDIS_ERR) return;
+
+    // 如果正在执行数据库的保存工作，那么强制中断它
+    if (server.rdb_child_pid != -1) {
+        // 杀死子进程
+        kill(server.rdb_child_pid,SIGUSR1);
+        // 删除临时文件
+        rdbRemoveTempFile(server.rdb_child_pid);
+    }
+
+    // 清空所有数据库
+    server.dirty += emptyDb(async,NULL);
+
+    addReply(c,shared.ok);
+
+    // 如果设置了保存条件，那么保存一个空的 RDB 文件，
+    // 避免重启后载入 FLUSHALL 之前的旧数据
+    if (server.saveparamslen > 0) {
+        /* Normally rdbSave() will reset dirty, but we don't want this here:
+         * the flushed keys are still changes the save points must see. */
+        long long saved_dirty = server.dirty;
+
+        rdbSave(server.rdb_filename);
+
+        server.dirty = saved_dirty;
+    }
+
+    server.dirty++;
+}
+
+/*
+ * SHUTDOWN [SAVE|NOSAVE]
+ */
+void shutdownCommand(redisClient *c) {
+    int flags = 0;
+
+    if (c->argc > 2) {
+        addReply(c,shared.syntaxerr);
+        return;
+    } else if (c->argc == 2) {
+
+        // 停机时不进行保存
+        if (!strcasecmp(c->argv[1]->ptr,"nosave")) {
+            flags |= REDIS_SHUTDOWN_NOSAVE;
+
+        // 停机时进行保存
+        } else if (!strcasecmp(c->argv[1]->ptr,"save")) {
+            flags |= REDIS_SHUTDOWN_SAVE;
+
+        } else {
+            addReply(c,shared.syntaxerr);
+            return;
+        }
+    }
+
+    if (prepareForShutdown(flags) == REDIS_OK) exit(0);
+
+    addReplyError(c,"Errors trying to SHUTDOWN. Check logs.");
+}
+
+/* This command implements DEL and UNLINK. */
+void delGenericCommand(redisClient *c, int lazy) {
+    int deleted = 0, j;
+
+    // 遍历所有输入键
+    for (j = 1; j < c->argc; j++) {
+
+        // 先删除过期的键
+        expireIfNeeded(c->db,c->argv[j]);
+
+        // 尝试删除键
+        int removed = lazy ? dbAsyncDelete(c->db,c->argv[j]) :
+                             dbSyncDelete(c->db,c->argv[j]);
+        if (removed) {
+            signalModifiedKey(c->db,c->argv[j]);
+            server.dirty++;
+            // 成功删除才增加 deleted 计数器的值
+            deleted++;
+        }
+    }
+
+    // 返回被删除键的数量
+    addReplyLongLong(c,deleted);
+}
+
+void delCommand(redisClient *c) {
+    delGenericCommand(c,server.lazyfree_lazy_user_del);
+}
+
+/* UNLINK: like DEL, but big values are always reclaimed by the bio thread.
+ *
+ * 和 DEL 一样，但大的值总是交给后台线程释放 */
+void unlinkCommand(redisClient *c) {
+    delGenericCommand(c,1);
+}
+
+/* EXISTS key1 key2 ... key_N.
+ * Return value is the number of keys existing. */
+void existsCommand(redisClient *c) {
+    long long count = 0;
+    int j;
+
+    for (j = 1; j < c->argc; j++) {
+        // 检查键是否已经过期，如果已过期的话，那么将它删除
+        // 这可以避免已过期的键被误认为存在
+        expireIfNeeded(c->db,c->argv[j]);
+        if (dictFind(c->db->dict,c->argv[j]->ptr)) count++;
+    }
+    addReplyLongLong(c,count);
+}
+
+void dbsizeCommand(redisClient *c) {
+    addReplyLongLong(c,dictSize(c->db->dict));
+}
+
+/*-----------------------------------------------------------------------------
+ * Expires API
+ *----------------------------------------------------------------------------*/
+
+/*
+ * 移除键 key 的过期时间
+ */
+int removeExpire(redisDb *db, robj *key) {
+    /* An expire may only be removed if there is a corresponding entry in the
+     * main dict. Otherwise, the key will never be freed. */
+    // 确保键带有过期时间
+    redisAssertWithInfo(NULL,key,dictFind(db->dict,key->ptr) != NULL);
+
+    // 删除过期时间
+    return dictDelete(db->expires,key->ptr) == DICT_OK;
+}
+
+/*
+ * 将键 key 的过期时间设为 when
+ */
+void setExpire(redisDb *db, robj *key, long long when) {
+
+    dictEntry *kde, *de;
+
+    /* Reuse the sds from the main dict in the expire dict */
+    // 取出键
+    kde = dictFind(db->dict,key->ptr);
+
+    redisAssertWithInfo(NULL,key,kde != NULL);
+
+    // 根据键取出键的过期时间
+    de = dictReplaceRaw(db->expires,dictGetKey(kde));
+
+    // 设置键的过期时间
+    // 这里是直接使用整数值来保存过期时间，不是用 INT 编码的 String 对象
+    dictSetSignedIntegerVal(de,when);
+}
+
+/* Return the expire time of the specified key, or -1 if no expire
+ * is associated with this key (i.e. the key is non volatile)
+ *
+ * 返回给定 key 的过期时间。
+ *
+ * 如果键没有设置过期时间，那么返回 -1 。
+ */
+long long getExpire(redisDb *db, robj *key) {
+    dictEntry *de;
+
+    /* No expire? return ASAP */
+    // 获取键的过期时间
+    // 如果过期时间不存在，那么直接返回
+    if (dictSize(db->expires) == 0 ||
+       (de = dictFind(db->expires,key->ptr)) == NULL) return -1;
+
+    /* The entry was found in the expire dict, this means it should also
+     * be present in the main dict (safety check). */
+    redisAssertWithInfo(NULL,key,dictFind(db->dict,key->ptr) != NULL);
+
+    // 返回过期时间
+    return dictGetSignedIntegerVal(de);
+}
+
+/* Propagate expires into the AOF file.
+ *
+ * 将过期时间传播到 AOF 文件。
+ *
+ * When a key expires (lazily on access, in the active expire cycle, or
+ * when it is evicted) an explicit DEL is appended to the log, so that the
+ * replay does not depend on the time the file is loaded.
+ *
+ * 键过期（被访问时发现、主动过期或者被淘汰）时，
+ * 向 AOF 文件追加一个显式的 DEL 命令，这样载入 AOF 的结果就不依赖于载入的时间。
+ */
+void propagateExpire(redisDb *db, robj *key) {
+    robj *argv[2];
+
+    // 构造一个 DEL key 命令
+    argv[0] = shared.del;
+    argv[1] = key;
+    incrRefCount(argv[0]);
+    incrRefCount(argv[1]);
+
+    // 传播到 AOF
+    if (server.aof_state != REDIS_AOF_OFF)
+        feedAppendOnlyFile(server.delCommand,db->id,argv,2);
+
+    // 传播到所有从服务器
+    replicationFeedSlaves(server.slaves,db->id,argv,2);
+
+    decrRefCount(argv[0]);
+    decrRefCount(argv[1]);
+}
+
+/*
+ * 检查 key 是否已经过期，如果是的话，将它从数据库中删除。
+ *
+ * 返回 0 表示键没有过期时间，或者键未过期。
+ *
+ * 返回 1 表示键已经因为过期而被删除了，
+ * 在从服务器上返回 1 表示键已经过期，但没有被删除。
+ */
+int expireIfNeeded(redisDb *db, robj *key) {
+
+    // 取出键的过期时间
+    long long when = getExpire(db,key);
+    int retval;
+
+    // 没有过期时间
+    if (when < 0) return 0; /* No expire for this key */
+
+    /* Don't expire anything while loading. It will be done later. */
+    // 如果服务器正在进行载入，那么不进行任何过期检查
+    if (server.loading) return 0;
+
+    /* If we are running in the context of a slave, return ASAP:
+     * the slave key expiration is controlled by the master that will
+     * send us synthesized DEL operations for expired keys.
+     *
+     * Still we try to return the right information to the caller,
+     * that is, 0 if we think the key should be still valid, 1 if
+     * we think the key is expired at this time. */
+    // 从服务器的过期键由主服务器发来的 DEL 删除
+    if (server.masterhost != NULL) return mstime() > when;
+
+    /* Return when this key has not expired */
+    // 键未过期
+    if (mstime() <= when) return 0;
+
+    /* Delete the key */
+    server.stat_expiredkeys++;
+
+    // 向 AOF 文件传播过期信息
+    propagateExpire(db,key);
+
+    // 将过期键从数据库中删除
+    retval = server.lazyfree_lazy_expire ? dbAsyncDelete(db,key) :
+                                           dbSyncDelete(db,key);
+    if (retval) signalModifiedKey(db,key);
+    return retval;
+}
+
+/*-----------------------------------------------------------------------------
+ * Expires Commands
+ *----------------------------------------------------------------------------*/
+
+/* This is the generic command implementation for EXPIRE, PEXPIRE, EXPIREAT
+ * and PEXPIREAT. Because the commad second argument may be relative or absolute
+ * the "basetime" argument is used to signal what the base time is (either 0
+ * for *AT variants of the command, or the current time for relative expires).
+ *
+ * 这个函数是 EXPIRE 、 PEXPIRE 、 EXPIREAT 和 PEXPIREAT 命令的底层实现函数。
+ *
+ * 命令的第二个参数可能是绝对值，也可能是相对值。
+ * 当执行 *AT 命令时， basetime 为 0 ，在其他情况下，它保存的就是当前的绝对时间。
+ *
+ * unit is either UNIT_SECONDS or UNIT_MILLISECONDS, and is only used for
+ * the argv[2] parameter. The basetime is always specified in milliseconds.
+ *
+ * unit 用于指定 argv[2] （传入过期时间）的格式，
+ * 它可以是 UNIT_SECONDS 或 UNIT_MILLISECONDS ，
+ * basetime 参数则总是毫秒格式的。
+ */
+void expireGenericCommand(redisClient *c, long long basetime, int unit) {
+    robj *key = c->argv[1], *param = c->argv[2];
+    long long when; /* unix time in milliseconds when the key will expire. */
+
+    // 取出 when 参数
+    if (getLongLongFromObjectOrReply(c, param, &when, NULL) != REDIS_OK)
+        return;
+
+    // 如果传入的过期时间是以秒为单位的，那么将它转换为毫秒
+    // 转换或者加上 basetime 会溢出时报错
+    if (unit == UNIT_SECONDS) {
+        if (when > LLONG_MAX/1000 || when < LLONG_MIN/1000) {
+            addReplyErrorFormat(c,"invalid expire time in %s",c->cmd->name);
+            return;
+        }
+        when *= 1000;
+    }
+    if (when > LLONG_MAX-basetime) {
+        addReplyErrorFormat(c,"invalid expire time in %s",c->cmd->name);
+        return;
+    }
+    when += basetime;
+
+    /* No key, return zero. */
+    // 取出键
+    if (lookupKeyWrite(c->db,key) == NULL) {
+        addReply(c,shared.czero);
+        return;
+    }
+
+    /* EXPIRE with negative TTL, or EXPIREAT with a timestamp into the past
+     * should never be executed as a DEL when load the AOF or in the context
+     * of a slave instance.
+     *
+     * Instead we take the other branch of the IF statement setting an expire
+     * (possibly in the past) and wait for an explicit DEL from the master. */
+    // 过期时间已经过去，直接删除键
+    // 载入 AOF 时或者在从服务器上不删除，等待之后的 DEL 命令
+    if (when <= mstime() && !server.loading && !server.masterhost) {
+        robj *aux;
+
+        redisAssertWithInfo(c,key,dbDelete(c->db,key));
+        signalModifiedKey(c->db,key);
+        server.dirty++;
+
+        /* Replicate/AOF this as an explicit DEL. */
+        // 传播 DEL 命令
+        aux = createStringObject("DEL",3);
+        rewriteClientCommandVector(c,2,aux,key);
+        decrRefCount(aux);
+
+        addReply(c, shared.cone);
+        return;
+    } else {
+        // 设置键的过期时间
+        setExpire(c->db,key,when);
+        signalModifiedKey(c->db,key);
+        server.dirty++;
+        addReply(c,shared.cone);
+        return;
+    }
+}
+
+void expireCommand(redisClient *c) {
+    expireGenericCommand(c,mstime(),UNIT_SECONDS);
+}
+
+void expireatCommand(redisClient *c) {
+    expireGenericCommand(c,0,UNIT_SECONDS);
+}
+
+void pexpireCommand(redisClient *c) {
+    expireGenericCommand(c,mstime(),UNIT_MILLISECONDS);
+}
+
+void pexpireatCommand(redisClient *c) {
+    expireGenericCommand(c,0,UNIT_MILLISECONDS);
+}
+
+/*
+ * 返回键的剩余生存时间。
+ *
+ * output_ms 指定返回值的格式：
+ *
+ *  - 为 1 时，返回毫秒
+ *
+ *  - 为 0 时，返回秒
+ */
+void ttlGenericCommand(redisClient *c, int output_ms) {
+    long long expire, ttl = -1;
+
+    /* If the key does not exist at all, return -2 */
+    // 取出键
+    if (lookupKeyRead(c,c->argv[1]) == NULL) {
+        addReplyLongLong(c,-2);
+        return;
+    }
+
+    /* The key exists. Return -1 if it has no expire, or the actual
+     * TTL value otherwise. */
+    // 取出过期时间
+    expire = getExpire(c->db,c->argv[1]);
+
+    if (expire != -1) {
+        // 计算剩余生存时间
+        ttl = expire-mstime();
+        if (ttl < 0) ttl = 0;
+    }
+
+    if (ttl == -1) {
+        // 键是持久的
+        addReplyLongLong(c,-1);
+    } else {
+        // 返回 TTL
+        // (ttl+500)/1000 计算的是渐近秒数
+        addReplyLongLong(c,output_ms ? ttl : ((ttl+500)/1000));
+    }
+}
+
+void ttlCommand(redisClient *c) {
+    ttlGenericCommand(c, 0);
+}
+
+void pttlCommand(redisClient *c) {
+    ttlGenericCommand(c, 1);
+}
+
+void persistCommand(redisClient *c) {
+
+    // 取出键（已过期的键会先被删除）
+    if (lookupKeyWrite(c->db,c->argv[1]) == NULL) {
+        // 键不存在
+        addReply(c,shared.czero);
+
+    } else {
+
+        // 键带有过期时间，那么将它移除
+        if (removeExpire(c->db,c->argv[1])) {
+            signalModifiedKey(c->db,c->argv[1]);
+            addReply(c,shared.cone);
+            server.dirty++;
+
+        // 键已经是持久的了
+        } else {
+            addReply(c,shared.czero);
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------
+ * API to get key arguments from commands
+ * 从命令中取出键参数的 API
+ *---------------------------------------------------------------------------*/
+
+/* The base case is to use the keys position as given in the command table
+ * (firstkey, lastkey, step).
+ *
+ * 根据命令表中给出的 firstkey 、 lastkey 和 step 取出命令的键参数，
+ * 返回一个保存键参数在 argv 中的索引的数组，数组的长度保存在 numkeys 里。
+ */
+int *getKeysFromCommand(struct redisCommand *cmd, robj **argv, int argc, int *numkeys) {
+    int j, i = 0, last, *keys;
+    REDIS_NOTUSED(argv);
+
+    // 命令不带键参数
+    if (cmd->firstkey == 0) {
+        *numkeys = 0;
+        return NULL;
+    }
+
+    last = cmd->lastkey;
+    if (last < 0) last = argc+last;
+    keys = zmalloc(sizeof(int)*((last - cmd->firstkey)+1));
+    for (j = cmd->firstkey; j <= last; j += cmd->keystep) {
+        redisAssert(j < argc);
+        keys[i++] = j;
+    }
+    *numkeys = i;
+    return keys;
+}
+
+/* Free the result of getKeysFromCommand. */
+void getKeysFreeResult(int *result) {
+    zfree(result);
+}
@@ -1,7 +1,75 @@
 #include "redis.h"
+#include "rdb.h"
 #include "stdarg.h"
 #include "syslog.h"
 
+/*
+ * DEBUG OBJECT <key>
+ *
+ * 返回键的值对象的底层信息，用于测试
+ *
+ * DEBUG SET-ACTIVE-EXPIRE <0|1>
+ *
+ * 关闭或打开过期键的主动删除，用于测试
+ *
+ * DEBUG RELOAD
+ *
+ * 保存 RDB 文件，清空数据库，然后重新载入 RDB 文件
+ *
+ * DEBUG LOADAOF
+ *
+ * 冲洗 AOF 缓冲区，清空数据库，然后重新载入 AOF 文件
+ */
+void debugCommand(redisClient *c) {
+    if (!strcasecmp(c->argv[1]->ptr,"object") && c->argc == 3) {
+        dictEntry *de;
+        robj *val;
+
+        // 取出值对象
+        if ((de = dictFind(c->db->dict,c->argv[2]->ptr)) == NULL) {
+            addReplyError(c,"no such key");
+            return;
+        }
+        val = dictGetVal(de);
+
+        addReplyStatusFormat(c,
+            "Value at:%p refcount:%d encoding:%s lru:%d lru_seconds_idle:%llu",
+            (void*)val, val->refcount, strEncoding(val->encoding),
+            val->lru, estimateObjectIdleTime(val)/1000);
+    } else if (!strcasecmp(c->argv[1]->ptr,"set-active-expire") &&
+               c->argc == 3)
+    {
+        // 打开或关闭 serverCron() 中的主动过期，用于测试惰性过期
+        server.active_expire_enabled = atoi(c->argv[2]->ptr);
+        addReply(c,shared.ok);
+    } else if (!strcasecmp(c->argv[1]->ptr,"reload") && c->argc == 2) {
+        // 保存 RDB 文件，清空数据库，然后重新载入 RDB 文件
+        if (rdbSave(server.rdb_filename) != REDIS_OK) {
+            addReply(c,shared.err);
+            return;
+        }
+        emptyDb(0,NULL);
+        if (rdbLoad(server.rdb_filename) != REDIS_OK) {
+            addReplyError(c,"Error trying to load the RDB dump");
+            return;
+        }
+        redisLog(REDIS_WARNING,"DB reloaded by DEBUG RELOAD");
+        addReply(c,shared.ok);
+    } else if (!strcasecmp(c->argv[1]->ptr,"loadaof") && c->argc == 2) {
+        if (server.aof_state == REDIS_AOF_ON) flushAppendOnlyFile(1);
+        emptyDb(0,NULL);
+        if (loadAppendOnlyFiles(server.aof_manifest) != REDIS_OK) {
+            addReply(c,shared.err);
+            return;
+        }
+        server.dirty = 0; /* Prevent AOF propagation. */
+        redisLog(REDIS_WARNING,"Append Only File loaded by DEBUG LOADAOF");
+        addReply(c,shared.ok);
+    } else {
+        addReplyError(c,"Syntax error. Try DEBUG [OBJECT <key>|SET-ACTIVE-EXPIRE <0|1>|RELOAD|LOADAOF]");
+    }
+}
+
 void _redisAssertWithInfo(redisClient *c, robj *o, char *estr, char *file, int line) {
     _redisAssert(estr,file,line);
 }
@@ -32,6 +100,17 @@ void redisLog(int level, const char *fmt, ...) {
     redisLogRaw(level,msg);
 }
 
+/* Log a fixed message without printf-alike capabilities, in a way that is
+ * safe to call from a signal handler: stdio is not async-signal-safe, so
+ * the message goes straight to the fd with write(2).
+ *
+ * 在信号处理器中打印日志，只使用 write(2) 。 */
+void redisLogFromHandler(int level, const char *msg) {
+    if ((level&0xff) < server.verbosity) return;
+    if (write(STDOUT_FILENO,msg,strlen(msg)) == -1) return;
+    if (write(STDOUT_FILENO,"\n",1) == -1) return;
+}
+
 void redisLogRaw(int level, const char *msg) {
     const char *syslogLevelMap[] = { "LOG_DEBUG", "LOG_INFO", "LOG_NOTICE", "LOG_WARNING" };
 
@@ -6,9 +6,36 @@
 #include "redis.h"
 #include <strings.h>
 #include <ctype.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+/* Using dictEnableResize() / dictDisableResize() we make possible to
+ * enable/disable resizing of the hash table as needed. This is very important
+ * for Redis, as we use copy-on-write and don't want to move too much memory
+ * around when there is a child performing saving operations.
+ *
+ * 通过 dictEnableResize() 和 dictDisableResize() 两个函数，
+ * 程序可以手动地允许或阻止哈希表进行 rehash ，
+ * 这在 Redis 使用子进程进行保存操作时，可以有效地利用 copy-on-write 机制。
+ *
+ * Note that even when dict_can_resize is set to 0, not all resizes are
+ * prevented: a hash table is still allowed to grow if the ratio between
+ * the number of elements and the buckets > dict_force_resize_ratio.
+ *
+ * 需要注意的是，并非所有 rehash 都会被 dictDisableResize 阻止：
+ * 如果已使用节点的数量和字典大小之间的比率，
+ * 大于字典强制 rehash 比率 dict_force_resize_ratio ，
+ * 那么 rehash 仍然会（强制）进行。
+ */
+// 指示字典是否启用 rehash 的标识
+static int dict_can_resize = 1;
+// 强制 rehash 的比率
+static unsigned int dict_force_resize_ratio = 5;
 
 static int _dictInit(dict *ht, dictType *type, void *privDataPtr);
 static void _dictReset(dictht *ht);
+static int _dictClear(dict *d, dictht *ht, void(callback)(void *));
+static void _dictRehashStep(dict *d);
 
 static int _dictKeyIndex(dict *ht, const void *key);
 static int _dictExpandIfNeeded(dict *d);
@@ -16,36 +43,87 @@ static unsigned long _dictNextPower(unsigned long size);
 
 static uint32_t dict_hash_function_seed = 5381;
 
+/*
+ * 返回字典中包含键 key 的节点
+ *
+ * 找到返回节点，找不到返回 NULL
+ *
+ * T = O(1)
+ */
 dictEntry *dictFind(dict *d, const void *key)
 {
     dictEntry *he;
-    unsigned int h, idx;
+    unsigned int h, idx, table;
 
     // 字典（的哈希表）为空
-    if (d->ht[0].size == 0) 
-        return NULL;
+    if (d->ht[0].size == 0) return NULL; /* We don't have a table at all */
+
+    // 如果条件允许的话，进行单步 rehash
+    if (dictIsRehashing(d)) _dictRehashStep(d);
 
     // 计算键的哈希值
     h = dictHashKey(d, key);
-
     // 在字典的哈希表中查找这个键
+    // T = O(1)
+    for (table = 0; table <= 1; table++) {
 
-    // 计算索引值
-    idx = h & d->ht[0].sizemask;
+        // 计算索引值
+        idx = h & d->ht[table].sizemask;
 
-    // 遍历给定索引上的链表的所有节点，查找 key
-    he = d->ht[0].table[idx];
-    
-    while(he) {
-        if (dictCompareKeys(d, key, he->key))
-            return he;
+        // 遍历给定索引上的链表的所有节点，查找 key
+        he = d->ht[table].table[idx];
+        // T = O(1)
+        while(he) {
+            if (dictCompareKeys(d, key, he->key))
+                return he;
 
-        he = he->next;
+            he = he->next;
+        }
+
+        // 如果程序遍历完 0 号哈希表，仍然没找到指定的键的节点
+        // 那么程序会检查字典是否在进行 rehash ，
+        // 然后才决定是直接返回 NULL ，还是继续查找 1 号哈希表
+        if (!dictIsRehashing(d)) return NULL;
     }
 
+    // 进行到这里时，说明两个哈希表都没找到
     return NULL;
 }
 
+/*
+ * 获取包含给定键的节点的值
+ *
+ * 如果节点不为空，返回节点的值
+ * 否则返回 NULL
+ *
+ * T = O(1)
+ */
+void *dictFetchValue(dict *d, const void *key) {
+    dictEntry *he;
+
+    // T = O(1)
+    he = dictFind(d,key);
+
+    return he ? dictGetVal(he) : NULL;
+}
+
+/*
+ * 预取 key 所在的哈希桶，用于批量查找
+ *
+ * Callers looking up many keys at once (MGET and friends) first call this
+ * for every key, so that the cache misses on the bucket array overlap
+ * instead of being paid one after the other by dictFind().
+ */
+void dictPrefetch(dict *d, const void *key) {
+    unsigned int h;
+
+    if (d->ht[0].size == 0) return;
+    h = dictHashKey(d, key);
+    __builtin_prefetch(&d->ht[0].table[h & d->ht[0].sizemask]);
+    if (dictIsRehashing(d))
+        __builtin_prefetch(&d->ht[1].table[h & d->ht[1].sizemask]);
+}
+
 /* Create a new hash table */
 /*
  * 创建一个新的字典
@@ -70,9 +148,10 @@ dict *dictCreate(dictType *type, void *privDataPtr)
 static int _dictInit(dict *d, dictType *type,
         void *privDataPtr)
 {
-    // 初始化哈希表的各项属性值
+    // 初始化两个哈希表的各项属性值
     // 但暂时还不分配内存给哈希表数组
     _dictReset(&d->ht[0]);
+    _dictReset(&d->ht[1]);
 
     // 设置类型特定函数
     d->type = type;
@@ -80,6 +159,12 @@ static int _dictInit(dict *d, dictType *type,
     // 设置私有数据
     d->privdata = privDataPtr;
 
+    // 设置哈希表 rehash 状态
+    d->rehashidx = -1;
+
+    // 设置字典的安全迭代器数量
+    d->iterators = 0;
+
     return DICT_OK;
 }
 
@@ -223,6 +308,10 @@ dictEntry *dictAddRaw(dict *d, void *key)
     dictEntry *entry;
     dictht *ht;
 
+    // 如果条件允许的话，进行单步 rehash
+    // T = O(1)
+    if (dictIsRehashing(d)) _dictRehashStep(d);
+
     /* Get the index of the new element, or -1 if
      * the element already exists. */
     // 计算键在哈希表中的索引值
@@ -233,8 +322,9 @@ dictEntry *dictAddRaw(dict *d, void *key)
 
     // T = O(1)
     /* Allocate the memory and store the new entry */
-    // 将新键添加到 0 号哈希表
-    ht = &d->ht[0];
+    // 如果字典正在 rehash ，那么将新键添加到 1 号哈希表
+    // 否则，将新键添加到 0 号哈希表
+    ht = dictIsRehashing(d) ? &d->ht[1] : &d->ht[0];
     // 为新节点分配空间
     entry = zmalloc(sizeof(*entry));
     // 将新节点插入到链表表头
@@ -251,11 +341,24 @@ dictEntry *dictAddRaw(dict *d, void *key)
     return entry;
 }
 
-//返回可以将 key 插入到哈希表的索引位置
-//如果 key 已经存在于哈希表，那么返回 -1
+/* Returns the index of a free slot that can be populated with
+ * a hash entry for the given 'key'.
+ * If the key already exists, -1 is returned.
+ *
+ * 返回可以将 key 插入到哈希表的索引位置
+ * 如果 key 已经存在于哈希表，那么返回 -1
+ *
+ * Note that if we are in the process of rehashing the hash table, the
+ * index is always returned in the context of the second (new) hash table.
+ *
+ * 注意，如果字典正在进行 rehash ，那么总是返回 1 号哈希表的索引。
+ * 因为在字典进行 rehash 时，新节点总是插入到 1 号哈希表。
+ *
+ * T = O(N)
+ */
 static int _dictKeyIndex(dict *d, const void *key)
 {
-    unsigned int h, idx;
+    unsigned int h, idx, table;
     dictEntry *he;
 
     /* Expand the hash table if needed */
@@ -268,20 +371,26 @@ static int _dictKeyIndex(dict *d, const void *key)
     // 计算 key 的哈希值
     h = dictHashKey(d, key);
     // T = O(1)
-    
-    // 计算索引值
-    idx = h & d->ht[0].sizemask;
-
-    /* Search if this slot does not already contain the given key */
-    // 查找 key 是否存在
-    // T = O(1)
-    he = d->ht[0].table[idx];
-    while(he) {
-        if (dictCompareKeys(d, key, he->key))
-            return -1;
-        he = he->next;
+    for (table = 0; table <= 1; table++) {
+
+        // 计算索引值
+        idx = h & d->ht[table].sizemask;
+
+        /* Search if this slot does not already contain the given key */
+        // 查找 key 是否存在
+        // T = O(1)
+        he = d->ht[table].table[idx];
+        while(he) {
+            if (dictCompareKeys(d, key, he->key))
+                return -1;
+            he = he->next;
+        }
+
+        // 如果运行到这里时，说明 0 号哈希表中所有节点都不包含 key
+        // 如果这时 rehahs 正在进行，那么继续对 1 号哈希表进行 rehash
+        if (!dictIsRehashing(d)) break;
     }
-    
+
     // 返回索引值
     return idx;
 }
@@ -296,10 +405,32 @@ static int _dictKeyIndex(dict *d, const void *key)
  */
 static int _dictExpandIfNeeded(dict *d)
 {
+    /* Incremental rehashing already in progress. Return. */
+    // 渐进式 rehash 已经在进行了，直接返回
+    if (dictIsRehashing(d)) return DICT_OK;
+
+    /* If the hash table is empty expand it to the initial size. */
     // 如果字典（的 0 号哈希表）为空，那么创建并返回初始化大小的 0 号哈希表
     // T = O(1)
     if (d->ht[0].size == 0) return dictExpand(d, DICT_HT_INITIAL_SIZE);
 
+    /* If we reached the 1:1 ratio, and we are allowed to resize the hash
+     * table (global setting) or we should avoid it but the ratio between
+     * elements/buckets is over the "safe" threshold, we resize doubling
+     * the number of buckets. */
+    // 一下两个条件之一为真时，对字典进行扩展
+    // 1）字典已使用节点数和字典大小之间的比率接近 1：1
+    //    并且 dict_can_resize 为真
+    // 2）已使用节点数和字典大小之间的比率超过 dict_force_resize_ratio
+    if (d->ht[0].used >= d->ht[0].size &&
+        (dict_can_resize ||
+         d->ht[0].used/d->ht[0].size > dict_force_resize_ratio))
+    {
+        // 新哈希表的大小至少是目前已使用节点数的两倍
+        // T = O(N)
+        return dictExpand(d, d->ht[0].used*2);
+    }
+
     return DICT_OK;
 }
 
@@ -308,9 +439,12 @@ static int _dictExpandIfNeeded(dict *d)
  * 创建一个新的哈希表，并根据字典的情况，选择以下其中一个动作来进行：
  *
  * 1) 如果字典的 0 号哈希表为空，那么将新哈希表设置为 0 号哈希表
+ * 2) 如果字典的 0 号哈希表非空，那么将新哈希表设置为 1 号哈希表，
+ *    并打开字典的 rehash 标识，使得程序可以开始对字典进行 rehash
  *
+ * size 参数不够大，或者 rehash 已经在进行时，返回 DICT_ERR 。
  *
- * 成功创建 0 号哈希表,返回 DICT_OK 。
+ * 成功创建 0 号哈希表，或者 1 号哈希表时，返回 DICT_OK 。
  *
  * T = O(N)
  */
@@ -323,6 +457,12 @@ int dictExpand(dict *d, unsigned long size)
     // T = O(1)
     unsigned long realsize = _dictNextPower(size);
 
+    /* the size is invalid if it is smaller than the number of
+     * elements already inside the hash table */
+    // 不能在字典正在 rehash 时进行
+    // size 的值也不能小于 0 号哈希表的当前已使用节点
+    if (dictIsRehashing(d) || d->ht[0].used > size)
+        return DICT_ERR;
 
     /* Allocate the new hash table and initialize all pointers to NULL */
     // 为哈希表分配空间，并将所有指针指向 NULL
@@ -341,8 +481,198 @@ int dictExpand(dict *d, unsigned long size)
         return DICT_OK;
     }
 
-    //should not here
-    redisAssertWithInfo(NULL,NULL,1 == 0);
+    /* Prepare a second hash table for incremental rehashing */
+    // 如果 0 号哈希表非空，那么这是一次 rehash ：
+    // 程序将新哈希表设置为 1 号哈希表，
+    // 并将字典的 rehash 标识打开，让程序可以开始对字典进行 rehash
+    d->ht[1] = n;
+    d->rehashidx = 0;
+    return DICT_OK;
+}
+
+/* Resize the table to the minimal size that contains all the elements,
+ * but with the invariant of a USED/BUCKETS ratio near to <= 1
+ *
+ * 缩小给定字典
+ * 让它的已用节点数和字典大小之间的比率接近 1:1
+ *
+ * 返回 DICT_ERR 表示字典已经在 rehash ，或者 dict_can_resize 为假。
+ *
+ * 成功创建体积更小的 ht[1] ，可以开始 resize 时，返回 DICT_OK。
+ *
+ * T = O(N)
+ */
+int dictResize(dict *d)
+{
+    int minimal;
+
+    // 不能在关闭 rehash 或者正在 rehash 的时候调用
+    if (!dict_can_resize || dictIsRehashing(d)) return DICT_ERR;
+
+    // 计算让比率接近 1：1 所需要的最少节点数量
+    minimal = d->ht[0].used;
+    if (minimal < DICT_HT_INITIAL_SIZE)
+        minimal = DICT_HT_INITIAL_SIZE;
+
+    // 调整字典的大小
+    // T = O(N)
+    return dictExpand(d, minimal);
+}
+
+/* Performs N steps of incremental rehashing. Returns 1 if there are still
+ * keys to move from the old to the new hash table, otherwise 0 is returned.
+ *
+ * 执行 N 步渐进式 rehash 。
+ *
+ * 返回 1 表示仍有键需要从 0 号哈希表移动到 1 号哈希表，
+ * 返回 0 则表示所有键都已经迁移完毕。
+ *
+ * Note that a rehashing step consists in moving a bucket (that may have more
+ * than one key as we use chaining) from the old to the new hash table.
+ *
+ * 注意，每步 rehash 都是以一个哈希表索引（桶）作为单位的，
+ * 一个桶里可能会有多个节点，
+ * 被 rehash 的桶里的所有节点都会被移动到新哈希表。
+ *
+ * To avoid blocking on long runs of empty buckets, at most n*10 empty
+ * buckets are visited per call.
+ *
+ * T = O(N)
+ */
+int dictRehash(dict *d, int n) {
+    int empty_visits = n*10; /* Max number of empty buckets to visit. */
+
+    // 只可以在 rehash 进行中时执行
+    if (!dictIsRehashing(d)) return 0;
+
+    // 进行 N 步迁移
+    // T = O(N)
+    while(n--) {
+        dictEntry *de, *nextde;
+
+        /* Check if we already rehashed the whole table... */
+        // 如果 0 号哈希表为空，那么表示 rehash 执行完毕
+        // T = O(1)
+        if (d->ht[0].used == 0) {
+            // 释放 0 号哈希表
+            zfree(d->ht[0].table);
+            // 将原来的 1 号哈希表设置为新的 0 号哈希表
+            d->ht[0] = d->ht[1];
+            // 重置旧的 1 号哈希表
+            _dictReset(&d->ht[1]);
+            // 关闭 rehash 标识
+            d->rehashidx = -1;
+            // 返回 0 ，向调用者表示 rehash 已经完成
+            return 0;
+        }
+
+        /* Note that rehashidx can't overflow as we are sure there are more
+         * elements because ht[0].used != 0 */
+        // 确保 rehashidx 没有越界
+        redisAssert(d->ht[0].size > (unsigned)d->rehashidx);
+
+        // 略过数组中为空的索引，找到下一个非空索引
+        while(d->ht[0].table[d->rehashidx] == NULL) {
+            d->rehashidx++;
+            if (--empty_visits == 0) return 1;
+        }
+
+        // 指向该索引的链表表头节点
+        de = d->ht[0].table[d->rehashidx];
+        /* Move all the keys in this bucket from the old to the new hash HT */
+        // 将链表中的所有节点迁移到新哈希表
+        // T = O(1)
+        while(de) {
+            unsigned int h;
+
+            // 保存下个节点的指针
+            nextde = de->next;
+
+            /* Get the index in the new hash table */
+            // 计算新哈希表的哈希值，以及节点插入的索引位置
+            h = dictHashKey(d, de->key) & d->ht[1].sizemask;
+
+            // 插入节点到新哈希表
+            de->next = d->ht[1].table[h];
+            d->ht[1].table[h] = de;
+
+            // 更新计数器
+            d->ht[0].used--;
+            d->ht[1].used++;
+
+            // 继续处理下个节点
+            de = nextde;
+        }
+        // 将刚迁移完的哈希表索引的指针设为空
+        d->ht[0].table[d->rehashidx] = NULL;
+        // 更新 rehash 索引
+        d->rehashidx++;
+    }
+
+    return 1;
+}
+
+/*
+ * 返回以毫秒为单位的 UNIX 时间戳
+ *
+ * T = O(1)
+ */
+static long long timeInMilliseconds(void) {
+    struct timeval tv;
+
+    gettimeofday(&tv,NULL);
+    return (((long long)tv.tv_sec)*1000)+(tv.tv_usec/1000);
+}
+
+/* Rehash for an amount of time between ms milliseconds and ms+1 milliseconds
+ *
+ * 在给定毫秒数内，以 100 步为单位，对字典进行 rehash 。
+ *
+ * T = O(N)
+ */
+int dictRehashMilliseconds(dict *d, int ms) {
+    // 记录开始时间
+    long long start = timeInMilliseconds();
+    int rehashes = 0;
+
+    while(dictRehash(d,100)) {
+        rehashes += 100;
+        // 如果时间已过，跳出
+        if (timeInMilliseconds()-start > ms) break;
+    }
+
+    return rehashes;
+}
+
+/* This function performs just a step of rehashing, and only if there are
+ * no safe iterators bound to our hash table. When we have iterators in the
+ * middle of a rehashing we can't mess with the two hash tables otherwise
+ * some element can be missed or duplicated.
+ *
+ * 在字典不存在安全迭代器的情况下，对字典进行单步 rehash 。
+ *
+ * 字典有安全迭代器的情况下不能进行 rehash ，
+ * 因为两种不同的迭代和修改操作可能会弄乱字典。
+ *
+ * This function is called by common lookup or update operations in the
+ * dictionary so that the hash table automatically migrates from H1 to H2
+ * while it is actively used.
+ *
+ * 这个函数被多个通用的查找、更新操作调用，
+ * 它可以让字典在被使用的同时进行 rehash 。
+ *
+ * T = O(1)
+ */
+static void _dictRehashStep(dict *d) {
+    if (d->iterators == 0) dictRehash(d,1);
+}
+
+void dictEnableResize(void) {
+    dict_can_resize = 1;
+}
+
+void dictDisableResize(void) {
+    dict_can_resize = 0;
 }
 
 /* Our hash table capability is a power of two */
@@ -390,6 +720,536 @@ int dictReplace(dict *d, void *key, void *val)
     return 0;
 }
 
+/* dictReplaceRaw() is simply a version of dictAddRaw() that always
+ * returns the hash entry of the specified key, even if the key already
+ * exists and can't be added (in that case the entry of the already
+ * existing key is returned.)
+ *
+ * dictAddRaw() 根据给定 key 释放存在，执行以下动作：
+ *
+ * 1) key 已经存在，返回包含该 key 的字典节点
+ * 2) key 不存在，那么将 key 添加到字典
+ *
+ * 不论发生以上的哪一种情况，
+ * dictAddRaw() 都总是返回包含给定 key 的字典节点。
+ *
+ * T = O(N)
+ */
+dictEntry *dictReplaceRaw(dict *d, void *key) {
+
+    // 使用 key 在字典中查找节点
+    // T = O(1)
+    dictEntry *entry = dictFind(d,key);
+
+    // 如果节点找到了直接返回节点，否则添加并返回一个新节点
+    // T = O(N)
+    return entry ? entry : dictAddRaw(d,key);
+}
+
+/* Search and remove an element
+ *
+ * 查找并删除包含给定键的节点
+ *
+ * 参数 nofree 决定是否调用键和值的释放函数
+ * 0 表示调用，1 表示不调用
+ *
+ * 找到并成功删除返回 DICT_OK ，没找到则返回 DICT_ERR
+ *
+ * T = O(1)
+ */
+static int dictGenericDelete(dict *d, const void *key, int nofree)
+{
+    unsigned int h, idx;
+    dictEntry *he, *prevHe;
+    int table;
+
+    // 字典（的哈希表）为空
+    if (d->ht[0].size == 0) return DICT_ERR; /* d->ht[0].table is NULL */
+
+    // 进行单步 rehash ，T = O(1)
+    if (dictIsRehashing(d)) _dictRehashStep(d);
+
+    // 计算哈希值
+    h = dictHashKey(d, key);
+
+    // 遍历哈希表
+    // T = O(1)
+    for (table = 0; table <= 1; table++) {
+
+        // 计算索引值 
+        idx = h & d->ht[table].sizemask;
+        // 指向该索引上的链表
+        he = d->ht[table].table[idx];
+        prevHe = NULL;
+        // 遍历链表上的所有节点
+        // T = O(1)
+        while(he) {
+
+            if (dictCompareKeys(d, key, he->key)) {
+                // 超找目标节点
+
+                /* Unlink the element from the list */
+                // 从链表中删除
+                if (prevHe)
+                    prevHe->next = he->next;
+                else
+                    d->ht[table].table[idx] = he->next;
+
+                // 释放调用键和值的释放函数？
+                if (!nofree) {
+                    dictFreeKey(d, he);
+                    dictFreeVal(d, he);
+                }
+
+                // 释放节点本身
+                zfree(he);
+
+                // 更新已使用节点数量
+                d->ht[table].used--;
+
+                // 返回已找到信号
+                return DICT_OK;
+            }
+
+            prevHe = he;
+            he = he->next;
+        }
+
+        // 如果执行到这里，说明在 0 号哈希表中找不到给定键
+        // 那么根据字典是否正在进行 rehash ，决定要不要查找 1 号哈希表
+        if (!dictIsRehashing(d)) break;
+    }
+
+    // 没找到
+    return DICT_ERR; /* not found */
+}
+
+/*
+ * 从字典中删除包含给定键的节点
+ *
+ * 并且调用键值的释放函数来删除键值
+ *
+ * 找到并成功删除返回 DICT_OK ，没找到则返回 DICT_ERR
+ * T = O(1)
+ */
+int dictDelete(dict *ht, const void *key) {
+    return dictGenericDelete(ht,key,0);
+}
+
+/*
+ * 从字典中删除包含给定键的节点
+ *
+ * 但不调用键值的释放函数来删除键值
+ *
+ * 找到并成功删除返回 DICT_OK ，没找到则返回 DICT_ERR
+ * T = O(1)
+ */
+int dictDeleteNoFree(dict *ht, const void *key) {
+    return dictGenericDelete(ht,key,1);
+}
+
+/* Destroy an entire dictionary
+ *
+ * 删除哈希表上的所有节点，并重置哈希表的各项属性
+ *
+ * T = O(N)
+ */
+static int _dictClear(dict *d, dictht *ht, void(callback)(void *)) {
+    unsigned long i;
+
+    /* Free all the elements */
+    // 遍历整个哈希表
+    // T = O(N)
+    for (i = 0; i < ht->size && ht->used > 0; i++) {
+        dictEntry *he, *nextHe;
+
+        // 每清空 65536 个桶调用一次回调，让调用者有机会处理其他事情
+        if (callback && (i & 65535) == 0) callback(d->privdata);
+
+        // 跳过空索引
+        if ((he = ht->table[i]) == NULL) continue;
+
+        // 遍历整个链表
+        // T = O(1)
+        while(he) {
+            nextHe = he->next;
+            // 删除键
+            dictFreeKey(d, he);
+            // 删除值
+            dictFreeVal(d, he);
+            // 释放节点
+            zfree(he);
+
+            // 更新已使用节点计数
+            ht->used--;
+
+            // 处理下个节点
+            he = nextHe;
+        }
+    }
+
+    /* Free the table and the allocated cache structure */
+    // 释放哈希表结构
+    zfree(ht->table);
+
+    /* Re-initialize the table */
+    // 重置哈希表属性
+    _dictReset(ht);
+
+    return DICT_OK; /* never fails */
+}
+
+/* Clear & Release the hash table */
+/*
+ * 删除并释放整个字典
+ *
+ * T = O(N)
+ */
+void dictRelease(dict *d)
+{
+    // 删除并清空两个哈希表
+    _dictClear(d,&d->ht[0],NULL);
+    _dictClear(d,&d->ht[1],NULL);
+    // 释放节点结构
+    zfree(d);
+}
+
+/*
+ * 清空字典上的所有哈希表节点，并重置字典属性
+ *
+ * T = O(N)
+ */
+void dictEmpty(dict *d, void(callback)(void*)) {
+
+    // 删除两个哈希表上的所有节点
+    // T = O(N)
+    _dictClear(d,&d->ht[0],callback);
+    _dictClear(d,&d->ht[1],callback);
+    // 重置属性 
+    d->rehashidx = -1;
+    d->iterators = 0;
+}
+
+/* A fingerprint is a 64 bit number that represents the state of the dictionary
+ * at a given time, it's just a few dict properties xored together.
+ * When an unsafe iterator is initialized, we get the dict fingerprint, and check
+ * the fingerprint again when the iterator is released.
+ * If the two fingerprints are different it means that the user of the iterator
+ * performed forbidden operations against the dictionary while iterating. */
+static long long dictFingerprint(dict *d) {
+    long long integers[6], hash = 0;
+    int j;
+
+    integers[0] = (long) d->ht[0].table;
+    integers[1] = d->ht[0].size;
+    integers[2] = d->ht[0].used;
+    integers[3] = (long) d->ht[1].table;
+    integers[4] = d->ht[1].size;
+    integers[5] = d->ht[1].used;
+
+    /* We hash N integers by summing every successive integer with the integer
+     * hashing of the previous sum. Basically:
+     *
+     * Result = hash(hash(hash(int1)+int2)+int3) ...
+     *
+     * This way the same set of integers in a different order will (likely) hash
+     * to a different number. */
+    for (j = 0; j < 6; j++) {
+        hash += integers[j];
+        /* For the hashing step we use Tomas Wang's 64 bit integer hash. */
+        hash = (~hash) + (hash << 21); // hash = (hash << 21) - hash - 1;
+        hash = hash ^ (hash >> 24);
+        hash = (hash + (hash << 3)) + (hash << 8); // hash * 265
+        hash = hash ^ (hash >> 14);
+        hash = (hash + (hash << 2)) + (hash << 4); // hash * 21
+        hash = hash ^ (hash >> 28);
+        hash = hash + (hash << 31);
+    }
+    return hash;
+}
+
+/*
+ * 创建并返回给定字典的不安全迭代器
+ *
+ * T = O(1)
+ */
+dictIterator *dictGetIterator(dict *d)
+{
+    dictIterator *iter = zmalloc(sizeof(*iter));
+
+    iter->d = d;
+    iter->table = 0;
+    iter->index = -1;
+    iter->safe = 0;
+    iter->entry = NULL;
+    iter->nextEntry = NULL;
+
+    return iter;
+}
+
+/*
+ * 创建并返回给定节点的安全迭代器
+ *
+ * T = O(1)
+ */
+dictIterator *dictGetSafeIterator(dict *d) {
+    dictIterator *i = dictGetIterator(d);
+
+    // 设置安全迭代器标识
+    i->safe = 1;
+
+    return i;
+}
+
+/*
+ * 返回迭代器指向的当前节点
+ *
+ * 字典迭代完毕时，返回 NULL
+ *
+ * T = O(1)
+ */
+dictEntry *dictNext(dictIterator *iter)
+{
+    while (1) {
+
+        // 进入这个循环有两种可能：
+        // 1) 这是迭代器第一次运行
+        // 2) 当前索引链表中的节点已经迭代完（NULL 为链表的表尾）
+        if (iter->entry == NULL) {
+
+            // 指向被迭代的哈希表
+            dictht *ht = &iter->d->ht[iter->table];
+
+            // 初次迭代时执行
+            if (iter->index == -1 && iter->table == 0) {
+                // 如果是安全迭代器，那么更新安全迭代器计数器
+                if (iter->safe)
+                    iter->d->iterators++;
+                // 如果是不安全迭代器，那么计算指纹
+                else
+                    iter->fingerprint = dictFingerprint(iter->d);
+            }
+            // 更新索引
+            iter->index++;
+
+            // 如果迭代器的当前索引大于当前被迭代的哈希表的大小
+            // 那么说明这个哈希表已经迭代完毕
+            if (iter->index >= (signed) ht->size) {
+                // 如果正在 rehash 的话，那么说明 1 号哈希表也正在使用中
+                // 那么继续对 1 号哈希表进行迭代
+                if (dictIsRehashing(iter->d) && iter->table == 0) {
+                    iter->table++;
+                    iter->index = 0;
+                    ht = &iter->d->ht[1];
+                // 如果没有 rehash ，那么说明迭代已经完成
+                } else {
+                    break;
+                }
+            }
+
+            // 如果进行到这里，说明这个哈希表并未迭代完
+            // 更新节点指针，指向下个索引链表的表头节点
+            iter->entry = ht->table[iter->index];
+        } else {
+            // 执行到这里，说明程序正在迭代某个链表
+            // 将节点指针指向链表的下个节点
+            iter->entry = iter->nextEntry;
+        }
+
+        // 如果当前节点不为空，那么也记录下该节点的下个节点
+        // 因为安全迭代器有可能会将迭代器返回的当前节点删除
+        if (iter->entry) {
+            /* We need to save the 'next' here, the iterator user
+             * may delete the entry we are returning. */
+            iter->nextEntry = iter->entry->next;
+            return iter->entry;
+        }
+    }
+
+    // 迭代完毕
+    return NULL;
+}
+
+/*
+ * 释放给定字典迭代器
+ *
+ * T = O(1)
+ */
+void dictReleaseIterator(dictIterator *iter)
+{
+    if (!(iter->index == -1 && iter->table == 0)) {
+        // 释放安全迭代器时，安全迭代器计数器减一
+        if (iter->safe)
+            iter->d->iterators--;
+        // 释放不安全迭代器时，验证指纹是否有变化
+        else
+            redisAssert(iter->fingerprint == dictFingerprint(iter->d));
+    }
+    zfree(iter);
+}
+
+/* Return a random entry from the hash table. Useful to
+ * implement randomized algorithms
+ *
+ * 随机返回字典中任意一个节点。
+ *
+ * 可用于实现随机化算法。
+ *
+ * 如果字典为空，返回 NULL 。
+ *
+ * T = O(N)
+ */
+dictEntry *dictGetRandomKey(dict *d)
+{
+    dictEntry *he, *orighe;
+    unsigned int h;
+    int listlen, listele;
+
+    // 字典为空
+    if (dictSize(d) == 0) return NULL;
+
+    // 进行单步 rehash
+    if (dictIsRehashing(d)) _dictRehashStep(d);
+
+    // 如果正在 rehash ，那么将 1 号哈希表也作为随机查找的目标
+    if (dictIsRehashing(d)) {
+        // T = O(N)
+        do {
+            /* We are sure there are no elements in indexes from 0
+             * to rehashidx-1 */
+            h = d->rehashidx + (random() % (d->ht[0].size +
+                                            d->ht[1].size -
+                                            d->rehashidx));
+            he = (h >= d->ht[0].size) ? d->ht[1].table[h - d->ht[0].size] :
+                                      d->ht[0].table[h];
+        } while(he == NULL);
+    // 否则，只从 0 号哈希表中查找节点
+    } else {
+        // T = O(N)
+        do {
+            h = random() & d->ht[0].sizemask;
+            he = d->ht[0].table[h];
+        } while(he == NULL);
+    }
+
+    /* Now we found a non empty bucket, but it is a linked
+     * list and we need to get a random element from the list.
+     * The only sane way to do so is counting the elements and
+     * select a random index. */
+    // 目前 he 已经指向一个非空的节点链表
+    // 程序将从这个链表随机返回一个节点
+    listlen = 0;
+    orighe = he;
+    // 计算节点数量, T = O(1)
+    while(he) {
+        he = he->next;
+        listlen++;
+    }
+    // 取模，得出随机节点的索引
+    listele = random() % listlen;
+    he = orighe;
+    // 按索引查找节点
+    // T = O(1)
+    while(listele--) he = he->next;
+
+    // 返回随机节点
+    return he;
+}
+
+/* This function samples the dictionary to return a few keys from random
+ * locations.
+ *
+ * 从字典的随机位置开始，连续取出最多 count 个节点，保存在 des 数组中，
+ * 返回实际取出的节点数量。
+ *
+ * It does not guarantee to return all the keys specified in 'count', nor
+ * it does guarantee to return non-duplicated elements, however it will make
+ * some effort to do both things.
+ *
+ * 函数不保证一定能取出 count 个节点，也不保证节点不重复。
+ *
+ * The function is much faster than calling dictGetRandomKey() 'count'
+ * times: instead of looking for a random non empty bucket for every key,
+ * it visits consecutive buckets starting at a random one, jumping to a new
+ * random position only after a long run of empty buckets. This is what
+ * the eviction pool needs: many samples, cheaply.
+ *
+ * 相比调用 count 次 dictGetRandomKey() ，这个函数要快得多，
+ * 因为它从一个随机的桶开始连续访问，只有遇到一长串空桶时才重新随机定位。
+ *
+ * T = O(N)
+ */
+unsigned int dictGetSomeKeys(dict *d, dictEntry **des, unsigned int count) {
+    unsigned long j; /* internal hash table id, 0 or 1. */
+    unsigned long tables; /* 1 or 2 tables? */
+    unsigned long stored = 0, maxsizemask;
+    unsigned long maxsteps;
+    unsigned long i, emptylen = 0;
+
+    if (dictSize(d) < count) count = dictSize(d);
+    maxsteps = count*10;
+
+    /* Try to do a rehashing work proportional to 'count'. */
+    // 按 count 的比例进行单步 rehash
+    for (j = 0; j < count; j++) {
+        if (dictIsRehashing(d))
+            _dictRehashStep(d);
+        else
+            break;
+    }
+
+    tables = dictIsRehashing(d) ? 2 : 1;
+    maxsizemask = d->ht[0].sizemask;
+    if (tables > 1 && maxsizemask < d->ht[1].sizemask)
+        maxsizemask = d->ht[1].sizemask;
+
+    /* Pick a random point inside the larger table. */
+    // 在较大的哈希表中随机选一个起点
+    i = random() & maxsizemask;
+    while(stored < count && maxsteps--) {
+        for (j = 0; j < tables; j++) {
+            /* Invariant of the dict.c rehashing: up to the indexes already
+             * visited in ht[0] during the rehashing, there are no populated
+             * buckets, so we can skip ht[0] for indexes between 0 and idx-1. */
+            // rehashidx 之前的 0 号哈希表桶都已经被迁移，为空
+            if (tables == 2 && j == 0 && i < (unsigned long) d->rehashidx) {
+                /* Moreover, if we are currently out of range in the second
+                 * table, there will be no elements in both tables up to
+                 * the current rehashing index, so we jump if possible.
+                 * (this happens when going from big to small table). */
+                if (i >= d->ht[1].size) i = d->rehashidx;
+                continue;
+            }
+            if (i >= d->ht[j].size) continue; /* Out of range for this table. */
+            dictEntry *he = d->ht[j].table[i];
+
+            /* Count contiguous empty buckets, and jump to other
+             * locations if they reach 'count' (with a minimum of 5). */
+            // 连续遇到太多空桶时，重新随机选择起点
+            if (he == NULL) {
+                emptylen++;
+                if (emptylen >= 5 && emptylen > count) {
+                    i = random() & maxsizemask;
+                    emptylen = 0;
+                }
+            } else {
+                emptylen = 0;
+                while (he) {
+                    /* Collect all the elements of the buckets found non
+                     * empty while iterating. */
+                    *des = he;
+                    des++;
+                    he = he->next;
+                    stored++;
+                    if (stored == count) return stored;
+                }
+            }
+        }
+        i = (i+1) & maxsizemask;
+    }
+    return stored;
+}
+
 void dictSdsDestructor(void *privdata, void *val)
 {
     DICT_NOTUSED(privdata);
@@ -405,3 +1265,40 @@ void dictRedisObjectDestructor(void *privdata, void *val)
     decrRefCount(val);
 }
 
+/*
+ * 收集字典的填充率和链表长度统计信息
+ *
+ * 当哈希表的桶数量超过 DICT_STATS_MAX_SAMPLE 时，
+ * 只按固定步长采样 DICT_STATS_MAX_SAMPLE 个桶，
+ * 保证 INFO 命令不会因为遍历大哈希表而阻塞服务器。
+ */
+void dictGetStats(dict *d, dictStats *stats) {
+    dictht *ht = &d->ht[0];
+    unsigned long i, step;
+
+    memset(stats,0,sizeof(*stats));
+    stats->buckets = ht->size;
+    stats->elements = ht->used;
+    if (ht->used == 0) return;
+
+    step = (ht->size > DICT_STATS_MAX_SAMPLE) ?
+           ht->size/DICT_STATS_MAX_SAMPLE : 1;
+
+    for (i = 0; i < ht->size; i += step) {
+        dictEntry *he;
+        unsigned long chainlen = 0;
+
+        stats->sampled++;
+        if (ht->table[i] == NULL) continue;
+
+        // 计算链表长度
+        he = ht->table[i];
+        while(he) {
+            chainlen++;
+            he = he->next;
+        }
+        stats->used_buckets++;
+        stats->chain_total += chainlen;
+        if (chainlen > stats->max_chain) stats->max_chain = chainlen;
+    }
+}
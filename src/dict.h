@@ -39,8 +39,21 @@
         entry->v.val = (_val_); \
 } while(0)
 
+// 释放给定字典节点的键
+#define dictFreeKey(d, entry) \
+    if ((d)->type->keyDestructor) \
+        (d)->type->keyDestructor((d)->privdata, (entry)->key)
+
+// 设置给定字典节点的有符号整数值
+#define dictSetSignedIntegerVal(entry, _val_) \
+    do { entry->v.s64 = _val_; } while(0)
+
+// 返回获取给定节点的键
+#define dictGetKey(he) ((he)->key)
 // 返回获取给定节点的值
 #define dictGetVal(he) ((he)->v.val)
+// 返回获取给定节点的有符号整数值
+#define dictGetSignedIntegerVal(he) ((he)->v.s64)
 
 // 释放给定字典节点的值
 #define dictFreeVal(d, entry) \
@@ -125,15 +138,91 @@ typedef struct dict {
     dictType *type;
 
     // 哈希表
-    dictht ht[1];
+    dictht ht[2];
+
+    // rehash 索引
+    // 当 rehash 不在进行时，值为 -1
+    long rehashidx; /* rehashing not in progress if rehashidx == -1 */
+
+    // 目前正在运行的安全迭代器的数量
+    int iterators; /* number of iterators currently running */
 
     void *privdata;
 } dict;
 
+/* If safe is set to 1 this is a safe iterator, that means, you can call
+ * dictAdd, dictFind, and other functions against the dictionary even while
+ * iterating. Otherwise it is a non safe iterator, and only dictNext()
+ * should be called while iterating.
+ *
+ * 如果 safe 属性的值为 1 ，那么在迭代进行的过程中，
+ * 程序仍然可以执行 dictAdd 、 dictFind 和其他函数，对字典进行修改。
+ *
+ * 如果 safe 不为 1 ，那么程序只会调用 dictNext 对字典进行迭代，
+ * 而不对字典进行修改。
+ */
+typedef struct dictIterator {
+
+    // 被迭代的字典
+    dict *d;
+
+    // table ：正在被迭代的哈希表号码，值可以是 0 或 1 。
+    // index ：迭代器当前所指向的哈希表索引位置。
+    // safe ：标识这个迭代器是否安全
+    int table, index, safe;
+
+    // entry ：当前迭代到的节点的指针
+    // nextEntry ：当前迭代节点的下一个节点
+    //             因为在安全迭代器运作时， entry 所指向的节点可能会被修改，
+    //             所以需要一个额外的指针来保存下一节点的位置，
+    //             从而防止指针丢失
+    dictEntry *entry, *nextEntry;
+
+    long long fingerprint; /* unsafe iterator fingerprint for misuse detection */
+} dictIterator;
+
+
+
+/*
+ * 哈希表的统计信息，由 dictGetStats 填充
+ */
+typedef struct dictStats {
+
+    // 哈希表大小（桶的数量）
+    unsigned long buckets;
+
+    // 哈希表已有节点的数量
+    unsigned long elements;
+
+    // 被采样的桶数量（小表为全部）
+    unsigned long sampled;
+
+    // 被采样的桶中，非空桶的数量
+    unsigned long used_buckets;
+
+    // 被采样的桶中，最长链表的长度
+    unsigned long max_chain;
+
+    // 被采样的非空桶中，链表节点的总数
+    unsigned long chain_total;
+
+} dictStats;
+
+/* Max number of buckets dictGetStats() visits: bigger tables are sampled
+ * with a fixed stride so that INFO stays O(1) on large keyspaces. */
+#define DICT_STATS_MAX_SAMPLE 4096
 
+/* ------------------------------- Macros ------------------------------------*/
+// 返回给定字典的大小
+#define dictSlots(d) ((d)->ht[0].size+(d)->ht[1].size)
+// 返回字典的已有节点数量
+#define dictSize(d) ((d)->ht[0].used+(d)->ht[1].used)
+// 查看字典是否正在 rehash
+#define dictIsRehashing(ht) ((ht)->rehashidx != -1)
 
 /* API */
 dictEntry * dictFind(dict *d, const void *key);
+void dictPrefetch(dict *d, const void *key);
 
 dict *dictCreate(dictType *type, void *privDataPtr);
 unsigned int dictGenHashFunction(const void *key, int len);
@@ -144,8 +233,27 @@ int dictAdd(dict *d, void *key, void *val);
 dictEntry *dictAddRaw(dict *d, void *key);
 
 int dictReplace(dict *d, void *key, void *val);
+dictEntry *dictReplaceRaw(dict *d, void *key);
 
 int dictExpand(dict *d, unsigned long size);
+int dictResize(dict *d);
+int dictDelete(dict *d, const void *key);
+int dictDeleteNoFree(dict *d, const void *key);
+void dictRelease(dict *d);
+void dictEmpty(dict *d, void(callback)(void*));
+void *dictFetchValue(dict *d, const void *key);
+dictIterator *dictGetIterator(dict *d);
+dictIterator *dictGetSafeIterator(dict *d);
+dictEntry *dictNext(dictIterator *iter);
+void dictReleaseIterator(dictIterator *iter);
+dictEntry *dictGetRandomKey(dict *d);
+unsigned int dictGetSomeKeys(dict *d, dictEntry **des, unsigned int count);
+int dictRehash(dict *d, int n);
+int dictRehashMilliseconds(dict *d, int ms);
+void dictEnableResize(void);
+void dictDisableResize(void);
+
+void dictGetStats(dict *d, dictStats *stats);
 
 unsigned int dictSdsCaseHash(const void *key);
 unsigned int dictGenCaseHashFunction(const unsigned char *buf, int len);
@@ -0,0 +1,524 @@
+/* Maxmemory directive handling (LRU eviction and other policies).
+ *
+ * 最大内存限制的处理：LRU / LFU / 随机 / TTL 淘汰策略
+ */
+#include "redis.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* ----------------------------------------------------------------------------
+ * Data structures
+ * --------------------------------------------------------------------------*/
+
+/* To improve the quality of the LRU approximation we take a set of keys
+ * that are good candidate for eviction across freeMemoryIfNeeded() calls.
+ *
+ * 为了提高近似 LRU 的精度，在多次 freeMemoryIfNeeded() 调用之间
+ * 保留一组最适合被淘汰的候选键。
+ *
+ * Entries inside the eviciton pool are taken ordered by idle time, putting
+ * greater idle times to the right (ascending order).
+ *
+ * 淘汰池中的键按空闲时间升序排列，空闲时间越长的越靠右。
+ *
+ * When an LFU policy is used instead, a reverse frequency indication is used
+ * instead of the idle time, so that we still evict by larger value (larger
+ * inverse frequency means to evict keys with the least frequent accesses).
+ *
+ * 使用 LFU 策略时，空闲时间换成 255 减去访问频率，
+ * 这样仍然是淘汰值最大的键。
+ *
+ * Empty entries have the key pointer set to NULL. */
+#define EVPOOL_SIZE 16
+#define EVPOOL_CACHED_SDS_SIZE 255
+struct evictionPoolEntry {
+    // 对象空闲时间（或者 LFU 的反向频率、TTL 的反向过期时间）
+    unsigned long long idle;    /* Object idle time (inverse frequency for LFU) */
+    // 键
+    sds key;                    /* Key name. */
+    // 预先分配的 sds ，用来保存较短的键，避免反复分配内存
+    sds cached;                 /* Cached SDS object for key name. */
+    // 键所在的数据库
+    int dbid;                   /* Key DB number. */
+};
+
+static struct evictionPoolEntry *EvictionPoolLRU;
+
+/* ----------------------------------------------------------------------------
+ * Implementation of eviction, aging and LRU
+ * --------------------------------------------------------------------------*/
+
+/* Return the LRU clock, based on the clock resolution. This is a time
+ * in a reduced-bits format that can be used to set and check the
+ * object->lru field of redisObject structures.
+ *
+ * 返回 REDIS_LRU_CLOCK_RESOLUTION 精度的 LRU 时钟
+ */
+unsigned int getLRUClock(void) {
+    return (mstime()/REDIS_LRU_CLOCK_RESOLUTION) & REDIS_LRU_CLOCK_MAX;
+}
+
+/* Given an object returns the min number of milliseconds the object was never
+ * requested, using an approximated LRU algorithm.
+ *
+ * 使用近似 LRU 算法，计算出给定对象的闲置时长（毫秒）
+ */
+unsigned long long estimateObjectIdleTime(robj *o) {
+    unsigned long long lruclock = LRU_CLOCK();
+    if (lruclock >= o->lru) {
+        return (lruclock - o->lru) * REDIS_LRU_CLOCK_RESOLUTION;
+    } else {
+        // LRU 时钟已经回绕
+        return (lruclock + (REDIS_LRU_CLOCK_MAX - o->lru)) *
+                    REDIS_LRU_CLOCK_RESOLUTION;
+    }
+}
+
+/* Create a new eviction pool.
+ *
+ * 创建淘汰池
+ */
+void evictionPoolAlloc(void) {
+    struct evictionPoolEntry *ep;
+    int j;
+
+    ep = zmalloc(sizeof(*ep)*EVPOOL_SIZE);
+    for (j = 0; j < EVPOOL_SIZE; j++) {
+        ep[j].idle = 0;
+        ep[j].key = NULL;
+        ep[j].cached = sdsnewlen(NULL,EVPOOL_CACHED_SDS_SIZE);
+        ep[j].dbid = 0;
+    }
+    EvictionPoolLRU = ep;
+}
+
+/* This is an helper function for freeMemoryIfNeeded(), it is used in order
+ * to populate the evictionPool with a few entries every time we want to
+ * expire a key. Keys with idle time smaller than one of the current
+ * keys are added. Keys are always added if there are free entries.
+ *
+ * freeMemoryIfNeeded() 的辅助函数：从 sampledict 中随机取样
+ * maxmemory-samples 个键，将比池中已有键更适合淘汰的键放入淘汰池。
+ * 池中有空位时，取样的键总是会被加入。
+ *
+ * We insert keys on place in ascending order, so keys with the smaller
+ * idle time are on the left, and keys with the higher idle time on the
+ * right.
+ *
+ * 键按空闲时间升序插入，空闲时间最长的在最右边。
+ */
+void evictionPoolPopulate(int dbid, dict *sampledict, dict *keydict, struct evictionPoolEntry *pool) {
+    int j, k, count;
+    dictEntry *samples[server.maxmemory_samples];
+
+    // 随机取样
+    count = dictGetSomeKeys(sampledict,samples,server.maxmemory_samples);
+    for (j = 0; j < count; j++) {
+        unsigned long long idle;
+        sds key;
+        robj *o = NULL;
+        dictEntry *de;
+
+        de = samples[j];
+        key = dictGetKey(de);
+
+        /* If the dictionary we are sampling from is not the main
+         * dictionary (but the expires one) we need to lookup the key
+         * again in the key dictionary to obtain the value object. */
+        // 从 expires 中取样时，需要到键空间里取出值对象
+        if (server.maxmemory_policy != MAXMEMORY_VOLATILE_TTL) {
+            if (sampledict != keydict) de = dictFind(keydict, key);
+            o = dictGetVal(de);
+        }
+
+        /* Calculate the idle time according to the policy. This is called
+         * idle just because the code initially handled LRU, but is in fact
+         * just a score where an higher score means better candidate. */
+        // 根据策略计算分值，分值越高越适合被淘汰
+        if (server.maxmemory_policy & MAXMEMORY_FLAG_LRU) {
+            idle = estimateObjectIdleTime(o);
+        } else if (server.maxmemory_policy & MAXMEMORY_FLAG_LFU) {
+            /* When we use an LRU policy, we sort the keys by idle time
+             * so that we expire keys starting from greater idle time.
+             * However when the policy is an LFU one, we have a frequency
+             * estimation, and we want to evict keys with lower frequency
+             * first. So inside the pool we put objects using the inverted
+             * frequency subtracting the actual frequency to the maximum
+             * frequency of 255. */
+            idle = 255-LFUDecrAndReturn(o);
+        } else {
+            /* In this case the sooner the expire the better. */
+            // 越早过期的键越适合被淘汰
+            idle = ULLONG_MAX - (long long)dictGetSignedIntegerVal(de);
+        }
+
+        /* Insert the element inside the pool.
+         * First, find the first empty bucket or the first populated
+         * bucket that has an idle time smaller than our idle time. */
+        // 找到插入位置
+        k = 0;
+        while (k < EVPOOL_SIZE &&
+               pool[k].key &&
+               pool[k].idle < idle) k++;
+        if (k == 0 && pool[EVPOOL_SIZE-1].key != NULL) {
+            /* Can't insert if the element is < the worst element we have
+             * and there are no empty buckets. */
+            // 池已满，并且这个键比池中所有键都更不适合淘汰
+            continue;
+        } else if (k < EVPOOL_SIZE && pool[k].key == NULL) {
+            /* Inserting into empty position. No setup needed before insert. */
+            // 插入到空位
+        } else {
+            /* Inserting in the middle. Now k points to the first element
+             * greater than the element to insert.  */
+            if (pool[EVPOOL_SIZE-1].key == NULL) {
+                /* Free space on the right? Insert at k shifting
+                 * all the elements from k to end to the right. */
+                // 右边还有空位，将 k 之后的元素右移
+
+                /* Save SDS before overwriting. */
+                sds cached = pool[EVPOOL_SIZE-1].cached;
+                memmove(pool+k+1,pool+k,
+                    sizeof(pool[0])*(EVPOOL_SIZE-k-1));
+                pool[k].cached = cached;
+            } else {
+                /* No free space on right? Insert at k-1 */
+                // 右边没有空位，丢弃最左边（最不适合淘汰）的元素，
+                // 将 k 之前的元素左移
+                k--;
+                /* Shift all elements on the left of k (included) to the
+                 * left, so we discard the element with smaller idle time. */
+                sds cached = pool[0].cached; /* Save SDS before overwriting. */
+                if (pool[0].key != pool[0].cached) sdsfree(pool[0].key);
+                memmove(pool,pool+1,sizeof(pool[0])*k);
+                pool[k].cached = cached;
+            }
+        }
+
+        /* Try to reuse the cached SDS string allocated in the pool entry,
+         * because allocating and deallocating this object is costly
+         * (according to the profiler, not my fantasy. Remember:
+         * premature optimizbla bla bla bla. */
+        // 较短的键直接复制到预先分配的 sds 中
+        int klen = sdslen(key);
+        if (klen > EVPOOL_CACHED_SDS_SIZE) {
+            pool[k].key = sdsdup(key);
+        } else {
+            memcpy(pool[k].cached,key,klen+1);
+            sdssetlen(pool[k].cached,klen);
+            pool[k].key = pool[k].cached;
+        }
+        pool[k].idle = idle;
+        pool[k].dbid = dbid;
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * LFU (Least Frequently Used) implementation.
+ *
+ * We have 24 total bits of space in each object in order to implement
+ * an LFU (Least Frequently Used) eviction policy, since we re-use the
+ * LRU field for this purpose.
+ *
+ * LFU 策略复用对象的 24 位 lru 字段：
+ *
+ * We split the 24 bits into two fields:
+ *
+ *          16 bits      8 bits
+ *     +----------------+--------+
+ *     + Last decr time | LOG_C  |
+ *     +----------------+--------+
+ *
+ * LOG_C is a logarithmic counter that provides an indication of the access
+ * frequency. However this field must also be decremented otherwise what used
+ * to be a frequently accessed key in the past, will remain ranked like that
+ * forever, while we want the algorithm to adapt to access pattern changes.
+ *
+ * LOG_C 是对数访问计数器（Morris 计数器），8 位最多表示百万级的访问次数；
+ * 计数器还需要随时间衰减，让算法能适应访问模式的变化。
+ *
+ * So the remaining 16 bits are used in order to store the "decrement time",
+ * a reduced-precision Unix time (we take 16 bits of the time converted
+ * in minutes since we don't care about wrapping around) where the LOG_C
+ * counter is halved if it has an high value, or just decremented if it
+ * has a low value.
+ *
+ * 高 16 位保存最后一次衰减的时间（以分钟为单位，允许回绕）。
+ *
+ * New keys don't start at zero, in order to have the ability to collect
+ * some accesses before being trashed away, so they start at LFU_INIT_VAL.
+ *
+ * 新键的计数器从 LFU_INIT_VAL 开始，避免刚创建就被淘汰。
+ * --------------------------------------------------------------------------*/
+
+/* Return the current time in minutes, just taking the least significant
+ * 16 bits. The returned time is suitable to be stored as LDT (last decrement
+ * time) for the LFU implementation.
+ *
+ * 返回以分钟为单位的当前时间的低 16 位
+ */
+unsigned long LFUGetTimeInMinutes(void) {
+    return (time(NULL)/60) & 65535;
+}
+
+/* Given an object last access time, compute the minimum number of minutes
+ * that elapsed since the last access. Handle overflow (ldt greater than
+ * the current 16 bits minutes time) considering the time as wrapping
+ * exactly once.
+ *
+ * 计算从 ldt 到现在经过的分钟数，处理一次回绕
+ */
+unsigned long LFUTimeElapsed(unsigned long ldt) {
+    unsigned long now = LFUGetTimeInMinutes();
+    if (now >= ldt) return now-ldt;
+    return 65535-ldt+now;
+}
+
+/* Logarithmically increment a counter. The greater is the current counter value
+ * the less likely is that it gets really implemented. Saturate it at 255.
+ *
+ * 以对数方式增加计数器：计数器越大，增加的概率越低，最大为 255
+ */
+uint8_t LFULogIncr(uint8_t counter) {
+    if (counter == 255) return 255;
+    double r = (double)rand()/RAND_MAX;
+    double baseval = counter - LFU_INIT_VAL;
+    if (baseval < 0) baseval = 0;
+    double p = 1.0/(baseval*server.lfu_log_factor+1);
+    if (r < p) counter++;
+    return counter;
+}
+
+/* If the object decrement time is reached decrement the LFU counter but
+ * do not update LFU fields of the object, we update the access time
+ * and counter in an explicit way when the object is really accessed.
+ * And we will times halve the counter according to the times of
+ * elapsed time than server.lfu_decay_time.
+ * Return the object frequency counter.
+ *
+ * 根据经过的时间衰减计数器：每经过 lfu-decay-time 分钟减一。
+ * 这个函数不修改对象，只返回衰减后的计数器。
+ */
+unsigned long LFUDecrAndReturn(robj *o) {
+    unsigned long ldt = o->lru >> 8;
+    unsigned long counter = o->lru & 255;
+    unsigned long num_periods = server.lfu_decay_time ?
+        LFUTimeElapsed(ldt) / server.lfu_decay_time : 0;
+    if (num_periods)
+        counter = (num_periods > counter) ? 0 : counter - num_periods;
+    return counter;
+}
+
+/* Update LFU when an object is accessed.
+ * Firstly, decrement the counter if the decrement time is reached.
+ * Then logarithmically increment the counter, and update the access time.
+ *
+ * 对象被访问时，先衰减计数器，再以对数方式增加，最后更新衰减时间
+ */
+void updateLFU(robj *val) {
+    unsigned long counter = LFUDecrAndReturn(val);
+    counter = LFULogIncr(counter);
+    val->lru = (LFUGetTimeInMinutes()<<8) | counter;
+}
+
+/* ----------------------------------------------------------------------------
+ * The external API for eviction: freeMemroyIfNeeded() is called by the
+ * server when there is data to add in order to make space if needed.
+ * --------------------------------------------------------------------------*/
+
+/* This function is periodically called to see if there is memory to free
+ * according to the current "maxmemory" settings. In case we are over the
+ * memory limit, the function will try to free some memory to return back
+ * under the limit.
+ *
+ * 检查内存使用是否超过 maxmemory ，如果是的话，按照淘汰策略删除键，
+ * 直到内存使用回到限制之下。
+ *
+ * The function returns REDIS_OK if we are under the memory limit or if we
+ * were over the limit, but the attempt to free memory was successful.
+ * Otehrwise if we are over the memory limit, but not enough memory
+ * was freed to return under the limit, the function returns REDIS_ERR.
+ *
+ * 内存在限制之内，或者成功释放了足够的内存时返回 REDIS_OK ，
+ * 否则返回 REDIS_ERR 。
+ */
+int freeMemoryIfNeeded(void) {
+    size_t mem_used, mem_tofree, mem_freed;
+    long long delta;
+
+    // 计算出 Redis 目前占用的内存总数
+    mem_used = zmalloc_used_memory();
+
+    /* Remove the size of the AOF buffer from the count of used memory:
+     * it is flushed at every event loop iteration, and freeing keys would
+     * only make it grow with the DELs. */
+    // AOF 缓冲区的大小不计算在内：它在每次事件循环中都会被清空，
+    // 而淘汰键只会让它因为 DEL 命令而变得更大
+    if (server.aof_state != REDIS_AOF_OFF) {
+        size_t aofbuf = sdslen(server.aof_buf);
+        mem_used = (mem_used > aofbuf) ? mem_used-aofbuf : 0;
+    }
+
+    /* The same goes for the output buffers of the slaves: every evicted key
+     * is propagated as a DEL, counting them would make the eviction feed
+     * itself until the keyspace is empty. */
+    // 从服务器的输出缓冲区同样不计算在内：
+    // 每个被淘汰的键都会以 DEL 命令传播给从服务器，计算它们会导致淘汰不停地进行下去
+    if (listLength(server.slaves)) {
+        listIter li;
+        listNode *ln;
+
+        listRewind(server.slaves,&li);
+        while((ln = listNext(&li)) != NULL) {
+            redisClient *slave = listNodeValue(ln);
+            unsigned long obuf_bytes = getClientOutputBufferMemoryUsage(slave);
+
+            mem_used = (mem_used > obuf_bytes) ? mem_used-obuf_bytes : 0;
+        }
+    }
+
+    /* Check if we are over the memory limit. */
+    // 如果目前使用的内存大小比设置的 maxmemory 要小，那么无须执行进一步操作
+    if (mem_used <= server.maxmemory) return REDIS_OK;
+
+    // 如果占用内存比 maxmemory 要大，但是 maxmemory 策略为不淘汰，那么直接返回
+    if (server.maxmemory_policy == MAXMEMORY_NO_EVICTION)
+        return REDIS_ERR; /* We need to free memory, but policy forbids. */
+
+    /* Compute how much memory we need to free. */
+    // 计算需要释放多少字节的内存
+    mem_tofree = mem_used - server.maxmemory;
+
+    // 初始化已释放内存的字节数为 0
+    mem_freed = 0;
+
+    // 根据 maxmemory 策略，
+    // 遍历字典，释放内存并记录被释放内存的字节数
+    while (mem_freed < mem_tofree) {
+        int j, k, keys_freed = 0;
+        static unsigned int next_db = 0;
+        sds bestkey = NULL;
+        int bestdbid = 0;
+        redisDb *db;
+        dict *dict;
+        dictEntry *de;
+
+        if (server.maxmemory_policy & (MAXMEMORY_FLAG_LRU|MAXMEMORY_FLAG_LFU) ||
+            server.maxmemory_policy == MAXMEMORY_VOLATILE_TTL)
+        {
+            struct evictionPoolEntry *pool = EvictionPoolLRU;
+
+            while(bestkey == NULL) {
+                unsigned long total_keys = 0, keys;
+
+                /* We don't want to make local-db choices when expiring keys,
+                 * so to start populate the eviction pool sampling keys from
+                 * every DB. */
+                // 从所有数据库中取样，填充淘汰池
+                for (j = 0; j < server.dbnum; j++) {
+                    db = server.db+j;
+                    dict = (server.maxmemory_policy & MAXMEMORY_FLAG_ALLKEYS) ?
+                            db->dict : db->expires;
+                    if ((keys = dictSize(dict)) != 0) {
+                        evictionPoolPopulate(j, dict, db->dict, pool);
+                        total_keys += keys;
+                    }
+                }
+                if (!total_keys) break; /* No keys to evict. */
+
+                /* Go backward from best to worst element to evict. */
+                // 从最适合淘汰的键开始，找到一个仍然存在的键
+                for (k = EVPOOL_SIZE-1; k >= 0; k--) {
+                    if (pool[k].key == NULL) continue;
+                    bestdbid = pool[k].dbid;
+
+                    if (server.maxmemory_policy & MAXMEMORY_FLAG_ALLKEYS) {
+                        de = dictFind(server.db[pool[k].dbid].dict,
+                            pool[k].key);
+                    } else {
+                        de = dictFind(server.db[pool[k].dbid].expires,
+                            pool[k].key);
+                    }
+
+                    /* Remove the entry from the pool. */
+                    // 从淘汰池中删除这个键
+                    if (pool[k].key != pool[k].cached)
+                        sdsfree(pool[k].key);
+                    pool[k].key = NULL;
+                    pool[k].idle = 0;
+
+                    /* If the key exists, is our pick. Otherwise it is
+                     * a ghost and we need to try the next element. */
+                    // 键已经被删除的话，继续尝试下一个
+                    if (de) {
+                        bestkey = dictGetKey(de);
+                        break;
+                    } else {
+                        /* Ghost... Iterate again. */
+                    }
+                }
+            }
+        }
+
+        /* volatile-random and allkeys-random policy */
+        // 随机淘汰
+        else if (server.maxmemory_policy == MAXMEMORY_ALLKEYS_RANDOM ||
+                 server.maxmemory_policy == MAXMEMORY_VOLATILE_RANDOM)
+        {
+            /* When evicting a random key, we try to evict a key for
+             * each DB, so we use the static 'next_db' variable to
+             * incrementally visit all DBs. */
+            for (j = 0; j < server.dbnum; j++) {
+                k = (++next_db) % server.dbnum;
+                db = server.db+k;
+                dict = (server.maxmemory_policy == MAXMEMORY_ALLKEYS_RANDOM) ?
+                        db->dict : db->expires;
+                if (dictSize(dict) != 0) {
+                    de = dictGetRandomKey(dict);
+                    bestkey = dictGetKey(de);
+                    bestdbid = k;
+                    break;
+                }
+            }
+        }
+
+        /* Finally remove the selected key. */
+        // 删除被选中的键
+        if (bestkey) {
+            robj *keyobj;
+
+            db = server.db+bestdbid;
+            keyobj = createStringObject(bestkey,sdslen(bestkey));
+
+            /* We compute the amount of memory freed by dbSyncDelete() alone.
+             * It is possible that actually the memory needed to propagate
+             * the DEL in AOF and replication link is greater than the one
+             * we are freeing removing the key, but we can't account for
+             * that otherwise we would never exit the loop.
+             *
+             * The key is always deleted synchronously: memory handed to
+             * the lazy free thread would not show up in the delta.
+             *
+             * 总是同步删除，交给后台线程的内存不会体现在 delta 中。 */
+            // 计算删除键所释放的内存数量
+            propagateExpire(db,keyobj);
+            delta = (long long) zmalloc_used_memory();
+            dbSyncDelete(db,keyobj);
+            delta -= (long long) zmalloc_used_memory();
+            mem_freed += delta;
+            signalModifiedKey(db,keyobj);
+
+            // 对淘汰键的计数器增一
+            server.stat_evictedkeys++;
+
+            decrRefCount(keyobj);
+            keys_freed++;
+        }
+
+        // 没有键可以淘汰，放弃
+        if (!keys_freed) return REDIS_ERR; /* nothing to free... */
+    }
+
+    return REDIS_OK;
+}
@@ -0,0 +1,193 @@
+#include "redis.h"
+#include "bio.h"
+#include "cluster.h"
+
+/*
+ * 等待后台线程释放的对象数量
+ *
+ * Updated by the main thread when jobs are queued and by the bio thread
+ * when the objects are actually freed, so it is accessed atomically.
+ */
+static size_t lazyfree_objects = 0;
+
+/* Return the number of currently pending objects to free. */
+size_t lazyfreeGetPendingObjectsCount(void) {
+    return __atomic_load_n(&lazyfree_objects,__ATOMIC_RELAXED);
+}
+
+/* Return the amount of work needed in order to free an object.
+ *
+ * 返回释放对象所需的工作量。
+ *
+ * For strings the cost is dominated by handing the sds buffer back to the
+ * allocator: big buffers are served by mmap and their release goes through
+ * munmap, whose cost grows with the number of pages. So the effort is the
+ * size of the allocation in pages, and small strings cost 1 like any other
+ * single allocation.
+ *
+ * 对于字符串，代价主要是把 sds 缓冲区交还给分配器：
+ * 大的缓冲区由 mmap 分配，释放时的 munmap 代价和页数成正比，
+ * 所以工作量是分配的页数，小字符串和其他单次分配一样，代价为 1 。
+ */
+size_t lazyfreeGetFreeEffort(robj *obj) {
+    if (obj->type == REDIS_STRING && obj->encoding == REDIS_ENCODING_RAW) {
+        size_t pages = sdsAllocSize(obj->ptr) / 4096;
+        return pages ? pages : 1;
+    } else {
+        return 1; /* Everything else is a single allocation. */
+    }
+}
+
+/* Delete a key, value, and associated expiration entry if any, from the DB.
+ * If there are enough allocations to free the value object may be put into
+ * a lazy free list instead of being freed synchronously. The lazy free list
+ * will be reclaimed in a different bio.c thread.
+ *
+ * 从数据库中删除给定的键，键的值，以及键的过期时间。
+ * 如果释放值对象的工作量足够大，那么将它交给后台线程释放。
+ *
+ * 删除成功返回 1 ，因为键不存在而导致删除失败时，返回 0 。
+ */
+#define LAZYFREE_THRESHOLD 64
+int dbAsyncDelete(redisDb *db, robj *key) {
+    dictEntry *de;
+
+    /* Deleting an entry from the expires dict will not free the sds of
+     * the key, because it is shared with the main dictionary. */
+    // 删除键的过期时间
+    if (dictSize(db->expires) > 0) dictDelete(db->expires,key->ptr);
+
+    /* If the value is composed of a few allocations, to free in a lazy way
+     * is actually just slower... So under a certain limit we just free
+     * the object synchronously. */
+    de = dictFind(db->dict,key->ptr);
+    if (de) {
+        robj *val = dictGetVal(de);
+        size_t free_effort = lazyfreeGetFreeEffort(val);
+
+        /* If releasing the object is too much work, let's put it into the
+         * lazy free list. Only values referenced by the keyspace alone can
+         * be handed over: the refcount is not atomic, so an object that is
+         * still shared (for instance queued in a client reply list) must be
+         * released by the main thread. */
+        // 只有仅被数据库引用的对象才能交给后台线程，
+        // 因为引用计数不是原子的
+        if (free_effort > LAZYFREE_THRESHOLD && val->refcount == 1) {
+            __atomic_add_fetch(&lazyfree_objects,1,__ATOMIC_RELAXED);
+            bioCreateBackgroundJob(BIO_LAZY_FREE,val,NULL,NULL);
+            // 值已经交给后台线程，字典只需要释放键
+            dictSetVal(db->dict,de,NULL);
+        }
+    }
+
+    // 槽的索引引用了键的 sds ，所以要在删除键值对之前更新
+    if (server.cluster_enabled && db->id == 0) slotToKeyDel(key->ptr);
+
+    /* Release the key-val pair, or just the key if we set the val
+     * field to NULL in order to lazy free it later. */
+    // 删除键值对
+    if (dictDelete(db->dict,key->ptr) == DICT_OK) {
+        return 1;
+    } else {
+        // 键不存在
+        return 0;
+    }
+}
+
+/* Free an object, if the object is huge enough, free it in async way.
+ *
+ * 释放对象，如果对象足够大，那么交给后台线程释放。
+ */
+void freeObjAsync(robj *o) {
+    size_t free_effort = lazyfreeGetFreeEffort(o);
+    if (free_effort > LAZYFREE_THRESHOLD && o->refcount == 1) {
+        __atomic_add_fetch(&lazyfree_objects,1,__ATOMIC_RELAXED);
+        bioCreateBackgroundJob(BIO_LAZY_FREE,o,NULL,NULL);
+    } else {
+        decrRefCount(o);
+    }
+}
+
+/* Empty a Redis DB asynchronously. What the function does actually is to
+ * create a new empty set of hash tables and scheduling the old ones for
+ * lazy freeing.
+ *
+ * 异步地清空数据库：为数据库创建新的空字典，把旧的字典交给后台线程释放。
+ */
+void emptyDbAsync(redisDb *db) {
+    replaceDbAsync(db,dictCreate(&dbDictType,NULL),
+                      dictCreate(&keyptrDictType,NULL));
+}
+
+/* Release in the main thread the values of 'd' that are referenced by
+ * something else than the keyspace, like the reply list of a client or
+ * the queued commands of a transaction, and leave a NULL value in their
+ * place. The refcount is not atomic, so like in dbAsyncDelete() the bio
+ * thread must be the only owner of what it frees.
+ *
+ * 在主线程中释放 d 中除了键空间之外还被其他地方引用的值，并将值设为 NULL 。
+ * 和 dbAsyncDelete() 一样，因为引用计数不是原子的，
+ * 后台线程必须是它所释放对象的唯一拥有者。
+ */
+static void lazyfreeReleaseSharedValues(dict *d) {
+    dictIterator *di = dictGetIterator(d);
+    dictEntry *de;
+
+    while((de = dictNext(di)) != NULL) {
+        robj *val = dictGetVal(de);
+
+        if (val->refcount != 1) {
+            decrRefCount(val);
+            dictSetVal(d,de,NULL);
+        }
+    }
+    dictReleaseIterator(di);
+}
+
+/* Install 'keys' and 'expires' as the hash tables of the DB, scheduling the
+ * old ones for lazy freeing. Used to swap in a keyspace that was built on
+ * the side.
+ *
+ * 用给定的字典替换数据库的键空间和过期字典，旧的字典交给后台线程释放。 */
+void replaceDbAsync(redisDb *db, dict *keys, dict *expires) {
+    dict *oldht1 = db->dict, *oldht2 = db->expires;
+
+    // 旧键空间中以及新键空间中被监视的键都会改变
+    touchWatchedKeysOnFlush(db,keys);
+
+    /* The slots index references the key strings of the old keyspace,
+     * which are about to be released by the bio thread: rebuild it on
+     * the new one. */
+    // 槽的索引引用的是旧键空间的 sds ，所以要根据新的键空间重建
+    if (server.cluster_enabled && db->id == 0) {
+        dictIterator *di = dictGetIterator(keys);
+        dictEntry *de;
+
+        slotToKeyFlush();
+        while((de = dictNext(di)) != NULL) slotToKeyAdd(dictGetKey(de));
+        dictReleaseIterator(di);
+    }
+
+    lazyfreeReleaseSharedValues(oldht1);
+    db->dict = keys;
+    db->expires = expires;
+    __atomic_add_fetch(&lazyfree_objects,dictSize(oldht1),__ATOMIC_RELAXED);
+    bioCreateBackgroundJob(BIO_LAZY_FREE,NULL,oldht1,oldht2);
+}
+
+/* Release objects from the lazyfree thread. It's just decrRefCount()
+ * updating the count of objects to release. */
+void lazyfreeFreeObjectFromBioThread(robj *o) {
+    decrRefCount(o);
+    __atomic_sub_fetch(&lazyfree_objects,1,__ATOMIC_RELAXED);
+}
+
+/* Release a database from the lazyfree thread. The 'db' pointer is the
+ * database which was substituted with a fresh one in the main thread
+ * when the database was logically deleted. */
+void lazyfreeFreeDatabaseFromBioThread(dict *ht1, dict *ht2) {
+    size_t numkeys = dictSize(ht1);
+    dictRelease(ht1);
+    dictRelease(ht2);
+    __atomic_sub_fetch(&lazyfree_objects,numkeys,__ATOMIC_RELAXED);
+}
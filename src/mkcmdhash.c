@@ -0,0 +1,151 @@
+/*
+ * mkcmdhash -- generate the minimal perfect hash of the command table.
+ *
+ * 在编译期为 commands.def 中的所有命令名生成最小完美哈希表，
+ * 结果输出到标准输出，由 Makefile 重定向为 cmdhash_table.h 。
+ *
+ * The algorithm is "hash, displace": names are first split into buckets,
+ * then, from the biggest bucket to the smallest, we search a displacement
+ * that places every name of the bucket into a free slot. Since there are
+ * exactly as many slots as commands the hash is minimal, and since every
+ * slot holds one command the lookup is a single compare.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cmdhash.h"
+
+#define REDIS_COMMAND(name,...) name,
+static const char *names[] = {
+#include "commands.def"
+};
+#undef REDIS_COMMAND
+
+#define NUMCOMMANDS (sizeof(names)/sizeof(names[0]))
+
+
+static uint32_t *bucket_size;
+
+static int compareBuckets(const void *a, const void *b) {
+    uint32_t ba = *(const uint32_t*)a, bb = *(const uint32_t*)b;
+
+    // 大的桶先放置
+    if (bucket_size[ba] != bucket_size[bb])
+        return bucket_size[ba] > bucket_size[bb] ? -1 : 1;
+    return ba < bb ? -1 : (ba > bb);
+}
+
+/* Try to build the table with the given number of buckets. Returns 0 on
+ * success, -1 if some bucket can't be placed: two names of the same bucket
+ * may collide for every displacement, in which case the caller retries with
+ * a different number of buckets, which redistributes the names.
+ *
+ * 用给定的桶数量尝试生成哈希表，失败时由调用者换一个桶数量重试。 */
+static int buildTable(uint64_t *hashes, uint32_t size, uint32_t buckets,
+                      uint32_t *disp, int *slot_cmd)
+{
+    uint32_t j, k, i;
+    uint32_t *order = malloc(sizeof(uint32_t)*buckets);
+    uint32_t *tmp = malloc(sizeof(uint32_t)*size);
+    int retval = 0;
+
+    bucket_size = calloc(buckets,sizeof(uint32_t));
+    for (j = 0; j < size; j++) slot_cmd[j] = -1;
+    for (j = 0; j < buckets; j++) disp[j] = 0;
+    for (j = 0; j < size; j++)
+        bucket_size[cmdhashBucket(hashes[j],buckets)]++;
+
+    for (j = 0; j < buckets; j++) order[j] = j;
+    qsort(order,buckets,sizeof(uint32_t),compareBuckets);
+
+    // 为每个桶寻找一个能把桶内所有命令放进空槽的偏移值
+    for (i = 0; i < buckets; i++) {
+        uint32_t b = order[i], d, n;
+
+        if (bucket_size[b] == 0) break;
+        for (d = 0; d < size*size; d++) {
+            n = 0;
+            for (j = 0; j < size; j++) {
+                uint32_t slot;
+
+                if (cmdhashBucket(hashes[j],buckets) != b) continue;
+                slot = cmdhashSlot(hashes[j],d,size);
+                if (slot_cmd[slot] != -1) break;
+                for (k = 0; k < n; k++) if (tmp[k] == slot) break;
+                if (k != n) break;
+                tmp[n++] = slot;
+            }
+            if (j == size) break; /* Every name of the bucket placed. */
+        }
+        if (d == size*size) {
+            retval = -1;
+            break;
+        }
+        disp[b] = d;
+        for (j = 0; j < size; j++) {
+            if (cmdhashBucket(hashes[j],buckets) != b) continue;
+            slot_cmd[cmdhashSlot(hashes[j],d,size)] = j;
+        }
+    }
+
+    free(order);
+    free(tmp);
+    free(bucket_size);
+    return retval;
+}
+
+int main(void) {
+    uint32_t size = NUMCOMMANDS, buckets;
+    uint32_t j, k;
+    uint64_t *hashes = malloc(sizeof(uint64_t)*size);
+    uint32_t *disp = calloc(size*2+1,sizeof(uint32_t));
+    int *slot_cmd = malloc(sizeof(int)*size);
+
+    for (j = 0; j < size; j++) {
+        const char *p;
+
+        // 命令名必须是小写的，并且不能重复
+        for (p = names[j]; *p; p++) {
+            if (cmdhash_tolower[(unsigned char)*p] != (unsigned char)*p) {
+                fprintf(stderr,"mkcmdhash: command '%s' is not lowercase\n",
+                    names[j]);
+                return 1;
+            }
+        }
+        for (k = 0; k < j; k++) {
+            if (!strcmp(names[j],names[k])) {
+                fprintf(stderr,"mkcmdhash: duplicated command '%s'\n",
+                    names[j]);
+                return 1;
+            }
+        }
+        hashes[j] = cmdhashFunction((const unsigned char*)names[j],
+                                    strlen(names[j]));
+    }
+
+    // 从 N/2+1 个桶开始，失败时增加桶的数量
+    for (buckets = size/2+1; buckets <= size*2+1; buckets++)
+        if (buildTable(hashes,size,buckets,disp,slot_cmd) == 0) break;
+    if (buckets > size*2+1) {
+        fprintf(stderr,"mkcmdhash: can't build a perfect hash for %u commands\n",
+            size);
+        return 1;
+    }
+
+    printf("/* Automatically generated by mkcmdhash from commands.def,\n"
+           " * do not edit. */\n\n");
+    printf("#define CMDHASH_SIZE %u\n",size);
+    printf("#define CMDHASH_BUCKETS %u\n\n",buckets);
+    printf("static const uint32_t cmdhashDisp[CMDHASH_BUCKETS] = {");
+    for (j = 0; j < buckets; j++)
+        printf("%s%s%u", j ? "," : "", (j%12) ? "" : "\n    ", disp[j]);
+    printf("\n};\n\n");
+    printf("/* Slot -> index into redisCommandTable, and name length. */\n");
+    printf("static const struct { uint16_t index; uint16_t len; } "
+           "cmdhashSlots[CMDHASH_SIZE] = {");
+    for (j = 0; j < size; j++)
+        printf("%s\n    {%d,%u} /* %s */", j ? "," : "", slot_cmd[j],
+            (unsigned)strlen(names[slot_cmd[j]]), names[slot_cmd[j]]);
+    printf("\n};\n");
+    return 0;
+}
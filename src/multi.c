@@ -0,0 +1,482 @@
+/* MULTI/EXEC transactions and optimistic locking with WATCH.
+ *
+ * 事务与 WATCH 乐观锁
+ *
+ * While a client is in a MULTI context its commands are not executed but
+ * queued in c->mstate, and EXEC runs them all in a row. WATCH records keys
+ * that must not be modified before EXEC: every DB maps its watched keys to
+ * the list of clients watching them, so that a write touching a key only
+ * flags the clients in that list with REDIS_DIRTY_CAS, without looking at
+ * any other client. EXEC refuses to run a transaction of a dirty client.
+ *
+ * 客户端处于 MULTI 状态时，命令不会被执行，而是被放入 c->mstate 队列，
+ * 由 EXEC 一次执行完毕。WATCH 记录在 EXEC 之前不能被修改的键：
+ * 每个数据库都保存着被监视的键到监视它们的客户端链表的映射，
+ * 写命令修改一个键时，只需要将这个链表中的客户端标记为 REDIS_DIRTY_CAS ，
+ * 不需要检查其他客户端。EXEC 拒绝执行被标记的客户端的事务。
+ */
+
+#include "redis.h"
+
+/* ================================ MULTI/EXEC ============================== */
+
+/* Client state initialization for MULTI/EXEC
+ *
+ * 初始化客户端的事务状态
+ */
+void initClientMultiState(redisClient *c) {
+
+    // 命令队列
+    c->mstate.commands = NULL;
+
+    // 命令计数
+    c->mstate.count = 0;
+}
+
+/* Release all the resources associated with MULTI/EXEC state
+ *
+ * 释放所有事务状态相关的资源
+ */
+void freeClientMultiState(redisClient *c) {
+    int j;
+
+    // 遍历事务队列
+    for (j = 0; j < c->mstate.count; j++) {
+        int i;
+        multiCmd *mc = c->mstate.commands+j;
+
+        // 释放所有命令参数
+        for (i = 0; i < mc->argc; i++)
+            decrRefCount(mc->argv[i]);
+
+        // 释放参数数组本身
+        zfree(mc->argv);
+    }
+
+    // 释放事务队列
+    zfree(c->mstate.commands);
+}
+
+/* Add a new command into the MULTI commands queue
+ *
+ * 将一个新命令添加到事务队列中
+ */
+void queueMultiCommand(redisClient *c) {
+    multiCmd *mc;
+    int j;
+
+    // 为新命令分配空间
+    c->mstate.commands = zrealloc(c->mstate.commands,
+            sizeof(multiCmd)*(c->mstate.count+1));
+
+    // 指向新元素
+    mc = c->mstate.commands+c->mstate.count;
+
+    // 设置事务的命令、命令参数数量，以及命令的参数
+    mc->cmd = c->cmd;
+    mc->argc = c->argc;
+    mc->argv = zmalloc(sizeof(robj*)*c->argc);
+    memcpy(mc->argv,c->argv,sizeof(robj*)*c->argc);
+    for (j = 0; j < c->argc; j++)
+        incrRefCount(mc->argv[j]);
+
+    // 事务命令数量计数器增一
+    c->mstate.count++;
+}
+
+/* Leave the MULTI context: the queue is emptied and the watched keys are
+ * released.
+ *
+ * 退出事务状态：清空命令队列，并取消对所有键的监视
+ */
+void discardTransaction(redisClient *c) {
+
+    // 重置事务状态
+    freeClientMultiState(c);
+    initClientMultiState(c);
+
+    // 屏蔽事务状态
+    c->flags &= ~(REDIS_MULTI|REDIS_DIRTY_CAS|REDIS_DIRTY_EXEC);
+
+    // 取消对所有键的监视
+    unwatchAllKeys(c);
+}
+
+/* Flag the transacation as DIRTY_EXEC so that EXEC will fail.
+ * Should be called every time there is an error while queueing a command.
+ *
+ * 如果在入队命令时出错，那么打开客户端的 REDIS_DIRTY_EXEC 标识，
+ * 让之后的 EXEC 命令执行失败。
+ */
+void flagTransaction(redisClient *c) {
+    if (c->flags & REDIS_MULTI)
+        c->flags |= REDIS_DIRTY_EXEC;
+}
+
+void multiCommand(redisClient *c) {
+
+    // 不能在事务中嵌套事务
+    if (c->flags & REDIS_MULTI) {
+        addReplyError(c,"MULTI calls can not be nested");
+        return;
+    }
+
+    // 打开事务 FLAG
+    c->flags |= REDIS_MULTI;
+
+    addReply(c,shared.ok);
+}
+
+void discardCommand(redisClient *c) {
+
+    // 不能在客户端未进行事务状态之前使用
+    if (!(c->flags & REDIS_MULTI)) {
+        addReplyError(c,"DISCARD without MULTI");
+        return;
+    }
+
+    discardTransaction(c);
+
+    addReply(c,shared.ok);
+}
+
+/* Send a MULTI command to all the slaves and AOF file. Check the execCommand
+ * implementation for more information.
+ *
+ * 向所有从服务器和 AOF 文件传播 MULTI 命令。
+ */
+static void execCommandPropagateMulti(redisClient *c) {
+    propagate(server.multiCommand,c->db->id,&shared.multi,1,
+              REDIS_PROPAGATE_AOF|REDIS_PROPAGATE_REPL);
+}
+
+void execCommand(redisClient *c) {
+    int j;
+    robj **orig_argv;
+    int orig_argc;
+    struct redisCommand *orig_cmd;
+    int must_propagate = 0; /* Need to propagate MULTI/EXEC to AOF / slaves? */
+
+    // 客户端没有执行事务
+    if (!(c->flags & REDIS_MULTI)) {
+        addReplyError(c,"EXEC without MULTI");
+        return;
+    }
+
+    /* Check if we need to propagate MULTI/EXEC to AOF / slaves.
+     *
+     * 检查是否需要阻止事务执行，因为：
+     *
+     * 1) Some of the WATCHed keys were touched.
+     *    有被监视的键已经被修改了
+     *
+     * 2) There was a previous error while queueing commands.
+     *    命令在入队时发生错误
+     *
+     * A failed EXEC in the first case returns a multi bulk nil object
+     * (technically it is not an error but a special behavior), while
+     * in the second an EXECABORT error is returned.
+     *
+     * 第一种情况返回多个批量回复的空对象，而第二种情况则返回一个 EXECABORT 错误。
+     */
+    if (c->flags & (REDIS_DIRTY_CAS|REDIS_DIRTY_EXEC)) {
+        addReply(c, c->flags & REDIS_DIRTY_EXEC ? shared.execaborterr :
+                                                  shared.nullmultibulk);
+        discardTransaction(c);
+        return;
+    }
+
+    /* Exec all the queued commands */
+    // 已经可以保证安全性了，取消客户端对所有键的监视
+    unwatchAllKeys(c); /* Unwatch ASAP otherwise we'll waste CPU cycles */
+
+    // 因为事务中的命令在执行时可能会修改命令和命令的参数
+    // 所以为了正确地传播命令，需要先备份这些命令和参数
+    orig_argv = c->argv;
+    orig_argc = c->argc;
+    orig_cmd = c->cmd;
+
+    addReplyMultiBulkLen(c,c->mstate.count);
+
+    // 执行事务中的命令
+    for (j = 0; j < c->mstate.count; j++) {
+
+        // 因为 Redis 的命令必须在客户端的上下文中执行
+        // 所以要将事务队列中的命令、命令参数等设置给客户端
+        c->argc = c->mstate.commands[j].argc;
+        c->argv = c->mstate.commands[j].argv;
+        c->cmd = c->mstate.commands[j].cmd;
+
+        /* Propagate a MULTI request once we encounter the first write op.
+         * This way we'll deliver the MULTI/..../EXEC block as a whole and
+         * both the AOF and the replication link will have the same consistency
+         * and atomicity guarantees.
+         *
+         * 当遇上第一个写命令时，传播 MULTI 命令。
+         *
+         * 这可以确保服务器和 AOF 文件以及附属节点的数据一致性。
+         */
+        if (!must_propagate && (c->cmd->flags & REDIS_CMD_WRITE)) {
+            execCommandPropagateMulti(c);
+            must_propagate = 1;
+        }
+
+        // 执行命令
+        call(c,REDIS_CALL_FULL);
+
+        /* Commands may alter argc/argv, restore mstate. */
+        // 因为执行后命令、命令参数可能会被改变
+        // 比如 EXPIRE 可能会被改写为 DEL
+        // 所以这里需要更新事务队列中的命令和参数
+        // 确保附属节点和 AOF 的数据一致性
+        c->mstate.commands[j].argc = c->argc;
+        c->mstate.commands[j].argv = c->argv;
+        c->mstate.commands[j].cmd = c->cmd;
+    }
+
+    // 还原命令、命令参数
+    c->argv = orig_argv;
+    c->argc = orig_argc;
+    c->cmd = orig_cmd;
+
+    // 清理事务状态
+    discardTransaction(c);
+
+    /* Make sure the EXEC command will be propagated as well if MULTI
+     * was already propagated. */
+    // 将服务器设为脏，确保 EXEC 命令也会被传播
+    if (must_propagate) server.dirty++;
+}
+
+/* ===================== WATCH (CAS alike for MULTI/EXEC) ===================
+ *
+ * The implementation uses a per-DB hash table mapping keys to list of clients
+ * WATCHing those keys, so that given a key that is going to be modified
+ * we can mark all the associated clients as dirty.
+ *
+ * 实现为每个数据库准备一个字典，字典的键为数据库键，值为监视这个键的客户端链表，
+ * 当一个键被修改时，程序会将所有监视这个键的客户端都设置为 DIRTY 。
+ *
+ * Also every client contains a list of WATCHed keys so that's possible to
+ * un-watch such keys when the client is freed or when UNWATCH is called.
+ *
+ * 另外，每个客户端都带有一个被监视键的链表，
+ * 用于在事务执行或者 UNWATCH 命令执行时，快速地取消对所有被监视键的监视。
+ */
+
+/* In the client->watched_keys list we need to use watchedKey structures
+ * as in order to identify a key in Redis we need both the key name and the
+ * DB.
+ *
+ * 在监视一个键时，需要同时保存被监视的键，以及该键所在的数据库。
+ */
+typedef struct watchedKey {
+
+    // 被监视的键
+    robj *key;
+
+    // 键所在的数据库
+    redisDb *db;
+
+} watchedKey;
+
+/* Watch for the specified key
+ *
+ * 让客户端 c 监视给定的键 key
+ */
+static void watchForKey(redisClient *c, robj *key) {
+    list *clients = NULL;
+    listIter li;
+    listNode *ln;
+    watchedKey *wk;
+
+    /* Check if we are already watching for this key */
+    // 检查 key 是否已经保存在 watched_keys 链表中，
+    // 如果是的话，直接返回
+    listRewind(c->watched_keys,&li);
+    while((ln = listNext(&li))) {
+        wk = listNodeValue(ln);
+        if (wk->db == c->db &&
+            dictSdsKeyCompare(NULL,key->ptr,wk->key->ptr))
+            return; /* Key already watched */
+    }
+
+    // 键没有被监视
+    // 根据以下步骤，将它添加到数据库的 watched_keys 字典和客户端的链表中
+
+    /* This key is not already watched in this DB. Let's add it */
+    // 检查 key 是否存在于数据库的 watched_keys 字典中
+    clients = dictFetchValue(c->db->watched_keys,key->ptr);
+    // 如果不存在的话，添加它
+    if (!clients) {
+        // 值为链表
+        clients = listCreate();
+        // 关联键值对到字典
+        dictAdd(c->db->watched_keys,sdsdup(key->ptr),clients);
+    }
+    // 将客户端添加到链表的末尾
+    listAddNodeTail(clients,c);
+
+    /* Add the new key to the list of keys watched by this client */
+    // 将新 watchedKey 结构添加到客户端 watched_keys 链表的表尾
+    wk = zmalloc(sizeof(*wk));
+    wk->key = key;
+    wk->db = c->db;
+    incrRefCount(key);
+    listAddNodeTail(c->watched_keys,wk);
+}
+
+/* Unwatch all the keys watched by this client. To clean the EXEC dirty
+ * flag is up to the caller.
+ *
+ * 取消客户端对所有键的监视。
+ *
+ * 清除客户端事务状态的任务由调用者执行。
+ */
+void unwatchAllKeys(redisClient *c) {
+    listIter li;
+    listNode *ln;
+
+    // 没有键被监视，直接返回
+    if (listLength(c->watched_keys) == 0) return;
+
+    // 遍历链表中所有被客户端监视的键
+    listRewind(c->watched_keys,&li);
+    while((ln = listNext(&li))) {
+        list *clients;
+        watchedKey *wk;
+
+        /* Lookup the watched key -> clients list and remove the client
+         * from the list */
+        // 从数据库的 watched_keys 字典的 key 键中
+        // 删除链表里包含的客户端节点
+        wk = listNodeValue(ln);
+        // 取出客户端链表
+        clients = dictFetchValue(wk->db->watched_keys,wk->key->ptr);
+        redisAssertWithInfo(c,NULL,clients != NULL);
+        // 删除链表中的客户端节点
+        listDelNode(clients,listSearchKey(clients,c));
+
+        /* Kill the entry at all if this was the only client */
+        // 如果链表已经被清空，那么删除这个键
+        if (listLength(clients) == 0)
+            dictDelete(wk->db->watched_keys,wk->key->ptr);
+
+        /* Remove this watched key from the client->watched list */
+        // 从链表中移除 key 节点
+        listDelNode(c->watched_keys,ln);
+
+        decrRefCount(wk->key);
+        zfree(wk);
+    }
+}
+
+/* "Touch" a key, so that if this key is being WATCHed by some client the
+ * next EXEC will fail.
+ *
+ * “触碰”一个键，如果这个键正在被某个/某些客户端监视着，
+ * 那么这个/这些客户端在执行 EXEC 时事务将失败。
+ */
+void touchWatchedKey(redisDb *db, robj *key) {
+    list *clients;
+    listIter li;
+    listNode *ln;
+
+    // 字典为空，没有任何键被监视
+    if (dictSize(db->watched_keys) == 0) return;
+
+    // 获取所有监视这个键的客户端
+    clients = dictFetchValue(db->watched_keys, key->ptr);
+    if (!clients) return;
+
+    /* Mark all the clients watching this key as REDIS_DIRTY_CAS */
+    // 遍历所有客户端，打开他们的 REDIS_DIRTY_CAS 标识
+    listRewind(clients,&li);
+    while((ln = listNext(&li))) {
+        redisClient *c = listNodeValue(ln);
+
+        c->flags |= REDIS_DIRTY_CAS;
+    }
+}
+
+/* On FLUSHDB or FLUSHALL all the watched keys that are present before the
+ * flush but will be deleted as effect of the flushing operation should
+ * be touched. When the keyspace of 'db' is about to be replaced by 'keys'
+ * instead of just emptied, the watched keys present in 'keys' are touched
+ * as well, since they are going to be created or changed.
+ *
+ * 当一个数据库被 FLUSHDB 或者 FLUSHALL 清空时，
+ * 它里面所有存在并且被监视的键都要被触碰。
+ * 如果数据库的键空间将被替换为 keys 字典，那么 keys 中被监视的键也要被触碰。
+ *
+ * Only the watched keys of the DB are visited, so the cost does not depend
+ * on the number of clients nor on the size of the keyspace.
+ *
+ * 只需要遍历数据库中被监视的键，代价和客户端的数量以及键空间的大小无关。
+ */
+void touchWatchedKeysOnFlush(redisDb *db, dict *keys) {
+    dictIterator *di;
+    dictEntry *de;
+
+    if (dictSize(db->watched_keys) == 0) return;
+
+    di = dictGetIterator(db->watched_keys);
+    while((de = dictNext(di)) != NULL) {
+        sds key = dictGetKey(de);
+
+        // 键存在于数据库或者新的键空间中，那么触碰所有监视它的客户端
+        if (dictFind(db->dict,key) != NULL ||
+            (keys && dictFind(keys,key) != NULL))
+        {
+            list *clients = dictGetVal(de);
+            listIter li;
+            listNode *ln;
+
+            listRewind(clients,&li);
+            while((ln = listNext(&li))) {
+                redisClient *c = listNodeValue(ln);
+
+                c->flags |= REDIS_DIRTY_CAS;
+            }
+        }
+    }
+    dictReleaseIterator(di);
+}
+
+/* Every time a key in the database is modified the function
+ * signalModifiedKey() is called. It is the hook the commands use to
+ * invalidate what depends on the value of the key.
+ *
+ * 每当数据库中的键被修改时，signalModifiedKey() 函数都会被调用。
+ */
+void signalModifiedKey(redisDb *db, robj *key) {
+    touchWatchedKey(db,key);
+    trackingInvalidateKey(key);
+}
+
+void watchCommand(redisClient *c) {
+    int j;
+
+    // 不能在事务开始后执行
+    if (c->flags & REDIS_MULTI) {
+        addReplyError(c,"WATCH inside MULTI is not allowed");
+        return;
+    }
+
+    // 监视输入的任意个键
+    for (j = 1; j < c->argc; j++)
+        watchForKey(c,c->argv[j]);
+
+    addReply(c,shared.ok);
+}
+
+void unwatchCommand(redisClient *c) {
+
+    // 取消客户端对所有键的监视
+    unwatchAllKeys(c);
+
+    // 重置状态
+    c->flags &= (~REDIS_DIRTY_CAS);
+
+    addReply(c,shared.ok);
+}
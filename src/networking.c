@@ -22,6 +22,9 @@ redisClient *createClient(int fd) {
         }
     }
 
+    // 客户端 ID
+    c->id = server.next_client_id++;
+
     // 默认数据库
     selectDb(c,0);
 
@@ -55,6 +58,50 @@ redisClient *createClient(int fd) {
     // 已发送字节数
     c->sentlen = 0;
 
+    // 回复链表
+    c->reply = listCreate();
+
+    // 回复链表的字节量
+    c->reply_bytes = 0;
+
+    // 回复链表的释放和复制函数
+    listSetFreeMethod(c->reply,decrRefCountVoid);
+
+    // 客户端的状态标志
+    c->flags = 0;
+
+    // 最后一次互动时间
+    c->lastinteraction = time(NULL);
+
+    // 复制状态
+    c->replstate = REDIS_REPL_NONE;
+    c->repl_put_online_on_ack = 0;
+    c->reploff = 0;
+    c->repl_ack_off = 0;
+    c->repl_ack_time = 0;
+    c->replrunid[0] = '\0';
+    c->slave_listening_port = 0;
+
+    // 事务状态
+    initClientMultiState(c);
+
+    // 被监视的键
+    c->watched_keys = listCreate();
+
+    // 订阅的频道和模式
+    c->pubsub_channels = dictCreate(&setDictType,NULL);
+    c->pubsub_patterns = dictCreate(&setDictType,NULL);
+
+    // 客户端缓存的追踪状态
+    c->client_tracking_redirection = 0;
+    c->client_tracking_prefixes = NULL;
+
+    // 如果不是伪客户端，那么添加到服务器的客户端链表和 ID 索引中
+    if (fd != -1) {
+        listAddNodeTail(server.clients,c);
+        dictAdd(server.clients_index,(void*)(uintptr_t)c->id,c);
+    }
+
     return c;
 }
 
@@ -104,6 +151,16 @@ void readQueryFromClient(aeEventLoop *el, int fd, void *privdata, int mask) {
         // 根据内容，更新查询缓冲区（SDS） free 和 len 属性
         // 并将 '\0' 正确地放到内容的最后
         sdsIncrLen(c->querybuf,nread);
+        c->lastinteraction = time(NULL);
+        server.stat_net_input_bytes += nread;
+
+        // 主服务器发来的复制流：更新复制偏移量，
+        // 并原样转发给下级从服务器和 backlog
+        if (c->flags & REDIS_MASTER) {
+            c->reploff += nread;
+            replicationFeedSlavesFromMasterStream(server.slaves,
+                c->querybuf+qblen,nread);
+        }
     } else {
         // 在 nread == -1 且 errno == EAGAIN 时运行
         // server.current_client = NULL;
@@ -130,6 +187,9 @@ static void acceptCommonHandler(int fd, int flags) {
         close(fd); /* May be already closed, just ignore errors */
         return;
     }
+
+    // 更新连接次数
+    server.stat_numconnections++;
 }
 
 
@@ -195,16 +255,77 @@ static void freeClientArgv(redisClient *c) {
  * 释放客户端
  */
 void freeClient(redisClient *c) {
-    // redisPanic("freeClient todo");
+    listNode *ln;
+
+    /* If it is our master that's beging disconnected we should make sure
+     * to cache the state to try a partial resynchronization later.
+     *
+     * 如果断开的是主服务器，那么缓存它的状态，重连之后尝试部分重同步 */
+    if (server.master && (c->flags & REDIS_MASTER)) {
+        redisLog(REDIS_WARNING,"Connection with master lost.");
+        if (!(c->flags & REDIS_CLOSE_ASAP)) {
+            replicationCacheMaster(c);
+            return;
+        }
+    }
+
     /* Free the query buffer */
     sdsfree(c->querybuf);
     c->querybuf = NULL;
 
+    /* UNWATCH all the keys */
+    // 取消所有被监视的键
+    unwatchAllKeys(c);
+    listRelease(c->watched_keys);
+
+    /* Unsubscribe from all the pubsub channels */
+    // 退订所有频道和模式
+    pubsubUnsubscribeAllChannels(c,0);
+    pubsubUnsubscribeAllPatterns(c,0);
+    dictRelease(c->pubsub_channels);
+    dictRelease(c->pubsub_patterns);
+
+    // 关闭客户端缓存的追踪
+    disableTracking(c);
+
     // 关闭套接字，并从事件处理器中删除该套接字的事件
     if (c->fd != -1) {
         aeDeleteFileEvent(server.el,c->fd,AE_READABLE);
         aeDeleteFileEvent(server.el,c->fd,AE_WRITABLE);
         close(c->fd);
+
+        // 从服务器的客户端链表中删除自身
+        ln = listSearchKey(server.clients,c);
+        redisAssert(ln != NULL);
+        listDelNode(server.clients,ln);
+        dictDelete(server.clients_index,(void*)(uintptr_t)c->id);
+    }
+
+    /* Free the reply list */
+    // 清空回复链表
+    listRelease(c->reply);
+
+    /* Master/slave cleanup Case 1:
+     * we lost the connection with a slave. */
+    // 从服务器断开，将它从 slaves 链表中删除
+    if (c->flags & REDIS_SLAVE) {
+        ln = listSearchKey(server.slaves,c);
+        redisAssert(ln != NULL);
+        listDelNode(server.slaves,ln);
+        redisLog(REDIS_NOTICE,"Connection with replica %d lost.",
+            c->slave_listening_port);
+    }
+
+    /* Master/slave cleanup Case 2:
+     * we lost the connection with the master. */
+    if (c->flags & REDIS_MASTER) replicationHandleMasterDisconnection();
+
+    /* If this client was scheduled for async freeing we need to remove it
+     * from the queue. */
+    if (c->flags & REDIS_CLOSE_ASAP) {
+        ln = listSearchKey(server.clients_to_close,c);
+        redisAssert(ln != NULL);
+        listDelNode(server.clients_to_close,ln);
     }
 
     // 清空命令参数
@@ -213,10 +334,37 @@ void freeClient(redisClient *c) {
     // 清除参数空间
     zfree(c->argv);
 
+    // 清除事务状态信息
+    freeClientMultiState(c);
+
     // 释放客户端 redisClient 结构本身
     zfree(c);
 }
 
+/* Schedule a client to free it at a safe time in the serverCron() function.
+ * This function is useful when we need to terminate a client but we are in
+ * a context where calling freeClient() is not possible, because the client
+ * should be valid for the continuation of the flow of the program.
+ *
+ * 将客户端加入异步关闭队列，由 serverCron() 在安全的时候释放 */
+void freeClientAsync(redisClient *c) {
+    if (c->flags & REDIS_CLOSE_ASAP) return;
+    c->flags |= REDIS_CLOSE_ASAP;
+    listAddNodeTail(server.clients_to_close,c);
+}
+
+// 释放异步关闭队列中的所有客户端
+void freeClientsInAsyncFreeQueue(void) {
+    while (listLength(server.clients_to_close)) {
+        listNode *ln = listFirst(server.clients_to_close);
+        redisClient *c = listNodeValue(ln);
+
+        c->flags &= ~REDIS_CLOSE_ASAP;
+        freeClient(c);
+        listDelNode(server.clients_to_close,ln);
+    }
+}
+
 int processInlineBuffer(redisClient *c) {
     redisPanic("processInlineBuffer todo");
 }
@@ -391,6 +539,10 @@ void processInputBuffer(redisClient *c) {
     // 这些滞留内容也许不能完整构成一个符合协议的命令，
     // 需要等待下次读事件的就绪
     while(sdslen(c->querybuf)) {
+        /* Immediately abort if the client is in the middle of something. */
+        // 客户端即将被关闭，不再处理它的命令
+        if (c->flags & REDIS_CLOSE_ASAP) break;
+
         /* Determine request type when unknown. */
         // 判断请求的类型
         // 两种类型的区别可以在 Redis 的通讯协议上查到：
@@ -434,10 +586,78 @@ void processInputBuffer(redisClient *c) {
 /* resetClient prepare the client to process the next command */
 // 在客户端执行完命令之后执行：重置客户端以准备执行下个命令
 void resetClient(redisClient *c) {
+    redisCommandProc *prevcmd = c->cmd ? c->cmd->proc : NULL;
+
     freeClientArgv(c);
     c->reqtype = 0;
     c->multibulklen = 0;
     c->bulklen = -1;
+
+    /* Remove the ASKING flag as ASKING is one shot, unless the command
+     * just executed was ASKING itself. */
+    // ASKING 标识只对下一个命令有效
+    if (prevcmd != askingCommand) c->flags &= ~REDIS_ASKING;
+}
+
+/* Rewrite the command vector of the client. All the new objects ref count
+ * is incremented. The old command vector is freed, and the old objects
+ * ref count is decremented.
+ *
+ * 修改客户端的参数数组，新参数的引用计数被增一，旧参数的引用计数被减一。
+ *
+ * Used by commands that must be propagated to the AOF in a different form
+ * than the one they were called with.
+ */
+void rewriteClientCommandVector(redisClient *c, int argc, ...) {
+    va_list ap;
+    int j;
+    robj **argv; /* The new argument vector */
+
+    // 创建新参数
+    argv = zmalloc(sizeof(robj*)*argc);
+    va_start(ap,argc);
+    for (j = 0; j < argc; j++) {
+        robj *a;
+
+        a = va_arg(ap, robj*);
+        argv[j] = a;
+        incrRefCount(a);
+    }
+    /* We free the objects in the original vector at the end, so we are
+     * sure that if the same objects are reused in the new vector the
+     * refcount gets incremented before it gets decremented. */
+    // 释放旧参数
+    for (j = 0; j < c->argc; j++) decrRefCount(c->argv[j]);
+    zfree(c->argv);
+
+    /* Replace argv and argc with our new versions. */
+    // 用新参数替换
+    c->argv = argv;
+    c->argc = argc;
+    c->cmd = lookupCommand(c->argv[0]->ptr);
+    redisAssertWithInfo(c,NULL,c->cmd != NULL);
+    va_end(ap);
+}
+
+/* Completely replace the client command vector with the provided one.
+ * Unlike rewriteClientCommandVector() the new vector and the references it
+ * holds are taken over by the client, so the caller must not release them.
+ *
+ * 用给定的参数数组替换客户端的参数数组。
+ * 和 rewriteClientCommandVector() 不同，数组以及数组中的对象的引用
+ * 都直接交给客户端，调用者不应再释放它们。 */
+void replaceClientCommandVector(redisClient *c, int argc, robj **argv) {
+    int j;
+
+    // 释放旧参数
+    for (j = 0; j < c->argc; j++) decrRefCount(c->argv[j]);
+    zfree(c->argv);
+
+    // 用新参数替换
+    c->argv = argv;
+    c->argc = argc;
+    c->cmd = lookupCommand(c->argv[0]->ptr);
+    redisAssertWithInfo(c,NULL,c->cmd != NULL);
 }
 
 /*
@@ -445,7 +665,7 @@ void resetClient(redisClient *c) {
  */
 void sendReplyToClient(aeEventLoop *el, int fd, void *privdata, int mask) {
     redisClient *c = privdata;
-    int nwritten = 0, objlen;
+    int nwritten = 0, totwritten = 0, objlen;
     size_t objmem;
     robj *o;
     REDIS_NOTUSED(el);
@@ -453,28 +673,80 @@ void sendReplyToClient(aeEventLoop *el, int fd, void *privdata, int mask) {
 
     // 一直循环，直到回复缓冲区为空
     // 或者指定条件满足为止
-    while(c->bufpos > 0) {
-        // c->bufpos > 0
-
-        // 写入内容到套接字
-        // c->sentlen 是用来处理 short write 的
-        // 当出现 short write ，导致写入未能一次完成时，
-        // c->buf+c->sentlen 就会偏移到正确（未写入）内容的位置上。
-        nwritten = write(fd,c->buf+c->sentlen,c->bufpos-c->sentlen);
-        // 出错则跳出
-        if (nwritten <= 0) break;
-        // 成功写入则更新写入计数器变量
-        c->sentlen += nwritten;
-
-        /* If the buffer was sent, set bufpos to zero to continue with
-            * the remainder of the reply. */
-        // 如果缓冲区中的内容已经全部写入完毕
-        // 那么清空客户端的两个计数器变量
-        if (c->sentlen == c->bufpos) {
-            c->bufpos = 0;
-            c->sentlen = 0;
+    while(c->bufpos > 0 || listLength(c->reply)) {
+
+        if (c->bufpos > 0) {
+
+            // c->bufpos > 0
+
+            // 写入内容到套接字
+            // c->sentlen 是用来处理 short write 的
+            // 当出现 short write ，导致写入未能一次完成时，
+            // c->buf+c->sentlen 就会偏移到正确（未写入）内容的位置上。
+            nwritten = write(fd,c->buf+c->sentlen,c->bufpos-c->sentlen);
+            // 出错则跳出
+            if (nwritten <= 0) break;
+            // 成功写入则更新写入计数器变量
+            c->sentlen += nwritten;
+            totwritten += nwritten;
+
+            /* If the buffer was sent, set bufpos to zero to continue with
+             * the remainder of the reply. */
+            // 如果缓冲区中的内容已经全部写入完毕
+            // 那么清空客户端的两个计数器变量
+            if (c->sentlen == c->bufpos) {
+                c->bufpos = 0;
+                c->sentlen = 0;
+            }
+        } else {
+
+            // listLength(c->reply) != 0
+
+            // 取出位于链表最前面的对象
+            o = listNodeValue(listFirst(c->reply));
+            objlen = sdslen(o->ptr);
+            objmem = sdsAllocSize(o->ptr);
+
+            // 略过空对象
+            if (objlen == 0) {
+                listDelNode(c->reply,listFirst(c->reply));
+                c->reply_bytes -= objmem;
+                continue;
+            }
+
+            // 写入内容到套接字
+            // c->sentlen 是用来处理 short write 的
+            // 当出现 short write ，导致写入未能一次完成时，
+            // c->buf+c->sentlen 就会偏移到正确（未写入）内容的位置上。
+            nwritten = write(fd, ((char*)o->ptr)+c->sentlen,objlen-c->sentlen);
+            // 写入出错则跳出
+            if (nwritten <= 0) break;
+            // 成功写入则更新写入计数器变量
+            c->sentlen += nwritten;
+            totwritten += nwritten;
+
+            /* If we fully sent the object on head go to the next one */
+            // 如果缓冲区内容全部写入完毕，那么删除已写入完毕的节点
+            if (c->sentlen == objlen) {
+                listDelNode(c->reply,listFirst(c->reply));
+                c->sentlen = 0;
+                c->reply_bytes -= objmem;
+            }
         }
+
+        /* Note that we avoid to send more than REDIS_MAX_WRITE_PER_EVENT
+         * bytes, in a single threaded server it's a good idea to serve
+         * other clients as well, even if a very large request comes from
+         * super fast link that is always able to accept data (in real world
+         * scenario think about 'KEYS *' against the loopback interface).
+         *
+         * 为了避免一个非常大的回复独占服务器，
+         * 当写入的总数量大于 REDIS_MAX_WRITE_PER_EVENT ，
+         * 临时中断写入，将处理时间让给其他客户端，
+         * 剩余的内容等下次写入就绪再继续写入 */
+        if (totwritten > REDIS_MAX_WRITE_PER_EVENT) break;
     }
+    server.stat_net_output_bytes += totwritten;
 
     // 写入出错检查
     if (nwritten == -1) {
@@ -488,8 +760,7 @@ void sendReplyToClient(aeEventLoop *el, int fd, void *privdata, int mask) {
         }
     }
 
-    
-    if (c->bufpos == 0) {
+    if (c->bufpos == 0 && listLength(c->reply) == 0) {
         c->sentlen = 0;
 
         // 删除 write handler
@@ -499,8 +770,24 @@ void sendReplyToClient(aeEventLoop *el, int fd, void *privdata, int mask) {
 
 
 int prepareClientToWrite(redisClient *c) {
+    /* Masters don't receive replies, unless REDIS_MASTER_FORCE_REPLY flag
+     * is set. */
+    // 主服务器不接收回复，REPLCONF ACK 这样主动发送的命令除外
+    if ((c->flags & REDIS_MASTER) &&
+        !(c->flags & REDIS_MASTER_FORCE_REPLY)) return REDIS_ERR;
+
+    // 伪客户端（比如载入数据时使用的客户端）不需要回复
+    if (c->fd <= 0) return REDIS_ERR; /* Fake client */
+
+    // 还在等待全量同步完成的从服务器：
+    // 复制流先积累在输出缓冲区中，同步完成之后才安装写处理器
+    if ((c->flags & REDIS_SLAVE) &&
+        (c->replstate != REDIS_REPL_ONLINE || c->repl_put_online_on_ack))
+        return REDIS_OK;
+
     // 一般情况，为客户端套接字安装写处理器到事件循环
-    if (c->bufpos == 0 && aeCreateFileEvent(server.el, c->fd, AE_WRITABLE,
+    if (c->bufpos == 0 && listLength(c->reply) == 0 &&
+        aeCreateFileEvent(server.el, c->fd, AE_WRITABLE,
         sendReplyToClient, c) == AE_ERR) 
         return REDIS_ERR;
 
@@ -513,6 +800,11 @@ int prepareClientToWrite(redisClient *c) {
 int _addReplyToBuffer(redisClient *c, char *s, size_t len) {
     size_t available = sizeof(c->buf)-c->bufpos;
 
+    /* If there already are entries in the reply list, we cannot
+     * add anything more to the static buffer. */
+    // 如果回复链表里已经有东西，那么不能再添加内容到 c->buf 里面
+    if (listLength(c->reply) > 0) return REDIS_ERR;
+
     /* Check that the buffer has enough space available for this string. */
     // 空间必须满足
     if (len > available) return REDIS_ERR;
@@ -524,6 +816,157 @@ int _addReplyToBuffer(redisClient *c, char *s, size_t len) {
     return REDIS_OK;
 }
 
+/*
+ * 将回复对象（一个 SDS ）添加到 c->reply 回复链表中
+ */
+void _addReplyObjectToList(redisClient *c, robj *o) {
+    robj *tail;
+
+    // 链表中无缓冲块，直接将对象追加到链表中
+    if (listLength(c->reply) == 0) {
+        incrRefCount(o);
+        listAddNodeTail(c->reply,o);
+        c->reply_bytes += sdsAllocSize(o->ptr);
+
+    // 链表中已有缓冲块，尝试将回复添加到块内
+    // 如果当前的块不能容纳回复的话，那么新建一个块
+    } else {
+
+        // 取出表尾的 SDS
+        tail = listNodeValue(listLast(c->reply));
+
+        /* Append to this object when possible. */
+        // 如果表尾 SDS 的已用空间加上对象的长度，小于 REDIS_REPLY_CHUNK_BYTES
+        // 并且表尾的对象只被回复链表引用，那么将新对象的内容拼接到表尾 SDS 的末尾
+        if (tail->ptr != NULL && tail->refcount == 1 &&
+            tail->encoding == REDIS_ENCODING_RAW &&
+            sdslen(tail->ptr)+sdslen(o->ptr) <= REDIS_REPLY_CHUNK_BYTES)
+        {
+            c->reply_bytes -= sdsAllocSize(tail->ptr);
+            tail->ptr = sdscatlen(tail->ptr,o->ptr,sdslen(o->ptr));
+            c->reply_bytes += sdsAllocSize(tail->ptr);
+
+        // 直接将对象追加到末尾，对象被回复链表共享，不需要复制
+        } else {
+            incrRefCount(o);
+            listAddNodeTail(c->reply,o);
+            c->reply_bytes += sdsAllocSize(o->ptr);
+        }
+    }
+}
+
+/* This method takes responsibility over the sds. When it is no longer
+ * needed it will be free'd, otherwise it ends up in a robj.
+ *
+ * 和 _addReplyObjectToList 类似，但会负责 SDS 的释放功能（如果需要的话）
+ */
+void _addReplySdsToList(redisClient *c, sds s) {
+    robj *tail;
+
+    if (listLength(c->reply) == 0) {
+        listAddNodeTail(c->reply,createObject(REDIS_STRING,s));
+        c->reply_bytes += sdsAllocSize(s);
+    } else {
+        tail = listNodeValue(listLast(c->reply));
+
+        /* Append to this object when possible. */
+        if (tail->ptr != NULL && tail->refcount == 1 &&
+            tail->encoding == REDIS_ENCODING_RAW &&
+            sdslen(tail->ptr)+sdslen(s) <= REDIS_REPLY_CHUNK_BYTES)
+        {
+            c->reply_bytes -= sdsAllocSize(tail->ptr);
+            tail->ptr = sdscatlen(tail->ptr,s,sdslen(s));
+            c->reply_bytes += sdsAllocSize(tail->ptr);
+            sdsfree(s);
+        } else {
+            listAddNodeTail(c->reply,createObject(REDIS_STRING,s));
+            c->reply_bytes += sdsAllocSize(s);
+        }
+    }
+}
+
+/*
+ * 将 C 字符串复制到回复链表中
+ */
+void _addReplyStringToList(redisClient *c, char *s, size_t len) {
+    robj *tail;
+
+    if (listLength(c->reply) == 0) {
+        // 为字符串创建字符串对象并追加到回复链表末尾
+        // 使用 RAW 编码，之后的回复才能追加到这个对象中
+        robj *o = createRawStringObject(s,len);
+
+        listAddNodeTail(c->reply,o);
+        c->reply_bytes += sdsAllocSize(o->ptr);
+    } else {
+        tail = listNodeValue(listLast(c->reply));
+
+        /* Append to this object when possible. */
+        if (tail->ptr != NULL && tail->refcount == 1 &&
+            tail->encoding == REDIS_ENCODING_RAW &&
+            sdslen(tail->ptr)+len <= REDIS_REPLY_CHUNK_BYTES)
+        {
+            c->reply_bytes -= sdsAllocSize(tail->ptr);
+            tail->ptr = sdscatlen(tail->ptr,s,len);
+            c->reply_bytes += sdsAllocSize(tail->ptr);
+        } else {
+            robj *o = createRawStringObject(s,len);
+
+            listAddNodeTail(c->reply,o);
+            c->reply_bytes += sdsAllocSize(o->ptr);
+        }
+    }
+}
+
+/* Reserve 'len' contiguous bytes at the end of the client reply and return
+ * a pointer to them, so that a caller knowing the total size of a reply
+ * in advance can format it in place with a single reservation.
+ *
+ * 在回复的末尾预留 len 个连续字节，并返回指向这些字节的指针。
+ *
+ * 如果 c->buf 放得下，那么直接使用 c->buf ；
+ * 否则如果表尾 SDS 只被回复链表引用并且有足够的空闲空间，那么在表尾扩展；
+ * 否则只分配一个大小正好为 len 的新块，并追加到回复链表中。
+ *
+ * Returns NULL if the client does not accept replies (fake clients).
+ */
+char *addReplyReserve(redisClient *c, size_t len) {
+    char *p;
+    robj *tail;
+
+    if (prepareClientToWrite(c) != REDIS_OK) return NULL;
+
+    // 使用静态缓冲区
+    if (listLength(c->reply) == 0 && sizeof(c->buf)-c->bufpos >= len) {
+        p = c->buf+c->bufpos;
+        c->bufpos += len;
+        return p;
+    }
+
+    // 扩展表尾的块
+    if (listLength(c->reply)) {
+        tail = listNodeValue(listLast(c->reply));
+        if (tail->refcount == 1 && tail->encoding == REDIS_ENCODING_RAW &&
+            sdsavail(tail->ptr) >= len)
+        {
+            p = (char*)tail->ptr+sdslen(tail->ptr);
+            sdsIncrLen(tail->ptr,len);
+            return p;
+        }
+    }
+
+    // 新建一个大小刚好的块
+    tail = createObject(REDIS_STRING,sdsMakeRoomFor(sdsempty(),len));
+    sdsIncrLen(tail->ptr,len);
+    listAddNodeTail(c->reply,tail);
+    c->reply_bytes += sdsAllocSize(tail->ptr);
+    return tail->ptr;
+}
+
+/* -----------------------------------------------------------------------------
+ * Higher level functions to queue data on the client output buffer.
+ * The following functions are the ones that commands implementations will call.
+ * -------------------------------------------------------------------------- */
 
 void addReply(redisClient *c, robj *obj) {
     // 为客户端安装写处理器到事件循环
@@ -534,10 +977,366 @@ void addReply(redisClient *c, robj *obj) {
         if (_addReplyToBuffer(c,obj->ptr,sdslen(obj->ptr)) != REDIS_OK)
             // 如果 c->buf 中的空间不够，就复制到 c->reply 链表中
             // 可能会引起内存分配
-            // _addReplyObjectToList(c,obj);
-            redisPanic("addReply() : replay too large");
+            _addReplyObjectToList(c,obj);
+    } else if (obj->encoding == REDIS_ENCODING_INT) {
+        /* Optimization: if there is room in the static buffer for 32 bytes
+         * (more than the max chars a 64 bit integer can take as string) we
+         * avoid decoding the object and go for the lower level approach. */
+        // 优化，如果 c->buf 中有等于或多于 32 个字节的空间
+        // 那么将整数直接以字符串的形式复制到 c->buf 中
+        if (listLength(c->reply) == 0 && (sizeof(c->buf) - c->bufpos) >= 32) {
+            char buf[32];
+            int len;
+
+            len = ll2string(buf,sizeof(buf),(long)obj->ptr);
+            if (_addReplyToBuffer(c,buf,len) == REDIS_OK)
+                return;
+            /* else... continue with the normal code path, but should never
+             * happen actually since we verified there is room. */
+        }
+        // 执行到这里，代表对象是整数，并且长度大于 32 位
+        // 将它转换为字符串
+        obj = getDecodedObject(obj);
+        // 保存到缓存中
+        if (_addReplyToBuffer(c,obj->ptr,sdslen(obj->ptr)) != REDIS_OK)
+            _addReplyObjectToList(c,obj);
+        decrRefCount(obj);
     } else {
          redisPanic("Wrong obj->encoding in addReply()");
     }
 }
 
+/* Queue an object that is about to be sent to many clients, like a Pub/Sub
+ * message. Small objects are copied as addReply() does, bigger ones are
+ * linked in the reply list by reference: the payload is then stored once
+ * whatever the number of receivers, and every client only pays a list node.
+ *
+ * 添加一个将要发送给大量客户端的对象，比如 Pub/Sub 消息。
+ * 小对象和 addReply() 一样被复制；大对象则以引用的方式加入回复链表，
+ * 无论有多少个接收者，消息内容都只有一份，每个客户端只需要一个链表节点。
+ */
+void addReplyShared(redisClient *c, robj *obj) {
+    if (sdslen(obj->ptr) < REDIS_REPLY_SHARED_MIN_BYTES) {
+        addReply(c,obj);
+        return;
+    }
+
+    if (prepareClientToWrite(c) != REDIS_OK) return;
+
+    incrRefCount(obj);
+    listAddNodeTail(c->reply,obj);
+    c->reply_bytes += sdsAllocSize(obj->ptr);
+}
+
+/*
+ * 将 sds 中的内容复制到回复缓冲区，并释放 sds
+ */
+void addReplySds(redisClient *c, sds s) {
+    if (prepareClientToWrite(c) != REDIS_OK) {
+        /* The caller expects the sds to be free'd. */
+        sdsfree(s);
+        return;
+    }
+    if (_addReplyToBuffer(c,s,sdslen(s)) == REDIS_OK) {
+        sdsfree(s);
+    } else {
+        /* This method free's the sds when it is no longer needed. */
+        _addReplySdsToList(c,s);
+    }
+}
+
+/*
+ * 返回一个错误回复
+ *
+ * 例子 -ERR unknown command 'foobar'
+ */
+void addReplyErrorLength(redisClient *c, char *s, size_t len) {
+    addReplyString(c,"-ERR ",5);
+    addReplyString(c,s,len);
+    addReplyString(c,"\r\n",2);
+}
+
+void addReplyError(redisClient *c, char *err) {
+    addReplyErrorLength(c,err,strlen(err));
+}
+
+void addReplyErrorFormat(redisClient *c, const char *fmt, ...) {
+    size_t l, j;
+    va_list ap;
+
+    // 不需要回复的客户端（比如 AOF 载入的伪客户端），不必格式化
+    if (c->fd <= 0) return;
+    va_start(ap,fmt);
+    sds s = sdscatvprintf(sdsempty(),fmt,ap);
+    va_end(ap);
+    /* Make sure there are no newlines in the string, otherwise invalid protocol
+     * is emitted. */
+    l = sdslen(s);
+    for (j = 0; j < l; j++) {
+        if (s[j] == '\r' || s[j] == '\n') s[j] = ' ';
+    }
+    addReplyErrorLength(c,s,sdslen(s));
+    sdsfree(s);
+}
+
+void addReplyStatusLength(redisClient *c, char *s, size_t len) {
+    addReplyString(c,"+",1);
+    addReplyString(c,s,len);
+    addReplyString(c,"\r\n",2);
+}
+
+void addReplyStatus(redisClient *c, char *status) {
+    addReplyStatusLength(c,status,strlen(status));
+}
+
+void addReplyStatusFormat(redisClient *c, const char *fmt, ...) {
+    va_list ap;
+
+    // 不需要回复的客户端，不必格式化
+    if (c->fd <= 0) return;
+    va_start(ap,fmt);
+    sds s = sdscatvprintf(sdsempty(),fmt,ap);
+    va_end(ap);
+    addReplyStatusLength(c,s,sdslen(s));
+    sdsfree(s);
+}
+
+/*
+ * 将 C 字符串中的内容复制到回复缓冲区
+ */
+void addReplyString(redisClient *c, char *s, size_t len) {
+    if (prepareClientToWrite(c) != REDIS_OK) return;
+    if (_addReplyToBuffer(c,s,len) != REDIS_OK)
+        _addReplyStringToList(c,s,len);
+}
+
+/* Add a long long as integer reply or bulk len / multi bulk count.
+ * 
+ * 添加一个 long long 为整数回复，或者 bulk 或 multi bulk 的数目
+ *
+ * Basically this is used to output <prefix><long long><crlf>. 
+ *
+ * 输出格式为 <prefix><long long><crlf>
+ *
+ * 例子:
+ *
+ * *5\r\n10086\r\n
+ *
+ * $5\r\n10086\r\n
+ */
+void addReplyLongLongWithPrefix(redisClient *c, long long ll, char prefix) {
+    char buf[128];
+    int len;
+
+    // 不需要回复的客户端，不必格式化
+    if (c->fd <= 0) return;
+
+    /* Things like $3\r\n or *2\r\n are emitted very often by the protocol
+     * so we have a few shared objects to use if the integer is small
+     * like it is most of the times. */
+    if (prefix == '$' && ll < server.shared_bulkhdr_len && ll >= 0) {
+        // 长度足够小，使用共享对象
+        addReply(c,shared.bulkhdr[ll]);
+        return;
+    }
+
+    buf[0] = prefix;
+    len = ll2string(buf+1,sizeof(buf)-1,ll);
+    buf[len+1] = '\r';
+    buf[len+2] = '\n';
+    addReplyString(c,buf,len+3);
+}
+
+/* Add a C nul term string as bulk reply
+ *
+ * 返回一个 C 字符串作为回复
+ */
+void addReplyBulkCString(redisClient *c, char *s) {
+    if (s == NULL) {
+        addReply(c,shared.nullbulk);
+    } else {
+        size_t len = strlen(s);
+
+        addReplyLongLongWithPrefix(c,len,'$');
+        addReplyString(c,s,len);
+        addReply(c,shared.crlf);
+    }
+}
+
+/* Add sds to reply (takes ownership of sds and frees it) 
+ *
+ * 返回一个 C 缓冲区作为回复，这个函数会释放 s
+ */
+void addReplyBulkSds(redisClient *c, sds s)  {
+    addReplyLongLongWithPrefix(c,sdslen(s),'$');
+    addReplySds(c,s);
+    addReply(c,shared.crlf);
+}
+
+/*
+ * 返回一个整数回复
+ *
+ * 格式为 :10086\r\n
+ */
+void addReplyLongLong(redisClient *c, long long ll) {
+    if (ll == 0)
+        addReply(c,shared.czero);
+    else if (ll == 1)
+        addReply(c,shared.cone);
+    else
+        addReplyLongLongWithPrefix(c,ll,':');
+}
+
+/*
+ * 返回一个 Multi Bulk 回复的长度
+ *
+ * 格式为 *5\r\n
+ */
+void addReplyMultiBulkLen(redisClient *c, long length) {
+    addReplyLongLongWithPrefix(c,length,'*');
+}
+
+/* Return the amount of memory used by the reply list of the client, the
+ * objects and the list nodes holding them. The static buffer c->buf is
+ * part of the client structure and not counted.
+ *
+ * 返回客户端回复链表占用的内存：对象本身以及保存它们的链表节点。
+ * 静态缓冲区 c->buf 是客户端结构的一部分，不计算在内。
+ */
+unsigned long getClientOutputBufferMemoryUsage(redisClient *c) {
+    unsigned long list_item_size = sizeof(listNode)+sizeof(robj);
+
+    return c->reply_bytes + (list_item_size*listLength(c->reply));
+}
+
+/* Return the client with the given ID, or NULL if there is no such client
+ * (any more).
+ *
+ * 返回 ID 为 id 的客户端，客户端不存在（或者已经断开）时返回 NULL 。
+ */
+redisClient *lookupClientByID(uint64_t id) {
+    return dictFetchValue(server.clients_index,(void*)(uintptr_t)id);
+}
+
+/*
+ * CLIENT ID
+ * CLIENT TRACKING (on|off) [REDIRECT <id>] [BCAST] [PREFIX <prefix> ...]
+ * CLIENT GETREDIR
+ */
+void clientCommand(redisClient *c) {
+    if (!strcasecmp(c->argv[1]->ptr,"id") && c->argc == 2) {
+        /* CLIENT ID */
+        addReplyLongLong(c,c->id);
+    } else if (!strcasecmp(c->argv[1]->ptr,"tracking") && c->argc >= 3) {
+        /* CLIENT TRACKING (on|off) [REDIRECT <id>] [BCAST] [PREFIX first]
+         *                          [PREFIX second] ... */
+        long long redir = 0;
+        int bcast = 0, j;
+        robj **prefix = NULL;
+        size_t numprefix = 0;
+
+        /* Parse the options. */
+        for (j = 3; j < c->argc; j++) {
+            int moreargs = (c->argc-1) - j;
+
+            if (!strcasecmp(c->argv[j]->ptr,"redirect") && moreargs) {
+                j++;
+                if (redir != 0) {
+                    addReplyError(c,"A client can only redirect to a single "
+                                    "other client");
+                    zfree(prefix);
+                    return;
+                }
+
+                if (getLongLongFromObjectOrReply(c,c->argv[j],&redir,NULL) !=
+                    REDIS_OK)
+                {
+                    zfree(prefix);
+                    return;
+                }
+                /* We will require the client with the specified ID to exist
+                 * right now, even if it is possible that it gets disconnected
+                 * later. Still a valid sanity check. */
+                if ((uint64_t)redir == c->id) {
+                    addReplyError(c,"A client can't redirect to itself");
+                    zfree(prefix);
+                    return;
+                }
+                if (lookupClientByID(redir) == NULL) {
+                    addReplyError(c,"The client ID you want redirect to "
+                                    "does not exist");
+                    zfree(prefix);
+                    return;
+                }
+            } else if (!strcasecmp(c->argv[j]->ptr,"bcast")) {
+                bcast = 1;
+            } else if (!strcasecmp(c->argv[j]->ptr,"prefix") && moreargs) {
+                j++;
+                prefix = zrealloc(prefix,sizeof(robj*)*(numprefix+1));
+                prefix[numprefix++] = c->argv[j];
+            } else {
+                zfree(prefix);
+                addReply(c,shared.syntaxerr);
+                return;
+            }
+        }
+
+        /* Options are ok: enable or disable the tracking for this client. */
+        if (!strcasecmp(c->argv[2]->ptr,"on")) {
+            if (!bcast && numprefix) {
+                addReplyError(c,"PREFIX option requires BCAST mode to be "
+                                "enabled");
+                zfree(prefix);
+                return;
+            }
+
+            if (c->flags & REDIS_TRACKING) {
+                int oldbcast = !!(c->flags & REDIS_TRACKING_BCAST);
+                if (oldbcast != bcast) {
+                    addReplyError(c,"You can't switch BCAST mode on/off "
+                                    "before disabling tracking for this "
+                                    "client, and then re-enabling it with "
+                                    "a different mode.");
+                    zfree(prefix);
+                    return;
+                }
+            }
+
+            /* Without RESP3 push messages the invalidations can only be
+             * delivered as Pub/Sub messages to another connection. */
+            // 服务器不支持 RESP3 推送，失效通知只能作为订阅消息发送给另一个连接
+            if (redir == 0) {
+                addReplyError(c,"Tracking needs REDIRECT to a client "
+                                "subscribed to __redis__:invalidate");
+                zfree(prefix);
+                return;
+            }
+
+            if (bcast && !checkPrefixCollisionsOrReply(c,prefix,numprefix)) {
+                zfree(prefix);
+                return;
+            }
+
+            enableTracking(c,redir,bcast,prefix,numprefix);
+        } else if (!strcasecmp(c->argv[2]->ptr,"off")) {
+            disableTracking(c);
+        } else {
+            zfree(prefix);
+            addReply(c,shared.syntaxerr);
+            return;
+        }
+        zfree(prefix);
+        addReply(c,shared.ok);
+    } else if (!strcasecmp(c->argv[1]->ptr,"getredir") && c->argc == 2) {
+        /* CLIENT GETREDIR */
+        if (c->flags & REDIS_TRACKING) {
+            addReplyLongLong(c,c->client_tracking_redirection);
+        } else {
+            addReplyLongLong(c,-1);
+        }
+    } else {
+        addReplyErrorFormat(c,
+            "Unknown CLIENT subcommand or wrong number of arguments for '%s'",
+            (char*)c->argv[1]->ptr);
+    }
+}
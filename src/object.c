@@ -1,4 +1,5 @@
 #include "redis.h"
+#include <limits.h>
 
 /*
  * 创建一个新 robj 对象
@@ -11,22 +12,137 @@ robj *createObject(int type, void *ptr) {
     o->ptr = ptr;
     o->refcount = 1;
 
+    /* Set the LRU to the current lruclock (minutes resolution), or
+     * alternatively the LFU counter. */
+    // 设置对象的 LRU 时间，或者 LFU 计数器的初始值
+    if (server.maxmemory_policy & MAXMEMORY_FLAG_LFU) {
+        o->lru = (LFUGetTimeInMinutes()<<8) | LFU_INIT_VAL;
+    } else {
+        o->lru = LRU_CLOCK();
+    }
+
     return o;
 }
 
+/*
+ * 创建一个 REDIS_ENCODING_RAW 编码的字符串对象
+ * 对象的指针指向一个单独分配的 sds 结构
+ */
 robj *createRawStringObject(char *ptr, size_t len) {
     return createObject(REDIS_STRING,sdsnewlen(ptr,len));
 }
 
-robj *createStringObject(char *ptr, size_t len) {   
-    return createRawStringObject(ptr,len);
+/* Create a string object with encoding REDIS_ENCODING_EMBSTR, that is
+ * an object where the sds string is actually an unmodifiable string
+ * allocated in the same chunk as the object itself.
+ *
+ * 创建一个 REDIS_ENCODING_EMBSTR 编码的字符对象
+ * 这个字符串对象中的 sds 会和字符串对象的 redisObject 结构一起分配
+ * 因此这个字符也是不可修改的
+ */
+robj *createEmbeddedStringObject(char *ptr, size_t len) {
+    robj *o = zmalloc(sizeof(robj)+sizeof(struct sdshdr8)+len+1);
+    struct sdshdr8 *sh = (void*)(o+1);
+
+    o->type = REDIS_STRING;
+    o->encoding = REDIS_ENCODING_EMBSTR;
+    o->ptr = sh+1;
+    o->refcount = 1;
+    if (server.maxmemory_policy & MAXMEMORY_FLAG_LFU) {
+        o->lru = (LFUGetTimeInMinutes()<<8) | LFU_INIT_VAL;
+    } else {
+        o->lru = LRU_CLOCK();
+    }
+
+    sh->len = len;
+    sh->alloc = len;
+    sh->flags = SDS_TYPE_8;
+    if (ptr) {
+        memcpy(sh->buf,ptr,len);
+        sh->buf[len] = '\0';
+    } else {
+        memset(sh->buf,0,len+1);
+    }
+    return o;
+}
+
+/* Create a string object with EMBSTR encoding if it is smaller than
+ * REDIS_ENCODING_EMBSTR_SIZE_LIMIT, otherwise the RAW encoding is
+ * used.
+ *
+ * 字符串长度不超过 REDIS_ENCODING_EMBSTR_SIZE_LIMIT 时使用 EMBSTR 编码，
+ * 否则使用 RAW 编码。
+ */
+robj *createStringObject(char *ptr, size_t len) {
+    if (len <= REDIS_ENCODING_EMBSTR_SIZE_LIMIT)
+        return createEmbeddedStringObject(ptr,len);
+    else
+        return createRawStringObject(ptr,len);
+}
+
+/*
+ * 根据传入的整数值，创建一个字符串对象
+ *
+ * 这个字符串的对象保存的可以是 INT 编码的 long 值，
+ * 也可以是 RAW 编码的、被转换成字符串的 long long 值。
+ */
+robj *createStringObjectFromLongLong(long long value) {
+    robj *o;
+
+    // value 的大小符合 REDIS 共享整数的范围
+    // 那么返回一个共享对象
+    // 在 LRU/LFU 淘汰策略下，每个对象都需要私有的 lru 字段，不使用共享对象
+    if ((server.maxmemory == 0 ||
+         !(server.maxmemory_policy & MAXMEMORY_FLAG_NO_SHARED_INTEGERS)) &&
+        value >= 0 && value < REDIS_SHARED_INTEGERS)
+    {
+        incrRefCount(shared.integers[value]);
+        o = shared.integers[value];
+
+    // 不符合共享范围，创建一个新的整数对象
+    } else {
+        // 值可以用 long 类型保存，
+        // 创建一个 REDIS_ENCODING_INT 编码的字符串对象
+        if (value >= LONG_MIN && value <= LONG_MAX) {
+            o = createObject(REDIS_STRING, NULL);
+            o->encoding = REDIS_ENCODING_INT;
+            o->ptr = (void*)((long)value);
+
+        // 值不能用 long 类型保存（long long 类型），将值转换为字符串，
+        // 并创建一个 REDIS_ENCODING_RAW 的字符串对象来保存值
+        } else {
+            o = createObject(REDIS_STRING,sdsfromlonglong(value));
+        }
+    }
+
+    return o;
+}
+
+/* Set a special refcount in the object to make it "shared":
+ * incrRefCount and decrRefCount() will test for this special refcount
+ * and will not touch the object. This way it is free to access shared
+ * objects such as small integers from different threads without any
+ * mutex.
+ *
+ * 将对象标记为共享对象：引用计数被设置为 REDIS_SHARED_REFCOUNT ，
+ * incrRefCount 和 decrRefCount 不会再修改它的引用计数，
+ * 共享对象也就永远不会被释放。
+ *
+ * A common patter to create shared objects:
+ *
+ * robj *myobject = makeObjectShared(createObject(...));
+ */
+robj *makeObjectShared(robj *o) {
+    redisAssert(o->refcount == 1);
+    o->refcount = REDIS_SHARED_REFCOUNT;
+    return o;
 }
 
 /*
  * 为对象的引用计数增一
  */
 void incrRefCount(robj *o) {
-    o->refcount++;
+    if (o->refcount != REDIS_SHARED_REFCOUNT) o->refcount++;
 }
 
 /*
@@ -38,6 +154,9 @@ void decrRefCount(robj *o) {
     // redisPanic("decrRefCount against refcount <= 0");
     if (o->refcount <= 0) redisPanic("decrRefCount against refcount <= 0");
 
+    // 共享对象，不修改引用计数
+    if (o->refcount == REDIS_SHARED_REFCOUNT) return;
+
     // 释放对象
     if (o->refcount == 1) {
         switch(o->type) {
@@ -56,6 +175,16 @@ void decrRefCount(robj *o) {
     }
 }
 
+/* This variant of decrRefCount() gets its argument as void, and is useful
+ * as free method in data structures that expect a 'void free_object(void*)'
+ * prototype for the free method. 
+ *
+ * 作用于特定数据结构的释放函数包装
+ */
+void decrRefCountVoid(void *o) {
+    decrRefCount(o);
+}
+
 /*
  * 释放字符串对象
  */
@@ -65,4 +194,329 @@ void freeStringObject(robj *o) {
     }
 }
 
+/* Try to encode a string object in order to save space
+ *
+ * 尝试对字符串对象进行编码，以节约内存。
+ *
+ * 如果字符串可以被表示为 long 类型的整数，
+ * 那么将它编码为 REDIS_ENCODING_INT ，值直接保存在 ptr 中，
+ * 如果整数位于共享整数的范围之内，那么直接返回共享对象。
+ */
+robj *tryObjectEncoding(robj *o) {
+    long value;
+    sds s = o->ptr;
+    size_t len;
+
+    /* Make sure this is a string object, the only type we encode
+     * in this function. Other types use encoded memory efficient
+     * representations but are handled by the commands implementing
+     * the type. */
+    redisAssertWithInfo(NULL,o,o->type == REDIS_STRING);
+
+    /* We try some specialized encoding only for objects that are
+     * RAW or EMBSTR encoded, in other words objects that are still
+     * in represented by an actually array of chars. */
+    // 只在字符串的编码为 RAW 或者 EMBSTR 时尝试进行编码
+    if (!sdsEncodedObject(o)) return o;
+
+    /* It's not safe to encode shared objects: shared objects can be shared
+     * everywhere in the "object space" of Redis and may end in places where
+     * they are not handled. We handle them only as values in the keyspace. */
+     // 不对共享对象进行编码
+     if (o->refcount > 1) return o;
+
+    /* Check if we can represent this string as a long integer.
+     * Note that we are sure that a string larger than 21 chars is not
+     * representable as a 32 nor 64 bit integer. */
+    // 对字符串进行检查
+    // 只对长度小于或等于 21 字节，并且可以被解释为整数的字符串进行编码
+    len = sdslen(s);
+    if (len <= 21 && string2l(s,len,&value)) {
+        /* This object is encodable as a long. Try to use a shared object.
+         * Note that we avoid using shared integers when maxmemory is used
+         * because every object needs to have a private LRU field for the LRU
+         * algorithm to work well. */
+        if ((server.maxmemory == 0 ||
+             !(server.maxmemory_policy & MAXMEMORY_FLAG_NO_SHARED_INTEGERS)) &&
+            value >= 0 && value < REDIS_SHARED_INTEGERS)
+        {
+            decrRefCount(o);
+            incrRefCount(shared.integers[value]);
+            return shared.integers[value];
+        } else {
+            if (o->encoding == REDIS_ENCODING_RAW) sdsfree(o->ptr);
+            o->encoding = REDIS_ENCODING_INT;
+            o->ptr = (void*) value;
+            return o;
+        }
+    }
+
+    /* If the string is small and is still RAW encoded,
+     * try the EMBSTR encoding which is more efficient.
+     * In this representation the object and the SDS string are allocated
+     * in the same chunk of memory to save space and cache misses. */
+    // 尝试将 RAW 编码的字符串编码为 EMBSTR 编码
+    if (len <= REDIS_ENCODING_EMBSTR_SIZE_LIMIT) {
+        robj *emb;
+
+        if (o->encoding == REDIS_ENCODING_EMBSTR) return o;
+        emb = createEmbeddedStringObject(s,sdslen(s));
+        decrRefCount(o);
+        return emb;
+    }
+
+    /* We can't encode the object...
+     *
+     * Do the last try, and at least optimize the SDS string inside
+     * the string object to require little space, in case there
+     * is more than 10% of free space at the end of the SDS string.
+     *
+     * We do that only for relatively large strings as this branch
+     * is only entered if the length of the string is greater than
+     * REDIS_ENCODING_EMBSTR_SIZE_LIMIT. */
+    // 这个对象没办法进行编码，尝试从 SDS 中移除所有空余空间
+    if (o->encoding == REDIS_ENCODING_RAW &&
+        sdsavail(s) > len/10)
+    {
+        o->ptr = sdsRemoveFreeSpace(o->ptr);
+    }
+
+    // 返回对象
+    return o;
+}
+
+/* Get a decoded version of an encoded object (returned as a new object).
+ * If the object is already raw-encoded just increment the ref count. 
+ *
+ * 以新对象的形式，返回一个输入对象的解码版本（RAW 编码）。
+ * 如果对象已经是 RAW 编码的，那么对输入对象的引用计数增一，
+ * 然后返回输入对象。
+ */
+robj *getDecodedObject(robj *o) {
+    robj *dec;
+
+    if (sdsEncodedObject(o)) {
+        incrRefCount(o);
+        return o;
+    }
+
+    // 解码对象，将对象的值从整数转换为字符串
+    if (o->type == REDIS_STRING && o->encoding == REDIS_ENCODING_INT) {
+        char buf[32];
+
+        ll2string(buf,32,(long)o->ptr);
+        dec = createStringObject(buf,strlen(buf));
+        return dec;
+    } else {
+        redisPanic("Unknown encoding type");
+    }
+}
+
+/*
+ * 返回字符串对象中字符串值的长度
+ */
+size_t stringObjectLen(robj *o) {
+    redisAssertWithInfo(NULL,o,o->type == REDIS_STRING);
+
+    if (sdsEncodedObject(o)) {
+        return sdslen(o->ptr);
+
+    // INT 编码，计算将这个值转换为字符串要多少字节
+    } else {
+        long n = (long)o->ptr;
+
+        if (n < 0) return 1+digits10(-(unsigned long)n);
+        return digits10(n);
+    }
+}
+
+/*
+ * 尝试从对象中取出 long long 类型值，
+ * 成功则将值保存在 *target 并返回 REDIS_OK ，否则返回 REDIS_ERR
+ */
+int getLongLongFromObject(robj *o, long long *target) {
+    long long value;
+
+    if (o == NULL) {
+        // o 为 NULL 时，将值设为 0 。
+        value = 0;
+    } else {
+
+        // 确保对象为 REDIS_STRING 类型
+        redisAssertWithInfo(NULL,o,o->type == REDIS_STRING);
+        if (sdsEncodedObject(o)) {
+            // 将字符串值转换为 long long 值
+            if (!string2ll(o->ptr,sdslen(o->ptr),&value)) return REDIS_ERR;
+        } else if (o->encoding == REDIS_ENCODING_INT) {
+            // 对于 REDIS_ENCODING_INT 编码的对象，直接将值保存到 value 中
+            value = (long)o->ptr;
+        } else {
+            redisPanic("Unknown string encoding");
+        }
+    }
+
+    // 保存值到指针
+    if (target) *target = value;
+
+    // 返回结果标识符
+    return REDIS_OK;
+}
+
+/*
+ * 尝试从对象 o 中取出整数值，
+ * 如果尝试失败的话，就返回指定的回复 msg 给客户端，函数返回 REDIS_ERR 。
+ *
+ * 取出成功的话，将值保存在 *target 中，函数返回 REDIS_OK 。
+ */
+int getLongLongFromObjectOrReply(redisClient *c, robj *o, long long *target, const char *msg) {
+    long long value;
+
+    if (getLongLongFromObject(o, &value) != REDIS_OK) {
+        if (msg != NULL) {
+            addReplyError(c,(char*)msg);
+        } else {
+            addReplyError(c,"value is not an integer or out of range");
+        }
+        return REDIS_ERR;
+    }
+
+    *target = value;
+
+    return REDIS_OK;
+}
+
+/*
+ * 返回编码的字符串表示
+ */
+char *strEncoding(int encoding) {
+
+    switch(encoding) {
+    case REDIS_ENCODING_RAW: return "raw";
+    case REDIS_ENCODING_INT: return "int";
+    case REDIS_ENCODING_EMBSTR: return "embstr";
+    default: return "unknown";
+    }
+}
 
+/* Object command allows to inspect the internals of an Redis Object.
+ * Usage: OBJECT <refcount|encoding> <key> */
+/* This is a helper function for the OBJECT command. We need to lookup keys
+ * without any modification of LRU or other parameters.
+ *
+ * OBJECT 命令的辅助函数，用于在不修改 LRU 时间的情况下，尝试获取 key 对象
+ */
+robj *objectCommandLookup(redisClient *c, robj *key) {
+    dictEntry *de;
+
+    if ((de = dictFind(c->db->dict,key->ptr)) == NULL) return NULL;
+    return (robj*) dictGetVal(de);
+}
+
+void objectCommand(redisClient *c) {
+    robj *o;
+
+    // 返回对象的引用计数
+    if (!strcasecmp(c->argv[1]->ptr,"refcount") && c->argc == 3) {
+        if ((o = objectCommandLookup(c,c->argv[2])) == NULL) {
+            addReply(c,shared.nullbulk);
+            return;
+        }
+        addReplyLongLong(c,o->refcount);
+
+    // 返回对象的编码
+    } else if (!strcasecmp(c->argv[1]->ptr,"encoding") && c->argc == 3) {
+        if ((o = objectCommandLookup(c,c->argv[2])) == NULL) {
+            addReply(c,shared.nullbulk);
+            return;
+        }
+        addReplyBulkCString(c,strEncoding(o->encoding));
+
+    // 返回对象的空闲时间（秒）
+    } else if (!strcasecmp(c->argv[1]->ptr,"idletime") && c->argc == 3) {
+        if ((o = objectCommandLookup(c,c->argv[2])) == NULL) {
+            addReply(c,shared.nullbulk);
+            return;
+        }
+        if (server.maxmemory_policy & MAXMEMORY_FLAG_LFU) {
+            addReplyError(c,"An LFU maxmemory policy is selected, idle time not tracked. Please note that when switching between policies at runtime LRU and LFU data will take some time to adjust.");
+            return;
+        }
+        addReplyLongLong(c,estimateObjectIdleTime(o)/1000);
+
+    // 返回对象的 LFU 访问频率
+    } else if (!strcasecmp(c->argv[1]->ptr,"freq") && c->argc == 3) {
+        if ((o = objectCommandLookup(c,c->argv[2])) == NULL) {
+            addReply(c,shared.nullbulk);
+            return;
+        }
+        if (!(server.maxmemory_policy & MAXMEMORY_FLAG_LFU)) {
+            addReplyError(c,"An LFU maxmemory policy is not selected, access frequency not tracked. Please note that when switching between policies at runtime LRU and LFU data will take some time to adjust.");
+            return;
+        }
+        /* LFUDecrAndReturn should be called
+         * in case of the key has not been accessed for a long time,
+         * because we update the access time only
+         * when the key is read or overwritten. */
+        addReplyLongLong(c,LFUDecrAndReturn(o));
+    } else {
+        addReplyError(c,"Syntax error. Try OBJECT (refcount|encoding|idletime|freq)");
+    }
+}
+
+#ifdef REDIS_TEST
+/*
+ * 字符串对象的微基准测试：RAW 编码 vs EMBSTR 编码
+ *
+ * For each encoding, 'numobjects' short values are created, then read back
+ * in random order the way GET does (robj -> sds header -> bytes). The
+ * memory per object comes from zmalloc_used_memory().
+ *
+ * Build with 'make REDIS_CFLAGS=-DREDIS_TEST' and run with
+ * './redis-server test embstr [numobjects]'.
+ */
+int stringObjectBenchmark(long long numobjects) {
+    robj **objs = zmalloc(sizeof(robj*)*numobjects);
+    long long *order = zmalloc(sizeof(long long)*numobjects);
+    long long j, start, elapsed;
+    size_t before, checksum;
+    char buf[32];
+    int embstr;
+
+    // 随机的访问顺序，避免硬件预取掩盖缓存未命中
+    for (j = 0; j < numobjects; j++) order[j] = j;
+    for (j = numobjects-1; j > 0; j--) {
+        long long k = random() % (j+1), tmp = order[j];
+        order[j] = order[k];
+        order[k] = tmp;
+    }
+
+    for (embstr = 0; embstr <= 1; embstr++) {
+        before = zmalloc_used_memory();
+        for (j = 0; j < numobjects; j++) {
+            int len = snprintf(buf,sizeof(buf),"value:%012lld",j);
+
+            objs[j] = embstr ? createEmbeddedStringObject(buf,len) :
+                               createRawStringObject(buf,len);
+        }
+
+        checksum = 0;
+        start = ustime();
+        for (j = 0; j < numobjects; j++) {
+            robj *o = objs[order[j]];
+
+            checksum += sdslen(o->ptr) + ((char*)o->ptr)[sdslen(o->ptr)-1];
+        }
+        elapsed = ustime()-start;
+
+        printf("%-6s: %.1f bytes/object, %.2f ns/read (checksum %zu)\n",
+            embstr ? "embstr" : "raw",
+            (double)(zmalloc_used_memory()-before)/numobjects,
+            (double)elapsed*1000/numobjects, checksum);
+        for (j = 0; j < numobjects; j++) decrRefCount(objs[j]);
+    }
+
+    zfree(order);
+    zfree(objs);
+    return 0;
+}
+#endif
@@ -0,0 +1,501 @@
+/* Pub/Sub: channels, patterns, and the fan-out of published messages.
+ *
+ * 发布与订阅
+ *
+ * server.pubsub_channels maps every channel to the list of its subscribers.
+ * Patterns are indexed by their literal prefix, that is the part before the
+ * first glob special character, in a radix tree (see radix.c): PUBLISH
+ * walks the tree along the channel name and only tries the patterns found
+ * on that path, so the patterns that can't match the channel are never
+ * looked at.
+ *
+ * 频道保存在 server.pubsub_channels 字典中，字典的值为订阅频道的客户端链表。
+ * 模式按照它们的字面前缀（第一个 glob 特殊字符之前的部分）保存在一棵基数树中：
+ * PUBLISH 沿着频道的名字遍历这棵树，只对路径上的节点保存的模式进行匹配，
+ * 前缀和频道不符的模式完全不会被检查。
+ *
+ * A message is encoded in the protocol once, and the same object is queued
+ * in the output of every receiver (see addReplyShared()), so sending it to
+ * N clients doesn't take N copies of the payload.
+ *
+ * 消息只会被编码成协议格式一次，同一个对象被加入所有接收者的回复链表中
+ * （见 addReplyShared() ），发送给 N 个客户端并不需要复制 N 份消息内容。
+ */
+
+#include "redis.h"
+
+/*-----------------------------------------------------------------------------
+ * Pattern index
+ *----------------------------------------------------------------------------*/
+
+/* Return the length of the literal prefix of the pattern, the part that
+ * every matching channel starts with.
+ *
+ * 返回模式的字面前缀的长度，所有匹配模式的频道都以这个前缀开头
+ */
+static size_t patternLiteralLen(sds pattern) {
+    size_t j, len = sdslen(pattern);
+
+    for (j = 0; j < len; j++) {
+        char c = pattern[j];
+
+        if (c == '*' || c == '?' || c == '[' || c == '\\') break;
+    }
+    return j;
+}
+
+/*-----------------------------------------------------------------------------
+ * Pubsub low level API
+ *----------------------------------------------------------------------------*/
+
+/*
+ * 初始化服务器的 Pub/Sub 状态
+ */
+void pubsubInit(void) {
+    server.pubsub_channels = dictCreate(&keylistDictType,NULL);
+    server.pubsub_patterns = radixCreate();
+    server.pubsub_numpat = 0;
+}
+
+/* Return the number of channels + patterns a client is subscribed to.
+ *
+ * 返回客户端订阅的频道和模式的数量之和
+ */
+int clientSubscriptionsCount(redisClient *c) {
+    return dictSize(c->pubsub_channels)+dictSize(c->pubsub_patterns);
+}
+
+/*
+ * 回复一条订阅或者退订的通知： [type, channel, 订阅总数]
+ * channel 为 NULL 时回复空值
+ */
+static void addReplyPubsubNotification(redisClient *c, robj *type,
+                                       robj *channel)
+{
+    addReplyMultiBulkLen(c,3);
+    addReply(c,type);
+    if (channel)
+        addReplyBulk(c,channel);
+    else
+        addReply(c,shared.nullbulk);
+    addReplyLongLong(c,clientSubscriptionsCount(c));
+}
+
+/* Subscribe a client to a channel. Returns 1 if the operation succeeded, or
+ * 0 if the client was already subscribed to that channel.
+ *
+ * 设置客户端 c 订阅频道 channel 。
+ * 订阅成功返回 1 ，如果客户端已经订阅了该频道，那么返回 0 。
+ */
+int pubsubSubscribeChannel(redisClient *c, robj *channel) {
+    list *clients;
+    int retval = 0;
+
+    /* Add the channel to the client -> channels hash dict */
+    if (dictFind(c->pubsub_channels,channel->ptr) == NULL) {
+        retval = 1;
+        dictAdd(c->pubsub_channels,sdsdup(channel->ptr),NULL);
+
+        /* Add the client to the channel -> list of clients hash table */
+        clients = dictFetchValue(server.pubsub_channels,channel->ptr);
+        if (clients == NULL) {
+            clients = listCreate();
+            dictAdd(server.pubsub_channels,sdsdup(channel->ptr),clients);
+        }
+        listAddNodeTail(clients,c);
+    }
+
+    /* Notify the client */
+    addReplyPubsubNotification(c,shared.subscribebulk,channel);
+    return retval;
+}
+
+/* Unsubscribe a client from a channel. Returns 1 if the operation succeeded,
+ * or 0 if the client was not subscribed to the specified channel.
+ *
+ * 客户端 c 退订频道 channel 。
+ * 退订成功返回 1 ，如果客户端没有订阅该频道，那么返回 0 。
+ */
+int pubsubUnsubscribeChannel(redisClient *c, robj *channel, int notify) {
+    list *clients;
+    listNode *ln;
+    int retval = 0;
+
+    /* Remove the channel from the client -> channels hash dict */
+    if (dictDelete(c->pubsub_channels,channel->ptr) == DICT_OK) {
+        retval = 1;
+
+        /* Remove the client from the channel -> clients list hash table */
+        clients = dictFetchValue(server.pubsub_channels,channel->ptr);
+        redisAssertWithInfo(c,channel,clients != NULL);
+        ln = listSearchKey(clients,c);
+        redisAssertWithInfo(c,channel,ln != NULL);
+        listDelNode(clients,ln);
+
+        // 频道已经没有订阅者，删除它
+        if (listLength(clients) == 0)
+            dictDelete(server.pubsub_channels,channel->ptr);
+    }
+
+    /* Notify the client */
+    if (notify) addReplyPubsubNotification(c,shared.unsubscribebulk,channel);
+    return retval;
+}
+
+/* Subscribe a client to a pattern. Returns 1 if the operation succeeded, or
+ * 0 if the client was already subscribed to that pattern.
+ *
+ * 设置客户端 c 订阅模式 pattern 。
+ * 订阅成功返回 1 ，如果客户端已经订阅了该模式，那么返回 0 。
+ */
+int pubsubSubscribePattern(redisClient *c, robj *pattern) {
+    radixNode *n;
+    dict *patterns;
+    list *clients;
+    int retval = 0;
+
+    if (dictFind(c->pubsub_patterns,pattern->ptr) == NULL) {
+        retval = 1;
+        dictAdd(c->pubsub_patterns,sdsdup(pattern->ptr),NULL);
+
+        // 找到模式的字面前缀对应的节点，将客户端添加到模式的订阅者链表中
+        // 节点的值是字面前缀在这里结束的模式的字典，
+        // 字典的键为模式，值为订阅模式的客户端链表
+        n = radixLookup(server.pubsub_patterns,pattern->ptr,
+                        patternLiteralLen(pattern->ptr),1);
+        if (n->value == NULL)
+            n->value = dictCreate(&keylistDictType,NULL);
+        patterns = n->value;
+        clients = dictFetchValue(patterns,pattern->ptr);
+        if (clients == NULL) {
+            clients = listCreate();
+            dictAdd(patterns,sdsdup(pattern->ptr),clients);
+            server.pubsub_numpat++;
+        }
+        listAddNodeTail(clients,c);
+    }
+
+    /* Notify the client */
+    addReplyPubsubNotification(c,shared.psubscribebulk,pattern);
+    return retval;
+}
+
+/* Unsubscribe a client from a pattern. Returns 1 if the operation succeeded,
+ * or 0 if the client was not subscribed to the specified pattern.
+ *
+ * 客户端 c 退订模式 pattern 。
+ * 退订成功返回 1 ，如果客户端没有订阅该模式，那么返回 0 。
+ */
+int pubsubUnsubscribePattern(redisClient *c, robj *pattern, int notify) {
+    radixNode *n;
+    dict *patterns;
+    list *clients;
+    listNode *ln;
+    int retval = 0;
+
+    if (dictDelete(c->pubsub_patterns,pattern->ptr) == DICT_OK) {
+        retval = 1;
+
+        n = radixLookup(server.pubsub_patterns,pattern->ptr,
+                        patternLiteralLen(pattern->ptr),0);
+        redisAssertWithInfo(c,pattern,n != NULL && n->value != NULL);
+        patterns = n->value;
+        clients = dictFetchValue(patterns,pattern->ptr);
+        redisAssertWithInfo(c,pattern,clients != NULL);
+        ln = listSearchKey(clients,c);
+        redisAssertWithInfo(c,pattern,ln != NULL);
+        listDelNode(clients,ln);
+
+        // 模式已经没有订阅者，删除它，并在节点变空时整理基数树
+        if (listLength(clients) == 0) {
+            dictDelete(patterns,pattern->ptr);
+            server.pubsub_numpat--;
+            if (dictSize(patterns) == 0) {
+                dictRelease(patterns);
+                n->value = NULL;
+                radixCompact(server.pubsub_patterns,n);
+            }
+        }
+    }
+
+    /* Notify the client */
+    if (notify) addReplyPubsubNotification(c,shared.punsubscribebulk,pattern);
+    return retval;
+}
+
+/* Unsubscribe from all the channels. Return the number of channels the
+ * client was subscribed to.
+ *
+ * 退订客户端 c 订阅的所有频道，返回被退订频道的数量
+ */
+int pubsubUnsubscribeAllChannels(redisClient *c, int notify) {
+    dictIterator *di = dictGetSafeIterator(c->pubsub_channels);
+    dictEntry *de;
+    int count = 0;
+
+    while((de = dictNext(di)) != NULL) {
+        sds key = dictGetKey(de);
+        robj *channel = createStringObject(key,sdslen(key));
+
+        count += pubsubUnsubscribeChannel(c,channel,notify);
+        decrRefCount(channel);
+    }
+    dictReleaseIterator(di);
+
+    /* We were subscribed to nothing? Still reply to the client. */
+    // 客户端没有订阅任何频道，仍然回复一条通知
+    if (notify && count == 0)
+        addReplyPubsubNotification(c,shared.unsubscribebulk,NULL);
+    return count;
+}
+
+/* Unsubscribe from all the patterns. Return the number of patterns the
+ * client was subscribed from.
+ *
+ * 退订客户端 c 订阅的所有模式，返回被退订模式的数量
+ */
+int pubsubUnsubscribeAllPatterns(redisClient *c, int notify) {
+    dictIterator *di = dictGetSafeIterator(c->pubsub_patterns);
+    dictEntry *de;
+    int count = 0;
+
+    while((de = dictNext(di)) != NULL) {
+        sds key = dictGetKey(de);
+        robj *pattern = createStringObject(key,sdslen(key));
+
+        count += pubsubUnsubscribePattern(c,pattern,notify);
+        decrRefCount(pattern);
+    }
+    dictReleaseIterator(di);
+
+    /* We were subscribed to nothing? Still reply to the client. */
+    // 客户端没有订阅任何模式，仍然回复一条通知
+    if (notify && count == 0)
+        addReplyPubsubNotification(c,shared.punsubscribebulk,NULL);
+    return count;
+}
+
+/* Encode a message in the protocol, all at once: the "message" reply sent to
+ * the subscribers of the channel, or the "pmessage" one sent to the
+ * subscribers of 'pattern' if it is not NULL.
+ *
+ * 将消息一次性编码成协议格式：
+ * pattern 为 NULL 时，创建发送给频道订阅者的 message 回复，
+ * 否则创建发送给模式订阅者的 pmessage 回复。
+ */
+static robj *createPubsubMessage(sds pattern, robj *channel, robj *message) {
+    size_t chlen = sdslen(channel->ptr), msglen = sdslen(message->ptr);
+    size_t patlen = pattern ? sdslen(pattern) : 0;
+    sds s = sdsMakeRoomFor(sdsempty(),64+patlen+chlen+msglen);
+
+    if (pattern) {
+        s = sdscatlen(s,"*4\r\n$8\r\npmessage\r\n",18);
+        s = sdscatprintf(s,"$%lu\r\n",(unsigned long)patlen);
+        s = sdscatlen(s,pattern,patlen);
+        s = sdscatlen(s,"\r\n",2);
+    } else {
+        s = sdscatlen(s,"*3\r\n$7\r\nmessage\r\n",17);
+    }
+    s = sdscatprintf(s,"$%lu\r\n",(unsigned long)chlen);
+    s = sdscatlen(s,channel->ptr,chlen);
+    s = sdscatprintf(s,"\r\n$%lu\r\n",(unsigned long)msglen);
+    s = sdscatlen(s,message->ptr,msglen);
+    s = sdscatlen(s,"\r\n",2);
+    return createObject(REDIS_STRING,s);
+}
+
+/*
+ * 将编码好的消息发送给链表中的所有客户端，返回接收者的数量
+ */
+static int pubsubSendMessage(list *clients, robj *msg) {
+    listIter li;
+    listNode *ln;
+    int receivers = 0;
+
+    listRewind(clients,&li);
+    while ((ln = listNext(&li)) != NULL) {
+        addReplyShared(ln->value,msg);
+        receivers++;
+    }
+    return receivers;
+}
+
+/* State of a PUBLISH while the pattern index is walked. */
+typedef struct pubsubPublishState {
+    robj *channel;
+    robj *message;
+    int receivers;
+} pubsubPublishState;
+
+/*
+ * 将消息发送给节点 n 保存的模式中，和频道匹配的那些模式的订阅者
+ */
+static void patternNodePublish(radixNode *n, void *privdata) {
+    pubsubPublishState *ps = privdata;
+    sds channel = ps->channel->ptr;
+    dictIterator *di = dictGetIterator(n->value);
+    dictEntry *de;
+
+    while((de = dictNext(di)) != NULL) {
+        sds pattern = dictGetKey(de);
+        robj *msg;
+
+        if (!stringmatchlen(pattern,sdslen(pattern),
+                            channel,sdslen(channel),0)) continue;
+
+        // 同一个模式的所有订阅者共用一条编码好的消息
+        msg = createPubsubMessage(pattern,ps->channel,ps->message);
+        ps->receivers += pubsubSendMessage(dictGetVal(de),msg);
+        decrRefCount(msg);
+    }
+    dictReleaseIterator(di);
+}
+
+/* Publish a message to the subscribers of the channel and of the matching
+ * patterns. Returns the number of clients that received the message.
+ *
+ * 将 message 发送给频道 channel 的订阅者，以及和频道匹配的模式的订阅者，
+ * 返回接收到消息的客户端数量。
+ */
+int pubsubPublishMessage(robj *channel, robj *message) {
+    pubsubPublishState ps;
+    list *clients;
+
+    ps.channel = channel;
+    ps.message = message;
+    ps.receivers = 0;
+
+    /* Send to clients listening for that channel */
+    clients = dictFetchValue(server.pubsub_channels,channel->ptr);
+    if (clients) {
+        robj *msg = createPubsubMessage(NULL,channel,message);
+
+        ps.receivers += pubsubSendMessage(clients,msg);
+        decrRefCount(msg);
+    }
+
+    /* Send to clients listening to matching patterns. Only the patterns
+     * whose literal prefix is a prefix of the channel can match, and those
+     * are exactly the ones stored along the path of the channel name. */
+    // 只有字面前缀是频道名字前缀的模式才可能匹配，
+    // 它们正好保存在沿着频道名字向下的路径上
+    radixWalkPrefixes(server.pubsub_patterns,channel->ptr,
+                      sdslen(channel->ptr),patternNodePublish,&ps);
+    return ps.receivers;
+}
+
+/*-----------------------------------------------------------------------------
+ * Pubsub commands implementation
+ *----------------------------------------------------------------------------*/
+
+/*
+ * SUBSCRIBE channel [channel ...]
+ */
+void subscribeCommand(redisClient *c) {
+    int j;
+
+    for (j = 1; j < c->argc; j++)
+        pubsubSubscribeChannel(c,c->argv[j]);
+}
+
+/*
+ * UNSUBSCRIBE [channel [channel ...]]
+ */
+void unsubscribeCommand(redisClient *c) {
+    if (c->argc == 1) {
+        pubsubUnsubscribeAllChannels(c,1);
+    } else {
+        int j;
+
+        for (j = 1; j < c->argc; j++)
+            pubsubUnsubscribeChannel(c,c->argv[j],1);
+    }
+}
+
+/*
+ * PSUBSCRIBE pattern [pattern ...]
+ */
+void psubscribeCommand(redisClient *c) {
+    int j;
+
+    for (j = 1; j < c->argc; j++)
+        pubsubSubscribePattern(c,c->argv[j]);
+}
+
+/*
+ * PUNSUBSCRIBE [pattern [pattern ...]]
+ */
+void punsubscribeCommand(redisClient *c) {
+    if (c->argc == 1) {
+        pubsubUnsubscribeAllPatterns(c,1);
+    } else {
+        int j;
+
+        for (j = 1; j < c->argc; j++)
+            pubsubUnsubscribePattern(c,c->argv[j],1);
+    }
+}
+
+/*
+ * PUBLISH channel message
+ */
+void publishCommand(redisClient *c) {
+    int receivers = pubsubPublishMessage(c->argv[1],c->argv[2]);
+
+    // 消息不会修改数据库，但仍然需要发送给从服务器，
+    // 让从服务器的订阅者也能收到
+    if (!(c->flags & REDIS_MASTER)) c->flags |= REDIS_FORCE_REPL;
+    addReplyLongLong(c,receivers);
+}
+
+/*
+ * PUBSUB CHANNELS [pattern]
+ * PUBSUB NUMSUB [channel ...]
+ * PUBSUB NUMPAT
+ */
+void pubsubCommand(redisClient *c) {
+    if (!strcasecmp(c->argv[1]->ptr,"channels") &&
+        (c->argc == 2 || c->argc == 3))
+    {
+        /* PUBSUB CHANNELS [<pattern>] */
+        sds pat = (c->argc == 2) ? NULL : c->argv[2]->ptr;
+        dictIterator *di = dictGetIterator(server.pubsub_channels);
+        dictEntry *de;
+        sds *channels;
+        long j, numchannels = 0;
+
+        // 先收集匹配的频道，得出回复的长度
+        channels = zmalloc(sizeof(sds)*(dictSize(server.pubsub_channels)+1));
+        while((de = dictNext(di)) != NULL) {
+            sds channel = dictGetKey(de);
+
+            if (!pat || stringmatchlen(pat, sdslen(pat),
+                                       channel, sdslen(channel),0))
+                channels[numchannels++] = channel;
+        }
+        dictReleaseIterator(di);
+
+        addReplyMultiBulkLen(c,numchannels);
+        for (j = 0; j < numchannels; j++)
+            addReplyBulkSds(c,sdsdup(channels[j]));
+        zfree(channels);
+    } else if (!strcasecmp(c->argv[1]->ptr,"numsub") && c->argc >= 2) {
+        /* PUBSUB NUMSUB [Channel_1 ... Channel_N] */
+        int j;
+
+        addReplyMultiBulkLen(c,(c->argc-2)*2);
+        for (j = 2; j < c->argc; j++) {
+            list *l = dictFetchValue(server.pubsub_channels,c->argv[j]->ptr);
+
+            addReplyBulk(c,c->argv[j]);
+            addReplyLongLong(c,l ? listLength(l) : 0);
+        }
+    } else if (!strcasecmp(c->argv[1]->ptr,"numpat") && c->argc == 2) {
+        /* PUBSUB NUMPAT */
+        addReplyLongLong(c,server.pubsub_numpat);
+    } else {
+        addReplyErrorFormat(c,
+            "Unknown PUBSUB subcommand or wrong number of arguments for '%s'",
+            (char*)c->argv[1]->ptr);
+    }
+}
@@ -0,0 +1,204 @@
+/* A compressed radix tree of byte strings, see radix.h.
+ *
+ * 压缩的基数树，见 radix.h
+ */
+
+#include <string.h>
+#include "radix.h"
+#include "zmalloc.h"
+#include "adlist.h"
+
+/*
+ * 创建一个节点，并将它添加为 parent 的子节点（如果 parent 不为 NULL 的话）
+ */
+static radixNode *radixNodeCreate(radixTree *t, radixNode *parent,
+                                  const char *edge, size_t len)
+{
+    radixNode *n = zmalloc(sizeof(*n));
+
+    n->edge = sdsnewlen(edge,len);
+    n->parent = parent;
+    n->children = NULL;
+    n->numchildren = 0;
+    n->value = NULL;
+
+    if (parent) {
+        parent->children = zrealloc(parent->children,
+            sizeof(radixNode*)*(parent->numchildren+1));
+        parent->children[parent->numchildren++] = n;
+    }
+    t->numnodes++;
+    return n;
+}
+
+/*
+ * 释放节点本身，节点的值必须已经被调用者清空
+ */
+static void radixNodeRelease(radixTree *t, radixNode *n) {
+    sdsfree(n->edge);
+    zfree(n->children);
+    zfree(n);
+    t->numnodes--;
+}
+
+/*
+ * 返回 n 的边以字节 c 开头的子节点的索引，没有这样的子节点时返回 -1
+ */
+static int radixNodeChild(radixNode *n, unsigned char c) {
+    int j;
+
+    for (j = 0; j < n->numchildren; j++)
+        if ((unsigned char)n->children[j]->edge[0] == c) return j;
+    return -1;
+}
+
+/*
+ * 创建一棵只有根节点的空树
+ */
+radixTree *radixCreate(void) {
+    radixTree *t = zmalloc(sizeof(*t));
+
+    t->numnodes = 0;
+    t->root = radixNodeCreate(t,NULL,"",0);
+    return t;
+}
+
+/* Return the node of the given string. If 'create' is true missing nodes
+ * are added, splitting an edge when the string ends in the middle of it,
+ * otherwise NULL is returned when there is no such node.
+ *
+ * 返回给定字符串对应的节点。
+ * 如果 create 为真，那么在节点不存在时创建它，字符串在一条边的中间结束时拆分这条边；
+ * 否则在节点不存在时返回 NULL 。
+ */
+radixNode *radixLookup(radixTree *t, const char *s, size_t len, int create) {
+    radixNode *n = t->root;
+
+    while (len) {
+        radixNode *child, *mid;
+        size_t edgelen, common = 0;
+        int j = radixNodeChild(n,s[0]);
+
+        if (j == -1) return create ? radixNodeCreate(t,n,s,len) : NULL;
+
+        child = n->children[j];
+        edgelen = sdslen(child->edge);
+        while (common < edgelen && common < len &&
+               child->edge[common] == s[common]) common++;
+
+        if (common < edgelen) {
+            if (!create) return NULL;
+
+            // 字符串在边的中间结束，或者在边的中间分叉：
+            // 使用一个新节点保存公共部分，原来的子节点成为新节点的子节点
+            mid = radixNodeCreate(t,NULL,child->edge,common);
+            mid->parent = n;
+            mid->children = zmalloc(sizeof(radixNode*));
+            mid->children[0] = child;
+            mid->numchildren = 1;
+            n->children[j] = mid;
+
+            sdsrange(child->edge,common,-1);
+            child->parent = mid;
+            child = mid;
+        }
+
+        n = child;
+        s += common;
+        len -= common;
+    }
+    return n;
+}
+
+/* Called after the value of 'n' was set to NULL: drop the nodes that are
+ * no longer needed and merge a node left with a single child into it, so
+ * that the tree doesn't keep the shape of the strings removed.
+ *
+ * 在节点 n 的值被设为 NULL 之后调用：
+ * 删除不再需要的节点，并将只剩下一个子节点的节点和它的子节点合并。
+ */
+void radixCompact(radixTree *t, radixNode *n) {
+    radixNode *parent, *child;
+    int j;
+
+    if (n->parent == NULL || n->value) return;
+
+    // 叶子节点：从父节点中删除
+    if (n->numchildren == 0) {
+        parent = n->parent;
+        for (j = 0; parent->children[j] != n; j++);
+        parent->children[j] = parent->children[--parent->numchildren];
+        radixNodeRelease(t,n);
+
+        n = parent;
+        if (n->parent == NULL || n->value) return;
+    }
+
+    // 只有一个子节点：将两条边拼接起来，由子节点取代 n
+    if (n->numchildren == 1) {
+        child = n->children[0];
+        parent = n->parent;
+
+        n->edge = sdscatlen(n->edge,child->edge,sdslen(child->edge));
+        sdsfree(child->edge);
+        child->edge = n->edge;
+        n->edge = NULL;
+
+        child->parent = parent;
+        for (j = 0; parent->children[j] != n; j++);
+        parent->children[j] = child;
+        radixNodeRelease(t,n);
+    }
+}
+
+/* Call 'fn' for every node having a value whose string is a prefix of 's',
+ * the empty string included, from the shortest to the longest.
+ *
+ * 对字符串是 s 的前缀（包括空字符串）并且有值的每个节点调用 fn ，
+ * 从最短的前缀到最长的前缀。
+ */
+void radixWalkPrefixes(radixTree *t, const char *s, size_t len,
+                       radixWalkProc *fn, void *privdata)
+{
+    radixNode *n = t->root;
+
+    if (n->value) fn(n,privdata);
+    while (len) {
+        radixNode *child;
+        size_t edgelen;
+        int j = radixNodeChild(n,s[0]);
+
+        if (j == -1) break;
+        child = n->children[j];
+        edgelen = sdslen(child->edge);
+        if (edgelen > len || memcmp(child->edge,s,edgelen) != 0) break;
+
+        n = child;
+        s += edgelen;
+        len -= edgelen;
+        if (n->value) fn(n,privdata);
+    }
+}
+
+/* Call 'fn' for every node having a value. The tree must not be modified
+ * by 'fn'.
+ *
+ * 对树中每个有值的节点调用 fn ， fn 不能修改树的结构。
+ */
+void radixWalk(radixTree *t, radixWalkProc *fn, void *privdata) {
+    list *stack = listCreate();
+    listNode *ln;
+    int j;
+
+    // 使用显式的栈进行深度优先遍历，避免深层的递归
+    listAddNodeTail(stack,t->root);
+    while ((ln = listLast(stack)) != NULL) {
+        radixNode *n = listNodeValue(ln);
+
+        listDelNode(stack,ln);
+        if (n->value) fn(n,privdata);
+        for (j = 0; j < n->numchildren; j++)
+            listAddNodeTail(stack,n->children[j]);
+    }
+    listRelease(stack);
+}
@@ -0,0 +1,70 @@
+/* A compressed radix tree of byte strings.
+ *
+ * 压缩的基数树
+ *
+ * Every node stores an optional value for the string spelled by the path
+ * from the root to the node. The edges carry whole runs of bytes, and a node
+ * without value always has two children or more (except the root), so the
+ * size of the tree depends on the number of strings and not on their length.
+ *
+ * 每个节点保存着从根节点到该节点的路径所组成的字符串对应的值（可以为空）。
+ * 边上保存的是一段字节而不是单个字节，除根节点之外，不保存值的节点至少有两个子节点，
+ * 所以树的大小取决于字符串的数量，而不是字符串的长度。
+ *
+ * The tree is used to find all the stored strings that are a prefix of a
+ * given string: Pub/Sub patterns by literal prefix, client side caching
+ * prefixes in broadcast mode.
+ *
+ * 这棵树用于找出给定字符串的所有前缀：
+ * 按照字面前缀保存的 Pub/Sub 模式，以及广播模式下客户端缓存追踪的前缀。
+ */
+
+#ifndef __RADIX_H
+#define __RADIX_H
+
+#include <stddef.h>
+#include "sds.h"
+
+/*
+ * 基数树节点
+ */
+typedef struct radixNode {
+
+    // 从父节点到本节点的边上的字节，根节点为空字符串
+    sds edge;
+
+    // 父节点，根节点为 NULL
+    struct radixNode *parent;
+
+    // 子节点，各个子节点的边的第一个字节都不相同
+    struct radixNode **children;
+    int numchildren;
+
+    // 节点的值，由调用者管理，为 NULL 表示没有字符串在本节点结束
+    void *value;
+} radixNode;
+
+/*
+ * 基数树
+ */
+typedef struct radixTree {
+
+    // 根节点，对应空字符串
+    radixNode *root;
+
+    // 节点数量，包括根节点
+    unsigned long numnodes;
+} radixTree;
+
+/* Called for the nodes having a value by the walk functions. */
+typedef void radixWalkProc(radixNode *n, void *privdata);
+
+/* API */
+radixTree *radixCreate(void);
+radixNode *radixLookup(radixTree *t, const char *s, size_t len, int create);
+void radixCompact(radixTree *t, radixNode *n);
+void radixWalkPrefixes(radixTree *t, const char *s, size_t len,
+                       radixWalkProc *fn, void *privdata);
+void radixWalk(radixTree *t, radixWalkProc *fn, void *privdata);
+
+#endif /* __RADIX_H */
@@ -0,0 +1,1951 @@
+/* RDB persistence: point in time snapshots of the dataset.
+ *
+ * RDB 持久化：数据库在某个时间点的快照
+ *
+ * The file is a sequence of opcodes and key/value pairs:
+ *
+ *   "REDIS0007" [SELECTDB <db> RESIZEDB <db_size> <expires_size>]
+ *   [EXPIRETIME_MS <ms>] <type> <key> <value> ... EOF <crc64>
+ *
+ * RESIZEDB follows every SELECTDB with the number of keys and of volatile
+ * keys of the DB, so the loader can size the hash tables up front.
+ *
+ * 每个 SELECTDB 之后是 RESIZEDB ，记录数据库的键数量以及带有过期时间的键数量，
+ * 载入时据此预先分配哈希表。
+ *
+ * Lengths use a 1, 2 or 5 bytes prefix encoding, strings that look like
+ * integers are stored as 1, 2 or 4 bytes integers, and the whole stream is
+ * checksummed with CRC64 while it is written, so the trailer costs no
+ * second pass over the file.
+ *
+ * 长度使用 1 、 2 或 5 字节的前缀编码，可以表示为整数的字符串保存为 1 、 2 或 4 字节整数，
+ * 整个文件在写入的同时计算 CRC64 校验和，不需要再读一遍文件。
+ */
+
+#include "redis.h"
+#include "rdb.h"
+#include "crc64.h"
+#include "cluster.h"
+
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <libgen.h>
+#include <fcntl.h>
+
+/*
+ * 将长度为 len 的字符数组 p 写入到 rdb 中。
+ *
+ * 写入成功返回 len ，失败返回 -1 。
+ */
+static int rdbWriteRaw(rio *rdb, void *p, size_t len) {
+    if (rdb && rioWrite(rdb,p,len) == 0)
+        return -1;
+    return len;
+}
+
+/*
+ * 将长度为 1 字节的字符 type 写入到 rdb 文件中。
+ */
+int rdbSaveType(rio *rdb, unsigned char type) {
+    return rdbWriteRaw(rdb,&type,1);
+}
+
+/* Load a "type" in RDB format, that is a one byte unsigned integer.
+ *
+ * 从 rdb 中载入 1 字节长的 type 数据。
+ *
+ * This function is not only used to load object types, but also special
+ * "types" like the end-of-file type, the EXPIRE type, and so forth.
+ *
+ * 函数即可以用于载入键的类型（rdb.h/REDIS_RDB_TYPE_*），
+ * 也可以用于载入特殊标识号（rdb.h/REDIS_RDB_OPCODE_*）
+ */
+int rdbLoadType(rio *rdb) {
+    unsigned char type;
+    if (rioRead(rdb,&type,1) == 0) return -1;
+    return type;
+}
+
+/*
+ * 以秒为单位写入过期时间，长度为 4 字节
+ */
+int rdbSaveTime(rio *rdb, time_t t) {
+    int32_t t32 = (int32_t) t;
+    return rdbWriteRaw(rdb,&t32,4);
+}
+
+/*
+ * 载入以秒为单位的过期时间，长度为 4 字节
+ */
+time_t rdbLoadTime(rio *rdb) {
+    int32_t t32;
+    if (rioRead(rdb,&t32,4) == 0) return -1;
+    return (time_t)t32;
+}
+
+/*
+ * 将长度为 8 字节的毫秒过期时间写入到 rdb 中。
+ */
+int rdbSaveMillisecondTime(rio *rdb, long long t) {
+    int64_t t64 = (int64_t) t;
+    return rdbWriteRaw(rdb,&t64,8);
+}
+
+/*
+ * 从 rdb 中载入 8 字节长的毫秒过期时间。
+ */
+long long rdbLoadMillisecondTime(rio *rdb) {
+    int64_t t64;
+    if (rioRead(rdb,&t64,8) == 0) return -1;
+    return (long long)t64;
+}
+
+/* Saves an encoded length. The first two bits in the first byte are used to
+ * hold the encoding type. See the REDIS_RDB_* definitions for more information
+ * on the types of encoding.
+ *
+ * 对 len 进行特殊编码之后写入到 rdb 。
+ *
+ * 写入成功返回保存编码后的 len 所需的字节数。
+ */
+int rdbSaveLen(rio *rdb, uint32_t len) {
+    unsigned char buf[2];
+    size_t nwritten;
+
+    if (len < (1<<6)) {
+        /* Save a 6 bit len */
+        buf[0] = (len&0xFF)|(REDIS_RDB_6BITLEN<<6);
+        if (rdbWriteRaw(rdb,buf,1) == -1) return -1;
+        nwritten = 1;
+
+    } else if (len < (1<<14)) {
+        /* Save a 14 bit len */
+        buf[0] = ((len>>8)&0xFF)|(REDIS_RDB_14BITLEN<<6);
+        buf[1] = len&0xFF;
+        if (rdbWriteRaw(rdb,buf,2) == -1) return -1;
+        nwritten = 2;
+
+    } else {
+        /* Save a 32 bit len */
+        buf[0] = (REDIS_RDB_32BITLEN<<6);
+        if (rdbWriteRaw(rdb,buf,1) == -1) return -1;
+        len = htonl(len);
+        if (rdbWriteRaw(rdb,&len,4) == -1) return -1;
+        nwritten = 1+4;
+    }
+
+    return nwritten;
+}
+
+/* Load an encoded length. The "isencoded" argument is set to 1 if the length
+ * is not actually a length but an "encoding type". See the REDIS_RDB_ENC_*
+ * definitions in rdb.h for more information.
+ *
+ * 读入一个被编码的长度值。
+ *
+ * 如果 length 值不是整数，而是一个被编码后值，那么 isencoded 将被设为 1 。
+ */
+uint32_t rdbLoadLen(rio *rdb, int *isencoded) {
+    unsigned char buf[2];
+    uint32_t len;
+    int type;
+
+    if (isencoded) *isencoded = 0;
+
+    // 读入 length ，这个值可能已经被编码，也可能没有
+    if (rioRead(rdb,buf,1) == 0) return REDIS_RDB_LENERR;
+
+    type = (buf[0]&0xC0)>>6;
+
+    // 编码值，进行解码
+    if (type == REDIS_RDB_ENCVAL) {
+        /* Read a 6 bit encoding type. */
+        if (isencoded) *isencoded = 1;
+        return buf[0]&0x3F;
+
+    // 6 位整数
+    } else if (type == REDIS_RDB_6BITLEN) {
+        /* Read a 6 bit len. */
+        return buf[0]&0x3F;
+
+    // 14 位整数
+    } else if (type == REDIS_RDB_14BITLEN) {
+        /* Read a 14 bit len. */
+        if (rioRead(rdb,buf+1,1) == 0) return REDIS_RDB_LENERR;
+        return ((buf[0]&0x3F)<<8)|buf[1];
+
+    // 32 位整数
+    } else {
+        /* Read a 32 bit len. */
+        if (rioRead(rdb,&len,4) == 0) return REDIS_RDB_LENERR;
+        return ntohl(len);
+    }
+}
+
+/* Encodes the "value" argument as integer when it fits in the supported ranges
+ * for encoded types. If the function successfully encodes the integer, the
+ * representation is stored in the buffer pointer to by "enc" and the string
+ * length is returned. Otherwise 0 is returned.
+ *
+ * 尝试使用特殊的整数编码来保存 value ，这要求它的值必须在给定范围之内。
+ *
+ * 如果可以编码的话，将编码后的值保存在 enc 指针中，
+ * 并返回值在编码后所需的长度。
+ *
+ * 如果不能编码的话，返回 0 。
+ */
+int rdbEncodeInteger(long long value, unsigned char *enc) {
+
+    if (value >= -(1<<7) && value <= (1<<7)-1) {
+        enc[0] = (REDIS_RDB_ENCVAL<<6)|REDIS_RDB_ENC_INT8;
+        enc[1] = value&0xFF;
+        return 2;
+
+    } else if (value >= -(1<<15) && value <= (1<<15)-1) {
+        enc[0] = (REDIS_RDB_ENCVAL<<6)|REDIS_RDB_ENC_INT16;
+        enc[1] = value&0xFF;
+        enc[2] = (value>>8)&0xFF;
+        return 3;
+
+    } else if (value >= -((long long)1<<31) && value <= ((long long)1<<31)-1) {
+        enc[0] = (REDIS_RDB_ENCVAL<<6)|REDIS_RDB_ENC_INT32;
+        enc[1] = value&0xFF;
+        enc[2] = (value>>8)&0xFF;
+        enc[3] = (value>>16)&0xFF;
+        enc[4] = (value>>24)&0xFF;
+        return 5;
+
+    } else {
+        return 0;
+    }
+}
+
+/* Loads an integer-encoded object with the specified encoding type "enctype".
+ * The returned value changes according to the flags, see
+ * rdbGenericLoadStringObject() for more info.
+ *
+ * 载入被 enctype 指定的类型编码的整数对象，返回值的类型由 flags 决定。
+ */
+void *rdbLoadIntegerObject(rio *rdb, int enctype, int flags) {
+    unsigned char enc[4];
+    long long val;
+
+    // 整数编码
+    if (enctype == REDIS_RDB_ENC_INT8) {
+        if (rioRead(rdb,enc,1) == 0) return NULL;
+        val = (signed char)enc[0];
+    } else if (enctype == REDIS_RDB_ENC_INT16) {
+        uint16_t v;
+        if (rioRead(rdb,enc,2) == 0) return NULL;
+        v = enc[0]|(enc[1]<<8);
+        val = (int16_t)v;
+    } else if (enctype == REDIS_RDB_ENC_INT32) {
+        uint32_t v;
+        if (rioRead(rdb,enc,4) == 0) return NULL;
+        v = enc[0]|(enc[1]<<8)|(enc[2]<<16)|((uint32_t)enc[3]<<24);
+        val = (int32_t)v;
+    } else {
+        redisLog(REDIS_WARNING,"Unknown RDB integer encoding type %d",enctype);
+        return NULL;
+    }
+
+    if (flags & RDB_LOAD_SDS)
+        // 不创建对象，直接返回 sds
+        return sdsfromlonglong(val);
+    else if (flags & RDB_LOAD_ENC)
+        // 整数编码的字符串
+        return createStringObjectFromLongLong(val);
+    else
+        // 未编码
+        return createObject(REDIS_STRING,sdsfromlonglong(val));
+}
+
+/* String objects in the form "2391" "-100" without any space and with a
+ * range of values that can fit in an 8, 16 or 32 bit signed value can be
+ * encoded as integers to save space
+ *
+ * 那些保存像是 "2391" 、 "-100" 这样的字符串的字符串对象，
+ * 可以将它们的值保存到 8 位、16 位或 32 位的带符号整数值中，
+ * 从而节省一些内存。
+ *
+ * 这个函数就是尝试将字符串编码成整数，
+ * 如果成功的话，返回保存整数值所需的字节数，这个值必然大于 0 。
+ *
+ * 如果转换失败，那么返回 0 。
+ */
+int rdbTryIntegerEncoding(char *s, size_t len, unsigned char *enc) {
+    long long value;
+    char *endptr, buf[32];
+
+    /* Check if it's possible to encode this value as a number */
+    // 尝试将值转换为整数
+    value = strtoll(s, &endptr, 10);
+    if (endptr[0] != '\0') return 0;
+
+    // 尝试将转换后的整数转换回字符串
+    ll2string(buf,32,value);
+
+    /* If the number converted back into a string is not identical
+     * then it's not possible to encode the string as integer */
+    // 检查两次转换后的整数值能否还原回原来的字符串
+    // 如果不行的话，那么转换失败
+    if (strlen(buf) != len || memcmp(buf,s,len)) return 0;
+
+    // 转换成功，对转换所得的整数进行特殊编码
+    return rdbEncodeInteger(value,enc);
+}
+
+/* Save a string objet as [len][data] on disk. If the object is a string
+ * representation of an integer value we try to save it in a special form
+ *
+ * 以 [len][data] 的形式将字符串对象写入到 rdb 中。
+ *
+ * 如果对象是字符串表示的整数值，那么程序尝试以特殊的形式来保存它。
+ *
+ * 函数返回保存字符串所需的空间字节数。
+ *
+ * Strings are stored as they are: there is no LZF compression in this
+ * tree, so REDIS_RDB_ENC_LZF is never produced.
+ *
+ * 这里没有 LZF 压缩，字符串按原样保存。
+ */
+int rdbSaveRawString(rio *rdb, unsigned char *s, size_t len) {
+    int enclen;
+    int n, nwritten = 0;
+
+    /* Try integer encoding */
+    // 尝试进行整数值编码
+    if (len <= 11) {
+        unsigned char buf[5];
+        if ((enclen = rdbTryIntegerEncoding((char*)s,len,buf)) > 0) {
+            // 整数转换成功，写入
+            if (rdbWriteRaw(rdb,buf,enclen) == -1) return -1;
+            // 返回字节数
+            return enclen;
+        }
+    }
+
+    /* Store verbatim */
+    // 执行到这里，说明值 s 既不能编码为整数，所以以原样写入
+
+    // 写入长度
+    if ((n = rdbSaveLen(rdb,len)) == -1) return -1;
+    nwritten += n;
+
+    // 写入内容
+    if (len > 0) {
+        if (rdbWriteRaw(rdb,s,len) == -1) return -1;
+        nwritten += len;
+    }
+
+    return nwritten;
+}
+
+/* Save a long long value as either an encoded string or a string.
+ *
+ * 将输入的 long long 类型的 value 转换成一个特殊编码的字符串，
+ * 或者是一个普通的字符串表示的整数，
+ * 然后将它写入到 rdb 中。
+ *
+ * 函数返回在 rdb 中保存 value 所需的字节数。
+ */
+int rdbSaveLongLongAsStringObject(rio *rdb, long long value) {
+    unsigned char buf[32];
+    int n, nwritten = 0;
+
+    // 尝试以节省空间的方式编码整数值 value
+    int enclen = rdbEncodeInteger(value,buf);
+
+    // 编码成功，直接写入编码后的缓存
+    // 比如，值 1 可以编码为 11 00 0001
+    if (enclen > 0) {
+        return rdbWriteRaw(rdb,buf,enclen);
+
+    // 编码失败，将整数值转换成对应的字符串来保存
+    // 比如，值 999999999 要编码成 "999999999" ，
+    // 因为这个值没办法用节省空间的方式编码
+    } else {
+        /* Encode as string */
+        // 转换成字符串表示
+        enclen = ll2string((char*)buf,32,value);
+        redisAssert(enclen < 32);
+        // 写入字符串长度
+        if ((n = rdbSaveLen(rdb,enclen)) == -1) return -1;
+        nwritten += n;
+        // 写入字符串
+        if ((n = rdbWriteRaw(rdb,buf,enclen)) == -1) return -1;
+        nwritten += n;
+    }
+
+    // 返回长度
+    return nwritten;
+}
+
+/* Like rdbSaveStringObjectRaw() but handle encoded objects
+ *
+ * 将给定的字符串对象 obj 保存到 rdb 中。
+ *
+ * 函数返回 rdb 保存字符串对象所需的字节数。
+ */
+int rdbSaveStringObject(rio *rdb, robj *obj) {
+
+    /* Avoid to decode the object, then encode it again, if the
+     * object is already integer encoded. */
+    // 尝试对 INT 编码的字符串进行特殊编码
+    if (obj->encoding == REDIS_ENCODING_INT) {
+        return rdbSaveLongLongAsStringObject(rdb,(long)obj->ptr);
+
+    // 保存 STRING 编码的字符串
+    } else {
+        redisAssertWithInfo(NULL,obj,sdsEncodedObject(obj));
+        return rdbSaveRawString(rdb,obj->ptr,sdslen(obj->ptr));
+    }
+}
+
+/*
+ * 从 rdb 中载入一个字符串对象
+ *
+ * flags 为 RDB_LOAD_ENC 时，使用 INT 编码或者 EMBSTR 编码来保存字符串对象；
+ * flags 为 RDB_LOAD_SDS 时，不创建对象，直接返回 sds （用于载入键名）。
+ *
+ * Returns NULL on short read or if the string uses an encoding this build
+ * can't decode.
+ */
+void *rdbGenericLoadStringObject(rio *rdb, int flags) {
+    int encode = flags & RDB_LOAD_ENC;
+    int isencoded;
+    uint32_t len;
+    robj *o;
+
+    // 长度
+    len = rdbLoadLen(rdb,&isencoded);
+
+    // 这是一个特殊编码字符串
+    if (isencoded) {
+        switch(len) {
+
+        // 整数编码
+        case REDIS_RDB_ENC_INT8:
+        case REDIS_RDB_ENC_INT16:
+        case REDIS_RDB_ENC_INT32:
+            return rdbLoadIntegerObject(rdb,len,flags);
+
+        // LZF 压缩的字符串
+        case REDIS_RDB_ENC_LZF:
+            redisLog(REDIS_WARNING,
+                "LZF compressed strings are not supported in this build");
+            return NULL;
+
+        default:
+            redisLog(REDIS_WARNING,"Unknown RDB string encoding type %d",len);
+            return NULL;
+        }
+    }
+
+    // 执行到这里，说明这个字符串即没有被压缩，也不是整数
+    // 那么直接从 rdb 中读入它
+    if (len == REDIS_RDB_LENERR) return NULL;
+    if (flags & RDB_LOAD_SDS) {
+        sds s = sdsnewlen(NULL,len);
+        if (len && rioRead(rdb,s,len) == 0) {
+            sdsfree(s);
+            return NULL;
+        }
+        return s;
+    }
+    o = encode ? createStringObject(NULL,len) :
+                 createRawStringObject(NULL,len);
+    if (len && rioRead(rdb,o->ptr,len) == 0) {
+        decrRefCount(o);
+        return NULL;
+    }
+    return o;
+}
+
+robj *rdbLoadStringObject(rio *rdb) {
+    return rdbGenericLoadStringObject(rdb,RDB_LOAD_NONE);
+}
+
+robj *rdbLoadEncodedStringObject(rio *rdb) {
+    return rdbGenericLoadStringObject(rdb,RDB_LOAD_ENC);
+}
+
+/* Save the object type of object "o".
+ *
+ * 将对象 o 的类型写入到 rdb 中
+ */
+int rdbSaveObjectType(rio *rdb, robj *o) {
+    switch (o->type) {
+    case REDIS_STRING:
+        return rdbSaveType(rdb,REDIS_RDB_TYPE_STRING);
+    default:
+        redisPanic("Unknown object type");
+    }
+    return -1; /* avoid warning */
+}
+
+/* Use rdbLoadType() to load a TYPE in RDB format, but returns -1 if the
+ * type is not specifically a valid Object Type.
+ *
+ * 载入对象的类型，并返回。
+ *
+ * 如果载入的类型不是对象类型，返回 -1 。
+ */
+int rdbLoadObjectType(rio *rdb) {
+    int type;
+    if ((type = rdbLoadType(rdb)) == -1) return -1;
+    if (!rdbIsObjectType(type)) return -1;
+    return type;
+}
+
+/* Save a Redis object. Returns -1 on error, 0 on success.
+ *
+ * 将给定对象 o 保存到 rdb 中。
+ *
+ * 保存成功返回 rdb 保存该对象所需的字节数 ，失败返回 0 。
+ */
+int rdbSaveObject(rio *rdb, robj *o) {
+    if (o->type == REDIS_STRING) {
+        /* Save a string value */
+        return rdbSaveStringObject(rdb,o);
+    } else {
+        redisPanic("Unknown object type");
+    }
+    return -1; /* avoid warning */
+}
+
+/* Load a Redis object of the specified type from the specified file.
+ * On success a newly allocated object is returned, otherwise NULL.
+ *
+ * 从 rdb 文件中载入指定类型的对象。
+ *
+ * 读入成功返回一个新对象，否则返回 NULL 。
+ */
+robj *rdbLoadObject(int rdbtype, rio *rdb) {
+    robj *o;
+
+    if (rdbtype == REDIS_RDB_TYPE_STRING) {
+        /* Read string value */
+        if ((o = rdbLoadEncodedStringObject(rdb)) == NULL) return NULL;
+        o = tryObjectEncoding(o);
+    } else {
+        redisPanic("Unknown object type");
+    }
+    return o;
+}
+
+/* Save a key-value pair, with expire time, type, key, value.
+ *
+ * 将键值对的键、值、过期时间和类型写入到 RDB 中。
+ *
+ * On error -1 is returned.
+ *
+ * 出错返回 -1 。
+ *
+ * On success if the key was actually saved 1 is returned, otherwise 0
+ * is returned (the key was already expired).
+ *
+ * 成功保存返回 1 ，当键已经过期时，返回 0 。
+ */
+int rdbSaveKeyValuePair(rio *rdb, robj *key, robj *val,
+                        long long expiretime, long long now)
+{
+    /* Save the expire time */
+    // 保存键的过期时间
+    if (expiretime != -1) {
+        /* If this key is already expired skip it */
+        // 不写入已经过期的键
+        if (expiretime < now) return 0;
+
+        if (rdbSaveType(rdb,REDIS_RDB_OPCODE_EXPIRETIME_MS) == -1) return -1;
+        if (rdbSaveMillisecondTime(rdb,expiretime) == -1) return -1;
+    }
+
+    /* Save type, key, value */
+    // 保存类型，键，值
+    if (rdbSaveObjectType(rdb,val) == -1) return -1;
+    if (rdbSaveStringObject(rdb,key) == -1) return -1;
+    if (rdbSaveObject(rdb,val) == -1) return -1;
+
+    return 1;
+}
+
+/* Produces a dump of the database in RDB format sending it to the specified
+ * Redis I/O channel. On success REDIS_OK is returned, otherwise REDIS_ERR
+ * is returned and part of the output, or all the output, can be
+ * missing because of I/O errors.
+ *
+ * 将数据库以 RDB 格式写入到 rdb 中。
+ *
+ * When the function returns REDIS_ERR and if 'error' is not NULL, the
+ * integer pointed by 'error' is set to the value of errno just after the I/O
+ * error.
+ */
+int rdbSaveRio(rio *rdb, int *error) {
+    dictIterator *di = NULL;
+    dictEntry *de;
+    char magic[10];
+    int j;
+    long long now = mstime();
+    uint64_t cksum;
+    uint32_t db_size, expires_size;
+
+    // 在写入的同时计算校验和
+    if (server.rdb_checksum)
+        rdb->update_cksum = rioGenericUpdateChecksum;
+
+    // 写入 RDB 版本号
+    snprintf(magic,sizeof(magic),"REDIS%04d",REDIS_RDB_VERSION);
+    if (rdbWriteRaw(rdb,magic,9) == -1) goto werr;
+
+    // 遍历所有数据库
+    for (j = 0; j < server.dbnum; j++) {
+
+        // 指向数据库
+        redisDb *db = server.db+j;
+
+        // 指向数据库键空间
+        dict *d = db->dict;
+
+        // 跳过空数据库
+        if (dictSize(d) == 0) continue;
+
+        // 创建键空间迭代器
+        di = dictGetSafeIterator(d);
+        if (!di) return REDIS_ERR;
+
+        /* Write the SELECT DB opcode */
+        // 写入 DB 选择器
+        if (rdbSaveType(rdb,REDIS_RDB_OPCODE_SELECTDB) == -1) goto werr;
+        if (rdbSaveLen(rdb,j) == -1) goto werr;
+
+        /* Write the RESIZE DB opcode. We trim the size to UINT32_MAX, which
+         * is currently the largest type we are able to represent in RDB
+         * sizes. However this does not limit the actual size of the DB to
+         * load since these sizes are just hints to resize the hash tables. */
+        // 写入键空间和过期字典的大小，载入时用来预先分配哈希表，避免 rehash
+        db_size = (dictSize(db->dict) <= UINT32_MAX) ?
+                                dictSize(db->dict) :
+                                UINT32_MAX;
+        expires_size = (dictSize(db->expires) <= UINT32_MAX) ?
+                                dictSize(db->expires) :
+                                UINT32_MAX;
+        if (rdbSaveType(rdb,REDIS_RDB_OPCODE_RESIZEDB) == -1) goto werr;
+        if (rdbSaveLen(rdb,db_size) == -1) goto werr;
+        if (rdbSaveLen(rdb,expires_size) == -1) goto werr;
+
+        /* Iterate this DB writing every entry */
+        // 遍历数据库，并写入每个键值对的数据
+        while((de = dictNext(di)) != NULL) {
+            sds keystr = dictGetKey(de);
+            robj key, *o = dictGetVal(de);
+            long long expire;
+
+            // 根据 keystr ，在栈中创建一个 key 对象
+            initStaticStringObject(key,keystr);
+
+            // 获取键的过期时间
+            expire = getExpire(db,&key);
+
+            // 保存键值对数据
+            if (rdbSaveKeyValuePair(rdb,&key,o,expire,now) == -1) goto werr;
+        }
+        dictReleaseIterator(di);
+        di = NULL;
+    }
+
+    /* EOF opcode */
+    // 写入 EOF 代码
+    if (rdbSaveType(rdb,REDIS_RDB_OPCODE_EOF) == -1) goto werr;
+
+    /* CRC64 checksum. It will be zero if checksum computation is disabled, the
+     * loading code skips the check in this case. */
+    // CRC64 校验和。
+    // 如果校验和功能已关闭，那么 rdb.cksum 将为 0 ，
+    // 在这种情况下， RDB 载入时会跳过校验和检查。
+    cksum = rdbLittleEndian64(rdb->cksum);
+    if (rioWrite(rdb,&cksum,8) == 0) goto werr;
+
+    return REDIS_OK;
+
+werr:
+    if (error) *error = errno;
+    if (di) dictReleaseIterator(di);
+    return REDIS_ERR;
+}
+
+/* Make the rename of the temp file durable: the new directory entry is
+ * only guaranteed to be on disk after the directory itself is synced.
+ *
+ * rename() 之后 fsync 所在的目录，保证新的目录项已经写入磁盘。 */
+void rdbFsyncFileDir(const char *filename) {
+    char *path = zstrdup(filename);
+    int dir_fd = open(dirname(path),O_RDONLY);
+
+    if (dir_fd != -1) {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+    zfree(path);
+}
+
+/* Save the DB on disk. Return REDIS_ERR on error, REDIS_OK on success
+ *
+ * 将数据库保存到磁盘上。
+ *
+ * 保存成功返回 REDIS_OK ，出错/失败返回 REDIS_ERR 。
+ *
+ * The dump is written to a temp file that is renamed over the old one only
+ * after it was fully written and synced, so a crash in the middle of a
+ * save never leaves a truncated file behind.
+ *
+ * 先写入临时文件，完整写入并 fsync 之后才重命名为目标文件，
+ * 所以保存途中崩溃不会留下不完整的 RDB 文件。
+ */
+int rdbSave(char *filename) {
+    char tmpfile[256];
+    char *iobuf;
+    FILE *fp;
+    rio rdb;
+    int error = 0;
+
+    // 创建临时文件
+    snprintf(tmpfile,256,"temp-%d.rdb", (int) getpid());
+    fp = fopen(tmpfile,"w");
+    if (!fp) {
+        redisLog(REDIS_WARNING, "Failed opening .rdb for saving: %s",
+            strerror(errno));
+        return REDIS_ERR;
+    }
+
+    // 使用更大的 stdio 缓冲区，减少 write() 调用的次数
+    iobuf = zmalloc(REDIS_RDB_IOBUF_LEN);
+    setvbuf(fp,iobuf,_IOFBF,REDIS_RDB_IOBUF_LEN);
+
+    // 初始化 I/O
+    rioInitWithFile(&rdb,fp);
+    // 每写入一定数量的字节就执行一次 fsync ，分散磁盘压力
+    rioSetAutoSync(&rdb,REDIS_AUTOSYNC_BYTES);
+
+    if (rdbSaveRio(&rdb,&error) == REDIS_ERR) {
+        errno = error;
+        goto werr;
+    }
+
+    /* Make sure data will not remain on the OS's output buffers */
+    // 冲洗缓存，确保数据已写入磁盘
+    if (fflush(fp) == EOF) goto werr;
+    if (fsync(fileno(fp)) == -1) goto werr;
+    if (fclose(fp) == EOF) { fp = NULL; goto werr; }
+    fp = NULL;
+    zfree(iobuf);
+
+    /* Use RENAME to make sure the DB file is changed atomically only
+     * if the generate DB file is ok. */
+    // 使用 RENAME ，原子性地对临时文件进行改名，覆盖原来的 RDB 文件
+    if (rename(tmpfile,filename) == -1) {
+        redisLog(REDIS_WARNING,"Error moving temp DB file on the final destination: %s", strerror(errno));
+        unlink(tmpfile);
+        return REDIS_ERR;
+    }
+    rdbFsyncFileDir(filename);
+
+    // 写入完成，打印日志
+    redisLog(REDIS_NOTICE,"DB saved on disk");
+
+    // 清零数据库脏状态
+    server.dirty = 0;
+
+    // 记录最后一次完成 SAVE 的时间
+    server.lastsave = time(NULL);
+
+    // 记录最后一次执行 SAVE 的状态
+    server.lastbgsave_status = REDIS_OK;
+
+    return REDIS_OK;
+
+werr:
+    // 关闭文件
+    if (fp) fclose(fp);
+    zfree(iobuf);
+    // 删除文件
+    unlink(tmpfile);
+
+    redisLog(REDIS_WARNING,"Write error saving DB on disk: %s", strerror(errno));
+
+    return REDIS_ERR;
+}
+
+/*
+ * 在子进程中保存数据库，父进程继续处理命令请求
+ *
+ * The child shares the parent memory copy-on-write: every page the parent
+ * writes while the child is running gets duplicated. The amount is sent
+ * back through the child info pipe and reported by INFO as
+ * rdb_last_cow_size, the time spent in fork() as latest_fork_usec.
+ *
+ * 子进程和父进程以写时复制的方式共享内存，子进程运行期间父进程写入的每个页都会被复制。
+ * 复制的数量通过管道发送回父进程，在 INFO 中显示为 rdb_last_cow_size ，
+ * fork() 的耗时显示为 latest_fork_usec 。
+ */
+int rdbSaveBackground(char *filename) {
+    pid_t childpid;
+    long long start;
+
+    // 如果 BGSAVE 或者 BGREWRITEAOF 已经在执行，那么出错
+    if (hasActiveChildProcess()) return REDIS_ERR;
+
+    // 记录 BGSAVE 执行前的数据库被修改次数
+    server.dirty_before_bgsave = server.dirty;
+
+    // 最近一次尝试执行 BGSAVE 的时间
+    server.lastbgsave_try = time(NULL);
+
+    // 子进程用来报告写时复制内存数量的管道
+    openChildInfoPipe();
+
+    // fork() 开始前的时间，记录 fork() 返回耗时用
+    start = ustime();
+
+    if ((childpid = fork()) == 0) {
+        int retval;
+
+        /* Child */
+
+        // 关闭网络连接 fd
+        closeListeningSockets();
+
+        // 执行保存操作
+        retval = rdbSave(filename);
+
+        // 报告写时复制的内存数量
+        if (retval == REDIS_OK) {
+            size_t private_dirty = zmalloc_get_private_dirty();
+
+            if (private_dirty) {
+                redisLog(REDIS_NOTICE,
+                    "RDB: %zu MB of memory used by copy-on-write",
+                    private_dirty/(1024*1024));
+            }
+            server.child_info_data.cow_size = private_dirty;
+            sendChildInfo(CHILD_INFO_TYPE_RDB);
+        }
+
+        // 向父进程发送信号
+        exitFromChild((retval == REDIS_OK) ? 0 : 1);
+
+    } else {
+
+        /* Parent */
+
+        // 计算 fork() 执行的时间
+        server.stat_fork_time = ustime()-start;
+
+        // 如果 fork() 出错，那么报告错误
+        if (childpid == -1) {
+            closeChildInfoPipe();
+            server.lastbgsave_status = REDIS_ERR;
+            redisLog(REDIS_WARNING,"Can't save in background: fork: %s",
+                strerror(errno));
+            return REDIS_ERR;
+        }
+
+        // 打印 BGSAVE 开始的日志
+        redisLog(REDIS_NOTICE,"Background saving started by pid %d",childpid);
+
+        // 记录数据库开始 BGSAVE 的时间
+        server.rdb_save_time_start = time(NULL);
+
+        // 记录负责执行 BGSAVE 的子进程 ID
+        server.rdb_child_pid = childpid;
+        server.rdb_child_type = REDIS_RDB_CHILD_TYPE_DISK;
+
+        // 关闭自动 rehash
+        updateDictResizePolicy();
+
+        return REDIS_OK;
+    }
+
+    return REDIS_OK; /* unreached */
+}
+
+/* This is just a wrapper around rdbSaveRio() that additionally adds a prefix
+ * and a suffix to the generated RDB dump. The prefix is:
+ *
+ * $EOF:<40 bytes unguessable hex string>\r\n
+ *
+ * While the suffix is the 40 bytes hex string we announced in the prefix.
+ * This way processes receiving the payload can understand when it ends
+ * without doing any processing of the content.
+ *
+ * 在 RDB 数据的前后加上随机生成的 40 字节结束标记，
+ * 接收方不需要预先知道 RDB 的长度，读到结束标记就知道传输完成了。 */
+int rdbSaveRioWithEOFMark(rio *rdb, int *error) {
+    char eofmark[REDIS_EOF_MARK_SIZE];
+
+    getRandomHexChars(eofmark,REDIS_EOF_MARK_SIZE);
+    if (error) *error = 0;
+    if (rioWrite(rdb,"$EOF:",5) == 0) goto werr;
+    if (rioWrite(rdb,eofmark,REDIS_EOF_MARK_SIZE) == 0) goto werr;
+    if (rioWrite(rdb,"\r\n",2) == 0) goto werr;
+    if (rdbSaveRio(rdb,error) == REDIS_ERR) goto werr;
+    if (rioWrite(rdb,eofmark,REDIS_EOF_MARK_SIZE) == 0) goto werr;
+    return REDIS_OK;
+
+werr: /* Write error. */
+    /* Set 'error' only if not already set by rdbSaveRio() call. */
+    if (error && *error == 0) *error = errno;
+    return REDIS_ERR;
+}
+
+/* Spawn an RDB child that writes the RDB to the sockets of the slaves
+ * that are currently in REDIS_REPL_WAIT_BGSAVE_START state.
+ *
+ * 创建一个子进程，将 RDB 直接写入所有处于 WAIT_BGSAVE_START 状态的
+ * 从服务器的套接字，数据从内存直接发往网络，中间不经过磁盘文件。
+ *
+ * The +FULLRESYNC reply carrying the replication offset is written by the
+ * parent before fork(), so that every write command executed after the
+ * snapshot point ends up in the slave output buffer, which is only flushed
+ * once the child is done.
+ *
+ * +FULLRESYNC 回复在 fork() 之前由父进程写入，
+ * 之后执行的写命令会积累在从服务器的输出缓冲区中，
+ * 等子进程传输完毕之后才发送。 */
+int rdbSaveToSlavesSockets(void) {
+    int *fds;
+    int numfds;
+    listNode *ln;
+    listIter li;
+    pid_t childpid;
+    long long start;
+    char buf[128];
+    int buflen;
+
+    if (hasActiveChildProcess()) return REDIS_ERR;
+
+    fds = zmalloc(sizeof(int)*listLength(server.slaves));
+    numfds = 0;
+
+    buflen = snprintf(buf,sizeof(buf),"+FULLRESYNC %s %lld\r\n",
+                      server.runid,server.master_repl_offset);
+
+    /* Collect the file descriptors of the slaves we want to transfer
+     * the RDB to, which are i WAIT_BGSAVE_START state. */
+    listRewind(server.slaves,&li);
+    while((ln = listNext(&li))) {
+        redisClient *slave = ln->value;
+
+        if (slave->replstate != REDIS_REPL_WAIT_BGSAVE_START ||
+            (slave->flags & REDIS_CLOSE_ASAP)) continue;
+
+        /* We can't use the connection buffers since they are used to
+         * accumulate new commands at this stage. But we are sure the
+         * socket send buffer is empty so this write will never fail
+         * actually. */
+        if (write(slave->fd,buf,buflen) != buflen) {
+            freeClientAsync(slave);
+            continue;
+        }
+        slave->replstate = REDIS_REPL_WAIT_BGSAVE_END;
+        fds[numfds++] = slave->fd;
+    }
+
+    if (numfds == 0) {
+        zfree(fds);
+        return REDIS_OK;
+    }
+
+    /* Force the next replicated command to be preceded by a SELECT. */
+    server.slaveseldb = -1;
+
+    // 子进程用来报告写时复制内存数量的管道
+    openChildInfoPipe();
+
+    start = ustime();
+    if ((childpid = fork()) == 0) {
+        /* Child */
+        int retval, j;
+        rio slave_sockets;
+
+        closeListeningSockets();
+
+        // 子进程以阻塞的方式写入，慢从服务器的超时由 repl-timeout 控制
+        for (j = 0; j < numfds; j++) {
+            anetBlock(NULL,fds[j]);
+            anetSendTimeout(NULL,fds[j],server.repl_timeout*1000);
+        }
+        rioInitWithFdset(&slave_sockets,fds,numfds);
+        zfree(fds);
+
+        retval = rdbSaveRioWithEOFMark(&slave_sockets,NULL);
+        if (retval == REDIS_OK && rioFdsetFlush(&slave_sockets) == 0)
+            retval = REDIS_ERR;
+
+        if (retval == REDIS_OK) {
+            size_t private_dirty = zmalloc_get_private_dirty();
+
+            if (private_dirty) {
+                redisLog(REDIS_NOTICE,
+                    "RDB: %zu MB of memory used by copy-on-write",
+                    private_dirty/(1024*1024));
+            }
+            server.child_info_data.cow_size = private_dirty;
+            sendChildInfo(CHILD_INFO_TYPE_RDB);
+        }
+        rioFreeFdset(&slave_sockets);
+        exitFromChild((retval == REDIS_OK) ? 0 : 1);
+    } else {
+        /* Parent */
+        server.stat_fork_time = ustime()-start;
+
+        if (childpid == -1) {
+            redisLog(REDIS_WARNING,"Can't save in background: fork: %s",
+                strerror(errno));
+
+            /* The +FULLRESYNC reply was already sent, these slaves can
+             * only start again from scratch. */
+            listRewind(server.slaves,&li);
+            while((ln = listNext(&li))) {
+                redisClient *slave = ln->value;
+
+                if (slave->replstate == REDIS_REPL_WAIT_BGSAVE_END)
+                    freeClientAsync(slave);
+            }
+            closeChildInfoPipe();
+            zfree(fds);
+            return REDIS_ERR;
+        }
+
+        redisLog(REDIS_NOTICE,"Starting BGSAVE for SYNC with target: slaves sockets (pid %d)",
+            childpid);
+        server.rdb_save_time_start = time(NULL);
+        server.rdb_child_pid = childpid;
+        server.rdb_child_type = REDIS_RDB_CHILD_TYPE_SOCKET;
+        updateDictResizePolicy();
+        zfree(fds);
+        return REDIS_OK;
+    }
+    return REDIS_OK; /* unreached */
+}
+
+/*
+ * 移除 BGSAVE 所产生的临时文件
+ *
+ * BGSAVE 执行被中断时使用
+ */
+void rdbRemoveTempFile(pid_t childpid) {
+    char tmpfile[256];
+
+    snprintf(tmpfile,256,"temp-%d.rdb", (int) childpid);
+    unlink(tmpfile);
+}
+
+/* ---------------------------------------------------------------------------
+ * Loading
+ *
+ * 载入 RDB 文件
+ *
+ * The file is mapped in memory and loaded in three steps:
+ *
+ * 1) The main thread scans the records without decoding them, only reading
+ *    types and lengths, and splits the file in chunks of whole records.
+ *    RESIZEDB hints met while scanning presize the dicts before any key is
+ *    added, so there is no rehashing during the load.
+ * 2) Loader threads (rdb-load-threads of them) and the main thread itself
+ *    decode the chunks in parallel, creating the key and value objects.
+ *    Allocation and encoding is where the load spends its time.
+ * 3) The main thread adds the decoded keys to the keyspace in file order,
+ *    since the dicts are not thread safe.
+ *
+ * The checksum of the whole file is computed by another thread meanwhile.
+ *
+ * 文件被映射到内存中，分三步载入：
+ *
+ * 1) 主线程只读取类型和长度，扫描所有记录，将文件切分为多个由完整记录组成的块。
+ *    扫描时遇到的 RESIZEDB 会在添加任何键之前预先分配哈希表，载入期间不会 rehash 。
+ * 2) 载入线程和主线程并行解码各个块，创建键和值对象，这是载入耗时最多的部分。
+ * 3) 因为字典不是线程安全的，由主线程按照文件中的顺序将解码后的键添加到数据库。
+ *
+ * 整个文件的校验和同时由另一个线程计算。
+ * ------------------------------------------------------------------------- */
+
+/* Keys per chunk: big enough to make the hand off between threads cheap,
+ * small enough to keep all the threads busy with small files too. */
+#define RDB_LOAD_CHUNK_KEYS 4096
+
+/* A key decoded by a loader thread, waiting to be added to the keyspace. */
+typedef struct rdbLoadEntry {
+    sds key;
+    robj *val;
+    long long expire;       /* -1 if the key has no expire. */
+    int dbid;
+} rdbLoadEntry;
+
+/* A slice of the mapped file holding whole records. */
+typedef struct rdbLoadChunk {
+    size_t start, end;      /* Offsets of the records in the mapped file. */
+    int dbid;               /* DB selected at 'start'. */
+    int numkeys;            /* Keys found by the scan. */
+    rdbLoadEntry *entries;  /* Decoded keys, expired ones are skipped. */
+    int numentries;
+    int error;              /* Set if the chunk could not be decoded. */
+    int done;               /* Protected by rdbLoadJob.lock. */
+} rdbLoadChunk;
+
+/* State shared by the threads loading a file. */
+typedef struct rdbLoadJob {
+    const char *map;        /* The mapped file. */
+    size_t size;
+    long long now;          /* Keys that expired before 'now' are skipped. */
+    rdbLoadChunk *chunks;
+    int numchunks;
+    int next;               /* Next chunk to decode, updated atomically. */
+    pthread_mutex_t lock;
+    pthread_cond_t cond;    /* Signaled every time a chunk is done. */
+    uint64_t cksum;         /* Computed by the checksum thread. */
+} rdbLoadJob;
+
+/*
+ * 跳过一个字符串，不解码也不复制它
+ *
+ * 成功返回 0 ，出错返回 -1 。
+ */
+static int rdbSkipStringObject(rio *rdb) {
+    int isencoded;
+    uint32_t len = rdbLoadLen(rdb,&isencoded);
+
+    if (isencoded) {
+        switch(len) {
+        case REDIS_RDB_ENC_INT8: return rioMemorySkip(rdb,1) ? 0 : -1;
+        case REDIS_RDB_ENC_INT16: return rioMemorySkip(rdb,2) ? 0 : -1;
+        case REDIS_RDB_ENC_INT32: return rioMemorySkip(rdb,4) ? 0 : -1;
+        default: return -1; /* LZF is not supported. */
+        }
+    }
+    if (len == REDIS_RDB_LENERR) return -1;
+    return rioMemorySkip(rdb,len) ? 0 : -1;
+}
+
+/*
+ * 为新的块分配空间，块从 start 偏移量开始，在 dbid 号数据库中
+ */
+static rdbLoadChunk *rdbLoadAddChunk(rdbLoadJob *job, size_t start, int dbid) {
+    rdbLoadChunk *c;
+
+    job->chunks = zrealloc(job->chunks,sizeof(rdbLoadChunk)*(job->numchunks+1));
+    c = job->chunks+job->numchunks++;
+    memset(c,0,sizeof(*c));
+    c->start = start;
+    c->end = start;
+    c->dbid = dbid;
+    return c;
+}
+
+/* Scan the records after the header, filling job->chunks. On success the
+ * offset of the EOF opcode is stored in *eofpos and REDIS_OK is returned,
+ * REDIS_ERR on a truncated or corrupted file.
+ *
+ * 扫描文件头之后的所有记录，将文件切分为块。
+ *
+ * 成功时将 EOF 标识的偏移量保存到 *eofpos 中，并返回 REDIS_OK ，
+ * 文件被截断或者损坏时返回 REDIS_ERR 。
+ */
+static int rdbLoadScan(rdbLoadJob *job, size_t *eofpos) {
+    rdbLoadChunk *c;
+    int type, dbid = 0;
+    rio rdb;
+
+    rioInitWithMemory(&rdb,job->map,job->size);
+    if (!rioMemorySkip(&rdb,9)) return REDIS_ERR;
+    c = rdbLoadAddChunk(job,9,dbid);
+
+    while(1) {
+        size_t recstart = rioTell(&rdb);
+
+        if ((type = rdbLoadType(&rdb)) == -1) return REDIS_ERR;
+
+        // 过期时间，之后跟着一个键值对
+        if (type == REDIS_RDB_OPCODE_EXPIRETIME) {
+            if (!rioMemorySkip(&rdb,4)) return REDIS_ERR;
+            if ((type = rdbLoadType(&rdb)) == -1) return REDIS_ERR;
+        } else if (type == REDIS_RDB_OPCODE_EXPIRETIME_MS) {
+            if (!rioMemorySkip(&rdb,8)) return REDIS_ERR;
+            if ((type = rdbLoadType(&rdb)) == -1) return REDIS_ERR;
+        }
+
+        if (type == REDIS_RDB_OPCODE_EOF) {
+            c->end = recstart;
+            *eofpos = recstart;
+            return REDIS_OK;
+        }
+
+        // 切换数据库，块也会读到这个标识，只需检查号码
+        if (type == REDIS_RDB_OPCODE_SELECTDB) {
+            uint32_t id = rdbLoadLen(&rdb,NULL);
+
+            if (id == REDIS_RDB_LENERR) return REDIS_ERR;
+            if (id >= (unsigned)server.dbnum) {
+                redisLog(REDIS_WARNING,"FATAL: Data file was created with a Redis server configured to handle more than %d databases. Exiting\n", server.dbnum);
+                exit(1);
+            }
+            dbid = id;
+            continue;
+        }
+
+        // 数据库大小的提示，在添加任何键之前预先分配哈希表
+        if (type == REDIS_RDB_OPCODE_RESIZEDB) {
+            uint32_t db_size, expires_size;
+            redisDb *db = server.db+dbid;
+
+            if ((db_size = rdbLoadLen(&rdb,NULL)) == REDIS_RDB_LENERR)
+                return REDIS_ERR;
+            if ((expires_size = rdbLoadLen(&rdb,NULL)) == REDIS_RDB_LENERR)
+                return REDIS_ERR;
+            if (db_size && dictSize(db->dict) == 0)
+                dictExpand(db->dict,db_size);
+            if (expires_size && dictSize(db->expires) == 0)
+                dictExpand(db->expires,expires_size);
+            continue;
+        }
+
+        // 只有字符串类型
+        if (!rdbIsObjectType(type)) {
+            redisLog(REDIS_WARNING,"Unknown RDB value type %d. Exiting.",type);
+            exit(1);
+        }
+
+        // 跳过键和值
+        if (rdbSkipStringObject(&rdb) == -1) return REDIS_ERR;
+        if (rdbSkipStringObject(&rdb) == -1) return REDIS_ERR;
+
+        // 块已满，开始一个新的块
+        c->end = rioTell(&rdb);
+        if (++c->numkeys == RDB_LOAD_CHUNK_KEYS)
+            c = rdbLoadAddChunk(job,c->end,dbid);
+    }
+}
+
+/*
+ * 解码块 c 中的所有键值对，保存到 c->entries 中
+ *
+ * Called by the loader threads and by the main thread. Only allocates and
+ * reads the mapped file, the keyspace is not touched.
+ */
+static void rdbLoadDecodeChunk(rdbLoadJob *job, rdbLoadChunk *c) {
+    int dbid = c->dbid;
+    rio rdb;
+
+    rioInitWithMemory(&rdb,job->map+c->start,c->end-c->start);
+    c->entries = zmalloc(sizeof(rdbLoadEntry)*(c->numkeys ? c->numkeys : 1));
+
+    while((size_t)rioTell(&rdb) < c->end-c->start) {
+        long long expiretime = -1;
+        int type;
+        sds key;
+        robj *val;
+
+        if ((type = rdbLoadType(&rdb)) == -1) goto err;
+
+        if (type == REDIS_RDB_OPCODE_EXPIRETIME) {
+            if ((expiretime = rdbLoadTime(&rdb)) == -1) goto err;
+            if ((type = rdbLoadType(&rdb)) == -1) goto err;
+            expiretime *= 1000;
+        } else if (type == REDIS_RDB_OPCODE_EXPIRETIME_MS) {
+            if ((expiretime = rdbLoadMillisecondTime(&rdb)) == -1) goto err;
+            if ((type = rdbLoadType(&rdb)) == -1) goto err;
+        }
+
+        // 已经由扫描检查过的标识
+        if (type == REDIS_RDB_OPCODE_SELECTDB) {
+            dbid = rdbLoadLen(&rdb,NULL);
+            continue;
+        } else if (type == REDIS_RDB_OPCODE_RESIZEDB) {
+            rdbLoadLen(&rdb,NULL);
+            rdbLoadLen(&rdb,NULL);
+            continue;
+        }
+
+        // 读入键和值
+        if ((key = rdbGenericLoadStringObject(&rdb,RDB_LOAD_SDS)) == NULL)
+            goto err;
+        if ((val = rdbLoadObject(type,&rdb)) == NULL) {
+            sdsfree(key);
+            goto err;
+        }
+
+        // 如果键已经过期，那么不载入
+        if (expiretime != -1 && expiretime < job->now) {
+            sdsfree(key);
+            decrRefCount(val);
+            continue;
+        }
+
+        c->entries[c->numentries].key = key;
+        c->entries[c->numentries].val = val;
+        c->entries[c->numentries].expire = expiretime;
+        c->entries[c->numentries].dbid = dbid;
+        c->numentries++;
+    }
+    return;
+
+err:
+    c->error = 1;
+}
+
+/* Decode the next chunk nobody took yet. Returns 0 if there are no chunks
+ * left to decode.
+ *
+ * 解码下一个还没有线程处理的块，没有剩余的块时返回 0 。
+ */
+static int rdbLoadDecodeNext(rdbLoadJob *job) {
+    int idx = __atomic_fetch_add(&job->next,1,__ATOMIC_RELAXED);
+    rdbLoadChunk *c;
+
+    if (idx >= job->numchunks) return 0;
+    c = job->chunks+idx;
+    rdbLoadDecodeChunk(job,c);
+
+    pthread_mutex_lock(&job->lock);
+    c->done = 1;
+    pthread_cond_broadcast(&job->cond);
+    pthread_mutex_unlock(&job->lock);
+    return 1;
+}
+
+static void *rdbLoadThreadMain(void *arg) {
+    rdbLoadJob *job = arg;
+
+    while(rdbLoadDecodeNext(job));
+    return NULL;
+}
+
+static void *rdbLoadChecksumThreadMain(void *arg) {
+    rdbLoadJob *job = arg;
+
+    job->cksum = crc64(0,(const unsigned char*)job->map,job->size-8);
+    return NULL;
+}
+
+/* Wait for the chunk 'c' to be decoded. Instead of sleeping the main thread
+ * decodes the chunks nobody took yet.
+ *
+ * 等待块 c 解码完成，等待期间主线程也参与解码。 */
+static void rdbLoadWaitChunk(rdbLoadJob *job, rdbLoadChunk *c) {
+    int done;
+
+    while(1) {
+        pthread_mutex_lock(&job->lock);
+        done = c->done;
+        pthread_mutex_unlock(&job->lock);
+        if (done) return;
+        if (!rdbLoadDecodeNext(job)) break;
+    }
+
+    pthread_mutex_lock(&job->lock);
+    while(!c->done) pthread_cond_wait(&job->cond,&job->lock);
+    pthread_mutex_unlock(&job->lock);
+}
+
+/*
+ * 将块 c 中解码后的键值对添加到数据库中，返回添加的键数量
+ */
+static long long rdbLoadInsertChunk(rdbLoadChunk *c) {
+    int j;
+
+    for (j = 0; j < c->numentries; j++) {
+        rdbLoadEntry *e = c->entries+j;
+        redisDb *db = server.db+e->dbid;
+        dictEntry *de;
+
+        // 将键值对关联到数据库中
+        if ((de = dictAddRaw(db->dict,e->key)) == NULL) {
+            redisLog(REDIS_WARNING,"Duplicated key '%s' in RDB file. Exiting.",
+                e->key);
+            exit(1);
+        }
+        dictSetVal(db->dict,de,e->val);
+
+        // 集群模式下，将键添加到它所在槽的索引中
+        if (server.cluster_enabled && e->dbid == 0) slotToKeyAdd(e->key);
+
+        // 设置过期时间，过期字典和键空间共用键的 sds
+        if (e->expire != -1) {
+            de = dictAddRaw(db->expires,e->key);
+            dictSetSignedIntegerVal(de,e->expire);
+        }
+    }
+    zfree(c->entries);
+    c->entries = NULL;
+    return c->numentries;
+}
+
+/*
+ * 将给定 rdb 中保存的数据载入到数据库中。
+ *
+ * Returns REDIS_ERR with errno set if the file can't be opened or is not
+ * an RDB file. A file that is truncated or corrupted in the middle is an
+ * unrecoverable error: the server exits.
+ *
+ * 文件无法打开或者不是 RDB 文件时返回 REDIS_ERR 并设置 errno ，
+ * 文件被截断或者损坏时，服务器直接退出。
+ */
+int rdbLoad(char *filename) {
+    int fd, j, rdbver, nthreads = 0, cksum_thread_started = 0;
+    pthread_t threads[REDIS_RDB_LOAD_THREADS_MAX], cksum_thread;
+    long long start = ustime(), keys = 0;
+    rdbLoadJob job;
+    struct stat sb;
+    size_t eofpos;
+    char buf[5];
+    char *map;
+
+    // 打开并映射 rdb 文件
+    if ((fd = open(filename,O_RDONLY)) == -1) return REDIS_ERR;
+    if (fstat(fd,&sb) == -1) {
+        close(fd);
+        return REDIS_ERR;
+    }
+    if (sb.st_size < 9) {
+        close(fd);
+        goto eoferr;
+    }
+    map = mmap(NULL,sb.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+    close(fd);
+    if (map == MAP_FAILED) return REDIS_ERR;
+
+    // 所有线程会一起读取整个文件，提前让内核开始预读
+    madvise(map,sb.st_size,MADV_WILLNEED);
+
+    // 检查版本号
+    if (memcmp(map,"REDIS",5) != 0) {
+        munmap(map,sb.st_size);
+        redisLog(REDIS_WARNING,"Wrong signature trying to load DB from file");
+        errno = EINVAL;
+        return REDIS_ERR;
+    }
+    memcpy(buf,map+5,4);
+    buf[4] = '\0';
+    rdbver = atoi(buf);
+    if (rdbver < 1 || rdbver > REDIS_RDB_VERSION) {
+        munmap(map,sb.st_size);
+        redisLog(REDIS_WARNING,"Can't handle RDB format version %d",rdbver);
+        errno = EINVAL;
+        return REDIS_ERR;
+    }
+
+    // 将服务器状态调整到开始载入状态
+    server.loading = 1;
+
+    memset(&job,0,sizeof(job));
+    job.map = map;
+    job.size = sb.st_size;
+    job.now = mstime();
+    pthread_mutex_init(&job.lock,NULL);
+    pthread_cond_init(&job.cond,NULL);
+
+    /* The checksum covers everything but the 8 bytes trailer: compute it
+     * while the file is scanned and decoded. */
+    // 在扫描和解码的同时计算校验和
+    if (rdbver >= 5 && server.rdb_checksum && job.size >= 9+1+8 &&
+        pthread_create(&cksum_thread,NULL,rdbLoadChecksumThreadMain,&job) == 0)
+    {
+        cksum_thread_started = 1;
+    }
+
+    // 切分文件
+    if (rdbLoadScan(&job,&eofpos) == REDIS_ERR) goto eoferr;
+
+    // 启动载入线程，只有一个块时由主线程自己解码
+    // 主线程也参与解码，所以线程数量不超过 CPU 数量减一
+    if (job.numchunks > 1) {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+
+        nthreads = server.rdb_load_threads;
+        if (ncpu > 0 && nthreads > ncpu-1) nthreads = ncpu-1;
+        if (nthreads > job.numchunks-1) nthreads = job.numchunks-1;
+    }
+    for (j = 0; j < nthreads; j++) {
+        if (pthread_create(&threads[j],NULL,rdbLoadThreadMain,&job) != 0) {
+            redisLog(REDIS_WARNING,
+                "Can't create RDB loader thread, loading with %d threads", j);
+            nthreads = j;
+            break;
+        }
+    }
+
+    // 按照文件中的顺序，将各个块的键值对添加到数据库
+    for (j = 0; j < job.numchunks; j++) {
+        rdbLoadChunk *c = job.chunks+j;
+
+        rdbLoadWaitChunk(&job,c);
+        if (c->error) goto eoferr;
+        keys += rdbLoadInsertChunk(c);
+    }
+    for (j = 0; j < nthreads; j++) pthread_join(threads[j],NULL);
+
+    /* Verify the checksum if RDB version is >= 5 */
+    // 如果 RDB 版本 >= 5 ，那么比对校验和
+    if (rdbver >= 5 && server.rdb_checksum) {
+        uint64_t cksum, expected;
+
+        // 读入文件的校验和
+        if (eofpos+1+8 > job.size) goto eoferr;
+        memcpy(&cksum,map+eofpos+1,8);
+        cksum = rdbLittleEndian64(cksum);
+
+        // 校验和线程计算的是最后 8 个字节之前的所有内容，
+        // 文件在校验和之后还有内容时需要重新计算
+        if (cksum_thread_started) pthread_join(cksum_thread,NULL);
+        if (cksum_thread_started && eofpos+1+8 == job.size)
+            expected = job.cksum;
+        else
+            expected = crc64(0,(const unsigned char*)map,eofpos+1);
+
+        // 比对校验和
+        if (cksum == 0) {
+            redisLog(REDIS_WARNING,"RDB file was saved with checksum disabled: no check performed.");
+        } else if (cksum != expected) {
+            redisLog(REDIS_WARNING,"Wrong RDB checksum. Aborting now.");
+            exit(1);
+        }
+    } else if (cksum_thread_started) {
+        pthread_join(cksum_thread,NULL);
+    }
+
+    zfree(job.chunks);
+    pthread_mutex_destroy(&job.lock);
+    pthread_cond_destroy(&job.cond);
+    munmap(map,sb.st_size);
+
+    // 服务器从载入状态中退出
+    server.loading = 0;
+
+    // 记录载入的速度
+    server.stat_rdb_load_keys = keys;
+    server.stat_rdb_load_bytes = sb.st_size;
+    server.stat_rdb_load_usec = ustime()-start;
+    server.stat_rdb_load_threads = nthreads+1;
+
+    return REDIS_OK;
+
+eoferr: /* unexpected end of file is handled here with a fatal exit */
+    redisLog(REDIS_WARNING,"Short read or OOM loading DB. Unrecoverable error, aborting now.");
+    exit(1);
+    return REDIS_ERR; /* Just to avoid warning */
+}
+
+/* -----------------------------------------------------------------------------
+ * Loading an RDB stream received from a socket
+ *
+ * A slave doing a full resync parses the payload while it is still being
+ * received, instead of saving it to disk and loading it back. The bytes are
+ * buffered until a whole record arrived, then decoded into a new set of
+ * hash tables that clients can't see: the slave keeps serving the old
+ * dataset until rdbStreamLoaderSwap() installs the new one in one step.
+ *
+ * 从套接字载入 RDB 流
+ *
+ * 全量同步时，从服务器一边接收一边解析 RDB ，不再先写入磁盘再载入。
+ * 收到的数据被缓存起来，直到一条完整的记录到达才解码，
+ * 键值对被添加到客户端看不到的新字典中。
+ * 载入期间从服务器继续使用旧的数据集服务，最后由 rdbStreamLoaderSwap() 一次换入。
+ * -------------------------------------------------------------------------- */
+
+struct rdbStreamLoader {
+    sds buf;                /* Received bytes not parsed yet. */
+    size_t trailer;         /* Bytes at the end of the stream that are not
+                               part of the RDB, like the EOF mark. */
+    int rdbver;             /* 0 until the header is parsed. */
+    int dbid;               /* DB selected by the last SELECTDB. */
+    int eof;                /* Set once the EOF opcode is parsed. */
+    dict **keys;            /* The new keyspace, one dict per DB. */
+    dict **expires;
+    uint64_t cksum;         /* Checksum of the bytes parsed so far. */
+    long long now;          /* Keys that expired before 'now' are skipped. */
+    long long numkeys;      /* Keys added to the new keyspace. */
+    long long bytes;        /* Bytes received. */
+    long long start;        /* ustime() of the creation. */
+};
+
+/* Parse the record at 'p', where 'len' bytes are available. Returns the
+ * size of the record if it was complete, 0 if more bytes are needed, or -1
+ * if the stream is corrupted.
+ *
+ * 解析 p 处的一条记录，p 之后有 len 字节可用。
+ *
+ * 记录完整时返回记录的长度，需要更多数据时返回 0 ，数据损坏时返回 -1 。 */
+static ssize_t rdbStreamParseRecord(rdbStreamLoader *l, const char *p,
+                                    size_t len)
+{
+    long long expiretime = -1;
+    size_t kvstart, end;
+    dictEntry *de;
+    int type;
+    sds key;
+    robj *val;
+    rio rdb;
+
+    rioInitWithMemory(&rdb,p,len);
+    if ((type = rdbLoadType(&rdb)) == -1) return 0;
+
+    // 过期时间，之后跟着一个键值对
+    if (type == REDIS_RDB_OPCODE_EXPIRETIME) {
+        if ((expiretime = rdbLoadTime(&rdb)) == -1) return 0;
+        if ((type = rdbLoadType(&rdb)) == -1) return 0;
+        expiretime *= 1000;
+    } else if (type == REDIS_RDB_OPCODE_EXPIRETIME_MS) {
+        if ((expiretime = rdbLoadMillisecondTime(&rdb)) == -1) return 0;
+        if ((type = rdbLoadType(&rdb)) == -1) return 0;
+    }
+
+    // 流的结束，之后只有校验和
+    if (type == REDIS_RDB_OPCODE_EOF) {
+        if (expiretime != -1) return -1;
+        l->eof = 1;
+        return rioTell(&rdb);
+    }
+
+    // 切换数据库
+    if (type == REDIS_RDB_OPCODE_SELECTDB) {
+        uint32_t id = rdbLoadLen(&rdb,NULL);
+
+        if (id == REDIS_RDB_LENERR) return 0;
+        if (id >= (unsigned)server.dbnum) {
+            redisLog(REDIS_WARNING,"The RDB stream selects DB %u, but this server handles only %d databases", id, server.dbnum);
+            return -1;
+        }
+        l->dbid = id;
+        return rioTell(&rdb);
+    }
+
+    // 数据库大小的提示，预先分配新键空间的哈希表
+    if (type == REDIS_RDB_OPCODE_RESIZEDB) {
+        uint32_t db_size, expires_size;
+
+        if ((db_size = rdbLoadLen(&rdb,NULL)) == REDIS_RDB_LENERR) return 0;
+        if ((expires_size = rdbLoadLen(&rdb,NULL)) == REDIS_RDB_LENERR)
+            return 0;
+        if (db_size && dictSize(l->keys[l->dbid]) == 0)
+            dictExpand(l->keys[l->dbid],db_size);
+        if (expires_size && dictSize(l->expires[l->dbid]) == 0)
+            dictExpand(l->expires[l->dbid],expires_size);
+        return rioTell(&rdb);
+    }
+
+    if (!rdbIsObjectType(type)) {
+        redisLog(REDIS_WARNING,"Unknown RDB value type %d in the stream",type);
+        return -1;
+    }
+
+    /* Make sure the whole key value pair arrived before decoding it, so
+     * that a big value is not allocated again at every read. */
+    // 先确认整个键值对都已经收到，再进行解码，
+    // 避免每次读入数据都为还没收完的大字符串分配一次内存
+    kvstart = rioTell(&rdb);
+    if (rdbSkipStringObject(&rdb) == -1) return 0;
+    if (rdbSkipStringObject(&rdb) == -1) return 0;
+    end = rioTell(&rdb);
+
+    // 读入键和值
+    rioInitWithMemory(&rdb,p+kvstart,end-kvstart);
+    if ((key = rdbGenericLoadStringObject(&rdb,RDB_LOAD_SDS)) == NULL)
+        return -1;
+    if ((val = rdbLoadObject(type,&rdb)) == NULL) {
+        sdsfree(key);
+        return -1;
+    }
+
+    // 如果键已经过期，那么不载入
+    if (expiretime != -1 && expiretime < l->now) {
+        sdsfree(key);
+        decrRefCount(val);
+        return end;
+    }
+
+    // 将键值对添加到新的键空间中
+    if ((de = dictAddRaw(l->keys[l->dbid],key)) == NULL) {
+        redisLog(REDIS_WARNING,"Duplicated key '%s' in the RDB stream",key);
+        sdsfree(key);
+        decrRefCount(val);
+        return -1;
+    }
+    dictSetVal(l->keys[l->dbid],de,val);
+    if (expiretime != -1) {
+        de = dictAddRaw(l->expires[l->dbid],key);
+        dictSetSignedIntegerVal(de,expiretime);
+    }
+    l->numkeys++;
+    return end;
+}
+
+/* Parse all the complete records in the buffer, but the last 'hold' bytes,
+ * then drop the parsed bytes. Returns REDIS_ERR if the stream is corrupted.
+ *
+ * 解析缓冲区中所有完整的记录，最后 hold 个字节不解析，
+ * 之后从缓冲区中删除已经解析的内容。数据损坏时返回 REDIS_ERR 。 */
+static int rdbStreamLoaderParse(rdbStreamLoader *l, size_t hold) {
+    size_t len = sdslen(l->buf), pos = 0;
+
+    if (len <= hold) return REDIS_OK;
+    len -= hold;
+
+    // 检查文件头和版本号
+    if (l->rdbver == 0) {
+        char buf[5];
+
+        if (len < 9) return REDIS_OK;
+        if (memcmp(l->buf,"REDIS",5) != 0) {
+            redisLog(REDIS_WARNING,"Wrong signature in the RDB stream");
+            return REDIS_ERR;
+        }
+        memcpy(buf,l->buf+5,4);
+        buf[4] = '\0';
+        l->rdbver = atoi(buf);
+        if (l->rdbver < 1 || l->rdbver > REDIS_RDB_VERSION) {
+            redisLog(REDIS_WARNING,"Can't handle RDB format version %d",
+                l->rdbver);
+            return REDIS_ERR;
+        }
+        pos = 9;
+    }
+
+    // 解析到 EOF 标识为止，之后的校验和由 rdbStreamLoaderFinish() 检查
+    while(!l->eof && pos < len) {
+        ssize_t n = rdbStreamParseRecord(l,l->buf+pos,len-pos);
+
+        if (n == -1) return REDIS_ERR;
+        if (n == 0) break;
+        pos += n;
+    }
+
+    // 校验和包括 EOF 标识在内的所有内容
+    l->cksum = crc64(l->cksum,(unsigned char*)l->buf,pos);
+    sdsrange(l->buf,pos,-1);
+    return REDIS_OK;
+}
+
+/* Create a loader for a stream whose last 'trailer' bytes are not part of
+ * the RDB payload.
+ *
+ * 创建一个载入器，流的最后 trailer 个字节不属于 RDB 。 */
+rdbStreamLoader *rdbStreamLoaderCreate(size_t trailer) {
+    rdbStreamLoader *l = zmalloc(sizeof(*l));
+    int j;
+
+    memset(l,0,sizeof(*l));
+    l->buf = sdsempty();
+    l->trailer = trailer;
+    l->keys = zmalloc(sizeof(dict*)*server.dbnum);
+    l->expires = zmalloc(sizeof(dict*)*server.dbnum);
+    for (j = 0; j < server.dbnum; j++) {
+        l->keys[j] = dictCreate(&dbDictType,NULL);
+        l->expires[j] = dictCreate(&keyptrDictType,NULL);
+    }
+    l->now = mstime();
+    l->start = ustime();
+    return l;
+}
+
+/* Feed 'len' bytes received from the socket to the loader. Returns
+ * REDIS_ERR if the stream is corrupted.
+ *
+ * 将从套接字读入的数据交给载入器，数据损坏时返回 REDIS_ERR 。 */
+int rdbStreamLoaderFeed(rdbStreamLoader *l, const char *buf, size_t len) {
+    l->buf = sdscatlen(l->buf,buf,len);
+    l->bytes += len;
+    return rdbStreamLoaderParse(l,l->trailer);
+}
+
+/* Called once the whole stream was received: parse what is left and verify
+ * the checksum. Returns REDIS_ERR if the stream is truncated or corrupted.
+ *
+ * 整个流接收完毕之后调用，解析剩下的数据并检查校验和。
+ * 流被截断或者损坏时返回 REDIS_ERR 。 */
+int rdbStreamLoaderFinish(rdbStreamLoader *l) {
+    size_t left;
+
+    if (rdbStreamLoaderParse(l,l->trailer) == REDIS_ERR) return REDIS_ERR;
+    if (!l->eof || sdslen(l->buf) < l->trailer) goto eoferr;
+    left = sdslen(l->buf)-l->trailer;
+
+    /* Verify the checksum if RDB version is >= 5 */
+    // 如果 RDB 版本 >= 5 ，那么比对校验和
+    if (l->rdbver >= 5) {
+        uint64_t cksum;
+
+        if (left != 8) goto eoferr;
+        memcpy(&cksum,l->buf,8);
+        cksum = rdbLittleEndian64(cksum);
+        if (server.rdb_checksum && cksum == 0) {
+            redisLog(REDIS_WARNING,"RDB stream was saved with checksum disabled: no check performed.");
+        } else if (server.rdb_checksum && cksum != l->cksum) {
+            redisLog(REDIS_WARNING,"Wrong RDB checksum in the stream.");
+            return REDIS_ERR;
+        }
+    } else if (left != 0) {
+        goto eoferr;
+    }
+
+    // 记录载入的速度
+    server.stat_rdb_load_keys = l->numkeys;
+    server.stat_rdb_load_bytes = l->bytes-l->trailer;
+    server.stat_rdb_load_usec = ustime()-l->start;
+    server.stat_rdb_load_threads = 1;
+    return REDIS_OK;
+
+eoferr:
+    redisLog(REDIS_WARNING,"Short read loading the RDB stream");
+    return REDIS_ERR;
+}
+
+/* Install the loaded keyspace in place of the current one. The old keys are
+ * released by the lazyfree thread, so the swap does not block the server
+ * whatever the size of the old dataset.
+ *
+ * 用载入的键空间替换当前的键空间，旧的键由后台线程释放。 */
+void rdbStreamLoaderSwap(rdbStreamLoader *l) {
+    int j;
+
+    // 通知开启追踪的客户端清空它们的缓存，所有数据库只通知一次
+    trackingInvalidateKeysOnFlush();
+    for (j = 0; j < server.dbnum; j++) {
+        replaceDbAsync(server.db+j,l->keys[j],l->expires[j]);
+        l->keys[j] = NULL;
+        l->expires[j] = NULL;
+    }
+}
+
+/*
+ * 释放载入器，以及还没有换入的键空间
+ */
+void rdbStreamLoaderFree(rdbStreamLoader *l) {
+    int j;
+
+    for (j = 0; j < server.dbnum; j++) {
+        if (l->keys[j]) dictRelease(l->keys[j]);
+        if (l->expires[j]) dictRelease(l->expires[j]);
+    }
+    zfree(l->keys);
+    zfree(l->expires);
+    sdsfree(l->buf);
+    zfree(l);
+}
+
+/* A background saving child (BGSAVE) terminated its work. Handle this.
+ * This function covers the case of actual BGSAVEs.
+ *
+ * 处理写入磁盘的 BGSAVE 完成时发送的信号
+ */
+static void backgroundSaveDoneHandlerDisk(int exitcode, int bysignal) {
+
+    // BGSAVE 成功
+    if (!bysignal && exitcode == 0) {
+        redisLog(REDIS_NOTICE,
+            "Background saving terminated with success");
+        server.dirty = server.dirty - server.dirty_before_bgsave;
+        server.lastsave = time(NULL);
+        server.lastbgsave_status = REDIS_OK;
+
+    // BGSAVE 出错
+    } else if (!bysignal && exitcode != 0) {
+        redisLog(REDIS_WARNING, "Background saving error");
+        server.lastbgsave_status = REDIS_ERR;
+
+    // BGSAVE 被中断
+    } else {
+        redisLog(REDIS_WARNING,
+            "Background saving terminated by signal %d", bysignal);
+        // 移除临时文件
+        rdbRemoveTempFile(server.rdb_child_pid);
+        /* SIGUSR1 is whitelisted, so we have a way to kill a child without
+         * tirggering an error conditon. */
+        if (bysignal != SIGUSR1)
+            server.lastbgsave_status = REDIS_ERR;
+    }
+}
+
+/* A background saving child streaming the RDB to the slaves sockets
+ * terminated. Nothing was written to disk, so lastsave and the dirty
+ * counter are left untouched.
+ *
+ * 处理直接写入从服务器套接字的 BGSAVE 完成时发送的信号，
+ * 这种 BGSAVE 不产生 RDB 文件，所以不更新 lastsave 和 dirty 。 */
+static void backgroundSaveDoneHandlerSocket(int exitcode, int bysignal) {
+    if (!bysignal && exitcode == 0) {
+        redisLog(REDIS_NOTICE,
+            "Background RDB transfer terminated with success");
+    } else if (!bysignal && exitcode != 0) {
+        redisLog(REDIS_WARNING, "Background transfer error");
+    } else {
+        redisLog(REDIS_WARNING,
+            "Background transfer terminated by signal %d", bysignal);
+    }
+}
+
+/* When a background RDB saving/transfer terminates, call the right handler.
+ *
+ * 根据子进程的类型调用对应的处理函数，然后通知等待中的从服务器 */
+void backgroundSaveDoneHandler(int exitcode, int bysignal) {
+    int type = server.rdb_child_type;
+
+    if (type == REDIS_RDB_CHILD_TYPE_SOCKET)
+        backgroundSaveDoneHandlerSocket(exitcode,bysignal);
+    else
+        backgroundSaveDoneHandlerDisk(exitcode,bysignal);
+
+    // 更新服务器状态
+    server.rdb_child_pid = -1;
+    server.rdb_child_type = REDIS_RDB_CHILD_TYPE_NONE;
+    server.rdb_save_time_last = time(NULL)-server.rdb_save_time_start;
+    server.rdb_save_time_start = -1;
+
+    /* Possibly there are slaves waiting for a BGSAVE in order to be served
+     * (the first stage of SYNC is a bulk transfer of dump.rdb) */
+    updateSlavesWaitingBgsave((!bysignal && exitcode == 0) ? REDIS_OK : REDIS_ERR,
+                              type);
+}
+
+/*
+ * SAVE
+ */
+void saveCommand(redisClient *c) {
+
+    // BGSAVE 已经在执行中，不能再执行 SAVE
+    // 否则将产生竞争条件
+    if (server.rdb_child_pid != -1) {
+        addReplyError(c,"Background save already in progress");
+        return;
+    }
+
+    // 执行
+    if (rdbSave(server.rdb_filename) == REDIS_OK) {
+        addReply(c,shared.ok);
+    } else {
+        addReply(c,shared.err);
+    }
+}
+
+/*
+ * BGSAVE
+ */
+void bgsaveCommand(redisClient *c) {
+
+    // 不能重复执行 BGSAVE
+    if (server.rdb_child_pid != -1) {
+        addReplyError(c,"Background save already in progress");
+
+    // 不能在 BGREWRITEAOF 正在运行时执行
+    } else if (server.aof_child_pid != -1) {
+        addReplyError(c,"Can't BGSAVE while AOF log rewriting is in progress");
+
+    // 执行 BGSAVE
+    } else if (rdbSaveBackground(server.rdb_filename) == REDIS_OK) {
+        addReplyStatus(c,"Background saving started");
+
+    } else {
+        addReply(c,shared.err);
+    }
+}
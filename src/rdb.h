@@ -0,0 +1,128 @@
+#ifndef __REDIS_RDB_H
+#define __REDIS_RDB_H
+
+#include <stdio.h>
+#include "rio.h"
+
+/* TBD: include only necessary headers. */
+#include "redis.h"
+
+/* The current RDB version. When the format changes in a way that is no longer
+ * backward compatible this number gets incremented.
+ *
+ * RDB 的版本，当新版本不向旧版本兼容时增一
+ */
+#define REDIS_RDB_VERSION 7
+
+/* The checksum trailer, of RDB files and of DUMP payloads, is always stored
+ * little endian. */
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define rdbLittleEndian64(v) __builtin_bswap64(v)
+#else
+#define rdbLittleEndian64(v) (v)
+#endif
+
+/* Defines related to the dump file format. To store 32 bits lengths for short
+ * keys requires a lot of space, so we check the most significant 2 bits of
+ * the first byte to interpreter the length:
+ *
+ * 通过读取第一字节的最高 2 位来判断长度
+ *
+ * 00|000000 => if the two MSB are 00 the len is the 6 bits of this byte
+ *              长度编码在这一字节的其余 6 位中
+ *
+ * 01|000000 00000000 =>  01, the len is 14 byes, 6 bits + 8 bits of next byte
+ *                        长度为 14 位，当前字节 6 位，加上下个字节 8 位
+ *
+ * 10|000000 [32 bit integer] => if it's 01, a full 32 bit len will follow
+ *                               长度由随后的 32 位保存
+ *
+ * 11|000000 this means: specially encoded object will follow. The six bits
+ *           number specify the kind of object that follows.
+ *           See the REDIS_RDB_ENC_* defines.
+ *           后跟一个特殊编码的对象。字节中的 6 位指定对象的类型。
+ *           查看 REDIS_RDB_ENC_* 定义获得更多消息
+ *
+ * Lengths up to 63 are stored using a single byte, most DB keys, and may
+ * values, will fit inside.
+ *
+ * 一个字节（的其中 6 个字节）可以保存的最大长度是 63 （包括在内），
+ * 对于大多数键和值来说，都已经足够了。
+ */
+#define REDIS_RDB_6BITLEN 0
+#define REDIS_RDB_14BITLEN 1
+#define REDIS_RDB_32BITLEN 2
+#define REDIS_RDB_ENCVAL 3
+// 表示读取/写入错误
+#define REDIS_RDB_LENERR UINT_MAX
+
+/* When a length of a string object stored on disk has the first two bits
+ * set, the remaining two bits specify a special encoding for the object
+ * accordingly to the following defines:
+ *
+ * 当对象是一个字符串对象时，
+ * 最高两个位之后的两个位（第 3 个位和第 4 个位）指定了对象的特殊编码
+ */
+#define REDIS_RDB_ENC_INT8 0        /* 8 bit signed integer */
+#define REDIS_RDB_ENC_INT16 1       /* 16 bit signed integer */
+#define REDIS_RDB_ENC_INT32 2       /* 32 bit signed integer */
+#define REDIS_RDB_ENC_LZF 3         /* string compressed with FASTLZ */
+
+/* Dup object types to RDB object types. Only reason is readability (are we
+ * dealing with RDB types or with in-memory object types?).
+ *
+ * 对象类型在 RDB 文件中的类型
+ */
+#define REDIS_RDB_TYPE_STRING 0
+
+/* Test if a type is an object type. */
+// 检查给定类型是否对象
+#define rdbIsObjectType(t) ((t) == REDIS_RDB_TYPE_STRING)
+
+/* Special RDB opcodes (saved/loaded with rdbSaveType/rdbLoadType). */
+// 数据库特殊操作标识符
+#define REDIS_RDB_OPCODE_RESIZEDB 251
+#define REDIS_RDB_OPCODE_EXPIRETIME_MS 252
+#define REDIS_RDB_OPCODE_EXPIRETIME 253
+#define REDIS_RDB_OPCODE_SELECTDB 254
+#define REDIS_RDB_OPCODE_EOF 255
+
+/* rdbGenericLoadStringObject() flags. */
+#define RDB_LOAD_NONE   0
+#define RDB_LOAD_ENC    (1<<0)  /* 返回 INT/EMBSTR 编码的对象 */
+#define RDB_LOAD_SDS    (1<<1)  /* 返回 sds 而不是对象 */
+
+int rdbSaveType(rio *rdb, unsigned char type);
+int rdbLoadType(rio *rdb);
+int rdbSaveTime(rio *rdb, time_t t);
+time_t rdbLoadTime(rio *rdb);
+int rdbSaveMillisecondTime(rio *rdb, long long t);
+long long rdbLoadMillisecondTime(rio *rdb);
+int rdbSaveLen(rio *rdb, uint32_t len);
+uint32_t rdbLoadLen(rio *rdb, int *isencoded);
+int rdbSaveObjectType(rio *rdb, robj *o);
+int rdbLoadObjectType(rio *rdb);
+int rdbLoad(char *filename);
+int rdbSaveRio(rio *rdb, int *error);
+int rdbSaveBackground(char *filename);
+int rdbSaveRioWithEOFMark(rio *rdb, int *error);
+int rdbSaveToSlavesSockets(void);
+void rdbRemoveTempFile(pid_t childpid);
+void rdbFsyncFileDir(const char *filename);
+int rdbSave(char *filename);
+int rdbSaveObject(rio *rdb, robj *o);
+robj *rdbLoadObject(int type, rio *rdb);
+void backgroundSaveDoneHandler(int exitcode, int bysignal);
+int rdbSaveKeyValuePair(rio *rdb, robj *key, robj *val, long long expiretime, long long now);
+robj *rdbLoadStringObject(rio *rdb);
+void *rdbGenericLoadStringObject(rio *rdb, int flags);
+typedef struct rdbStreamLoader rdbStreamLoader;
+rdbStreamLoader *rdbStreamLoaderCreate(size_t trailer);
+int rdbStreamLoaderFeed(rdbStreamLoader *l, const char *buf, size_t len);
+int rdbStreamLoaderFinish(rdbStreamLoader *l);
+void rdbStreamLoaderSwap(rdbStreamLoader *l);
+void rdbStreamLoaderFree(rdbStreamLoader *l);
+void saveCommand(redisClient *c);
+void bgsaveCommand(redisClient *c);
+
+#endif
@@ -2,14 +2,21 @@
 #define __REDIS_H
 
 #include <stddef.h>
+#include <limits.h>
+#include <time.h>
+#include <signal.h>
+#include <errno.h>
 #include "dict.h"    /* Hash tables */
+#include "adlist.h"  /* Linked lists */
 #include "sds.h"     /* Dynamic safe strings */
+#include "radix.h"   /* Radix trees */
 #include "zmalloc.h"
 #include "unistd.h"
 #include "ae.h"
 #include "anet.h"
 #include <netinet/in.h>
 #include "util.h"
+#include "version.h"
 
 
 #define sdsEncodedObject(objptr) (objptr->encoding == REDIS_ENCODING_RAW || objptr->encoding == REDIS_ENCODING_EMBSTR)
@@ -21,11 +28,17 @@
 #define REDIS_NOTUSED(V) ((void) V)
 
 #define REDIS_SERVERPORT        6379    /* TCP port */
+#define REDIS_DEFAULT_HZ        10      /* Time interrupt calls/sec. */
+#define REDIS_MIN_HZ            1
+#define REDIS_MAX_HZ            500
 
 
 #define redisPanic(_e) _redisPanic(#_e,__FILE__,__LINE__),_exit(1)
 
-#define REDIS_SHARED_BULKHDR_LEN 32
+#define REDIS_SHARED_INTEGERS 10000
+#define REDIS_SHARED_BULKHDR_LEN 32      /* Default shared-bulkhdr-len */
+#define REDIS_SHARED_BULKHDR_MAX_LEN (1024*64)
+#define REDIS_SHARED_REFCOUNT INT_MAX
 
 /* Log levels */
 #define REDIS_DEBUG 0
@@ -35,6 +48,7 @@
 #define REDIS_LOG_RAW (1<<10) /* Modifier to log without timestamp */
 #define REDIS_DEFAULT_VERBOSITY REDIS_NOTICE
 
+#define REDIS_CONFIGLINE_MAX    1024
 #define REDIS_MAX_LOGMSG_LEN    1024 /* Default maximum length of syslog messages */
 
 #define redisAssert(_e) ((_e)?(void)0 : (_redisAssert(#_e,__FILE__,__LINE__),_exit(1)))
@@ -45,6 +59,149 @@
 #define REDIS_ERR               -1
 
 #define REDIS_DEFAULT_DBNUM     16
+#define REDIS_DBCRON_DBS_PER_CALL 16
+#define REDIS_HT_MINFILL        10      /* Minimal hash table fill 10% */
+
+/* Active expire cycle */
+#define ACTIVE_EXPIRE_CYCLE_LOOKUPS_PER_LOOP 20 /* Loopkups per loop. */
+#define ACTIVE_EXPIRE_CYCLE_SLOW_TIME_PERC 25 /* CPU max % for keys collection */
+
+/* Redis maxmemory strategies. Instead of using just incremental number
+ * for this defines, we use a set of flags so that testing for certain
+ * properties common to multiple policies is faster. */
+#define MAXMEMORY_FLAG_LRU (1<<0)
+#define MAXMEMORY_FLAG_LFU (1<<1)
+#define MAXMEMORY_FLAG_ALLKEYS (1<<2)
+#define MAXMEMORY_FLAG_NO_SHARED_INTEGERS \
+    (MAXMEMORY_FLAG_LRU|MAXMEMORY_FLAG_LFU)
+
+#define MAXMEMORY_VOLATILE_LRU ((0<<8)|MAXMEMORY_FLAG_LRU)
+#define MAXMEMORY_VOLATILE_LFU ((1<<8)|MAXMEMORY_FLAG_LFU)
+#define MAXMEMORY_VOLATILE_TTL (2<<8)
+#define MAXMEMORY_VOLATILE_RANDOM (3<<8)
+#define MAXMEMORY_ALLKEYS_LRU ((4<<8)|MAXMEMORY_FLAG_LRU|MAXMEMORY_FLAG_ALLKEYS)
+#define MAXMEMORY_ALLKEYS_LFU ((5<<8)|MAXMEMORY_FLAG_LFU|MAXMEMORY_FLAG_ALLKEYS)
+#define MAXMEMORY_ALLKEYS_RANDOM ((6<<8)|MAXMEMORY_FLAG_ALLKEYS)
+#define MAXMEMORY_NO_EVICTION (7<<8)
+
+#define REDIS_DEFAULT_MAXMEMORY 0
+#define REDIS_DEFAULT_MAXMEMORY_POLICY MAXMEMORY_NO_EVICTION
+#define REDIS_DEFAULT_MAXMEMORY_SAMPLES 5
+#define REDIS_DEFAULT_LFU_LOG_FACTOR 10
+#define REDIS_DEFAULT_LFU_DECAY_TIME 1
+#define REDIS_DEFAULT_TRACKING_TABLE_MAX_KEYS 1000000
+
+/* Lazy free */
+#define REDIS_DEFAULT_LAZYFREE_LAZY_EXPIRE 1
+#define REDIS_DEFAULT_LAZYFREE_LAZY_SERVER_DEL 1
+#define REDIS_DEFAULT_LAZYFREE_LAZY_USER_DEL 1
+
+/* RDB persistence */
+#define REDIS_DEFAULT_RDB_FILENAME "dump.rdb"
+#define REDIS_DEFAULT_RDB_CHECKSUM 1
+#define REDIS_DEFAULT_STOP_WRITES_ON_BGSAVE_ERROR 1
+#define REDIS_RDB_IOBUF_LEN (1024*64)       /* stdio buffer of the RDB file */
+#define REDIS_AUTOSYNC_BYTES (1024*1024*32) /* fdatasync every 32MB */
+#define REDIS_BGSAVE_RETRY_DELAY 5 /* Wait a few secs before trying again. */
+#define REDIS_DEFAULT_RDB_LOAD_THREADS 4
+#define REDIS_RDB_LOAD_THREADS_MAX 64
+
+/* AOF persistence */
+#define REDIS_AOF_OFF 0             /* AOF is off */
+#define REDIS_AOF_ON 1              /* AOF is on */
+#define REDIS_AOF_WAIT_REWRITE 2    /* AOF waits rewrite to start appending */
+
+/* Append only fsync policies */
+#define AOF_FSYNC_NO 0
+#define AOF_FSYNC_ALWAYS 1
+#define AOF_FSYNC_EVERYSEC 2
+#define REDIS_DEFAULT_AOF_FSYNC AOF_FSYNC_EVERYSEC
+#define REDIS_DEFAULT_AOF_FILENAME "appendonly.aof"
+#define REDIS_DEFAULT_AOF_LOAD_TRUNCATED 1
+#define REDIS_AOF_MAX_FLUSH_DELAY 2 /* Max secs a write waits for the fsync. */
+#define REDIS_AOF_REWRITE_PERC 100
+#define REDIS_AOF_REWRITE_MIN_SIZE (64*1024*1024)
+#define REDIS_AOF_MANIFEST_SUFFIX ".manifest"
+#define REDIS_AOF_BASE_SUFFIX ".base.aof"
+#define REDIS_AOF_INCR_SUFFIX ".incr.aof"
+#define REDIS_AOF_TEMP_PREFIX "temp-"
+
+/* Types of the files listed in the AOF manifest. */
+#define AOF_FILE_TYPE_BASE 'b'      /* Rewritten snapshot of the dataset */
+#define AOF_FILE_TYPE_HIST 'h'      /* Replaced by a rewrite, to be deleted */
+#define AOF_FILE_TYPE_INCR 'i'      /* Commands appended after the base */
+
+/* Replication */
+#define REDIS_RUN_ID_SIZE 40
+#define REDIS_EOF_MARK_SIZE 40
+#define REDIS_DEFAULT_REPL_BACKLOG_SIZE (1024*1024)    /* 1mb */
+#define REDIS_REPL_BACKLOG_MIN_SIZE (1024*16)          /* 16k */
+#define REDIS_REPL_TIMEOUT 60
+#define REDIS_REPL_PING_SLAVE_PERIOD 10
+#define REDIS_REPL_SYNCIO_TIMEOUT 5
+#define REDIS_DEFAULT_SLAVE_READ_ONLY 1
+
+/* How the slave loads the RDB received in a full resync. */
+#define REPL_DISKLESS_LOAD_DISABLED 0   /* Save to disk, then rdbLoad(). */
+#define REPL_DISKLESS_LOAD_SWAPDB 1     /* Parse from the socket into a new
+                                           keyspace, swapped in at the end. */
+#define REDIS_DEFAULT_REPL_DISKLESS_LOAD REPL_DISKLESS_LOAD_SWAPDB
+
+/* Slave replication state - from the point of view of the slave. */
+// 从服务器的复制状态
+#define REDIS_REPL_NONE 0 /* No active replication */
+#define REDIS_REPL_CONNECT 1 /* Must connect to master */
+#define REDIS_REPL_CONNECTING 2 /* Connecting to master */
+/* --- Handshake states, must be ordered --- */
+#define REDIS_REPL_RECEIVE_PONG 3 /* Wait for PING reply */
+#define REDIS_REPL_RECEIVE_PORT 4 /* Wait for REPLCONF reply */
+#define REDIS_REPL_SEND_PSYNC 5 /* Send PSYNC */
+#define REDIS_REPL_RECEIVE_PSYNC 6 /* Wait for PSYNC reply */
+/* --- End of handshake states --- */
+#define REDIS_REPL_TRANSFER 7 /* Receiving .rdb from master */
+#define REDIS_REPL_CONNECTED 8 /* Connected to master */
+
+/* Slave replication state - from the point of view of the master.
+ * In SYNC/PSYNC the master forks a child that streams the RDB straight
+ * to the slave sockets, then the slave is put online. */
+// 主服务器记录的从服务器的复制状态
+#define REDIS_REPL_WAIT_BGSAVE_START 9 /* We need to produce a new RDB file. */
+#define REDIS_REPL_WAIT_BGSAVE_END 10 /* Waiting RDB file creation to finish. */
+#define REDIS_REPL_ONLINE 11 /* RDB file transmitted, sending just updates. */
+
+/* Kind of the BGSAVE child */
+#define REDIS_RDB_CHILD_TYPE_NONE 0
+#define REDIS_RDB_CHILD_TYPE_DISK 1     /* RDB is written to disk. */
+#define REDIS_RDB_CHILD_TYPE_SOCKET 2   /* RDB is written to slave socket. */
+
+/* Client flags */
+#define REDIS_SLAVE (1<<0)   /* This client is a slave server */
+#define REDIS_MASTER (1<<1)  /* This client is a master server */
+#define REDIS_CLOSE_ASAP (1<<2) /* Close this client ASAP */
+#define REDIS_MASTER_FORCE_REPLY (1<<3) /* Queue replies even if is master */
+#define REDIS_ASKING (1<<4)     /* Client issued the ASKING command */
+#define REDIS_MULTI (1<<5)      /* This client is in a MULTI context */
+#define REDIS_DIRTY_CAS (1<<6)  /* Watched keys modified. EXEC will fail. */
+#define REDIS_DIRTY_EXEC (1<<7) /* EXEC will fail for errors while queueing */
+#define REDIS_FORCE_REPL (1<<8) /* Force replication of current cmd. */
+#define REDIS_TRACKING (1<<9)   /* Client enabled keys tracking in order to
+                                   perform client side caching. */
+#define REDIS_TRACKING_BCAST (1<<10) /* Tracking in BCAST mode. */
+
+/* SHUTDOWN flags */
+#define REDIS_SHUTDOWN_NOFLAGS 0    /* No flags. */
+#define REDIS_SHUTDOWN_SAVE 1       /* Force SAVE on SHUTDOWN even if no save
+                                       points are configured. */
+#define REDIS_SHUTDOWN_NOSAVE 2     /* Don't SAVE on SHUTDOWN. */
+
+/* Child info pipe */
+#define CHILD_INFO_MAGIC 0xC17DDA7A12345678LL
+#define CHILD_INFO_TYPE_RDB 0
+#define CHILD_INFO_TYPE_AOF 1
+
+/* Units */
+#define UNIT_SECONDS 0
+#define UNIT_MILLISECONDS 1
 
 /* Object types */
 // 对象类型
@@ -65,6 +222,11 @@
 #define REDIS_ENCODING_SKIPLIST 7  /* Encoded as skiplist */
 #define REDIS_ENCODING_EMBSTR 8  /* Embedded sds string encoding */
 
+/* Strings up to this length are created with the EMBSTR encoding: the robj,
+ * the sds header and the bytes share one allocation of 64 bytes
+ * (16 robj + 3 sdshdr8 + 44 + 1 nul term). */
+#define REDIS_ENCODING_EMBSTR_SIZE_LIMIT 44
+
 
 #define REDIS_IP_STR_LEN INET6_ADDRSTRLEN
 
@@ -82,6 +244,16 @@
 #define REDIS_REQ_MULTIBULK 2
 
 
+/* Command flags. Please check the command table defined in the commands.def
+ * file for more information about the meaning of every flag. */
+// 命令标志
+#define REDIS_CMD_WRITE 1                   /* "w" flag */
+#define REDIS_CMD_READONLY 2                /* "r" flag */
+#define REDIS_CMD_DENYOOM 4                 /* "m" flag */
+#define REDIS_CMD_FAST 8                    /* "F" flag */
+#define REDIS_CMD_MAY_REPLICATE 16          /* "P" flag */
+#define REDIS_CMD_ASKING 32                 /* "k" flag */
+
 /* Command call flags, see call() function */
 #define REDIS_CALL_NONE 0
 #define REDIS_CALL_SLOWLOG 1
@@ -89,16 +261,56 @@
 #define REDIS_CALL_PROPAGATE 4
 #define REDIS_CALL_FULL (REDIS_CALL_SLOWLOG | REDIS_CALL_STATS | REDIS_CALL_PROPAGATE)
 
+/* Command propagation flags, see propagate() function */
+#define REDIS_PROPAGATE_NONE 0
+#define REDIS_PROPAGATE_AOF 1
+#define REDIS_PROPAGATE_REPL 2
+
 #define REDIS_REPLY_CHUNK_BYTES (16*1024) /* 16k output buffer */
+#define REDIS_REPLY_SHARED_MIN_BYTES 512  /* Smaller shared replies are copied */
+#define REDIS_MAX_WRITE_PER_EVENT (1024*64)
+
+/* Instantaneous metrics tracking. */
+#define REDIS_METRIC_SAMPLES 16     /* Number of samples per metric. */
+#define REDIS_METRIC_COMMAND 0      /* Number of commands executed. */
+#define REDIS_METRIC_NET_INPUT 1    /* Bytes read to network .*/
+#define REDIS_METRIC_NET_OUTPUT 2   /* Bytes written to network. */
+#define REDIS_METRIC_COUNT 3
+
+/* Using the following macro you can run code inside serverCron() with the
+ * specified period, specified in milliseconds.
+ * The actual resolution depends on server.hz. */
+#define run_with_period(_ms_) if ((_ms_ <= 1000/server.hz) || !(server.cronloops%((_ms_)/(1000/server.hz))))
+
+/* Return the LRU clock, based on the clock resolution. If the current
+ * resolution is lower than the frequency we refresh the LRU clock (as it
+ * should be in production servers) we return the precomputed value,
+ * otherwise we need to resort to a function call. */
+// serverCron 的刷新频率足够时，直接使用缓存的 LRU 时钟
+#define LRU_CLOCK() ((1000/server.hz <= REDIS_LRU_CLOCK_RESOLUTION) ? server.lruclock : getLRUClock())
 
 typedef struct redisDb {
     // 数据库键空间，保存着数据库中的所有键值对
     dict *dict;                 /* The keyspace for this DB */
 
+    // 键的过期时间，字典的键为键，字典的值为过期事件 UNIX 时间戳
+    dict *expires;              /* Timeout of keys with a timeout set */
+
+    // 正在被 WATCH 命令监视的键，字典的值为监视这个键的客户端链表
+    dict *watched_keys;         /* WATCHED keys for MULTI/EXEC CAS */
+
     // 数据库号码
     int id;                     /* Database ID */
 } redisDb;
 
+/* The actual Redis Object */
+/*
+ * 对象最后一次被访问的时间，或者 LFU 的访问频率
+ */
+#define REDIS_LRU_BITS 24
+#define REDIS_LRU_CLOCK_MAX ((1<<REDIS_LRU_BITS)-1) /* Max value of obj->lru */
+#define REDIS_LRU_CLOCK_RESOLUTION 1000 /* LRU clock resolution in ms */
+
 /*
  * Redis 对象
  */
@@ -110,16 +322,79 @@ typedef struct redisObject {
     // 编码
     unsigned encoding:4;
 
-    // 指向实际值的指针
-    void *ptr;
+    // LRU 策略下：对象最后一次被访问的时间（REDIS_LRU_CLOCK_RESOLUTION 精度）
+    // LFU 策略下：高 16 位是最后一次衰减的时间（分钟），低 8 位是对数访问计数器
+    unsigned lru:REDIS_LRU_BITS; /* LRU time (relative to server.lruclock) or
+                                  * LFU data (least significant 8 bits frequency
+                                  * and most significant 16 bits decreas time). */
 
     // 引用计数
+    // 放在 ptr 之前，和 type/encoding/lru 共用前 8 个字节，robj 只占 16 字节
     int refcount;
 
+    // 指向实际值的指针
+    void *ptr;
+
 } robj;
 
 
+/*
+ * 服务器的保存条件（BGSAVE 自动执行的条件）
+ */
+struct saveparam {
+
+    // 多少秒之内
+    time_t seconds;
+
+    // 发生多少次修改
+    int changes;
+
+};
+
+/* Initialize a robj that lives on the stack, used when a temporary string
+ * object is needed for a sds that is not owned by an object. */
+#define initStaticStringObject(_var,_ptr) do { \
+    _var.refcount = 1; \
+    _var.type = REDIS_STRING; \
+    _var.encoding = REDIS_ENCODING_RAW; \
+    _var.ptr = _ptr; \
+} while(0)
+
+/* Client MULTI/EXEC state */
+
+/*
+ * 事务命令
+ */
+typedef struct multiCmd {
+
+    // 参数
+    robj **argv;
+
+    // 参数数量
+    int argc;
+
+    // 命令指针
+    struct redisCommand *cmd;
+
+} multiCmd;
+
+/*
+ * 事务状态
+ */
+typedef struct multiState {
+
+    // 事务队列，FIFO 顺序
+    multiCmd *commands;     /* Array of MULTI commands */
+
+    // 已入队命令计数
+    int count;              /* Total number of MULTI commands */
+
+} multiState;
+
 typedef struct redisClient {
+    // 客户端的唯一 ID ，从 1 开始递增
+    uint64_t id;            /* Client incremental unique ID. */
+
     // 当前正在使用的数据库
     redisDb *db;
 
@@ -151,12 +426,55 @@ typedef struct redisClient {
     // 回复偏移量
     int bufpos;
 
+    // 回复链表
+    list *reply;
+
+    // 回复链表中对象的总大小
+    unsigned long reply_bytes; /* Tot bytes of objects in reply list */
+
     // 回复缓冲区
     char buf[REDIS_REPLY_CHUNK_BYTES];
 
     // 已发送字节，处理 short write 用
     int sentlen;            /* Amount of bytes already sent in the current
                                buffer or object being sent. */
+
+    // 客户端的类型（REDIS_SLAVE 、 REDIS_MASTER 等）
+    int flags;              /* REDIS_SLAVE | REDIS_MASTER | ... */
+
+    // 客户端最后一次和服务器互动的时间
+    time_t lastinteraction; /* time of the last interaction, used for timeout */
+
+    /* Replication */
+
+    // 从服务器的复制状态
+    int replstate;          /* replication state if this is a slave */
+    // 全量同步之后，等待从服务器的第一个 ACK 再发送命令
+    int repl_put_online_on_ack; /* Install slave write handler on ACK. */
+    // 主服务器的复制偏移量
+    long long reploff;      /* replication offset if this is our master */
+    // 从服务器最后一次发送 REPLCONF ACK 时的偏移量和时间
+    long long repl_ack_off; /* replication ack offset, if this is a slave */
+    long long repl_ack_time;/* replication ack time, if this is a slave */
+    // 主服务器的运行 ID
+    char replrunid[REDIS_RUN_ID_SIZE+1]; /* master run id if this is a master */
+    // 从服务器的监听端口
+    int slave_listening_port; /* As configured with: REPLCONF listening-port */
+
+    // 事务状态
+    multiState mstate;      /* MULTI/EXEC state */
+
+    // 被监视的键
+    list *watched_keys;     /* Keys WATCHED for MULTI/EXEC CAS */
+
+    // 客户端订阅的频道和模式，字典的值不使用
+    dict *pubsub_channels;  /* channels a client is interested in (SUBSCRIBE) */
+    dict *pubsub_patterns;  /* patterns a client is interested in (PSUBSCRIBE) */
+
+    // 接收失效通知的客户端的 ID
+    uint64_t client_tracking_redirection;
+    // 广播模式下客户端追踪的键前缀，没有开启广播模式时为 NULL
+    dict *client_tracking_prefixes; /* Prefixes we are tracking in BCAST mode */
 } redisClient;
 
 typedef void redisCommandProc(redisClient *c);
@@ -174,9 +492,60 @@ struct redisCommand {
 
     // 参数个数
     int arity;
+
+    // 字符串表示的 FLAG
+    char *sflags; /* Flags as string representation, one char per flag. */
+
+    // 实际 FLAG
+    int flags;    /* The actual flags, obtained from the 'sflags' field. */
+
+    /* What keys should be loaded in background when calling this command? */
+    // 第一个参数是 key
+    int firstkey; /* The first argument that's a key (0 = no keys) */
+
+    // 最后一个参数是 key
+    int lastkey;  /* The last argument that's a key */
+
+    // 从 first 参数和 last 参数之间，所有 key 的步数（step）
+    // 比如说， MSET 命令的格式为 MSET key value [key value ...]
+    // 那么它的 step 就为 2
+    int keystep;  /* The step between first and last key */
 };
 
+/*
+ * AOF 清单中的一个文件
+ */
+typedef struct aofInfo {
+    sds file_name;              /* File name, relative to the working dir */
+    long long file_seq;         /* Sequence number of the file */
+    int file_type;              /* AOF_FILE_TYPE_* */
+} aofInfo;
+
+/*
+ * AOF 清单：记录组成 AOF 的基础文件和增量文件
+ *
+ * The AOF is made of one base file, produced by the latest rewrite, plus
+ * the incremental files holding the commands appended after it. The
+ * manifest lists them in load order and is replaced atomically on disk.
+ *
+ * AOF 由最近一次重写生成的一个基础文件，以及之后追加命令的增量文件组成。
+ * 清单按载入顺序记录这些文件，并在磁盘上被原子地替换。
+ */
+typedef struct aofManifest {
+    aofInfo *base_aof_info;     /* Base file, NULL if never rewritten */
+    list *incr_aof_list;        /* Incremental files, in append order */
+    list *history_aof_list;     /* Files replaced by a rewrite */
+    long long curr_base_file_seq;   /* Sequence of the current base file */
+    long long curr_incr_file_seq;   /* Sequence of the last incr file */
+} aofManifest;
+
 struct redisServer {
+
+    /* General */
+
+    // 进程 ID
+    pid_t pid;                  /* Main process pid. */
+
     int dbnum;
 
     // 数据库
@@ -191,6 +560,9 @@ struct redisServer {
     // 网络错误
     char neterr[ANET_ERR_LEN];   /* Error buffer for anet.c */
 
+    // 本次运行的 ID ，每次启动都不同
+    char runid[REDIS_RUN_ID_SIZE+1];  /* ID always different at every exec. */
+
     // TCP 监听端口
     int port;                   /* TCP listening port */
 
@@ -204,17 +576,368 @@ struct redisServer {
     /* Limits */
     int maxclients;
 
+    // 配置文件的绝对路径
+    char *configfile;           /* Absolute config file path, or NULL */
+
+    // 共享的 "$<len>\r\n" 回复头的数量
+    int shared_bulkhdr_len;     /* Bulk lengths with a shared header */
+
     // 命令表（受到 rename 配置选项的作用）
     dict *commands;             /* Command table */
+
+    // 常用命令的快捷连接
+    struct redisCommand *delCommand, *expireCommand, *pexpireCommand,
+                        *multiCommand;
+
+    // serverCron() 每秒调用的次数
+    int hz;                     /* serverCron() calls frequency in hertz */
+
+    // serverCron() 函数的运行次数计数器
+    int cronloops;              /* Number of times the cron function run */
+
+    // 最近一次使用时钟
+    unsigned lruclock:REDIS_LRU_BITS; /* Clock for LRU eviction */
+
+    // 最大可用内存
+    unsigned long long maxmemory;   /* Max number of memory bytes to use */
+    // 超过可用内存之后的应对策略
+    int maxmemory_policy;           /* Policy for key eviction */
+    // 随机取样的精度
+    int maxmemory_samples;          /* Pricision of random sampling */
+    // LFU 计数器的对数因子，越大计数器增长越慢
+    int lfu_log_factor;             /* LFU logarithmic counter factor. */
+    // LFU 计数器每隔多少分钟衰减一次
+    int lfu_decay_time;             /* LFU counter decay factor. */
+
+    // 是否在 serverCron() 中主动删除过期键（DEBUG SET-ACTIVE-EXPIRE）
+    int active_expire_enabled;      /* Can be disabled for testing purposes. */
+
+    /* Lazy free */
+    // 删除过期键时，是否在后台线程释放值
+    int lazyfree_lazy_expire;
+    // 服务器内部的隐式删除（比如覆写旧值）是否在后台线程释放值
+    int lazyfree_lazy_server_del;
+    // DEL 命令是否和 UNLINK 一样在后台线程释放值
+    int lazyfree_lazy_user_del;
+
+    // 一个链表，保存了所有客户端状态结构
+    list *clients;              /* List of active clients */
+
+    // 根据 ID 查找客户端的索引，字典的键为客户端 ID
+    dict *clients_index;        /* Active clients dictionary by client ID. */
+
+    // 下一个客户端的 ID
+    uint64_t next_client_id;    /* Next client unique ID. Incremental. */
+
+    // 等待被异步关闭的客户端
+    list *clients_to_close;     /* Clients to close asynchronously */
+
+    // 收到 SIGTERM 之后设置，由 serverCron() 负责关闭服务器
+    int shutdown_asap;          /* SHUTDOWN needed ASAP */
+
+    /* AOF persistence */
+
+    // AOF 状态（开启/关闭）
+    int aof_state;                  /* REDIS_AOF_(ON|OFF) */
+
+    // 所使用的 fsync 策略（每个写命令/每秒/从不）
+    int aof_fsync;                  /* Kind of fsync() policy */
+    char *aof_filename;             /* Name of the AOF file */
+
+    // 载入时遇到被截断的 AOF 文件，是否丢弃最后不完整的命令并继续
+    int aof_load_truncated;         /* Don't stop on unexpected AOF EOF. */
+
+    // AOF 文件的当前字节大小
+    off_t aof_current_size;         /* AOF current size. */
+
+    // AOF 缓冲区，在进入事件循环之前写入到文件
+    sds aof_buf;      /* AOF buffer, written before entering the event loop */
+
+    // AOF 文件的描述符
+    int aof_fd;       /* File descriptor of currently selected AOF file */
+
+    // AOF 的当前目标数据库
+    int aof_selected_db; /* Currently selected DB in AOF */
+
+    // 推迟 write 操作的开始时间
+    time_t aof_flush_postponed_start; /* UNIX time of postponed AOF flush */
+
+    // 最后一次执行 fsync 的时间
+    time_t aof_last_fsync;            /* UNIX time of last fsync() */
+
+    // 最后一次 fsync 覆盖到的文件大小
+    off_t aof_fsync_offset;           /* Incr size covered by the last fsync */
+
+    // 最后一次写入 AOF 的状态
+    int aof_last_write_status;      /* REDIS_OK or REDIS_ERR */
+    int aof_last_write_errno;       /* Valid if aof_last_write_status is ERR */
+
+    // 因为后台 fsync 太慢而不再等待、直接写入的次数
+    unsigned long aof_delayed_fsync;  /* delayed AOF fsync() counter */
+
+    // 当前使用的 AOF 清单
+    aofManifest *aof_manifest;      /* Used to track AOFs. */
+
+    // 最后一个增量文件的字节大小，写入和 fsync 都针对这个文件
+    off_t aof_last_incr_size;       /* Size of the incr file being written. */
+
+    // 最近一次重写生成的基础文件的大小
+    off_t aof_rewrite_base_size;    /* AOF size on latest startup or rewrite. */
+
+    // 文件增长超过基础大小的这个百分比时自动重写
+    int aof_rewrite_perc;           /* Rewrite AOF if % growth is > M and... */
+
+    // 文件至少达到这个大小才会自动重写
+    off_t aof_rewrite_min_size;     /* the AOF file is at least N bytes. */
+
+    // 负责执行 AOF 重写的子进程的 ID ，没在重写时为 -1
+    pid_t aof_child_pid;            /* PID if rewriting process */
+
+    // 有其他子进程在运行时，BGREWRITEAOF 被推迟到子进程退出之后
+    int aof_rewrite_scheduled;      /* Rewrite once BGSAVE terminates. */
+
+    // 最近一次重写耗费的时间，以及当前重写开始的时间
+    time_t aof_rewrite_time_last;   /* Time used by last AOF rewrite run. */
+    time_t aof_rewrite_time_start;  /* Current AOF rewrite start time. */
+
+    // 最后一次尝试执行 BGREWRITEAOF 的时间，以及它的结果
+    time_t aof_lastbgrewrite_try;   /* Unix time of last attempted rewrite */
+    int aof_lastbgrewrite_status;   /* REDIS_OK or REDIS_ERR */
+
+    /* RDB persistence */
+
+    // BGSAVE 子进程的类型（写入磁盘还是发送给从服务器）
+    int rdb_child_type;             /* Type of save by active child. */
+
+    // 自从上次 SAVE 执行以来，数据库被修改的次数
+    long long dirty;                /* Changes to DB from the last save */
+
+    // BGSAVE 执行前的数据库被修改次数
+    long long dirty_before_bgsave;  /* Used to restore dirty on failed BGSAVE */
+
+    // 负责执行 BGSAVE 的子进程的 ID
+    // 没在执行 BGSAVE 时，设为 -1
+    pid_t rdb_child_pid;            /* PID of RDB saving child */
+
+    // 自动保存条件
+    struct saveparam *saveparams;   /* Save points array for RDB */
+    int saveparamslen;              /* Number of saving points */
+
+    char *rdb_filename;             /* Name of RDB file */
+    int rdb_checksum;               /* Use RDB checksum? */
+
+    // 载入 RDB 文件时，除主线程之外的解码线程数量
+    int rdb_load_threads;           /* Loader threads besides the main one */
+
+    // 最后一次完成 SAVE 的时间
+    time_t lastsave;                /* Unix time of last successful save */
+
+    // 最后一次尝试执行 BGSAVE 的时间
+    time_t lastbgsave_try;          /* Unix time of last attempted bgsave */
+
+    // 最近一次 BGSAVE 执行耗费的时间
+    time_t rdb_save_time_last;      /* Time used by last RDB save run. */
+
+    // 数据库最近一次开始执行 BGSAVE 的时间
+    time_t rdb_save_time_start;     /* Current RDB save start time. */
+
+    // 最后一次执行 SAVE 的状态
+    int lastbgsave_status;          /* REDIS_OK or REDIS_ERR */
+    int stop_writes_on_bgsave_err;  /* Don't allow writes if can't BGSAVE */
+
+    // 正在载入 RDB 文件
+    int loading;                /* We are loading data from disk if true */
+
+    /* Replication (master) */
+
+    // 最近一次传播的命令所使用的数据库
+    int slaveseldb;                 /* Last SELECTed DB in replication output */
+    // 全局复制偏移量，也即是写入复制积压缓冲区的字节总数
+    long long master_repl_offset;   /* Global replication offset */
+    // 主服务器向从服务器发送 PING 的间隔
+    int repl_ping_slave_period;     /* Master pings the slave every N seconds */
+
+    // 复制积压缓冲区，一个环形缓冲区，用于部分重同步
+    char *repl_backlog;             /* Replication backlog for partial syncs */
+    // 缓冲区的大小
+    long long repl_backlog_size;    /* Backlog circular buffer size */
+    // 缓冲区中有效数据的长度
+    long long repl_backlog_histlen; /* Backlog actual data length */
+    // 下一个字节的写入位置
+    long long repl_backlog_idx;     /* Backlog circular buffer current offset */
+    // 缓冲区中第一个字节的复制偏移量
+    long long repl_backlog_off;     /* Replication offset of first byte in the
+                                       backlog buffer. */
+    // 所有从服务器
+    list *slaves;                   /* List of slaves */
+
+    // 全量同步、成功和失败的部分重同步的次数
+    long long stat_sync_full;       /* Number of full resyncs with slaves. */
+    long long stat_sync_partial_ok; /* Number of accepted PSYNC requests. */
+    long long stat_sync_partial_err;/* Number of unaccepted PSYNC requests. */
+
+    /* Replication (slave) */
+
+    // 主服务器的地址和端口
+    char *masterhost;               /* Hostname of master */
+    int masterport;                 /* Port of master */
+    // 复制超时时间
+    int repl_timeout;               /* Timeout after N seconds of master idle */
+    // 主服务器对应的客户端
+    redisClient *master;     /* Client that is master for this slave */
+    // 断开连接之后缓存的主服务器客户端，用于部分重同步
+    redisClient *cached_master; /* Cached master to be reused for PSYNC. */
+    // 握手阶段同步 I/O 的超时时间
+    int repl_syncio_timeout; /* Timeout for synchronous I/O calls */
+    // 复制状态
+    int repl_state;          /* Replication status if the instance is a slave */
+    // 同步时接收的 RDB 的大小，使用 EOF 标记时为 -1
+    off_t repl_transfer_size; /* Size of RDB to read from master during sync. */
+    // 已经读取的字节数
+    off_t repl_transfer_read; /* Amount of RDB read from master during sync. */
+    // 和主服务器连接的套接字
+    int repl_transfer_s;     /* Slave -> Master SYNC socket */
+    // 保存 RDB 的临时文件的描述符和名字
+    int repl_transfer_fd;    /* Slave -> Master SYNC temp file descriptor */
+    char *repl_transfer_tmpfile; /* Slave-> master SYNC temp file name */
+    // 直接从套接字载入 RDB 时使用的载入器，旧的数据集在载入期间继续服务
+    int repl_diskless_load;  /* REPL_DISKLESS_LOAD_* */
+    struct rdbStreamLoader *repl_transfer_loader; /* Socket load in progress */
+    // 最近一次读取到主服务器数据的时间
+    time_t repl_transfer_lastio; /* Unix time of the latest read, for timeout */
+    // 从服务器是否只读
+    int repl_slave_ro;          /* Slave is read only? */
+    // 和主服务器断开连接的时间
+    time_t repl_down_since; /* Unix time at which link with master went down */
+    // PSYNC 收到的主服务器运行 ID 和偏移量
+    char repl_master_runid[REDIS_RUN_ID_SIZE+1];  /* Master run id for PSYNC. */
+    long long repl_master_initial_offset;         /* Master PSYNC offset. */
+
+    /* Cluster */
+    // 是否开启集群模式
+    int cluster_enabled;      /* Is cluster enabled? */
+    // 集群状态，只有开启集群模式时才会创建
+    struct clusterState *cluster;  /* State of the cluster */
+    // MIGRATE 缓存的连接，键为 "host:port" ，值为 migrateCachedSocket
+    dict *migrate_cached_sockets;/* MIGRATE cached sockets */
+
+    /* Pubsub */
+    // 频道，字典的键为频道名字，值为订阅频道的客户端链表
+    dict *pubsub_channels;  /* Map channels to lists of subscribed clients */
+    // 模式，按照字面前缀保存在基数树中，见 pubsub.c
+    radixTree *pubsub_patterns; /* Patterns by literal prefix */
+    // 被订阅的模式的数量
+    long pubsub_numpat;     /* Number of distinct subscribed patterns */
+
+    /* Client side caching. */
+    // 默认模式下被追踪的键，字典的值为可能缓存了这个键的客户端 ID 的集合
+    dict *tracking_table;       /* Tracked keys -> IDs of the caching clients */
+    // 广播模式下被追踪的前缀，见 tracking.c
+    radixTree *tracking_prefixes; /* Prefixes of the BCAST clients */
+    // 被追踪的前缀的数量
+    unsigned long tracking_total_prefixes; /* Number of BCAST prefixes */
+    // 开启了追踪的客户端的数量
+    unsigned long tracking_clients; /* Number of clients with tracking on */
+    // 被追踪的键的数量上限，为 0 时没有上限
+    long long tracking_table_max_keys; /* Max number of keys in tracking table */
+
+    /* Pipe and data structures for child -> parent info sharing. */
+    int child_info_pipe[2];         /* Pipe used to write the child_info_data. */
+    struct {
+        int process_type;           /* CHILD_INFO_TYPE_* */
+        size_t cow_size;            /* Copy on write size. */
+        unsigned long long magic;   /* Magic value to make sure data is valid. */
+    } child_info_data;
+
+    /* Fields used only for stats */
+
+    // 服务器启动时间
+    time_t stat_starttime;          /* Server start time */
+
+    // 已处理命令的数量
+    long long stat_numcommands;     /* Number of processed commands */
+
+    // 服务器接到的连接请求数量
+    long long stat_numconnections;  /* Number of connections received */
+
+    // 因为客户端数量过大而被拒绝的连接数量
+    long long stat_rejected_conn;   /* Clients rejected because of maxclients */
+
+    // 已过期的键数量
+    long long stat_expiredkeys;     /* Number of expired keys */
+
+    // 因为回收内存而被释放的过期键的数量
+    long long stat_evictedkeys;     /* Number of evicted keys (maxmemory) */
+
+    // 主动过期因为用完时间预算而提前退出的次数
+    long long stat_expire_cycle_time_cap; /* Active expire cycles cut short */
+
+    // 已使用内存峰值
+    size_t stat_peak_memory;        /* Max used memory record */
+
+    // 最后一次执行 fork() 时消耗的时间（微秒）
+    long long stat_fork_time;       /* Time needed to perform latest fork() */
+
+    // 最后一次 BGSAVE 子进程写时复制的内存
+    size_t stat_rdb_cow_bytes;      /* Copy on write bytes during RDB saving. */
+    size_t stat_aof_cow_bytes;      /* Copy on write bytes during AOF rewrite. */
+
+    // 最后一次载入 RDB 文件的键数量、文件大小、耗时和线程数
+    long long stat_rdb_load_keys;   /* Keys added by the last RDB load. */
+    long long stat_rdb_load_bytes;  /* Size of the last loaded RDB file. */
+    long long stat_rdb_load_usec;   /* Duration of the last RDB load. */
+    int stat_rdb_load_threads;      /* Threads decoding the last RDB load. */
+    long long stat_aof_load_commands; /* Commands replayed by the last AOF load. */
+    long long stat_aof_load_bytes;  /* Size of the AOF files last loaded. */
+    long long stat_aof_load_usec;   /* Duration of the last AOF load. */
+
+    // AOF write() 的次数，总耗时，最近一次和最大的耗时（微秒）
+    long long stat_aof_writes;          /* write() calls flushing aof_buf */
+    long long stat_aof_write_usec;      /* Total time spent in write() */
+    long long stat_aof_write_usec_last; /* Duration of the latest write() */
+    long long stat_aof_write_usec_max;  /* Slowest write() */
+
+    // AOF fsync 的次数和耗时（微秒）
+    // appendfsync everysec 时由后台线程更新，所以只能通过原子操作读写
+    long long stat_aof_fsyncs;          /* fsync() calls on the AOF */
+    long long stat_aof_fsync_usec;      /* Total time spent in fsync() */
+    long long stat_aof_fsync_usec_last; /* Duration of the latest fsync() */
+    long long stat_aof_fsync_usec_max;  /* Slowest fsync() */
+
+    // 最近一次采样得到的常驻内存大小
+    size_t resident_set_size;       /* RSS sampled in serverCron(). */
+
+    // 从网络读入的字节数
+    long long stat_net_input_bytes; /* Bytes read from network. */
+
+    // 写入网络的字节数
+    long long stat_net_output_bytes; /* Bytes written to network. */
+
+    /* The following two are used to track instantaneous metrics, like
+     * number of operations per second, network traffic. */
+    struct {
+        // 最后一次进行抽样的时间
+        long long last_sample_time; /* Timestamp of last sample in ms */
+        // 最后一次抽样时，计数器的值
+        long long last_sample_count;/* Count in last sample */
+        // 抽样结果
+        long long samples[REDIS_METRIC_SAMPLES];
+        // 数组的索引，用于保存抽样结果
+        int idx;
+    } inst_metric[REDIS_METRIC_COUNT];
 };
 
 // 通过复用来减少内存碎片，以及减少操作耗时的共享对象
 struct sharedObjectsStruct {
-    robj *crlf, *ok, *err, 
-    *bulkhdr[REDIS_SHARED_BULKHDR_LEN];  /* "$<value>\r\n" */;
+    robj *crlf, *ok, *err, *syntaxerr, *czero, *cone, *nullbulk,
+    *wrongtypeerr, *oomerr, *bgsaveerr, *del, *pong, *roslaveerr, *ping,
+    *queued, *nullmultibulk, *execaborterr, *multi,
+    *subscribebulk, *unsubscribebulk, *psubscribebulk, *punsubscribebulk,
+    *integers[REDIS_SHARED_INTEGERS],
+    **bulkhdr;  /* "$<value>\r\n", server.shared_bulkhdr_len of them */
 };
 
-void setGenericCommand(redisClient *c, robj *key, robj *val);
+void setGenericCommand(redisClient *c, int flags, robj *key, robj *val, robj *expire, int unit, robj *ok_reply, robj *abort_reply);
 int getGenericCommand(redisClient *c);
 
 robj *lookupKeyWrite(redisDb *db, robj *key);
@@ -226,13 +949,25 @@ robj *lookupKey(redisDb *db, robj *key);
 
 /* db.c -- Keyspace access API */
 void setKey(redisDb *db, robj *key, robj *val);
+int dbDelete(redisDb *db, robj *key);
+long long emptyDb(int async, void(callback)(void*));
+int dbSyncDelete(redisDb *db, robj *key);
+int removeExpire(redisDb *db, robj *key);
+void setExpire(redisDb *db, robj *key, long long when);
+long long getExpire(redisDb *db, robj *key);
+int expireIfNeeded(redisDb *db, robj *key);
+int *getKeysFromCommand(struct redisCommand *cmd, robj **argv, int argc, int *numkeys);
+void getKeysFreeResult(int *result);
 
 /* Commands prototypes */
+void selectCommand(redisClient *c);
 void setCommand(redisClient *c);
 void getCommand(redisClient *c);
 
 /* networking.c -- Networking and Client related operations */
 redisClient *createClient(int fd);
+void rewriteClientCommandVector(redisClient *c, int argc, ...);
+void replaceClientCommandVector(redisClient *c, int argc, robj **argv);
 
 int selectDb(redisClient *c, int id);
 
@@ -243,6 +978,18 @@ int dictSdsKeyCompare(void *privdata, const void *key1,
 
 robj *createStringObject(char *ptr, size_t len);
 robj *createRawStringObject(char *ptr, size_t len);
+robj *createEmbeddedStringObject(char *ptr, size_t len);
+robj *createStringObjectFromLongLong(long long value);
+robj *makeObjectShared(robj *o);
+robj *tryObjectEncoding(robj *o);
+robj *getDecodedObject(robj *o);
+size_t stringObjectLen(robj *o);
+int getLongLongFromObject(robj *o, long long *target);
+int getLongLongFromObjectOrReply(redisClient *c, robj *o, long long *target, const char *msg);
+char *strEncoding(int encoding);
+#ifdef REDIS_TEST
+int stringObjectBenchmark(long long numobjects);
+#endif
 
 /*-----------------------------------------------------------------------------
  * Extern declarations
@@ -250,6 +997,12 @@ robj *createRawStringObject(char *ptr, size_t len);
 
 extern struct redisServer server;
 extern struct sharedObjectsStruct shared;
+extern dictType dbDictType;
+extern dictType keyptrDictType;
+extern dictType migrateCacheDictType;
+extern dictType keylistDictType;
+extern dictType setDictType;
+extern dictType ptrDictType;
 
 
 /* Debugging stuff */
@@ -257,6 +1010,7 @@ void _redisAssertWithInfo(redisClient *c, robj *o, char *estr, char *file, int l
 void redisLog(int level, const char *fmt, ...);
 void _redisAssert(char *estr, char *file, int line);
 void redisLogRaw(int level, const char *msg);
+void redisLogFromHandler(int level, const char *msg);
 void _redisPanic(char *msg, char *file, int line);
 
 robj *lookupKeyRead(redisClient *c, robj *key);
@@ -270,6 +1024,7 @@ void incrRefCount(robj *o);
 void freeStringObject(robj *o);
 
 void readQueryFromClient(aeEventLoop *el, int fd, void *privdata, int mask);
+void sendReplyToClient(aeEventLoop *el, int fd, void *privdata, int mask);
 
 void acceptTcpHandler(aeEventLoop *el, int fd, void *privdata, int mask);
 
@@ -279,6 +1034,9 @@ aeEventLoop *aeCreateEventLoop(int setsize);
 int aeProcessEvents(aeEventLoop *eventLoop, int flags);
 
 void freeClient(redisClient *c);
+redisClient *lookupClientByID(uint64_t id);
+unsigned long getClientOutputBufferMemoryUsage(redisClient *c);
+void clientCommand(redisClient *c);
 
 void processInputBuffer(redisClient *c);
 
@@ -291,11 +1049,183 @@ int processInlineBuffer(redisClient *c);
 int processMultibulkBuffer(redisClient *c);
 
 void addReply(redisClient *c, robj *obj);
+void addReplyShared(redisClient *c, robj *obj);
 
 int prepareClientToWrite(redisClient *c);
 
 robj *createObject(int type, void *ptr);
 
+void addReplySds(redisClient *c, sds s);
+void addReplyError(redisClient *c, char *err);
+void addReplyErrorFormat(redisClient *c, const char *fmt, ...);
+void addReplyString(redisClient *c, char *s, size_t len);
+void addReplyBulkSds(redisClient *c, sds s);
+void addReplyLongLongWithPrefix(redisClient *c, long long ll, char prefix);
+
+/* Utils */
+long long ustime(void);
+long long mstime(void);
+void activeExpireCycle(void);
+
+/* evict.c -- maxmemory handling and LRU/LFU eviction. */
+#define LFU_INIT_VAL 5
+unsigned int getLRUClock(void);
+unsigned long long estimateObjectIdleTime(robj *o);
+unsigned long LFUGetTimeInMinutes(void);
+unsigned long LFUDecrAndReturn(robj *o);
+void updateLFU(robj *val);
+void evictionPoolAlloc(void);
+int freeMemoryIfNeeded(void);
+void bytesToHuman(char *s, unsigned long long n);
+sds genRedisInfoString(char *section);
+void infoCommand(redisClient *c);
+
+/* lazyfree.c -- Freeing big values on the bio thread. */
+int dbAsyncDelete(redisDb *db, robj *key);
+void emptyDbAsync(redisDb *db);
+void replaceDbAsync(redisDb *db, dict *keys, dict *expires);
+void freeObjAsync(robj *o);
+size_t lazyfreeGetPendingObjectsCount(void);
+
+/* MULTI/EXEC/WATCH... */
+void initClientMultiState(redisClient *c);
+void freeClientMultiState(redisClient *c);
+void queueMultiCommand(redisClient *c);
+void discardTransaction(redisClient *c);
+void flagTransaction(redisClient *c);
+void unwatchAllKeys(redisClient *c);
+void touchWatchedKey(redisDb *db, robj *key);
+void touchWatchedKeysOnFlush(redisDb *db, dict *keys);
+void signalModifiedKey(redisDb *db, robj *key);
+void multiCommand(redisClient *c);
+void execCommand(redisClient *c);
+void discardCommand(redisClient *c);
+void watchCommand(redisClient *c);
+void unwatchCommand(redisClient *c);
+
+/* Pub / Sub */
+void pubsubInit(void);
+int clientSubscriptionsCount(redisClient *c);
+int pubsubUnsubscribeAllChannels(redisClient *c, int notify);
+int pubsubUnsubscribeAllPatterns(redisClient *c, int notify);
+int pubsubPublishMessage(robj *channel, robj *msg);
+void subscribeCommand(redisClient *c);
+void unsubscribeCommand(redisClient *c);
+void psubscribeCommand(redisClient *c);
+void punsubscribeCommand(redisClient *c);
+void publishCommand(redisClient *c);
+void pubsubCommand(redisClient *c);
+
+/* Client side caching (tracking mode) */
+void trackingInit(void);
+int checkPrefixCollisionsOrReply(redisClient *c, robj **prefixes, size_t numprefix);
+void enableTracking(redisClient *c, uint64_t redirect_to, int bcast, robj **prefixes, size_t numprefix);
+void disableTracking(redisClient *c);
+void trackingRememberKeys(redisClient *c);
+void trackingInvalidateKey(robj *key);
+void trackingInvalidateKeysOnFlush(void);
+void trackingLimitUsedSlots(void);
+void trackingBroadcastInvalidationMessages(void);
+
+/* RDB persistence and child processes */
+void updateDictResizePolicy(void);
+void closeListeningSockets(void);
+void exitFromChild(int retcode);
+int prepareForShutdown(int flags);
+void lastsaveCommand(redisClient *c);
+void shutdownCommand(redisClient *c);
+void openChildInfoPipe(void);
+void closeChildInfoPipe(void);
+void sendChildInfo(int ptype);
+void receiveChildInfo(void);
+
+/* AOF persistence */
+void call(redisClient *c, int flags);
+void propagate(struct redisCommand *cmd, int dbid, robj **argv, int argc, int flags);
+void propagateExpire(redisDb *db, robj *key);
+struct redisCommand *lookupCommandByPerfectHash(const char *name, size_t len);
+struct redisCommand *lookupCommand(sds name);
+struct redisCommand *lookupCommandByCString(char *s);
+void feedAppendOnlyFile(struct redisCommand *cmd, int dictid, robj **argv, int argc);
+void flushAppendOnlyFile(int force);
+void aofFsync(int fd);
+int loadAppendOnlyFiles(aofManifest *am);
+int rewriteAppendOnlyFile(char *filename);
+int rewriteAppendOnlyFileBackground(void);
+void backgroundRewriteDoneHandler(int exitcode, int bysignal);
+void bgrewriteaofCommand(redisClient *c);
+int startAppendOnly(void);
+void stopAppendOnly(void);
+void aofLoadManifestFromDisk(void);
+void aofOpenIfNeededOnServerStart(void);
+void killAppendOnlyChild(void);
+int hasActiveChildProcess(void);
+
+/* Replication */
+void replicationFeedSlaves(list *slaves, int dictid, robj **argv, int argc);
+void replicationFeedSlavesFromMasterStream(list *slaves, char *buf, size_t buflen);
+void updateSlavesWaitingBgsave(int bgsaveerr, int type);
+void replicationCron(void);
+void replicationCacheMaster(redisClient *c);
+void replicationHandleMasterDisconnection(void);
+void replicationSetMaster(char *ip, int port);
+void resizeReplicationBacklog(long long newsize);
+void syncCommand(redisClient *c);
+void replconfCommand(redisClient *c);
+void replicaofCommand(redisClient *c);
+void clusterCommand(redisClient *c);
+void askingCommand(redisClient *c);
+void dumpCommand(redisClient *c);
+void restoreCommand(redisClient *c);
+void migrateCommand(redisClient *c);
+sds genReplicationInfoString(sds info);
+ssize_t syncWrite(int fd, char *ptr, ssize_t size, long long timeout);
+ssize_t syncRead(int fd, char *ptr, ssize_t size, long long timeout);
+ssize_t syncReadLine(int fd, char *ptr, ssize_t size, long long timeout);
+void freeClientAsync(redisClient *c);
+void freeClientsInAsyncFreeQueue(void);
+sds catAppendOnlyGenericCommand(sds dst, int argc, robj **argv);
+void pingCommand(redisClient *c);
+
+/* Configuration */
+void loadServerConfig(char *filename, char *options);
+void appendServerSaveParams(time_t seconds, int changes);
+void resetServerSaveParams(void);
+void configCommand(redisClient *c);
+const char *evictPolicyToString(void);
+const char *aofFsyncPolicyToString(void);
+
 void addReplyBulk(redisClient *c, robj *obj);
+void addReplyLongLong(redisClient *c, long long ll);
+void addReplyMultiBulkLen(redisClient *c, long length);
+char *addReplyReserve(redisClient *c, size_t len);
+void decrRefCountVoid(void *o);
+void msetCommand(redisClient *c);
+void msetnxCommand(redisClient *c);
+void mgetCommand(redisClient *c);
+void incrCommand(redisClient *c);
+void decrCommand(redisClient *c);
+void incrbyCommand(redisClient *c);
+void decrbyCommand(redisClient *c);
+void objectCommand(redisClient *c);
+void debugCommand(redisClient *c);
+void setexCommand(redisClient *c);
+void psetexCommand(redisClient *c);
+void delCommand(redisClient *c);
+void unlinkCommand(redisClient *c);
+void existsCommand(redisClient *c);
+void dbsizeCommand(redisClient *c);
+void flushdbCommand(redisClient *c);
+void flushallCommand(redisClient *c);
+void expireCommand(redisClient *c);
+void expireatCommand(redisClient *c);
+void pexpireCommand(redisClient *c);
+void pexpireatCommand(redisClient *c);
+void ttlCommand(redisClient *c);
+void pttlCommand(redisClient *c);
+void persistCommand(redisClient *c);
+void addReplyBulkCString(redisClient *c, char *s);
+void addReplyStatus(redisClient *c, char *status);
+void addReplyStatusFormat(redisClient *c, const char *fmt, ...);
 void addReplyBulkLen(redisClient *c, robj *obj);
 #endif
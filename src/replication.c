@@ -0,0 +1,1672 @@
+/* Asynchronous replication implementation.
+ *
+ * 主从复制
+ *
+ * A replica connects to its master with REPLICAOF and sends PSYNC. When a
+ * partial resync is not possible the master forks a child that streams a
+ * snapshot straight from memory to the replica sockets (no temporary RDB
+ * file on the master side), while the write commands executed meanwhile
+ * accumulate in the replica output buffers. After the snapshot the master
+ * keeps sending every write command it executes, in the same protocol
+ * format used by the AOF.
+ *
+ * 从服务器通过 REPLICAOF 连接主服务器并发送 PSYNC 。
+ * 不能进行部分重同步时，主服务器 fork 出一个子进程，
+ * 将快照直接从内存写入从服务器的套接字（主服务器不产生临时 RDB 文件），
+ * 在此期间执行的写命令积累在从服务器的输出缓冲区中。
+ * 快照传输完毕之后，主服务器将执行的每个写命令以 AOF 相同的协议格式发送给从服务器。
+ *
+ * Every byte of the replication stream is also appended to a circular
+ * backlog and counted by master_repl_offset. A replica that lost the link
+ * for a short time asks PSYNC <runid> <offset+1>: if the requested offset is
+ * still inside the backlog the master replies +CONTINUE and sends only the
+ * missing bytes.
+ *
+ * 复制流的每个字节还会写入一个环形的 backlog ，并计入 master_repl_offset 。
+ * 短暂断线的从服务器发送 PSYNC <runid> <offset+1> ，
+ * 如果请求的偏移量还在 backlog 之内，主服务器回复 +CONTINUE ，只发送缺失的部分。
+ */
+
+#include "redis.h"
+#include "rdb.h"
+
+#include <sys/time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+void replicationDiscardCachedMaster(void);
+void replicationResurrectCachedMaster(int newfd);
+void replicationSendAck(void);
+void putSlaveOnline(redisClient *slave);
+static void disconnectSlaves(void);
+
+/* --------------------------- Utility functions ---------------------------- */
+
+/* Return the pointer to a string representing the slave ip:listening_port
+ * pair. Mostly useful for logging, since we want to log a slave using its
+ * IP address and it's listening port which is more clear for the user, for
+ * example: "Closing connection with slave 10.1.2.3:6380".
+ *
+ * 返回 "ip:listening_port" 形式的从服务器描述，用于日志 */
+static char *replicationGetSlaveName(redisClient *c) {
+    static char buf[REDIS_IP_STR_LEN+32];
+    char ip[REDIS_IP_STR_LEN];
+
+    anetPeerToString(c->fd,ip,sizeof(ip),NULL);
+    if (c->slave_listening_port)
+        snprintf(buf,sizeof(buf),"%s:%d",ip,c->slave_listening_port);
+    else
+        snprintf(buf,sizeof(buf),"%s:<unknown-replica-port>",ip);
+    return buf;
+}
+
+/* ---------------------------------- MASTER -------------------------------- */
+
+/*
+ * 创建 backlog
+ */
+void createReplicationBacklog(void) {
+    redisAssert(server.repl_backlog == NULL);
+    server.repl_backlog = zmalloc(server.repl_backlog_size);
+    server.repl_backlog_histlen = 0;
+    server.repl_backlog_idx = 0;
+    /* When a new backlog buffer is created, we increment the replication
+     * offset by one to make sure we'll not be able to PSYNC with any
+     * previous slave. This is needed because we avoid incrementing the
+     * master_repl_offset if no backlog exists nor slaves are attached. */
+    server.master_repl_offset++;
+
+    /* We don't have any data inside our buffer, but virtually the first
+     * byte we have is the next byte that will be generated for the
+     * replication stream. */
+    server.repl_backlog_off = server.master_repl_offset+1;
+}
+
+/* This function is called when the user modifies the replication backlog
+ * size at runtime. It is up to the function to both update the
+ * server.repl_backlog_size and to resize the buffer and setup it so that
+ * it contains the same data as the previous one (possibly less data, but
+ * the most recent bytes, or the same data and more free space in case the
+ * buffer is enlarged).
+ *
+ * 修改 backlog 的大小。
+ * 为了简单起见，已有的 backlog 会被丢弃，之后的 PSYNC 只能从新的数据开始。 */
+void resizeReplicationBacklog(long long newsize) {
+    if (newsize < REDIS_REPL_BACKLOG_MIN_SIZE)
+        newsize = REDIS_REPL_BACKLOG_MIN_SIZE;
+    if (server.repl_backlog_size == newsize) return;
+
+    server.repl_backlog_size = newsize;
+    if (server.repl_backlog != NULL) {
+        /* What we actually do is to flush the old buffer and realloc a new
+         * empty one. It will refill with new data incrementally.
+         * The reason is that copying a few gigabytes adds latency and even
+         * worse often we need to alloc additional space before freeing the
+         * old buffer. */
+        zfree(server.repl_backlog);
+        server.repl_backlog = zmalloc(server.repl_backlog_size);
+        server.repl_backlog_histlen = 0;
+        server.repl_backlog_idx = 0;
+        /* Next byte we have is... the next since the buffer is emtpy. */
+        server.repl_backlog_off = server.master_repl_offset+1;
+    }
+}
+
+// 释放 backlog
+void freeReplicationBacklog(void) {
+    zfree(server.repl_backlog);
+    server.repl_backlog = NULL;
+}
+
+/* Add data to the replication backlog.
+ * This function also increments the global replication offset stored at
+ * server.master_repl_offset, because there is no case where we want to feed
+ * the backlog without incrementing the buffer.
+ *
+ * 将数据写入环形的 backlog ，并增加全局复制偏移量 */
+void feedReplicationBacklog(void *ptr, size_t len) {
+    unsigned char *p = ptr;
+
+    server.master_repl_offset += len;
+
+    /* This is a circular buffer, so write as much data we can at every
+     * iteration and rewind the "idx" index if we reach the limit. */
+    while(len) {
+        size_t thislen = server.repl_backlog_size - server.repl_backlog_idx;
+        if (thislen > len) thislen = len;
+        memcpy(server.repl_backlog+server.repl_backlog_idx,p,thislen);
+        server.repl_backlog_idx += thislen;
+        if (server.repl_backlog_idx == server.repl_backlog_size)
+            server.repl_backlog_idx = 0;
+        len -= thislen;
+        p += thislen;
+        server.repl_backlog_histlen += thislen;
+    }
+    if (server.repl_backlog_histlen > server.repl_backlog_size)
+        server.repl_backlog_histlen = server.repl_backlog_size;
+    /* Set the offset of the first byte we have in the backlog. */
+    server.repl_backlog_off = server.master_repl_offset -
+                              server.repl_backlog_histlen + 1;
+}
+
+/* Propagate a write command to the backlog and to every slave.
+ *
+ * 将写命令传播给 backlog 和所有从服务器。
+ *
+ * The command is encoded in the protocol format only once: the same bytes
+ * are appended to the backlog and to the output buffer of every slave.
+ *
+ * 命令只编码一次，同一份协议内容写入 backlog 和每个从服务器的输出缓冲区。 */
+void replicationFeedSlaves(list *slaves, int dictid, robj **argv, int argc) {
+    listNode *ln;
+    listIter li;
+    sds buf;
+
+    /* A slave proxies the stream of its master verbatim to its own slaves,
+     * see replicationFeedSlavesFromMasterStream(). */
+    // 从服务器只转发主服务器的复制流
+    if (server.masterhost != NULL) return;
+
+    /* If there aren't slaves, and there is no backlog buffer to populate,
+     * we have no reasons to create the replication stream. */
+    if (server.repl_backlog == NULL && listLength(slaves) == 0) return;
+
+    /* We can't have slaves attached and no backlog. */
+    redisAssert(!(listLength(slaves) != 0 && server.repl_backlog == NULL));
+
+    buf = sdsempty();
+
+    /* Send SELECT command to every slave if needed. */
+    // 数据库不同时，先发送 SELECT 命令
+    if (server.slaveseldb != dictid) {
+        char seldb[32];
+        int len = ll2string(seldb,sizeof(seldb),dictid);
+
+        buf = sdscatprintf(buf,"*2\r\n$6\r\nSELECT\r\n$%d\r\n%s\r\n",
+            len,seldb);
+        server.slaveseldb = dictid;
+    }
+    buf = catAppendOnlyGenericCommand(buf,argc,argv);
+
+    // 写入 backlog
+    if (server.repl_backlog) feedReplicationBacklog(buf,sdslen(buf));
+
+    // 写入每个从服务器的输出缓冲区
+    listRewind(slaves,&li);
+    while((ln = listNext(&li))) {
+        redisClient *slave = ln->value;
+
+        /* Don't feed slaves that are still waiting for BGSAVE to start */
+        if (slave->replstate == REDIS_REPL_WAIT_BGSAVE_START) continue;
+
+        addReplyString(slave,buf,sdslen(buf));
+    }
+    sdsfree(buf);
+}
+
+/* Feed the slaves of this slave with the bytes received from our master,
+ * exactly as they were received, so that the whole chain shares the same
+ * replication offsets.
+ *
+ * 将主服务器发来的复制流原样转发给下级从服务器，整条复制链的偏移量保持一致。 */
+void replicationFeedSlavesFromMasterStream(list *slaves, char *buf, size_t buflen) {
+    listNode *ln;
+    listIter li;
+
+    if (server.repl_backlog) feedReplicationBacklog(buf,buflen);
+
+    listRewind(slaves,&li);
+    while((ln = listNext(&li))) {
+        redisClient *slave = ln->value;
+
+        /* Don't feed slaves that are still waiting for BGSAVE to start */
+        if (slave->replstate == REDIS_REPL_WAIT_BGSAVE_START) continue;
+        addReplyString(slave,buf,buflen);
+    }
+}
+
+/* Feed the slave 'c' with the replication backlog starting from the
+ * specified 'offset' up to the end of the backlog.
+ *
+ * 将 backlog 中从 offset 开始的内容发送给从服务器 c 。 */
+long long addReplyReplicationBacklog(redisClient *c, long long offset) {
+    long long j, skip, len;
+
+    redisLog(REDIS_DEBUG, "[PSYNC] Slave request offset: %lld", offset);
+
+    if (server.repl_backlog_histlen == 0) {
+        redisLog(REDIS_DEBUG, "[PSYNC] Backlog history len is zero");
+        return 0;
+    }
+
+    /* Compute the amount of bytes we need to discard. */
+    skip = offset - server.repl_backlog_off;
+
+    /* Point j to the oldest byte, that is actaully our
+     * server.repl_backlog_off byte. */
+    j = (server.repl_backlog_idx +
+        (server.repl_backlog_size-server.repl_backlog_histlen)) %
+        server.repl_backlog_size;
+
+    /* Discard the amount of data to seek to the specified 'offset'. */
+    j = (j + skip) % server.repl_backlog_size;
+
+    /* Feed slave with data. Since it is a circular buffer we have to
+     * split the reply in two parts if we are cross-boundary. */
+    len = server.repl_backlog_histlen - skip;
+    while(len) {
+        long long thislen =
+            ((server.repl_backlog_size - j) < len) ?
+            (server.repl_backlog_size - j) : len;
+
+        addReplyString(c,server.repl_backlog + j,thislen);
+        len -= thislen;
+        j = 0;
+    }
+    return server.repl_backlog_histlen - skip;
+}
+
+/* This function handles the PSYNC command from the point of view of a
+ * master receiving a request for partial resynchronization.
+ *
+ * On success return REDIS_OK, otherwise REDIS_ERR is returned and we proceed
+ * with the usual full resync.
+ *
+ * 尝试进行部分重同步，成功返回 REDIS_OK ，否则返回 REDIS_ERR ，
+ * 调用者随后进行全量同步。 */
+int masterTryPartialResynchronization(redisClient *c) {
+    long long psync_offset, psync_len;
+    char *master_runid = c->argv[1]->ptr;
+
+    /* Is the runid of this master the same advertised by the wannabe slave
+     * via PSYNC? If runid changed this master is a different instance and
+     * there is no way to continue. */
+    if (strcasecmp(master_runid, server.runid)) {
+        /* Run id "?" is used by slaves that want to force a full resync. */
+        if (master_runid[0] != '?') {
+            redisLog(REDIS_NOTICE,"Partial resynchronization not accepted: "
+                "Runid mismatch (Client asked for runid '%s', my runid is '%s')",
+                master_runid, server.runid);
+        } else {
+            redisLog(REDIS_NOTICE,"Full resync requested by replica %s",
+                replicationGetSlaveName(c));
+        }
+        goto need_full_resync;
+    }
+
+    /* We still have the data our slave is asking for? */
+    if (getLongLongFromObject(c->argv[2],&psync_offset) != REDIS_OK ||
+        !server.repl_backlog ||
+        psync_offset < server.repl_backlog_off ||
+        psync_offset > (server.repl_backlog_off + server.repl_backlog_histlen))
+    {
+        redisLog(REDIS_NOTICE,
+            "Unable to partial resync with replica %s for lack of backlog "
+            "(Replica request was: %s).", replicationGetSlaveName(c),
+            (char*)c->argv[2]->ptr);
+        goto need_full_resync;
+    }
+
+    /* If we reached this point, we are able to perform a partial resync:
+     * 1) Set client state to make it a slave.
+     * 2) Inform the client we can continue with +CONTINUE
+     * 3) Send the backlog data (from the offset to the end) to the slave. */
+    c->flags |= REDIS_SLAVE;
+    c->replstate = REDIS_REPL_ONLINE;
+    c->repl_ack_time = time(NULL);
+    c->repl_put_online_on_ack = 0;
+    listAddNodeTail(server.slaves,c);
+
+    addReplySds(c,sdsnew("+CONTINUE\r\n"));
+    psync_len = addReplyReplicationBacklog(c,psync_offset);
+    redisLog(REDIS_NOTICE,
+        "Partial resynchronization request from %s accepted. Sending %lld bytes of backlog starting from offset %lld.",
+            replicationGetSlaveName(c), psync_len, psync_offset);
+    return REDIS_OK; /* The caller can return, no full resync needed. */
+
+need_full_resync:
+    return REDIS_ERR;
+}
+
+/* Start a full resynchronization for every slave waiting for it. The RDB
+ * is always streamed to the sockets by a child process.
+ *
+ * 为所有等待全量同步的从服务器启动一次传输，失败时关闭这些从服务器 */
+static int startBgsaveForReplication(void) {
+    listNode *ln;
+    listIter li;
+
+    if (rdbSaveToSlavesSockets() == REDIS_OK) return REDIS_OK;
+
+    redisLog(REDIS_WARNING,"BGSAVE for replication failed");
+    listRewind(server.slaves,&li);
+    while((ln = listNext(&li))) {
+        redisClient *slave = ln->value;
+
+        if (slave->replstate == REDIS_REPL_WAIT_BGSAVE_START)
+            freeClientAsync(slave);
+    }
+    return REDIS_ERR;
+}
+
+/* PSYNC <runid> <offset>
+ *
+ * 从服务器请求同步 */
+void syncCommand(redisClient *c) {
+    /* ignore PSYNC if already slave */
+    if (c->flags & REDIS_SLAVE) return;
+
+    /* Refuse SYNC requests if we are a slave but the link with our master
+     * is not ok... */
+    if (server.masterhost && server.repl_state != REDIS_REPL_CONNECTED) {
+        addReplyError(c,"Can't SYNC while not connected with my master");
+        return;
+    }
+
+    /* SYNC can't be issued when the server has pending data to send to
+     * the client about already issued commands. We need a fresh reply
+     * buffer registering the differences between the BGSAVE and the current
+     * dataset, so that we can copy to other slaves if needed. */
+    if (listLength(c->reply) != 0 || c->bufpos != 0) {
+        addReplyError(c,"SYNC and PSYNC are invalid with pending output");
+        return;
+    }
+
+    redisLog(REDIS_NOTICE,"Replica %s asks for synchronization",
+        replicationGetSlaveName(c));
+
+    /* Try a partial resynchronization. If it fails we go ahead with a
+     * full resync. */
+    if (masterTryPartialResynchronization(c) == REDIS_OK) {
+        server.stat_sync_partial_ok++;
+        return; /* No full resync needed, return. */
+    } else {
+        char *master_runid = c->argv[1]->ptr;
+
+        /* Increment stats for failed PSYNCs, but only if the
+         * runid is not "?", as this is used by slaves to force a full
+         * resync on purpose when they are not albe to partially
+         * resync. */
+        if (master_runid[0] != '?') server.stat_sync_partial_err++;
+    }
+
+    /* Full resynchronization. */
+    server.stat_sync_full++;
+
+    /* Setup the slave as one waiting for BGSAVE to start. The following code
+     * paths will change the state if we handle the slave differently. */
+    c->replstate = REDIS_REPL_WAIT_BGSAVE_START;
+    c->repl_put_online_on_ack = 0;
+    c->flags |= REDIS_SLAVE;
+    listAddNodeTail(server.slaves,c);
+
+    /* Create the replication backlog if needed. */
+    if (listLength(server.slaves) == 1 && server.repl_backlog == NULL)
+        createReplicationBacklog();
+
+    /* If a child is already busy (a BGSAVE, an AOF rewrite or another
+     * transfer) the slave waits for it to finish: replicationCron()
+     * starts the transfer as soon as no child is active. */
+    // 已经有子进程在运行时，等它结束之后由 replicationCron() 开始传输
+    if (hasActiveChildProcess()) {
+        redisLog(REDIS_NOTICE,
+            "Delay next BGSAVE for SYNC: another child is active");
+        return;
+    }
+    startBgsaveForReplication();
+}
+
+/* REPLCONF <option> <value> <option> <value> ...
+ * This command is used by a slave in order to configure the replication
+ * process before starting it with the PSYNC command.
+ *
+ * Currently the only use of this command is to communicate to the master
+ * what is the listening port of the Slave redis instance, so that the
+ * master can accurately list slaves and their listening ports in
+ * the INFO output. Once the slave is online it uses REPLCONF ACK <offset>
+ * to report the amount of replication stream it processed.
+ *
+ * 从服务器在 PSYNC 之前用它告知自己的监听端口，
+ * 同步完成之后用 REPLCONF ACK <offset> 报告已经处理的复制流。 */
+void replconfCommand(redisClient *c) {
+    int j;
+
+    if ((c->argc % 2) == 0) {
+        /* Number of arguments must be odd to make sure that every
+         * option has a corresponding value. */
+        addReply(c,shared.syntaxerr);
+        return;
+    }
+
+    /* Process every option-value pair. */
+    for (j = 1; j < c->argc; j+=2) {
+        if (!strcasecmp(c->argv[j]->ptr,"listening-port")) {
+            long long port;
+
+            if ((getLongLongFromObjectOrReply(c,c->argv[j+1],
+                    &port,NULL) != REDIS_OK))
+                return;
+            c->slave_listening_port = port;
+        } else if (!strcasecmp(c->argv[j]->ptr,"ack")) {
+            /* REPLCONF ACK is used by slave to inform the master the amount
+             * of replication stream that it processed so far. It is an
+             * internal only command that normal clients should never use. */
+            long long offset;
+
+            if (!(c->flags & REDIS_SLAVE)) return;
+            if ((getLongLongFromObject(c->argv[j+1], &offset) != REDIS_OK))
+                return;
+            if (offset > c->repl_ack_off)
+                c->repl_ack_off = offset;
+            c->repl_ack_time = time(NULL);
+            /* The first ACK after a full resync confirms that the slave
+             * loaded the snapshot: only now the accumulated stream is
+             * sent. */
+            // 全量同步之后的第一个 ACK 表示从服务器已经载入了快照，
+            // 这时才开始发送积累的复制流
+            if (c->repl_put_online_on_ack && c->replstate == REDIS_REPL_ONLINE)
+                putSlaveOnline(c);
+            /* Note: this command does not reply anything! */
+            return;
+        } else {
+            addReplyErrorFormat(c,"Unrecognized REPLCONF option: %s",
+                (char*)c->argv[j]->ptr);
+            return;
+        }
+    }
+    addReply(c,shared.ok);
+}
+
+/* This function puts a slave in the online state, and should be called just
+ * after a slave received the RDB file for the initial synchronization, and
+ * we are finally ready to send the incremental stream of commands.
+ *
+ * 将从服务器设置为在线状态，并开始发送积累的复制流 */
+void putSlaveOnline(redisClient *slave) {
+    slave->replstate = REDIS_REPL_ONLINE;
+    slave->repl_put_online_on_ack = 0;
+    slave->repl_ack_time = time(NULL);
+    if ((slave->bufpos || listLength(slave->reply)) &&
+        aeCreateFileEvent(server.el, slave->fd, AE_WRITABLE,
+        sendReplyToClient, slave) == AE_ERR) {
+        redisLog(REDIS_WARNING,"Unable to register writable event for replica bulk transfer: %s", strerror(errno));
+        freeClientAsync(slave);
+        return;
+    }
+    redisLog(REDIS_NOTICE,"Synchronization with replica %s succeeded",
+        replicationGetSlaveName(slave));
+}
+
+/* This function is called at the end of every background saving.
+ * The argument bgsaveerr is REDIS_OK if the background saving succeeded
+ * otherwise REDIS_ERR is passed to the function.
+ * The 'type' argument is the type of the child that terminated
+ * (if it had a disk or socket target).
+ *
+ * 在每次 BGSAVE 执行完毕之后调用。
+ * 直接写入套接字的传输完成之后，从服务器要等到发来第一个 ACK 才真正上线；
+ * 仍在等待传输开始的从服务器由 replicationCron() 处理，
+ * 因为这里还处于回收子进程的过程中，不能 fork 。 */
+void updateSlavesWaitingBgsave(int bgsaveerr, int type) {
+    listNode *ln;
+    listIter li;
+
+    if (type != REDIS_RDB_CHILD_TYPE_SOCKET) return;
+
+    listRewind(server.slaves,&li);
+    while((ln = listNext(&li))) {
+        redisClient *slave = ln->value;
+
+        if (slave->replstate != REDIS_REPL_WAIT_BGSAVE_END) continue;
+
+        if (bgsaveerr != REDIS_OK) {
+            redisLog(REDIS_WARNING,"SYNC failed. BGSAVE child returned an error");
+            freeClient(slave);
+            continue;
+        }
+
+        /* The child wrote to the socket in blocking mode: restore it. */
+        // 子进程以阻塞模式写入，恢复非阻塞模式
+        anetNonBlock(NULL,slave->fd);
+        anetSendTimeout(NULL,slave->fd,0);
+
+        redisLog(REDIS_NOTICE,
+            "Streamed RDB transfer with replica %s succeeded (socket). Waiting for REPLCONF ACK from replica to enable streaming",
+                replicationGetSlaveName(slave));
+        /* Note: we wait for a REPLCONF ACK message from slave in
+         * order to really put it online (install the write handler
+         * so that the accumulated data can be transfered). However
+         * we change the replication state ASAP, since our slave
+         * is technically online now. */
+        slave->replstate = REDIS_REPL_ONLINE;
+        slave->repl_put_online_on_ack = 1;
+        slave->repl_ack_time = time(NULL);
+    }
+}
+
+/* ----------------------------------- SLAVE -------------------------------- */
+
+/* Abort the async download of the bulk dataset while SYNC-ing with master
+ *
+ * 停止下载 RDB 文件 */
+void replicationAbortSyncTransfer(void) {
+    redisAssert(server.repl_state == REDIS_REPL_TRANSFER);
+
+    aeDeleteFileEvent(server.el,server.repl_transfer_s,AE_READABLE);
+    close(server.repl_transfer_s);
+    if (server.repl_transfer_loader) {
+        // 丢弃载入了一半的键空间，旧的数据集保持不变
+        rdbStreamLoaderFree(server.repl_transfer_loader);
+        server.repl_transfer_loader = NULL;
+    } else {
+        close(server.repl_transfer_fd);
+        unlink(server.repl_transfer_tmpfile);
+        zfree(server.repl_transfer_tmpfile);
+        server.repl_transfer_tmpfile = NULL;
+    }
+    server.repl_state = REDIS_REPL_CONNECT;
+}
+
+/* Create the client that represents our master once the link is up.
+ *
+ * 为主服务器创建一个客户端，之后复制流就像普通命令一样被读入和执行 */
+static void replicationCreateMasterClient(int fd) {
+    server.master = createClient(fd);
+    server.master->flags |= REDIS_MASTER;
+    server.master->reploff = server.repl_master_initial_offset;
+    memcpy(server.master->replrunid, server.repl_master_runid,
+        sizeof(server.repl_master_runid));
+    server.repl_state = REDIS_REPL_CONNECTED;
+}
+
+/* Asynchronously read the SYNC payload we receive from a master
+ *
+ * 异步读取主服务器发来的 RDB 数据
+ *
+ * The payload is either "$<count>\r\n" followed by count bytes, or, for
+ * the diskless transfer used by this master, "$EOF:<40 bytes mark>\r\n"
+ * followed by the RDB and the same mark.
+ *
+ * 数据的格式是 "$<count>\r\n" 加上 count 字节，
+ * 或者 "$EOF:<40 字节标记>\r\n" 加上 RDB 数据，最后跟着同一个标记。
+ *
+ * With repl-diskless-load swapdb the payload is not written to a temp file:
+ * it is parsed as it arrives into a new keyspace, while the clients are
+ * still served with the old dataset, and swapped in at the end.
+ *
+ * 使用 repl-diskless-load swapdb 时数据不写入临时文件，
+ * 而是一边接收一边载入到新的键空间中，旧的数据集继续服务，最后一次换入。 */
+void readSyncBulkPayload(aeEventLoop *el, int fd, void *privdata, int mask) {
+    char buf[REDIS_IOBUF_LEN];
+    ssize_t nread, readlen;
+    off_t left;
+    int eof_reached = 0;
+    REDIS_NOTUSED(el);
+    REDIS_NOTUSED(privdata);
+    REDIS_NOTUSED(mask);
+
+    /* Static vars used to hold the EOF mark, and the last bytes received
+     * form the server: when they match, we reached the end of the transfer. */
+    static char eofmark[REDIS_EOF_MARK_SIZE];
+    static char lastbytes[REDIS_EOF_MARK_SIZE];
+    static int usemark = 0;
+
+    /* If repl_transfer_size == -1 we still have to read the bulk length
+     * from the master reply. */
+    if (server.repl_transfer_size == -1) {
+        if (syncReadLine(fd,buf,1024,server.repl_syncio_timeout*1000) == -1) {
+            redisLog(REDIS_WARNING,
+                "I/O error reading bulk count from MASTER: %s",
+                strerror(errno));
+            goto error;
+        }
+
+        if (buf[0] == '-') {
+            redisLog(REDIS_WARNING,
+                "MASTER aborted replication with an error: %s",
+                buf+1);
+            goto error;
+        } else if (buf[0] == '\0') {
+            /* At this stage just a newline works as a PING in order to take
+             * the connection live. So we refresh our last interaction
+             * timestamp. */
+            server.repl_transfer_lastio = time(NULL);
+            return;
+        } else if (buf[0] != '$') {
+            redisLog(REDIS_WARNING,"Bad protocol from MASTER, the first byte is not '$' (we received '%s'), are you sure the host and port are right?", buf);
+            goto error;
+        }
+
+        if (strncmp(buf+1,"EOF:",4) == 0 &&
+            strlen(buf+5) >= REDIS_EOF_MARK_SIZE)
+        {
+            usemark = 1;
+            memcpy(eofmark,buf+5,REDIS_EOF_MARK_SIZE);
+            memset(lastbytes,0,REDIS_EOF_MARK_SIZE);
+            /* Set any repl_transfer_size to avoid entering this code path
+             * at the next call. */
+            server.repl_transfer_size = 0;
+            redisLog(REDIS_NOTICE,
+                "MASTER <-> REPLICA sync: receiving streamed RDB from master");
+        } else {
+            usemark = 0;
+            server.repl_transfer_size = strtol(buf+1,NULL,10);
+            redisLog(REDIS_NOTICE,
+                "MASTER <-> REPLICA sync: receiving %lld bytes from master",
+                (long long) server.repl_transfer_size);
+        }
+
+        /* No temp file was created by syncWithMaster(): load from the
+         * socket. The final EOF mark is not part of the RDB. */
+        if (server.repl_transfer_tmpfile == NULL)
+            server.repl_transfer_loader =
+                rdbStreamLoaderCreate(usemark ? REDIS_EOF_MARK_SIZE : 0);
+        return;
+    }
+
+    /* Read bulk data */
+    if (usemark) {
+        readlen = sizeof(buf);
+    } else {
+        left = server.repl_transfer_size - server.repl_transfer_read;
+        readlen = (left < (signed)sizeof(buf)) ? left : (signed)sizeof(buf);
+    }
+
+    nread = read(fd,buf,readlen);
+    if (nread <= 0) {
+        if (nread == -1 && errno == EAGAIN) return;
+        redisLog(REDIS_WARNING,"I/O error trying to sync with MASTER: %s",
+            (nread == -1) ? strerror(errno) : "connection lost");
+        replicationAbortSyncTransfer();
+        return;
+    }
+    server.stat_net_input_bytes += nread;
+
+    /* When a mark is used, we want to detect EOF asap in order to avoid
+     * writing the EOF mark into the file... */
+    if (usemark) {
+        /* Update the last bytes array, and check if it matches our delimiter.*/
+        if (nread >= REDIS_EOF_MARK_SIZE) {
+            memcpy(lastbytes,buf+nread-REDIS_EOF_MARK_SIZE,REDIS_EOF_MARK_SIZE);
+        } else {
+            int rem = REDIS_EOF_MARK_SIZE-nread;
+            memmove(lastbytes,lastbytes+nread,rem);
+            memcpy(lastbytes+rem,buf,nread);
+        }
+        if (memcmp(lastbytes,eofmark,REDIS_EOF_MARK_SIZE) == 0) eof_reached = 1;
+    }
+
+    server.repl_transfer_lastio = time(NULL);
+    if (server.repl_transfer_loader) {
+        if (rdbStreamLoaderFeed(server.repl_transfer_loader,buf,nread)
+            == REDIS_ERR)
+        {
+            redisLog(REDIS_WARNING,"Failed loading the RDB streamed by the MASTER");
+            goto error;
+        }
+    } else if (write(server.repl_transfer_fd,buf,nread) != nread) {
+        redisLog(REDIS_WARNING,"Write error or short write writing to the DB dump file needed for MASTER <-> REPLICA synchronization: %s", strerror(errno));
+        goto error;
+    }
+    server.repl_transfer_read += nread;
+
+    /* Delete the last 40 bytes from the file if we reached EOF. */
+    if (usemark && eof_reached && !server.repl_transfer_loader) {
+        if (ftruncate(server.repl_transfer_fd,
+            server.repl_transfer_read - REDIS_EOF_MARK_SIZE) == -1)
+        {
+            redisLog(REDIS_WARNING,"Error truncating the RDB file received from the master for SYNC: %s", strerror(errno));
+            goto error;
+        }
+    }
+
+    /* Check if the transfer is now complete */
+    if (!usemark) {
+        if (server.repl_transfer_read == server.repl_transfer_size)
+            eof_reached = 1;
+    }
+
+    if (eof_reached && server.repl_transfer_loader) {
+        if (rdbStreamLoaderFinish(server.repl_transfer_loader) == REDIS_ERR) {
+            redisLog(REDIS_WARNING,"Failed loading the RDB streamed by the MASTER, keeping the old dataset");
+            goto error;
+        }
+    }
+
+    if (eof_reached) {
+        int aof_is_enabled = server.aof_state != REDIS_AOF_OFF;
+
+        /* The received snapshot becomes our RDB file. */
+        if (!server.repl_transfer_loader && rename(server.repl_transfer_tmpfile,server.rdb_filename) == -1) {
+            redisLog(REDIS_WARNING,"Failed trying to rename the temp DB into %s in MASTER <-> REPLICA synchronization: %s",
+                server.rdb_filename, strerror(errno));
+            replicationAbortSyncTransfer();
+            return;
+        }
+
+        // 停止 AOF ，载入完成后重新开启，从而重写出一份与新数据集一致的 AOF
+        if (aof_is_enabled) stopAppendOnly();
+
+        /* Our own slaves hold the old dataset and offsets: force them to
+         * resync with us as well. */
+        disconnectSlaves();
+
+        if (server.repl_transfer_loader) {
+            /* The new keyspace is already in memory: swap it with the old
+             * one, that is released in background. */
+            redisLog(REDIS_NOTICE, "MASTER <-> REPLICA sync: Swapping in the loaded DB");
+            rdbStreamLoaderSwap(server.repl_transfer_loader);
+            rdbStreamLoaderFree(server.repl_transfer_loader);
+            server.repl_transfer_loader = NULL;
+            aeDeleteFileEvent(server.el,server.repl_transfer_s,AE_READABLE);
+        } else {
+            redisLog(REDIS_NOTICE, "MASTER <-> REPLICA sync: Flushing old data");
+            emptyDb(0,NULL);
+
+            /* Before loading the DB into memory we need to delete the
+             * readable handler, otherwise it will get called recursively
+             * since rdbLoad() may process events while loading. */
+            aeDeleteFileEvent(server.el,server.repl_transfer_s,AE_READABLE);
+            redisLog(REDIS_NOTICE, "MASTER <-> REPLICA sync: Loading DB in memory");
+            if (rdbLoad(server.rdb_filename) != REDIS_OK) {
+                redisLog(REDIS_WARNING,"Failed trying to load the MASTER synchronization DB from disk");
+                replicationAbortSyncTransfer();
+                return;
+            }
+            zfree(server.repl_transfer_tmpfile);
+            server.repl_transfer_tmpfile = NULL;
+            close(server.repl_transfer_fd);
+        }
+
+        /* Final setup of the connected slave <- master link */
+        replicationCreateMasterClient(server.repl_transfer_s);
+
+        /* Our offset now matches the master one: start the backlog from
+         * here so that our own slaves can PSYNC with us. */
+        // 从服务器的复制偏移量与主服务器一致，backlog 从这里开始
+        if (server.repl_backlog == NULL) createReplicationBacklog();
+        server.master_repl_offset = server.master->reploff;
+        server.repl_backlog_histlen = 0;
+        server.repl_backlog_idx = 0;
+        server.repl_backlog_off = server.master_repl_offset+1;
+        redisLog(REDIS_NOTICE, "MASTER <-> REPLICA sync: Finished with success");
+
+        /* Restart the AOF subsystem now that we finished the sync. This
+         * will trigger an AOF rewrite, and when done will start appending
+         * to the new file. */
+        if (aof_is_enabled) {
+            int retry = 10, ret;
+
+            // 最多尝试 10 次，只有最后一次仍然失败时才退出
+            while ((ret = startAppendOnly()) == REDIS_ERR && --retry) {
+                redisLog(REDIS_WARNING,"Failed enabling the AOF after successful master synchronization! Trying it again in one second.");
+                sleep(1);
+            }
+            if (ret == REDIS_ERR) {
+                redisLog(REDIS_WARNING,"FATAL: this replica instance finished the synchronization with its master, but the AOF can't be turned on. Exiting now.");
+                exit(1);
+            }
+        }
+
+        /* Send the initial ACK immediately to put this slave in online
+         * state: the master holds the stream until it receives it. */
+        replicationSendAck();
+    }
+    return;
+
+error:
+    replicationAbortSyncTransfer();
+    return;
+}
+
+/* Send a synchronous command to the master. Used to send the handshake
+ * commands: the arguments are NULL terminated. With SYNC_CMD_WRITE the
+ * command is written, with SYNC_CMD_READ a single line of reply is read and
+ * returned as an sds string, that the caller should free. In case of write
+ * errors an error string is returned, starting with "-".
+ *
+ * 以阻塞的方式向主服务器发送命令，或者读取一行回复。
+ * 命令以多条查询的格式发送。 */
+#define SYNC_CMD_READ (1<<0)
+#define SYNC_CMD_WRITE (1<<1)
+static char *sendSynchronousCommand(int flags, int fd, ...) {
+
+    /* Create the command to send to the master. */
+    if (flags & SYNC_CMD_WRITE) {
+        char *arg;
+        va_list ap;
+        int argc = 0;
+        sds cmd = sdsempty(), args = sdsempty();
+
+        va_start(ap,fd);
+        while(1) {
+            arg = va_arg(ap, char*);
+            if (arg == NULL) break;
+            args = sdscatprintf(args,"$%lu\r\n%s\r\n",
+                (unsigned long)strlen(arg),arg);
+            argc++;
+        }
+        va_end(ap);
+        cmd = sdscatprintf(cmd,"*%d\r\n",argc);
+        cmd = sdscatlen(cmd,args,sdslen(args));
+        sdsfree(args);
+
+        /* Transfer command to the server. */
+        if (syncWrite(fd,cmd,sdslen(cmd),server.repl_syncio_timeout*1000)
+            == -1)
+        {
+            sdsfree(cmd);
+            return sdscatprintf(sdsempty(),"-Writing to master: %s",
+                    strerror(errno));
+        }
+        sdsfree(cmd);
+    }
+
+    /* Read the reply from the server. */
+    if (flags & SYNC_CMD_READ) {
+        char buf[256];
+
+        if (syncReadLine(fd,buf,sizeof(buf),server.repl_syncio_timeout*1000)
+            == -1)
+        {
+            return sdscatprintf(sdsempty(),"-Reading from master: %s",
+                    strerror(errno));
+        }
+        return sdsnew(buf);
+    }
+    return NULL;
+}
+
+/* Try a partial resynchronization with the master if we are about to reconnect.
+ * If there is no cached master structure, at least try to issue a
+ * "PSYNC ? -1" command in order to trigger a full resync using the PSYNC
+ * command in order to obtain the master run id and the master replication
+ * global offset.
+ *
+ * 尝试与主服务器进行部分重同步。
+ *
+ * The function is called twice: with read_reply == 0 it sends the PSYNC
+ * command, with read_reply == 1 it reads the reply. Return values:
+ *
+ * PSYNC_WAIT_REPLY: the command was sent (or an empty keepalive line was
+ *                   read), call again when the socket is readable.
+ * PSYNC_CONTINUE: the partial resync was accepted, the cached master is
+ *                 now the master again.
+ * PSYNC_FULLRESYNC: the master will send a snapshot.
+ * PSYNC_NOT_SUPPORTED / PSYNC_WRITE_ERROR: give up this connection.
+ */
+#define PSYNC_WRITE_ERROR 0
+#define PSYNC_WAIT_REPLY 1
+#define PSYNC_CONTINUE 2
+#define PSYNC_FULLRESYNC 3
+#define PSYNC_NOT_SUPPORTED 4
+static int slaveTryPartialResynchronization(int fd, int read_reply) {
+    char *psync_runid;
+    char psync_offset[32];
+    sds reply;
+
+    /* Writing half */
+    if (!read_reply) {
+        /* Initially set repl_master_initial_offset to -1 to mark the current
+         * master run_id and offset as not valid. Later if we'll be able to do
+         * a FULL resync using the PSYNC command we'll set the offset at the
+         * right value, so that this information will be propagated to the
+         * client structure representing the master into server.master. */
+        server.repl_master_initial_offset = -1;
+
+        if (server.cached_master) {
+            psync_runid = server.cached_master->replrunid;
+            snprintf(psync_offset,sizeof(psync_offset),"%lld",
+                server.cached_master->reploff+1);
+            redisLog(REDIS_NOTICE,"Trying a partial resynchronization (request %s:%s).", psync_runid, psync_offset);
+        } else {
+            redisLog(REDIS_NOTICE,"Partial resynchronization not possible (no cached master)");
+            psync_runid = "?";
+            memcpy(psync_offset,"-1",3);
+        }
+
+        /* Issue the PSYNC command */
+        reply = sendSynchronousCommand(SYNC_CMD_WRITE,fd,"PSYNC",
+            psync_runid,psync_offset,NULL);
+        if (reply != NULL) {
+            redisLog(REDIS_WARNING,"Unable to send PSYNC to master: %s",reply);
+            sdsfree(reply);
+            return PSYNC_WRITE_ERROR;
+        }
+        return PSYNC_WAIT_REPLY;
+    }
+
+    /* Reading half */
+    reply = sendSynchronousCommand(SYNC_CMD_READ,fd,NULL);
+    if (sdslen(reply) == 0) {
+        /* The master may send empty newlines after it receives PSYNC
+         * and before to reply, just to keep the connection alive. */
+        sdsfree(reply);
+        return PSYNC_WAIT_REPLY;
+    }
+
+    aeDeleteFileEvent(server.el,fd,AE_READABLE);
+
+    if (!strncmp(reply,"+FULLRESYNC",11)) {
+        char *runid = NULL, *offset = NULL;
+
+        /* FULL RESYNC, parse the reply in order to extract the run id
+         * and the replication offset. */
+        runid = strchr(reply,' ');
+        if (runid) {
+            runid++;
+            offset = strchr(runid,' ');
+            if (offset) offset++;
+        }
+        if (!runid || !offset || (offset-runid-1) != REDIS_RUN_ID_SIZE) {
+            redisLog(REDIS_WARNING,
+                "Master replied with wrong +FULLRESYNC syntax.");
+            /* This is an unexpected condition, actually the +FULLRESYNC
+             * reply means that the master supports PSYNC, but the reply
+             * format seems wrong. To stay safe we blank the master
+             * runid to make sure next PSYNCs will fail. */
+            memset(server.repl_master_runid,0,REDIS_RUN_ID_SIZE+1);
+        } else {
+            memcpy(server.repl_master_runid, runid, offset-runid-1);
+            server.repl_master_runid[REDIS_RUN_ID_SIZE] = '\0';
+            server.repl_master_initial_offset = strtoll(offset,NULL,10);
+            redisLog(REDIS_NOTICE,"Full resync from master: %s:%lld",
+                server.repl_master_runid,
+                server.repl_master_initial_offset);
+        }
+        /* We are going to full resync, discard the cached master structure. */
+        replicationDiscardCachedMaster();
+        sdsfree(reply);
+        return PSYNC_FULLRESYNC;
+    }
+
+    if (!strncmp(reply,"+CONTINUE",9)) {
+        /* Partial resync was accepted, set the replication state accordingly */
+        redisLog(REDIS_NOTICE,
+            "Successful partial resynchronization with master.");
+        sdsfree(reply);
+        replicationResurrectCachedMaster(fd);
+        return PSYNC_CONTINUE;
+    }
+
+    /* If we reach this point we received either an error since the master
+     * does not understand PSYNC, or an unexpected reply from the master. */
+    redisLog(REDIS_WARNING,"Unexpected reply to PSYNC from master: %s",reply);
+    sdsfree(reply);
+    replicationDiscardCachedMaster();
+    return PSYNC_NOT_SUPPORTED;
+}
+
+/*
+ * 从服务器与主服务器的握手：PING -> REPLCONF listening-port -> PSYNC
+ *
+ * The handshake is a small state machine driven by the events of the
+ * non blocking socket: every step sends a command and returns, the next
+ * call reads its reply.
+ *
+ * 握手由非阻塞套接字的事件驱动：每一步发送一个命令后返回，下一次调用读取它的回复。
+ */
+void syncWithMaster(aeEventLoop *el, int fd, void *privdata, int mask) {
+    char tmpfile[256], *err = NULL;
+    int dfd = -1, maxtries = 5;
+    int sockerr = 0, psync_result;
+    socklen_t errlen = sizeof(sockerr);
+    REDIS_NOTUSED(el);
+    REDIS_NOTUSED(privdata);
+    REDIS_NOTUSED(mask);
+
+    /* If this event fired after the user turned the instance into a master
+     * with REPLICAOF NO ONE we must just return ASAP. */
+    if (server.repl_state == REDIS_REPL_NONE) {
+        close(fd);
+        return;
+    }
+
+    /* Check for errors in the socket. */
+    if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &sockerr, &errlen) == -1)
+        sockerr = errno;
+    if (sockerr) {
+        redisLog(REDIS_WARNING,"Error condition on socket for SYNC: %s",
+            strerror(sockerr));
+        goto error;
+    }
+
+    /* Send a PING to check the master is able to reply without errors. */
+    if (server.repl_state == REDIS_REPL_CONNECTING) {
+        redisLog(REDIS_NOTICE,"Non blocking connect for SYNC fired the event.");
+        /* Delete the writable event so that the readable event remains
+         * registered and we can wait for the PONG reply. */
+        aeDeleteFileEvent(server.el,fd,AE_WRITABLE);
+        server.repl_state = REDIS_REPL_RECEIVE_PONG;
+        /* Send the PING, don't check for errors at all, we have the timeout
+         * that will take care about this. */
+        err = sendSynchronousCommand(SYNC_CMD_WRITE,fd,"PING",NULL);
+        if (err) goto write_error;
+        return;
+    }
+
+    /* Receive the PONG command. */
+    if (server.repl_state == REDIS_REPL_RECEIVE_PONG) {
+        err = sendSynchronousCommand(SYNC_CMD_READ,fd,NULL);
+
+        /* We accept only two replies as valid, a positive +PONG reply
+         * (we just check for "+") or an authentication error. */
+        if (err[0] != '+') {
+            redisLog(REDIS_WARNING,"Error reply to PING from master: '%s'",err);
+            sdsfree(err);
+            goto error;
+        } else {
+            redisLog(REDIS_NOTICE,
+                "Master replied to PING, replication can continue...");
+        }
+        sdsfree(err);
+
+        /* Set the slave port, so that Master's INFO command can list the
+         * slave listening port correctly. */
+        {
+            char port[32];
+
+            ll2string(port,sizeof(port),server.port);
+            err = sendSynchronousCommand(SYNC_CMD_WRITE,fd,"REPLCONF",
+                    "listening-port",port,NULL);
+            if (err) goto write_error;
+        }
+        server.repl_state = REDIS_REPL_RECEIVE_PORT;
+        return;
+    }
+
+    /* Receive REPLCONF listening-port reply. */
+    if (server.repl_state == REDIS_REPL_RECEIVE_PORT) {
+        err = sendSynchronousCommand(SYNC_CMD_READ,fd,NULL);
+        /* Ignore the error if any, not all the Redis versions support
+         * REPLCONF listening-port. */
+        if (err[0] == '-') {
+            redisLog(REDIS_NOTICE,"(Non critical) Master does not understand "
+                                  "REPLCONF listening-port: %s", err);
+        }
+        sdsfree(err);
+        server.repl_state = REDIS_REPL_SEND_PSYNC;
+    }
+
+    /* Try a partial resynchonization. If we don't have a cached master
+     * slaveTryPartialResynchronization() will at least try to use PSYNC
+     * to start a full resynchronization so that we get the master run id
+     * and the global offset, to try a partial resync at the next
+     * reconnection attempt. */
+    if (server.repl_state == REDIS_REPL_SEND_PSYNC) {
+        if (slaveTryPartialResynchronization(fd,0) == PSYNC_WRITE_ERROR) {
+            err = sdsnew("Write error sending the PSYNC command.");
+            goto write_error;
+        }
+        server.repl_state = REDIS_REPL_RECEIVE_PSYNC;
+        return;
+    }
+
+    /* If reached this point, we should be in REDIS_REPL_RECEIVE_PSYNC. */
+    if (server.repl_state != REDIS_REPL_RECEIVE_PSYNC) {
+        redisLog(REDIS_WARNING,"syncWithMaster(): state machine error, "
+                             "state should be RECEIVE_PSYNC but is %d",
+                             server.repl_state);
+        goto error;
+    }
+
+    psync_result = slaveTryPartialResynchronization(fd,1);
+    if (psync_result == PSYNC_WAIT_REPLY) return; /* Try again later... */
+
+    /* Note: if PSYNC does not return WAIT_REPLY, it will take care of
+     * uninstalling the read handler from the file descriptor. */
+
+    if (psync_result == PSYNC_CONTINUE) {
+        redisLog(REDIS_NOTICE, "MASTER <-> REPLICA sync: Master accepted a Partial Resynchronization.");
+        return;
+    }
+
+    if (psync_result != PSYNC_FULLRESYNC) {
+        redisLog(REDIS_WARNING,"MASTER <-> REPLICA sync: PSYNC failed.");
+        goto error;
+    }
+
+    /* Prepare a suitable temp file for bulk transfer, unless the payload
+     * is loaded straight from the socket. */
+    // 直接从套接字载入时不需要临时文件
+    while(server.repl_diskless_load == REPL_DISKLESS_LOAD_DISABLED &&
+          maxtries--)
+    {
+        snprintf(tmpfile,256,
+            "temp-%d.%ld.rdb",(int)time(NULL),(long int)getpid());
+        dfd = open(tmpfile,O_CREAT|O_WRONLY|O_EXCL,0644);
+        if (dfd != -1) break;
+        sleep(1);
+    }
+    if (server.repl_diskless_load == REPL_DISKLESS_LOAD_DISABLED &&
+        dfd == -1)
+    {
+        redisLog(REDIS_WARNING,"Opening the temp file needed for MASTER <-> REPLICA synchronization: %s",strerror(errno));
+        goto error;
+    }
+
+    /* Setup the non blocking download of the bulk file. */
+    if (aeCreateFileEvent(server.el,fd, AE_READABLE,readSyncBulkPayload,NULL)
+            == AE_ERR)
+    {
+        redisLog(REDIS_WARNING,
+            "Can't create readable event for SYNC: %s (fd=%d)",
+            strerror(errno),fd);
+        goto error;
+    }
+
+    server.repl_state = REDIS_REPL_TRANSFER;
+    server.repl_transfer_size = -1;
+    server.repl_transfer_read = 0;
+    server.repl_transfer_fd = dfd;
+    server.repl_transfer_lastio = time(NULL);
+    server.repl_transfer_tmpfile = (dfd != -1) ? zstrdup(tmpfile) : NULL;
+    return;
+
+error:
+    aeDeleteFileEvent(server.el,fd,AE_READABLE|AE_WRITABLE);
+    if (dfd != -1) close(dfd);
+    close(fd);
+    server.repl_transfer_s = -1;
+    server.repl_state = REDIS_REPL_CONNECT;
+    return;
+
+write_error: /* Handle sendSynchronousCommand(SYNC_CMD_WRITE) errors. */
+    redisLog(REDIS_WARNING,"Sending command to master in replication handshake: %s", err);
+    sdsfree(err);
+    goto error;
+}
+
+/*
+ * 以非阻塞的方式连接主服务器
+ */
+int connectWithMaster(void) {
+    int fd;
+
+    fd = anetTcpNonBlockConnect(NULL,server.masterhost,server.masterport);
+    if (fd == -1) {
+        redisLog(REDIS_WARNING,"Unable to connect to MASTER: %s",
+            strerror(errno));
+        return REDIS_ERR;
+    }
+
+    if (aeCreateFileEvent(server.el,fd,AE_READABLE|AE_WRITABLE,syncWithMaster,NULL) ==
+            AE_ERR)
+    {
+        close(fd);
+        redisLog(REDIS_WARNING,"Can't create readable event for SYNC");
+        return REDIS_ERR;
+    }
+
+    server.repl_transfer_lastio = time(NULL);
+    server.repl_transfer_s = fd;
+    server.repl_state = REDIS_REPL_CONNECTING;
+    return REDIS_OK;
+}
+
+/* This function can be called when a non blocking connection is currently
+ * in progress to undo it.
+ *
+ * 撤销正在进行的非阻塞连接 */
+static void undoConnectWithMaster(void) {
+    int fd = server.repl_transfer_s;
+
+    aeDeleteFileEvent(server.el,fd,AE_READABLE|AE_WRITABLE);
+    close(fd);
+    server.repl_transfer_s = -1;
+}
+
+// 从服务器是否处于握手阶段
+static int slaveIsInHandshakeState(void) {
+    return server.repl_state >= REDIS_REPL_RECEIVE_PONG &&
+           server.repl_state <= REDIS_REPL_RECEIVE_PSYNC;
+}
+
+/* This function aborts a non blocking replication attempt if there is one
+ * in progress, by canceling the non-blocking connect attempt or
+ * the initial bulk transfer.
+ *
+ * If there was a replication handshake in progress 1 is returned and
+ * the replication state (server.repl_state) set to REDIS_REPL_CONNECT.
+ *
+ * Otherwise zero is returned and no operation is perforemd at all.
+ *
+ * 取消正在进行的握手或者 RDB 传输，取消了返回 1 ，否则返回 0 。 */
+int cancelReplicationHandshake(void) {
+    if (server.repl_state == REDIS_REPL_TRANSFER) {
+        replicationAbortSyncTransfer();
+    } else if (server.repl_state == REDIS_REPL_CONNECTING ||
+               slaveIsInHandshakeState())
+    {
+        undoConnectWithMaster();
+    } else {
+        return 0;
+    }
+    server.repl_state = REDIS_REPL_CONNECT;
+    return 1;
+}
+
+// 断开所有从服务器，强制它们重新同步
+static void disconnectSlaves(void) {
+    while (listLength(server.slaves)) {
+        listNode *ln = listFirst(server.slaves);
+        freeClient((redisClient*)ln->value);
+    }
+}
+
+/* Set replication to the specified master address and port.
+ *
+ * 将服务器设置为指定地址的从服务器 */
+void replicationSetMaster(char *ip, int port) {
+    sdsfree(server.masterhost);
+    server.masterhost = sdsnew(ip);
+    server.masterport = port;
+    if (server.master) freeClient(server.master);
+    disconnectSlaves(); /* Force our slaves to resync with us as well. */
+    replicationDiscardCachedMaster(); /* Don't try a PSYNC. */
+    freeReplicationBacklog(); /* Don't allow our chained slaves to PSYNC. */
+    cancelReplicationHandshake();
+    server.repl_state = REDIS_REPL_CONNECT;
+    server.master_repl_offset = 0;
+    server.repl_down_since = 0;
+}
+
+/* Cancel replication, setting the instance as a master itself.
+ *
+ * 取消复制，将服务器设置为主服务器 */
+void replicationUnsetMaster(void) {
+    if (server.masterhost == NULL) return; /* Nothing to do. */
+    sdsfree(server.masterhost);
+    server.masterhost = NULL;
+    if (server.master) freeClient(server.master);
+    replicationDiscardCachedMaster();
+    cancelReplicationHandshake();
+    server.repl_state = REDIS_REPL_NONE;
+    /* From now on we generate the stream ourselves: the first command
+     * sent to our slaves must select its database explicitly. */
+    server.slaveseldb = -1;
+}
+
+/* REPLICAOF <host> <port> | REPLICAOF NO ONE */
+void replicaofCommand(redisClient *c) {
+    /* Replicas of a cluster node would need the cluster to know about
+     * them, which is not supported. */
+    // 集群模式下不支持复制
+    if (server.cluster_enabled) {
+        addReplyError(c,"REPLICAOF not allowed in cluster mode.");
+        return;
+    }
+
+    /* The special host/port combination "NO" "ONE" turns the instance
+     * into a master. Otherwise the new master address is set. */
+    if (!strcasecmp(c->argv[1]->ptr,"no") &&
+        !strcasecmp(c->argv[2]->ptr,"one")) {
+        if (server.masterhost) {
+            replicationUnsetMaster();
+            redisLog(REDIS_NOTICE,"MASTER MODE enabled (user request)");
+        }
+    } else {
+        long long port;
+
+        if ((getLongLongFromObjectOrReply(c, c->argv[2], &port, NULL) != REDIS_OK))
+            return;
+        if (port <= 0 || port > 65535) {
+            addReplyError(c,"Invalid master port");
+            return;
+        }
+
+        /* Check if we are already attached to the specified master */
+        if (server.masterhost && !strcasecmp(server.masterhost,c->argv[1]->ptr)
+            && server.masterport == port) {
+            redisLog(REDIS_NOTICE,"REPLICAOF would result into synchronization with the master we are already connected with. No operation performed.");
+            addReplySds(c,sdsnew("+OK Already connected to specified master\r\n"));
+            return;
+        }
+        /* There was no previous master or the user specified a different one,
+         * we can continue. */
+        replicationSetMaster(c->argv[1]->ptr, port);
+        redisLog(REDIS_NOTICE,"REPLICAOF %s:%d enabled (user request)",
+            server.masterhost, server.masterport);
+    }
+    addReply(c,shared.ok);
+}
+
+/* Send a REPLCONF ACK command to the master to inform it about the current
+ * processed offset. If we are not connected with a master, the command has
+ * no effects.
+ *
+ * 向主服务器发送 REPLCONF ACK <offset> */
+void replicationSendAck(void) {
+    redisClient *c = server.master;
+
+    if (c != NULL) {
+        char offset[32];
+
+        ll2string(offset,sizeof(offset),c->reploff);
+        c->flags |= REDIS_MASTER_FORCE_REPLY;
+        addReplyMultiBulkLen(c,3);
+        addReplyBulkCString(c,"REPLCONF");
+        addReplyBulkCString(c,"ACK");
+        addReplyBulkCString(c,offset);
+        c->flags &= ~REDIS_MASTER_FORCE_REPLY;
+    }
+}
+
+/* ---------------------- MASTER CACHING FOR PSYNC -------------------------- */
+
+/* In order to implement partial synchronization we need to be able to cache
+ * our master's client structure after a transient disconnection.
+ * It is cached into server.cached_master and flushed away using the following
+ * functions.
+ *
+ * 为了实现部分重同步，连接断开之后主服务器的客户端结构被缓存在
+ * server.cached_master 中，它保存着 runid 和复制偏移量。 */
+
+/* This function is called by freeClient() in order to cache the master
+ * client structure instead of destryoing it. freeClient() will return
+ * ASAP after this function returns, so every action needed to avoid problems
+ * with a client that is really "suspended" has to be done by this function.
+ *
+ * The other functions that will deal with the cached master are:
+ *
+ * replicationDiscardCachedMaster() that will make sure to kill the client
+ * as for some reason we don't want to use it in the future.
+ *
+ * replicationResurrectCachedMaster() that is used after a successful PSYNC
+ * handshake in order to reactivate the cached master.
+ */
+void replicationCacheMaster(redisClient *c) {
+    listNode *ln;
+
+    redisAssert(server.master != NULL && server.cached_master == NULL);
+    redisLog(REDIS_NOTICE,"Caching the disconnected master state.");
+
+    /* Remove from the list of clients, we don't want this client to be
+     * listed by CLIENT LIST or processed in any way by batch operations. */
+    ln = listSearchKey(server.clients,c);
+    redisAssert(ln != NULL);
+    listDelNode(server.clients,ln);
+
+    /* Save the master. Server.master will be set to null later by
+     * replicationHandleMasterDisconnection(). */
+    server.cached_master = server.master;
+
+    /* Remove the event handlers and close the socket. We'll later reuse
+     * the socket of the new connection with the master during PSYNC. */
+    aeDeleteFileEvent(server.el,c->fd,AE_READABLE);
+    aeDeleteFileEvent(server.el,c->fd,AE_WRITABLE);
+    close(c->fd);
+
+    /* Set fd to -1 so that we can safely call freeClient(c) later. */
+    c->fd = -1;
+
+    /* Pending ACKs are meaningless for the next connection. */
+    // 丢弃还没发出的 ACK
+    c->bufpos = 0;
+    c->sentlen = 0;
+    while (listLength(c->reply))
+        listDelNode(c->reply,listFirst(c->reply));
+    c->reply_bytes = 0;
+
+    /* Caching the master happens instead of the actual freeClient() call,
+     * so make sure to adjust the replication state as needed. */
+    replicationHandleMasterDisconnection();
+}
+
+/* Free a cached master, called when there are no longer the conditions for
+ * a partial resync on reconnection.
+ *
+ * 丢弃缓存的主服务器 */
+void replicationDiscardCachedMaster(void) {
+    if (server.cached_master == NULL) return;
+
+    redisLog(REDIS_NOTICE,"Discarding previously cached master state.");
+    server.cached_master->flags &= ~REDIS_MASTER;
+    freeClient(server.cached_master);
+    server.cached_master = NULL;
+}
+
+/* Turn the cached master into the current master, using the file descriptor
+ * passed as argument as the socket for the new master.
+ *
+ * This funciton is called when successfully setup a partial resynchronization
+ * so the stream of data that we'll receive will start from were this
+ * master left.
+ *
+ * 部分重同步成功之后，用新的套接字恢复缓存的主服务器 */
+void replicationResurrectCachedMaster(int newfd) {
+    server.master = server.cached_master;
+    server.cached_master = NULL;
+    server.master->fd = newfd;
+    server.master->flags &= ~REDIS_CLOSE_ASAP;
+    server.master->lastinteraction = time(NULL);
+    server.repl_state = REDIS_REPL_CONNECTED;
+
+    /* Re-add to the list of clients. */
+    listAddNodeTail(server.clients,server.master);
+    if (aeCreateFileEvent(server.el, newfd, AE_READABLE,
+                          readQueryFromClient, server.master)) {
+        redisLog(REDIS_WARNING,"Error resurrecting the cached master, impossible to add the readable handler: %s", strerror(errno));
+        freeClientAsync(server.master); /* Close ASAP. */
+    }
+}
+
+/* Update the replication state after the link with the master went down.
+ *
+ * 与主服务器的连接断开之后更新复制状态 */
+void replicationHandleMasterDisconnection(void) {
+    server.master = NULL;
+    server.repl_state = REDIS_REPL_CONNECT;
+    server.repl_down_since = time(NULL);
+    /* We lost connection with our master, don't disconnect slaves yet,
+     * maybe we'll be able to PSYNC with our master later. We'll disconnect
+     * the slaves only if we'll have to do a full resync with our master. */
+}
+
+/* --------------------------- REPLICATION CRON  ---------------------------- */
+
+/* Replication cron funciton, called 1 time per second.
+ *
+ * 复制的定时函数，每秒调用一次 */
+void replicationCron(void) {
+    static long long replication_cron_loops = 0;
+    time_t now = time(NULL);
+    listIter li;
+    listNode *ln;
+    int waiting = 0;
+
+    /* Non blocking connection timeout? */
+    if (server.masterhost &&
+        (server.repl_state == REDIS_REPL_CONNECTING ||
+         slaveIsInHandshakeState()) &&
+         (now - server.repl_transfer_lastio) > server.repl_timeout)
+    {
+        redisLog(REDIS_WARNING,"Timeout connecting to the MASTER...");
+        cancelReplicationHandshake();
+    }
+
+    /* Bulk transfer I/O timeout? */
+    if (server.masterhost && server.repl_state == REDIS_REPL_TRANSFER &&
+        (now - server.repl_transfer_lastio) > server.repl_timeout)
+    {
+        redisLog(REDIS_WARNING,"Timeout receiving bulk data from MASTER... If the problem persists try to set the 'repl-timeout' parameter in redis.conf to a larger value.");
+        replicationAbortSyncTransfer();
+    }
+
+    /* Timed out master when we are an already connected slave? */
+    if (server.masterhost && server.repl_state == REDIS_REPL_CONNECTED &&
+        (now - server.master->lastinteraction) > server.repl_timeout)
+    {
+        redisLog(REDIS_WARNING,"MASTER timeout: no data nor PING received...");
+        freeClient(server.master);
+    }
+
+    /* Check if we should connect to a MASTER */
+    if (server.repl_state == REDIS_REPL_CONNECT) {
+        redisLog(REDIS_NOTICE,"Connecting to MASTER %s:%d",
+            server.masterhost, server.masterport);
+        if (connectWithMaster() == REDIS_OK) {
+            redisLog(REDIS_NOTICE,"MASTER <-> REPLICA sync started");
+        }
+    }
+
+    /* Send ACK to master from time to time. */
+    if (server.masterhost && server.master) replicationSendAck();
+
+    /* If we have attached slaves, PING them from time to time.
+     * So slaves can implement an explicit timeout to masters, and will
+     * be able to detect a link disconnection even if the TCP connection
+     * will not actually go down. */
+    if ((replication_cron_loops % server.repl_ping_slave_period) == 0 &&
+        listLength(server.slaves))
+    {
+        robj *ping_argv[1];
+
+        ping_argv[0] = shared.ping;
+        replicationFeedSlaves(server.slaves, server.slaveseldb, ping_argv, 1);
+    }
+
+    /* Second, send a newline to all the slaves in pre-synchronization
+     * stage, that is, slaves waiting for the master to create the RDB file.
+     * The newline will be ignored by the slave but will refresh the
+     * last-io timer preventing a timeout. */
+    listRewind(server.slaves,&li);
+    while((ln = listNext(&li))) {
+        redisClient *slave = ln->value;
+
+        if (slave->replstate == REDIS_REPL_WAIT_BGSAVE_START) {
+            if (write(slave->fd, "\n", 1) == -1) {
+                /* Don't worry, it's just a ping. */
+            }
+            waiting++;
+        }
+    }
+
+    /* Disconnect timedout slaves. */
+    listRewind(server.slaves,&li);
+    while((ln = listNext(&li))) {
+        redisClient *slave = ln->value;
+
+        if (slave->replstate != REDIS_REPL_ONLINE) continue;
+        if ((now - slave->repl_ack_time) > server.repl_timeout) {
+            redisLog(REDIS_WARNING, "Disconnecting timedout replica: %s",
+                replicationGetSlaveName(slave));
+            freeClient(slave);
+        }
+    }
+
+    /* Start the transfer for slaves that arrived while another child was
+     * active. */
+    // 为等待中的从服务器启动全量同步
+    if (waiting && !hasActiveChildProcess()) startBgsaveForReplication();
+
+    replication_cron_loops++;
+}
+
+/* Append the "# Replication" section of INFO to 'info'.
+ *
+ * 生成 INFO 的复制部分 */
+sds genReplicationInfoString(sds info) {
+    time_t now = time(NULL);
+
+    info = sdscatprintf(info,
+        "# Replication\r\n"
+        "role:%s\r\n",
+        server.masterhost == NULL ? "master" : "slave");
+    if (server.masterhost) {
+        long long slave_repl_offset = 1;
+
+        if (server.master)
+            slave_repl_offset = server.master->reploff;
+        else if (server.cached_master)
+            slave_repl_offset = server.cached_master->reploff;
+
+        info = sdscatprintf(info,
+            "master_host:%s\r\n"
+            "master_port:%d\r\n"
+            "master_link_status:%s\r\n"
+            "master_last_io_seconds_ago:%d\r\n"
+            "master_sync_in_progress:%d\r\n"
+            "slave_repl_offset:%lld\r\n"
+            ,server.masterhost,
+            server.masterport,
+            (server.repl_state == REDIS_REPL_CONNECTED) ?
+                "up" : "down",
+            server.master ?
+            ((int)(now-server.master->lastinteraction)) : -1,
+            server.repl_state == REDIS_REPL_TRANSFER,
+            slave_repl_offset
+        );
+
+        if (server.repl_state == REDIS_REPL_TRANSFER) {
+            info = sdscatprintf(info,
+                "master_sync_read_bytes:%lld\r\n"
+                "master_sync_last_io_seconds_ago:%d\r\n"
+                , (long long) server.repl_transfer_read,
+                (int)(now-server.repl_transfer_lastio)
+            );
+        }
+
+        if (server.repl_state != REDIS_REPL_CONNECTED) {
+            info = sdscatprintf(info,
+                "master_link_down_since_seconds:%ld\r\n",
+                server.repl_down_since ?
+                (long)(now-server.repl_down_since) : -1);
+        }
+        info = sdscatprintf(info,"slave_read_only:%d\r\n",
+            server.repl_slave_ro);
+    }
+
+    info = sdscatprintf(info,
+        "connected_slaves:%lu\r\n",
+        listLength(server.slaves));
+
+    if (listLength(server.slaves)) {
+        int slaveid = 0;
+        listNode *ln;
+        listIter li;
+
+        listRewind(server.slaves,&li);
+        while((ln = listNext(&li))) {
+            redisClient *slave = listNodeValue(ln);
+            char *state = NULL;
+            char ip[REDIS_IP_STR_LEN];
+            long lag = 0;
+
+            if (anetPeerToString(slave->fd,ip,sizeof(ip),NULL) == -1) continue;
+            switch(slave->replstate) {
+            case REDIS_REPL_WAIT_BGSAVE_START:
+            case REDIS_REPL_WAIT_BGSAVE_END:
+                state = "wait_bgsave";
+                break;
+            case REDIS_REPL_ONLINE:
+                state = "online";
+                break;
+            }
+            if (state == NULL) continue;
+            if (slave->replstate == REDIS_REPL_ONLINE)
+                lag = time(NULL) - slave->repl_ack_time;
+
+            info = sdscatprintf(info,
+                "slave%d:ip=%s,port=%d,state=%s,"
+                "offset=%lld,lag=%ld\r\n",
+                slaveid,ip,slave->slave_listening_port,state,
+                slave->repl_ack_off, lag);
+            slaveid++;
+        }
+    }
+    info = sdscatprintf(info,
+        "master_repl_offset:%lld\r\n"
+        "repl_backlog_active:%d\r\n"
+        "repl_backlog_size:%lld\r\n"
+        "repl_backlog_first_byte_offset:%lld\r\n"
+        "repl_backlog_histlen:%lld\r\n",
+        server.master_repl_offset,
+        server.repl_backlog != NULL,
+        server.repl_backlog_size,
+        server.repl_backlog_off,
+        server.repl_backlog_histlen);
+    return info;
+}
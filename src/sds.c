@@ -1,38 +1,120 @@
 #include "sds.h"
 #include "zmalloc.h"
 #include "redisassert.h"
+#include "util.h"
 #include <stdarg.h>
+#include <limits.h>
+#include <string.h>
+#include <ctype.h>
 
-sds sdsnewlen(const void *init, size_t initlen) {
+/*
+ * 返回给定类型的头部的大小
+ */
+static inline int sdsHdrSize(char type) {
+    switch(type&SDS_TYPE_MASK) {
+        case SDS_TYPE_8:
+            return sizeof(struct sdshdr8);
+        case SDS_TYPE_16:
+            return sizeof(struct sdshdr16);
+        case SDS_TYPE_32:
+            return sizeof(struct sdshdr32);
+        case SDS_TYPE_64:
+            return sizeof(struct sdshdr64);
+    }
+    return 0;
+}
 
-    struct sdshdr *sh;
+/*
+ * 返回能保存长度为 string_size 的字符串的最小头部类型
+ */
+static inline char sdsReqType(size_t string_size) {
+    if (string_size < 1<<8)
+        return SDS_TYPE_8;
+    if (string_size < 1<<16)
+        return SDS_TYPE_16;
+#if (LONG_MAX == LLONG_MAX)
+    if (string_size < 1ll<<32)
+        return SDS_TYPE_32;
+    return SDS_TYPE_64;
+#else
+    return SDS_TYPE_32;
+#endif
+}
+
+/* Create a new sds string with the content specified by the 'init' pointer
+ * and 'initlen'.
+ * If NULL is used for 'init' the string is initialized with zero bytes.
+ *
+ * 根据给定的初始化字符串 init 和字符串长度 initlen
+ * 创建一个新的 sds
+ *
+ * T = O(N)
+ */
+sds sdsnewlen(const void *init, size_t initlen) {
+    void *sh;
+    sds s;
+    // 根据长度选择头部类型
+    char type = sdsReqType(initlen);
+    int hdrlen = sdsHdrSize(type);
+    unsigned char *fp; /* flags pointer. */
 
     // 根据是否有初始化内容，选择适当的内存分配方式
     // T = O(N)
     if (init) {
         // zmalloc 不初始化所分配的内存
-        sh = zmalloc(sizeof(struct sdshdr)+initlen+1);
+        sh = zmalloc(hdrlen+initlen+1);
     } else {
         // zcalloc 将分配的内存全部初始化为 0
-        sh = zcalloc(sizeof(struct sdshdr)+initlen+1);
+        sh = zcalloc(hdrlen+initlen+1);
     }
 
     // 内存分配失败，返回
     if (sh == NULL) return NULL;
 
-    // 设置初始化长度
-    sh->len = initlen;
-    // 新 sds 不预留任何空间
-    sh->free = 0;
-    // 如果有指定初始化内容，将它们复制到 sdshdr 的 buf 中
+    s = (char*)sh+hdrlen;
+    fp = ((unsigned char*)s)-1;
+
+    // 设置初始化长度，新 sds 不预留任何空间
+    switch(type) {
+        case SDS_TYPE_8: {
+            SDS_HDR_VAR(8,s);
+            sh->len = initlen;
+            sh->alloc = initlen;
+            *fp = type;
+            break;
+        }
+        case SDS_TYPE_16: {
+            SDS_HDR_VAR(16,s);
+            sh->len = initlen;
+            sh->alloc = initlen;
+            *fp = type;
+            break;
+        }
+        case SDS_TYPE_32: {
+            SDS_HDR_VAR(32,s);
+            sh->len = initlen;
+            sh->alloc = initlen;
+            *fp = type;
+            break;
+        }
+        case SDS_TYPE_64: {
+            SDS_HDR_VAR(64,s);
+            sh->len = initlen;
+            sh->alloc = initlen;
+            *fp = type;
+            break;
+        }
+    }
+
+    // 如果有指定初始化内容，将它们复制到 buf 中
     // T = O(N)
     if (initlen && init)
-        memcpy(sh->buf, init, initlen);
+        memcpy(s, init, initlen);
     // 以 \0 结尾
-    sh->buf[initlen] = '\0';
+    s[initlen] = '\0';
 
-    // 返回 buf 部分，而不是整个 sdshdr
-    return (char*)sh->buf;
+    // 返回 buf 部分，而不是整个头部
+    return s;
 }
 
 /*
@@ -52,28 +134,58 @@ sds sdsdup(const sds s) {
 
 void sdsfree(sds s) {
     if (s == NULL) return;
-    zfree(s-sizeof(struct sdshdr));
+    zfree((char*)s-sdsHdrSize(s[-1]));
 }
 
 sds sdsempty(void) {
     return sdsnewlen("",0);
 }
 
-sds sdsMakeRoomFor(sds s, size_t addlen) {
+/* Modify an sds string in-place to make it empty (zero length).
+ * However all the existing buffer is not discarded but set as free space
+ * so that next append operations will not require allocations up to the
+ * number of bytes previously available.
+ *
+ * 在不释放 SDS 的字符串空间的情况下，
+ * 重置 SDS 所保存的字符串为空字符串。
+ *
+ * 复杂度
+ *  T = O(1)
+ */
+void sdsclear(sds s) {
+    sdssetlen(s, 0);
+    s[0] = '\0';
+}
 
-    struct sdshdr *sh, *newsh;
+/* Enlarge the free space at the end of the sds string so that the caller
+ * is sure that after calling this function can overwrite up to addlen
+ * bytes after the end of the string, plus one more byte for nul term.
+ *
+ * 对 sds 中 buf 的长度进行扩展，确保在函数执行之后，
+ * buf 至少会有 addlen + 1 长度的空余空间
+ * （额外的 1 字节是为 \0 准备的）
+ *
+ * If the new length needs a bigger header type, the string is moved to a
+ * new allocation with the new header.
+ *
+ * T = O(N)
+ */
+sds sdsMakeRoomFor(sds s, size_t addlen) {
+    void *sh, *newsh;
 
     // 获取 s 目前的空余空间长度
-    size_t free = sdsavail(s);
+    size_t avail = sdsavail(s);
 
     size_t len, newlen;
+    char type, oldtype = s[-1] & SDS_TYPE_MASK;
+    int hdrlen;
 
     // s 目前的空余空间已经足够，无须再进行扩展，直接返回
-    if (free >= addlen) return s;
+    if (avail >= addlen) return s;
 
     // 获取 s 目前已占用空间的长度
     len = sdslen(s);
-    sh = (void*) (s-(sizeof(struct sdshdr)));
+    sh = (char*)s-sdsHdrSize(oldtype);
 
     // s 最少需要的长度
     newlen = (len+addlen);
@@ -86,36 +198,145 @@ sds sdsMakeRoomFor(sds s, size_t addlen) {
     else
         // 否则，分配长度为目前长度加上 SDS_MAX_PREALLOC
         newlen += SDS_MAX_PREALLOC;
-    // T = O(N)
-    newsh = zrealloc(sh, sizeof(struct sdshdr)+newlen+1);
 
-    // 内存不足，分配失败，返回
-    if (newsh == NULL) return NULL;
+    type = sdsReqType(newlen);
+    hdrlen = sdsHdrSize(type);
+    if (oldtype==type) {
+        // 头部类型不变，直接重分配
+        // T = O(N)
+        newsh = zrealloc(sh, hdrlen+newlen+1);
+        // 内存不足，分配失败，返回
+        if (newsh == NULL) return NULL;
+        s = (char*)newsh+hdrlen;
+    } else {
+        /* Since the header size changes, need to move the string forward,
+         * and can't use realloc */
+        // 头部类型改变，字符串的位置也要改变，不能使用 realloc
+        newsh = zmalloc(hdrlen+newlen+1);
+        if (newsh == NULL) return NULL;
+        memcpy((char*)newsh+hdrlen, s, len+1);
+        zfree(sh);
+        s = (char*)newsh+hdrlen;
+        s[-1] = type;
+        sdssetlen(s, len);
+    }
 
-    // 更新 sds 的空余长度
-    newsh->free = newlen - len;
+    // 更新 sds 的总长度
+    sdssetalloc(s, newlen);
 
     // 返回 sds
-    return newsh->buf;
+    return s;
 }
 
-void sdsIncrLen(sds s, int incr) {
-    struct sdshdr *sh = (void*) (s-(sizeof(struct sdshdr)));
+/* Reallocate the sds string so that it has no free space at the end. The
+ * contained string remains not altered, but next concatenation operations
+ * will require a reallocation.
+ *
+ * 回收 sds 中的空闲空间，
+ * 回收不会对 sds 中保存的字符串内容做任何修改。
+ *
+ * After the call, the passed sds string is no longer valid and all the
+ * references must be substituted with the new pointer returned by the call.
+ *
+ * T = O(N)
+ */
+sds sdsRemoveFreeSpace(sds s) {
+    void *sh, *newsh;
+    char type, oldtype = s[-1] & SDS_TYPE_MASK;
+    int hdrlen, oldhdrlen = sdsHdrSize(oldtype);
+    size_t len = sdslen(s);
 
-    // 确保 sds 空间足够
-    
-    assert(sh->free >= incr);
+    sh = (char*)s-oldhdrlen;
 
-    // 更新属性
-    sh->len += incr;
-    sh->free -= incr;
+    // 选择能保存当前长度的最小头部
+    type = sdsReqType(len);
+    hdrlen = sdsHdrSize(type);
+    if (oldtype==type) {
+        // 进行内存重分配，让 buf 的长度仅仅足够保存字符串内容
+        // T = O(N)
+        newsh = zrealloc(sh, oldhdrlen+len+1);
+        if (newsh == NULL) return NULL;
+        s = (char*)newsh+oldhdrlen;
+    } else {
+        newsh = zmalloc(hdrlen+len+1);
+        if (newsh == NULL) return NULL;
+        memcpy((char*)newsh+hdrlen, s, len+1);
+        zfree(sh);
+        s = (char*)newsh+hdrlen;
+        s[-1] = type;
+        sdssetlen(s, len);
+    }
+
+    // 空余空间为 0
+    sdssetalloc(s, len);
+    return s;
+}
+
+/* Return the total size of the allocation of the specifed sds string,
+ * including:
+ * 1) The sds header before the pointer.
+ * 2) The string.
+ * 3) The free buffer at the end if any.
+ * 4) The implicit null term.
+ *
+ * 返回给定 sds 分配的内存字节数
+ *
+ * 复杂度
+ *  T = O(1)
+ */
+size_t sdsAllocSize(sds s) {
+    size_t alloc = sdsalloc(s);
 
-    // 这个 assert 其实可以忽略
-    // 因为前一个 assert 已经确保 sh->free - incr >= 0 了
-    assert(sh->free >= 0);
+    return sdsHdrSize(s[-1])+alloc+1;
+}
+
+/* Increment the sds length and decrements the left free space at the
+ * end of the string according to 'incr'. Also set the null term
+ * in the new end of the string.
+ *
+ * 根据 incr 参数，增加 sds 的长度，缩减空余空间，
+ * 并将 \0 放到新字符串的尾端
+ *
+ * Note: it is possible to use a negative increment in order to
+ * right-trim the string.
+ *
+ * T = O(1)
+ */
+void sdsIncrLen(sds s, ssize_t incr) {
+    unsigned char flags = s[-1];
+    size_t len;
+
+    // 确保 sds 空间足够
+    switch(flags&SDS_TYPE_MASK) {
+        case SDS_TYPE_8: {
+            SDS_HDR_VAR(8,s);
+            assert((incr >= 0 && sh->alloc-sh->len >= incr) || (incr < 0 && sh->len >= (unsigned int)(-incr)));
+            len = (sh->len += incr);
+            break;
+        }
+        case SDS_TYPE_16: {
+            SDS_HDR_VAR(16,s);
+            assert((incr >= 0 && sh->alloc-sh->len >= incr) || (incr < 0 && sh->len >= (unsigned int)(-incr)));
+            len = (sh->len += incr);
+            break;
+        }
+        case SDS_TYPE_32: {
+            SDS_HDR_VAR(32,s);
+            assert((incr >= 0 && sh->alloc-sh->len >= (unsigned int)incr) || (incr < 0 && sh->len >= (unsigned int)(-incr)));
+            len = (sh->len += incr);
+            break;
+        }
+        case SDS_TYPE_64: {
+            SDS_HDR_VAR(64,s);
+            assert((incr >= 0 && sh->alloc-sh->len >= (uint64_t)incr) || (incr < 0 && sh->len >= (uint64_t)(-incr)));
+            len = (sh->len += incr);
+            break;
+        }
+        default: len = 0; /* Just to avoid compilation warnings. */
+    }
 
     // 放置新的结尾符号
-    s[sh->len] = '\0';
+    s[len] = '\0';
 }
 
 /* Create a new sds string starting from a null termined C string. */
@@ -124,6 +345,23 @@ sds sdsnew(const char *init) {
     return sdsnewlen(init, initlen);
 }
 
+/* Size of a buffer able to hold any long long or unsigned long long
+ * as a string, nul term included. */
+#define SDS_LLSTR_SIZE 21
+
+/* Create an sds string from a long long value. It is much faster than:
+ *
+ * sdscatprintf(sdsempty(),"%lld\n", value);
+ *
+ * 根据输入的 long long 值 value ，创建一个 SDS
+ */
+sds sdsfromlonglong(long long value) {
+    char buf[SDS_LLSTR_SIZE];
+    int len = ll2string(buf,sizeof(buf),value);
+
+    return sdsnewlen(buf,len);
+}
+
 sds sdscatprintf(sds s, const char *fmt, ...) {
     va_list ap;
     char *t;
@@ -176,9 +414,6 @@ sds sdscat(sds s, const char *t) {
 }
 
 sds sdscatlen(sds s, const void *t, size_t len) {
-    
-    struct sdshdr *sh;
-    
     // 原有字符串长度
     size_t curlen = sdslen(s);
 
@@ -191,12 +426,10 @@ sds sdscatlen(sds s, const void *t, size_t len) {
 
     // 复制 t 中的内容到字符串后部
     // T = O(N)
-    sh = (void*) (s-(sizeof(struct sdshdr)));
     memcpy(s+curlen, t, len);
 
     // 更新属性
-    sh->len = curlen+len;
-    sh->free = sh->free-len;
+    sdssetlen(s, curlen+len);
 
     // 添加新结尾符号
     s[curlen+len] = '\0';
@@ -205,6 +438,125 @@ sds sdscatlen(sds s, const void *t, size_t len) {
     return s;
 }
 
+/* This function is similar to sdscatprintf, but much faster as it does
+ * not rely on sprintf() family functions implemented by the libc that
+ * are often very slow. Moreover directly handling the sds string as
+ * new data is concatenated provides a performance improvement.
+ *
+ * 和 sdscatprintf 类似，但不依赖 libc 的 sprintf 系列函数，
+ * 整数使用 ll2string()/ull2string() 直接写入 sds 的空余空间，
+ * 不需要临时缓冲区，也不需要在缓冲区不够时重试。
+ *
+ * However this function only handles an incompatible subset of printf-alike
+ * format specifiers:
+ *
+ * %s - C String
+ * %S - SDS string
+ * %i - signed int
+ * %I - 64 bit signed integer (long long, int64_t)
+ * %u - unsigned int
+ * %U - 64 bit unsigned integer (unsigned long long, uint64_t)
+ * %% - Verbatim "%" character.
+ */
+sds sdscatfmt(sds s, char const *fmt, ...) {
+    size_t initlen = sdslen(s);
+    const char *f = fmt;
+    long i;
+    va_list ap;
+
+    /* To avoid continuous reallocations, let's start with a buffer that
+     * can hold at least two times the format string itself. It's not the
+     * best heuristic but seems to work in practice. */
+    s = sdsMakeRoomFor(s, strlen(fmt)*2);
+    va_start(ap,fmt);
+    f = fmt;    /* Next format specifier byte to process. */
+    i = initlen; /* Position of the next byte to write to dest str. */
+    while(*f) {
+        char next, *str;
+        size_t l;
+        long long num;
+        unsigned long long unum;
+
+        /* Make sure there is always space for at least 1 char. */
+        if (sdsavail(s)==0) {
+            s = sdsMakeRoomFor(s,1);
+        }
+
+        switch(*f) {
+        case '%':
+            next = *(f+1);
+            f++;
+            switch(next) {
+            case 's':
+            case 'S':
+                str = va_arg(ap,char*);
+                l = (next == 's') ? strlen(str) : sdslen(str);
+                if (sdsavail(s) < l) {
+                    s = sdsMakeRoomFor(s,l);
+                }
+                memcpy(s+i,str,l);
+                sdsinclen(s,l);
+                i += l;
+                break;
+            case 'i':
+            case 'I':
+                if (next == 'i')
+                    num = va_arg(ap,int);
+                else
+                    num = va_arg(ap,long long);
+                /* Reserve room for the longest number and format it in
+                 * place, the nul term is overwritten by what follows. */
+                // 预留最长整数所需的空间，直接在 sds 的空余空间中格式化
+                if (sdsavail(s) < SDS_LLSTR_SIZE) {
+                    s = sdsMakeRoomFor(s,SDS_LLSTR_SIZE);
+                }
+                l = ll2string(s+i,SDS_LLSTR_SIZE,num);
+                sdsinclen(s,l);
+                i += l;
+                break;
+            case 'u':
+            case 'U':
+                if (next == 'u')
+                    unum = va_arg(ap,unsigned int);
+                else
+                    unum = va_arg(ap,unsigned long long);
+                if (sdsavail(s) < SDS_LLSTR_SIZE) {
+                    s = sdsMakeRoomFor(s,SDS_LLSTR_SIZE);
+                }
+                l = ull2string(s+i,SDS_LLSTR_SIZE,unum);
+                sdsinclen(s,l);
+                i += l;
+                break;
+            default: /* Handle %% and generally %<unknown>. */
+                s[i++] = next;
+                sdsinclen(s,1);
+                break;
+            }
+            break;
+        default:
+            /* Copy the whole run of verbatim bytes up to the next '%'
+             * with a single memcpy(). */
+            // 一次复制到下一个 '%' 为止的所有普通字符
+            str = (char*)f;
+            while(*f && *f != '%') f++;
+            l = f-str;
+            if (sdsavail(s) < l) {
+                s = sdsMakeRoomFor(s,l);
+            }
+            memcpy(s+i,str,l);
+            sdsinclen(s,l);
+            i += l;
+            continue;
+        }
+        f++;
+    }
+    va_end(ap);
+
+    /* Add null-term */
+    s[i] = '\0';
+    return s;
+}
+
 /* Turn the string into a smaller (or equal) string containing only the
  * substring specified by the 'start' and 'end' indexes.
  *
@@ -222,7 +574,6 @@ sds sdscatlen(sds s, const void *t, size_t len) {
  * sdsrange(s,1,-1); => "ello World"
  */
 void sdsrange(sds s, int start, int end) {
-    struct sdshdr *sh = (void*) (s-(sizeof(struct sdshdr)));
     size_t newlen, len = sdslen(s);
 
     if (len == 0) return;
@@ -248,12 +599,452 @@ void sdsrange(sds s, int start, int end) {
 
     // 如果有需要，对字符串进行移动
     // T = O(N)
-    if (start && newlen) memmove(sh->buf, sh->buf+start, newlen);
+    if (start && newlen) memmove(s, s+start, newlen);
+
+    // 添加终结符
+    s[newlen] = 0;
+
+    // 更新属性
+    sdssetlen(s,newlen);
+}
+/* Append to the sds string "s" an escaped string representation where
+ * all the non-printable characters (tested with isprint()) are turned into
+ * escapes in the form "\n\r\a...." or "\x<hex-number>".
+ *
+ * 将长度为 len 的字符串 p 以带引号（quoted）的格式
+ * 追加到给定 sds 的末尾
+ *
+ * After the call, the modified sds string is no longer valid and all the
+ * references must be substituted with the new pointer returned by the call.
+ *
+ * T = O(N)
+ */
+sds sdscatrepr(sds s, const char *p, size_t len) {
+    s = sdscatlen(s,"\"",1);
+
+    while(len--) {
+        switch(*p) {
+        case '\\':
+        case '"':
+            s = sdscatprintf(s,"\\%c",*p);
+            break;
+        case '\n': s = sdscatlen(s,"\\n",2); break;
+        case '\r': s = sdscatlen(s,"\\r",2); break;
+        case '\t': s = sdscatlen(s,"\\t",2); break;
+        case '\a': s = sdscatlen(s,"\\a",2); break;
+        case '\b': s = sdscatlen(s,"\\b",2); break;
+        default:
+            if (isprint(*p))
+                s = sdscatprintf(s,"%c",*p);
+            else
+                s = sdscatprintf(s,"\\x%02x",(unsigned char)*p);
+            break;
+        }
+        p++;
+    }
+
+    return sdscatlen(s,"\"",1);
+}
+
+/* Remove the part of the string from left and from right composed just of
+ * contiguous characters found in 'cset', that is a null terminted C string.
+ *
+ * 对 sds 左右两端进行修剪，清除其中 cset 指定的所有字符
+ *
+ * After the call, the modified sds string is no longer valid and all the
+ * references must be substituted with the new pointer returned by the call.
+ *
+ * Example:
+ *
+ * s = sdsnew("AA...AA.a.aa.aHelloWorld     :::");
+ * s = sdstrim(s,"A. :");
+ * printf("%s\n", s);
+ *
+ * Output will be just "HelloWorld".
+ *
+ * T = O(M*N)
+ */
+sds sdstrim(sds s, const char *cset) {
+    char *start, *end, *sp, *ep;
+    size_t len;
+
+    // 设置和记录指针
+    sp = start = s;
+    ep = end = s+sdslen(s)-1;
+
+    // 修剪, T = O(N^2)
+    while(sp <= end && strchr(cset, *sp)) sp++;
+    while(ep > sp && strchr(cset, *ep)) ep--;
+
+    // 计算 trim 完毕之后剩余的字符串长度
+    len = (sp > ep) ? 0 : ((ep-sp)+1);
+
+    // 如果有需要，前移字符串内容
+    // T = O(N)
+    if (sp != s) memmove(s, sp, len);
 
     // 添加终结符
-    sh->buf[newlen] = 0;
+    s[len] = '\0';
 
     // 更新属性
-    sh->free = sh->free+(sh->len-newlen);
-    sh->len = newlen;
-}
\ No newline at end of file
+    sdssetlen(s,len);
+
+    // 返回修剪后的 sds
+    return s;
+}
+
+/* Apply tolower() to every character of the sds string 's'.
+ *
+ * 将 sds 字符串中的所有字符转换为小写
+ *
+ * T = O(N)
+ */
+void sdstolower(sds s) {
+    int len = sdslen(s), j;
+
+    for (j = 0; j < len; j++) s[j] = tolower(s[j]);
+}
+
+/* Split 's' with separator in 'sep'. An array
+ * of sds strings is returned. *count will be set
+ * by reference to the number of tokens returned.
+ *
+ * 使用分隔符 sep 对 s 进行分割，返回一个 sds 字符串的数组。
+ * *count 会被设置为返回数组元素的数量。
+ *
+ * On out of memory, zero length string, zero length
+ * separator, NULL is returned.
+ *
+ * 如果出现内存不足、字符串长度为 0 或分隔符长度为 0
+ * 的情况，返回 NULL
+ *
+ * Note that 'sep' is able to split a string using
+ * a multi-character separator. For example
+ * sdssplit("foo_-_bar","_-_"); will return two
+ * elements "foo" and "bar".
+ *
+ * T = O(N^2)
+ */
+sds *sdssplitlen(const char *s, int len, const char *sep, int seplen, int *count) {
+    int elements = 0, slots = 5, start = 0, j;
+    sds *tokens;
+
+    if (seplen < 1 || len < 0) return NULL;
+
+    tokens = zmalloc(sizeof(sds)*slots);
+    if (tokens == NULL) return NULL;
+
+    if (len == 0) {
+        *count = 0;
+        return tokens;
+    }
+
+    // T = O(N^2)
+    for (j = 0; j < (len-(seplen-1)); j++) {
+        /* make sure there is room for the next element and the final one */
+        if (slots < elements+2) {
+            sds *newtokens;
+
+            slots *= 2;
+            newtokens = zrealloc(tokens,sizeof(sds)*slots);
+            if (newtokens == NULL) goto cleanup;
+            tokens = newtokens;
+        }
+        /* search the separator */
+        // T = O(N)
+        if ((seplen == 1 && *(s+j) == sep[0]) || (memcmp(s+j,sep,seplen) == 0)) {
+            tokens[elements] = sdsnewlen(s+start,j-start);
+            if (tokens[elements] == NULL) goto cleanup;
+            elements++;
+            start = j+seplen;
+            j = j+seplen-1; /* skip the separator */
+        }
+    }
+    /* Add the final element. We are sure there is room in the tokens array. */
+    tokens[elements] = sdsnewlen(s+start,len-start);
+    if (tokens[elements] == NULL) goto cleanup;
+    elements++;
+    *count = elements;
+    return tokens;
+
+cleanup:
+    {
+        int i;
+        for (i = 0; i < elements; i++) sdsfree(tokens[i]);
+        zfree(tokens);
+        *count = 0;
+        return NULL;
+    }
+}
+
+/* Free the result returned by sdssplitlen(), or do nothing if 'tokens' is NULL.
+ *
+ * 释放 tokens 数组中 count 个 sds
+ *
+ * T = O(N^2)
+ */
+void sdsfreesplitres(sds *tokens, int count) {
+    if (!tokens) return;
+    while(count--)
+        sdsfree(tokens[count]);
+    zfree(tokens);
+}
+
+/* Helper function for sdssplitargs() that returns non zero if 'c'
+ * is a valid hex digit.
+ *
+ * 如果 c 为十六进制符号的其中一个，返回正数
+ *
+ * T = O(1)
+ */
+int is_hex_digit(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') ||
+           (c >= 'A' && c <= 'F');
+}
+
+/* Helper function for sdssplitargs() that converts a hex digit into an
+ * integer from 0 to 15
+ *
+ * 将十六进制符号转换为 10 进制
+ *
+ * T = O(1)
+ */
+int hex_digit_to_int(char c) {
+    switch(c) {
+    case '0': return 0;
+    case '1': return 1;
+    case '2': return 2;
+    case '3': return 3;
+    case '4': return 4;
+    case '5': return 5;
+    case '6': return 6;
+    case '7': return 7;
+    case '8': return 8;
+    case '9': return 9;
+    case 'a': case 'A': return 10;
+    case 'b': case 'B': return 11;
+    case 'c': case 'C': return 12;
+    case 'd': case 'D': return 13;
+    case 'e': case 'E': return 14;
+    case 'f': case 'F': return 15;
+    default: return 0;
+    }
+}
+
+/* Split a line into arguments, where every argument can be in the
+ * following programming-language REPL-alike form:
+ *
+ * 将一行文本分割成多个参数，每个参数可以有以下的类编程语言 REPL 格式：
+ *
+ * foo bar "newline are supported\n" and "\xff\x00otherstuff"
+ *
+ * The number of arguments is stored into *argc, and an array
+ * of sds is returned.
+ *
+ * 参数的个数会保存在 *argc 中，函数返回一个 sds 数组。
+ *
+ * The caller should free the resulting array of sds strings with
+ * sdsfreesplitres().
+ *
+ * 调用者应该使用 sdsfreesplitres() 来释放函数返回的 sds 数组。
+ *
+ * The function returns the allocated tokens on success, even when the
+ * input string is empty, or NULL if the input contains unbalanced
+ * quotes or closed quotes followed by non space characters
+ * as in: "foo"bar or "foo'
+ *
+ * 如果输入中包含不平衡的引号或者引号之后紧跟非空格字符，函数返回 NULL 。
+ */
+sds *sdssplitargs(const char *line, int *argc) {
+    const char *p = line;
+    char *current = NULL;
+    char **vector = NULL;
+
+    *argc = 0;
+    while(1) {
+
+        /* skip blanks */
+        // 跳过空白
+        // T = O(N)
+        while(*p && isspace(*p)) p++;
+
+        if (*p) {
+            /* get a token */
+            int inq=0;  /* set to 1 if we are in "quotes" */
+            int insq=0; /* set to 1 if we are in 'single quotes' */
+            int done=0;
+
+            if (current == NULL) current = sdsempty();
+
+            // T = O(N)
+            while(!done) {
+                if (inq) {
+                    if (*p == '\\' && *(p+1) == 'x' &&
+                                             is_hex_digit(*(p+2)) &&
+                                             is_hex_digit(*(p+3)))
+                    {
+                        unsigned char byte;
+
+                        byte = (hex_digit_to_int(*(p+2))*16)+
+                                hex_digit_to_int(*(p+3));
+                        current = sdscatlen(current,(char*)&byte,1);
+                        p += 3;
+                    } else if (*p == '\\' && *(p+1)) {
+                        char c;
+
+                        p++;
+                        switch(*p) {
+                        case 'n': c = '\n'; break;
+                        case 'r': c = '\r'; break;
+                        case 't': c = '\t'; break;
+                        case 'b': c = '\b'; break;
+                        case 'a': c = '\a'; break;
+                        default: c = *p; break;
+                        }
+                        current = sdscatlen(current,&c,1);
+                    } else if (*p == '"') {
+                        /* closing quote must be followed by a space or
+                         * nothing at all. */
+                        if (*(p+1) && !isspace(*(p+1))) goto err;
+                        done=1;
+                    } else if (!*p) {
+                        /* unterminated quotes */
+                        goto err;
+                    } else {
+                        current = sdscatlen(current,p,1);
+                    }
+                } else if (insq) {
+                    if (*p == '\\' && *(p+1) == '\'') {
+                        p++;
+                        current = sdscatlen(current,"'",1);
+                    } else if (*p == '\'') {
+                        /* closing quote must be followed by a space or
+                         * nothing at all. */
+                        if (*(p+1) && !isspace(*(p+1))) goto err;
+                        done=1;
+                    } else if (!*p) {
+                        /* unterminated quotes */
+                        goto err;
+                    } else {
+                        current = sdscatlen(current,p,1);
+                    }
+                } else {
+                    switch(*p) {
+                    case ' ':
+                    case '\n':
+                    case '\r':
+                    case '\t':
+                    case '\0':
+                        done=1;
+                        break;
+                    case '"':
+                        inq=1;
+                        break;
+                    case '\'':
+                        insq=1;
+                        break;
+                    default:
+                        current = sdscatlen(current,p,1);
+                        break;
+                    }
+                }
+                if (*p) p++;
+            }
+            /* add the token to the vector */
+            // T = O(N)
+            vector = zrealloc(vector,((*argc)+1)*sizeof(char*));
+            vector[*argc] = current;
+            (*argc)++;
+            current = NULL;
+        } else {
+            /* Even on empty input string return something not NULL. */
+            if (vector == NULL) vector = zmalloc(sizeof(void*));
+            return vector;
+        }
+    }
+
+err:
+    while((*argc)--)
+        sdsfree(vector[*argc]);
+    zfree(vector);
+    if (current) sdsfree(current);
+    *argc = 0;
+    return NULL;
+}
+
+#ifdef REDIS_TEST
+#include <stdio.h>
+#include <sys/time.h>
+
+static long long sdsBenchUstime(void) {
+    struct timeval tv;
+
+    gettimeofday(&tv,NULL);
+    return ((long long)tv.tv_sec)*1000000+tv.tv_usec;
+}
+
+/*
+ * sds 的微基准测试：创建、追加和取长度
+ *
+ * Build with 'make REDIS_CFLAGS=-DREDIS_TEST' and run with
+ * './redis-server test sds [iterations]'.
+ */
+int sdsBenchmark(long long iterations) {
+    long long j, start, elapsed;
+    size_t before, total = 0;
+    sds *strs = zmalloc(sizeof(sds)*iterations);
+    sds s;
+
+    // 创建短字符串，以及每个字符串占用的内存
+    before = zmalloc_used_memory();
+    start = sdsBenchUstime();
+    for (j = 0; j < iterations; j++)
+        strs[j] = sdsnewlen("key:000000000000",16);
+    elapsed = sdsBenchUstime()-start;
+    printf("create: %.2f ns/op, %.1f bytes/string (16 bytes content)\n",
+        (double)elapsed*1000/iterations,
+        (double)(zmalloc_used_memory()-before)/iterations);
+
+    // 取长度
+    start = sdsBenchUstime();
+    for (j = 0; j < iterations; j++)
+        total += sdslen(strs[j]) + sdsavail(strs[j]);
+    elapsed = sdsBenchUstime()-start;
+    printf("len:    %.2f ns/op (%zu)\n",
+        (double)elapsed*1000/iterations, total);
+
+    for (j = 0; j < iterations; j++) sdsfree(strs[j]);
+    zfree(strs);
+
+    // 格式化：sdscatprintf vs sdscatfmt
+    s = sdsempty();
+    start = sdsBenchUstime();
+    for (j = 0; j < iterations; j++) {
+        sdssetlen(s,0);
+        s = sdscatprintf(s,"total_commands_processed:%lld\r\nhz:%d\r\n",
+            j*1000003,10);
+    }
+    elapsed = sdsBenchUstime()-start;
+    printf("catprintf: %.2f ns/op\n", (double)elapsed*1000/iterations);
+    start = sdsBenchUstime();
+    for (j = 0; j < iterations; j++) {
+        sdssetlen(s,0);
+        s = sdscatfmt(s,"total_commands_processed:%I\r\nhz:%i\r\n",
+            j*1000003,10);
+    }
+    elapsed = sdsBenchUstime()-start;
+    printf("catfmt:    %.2f ns/op\n", (double)elapsed*1000/iterations);
+    sdsfree(s);
+
+    // 追加，字符串会跨过所有头部类型
+    s = sdsempty();
+    start = sdsBenchUstime();
+    for (j = 0; j < iterations; j++)
+        s = sdscatlen(s,"0123456789abcdef",16);
+    elapsed = sdsBenchUstime()-start;
+    printf("append: %.2f ns/op (%zu bytes)\n",
+        (double)elapsed*1000/iterations, sdslen(s));
+    sdsfree(s);
+    return 0;
+}
+#endif
@@ -1,5 +1,7 @@
 #include <stddef.h>
 #include <stdarg.h>
+#include <sys/types.h>
+#include <stdint.h>
 
 #ifndef __SDS_H
 #define __SDS_H
@@ -16,22 +18,68 @@ typedef char *sds;
 
 /*
  * 保存字符串对象的结构
+ *
+ * The header type is chosen by the length of the string: the len and
+ * alloc fields are as small as possible, and 'flags' is always the byte
+ * just before 'buf', so that sds[-1] tells the type of the header.
+ *
+ * 根据字符串的长度选择头部的类型，flags 总是紧挨在 buf 之前，
+ * 因此通过 s[-1] 就可以知道头部的类型。
+ *
+ * Note: the structs are packed, the fields are accessed unaligned.
  */
-struct sdshdr {
-    
-    // buf 中已占用空间的长度
-    int len;
-
-    // buf 中剩余可用空间的长度
-    int free;
-
-    // 数据空间
+struct __attribute__ ((__packed__)) sdshdr8 {
+    uint8_t len;        /* buf 中已占用空间的长度 */
+    uint8_t alloc;      /* buf 的总长度，不包括头部和结尾的 \0 */
+    unsigned char flags; /* 低 2 位保存头部的类型 */
+    char buf[];
+};
+struct __attribute__ ((__packed__)) sdshdr16 {
+    uint16_t len;
+    uint16_t alloc;
+    unsigned char flags;
+    char buf[];
+};
+struct __attribute__ ((__packed__)) sdshdr32 {
+    uint32_t len;
+    uint32_t alloc;
+    unsigned char flags;
+    char buf[];
+};
+struct __attribute__ ((__packed__)) sdshdr64 {
+    uint64_t len;
+    uint64_t alloc;
+    unsigned char flags;
     char buf[];
 };
 
+#define SDS_TYPE_8  0
+#define SDS_TYPE_16 1
+#define SDS_TYPE_32 2
+#define SDS_TYPE_64 3
+#define SDS_TYPE_MASK 3
+#define SDS_TYPE_BITS 2
+#define SDS_HDR_VAR(T,s) struct sdshdr##T *sh = (void*)((s)-(sizeof(struct sdshdr##T)));
+#define SDS_HDR(T,s) ((struct sdshdr##T *)((s)-(sizeof(struct sdshdr##T))))
+
+/*
+ * 返回 sds 实际保存的字符串的长度
+ *
+ * T = O(1)
+ */
 static inline size_t sdslen(const sds s) {
-    struct sdshdr *sh = (void*)(s-(sizeof(struct sdshdr)));
-    return sh->len;
+    unsigned char flags = s[-1];
+    switch(flags&SDS_TYPE_MASK) {
+        case SDS_TYPE_8:
+            return SDS_HDR(8,s)->len;
+        case SDS_TYPE_16:
+            return SDS_HDR(16,s)->len;
+        case SDS_TYPE_32:
+            return SDS_HDR(32,s)->len;
+        case SDS_TYPE_64:
+            return SDS_HDR(64,s)->len;
+    }
+    return 0;
 }
 
 /*
@@ -40,8 +88,107 @@ static inline size_t sdslen(const sds s) {
  * T = O(1)
  */
 static inline size_t sdsavail(const sds s) {
-    struct sdshdr *sh = (void*)(s-(sizeof(struct sdshdr)));
-    return sh->free;
+    unsigned char flags = s[-1];
+    switch(flags&SDS_TYPE_MASK) {
+        case SDS_TYPE_8: {
+            SDS_HDR_VAR(8,s);
+            return sh->alloc - sh->len;
+        }
+        case SDS_TYPE_16: {
+            SDS_HDR_VAR(16,s);
+            return sh->alloc - sh->len;
+        }
+        case SDS_TYPE_32: {
+            SDS_HDR_VAR(32,s);
+            return sh->alloc - sh->len;
+        }
+        case SDS_TYPE_64: {
+            SDS_HDR_VAR(64,s);
+            return sh->alloc - sh->len;
+        }
+    }
+    return 0;
+}
+
+/*
+ * 设置 sds 的长度
+ */
+static inline void sdssetlen(sds s, size_t newlen) {
+    unsigned char flags = s[-1];
+    switch(flags&SDS_TYPE_MASK) {
+        case SDS_TYPE_8:
+            SDS_HDR(8,s)->len = newlen;
+            break;
+        case SDS_TYPE_16:
+            SDS_HDR(16,s)->len = newlen;
+            break;
+        case SDS_TYPE_32:
+            SDS_HDR(32,s)->len = newlen;
+            break;
+        case SDS_TYPE_64:
+            SDS_HDR(64,s)->len = newlen;
+            break;
+    }
+}
+
+/*
+ * 将 sds 的长度增加 inc ，调用者需要确保空余空间足够
+ */
+static inline void sdsinclen(sds s, size_t inc) {
+    unsigned char flags = s[-1];
+    switch(flags&SDS_TYPE_MASK) {
+        case SDS_TYPE_8:
+            SDS_HDR(8,s)->len += inc;
+            break;
+        case SDS_TYPE_16:
+            SDS_HDR(16,s)->len += inc;
+            break;
+        case SDS_TYPE_32:
+            SDS_HDR(32,s)->len += inc;
+            break;
+        case SDS_TYPE_64:
+            SDS_HDR(64,s)->len += inc;
+            break;
+    }
+}
+
+/*
+ * 返回 buf 的总长度 sdsavail() + sdslen()
+ */
+static inline size_t sdsalloc(const sds s) {
+    unsigned char flags = s[-1];
+    switch(flags&SDS_TYPE_MASK) {
+        case SDS_TYPE_8:
+            return SDS_HDR(8,s)->alloc;
+        case SDS_TYPE_16:
+            return SDS_HDR(16,s)->alloc;
+        case SDS_TYPE_32:
+            return SDS_HDR(32,s)->alloc;
+        case SDS_TYPE_64:
+            return SDS_HDR(64,s)->alloc;
+    }
+    return 0;
+}
+
+/*
+ * 设置 buf 的总长度
+ */
+static inline void sdssetalloc(sds s, size_t newlen) {
+    unsigned char flags = s[-1];
+    switch(flags&SDS_TYPE_MASK) {
+        case SDS_TYPE_8:
+            SDS_HDR(8,s)->alloc = newlen;
+            break;
+        case SDS_TYPE_16:
+            SDS_HDR(16,s)->alloc = newlen;
+            break;
+        case SDS_TYPE_32:
+            SDS_HDR(32,s)->alloc = newlen;
+            break;
+        case SDS_TYPE_64:
+            SDS_HDR(64,s)->alloc = newlen;
+            break;
+    }
 }
 
 sds sdsnewlen(const void *init, size_t initlen);
@@ -51,18 +198,33 @@ sds sdsdup(const sds s);
 void sdsfree(sds s);
 
 sds sdsempty(void);
+void sdsclear(sds s);
 
-void sdsIncrLen(sds s, int incr);
+void sdsIncrLen(sds s, ssize_t incr);
 
 sds sdsMakeRoomFor(sds s, size_t addlen);
+sds sdsRemoveFreeSpace(sds s);
+size_t sdsAllocSize(sds s);
 
 sds sdsnew(const char *init);
 
+sds sdsfromlonglong(long long value);
 sds sdscatprintf(sds s, const char *fmt, ...);
 sds sdscatvprintf(sds s, const char *fmt, va_list ap);
 sds sdscat(sds s, const char *t);
 
 sds sdscatlen(sds s, const void *t, size_t len);
+sds sdscatfmt(sds s, char const *fmt, ...);
 
 void sdsrange(sds s, int start, int end);
+sds sdscatrepr(sds s, const char *p, size_t len);
+sds sdstrim(sds s, const char *cset);
+void sdstolower(sds s);
+sds *sdssplitlen(const char *s, int len, const char *sep, int seplen, int *count);
+void sdsfreesplitres(sds *tokens, int count);
+sds *sdssplitargs(const char *line, int *argc);
+
+#ifdef REDIS_TEST
+int sdsBenchmark(long long iterations);
+#endif
 #endif
@@ -1,11 +1,30 @@
 #include "redis.h"
 #include "tmp.h"
+#include "cmdhash.h"
+#include "cmdhash_table.h"
+#include "bio.h"
+#include "crc64.h"
+#include "rdb.h"
+#include "cluster.h"
+
+#include <time.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <sys/utsname.h>
+#include <stdlib.h>
 
 /* Global vars */
 struct redisServer server; /* server global state */
 
 struct sharedObjectsStruct shared;
 
+static void dictListDestructor(void *privdata, void *val) {
+    DICT_NOTUSED(privdata);
+    listRelease((list*)val);
+}
+
 /* Db->dict, keys are sds strings, vals are Redis objects. */
 dictType dbDictType = {
     dictSdsHash,                /* hash function */
@@ -16,6 +35,16 @@ dictType dbDictType = {
     dictRedisObjectDestructor   /* val destructor */
 };
 
+/* Db->expires */
+dictType keyptrDictType = {
+    dictSdsHash,               /* hash function */
+    NULL,                      /* key dup */
+    NULL,                      /* val dup */
+    dictSdsKeyCompare,         /* key compare */
+    NULL,                      /* key destructor */
+    NULL                       /* val destructor */
+};
+
 /* Command table. sds string -> command struct pointer. */
 dictType commandTableDictType = {
     dictSdsCaseHash,           /* hash function */
@@ -26,44 +55,861 @@ dictType commandTableDictType = {
     NULL                       /* val destructor */
 };
 
+/* Db->watched_keys, keys are sds strings, vals are lists of the clients
+ * WATCHing the key. */
+dictType keylistDictType = {
+    dictSdsHash,                /* hash function */
+    NULL,                       /* key dup */
+    NULL,                       /* val dup */
+    dictSdsKeyCompare,          /* key compare */
+    dictSdsDestructor,          /* key destructor */
+    dictListDestructor          /* val destructor */
+};
+
+/* Set dictionary type. Keys are sds strings, values are not used. */
+dictType setDictType = {
+    dictSdsHash,                /* hash function */
+    NULL,                       /* key dup */
+    NULL,                       /* val dup */
+    dictSdsKeyCompare,          /* key compare */
+    dictSdsDestructor,          /* key destructor */
+    NULL                        /* val destructor */
+};
+
+/* Keys are pointers, or integers like client IDs cast to pointers, that
+ * are compared by value. Nothing is freed. */
+static unsigned int dictPtrHash(const void *key) {
+    return dictGenHashFunction((unsigned char*)&key,sizeof(key));
+}
+
+dictType ptrDictType = {
+    dictPtrHash,                /* hash function */
+    NULL,                       /* key dup */
+    NULL,                       /* val dup */
+    NULL,                       /* key compare */
+    NULL,                       /* key destructor */
+    NULL                        /* val destructor */
+};
+
+/* Migrate cache dict type. */
+dictType migrateCacheDictType = {
+    dictSdsHash,                /* hash function */
+    NULL,                       /* key dup */
+    NULL,                       /* val dup */
+    dictSdsKeyCompare,          /* key compare */
+    dictSdsDestructor,          /* key destructor */
+    NULL                        /* val destructor */
+};
+
+/*============================ Utility functions ============================ */
+
+/* Return the UNIX time in microseconds */
+// 返回微秒格式的 UNIX 时间
+long long ustime(void) {
+    struct timeval tv;
+    long long ust;
+
+    gettimeofday(&tv, NULL);
+    ust = ((long long)tv.tv_sec)*1000000;
+    ust += tv.tv_usec;
+    return ust;
+}
+
+/* Return the UNIX time in milliseconds */
+// 返回毫秒格式的 UNIX 时间
+long long mstime(void) {
+    return ustime()/1000;
+}
+
+/* ======================= Cron: called every 100 ms ======================== */
+
+/* Add a sample to the operations per second array of samples. */
+// 将服务器的命令执行次数记录到抽样数组中
+void trackInstantaneousMetric(int metric, long long current_reading) {
+    long long t = mstime() - server.inst_metric[metric].last_sample_time;
+    long long ops = current_reading -
+                    server.inst_metric[metric].last_sample_count;
+    long long ops_sec;
+
+    ops_sec = t > 0 ? (ops*1000/t) : 0;
+
+    server.inst_metric[metric].samples[server.inst_metric[metric].idx] =
+        ops_sec;
+    server.inst_metric[metric].idx++;
+    server.inst_metric[metric].idx %= REDIS_METRIC_SAMPLES;
+    server.inst_metric[metric].last_sample_time = mstime();
+    server.inst_metric[metric].last_sample_count = current_reading;
+}
+
+/* Return the mean of all the samples. */
+// 根据所有取样信息，计算服务器平均每秒执行命令数
+long long getInstantaneousMetric(int metric) {
+    int j;
+    long long sum = 0;
+
+    for (j = 0; j < REDIS_METRIC_SAMPLES; j++)
+        sum += server.inst_metric[metric].samples[j];
+    return sum / REDIS_METRIC_SAMPLES;
+}
+
+/* Helper function for the activeExpireCycle() function.
+ * This function will try to expire the key that is stored in the hash table
+ * entry 'de' of the 'expires' hash table of a Redis database.
+ *
+ * activeExpireCycle() 函数使用的检查键是否过期的辅佐函数。
+ *
+ * If the key is found to be expired, it is removed from the database and
+ * 1 is returned. Otherwise no operation is performed and 0 is returned.
+ *
+ * 如果 de 中的键已经过期，那么移除它，并返回 1 ，否则不做动作，并返回 0 。
+ *
+ * When a key is expired, server.stat_expiredkeys is incremented.
+ *
+ * The parameter 'now' is the current time in milliseconds as is passed
+ * to the function to avoid too many gettimeofday() syscalls.
+ *
+ * 参数 now 是毫秒格式的当前时间
+ */
+int activeExpireCycleTryExpire(redisDb *db, dictEntry *de, long long now) {
+    // 获取键的过期时间
+    long long t = dictGetSignedIntegerVal(de);
+    if (now > t) {
+
+        // 键已过期
+
+        sds key = dictGetKey(de);
+        robj *keyobj = createStringObject(key,sdslen(key));
+
+        // 传播过期命令
+        propagateExpire(db,keyobj);
+
+        // 从数据库中删除该键
+        if (server.lazyfree_lazy_expire)
+            dbAsyncDelete(db,keyobj);
+        else
+            dbSyncDelete(db,keyobj);
+        signalModifiedKey(db,keyobj);
+        decrRefCount(keyobj);
+
+        // 更新计数器
+        server.stat_expiredkeys++;
+        return 1;
+    } else {
+
+        // 键未过期
+        return 0;
+    }
+}
+
+/* Try to expire a few timed out keys. The algorithm used is adaptive and
+ * will use few CPU cycles if there are few expiring keys, otherwise
+ * it will get more aggressive to avoid that too much memory is used by
+ * keys that can be removed from the keyspace.
+ *
+ * 函数尝试删除数据库中已经过期的键。
+ * 当带有过期时间的键比较少时，函数运行得比较保守，
+ * 如果带有过期时间的键比较多，那么函数会以更积极的方式来删除过期键，
+ * 从而可能地释放被过期键占用的内存。
+ *
+ * No more than REDIS_DBCRON_DBS_PER_CALL databases are tested at every
+ * iteration.
+ *
+ * 每次循环中被测试的数据库数目不会超过 REDIS_DBCRON_DBS_PER_CALL 。
+ *
+ * Every database is sampled ACTIVE_EXPIRE_CYCLE_LOOKUPS_PER_LOOP keys at a
+ * time; the same database is sampled again as long as more than 25% of the
+ * sampled keys were expired.
+ *
+ * 每个数据库每次随机抽取 ACTIVE_EXPIRE_CYCLE_LOOKUPS_PER_LOOP 个带过期时间的键，
+ * 如果其中超过 25% 已经过期，那么继续对这个数据库进行抽样。
+ *
+ * The whole cycle may use at most ACTIVE_EXPIRE_CYCLE_SLOW_TIME_PERC percent
+ * of the time between two cron calls: when the budget runs out the function
+ * returns and the next call resumes from the database where it stopped,
+ * so expiring a large number of keys never blocks the server for long.
+ *
+ * 整个过程最多只能使用两次 serverCron() 之间
+ * ACTIVE_EXPIRE_CYCLE_SLOW_TIME_PERC% 的时间，
+ * 时间用完时函数立即返回，下次调用从中断的数据库继续，
+ * 这样大量键同时过期也不会造成延迟尖峰。
+ */
+void activeExpireCycle(void) {
+    /* This function has some global state in order to continue the work
+     * incrementally across calls. */
+    // 静态变量，用来累积函数连续执行时的数据
+    static unsigned int current_db = 0; /* Last DB tested. */
+    static int timelimit_exit = 0;      /* Time limit hit in previous call? */
+
+    unsigned int j, iteration = 0;
+    // 默认每次处理的数据库数量
+    unsigned int dbs_per_call = REDIS_DBCRON_DBS_PER_CALL;
+    // 函数开始的时间
+    long long start = ustime(), timelimit;
+
+    /* We usually should test REDIS_DBCRON_DBS_PER_CALL per iteration, with
+     * two exceptions:
+     *
+     * 一般情况下，函数只处理 REDIS_DBCRON_DBS_PER_CALL 个数据库，
+     * 除非：
+     *
+     * 1) Don't test more DBs than we have.
+     *    当前数据库的数量小于 REDIS_DBCRON_DBS_PER_CALL
+     * 2) If last time we hit the time limit, we want to scan all DBs
+     * in this iteration, as there is work to do in some DB and we don't want
+     * expired keys to use memory for too much time.
+     *     如果上次处理遇到了时间上限，那么这次需要对所有数据库进行扫描，
+     *     这可以避免过多的过期键占用空间
+     */
+    if (dbs_per_call > (unsigned)server.dbnum || timelimit_exit)
+        dbs_per_call = server.dbnum;
+
+    /* We can use at max ACTIVE_EXPIRE_CYCLE_SLOW_TIME_PERC percentage of CPU
+     * time per iteration. Since this function gets called with a frequency of
+     * server.hz times per second, the following is the max amount of
+     * microseconds we can spend in this function. */
+    // 函数处理的微秒时间上限
+    // ACTIVE_EXPIRE_CYCLE_SLOW_TIME_PERC 默认为 25 ，也即是 25 % 的 CPU 时间
+    timelimit = 1000000*ACTIVE_EXPIRE_CYCLE_SLOW_TIME_PERC/server.hz/100;
+    timelimit_exit = 0;
+    if (timelimit <= 0) timelimit = 1;
+
+    // 遍历数据库
+    for (j = 0; j < dbs_per_call; j++) {
+        int expired;
+        // 指向要处理的数据库
+        redisDb *db = server.db+(current_db % server.dbnum);
+
+        /* Increment the DB now so we are sure if we run out of time
+         * in the current DB we'll restart from the next. This allows to
+         * distribute the time evenly across DBs. */
+        // 为 DB 计数器加一，如果进入 do 循环之后因为超时而跳出
+        // 那么下次会直接从下个 DB 开始处理
+        current_db++;
+
+        /* Continue to expire if at the end of the cycle more than 25%
+         * of the keys were expired. */
+        do {
+            unsigned long num, slots;
+            long long now;
+
+            /* If there is nothing to expire try next DB ASAP. */
+            // 获取数据库中带过期时间的键的数量
+            // 如果该数量为 0 ，直接跳过这个数据库
+            if ((num = dictSize(db->expires)) == 0) break;
+            // 获取数据库中键值对的数量
+            slots = dictSlots(db->expires);
+            // 当前时间
+            now = mstime();
+
+            /* When there are less than 1% filled slots getting random
+             * keys is expensive, so stop here waiting for better times...
+             * The dictionary will be resized asap. */
+            // 这个数据库的使用率低于 1% ，扫描起来太费力了（大部分都会 MISS）
+            // 跳过，等待字典收缩程序运行
+            if (num && slots > DICT_HT_INITIAL_SIZE &&
+                (num*100/slots < 1)) break;
+
+            /* The main collection cycle. Sample random keys among keys
+             * with an expire set, checking for expired ones. */
+            // 已处理过期键计数器
+            expired = 0;
+
+            // 每次最多只能检查 LOOKUPS_PER_LOOP 个键
+            if (num > ACTIVE_EXPIRE_CYCLE_LOOKUPS_PER_LOOP)
+                num = ACTIVE_EXPIRE_CYCLE_LOOKUPS_PER_LOOP;
+
+            // 开始遍历数据库
+            while (num--) {
+                dictEntry *de;
+
+                // 从 expires 中随机取出一个带过期时间的键
+                if ((de = dictGetRandomKey(db->expires)) == NULL) break;
+
+                // 如果键已经过期，那么删除它，并将 expired 计数器增一
+                if (activeExpireCycleTryExpire(db,de,now)) expired++;
+            }
+
+            // 为这个数据库更新遍历次数
+            iteration++;
+
+            /* We can't block forever here even if there are many keys to
+             * expire. So after a given amount of milliseconds return to the
+             * caller waiting for the other active expire cycle. */
+            // 每遍历 16 次执行一次
+            if ((iteration & 0xf) == 0) { /* check once every 16 iterations. */
+                long long elapsed = ustime()-start;
+
+                // 如果遍历次数正好是 16 的倍数
+                // 并且遍历的时间超过了 timelimit
+                // 那么断开 timelimit_exit
+                if (elapsed > timelimit) timelimit_exit = 1;
+            }
+
+            // 已经超时了，返回
+            if (timelimit_exit) {
+                server.stat_expire_cycle_time_cap++;
+                return;
+            }
+
+            /* We don't repeat the cycle if there are less than 25% of keys
+             * found expired in the current DB. */
+            // 如果已删除的过期键占当前总数据库带过期时间的键数量的 25 %
+            // 那么不再遍历
+        } while (expired > ACTIVE_EXPIRE_CYCLE_LOOKUPS_PER_LOOP/4);
+    }
+}
+
+/*
+ * 检查字典的使用率是否低于系统允许的最小比率
+ *
+ * 是的话返回 1 ，否则返回 0 。
+ */
+int htNeedsResize(dict *dict) {
+    long long size, used;
+
+    // 哈希表已用节点数量
+    size = dictSlots(dict);
+
+    // 哈希表大小
+    used = dictSize(dict);
+
+    // 当哈希表的大小大于 DICT_HT_INITIAL_SIZE
+    // 并且字典的填充率低于 REDIS_HT_MINFILL 时
+    // 返回 1
+    return (size && used && size > DICT_HT_INITIAL_SIZE &&
+            (used*100/size < REDIS_HT_MINFILL));
+}
+
+/* If the percentage of used slots in the HT reaches REDIS_HT_MINFILL
+ * we resize the hash table to save memory
+ *
+ * 对服务器中的所有数据库键空间字典、以及过期时间字典进行检查，
+ * 看是否需要对这些字典进行收缩。
+ *
+ * 如果字典的使用空间比率低于 REDIS_HT_MINFILL
+ * 那么将字典的大小缩小，让 USED/BUCKETS 的比率 <= 1
+ */
+void tryResizeHashTables(int dbid) {
+    if (htNeedsResize(server.db[dbid].dict))
+        dictResize(server.db[dbid].dict);
+    if (htNeedsResize(server.db[dbid].expires))
+        dictResize(server.db[dbid].expires);
+}
+
+/* Our hash table implementation performs rehashing incrementally while
+ * we write/read from the hash table. Still if the server is idle, the hash
+ * table will use two tables for a long time. So we try to use 1 millisecond
+ * of CPU time at every call of this function to perform some rehahsing.
+ *
+ * 虽然服务器在对数据库执行读取/写入命令时会对数据库进行渐进式 rehash ，
+ * 但如果服务器长期没有执行命令的话，数据库字典的 rehash 就可能一直没办法完成，
+ * 为了防止出现这种情况，我们需要对数据库执行主动 rehash 。
+ *
+ * The function returns 1 if some rehashing was performed, otherwise 0
+ * is returned.
+ *
+ * 函数在执行了主动 rehash 时返回 1 ，否则返回 0 。
+ */
+int incrementallyRehash(int dbid) {
+
+    /* Keys dictionary */
+    if (dictIsRehashing(server.db[dbid].dict)) {
+        dictRehashMilliseconds(server.db[dbid].dict,1);
+        return 1; /* already used our millisecond for this loop... */
+    }
+
+    /* Expires */
+    if (dictIsRehashing(server.db[dbid].expires)) {
+        dictRehashMilliseconds(server.db[dbid].expires,1);
+        return 1; /* already used our millisecond for this loop... */
+    }
+
+    return 0;
+}
+
+/* This function handles 'background' operations we are required to do
+ * incrementally in Redis databases, such as active key expiring, resizing,
+ * rehashing.
+ *
+ * 对数据库执行删除过期键，调整大小，以及主动和渐进式 rehash
+ */
+void databasesCron(void) {
+
+    /* Expire keys by random sampling. */
+    // 删除过期键
+    // 从服务器不主动删除过期键，等待主服务器传来的 DEL
+    if (server.active_expire_enabled && server.masterhost == NULL)
+        activeExpireCycle();
+
+    /* Perform hash tables rehashing if needed, but only if there are no
+     * other processes saving the DB on disk. Otherwise rehashing is bad
+     * as will cause a lot of copy-on-write of memory pages. */
+    // 在没有 BGSAVE 或者 BGREWRITEAOF 子进程时，对数据库字典进行调整和 rehash
+    // 子进程存在时 rehash 会导致大量内存页被写时复制
+    if (!hasActiveChildProcess()) {
+        /* We use global counters so if we stop the computation at a given
+         * DB we'll be able to start from the successive in the next
+         * cron loop iteration. */
+        static unsigned int resize_db = 0;
+        static unsigned int rehash_db = 0;
+        unsigned int dbs_per_call = REDIS_DBCRON_DBS_PER_CALL;
+        unsigned int j;
+
+        /* Don't test more DBs than we have. */
+        // 设定要测试的数据库数量
+        if (dbs_per_call > (unsigned)server.dbnum)
+            dbs_per_call = server.dbnum;
+
+        /* Resize */
+        // 调整字典的大小
+        for (j = 0; j < dbs_per_call; j++) {
+            tryResizeHashTables(resize_db % server.dbnum);
+            resize_db++;
+        }
+
+        /* Rehash */
+        // 对字典进行渐进式 rehash
+        for (j = 0; j < dbs_per_call; j++) {
+            int work_done = incrementallyRehash(rehash_db % server.dbnum);
+            rehash_db++;
+            if (work_done) {
+                /* If the function did some work, stop here, we'll do
+                 * more at the next cron loop. */
+                break;
+            }
+        }
+    }
+}
+
+/* This is our timer interrupt, called server.hz times per second.
+ *
+ * Redis 的时间中断器，每秒调用 server.hz 次。
+ *
+ * Here is where we do a number of things that need to be done asynchronously.
+ * For instance:
+ *
+ * 以下是需要异步执行的操作：
+ *
+ * - Stats sampling: instantaneous ops/sec, network traffic.
+ *   对命令执行次数和网络流量进行抽样。
+ * - Memory stats: peak memory and RSS.
+ *   更新已用内存峰值和常驻内存大小。
+ * - Active expired keys collection (it is also performed in a lazy way on
+ *   lookup).
+ *   清理数据库中的过期键值对。
+ * - Incremental rehashing of the DBs hash tables.
+ *   对数据库进行渐增式 Rehash 。
+ */
+int serverCron(struct aeEventLoop *eventLoop, long long id, void *clientData) {
+    size_t zmalloc_used;
+    REDIS_NOTUSED(eventLoop);
+    REDIS_NOTUSED(id);
+    REDIS_NOTUSED(clientData);
+
+    /* We have just REDIS_LRU_BITS bits per object for LRU information.
+     * So we use an (eventually wrapping) LRU clock.
+     *
+     * Note that even if the counter wraps it's not a big problem,
+     * everything will still work but some object will appear younger
+     * to Redis. However for this to happen a given object should never be
+     * touched for all the time needed to the counter to wrap, which is
+     * not likely.
+     *
+     * 即使服务器的时间最终比 1.5 年长也无所谓，
+     * 对象系统仍会正常运作，不过一些对象可能会比服务器本身的时钟更年轻。
+     * 不过这要这个对象在 1.5 年内都没有被访问过，才会出现这种现象。
+     *
+     * Note that you can change the resolution altering the
+     * REDIS_LRU_CLOCK_RESOLUTION define.
+     *
+     * LRU 时间的精度可以通过修改 REDIS_LRU_CLOCK_RESOLUTION 常量来改变。
+     */
+    server.lruclock = getLRUClock();
+
+    /* We received a SIGTERM, shutting down here in a safe way, as it is
+     * not ok doing so inside the signal handler. */
+    // 服务器进程收到 SIGTERM 信号，关闭服务器
+    if (server.shutdown_asap) {
+
+        // 尝试关闭服务器
+        if (prepareForShutdown(REDIS_SHUTDOWN_NOFLAGS) == REDIS_OK) exit(0);
+
+        // 如果关闭失败，那么打印 LOG ，并移除关闭标识
+        redisLog(REDIS_WARNING,"SIGTERM received but errors trying to shut down the server, check the logs for more information");
+        server.shutdown_asap = 0;
+    }
+
+    // 记录服务器执行命令的次数和网络流量
+    run_with_period(100) {
+        trackInstantaneousMetric(REDIS_METRIC_COMMAND,server.stat_numcommands);
+        trackInstantaneousMetric(REDIS_METRIC_NET_INPUT,
+                server.stat_net_input_bytes);
+        trackInstantaneousMetric(REDIS_METRIC_NET_OUTPUT,
+                server.stat_net_output_bytes);
+    }
+
+    /* Record the max memory used since the server was started. */
+    // 记录服务器的内存峰值
+    zmalloc_used = zmalloc_used_memory();
+    if (zmalloc_used > server.stat_peak_memory)
+        server.stat_peak_memory = zmalloc_used;
+
+    /* Sample the RSS here since this is a relatively slow call. */
+    // 读取 /proc 比较慢，所以只在这里抽样一次，INFO 直接使用抽样结果
+    server.resident_set_size = zmalloc_get_rss();
+
+    /* Handle background operations on Redis databases. */
+    // 对数据库执行各种操作
+    databasesCron();
+
+    /* Start a scheduled AOF rewrite if this was requested by the user while
+     * a BGSAVE was in progress. */
+    // 如果 BGSAVE 和 BGREWRITEAOF 都没有在执行
+    // 并且有一个 BGREWRITEAOF 在等待，那么执行 BGREWRITEAOF
+    // 重写失败之后，至少等待 REDIS_BGSAVE_RETRY_DELAY 秒再重试
+    if (!hasActiveChildProcess() && server.aof_rewrite_scheduled &&
+        (server.aof_lastbgrewrite_status == REDIS_OK ||
+         time(NULL)-server.aof_lastbgrewrite_try > REDIS_BGSAVE_RETRY_DELAY))
+    {
+        rewriteAppendOnlyFileBackground();
+    }
+
+    /* Check if a background saving or AOF rewrite in progress terminated. */
+    // 检查 BGSAVE 或者 BGREWRITEAOF 子进程是否已经执行完毕
+    if (hasActiveChildProcess()) {
+        int statloc;
+        pid_t pid;
+
+        // 接收子进程发来的信号，非阻塞
+        if ((pid = wait3(&statloc,WNOHANG,NULL)) != 0) {
+            int exitcode = WEXITSTATUS(statloc);
+            int bysignal = 0;
+
+            if (WIFSIGNALED(statloc)) bysignal = WTERMSIG(statloc);
+
+            if (pid == -1) {
+                redisLog(REDIS_WARNING,"wait3() returned an error: %s. "
+                    "rdb_child_pid = %d, aof_child_pid = %d",
+                    strerror(errno),
+                    (int) server.rdb_child_pid,
+                    (int) server.aof_child_pid);
+            } else if (pid == server.rdb_child_pid) {
+                // BGSAVE 执行完毕
+                backgroundSaveDoneHandler(exitcode,bysignal);
+                // 读取子进程报告的写时复制内存数量
+                if (!bysignal && exitcode == 0) receiveChildInfo();
+            } else if (pid == server.aof_child_pid) {
+                // BGREWRITEAOF 执行完毕
+                backgroundRewriteDoneHandler(exitcode,bysignal);
+                if (!bysignal && exitcode == 0) receiveChildInfo();
+            }
+            updateDictResizePolicy();
+            closeChildInfoPipe();
+        }
+    } else {
+        /* If there is not a background saving in progress check if
+         * we have to save now */
+        // 既然没有 BGSAVE 在执行，那么检查是否需要执行 BGSAVE
+        // 遍历所有保存条件，看是否需要执行 BGSAVE 命令
+        time_t now = time(NULL);
+        int j;
+
+        for (j = 0; j < server.saveparamslen; j++) {
+            struct saveparam *sp = server.saveparams+j;
+
+            /* Save if we reached the given amount of changes,
+             * the given amount of seconds, and if the latest bgsave was
+             * successful or if, in case of an error, at least
+             * REDIS_BGSAVE_RETRY_DELAY seconds already elapsed. */
+            // 检查是否有某个保存条件已经满足了
+            if (server.dirty >= sp->changes &&
+                now-server.lastsave > sp->seconds &&
+                (now-server.lastbgsave_try > REDIS_BGSAVE_RETRY_DELAY ||
+                 server.lastbgsave_status == REDIS_OK))
+            {
+                redisLog(REDIS_NOTICE,"%d changes in %d seconds. Saving...",
+                    sp->changes, (int)sp->seconds);
+                // 执行 BGSAVE
+                rdbSaveBackground(server.rdb_filename);
+                break;
+            }
+        }
+
+        /* Trigger an AOF rewrite if needed */
+        // 在 AOF 的大小增长到基础文件的一定比例之后，自动执行 BGREWRITEAOF
+        if (server.aof_state == REDIS_AOF_ON &&
+            !hasActiveChildProcess() &&
+            server.aof_rewrite_perc &&
+            server.aof_current_size > server.aof_rewrite_min_size)
+        {
+            // 最后一次 AOF 重写之后，AOF 文件的大小
+            long long base = server.aof_rewrite_base_size ?
+                            server.aof_rewrite_base_size : 1;
+
+            // AOF 文件当前的体积相对于 base 的体积的百分比
+            long long growth = (server.aof_current_size*100/base) - 100;
+
+            // 如果增长体积的百分比超过了 growth ，那么执行 BGREWRITEAOF
+            if (growth >= server.aof_rewrite_perc) {
+                redisLog(REDIS_NOTICE,"Starting automatic rewriting of AOF on %lld%% growth",growth);
+                rewriteAppendOnlyFileBackground();
+            }
+        }
+    }
+
+    /* Close clients that need to be closed asynchronous */
+    // 关闭需要异步关闭的客户端
+    freeClientsInAsyncFreeQueue();
+
+    /* Replication cron function -- used to reconnect to master and
+     * to detect transfer failures. */
+    // 复制相关的定时操作
+    run_with_period(1000) replicationCron();
+
+    // 关闭 MIGRATE 空闲的缓存连接
+    run_with_period(1000) migrateCloseTimedoutSockets();
+
+    // 增加 loop 计数器
+    server.cronloops++;
+
+    return 1000/server.hz;
+}
+
 /* =========================== Server initialization ======================== */
 void createSharedObjects(void) {
     // 常用回复
     shared.crlf = createObject(REDIS_STRING,sdsnew("\r\n"));
     shared.ok = createObject(REDIS_STRING,sdsnew("+OK\r\n"));
     shared.err = createObject(REDIS_STRING,sdsnew("-ERR\r\n"));
-    
+    shared.syntaxerr = createObject(REDIS_STRING,sdsnew(
+        "-ERR syntax error\r\n"));
+    shared.czero = createObject(REDIS_STRING,sdsnew(":0\r\n"));
+    shared.cone = createObject(REDIS_STRING,sdsnew(":1\r\n"));
+    shared.nullbulk = createObject(REDIS_STRING,sdsnew("$-1\r\n"));
+    shared.wrongtypeerr = createObject(REDIS_STRING,sdsnew(
+        "-WRONGTYPE Operation against a key holding the wrong kind of value\r\n"));
+    shared.oomerr = createObject(REDIS_STRING,sdsnew(
+        "-OOM command not allowed when used memory > 'maxmemory'.\r\n"));
+    shared.bgsaveerr = createObject(REDIS_STRING,sdsnew(
+        "-MISCONF Redis is configured to save RDB snapshots, but is currently not able to persist on disk. Commands that may modify the data set are disabled. Please check Redis logs for details about the error.\r\n"));
+    shared.pong = createObject(REDIS_STRING,sdsnew("+PONG\r\n"));
+    shared.roslaveerr = createObject(REDIS_STRING,sdsnew(
+        "-READONLY You can't write against a read only replica.\r\n"));
+    shared.queued = createObject(REDIS_STRING,sdsnew("+QUEUED\r\n"));
+    shared.nullmultibulk = createObject(REDIS_STRING,sdsnew("*-1\r\n"));
+    shared.execaborterr = createObject(REDIS_STRING,sdsnew(
+        "-EXECABORT Transaction discarded because of previous errors.\r\n"));
+
+    // 常用字符串
+    shared.del = createStringObject("DEL",3);
+    shared.ping = createStringObject("PING",4);
+    shared.multi = createStringObject("MULTI",5);
+
+    // Pub/Sub 通知的类型
+    shared.subscribebulk = createStringObject("$9\r\nsubscribe\r\n",15);
+    shared.unsubscribebulk = createStringObject("$11\r\nunsubscribe\r\n",18);
+    shared.psubscribebulk = createStringObject("$10\r\npsubscribe\r\n",17);
+    shared.punsubscribebulk = createStringObject("$12\r\npunsubscribe\r\n",19);
+
+    // 常用整数
+    for (int j = 0; j < REDIS_SHARED_INTEGERS; j++) {
+        shared.integers[j] = makeObjectShared(createObject(REDIS_STRING,
+            (void*)(long)j));
+        shared.integers[j]->encoding = REDIS_ENCODING_INT;
+    }
 
     // 常用长度 bulk 或者 multi bulk 回复
-    for (int j = 0; j < REDIS_SHARED_BULKHDR_LEN; j++) {
-        shared.bulkhdr[j] = createObject(REDIS_STRING,
-            sdscatprintf(sdsempty(),"$%d\r\n",j));
+    // 数量由 shared-bulkhdr-len 选项决定
+    shared.bulkhdr = zmalloc(sizeof(robj*)*server.shared_bulkhdr_len);
+    for (int j = 0; j < server.shared_bulkhdr_len; j++) {
+        shared.bulkhdr[j] = makeObjectShared(createObject(REDIS_STRING,
+            sdscatprintf(sdsempty(),"$%d\r\n",j)));
+    }
+}
+
+
+/* Resets the stats that we expose via INFO or other means that we want
+ * to reset via CONFIG RESETSTAT. The function is also used in order to
+ * initialize these fields in initServer() at server startup. */
+void resetServerStats(void) {
+    int j;
+
+    server.stat_numcommands = 0;
+    server.stat_numconnections = 0;
+    server.stat_rejected_conn = 0;
+    server.stat_expiredkeys = 0;
+    server.stat_evictedkeys = 0;
+    server.stat_expire_cycle_time_cap = 0;
+    for (j = 0; j < REDIS_METRIC_COUNT; j++) {
+        server.inst_metric[j].idx = 0;
+        server.inst_metric[j].last_sample_time = mstime();
+        server.inst_metric[j].last_sample_count = 0;
+        memset(server.inst_metric[j].samples,0,
+            sizeof(server.inst_metric[j].samples));
     }
+    server.stat_net_input_bytes = 0;
+    server.stat_net_output_bytes = 0;
+    server.stat_fork_time = 0;
+    server.stat_rdb_cow_bytes = 0;
+    server.stat_aof_cow_bytes = 0;
+    server.stat_aof_writes = 0;
+    server.stat_aof_write_usec = 0;
+    server.stat_aof_write_usec_last = 0;
+    server.stat_aof_write_usec_max = 0;
+    server.stat_aof_fsyncs = 0;
+    server.stat_aof_fsync_usec = 0;
+    server.stat_aof_fsync_usec_last = 0;
+    server.stat_aof_fsync_usec_max = 0;
+    server.stat_sync_full = 0;
+    server.stat_sync_partial_ok = 0;
+    server.stat_sync_partial_err = 0;
+}
+
+/*
+ * 载入速度：每秒载入的键数量和 MB 数量
+ */
+static void rdbLoadThroughput(double *keys_per_sec, double *mb_per_sec) {
+    double secs = (double)server.stat_rdb_load_usec/1000000;
+
+    *keys_per_sec = secs ? server.stat_rdb_load_keys/secs : 0;
+    *mb_per_sec = secs ? (double)server.stat_rdb_load_bytes/(1024*1024)/secs : 0;
+}
+
+/*
+ * 计算最近一次 AOF 载入的速度
+ */
+static void aofLoadThroughput(double *cmds_per_sec, double *mb_per_sec) {
+    double secs = (double)server.stat_aof_load_usec/1000000;
+
+    *cmds_per_sec = secs ? server.stat_aof_load_commands/secs : 0;
+    *mb_per_sec = secs ? (double)server.stat_aof_load_bytes/(1024*1024)/secs : 0;
+}
+
+/*
+ * SIGTERM 信号处理器
+ */
+static void sigtermHandler(int sig) {
+    REDIS_NOTUSED(sig);
+
+    redisLogFromHandler(REDIS_WARNING,"Received SIGTERM, scheduling shutdown...");
+
+    // 打开关闭标识
+    server.shutdown_asap = 1;
 }
 
+/*
+ * 设置信号处理函数
+ */
+void setupSignalHandlers(void) {
+    struct sigaction act;
+
+    /* When the SA_SIGINFO flag is set in sa_flags then sa_sigaction is used.
+     * Otherwise, sa_handler is used. */
+    sigemptyset(&act.sa_mask);
+    act.sa_flags = 0;
+    act.sa_handler = sigtermHandler;
+    sigaction(SIGTERM, &act, NULL);
+}
 
 void initServer() {
 	int j;
 
+    // 设置信号处理函数
+    signal(SIGHUP, SIG_IGN);
+    signal(SIGPIPE, SIG_IGN);
+    setupSignalHandlers();
+
+    server.pid = getpid();
+    server.clients = listCreate();
+    server.clients_index = dictCreate(&ptrDictType,NULL);
+    server.next_client_id = 1; /* Client IDs, start from 1 .*/
+    server.clients_to_close = listCreate();
+    server.slaves = listCreate();
+    server.shutdown_asap = 0;
+
 	server.db = zmalloc(sizeof(redisDb)*server.dbnum);
 
 	// 创建并初始化数据库结构
     for (j = 0; j < server.dbnum; j++) {
 		server.db[j].id = j;
 		server.db[j].dict = dictCreate(&dbDictType, NULL);
+		server.db[j].expires = dictCreate(&keyptrDictType, NULL);
+		server.db[j].watched_keys = dictCreate(&keylistDictType, NULL);
 	}
 
     // 创建共享对象
     createSharedObjects();
 
+    // 创建 LRU/LFU 淘汰池
+    evictionPoolAlloc();
+
+    // 创建后台线程
+    bioInit();
+
     server.el = aeCreateEventLoop(server.maxclients+REDIS_EVENTLOOP_FDSET_INCR);
 
+    // 初始化统计数据
+    server.cronloops = 0;
+    server.stat_starttime = time(NULL);
+    server.stat_peak_memory = 0;
+    server.resident_set_size = 0;
+    resetServerStats();
+
+    // 初始化 RDB 持久化状态
+    server.rdb_child_pid = -1;
+    server.rdb_child_type = REDIS_RDB_CHILD_TYPE_NONE;
+    server.child_info_pipe[0] = -1;
+    server.child_info_pipe[1] = -1;
+    server.dirty = 0;
+    server.loading = 0;
+    server.lastsave = time(NULL); /* At startup we consider the DB saved. */
+    server.lastbgsave_try = 0;    /* At startup we never tried to BGSAVE. */
+    server.rdb_save_time_last = -1;
+    server.rdb_save_time_start = -1;
+    server.lastbgsave_status = REDIS_OK;
+    server.stat_rdb_load_keys = 0;
+    server.stat_rdb_load_bytes = 0;
+    server.stat_rdb_load_usec = 0;
+    server.stat_rdb_load_threads = 0;
+    server.stat_aof_load_commands = 0;
+    server.stat_aof_load_bytes = 0;
+    server.stat_aof_load_usec = 0;
+
+    // 初始化 AOF 持久化状态
+    server.aof_buf = sdsempty();
+    server.aof_fd = -1;
+    server.aof_selected_db = -1; /* Make sure the first time will not match */
+    server.aof_current_size = 0;
+    server.aof_fsync_offset = 0;
+    server.aof_flush_postponed_start = 0;
+    server.aof_last_fsync = time(NULL);
+    server.aof_last_write_status = REDIS_OK;
+    server.aof_last_write_errno = 0;
+    server.aof_delayed_fsync = 0;
+    server.aof_manifest = NULL;
+    server.aof_last_incr_size = 0;
+    server.aof_rewrite_base_size = 0;
+    server.aof_child_pid = -1;
+    server.aof_rewrite_scheduled = 0;
+    server.aof_rewrite_time_last = -1;
+    server.aof_rewrite_time_start = -1;
+    server.aof_lastbgrewrite_try = 0;
+    server.aof_lastbgrewrite_status = REDIS_OK;
+
 	// 打开 TCP 监听端口，用于等待客户端的命令请求
     if (server.port != 0 &&
         listenToPort(server.port,server.ipfd,&server.ipfd_count) == REDIS_ERR)
         exit(1);
 
 
+    /* Create the serverCron() time event, that's our main way to process
+     * background operations. */
+    // 为 serverCron() 创建时间事件
+    if(aeCreateTimeEvent(server.el, 1, serverCron, NULL, NULL) == AE_ERR) {
+        redisPanic("Can't create the serverCron time event.");
+        exit(1);
+    }
+
 	// 为 TCP 连接关联连接应答（accept）处理器
     // 用于接受并应答客户端的 connect() 调用
     for (j = 0; j < server.ipfd_count; j++) {
@@ -74,11 +920,26 @@ void initServer() {
                     "Unrecoverable error creating server.ipfd file event.");
             }
     }
+
+    // 初始化集群状态
+    if (server.cluster_enabled) clusterInit();
+    server.migrate_cached_sockets = dictCreate(&migrateCacheDictType,NULL);
+    pubsubInit();
+    trackingInit();
 }
 
+/* Our command table.
+ *
+ * 命令表
+ *
+ * The entries live in commands.def so that mkcmdhash can build the
+ * compile-time perfect hash used by lookupCommand() from the very same
+ * list.
+ */
 struct redisCommand redisCommandTable[] = {
-    {"get",getCommand,2},
-    {"set",setCommand,-3},
+#define REDIS_COMMAND(name,proc,...) {name,proc,__VA_ARGS__},
+#include "commands.def"
+#undef REDIS_COMMAND
 };
 
 /* Populates the Redis Command Table starting from the hard coded list
@@ -97,8 +958,25 @@ void populateCommandTable(void) {
         // 指定命令
         struct redisCommand *c = redisCommandTable+j;
 
+        // 取出字符串 FLAG
+        char *f = c->sflags;
+
         int retval1;
 
+        // 根据字符串 FLAG 生成实际 FLAG
+        while(*f != '\0') {
+            switch(*f) {
+            case 'w': c->flags |= REDIS_CMD_WRITE; break;
+            case 'r': c->flags |= REDIS_CMD_READONLY; break;
+            case 'm': c->flags |= REDIS_CMD_DENYOOM; break;
+            case 'F': c->flags |= REDIS_CMD_FAST; break;
+            case 'P': c->flags |= REDIS_CMD_MAY_REPLICATE; break;
+            case 'k': c->flags |= REDIS_CMD_ASKING; break;
+            default: redisPanic("Unsupported command flag"); break;
+            }
+            f++;
+        }
+
         // 将命令关联到命令表
         retval1 = dictAdd(server.commands, sdsnew(c->name), c);
 
@@ -112,43 +990,208 @@ void initServerConfig()
 	server.verbosity = REDIS_DEFAULT_VERBOSITY;
 
 	server.port = REDIS_SERVERPORT;
+    server.hz = REDIS_DEFAULT_HZ;
     server.maxclients = REDIS_MAX_CLIENTS;
+    server.configfile = NULL;
+    server.active_expire_enabled = 1;
+    server.shared_bulkhdr_len = REDIS_SHARED_BULKHDR_LEN;
+    server.maxmemory = REDIS_DEFAULT_MAXMEMORY;
+    server.maxmemory_policy = REDIS_DEFAULT_MAXMEMORY_POLICY;
+    server.maxmemory_samples = REDIS_DEFAULT_MAXMEMORY_SAMPLES;
+    server.tracking_table_max_keys = REDIS_DEFAULT_TRACKING_TABLE_MAX_KEYS;
+    server.lfu_log_factor = REDIS_DEFAULT_LFU_LOG_FACTOR;
+    server.lfu_decay_time = REDIS_DEFAULT_LFU_DECAY_TIME;
+    server.lazyfree_lazy_expire = REDIS_DEFAULT_LAZYFREE_LAZY_EXPIRE;
+    server.lazyfree_lazy_server_del = REDIS_DEFAULT_LAZYFREE_LAZY_SERVER_DEL;
+    server.lazyfree_lazy_user_del = REDIS_DEFAULT_LAZYFREE_LAZY_USER_DEL;
+    server.rdb_filename = zstrdup(REDIS_DEFAULT_RDB_FILENAME);
+    server.rdb_checksum = REDIS_DEFAULT_RDB_CHECKSUM;
+    server.rdb_load_threads = REDIS_DEFAULT_RDB_LOAD_THREADS;
+    server.stop_writes_on_bgsave_err = REDIS_DEFAULT_STOP_WRITES_ON_BGSAVE_ERROR;
+    server.aof_state = REDIS_AOF_OFF;
+    server.aof_fsync = REDIS_DEFAULT_AOF_FSYNC;
+    server.aof_filename = zstrdup(REDIS_DEFAULT_AOF_FILENAME);
+    server.aof_load_truncated = REDIS_DEFAULT_AOF_LOAD_TRUNCATED;
+    server.aof_rewrite_perc = REDIS_AOF_REWRITE_PERC;
+    server.aof_rewrite_min_size = REDIS_AOF_REWRITE_MIN_SIZE;
+
+    // 每次启动都不同的运行 ID ，从服务器用它判断能否部分重同步
+    getRandomHexChars(server.runid,REDIS_RUN_ID_SIZE);
+    server.runid[REDIS_RUN_ID_SIZE] = '\0';
+
+    // 初始化复制状态
+    server.masterhost = NULL;
+    server.masterport = 6379;
+    server.master = NULL;
+    server.cached_master = NULL;
+    server.repl_state = REDIS_REPL_NONE;
+    server.repl_transfer_s = -1;
+    server.repl_transfer_tmpfile = NULL;
+    server.repl_diskless_load = REDIS_DEFAULT_REPL_DISKLESS_LOAD;
+    server.repl_transfer_loader = NULL;
+    server.repl_syncio_timeout = REDIS_REPL_SYNCIO_TIMEOUT;
+    server.repl_slave_ro = REDIS_DEFAULT_SLAVE_READ_ONLY;
+    server.repl_down_since = 0; /* Never connected, repl is down since EVER. */
+    server.repl_master_initial_offset = -1;
+    server.repl_master_runid[0] = '\0';
+    server.repl_timeout = REDIS_REPL_TIMEOUT;
+    server.repl_ping_slave_period = REDIS_REPL_PING_SLAVE_PERIOD;
+    server.slaveseldb = -1; /* Force to emit the first SELECT command. */
+    server.master_repl_offset = 0;
+
+    /* Replication partial resync backlog */
+    server.repl_backlog = NULL;
+    server.repl_backlog_size = REDIS_DEFAULT_REPL_BACKLOG_SIZE;
+    server.repl_backlog_histlen = 0;
+    server.repl_backlog_idx = 0;
+    server.repl_backlog_off = 0;
+
+    // 初始化集群状态
+    server.cluster_enabled = 0;
+    server.cluster = NULL;
+
+    // 初始化 RDB 保存条件
+    server.saveparams = NULL;
+    resetServerSaveParams();
+    appendServerSaveParams(60*60,1);  /* save after 1 hour and 1 change */
+    appendServerSaveParams(300,100);  /* save after 5 minutes and 100 changes */
+    appendServerSaveParams(60,10000); /* save after 1 minute and 10000 changes */
+
+    // 初始化 LRU 时间
+    server.lruclock = getLRUClock();
 
     // 初始化命令表
     // 在这里初始化是因为接下来读取 .conf 文件时可能会用到这些命令
     server.commands = dictCreate(&commandTableDictType,NULL);
     populateCommandTable();
+    server.delCommand = lookupCommandByCString("del");
+    server.expireCommand = lookupCommandByCString("expire");
+    server.pexpireCommand = lookupCommandByCString("pexpire");
+    server.multiCommand = lookupCommandByCString("multi");
 }
 
 /*
- * 获取包含给定键的节点的值
+ * 通过编译期生成的最小完美哈希查找命令
  *
- * 如果节点不为空，返回节点的值
- * 否则返回 NULL
- *
- * T = O(1)
+ * The perfect hash maps every name of redisCommandTable to a distinct slot,
+ * so a single case insensitive compare tells if 'name' is that command.
+ * Returns NULL if the name is not in the static table.
  */
-void *dictFetchValue(dict *d, const void *key) {
-    dictEntry *he;
-
-    // T = O(1)
-    he = dictFind(d,key);
+struct redisCommand *lookupCommandByPerfectHash(const char *name, size_t len) {
+    uint64_t h = cmdhashFunction((const unsigned char*)name,len);
+    uint32_t slot = cmdhashSlot(h,cmdhashDisp[cmdhashBucket(h,CMDHASH_BUCKETS)],
+                                CMDHASH_SIZE);
 
-    return he ? dictGetVal(he) : NULL;
+    if (cmdhashSlots[slot].len != len) return NULL;
+    if (!cmdhashEqual((const unsigned char*)name,
+            redisCommandTable[cmdhashSlots[slot].index].name,len))
+        return NULL;
+    return redisCommandTable+cmdhashSlots[slot].index;
 }
 
 /*
  * 根据给定命令名字（SDS），查找命令
+ *
+ * The static table is resolved through the perfect hash, the
+ * server.commands dict is only consulted when that fails, that is for
+ * commands added or renamed at runtime.
  */
 struct redisCommand *lookupCommand(sds name) {
+    struct redisCommand *cmd = lookupCommandByPerfectHash(name,sdslen(name));
+
+    if (cmd) return cmd;
     return dictFetchValue(server.commands, name);
 }
 
+/*
+ * 根据给定命令名字（C 字符串），查找命令
+ */
+struct redisCommand *lookupCommandByCString(char *s) {
+    struct redisCommand *cmd = lookupCommandByPerfectHash(s,strlen(s));
+    sds name;
+
+    if (cmd) return cmd;
+    name = sdsnew(s);
+    cmd = dictFetchValue(server.commands, name);
+    sdsfree(name);
+    return cmd;
+}
+
+/* Propagate the specified command (in the context of the specified database id)
+ * to AOF and Slaves.
+ *
+ * 将指定命令（以及执行该命令的上下文，比如数据库 id 等信息）传播到 AOF
+ *
+ * flags are an xor between:
+ * FLAG 可以是以下标识的 xor ：
+ *
+ * + REDIS_PROPAGATE_NONE (no propagation of command at all)
+ *   不传播
+ *
+ * + REDIS_PROPAGATE_AOF (propagate into the AOF file if is enabled)
+ *   传播到 AOF
+ *
+ * + REDIS_PROPAGATE_REPL (propagate into the replication link)
+ *   传播到从服务器
+ */
+void propagate(struct redisCommand *cmd, int dbid, robj **argv, int argc,
+               int flags)
+{
+    // 传播到 AOF
+    if (server.aof_state != REDIS_AOF_OFF && flags & REDIS_PROPAGATE_AOF)
+        feedAppendOnlyFile(cmd,dbid,argv,argc);
+
+    // 传播到从服务器
+    if (flags & REDIS_PROPAGATE_REPL)
+        replicationFeedSlaves(server.slaves,dbid,argv,argc);
+}
+
+/* Call() is the core of Redis execution of a command
+ *
+ * 调用命令的实现函数，执行命令
+ */
 void call(redisClient *c, int flags) {
-    REDIS_NOTUSED(flags);
+    long long dirty;
+
+    // 保留旧 dirty 计数器值
+    c->flags &= ~REDIS_FORCE_REPL;
+    dirty = server.dirty;
 
     // 执行实现函数
     c->cmd->proc(c);
+
+    /* If the client has keys tracking enabled for client side caching,
+     * make sure to remember the keys it fetched. */
+    // 记录开启追踪的客户端读取的键
+    if (c->cmd->flags & REDIS_CMD_READONLY &&
+        (c->flags & (REDIS_TRACKING|REDIS_TRACKING_BCAST)) == REDIS_TRACKING)
+    {
+        trackingRememberKeys(c);
+    }
+
+    // 计算命令之后产生的 dirty 值
+    dirty = server.dirty-dirty;
+    // SAVE 之类的命令会清零 dirty 计数器
+    if (dirty < 0) dirty = 0;
+
+    /* Propagate the command into the AOF if it modified the dataset.
+     * Note that the command vector may have been rewritten by the command
+     * implementation (for instance EXPIRE in the past becomes DEL). */
+    // 如果命令修改了数据库，那么将它传播到 AOF 和从服务器
+    // 注意命令实现函数可能改写了参数（比如已经过去的 EXPIRE 会变成 DEL）
+    // 没有修改数据库的命令（比如 PUBLISH ）可以要求只传播到从服务器
+    if (flags & REDIS_CALL_PROPAGATE) {
+        int flags = REDIS_PROPAGATE_NONE;
+
+        if (c->flags & REDIS_FORCE_REPL) flags |= REDIS_PROPAGATE_REPL;
+        if (dirty)
+            flags |= (REDIS_PROPAGATE_REPL | REDIS_PROPAGATE_AOF);
+        if (flags != REDIS_PROPAGATE_NONE)
+            propagate(c->cmd,c->db->id,c->argv,c->argc,flags);
+    }
+    c->flags &= ~REDIS_FORCE_REPL;
+
+    server.stat_numcommands++;
 }
 
 int processCommand(redisClient *c) {
@@ -157,29 +1200,822 @@ int processCommand(redisClient *c) {
 
     if (!c->cmd) {
         // 没找到指定的命令
-        redisLog(REDIS_WARNING,"unknown command %s", (char*)c->argv[0]->ptr);
-        
+        flagTransaction(c);
+        addReplyErrorFormat(c,"unknown command '%s'",
+            (char*)c->argv[0]->ptr);
         return REDIS_OK;
     } else if ((c->cmd->arity > 0 && c->cmd->arity != c->argc) ||
                (c->argc < -c->cmd->arity)) {
         // 参数个数错误
-        redisLog(REDIS_WARNING,"wrong number of arguments for '%s' command", c->cmd->name);
+        flagTransaction(c);
+        addReplyErrorFormat(c,"wrong number of arguments for '%s' command",
+            c->cmd->name);
+        return REDIS_OK;
+    }
+
+    /* If cluster is enabled perform the cluster redirection here.
+     * However we don't perform the redirection if:
+     * 1) The sender of this command is our master.
+     * 2) The command has no key arguments. EXEC is checked anyway, since
+     *    the keys of the queued commands must all be served here. */
+    // 集群模式下，将不属于当前节点的槽的命令重定向到正确的节点
+    if (server.cluster_enabled &&
+        !(c->flags & REDIS_MASTER) &&
+        (c->cmd->firstkey != 0 || c->cmd->proc == execCommand))
+    {
+        int hashslot = 0, error_code;
+        clusterNode *n = getNodeByQuery(c,c->cmd,c->argv,c->argc,
+                                        &hashslot,&error_code);
 
+        if (n == NULL || n != server.cluster->myself) {
+            // EXEC 被拒绝时，事务随之结束
+            if (c->cmd->proc == execCommand)
+                discardTransaction(c);
+            else
+                flagTransaction(c);
+            clusterRedirectClient(c,n,hashslot,error_code);
+            return REDIS_OK;
+        }
+    }
+
+    /* Handle the maxmemory directive.
+     *
+     * First we try to free some memory if possible (if there are volatile
+     * keys in the dataset). If there are not the only thing we can do
+     * is returning an error. */
+    // 如果服务器打开了内存上限功能，那么在执行命令之前，先检查是否需要回收内存
+    if (server.maxmemory) {
+        // 如果内存已超过限制，那么尝试通过删除过期键来释放内存
+        int retval = freeMemoryIfNeeded();
+        // 如果即将要执行的命令可能占用大量内存（REDIS_CMD_DENYOOM）
+        // 并且前面的内存释放失败的话
+        // 那么向客户端返回内存错误
+        if ((c->cmd->flags & REDIS_CMD_DENYOOM) && retval == REDIS_ERR) {
+            flagTransaction(c);
+            addReply(c, shared.oomerr);
+            return REDIS_OK;
+        }
+    }
+
+    /* Don't accept write commands if there are problems persisting on disk. */
+    // 如果这个服务器之前执行 BGSAVE 或者写入 AOF 时发生了错误
+    // 那么不执行写命令
+    if (((server.stop_writes_on_bgsave_err &&
+          server.saveparamslen > 0 &&
+          server.lastbgsave_status == REDIS_ERR) ||
+          server.aof_last_write_status == REDIS_ERR) &&
+        server.masterhost == NULL &&
+        c->cmd->flags & REDIS_CMD_WRITE)
+    {
+        flagTransaction(c);
+        if (server.aof_last_write_status == REDIS_OK)
+            addReply(c, shared.bgsaveerr);
+        else
+            addReplySds(c,
+                sdscatprintf(sdsempty(),
+                "-MISCONF Errors writing to the AOF file: %s\r\n",
+                strerror(server.aof_last_write_errno)));
+        return REDIS_OK;
+    }
+
+    /* Don't accept write commands if this is a read only slave. But
+     * accept write commands if this is our master. */
+    // 只读的从服务器只接受主服务器发来的写命令
+    if (server.masterhost && server.repl_slave_ro &&
+        !(c->flags & REDIS_MASTER) &&
+        c->cmd->flags & REDIS_CMD_WRITE)
+    {
+        flagTransaction(c);
+        addReply(c, shared.roslaveerr);
         return REDIS_OK;
     }
 
-    // 执行命令
-    call(c,REDIS_CALL_FULL);
+    /* Only allow SUBSCRIBE and UNSUBSCRIBE in the context of Pub/Sub */
+    // 在订阅与发布模式的上下文中，只能执行订阅、退订和 PING 命令
+    if (clientSubscriptionsCount(c) > 0 &&
+        c->cmd->proc != subscribeCommand &&
+        c->cmd->proc != unsubscribeCommand &&
+        c->cmd->proc != psubscribeCommand &&
+        c->cmd->proc != punsubscribeCommand &&
+        c->cmd->proc != pingCommand)
+    {
+        addReplyError(c,"only (P)SUBSCRIBE / (P)UNSUBSCRIBE / PING / QUIT allowed in this context");
+        return REDIS_OK;
+    }
+
+    /* Exec the command */
+    if (c->flags & REDIS_MULTI &&
+        c->cmd->proc != execCommand && c->cmd->proc != discardCommand &&
+        c->cmd->proc != multiCommand && c->cmd->proc != watchCommand)
+    {
+        // 在事务上下文中
+        // 除 EXEC 、 DISCARD 、 MULTI 和 WATCH 命令之外
+        // 其他所有命令都会被入队到事务队列中
+        queueMultiCommand(c);
+        addReply(c,shared.queued);
+    } else {
+        // 执行命令
+        call(c,REDIS_CALL_FULL);
+    }
+
+    return REDIS_OK;
+}
+
+/* This function gets called every time Redis is entering the
+ * main loop of the event driven library, that is, before to sleep
+ * for ready file descriptors.
+ *
+ * 每次处理事件之前执行
+ */
+void beforeSleep(struct aeEventLoop *eventLoop) {
+    REDIS_NOTUSED(eventLoop);
+
+    /* Keep the tracking table within its limit, and send the invalidation
+     * messages collected for the broadcast prefixes. */
+    // 将追踪表限制在上限以内，并发送广播模式下收集到的失效通知
+    trackingLimitUsedSlots();
+    trackingBroadcastInvalidationMessages();
+
+    /* Write the AOF buffer on disk */
+    // 将 AOF 缓冲区的内容写入到 AOF 文件
+    // 这次循环中执行的所有写命令共用一次 write()
+    flushAppendOnlyFile(0);
+}
+
+/* This function is called once a background process of some kind terminates,
+ * as we want to avoid resizing the hash tables when there is a child in order
+ * to play well with copy-on-write (otherwise when a resize happens lots of
+ * memory pages are copied). The goal of this function is to update the ability
+ * for dict.c to resize the hash tables accordingly to the fact we have or not
+ * running children.
+ *
+ * 子进程存在时禁止字典自动扩容，以免 rehash 导致大量内存页被写时复制。
+ */
+void updateDictResizePolicy(void) {
+    if (!hasActiveChildProcess())
+        dictEnableResize();
+    else
+        dictDisableResize();
+}
+
+/* Return true if there is a BGSAVE or BGREWRITEAOF child running.
+ *
+ * 有 BGSAVE 或者 BGREWRITEAOF 子进程正在运行时返回真。 */
+int hasActiveChildProcess(void) {
+    return server.rdb_child_pid != -1 || server.aof_child_pid != -1;
+}
+
+/* Exit from a forked child. The child must not run the atexit() handlers
+ * and flush the stdio buffers inherited from the parent, so _exit() is
+ * used.
+ *
+ * 子进程退出时使用 _exit() ，避免冲洗从父进程继承来的 stdio 缓冲区。
+ */
+void exitFromChild(int retcode) {
+    _exit(retcode);
+}
+
+/*================================== Shutdown =============================== */
+
+/* Close listening sockets. Used on shutdown and by the saving child, that
+ * has no business keeping the parent's ports open. */
+// 关闭监听套接字
+void closeListeningSockets(void) {
+    int j;
+
+    for (j = 0; j < server.ipfd_count; j++) close(server.ipfd[j]);
+}
+
+/*
+ * 关闭服务器之前的准备工作：
+ * 停止正在执行的 BGSAVE ，并且在需要时执行 SAVE 。
+ */
+int prepareForShutdown(int flags) {
+    int save = flags & REDIS_SHUTDOWN_SAVE;
+    int nosave = flags & REDIS_SHUTDOWN_NOSAVE;
+
+    redisLog(REDIS_WARNING,"User requested shutdown...");
+
+    /* Kill the saving child if there is a background saving in progress.
+       We want to avoid race conditions, for instance our saving child may
+       overwrite the synchronous saving did by SHUTDOWN. */
+    // 如果有 BGSAVE 正在执行，那么杀死子进程，避免竞争条件
+    if (server.rdb_child_pid != -1) {
+        redisLog(REDIS_WARNING,"There is a child saving an .rdb. Killing it!");
+        kill(server.rdb_child_pid,SIGUSR1);
+        // 移除临时文件
+        rdbRemoveTempFile(server.rdb_child_pid);
+    }
+
+    /* Kill the AOF rewriting child if there is one: the files in use are
+     * complete without it. */
+    // 杀死 AOF 重写子进程，正在使用的文件不需要它也是完整的
+    killAppendOnlyChild();
 
+    /* Flush the AOF buffer and sync the file before exiting. */
+    // 将 AOF 缓冲区写入并同步到文件
+    if (server.aof_state == REDIS_AOF_ON) {
+        redisLog(REDIS_NOTICE,"Calling fsync() on the AOF file.");
+        flushAppendOnlyFile(1);
+        aofFsync(server.aof_fd);
+    }
+
+    if ((server.saveparamslen > 0 && !nosave) || save) {
+        redisLog(REDIS_NOTICE,"Saving the final RDB snapshot before exiting.");
+        /* Snapshotting. Perform a SYNC SAVE and exit */
+        // 执行 SAVE 操作
+        if (rdbSave(server.rdb_filename) != REDIS_OK) {
+            /* Ooops.. error saving! The best we can do is to continue
+             * operating. Note that if there was a background saving process,
+             * in the next cron() Redis will be notified that the background
+             * saving aborted, handling special stuff like slaves pending for
+             * synchronization... */
+            redisLog(REDIS_WARNING,"Error trying to save the DB, can't exit.");
+            return REDIS_ERR;
+        }
+    }
+
+    /* Close the listening sockets. Apparently this allows faster restarts. */
+    // 关闭监听套接字，这样在重启的时候会快一点
+    closeListeningSockets();
+    redisLog(REDIS_WARNING,"Redis is now ready to exit, bye bye...");
     return REDIS_OK;
 }
 
+/*================================== Commands =============================== */
+
+/* Convert an amount of bytes into a human readable string in the form
+ * of 100B, 2G, 100M, 4K, and so forth. */
+void bytesToHuman(char *s, unsigned long long n) {
+    double d;
+
+    if (n < 1024) {
+        /* Bytes */
+        sprintf(s,"%lluB",n);
+        return;
+    } else if (n < (1024*1024)) {
+        d = (double)n/(1024);
+        sprintf(s,"%.2fK",d);
+    } else if (n < (1024LL*1024*1024)) {
+        d = (double)n/(1024*1024);
+        sprintf(s,"%.2fM",d);
+    } else if (n < (1024LL*1024*1024*1024)) {
+        d = (double)n/(1024LL*1024*1024);
+        sprintf(s,"%.2fG",d);
+    } else if (n < (1024LL*1024*1024*1024*1024)) {
+        d = (double)n/(1024LL*1024*1024*1024);
+        sprintf(s,"%.2fT",d);
+    } else {
+        /* Let's hope we never need this */
+        sprintf(s,"%lluB",n);
+    }
+}
+
+/* Create the string returned by the INFO command. This is decoupled
+ * by the INFO command itself as we need to report the same information
+ * on memory corruption problems. */
+sds genRedisInfoString(char *section) {
+    sds info = sdsempty();
+    time_t uptime;
+    int j, sections = 0;
+    int allsections = 0, defsections = 0;
+
+    if (section) {
+        allsections = strcasecmp(section,"all") == 0;
+        defsections = strcasecmp(section,"default") == 0;
+    }
+
+    uptime = time(NULL)-server.stat_starttime;
+
+    /* Server */
+    if (allsections || defsections || !strcasecmp(section,"server")) {
+        static int call_uname = 1;
+        static struct utsname name;
+
+        if (sections++) info = sdscat(info,"\r\n");
+
+        if (call_uname) {
+            /* Uname can be slow and is always the same output. Cache it. */
+            uname(&name);
+            call_uname = 0;
+        }
+
+        info = sdscatfmt(info,
+            "# Server\r\n"
+            "redis_version:%s\r\n"
+            "os:%s %s %s\r\n"
+            "arch_bits:%s\r\n"
+            "multiplexing_api:epoll\r\n"
+            "process_id:%I\r\n"
+            "tcp_port:%i\r\n"
+            "uptime_in_seconds:%I\r\n"
+            "uptime_in_days:%I\r\n"
+            "hz:%i\r\n",
+            REDIS_VERSION,
+            name.sysname, name.release, name.machine,
+            (sizeof(long) == 8) ? "64" : "32",
+            (long long) getpid(),
+            server.port,
+            (long long)uptime,
+            (long long)(uptime/(3600*24)),
+            server.hz);
+    }
+
+    /* Clients */
+    if (allsections || defsections || !strcasecmp(section,"clients")) {
+        if (sections++) info = sdscat(info,"\r\n");
+        info = sdscatfmt(info,
+            "# Clients\r\n"
+            "connected_clients:%U\r\n"
+            "maxclients:%i\r\n"
+            "tracking_clients:%U\r\n",
+            (unsigned long long)listLength(server.clients),
+            server.maxclients,
+            (unsigned long long)server.tracking_clients);
+    }
+
+    /* Memory */
+    if (allsections || defsections || !strcasecmp(section,"memory")) {
+        char hmem[64];
+        char peak_hmem[64];
+        char rss_hmem[64];
+        char maxmemory_hmem[64];
+        char frag[32];
+        size_t zmalloc_used = zmalloc_used_memory();
+
+        /* Peak memory is updated from time to time by serverCron() so it
+         * may happen that the instantaneous value is slightly bigger than
+         * the peak value. This may confuse users, so we update the peak
+         * if found smaller than the current memory usage. */
+        if (zmalloc_used > server.stat_peak_memory)
+            server.stat_peak_memory = zmalloc_used;
+
+        bytesToHuman(hmem,zmalloc_used);
+        bytesToHuman(peak_hmem,server.stat_peak_memory);
+        bytesToHuman(rss_hmem,server.resident_set_size);
+        bytesToHuman(maxmemory_hmem,server.maxmemory);
+        // sdscatfmt 不支持浮点数，先单独格式化
+        snprintf(frag,sizeof(frag),"%.2f",
+            zmalloc_get_fragmentation_ratio(server.resident_set_size));
+        if (sections++) info = sdscat(info,"\r\n");
+        info = sdscatfmt(info,
+            "# Memory\r\n"
+            "used_memory:%U\r\n"
+            "used_memory_human:%s\r\n"
+            "used_memory_rss:%U\r\n"
+            "used_memory_rss_human:%s\r\n"
+            "used_memory_peak:%U\r\n"
+            "used_memory_peak_human:%s\r\n"
+            "mem_fragmentation_ratio:%s\r\n"
+            "maxmemory:%U\r\n"
+            "maxmemory_human:%s\r\n"
+            "maxmemory_policy:%s\r\n"
+            "mem_allocator:libc\r\n"
+            "lazyfree_pending_objects:%U\r\n",
+            (unsigned long long)zmalloc_used,
+            hmem,
+            (unsigned long long)server.resident_set_size,
+            rss_hmem,
+            (unsigned long long)server.stat_peak_memory,
+            peak_hmem,
+            frag,
+            server.maxmemory,
+            maxmemory_hmem,
+            evictPolicyToString(),
+            (unsigned long long)lazyfreeGetPendingObjectsCount());
+    }
+
+    /* Persistence */
+    if (allsections || defsections || !strcasecmp(section,"persistence")) {
+        char load_kps[32], load_mbps[32], aof_load_cps[32];
+        double kps, mbps, cps;
+        long long fsyncs, fsync_usec;
+
+        rdbLoadThroughput(&kps,&mbps);
+        snprintf(load_kps,sizeof(load_kps),"%.0f",kps);
+        snprintf(load_mbps,sizeof(load_mbps),"%.2f",mbps);
+        aofLoadThroughput(&cps,&mbps);
+        snprintf(aof_load_cps,sizeof(aof_load_cps),"%.0f",cps);
+        if (sections++) info = sdscat(info,"\r\n");
+        info = sdscatfmt(info,
+            "# Persistence\r\n"
+            "loading:%i\r\n"
+            "rdb_changes_since_last_save:%I\r\n"
+            "rdb_bgsave_in_progress:%i\r\n"
+            "rdb_last_save_time:%I\r\n"
+            "rdb_last_bgsave_status:%s\r\n"
+            "rdb_last_bgsave_time_sec:%I\r\n"
+            "rdb_current_bgsave_time_sec:%I\r\n"
+            "rdb_last_cow_size:%U\r\n"
+            "rdb_last_load_keys_loaded:%I\r\n"
+            "rdb_last_load_usec:%I\r\n"
+            "rdb_last_load_threads:%i\r\n"
+            "rdb_last_load_keys_per_sec:%s\r\n"
+            "rdb_last_load_mb_per_sec:%s\r\n",
+            server.loading,
+            server.dirty,
+            server.rdb_child_pid != -1,
+            (long long)server.lastsave,
+            (server.lastbgsave_status == REDIS_OK) ? "ok" : "err",
+            (long long)server.rdb_save_time_last,
+            (long long)((server.rdb_child_pid == -1) ?
+                -1 : time(NULL)-server.rdb_save_time_start),
+            (unsigned long long)server.stat_rdb_cow_bytes,
+            server.stat_rdb_load_keys,
+            server.stat_rdb_load_usec,
+            server.stat_rdb_load_threads,
+            load_kps,
+            load_mbps);
+
+        info = sdscatfmt(info,
+            "aof_rewrite_in_progress:%i\r\n"
+            "aof_rewrite_scheduled:%i\r\n"
+            "aof_last_rewrite_time_sec:%I\r\n"
+            "aof_current_rewrite_time_sec:%I\r\n"
+            "aof_last_bgrewrite_status:%s\r\n"
+            "aof_last_cow_size:%U\r\n"
+            "aof_base_size:%I\r\n"
+            "aof_incr_files:%U\r\n"
+            "aof_last_load_commands:%I\r\n"
+            "aof_last_load_usec:%I\r\n"
+            "aof_last_load_commands_per_sec:%s\r\n",
+            server.aof_child_pid != -1,
+            server.aof_rewrite_scheduled,
+            (long long)server.aof_rewrite_time_last,
+            (long long)((server.aof_child_pid == -1) ?
+                -1 : time(NULL)-server.aof_rewrite_time_start),
+            (server.aof_lastbgrewrite_status == REDIS_OK) ? "ok" : "err",
+            (unsigned long long)server.stat_aof_cow_bytes,
+            (long long)server.aof_rewrite_base_size,
+            (unsigned long long)listLength(server.aof_manifest->incr_aof_list),
+            server.stat_aof_load_commands,
+            server.stat_aof_load_usec,
+            aof_load_cps);
+
+        // fsync 的统计数据可能正在被后台线程更新
+        fsyncs = __atomic_load_n(&server.stat_aof_fsyncs,__ATOMIC_RELAXED);
+        fsync_usec = __atomic_load_n(&server.stat_aof_fsync_usec,
+                                     __ATOMIC_RELAXED);
+        info = sdscatfmt(info,
+            "aof_enabled:%i\r\n"
+            "aof_fsync_policy:%s\r\n"
+            "aof_last_write_status:%s\r\n"
+            "aof_current_size:%I\r\n"
+            "aof_buffer_length:%U\r\n"
+            "aof_pending_bio_fsync:%U\r\n"
+            "aof_delayed_fsync:%U\r\n"
+            "aof_writes:%I\r\n"
+            "aof_last_write_usec:%I\r\n"
+            "aof_avg_write_usec:%I\r\n"
+            "aof_max_write_usec:%I\r\n"
+            "aof_fsyncs:%I\r\n"
+            "aof_last_fsync_usec:%I\r\n"
+            "aof_avg_fsync_usec:%I\r\n"
+            "aof_max_fsync_usec:%I\r\n",
+            server.aof_state != REDIS_AOF_OFF,
+            aofFsyncPolicyToString(),
+            (server.aof_last_write_status == REDIS_OK) ? "ok" : "err",
+            (long long) server.aof_current_size,
+            (unsigned long long) sdslen(server.aof_buf),
+            bioPendingJobsOfType(BIO_AOF_FSYNC),
+            (unsigned long long) server.aof_delayed_fsync,
+            server.stat_aof_writes,
+            server.stat_aof_write_usec_last,
+            server.stat_aof_writes ?
+                server.stat_aof_write_usec/server.stat_aof_writes : 0,
+            server.stat_aof_write_usec_max,
+            fsyncs,
+            __atomic_load_n(&server.stat_aof_fsync_usec_last,__ATOMIC_RELAXED),
+            fsyncs ? fsync_usec/fsyncs : 0,
+            __atomic_load_n(&server.stat_aof_fsync_usec_max,__ATOMIC_RELAXED));
+    }
+
+    /* Stats */
+    if (allsections || defsections || !strcasecmp(section,"stats")) {
+        char input_kbps[32], output_kbps[32];
+
+        snprintf(input_kbps,sizeof(input_kbps),"%.2f",
+            (float)getInstantaneousMetric(REDIS_METRIC_NET_INPUT)/1024);
+        snprintf(output_kbps,sizeof(output_kbps),"%.2f",
+            (float)getInstantaneousMetric(REDIS_METRIC_NET_OUTPUT)/1024);
+        if (sections++) info = sdscat(info,"\r\n");
+        info = sdscatfmt(info,
+            "# Stats\r\n"
+            "total_connections_received:%I\r\n"
+            "total_commands_processed:%I\r\n"
+            "instantaneous_ops_per_sec:%I\r\n"
+            "total_net_input_bytes:%I\r\n"
+            "total_net_output_bytes:%I\r\n"
+            "instantaneous_input_kbps:%s\r\n"
+            "instantaneous_output_kbps:%s\r\n"
+            "rejected_connections:%I\r\n"
+            "expired_keys:%I\r\n"
+            "expire_cycle_time_cap_hits:%I\r\n"
+            "evicted_keys:%I\r\n"
+            "pubsub_channels:%I\r\n"
+            "pubsub_patterns:%I\r\n"
+            "tracking_total_keys:%I\r\n"
+            "tracking_total_prefixes:%I\r\n"
+            "latest_fork_usec:%I\r\n"
+            "sync_full:%I\r\n"
+            "sync_partial_ok:%I\r\n"
+            "sync_partial_err:%I\r\n",
+            server.stat_numconnections,
+            server.stat_numcommands,
+            getInstantaneousMetric(REDIS_METRIC_COMMAND),
+            server.stat_net_input_bytes,
+            server.stat_net_output_bytes,
+            input_kbps,
+            output_kbps,
+            server.stat_rejected_conn,
+            server.stat_expiredkeys,
+            server.stat_expire_cycle_time_cap,
+            server.stat_evictedkeys,
+            (long long)dictSize(server.pubsub_channels),
+            (long long)server.pubsub_numpat,
+            (long long)dictSize(server.tracking_table),
+            (long long)server.tracking_total_prefixes,
+            server.stat_fork_time,
+            server.stat_sync_full,
+            server.stat_sync_partial_ok,
+            server.stat_sync_partial_err);
+    }
+
+    /* Replication */
+    if (allsections || defsections || !strcasecmp(section,"replication")) {
+        if (sections++) info = sdscat(info,"\r\n");
+        info = genReplicationInfoString(info);
+    }
+
+    /* Cluster */
+    if (allsections || defsections || !strcasecmp(section,"cluster")) {
+        if (sections++) info = sdscat(info,"\r\n");
+        info = sdscatprintf(info,
+        "# Cluster\r\n"
+        "cluster_enabled:%d\r\n",
+        server.cluster_enabled);
+    }
+
+    /* Key space */
+    if (allsections || defsections || !strcasecmp(section,"keyspace")) {
+        if (sections++) info = sdscat(info,"\r\n");
+        info = sdscat(info, "# Keyspace\r\n");
+        for (j = 0; j < server.dbnum; j++) {
+            dictStats st;
+            char fill[32], used_pct[32], avg_chain[32];
+
+            if (dictSize(server.db[j].dict) == 0) continue;
+
+            // 键的数量，以及哈希表的填充率和链表长度
+            dictGetStats(server.db[j].dict,&st);
+            snprintf(fill,sizeof(fill),"%.2f",
+                (double)st.elements/st.buckets);
+            snprintf(used_pct,sizeof(used_pct),"%.2f",
+                st.sampled ? (double)st.used_buckets*100/st.sampled : 0);
+            snprintf(avg_chain,sizeof(avg_chain),"%.2f",
+                st.used_buckets ? (double)st.chain_total/st.used_buckets : 0);
+            info = sdscatfmt(info,
+                "db%i:keys=%U,expires=%U,buckets=%U,fill=%s,"
+                "used_buckets_pct=%s,avg_chain=%s,max_chain=%U\r\n",
+                j, (unsigned long long)st.elements,
+                (unsigned long long)dictSize(server.db[j].expires),
+                (unsigned long long)st.buckets,
+                fill, used_pct, avg_chain,
+                (unsigned long long)st.max_chain);
+        }
+    }
+    return info;
+}
+
+/*
+ * PING [message]
+ */
+void pingCommand(redisClient *c) {
+    /* The command takes zero or one arguments. */
+    if (c->argc > 2) {
+        addReplyErrorFormat(c,"wrong number of arguments for '%s' command",
+            c->cmd->name);
+        return;
+    }
+
+    // 订阅模式下的 PING 以多条批量回复的形式返回
+    if (clientSubscriptionsCount(c) > 0) {
+        addReplyMultiBulkLen(c,2);
+        addReplyBulkCString(c,"pong");
+        if (c->argc == 1)
+            addReplyBulkCString(c,"");
+        else
+            addReplyBulk(c,c->argv[1]);
+    } else if (c->argc == 1) {
+        addReply(c,shared.pong);
+    } else {
+        addReplyBulk(c,c->argv[1]);
+    }
+}
+
+/*
+ * LASTSAVE
+ */
+void lastsaveCommand(redisClient *c) {
+    addReplyLongLong(c,server.lastsave);
+}
+
+/*
+ * INFO [section]
+ */
+void infoCommand(redisClient *c) {
+    char *section = c->argc == 2 ? c->argv[1]->ptr : "default";
 
-int main(void)
+    if (c->argc > 2) {
+        addReply(c,shared.syntaxerr);
+        return;
+    }
+    addReplyBulkSds(c, genRedisInfoString(section));
+}
+
+#ifdef REDIS_TEST
+/*
+ * 命令查找的微基准测试：完美哈希 vs 命令表字典
+ *
+ * Build with 'make REDIS_CFLAGS=-DREDIS_TEST' and run with
+ * './redis-server test cmdlookup [iterations]'.
+ */
+int cmdlookupBenchmark(long long iterations) {
+    char *names[] = {"get","SET","Info","GeT","set","nosuchcommand","INFO"};
+    int numnames = sizeof(names)/sizeof(names[0]);
+    sds snames[sizeof(names)/sizeof(names[0])];
+    long long j, start, elapsed;
+    unsigned long found;
+    int k;
+
+    for (k = 0; k < numnames; k++) snames[k] = sdsnew(names[k]);
+
+    found = 0;
+    start = ustime();
+    for (j = 0; j < iterations; j++)
+        found += dictFetchValue(server.commands,snames[j%numnames]) != NULL;
+    elapsed = ustime()-start;
+    printf("dict lookup:         %.2f ns/op (%lu found)\n",
+        (double)elapsed*1000/iterations, found);
+
+    found = 0;
+    start = ustime();
+    for (j = 0; j < iterations; j++)
+        found += lookupCommandByPerfectHash(snames[j%numnames],
+                    sdslen(snames[j%numnames])) != NULL;
+    elapsed = ustime()-start;
+    printf("perfect hash lookup: %.2f ns/op (%lu found)\n",
+        (double)elapsed*1000/iterations, found);
+
+    for (k = 0; k < numnames; k++) sdsfree(snames[k]);
+    return 0;
+}
+#endif
+
+/*
+ * 启动时载入数据：AOF 打开时载入 AOF 文件，否则载入 RDB 文件
+ */
+void loadDataFromDisk(void) {
+    // AOF 持久化已打开，AOF 文件总是比 RDB 文件更新
+    if (server.aof_state == REDIS_AOF_ON) {
+        if (loadAppendOnlyFiles(server.aof_manifest) == REDIS_OK) {
+            double cps, mbps;
+
+            aofLoadThroughput(&cps,&mbps);
+            redisLog(REDIS_NOTICE,"DB loaded from append only file: "
+                "%lld commands in %.3f seconds (%.0f commands/sec, "
+                "%.2f MB/sec)",
+                server.stat_aof_load_commands,
+                (double)server.stat_aof_load_usec/1000000,
+                cps, mbps);
+        } else if (errno != ENOENT) {
+            redisLog(REDIS_WARNING,"Fatal error loading the AOF: %s. Exiting.",
+                strerror(errno));
+            exit(1);
+        }
+    } else if (rdbLoad(server.rdb_filename) == REDIS_OK) {
+        double kps, mbps;
+
+        rdbLoadThroughput(&kps,&mbps);
+        redisLog(REDIS_NOTICE,"DB loaded from disk: %lld keys in %.3f seconds "
+            "(%.0f keys/sec, %.2f MB/sec, %d threads)",
+            server.stat_rdb_load_keys,
+            (double)server.stat_rdb_load_usec/1000000,
+            kps, mbps, server.stat_rdb_load_threads);
+    } else if (errno != ENOENT) {
+        redisLog(REDIS_WARNING,"Fatal error loading the DB: %s. Exiting.",
+            strerror(errno));
+        exit(1);
+    }
+}
+
+void version(void) {
+    printf("Redis server v=%s bits=%d\n",
+        REDIS_VERSION, (sizeof(long) == 8) ? 64 : 32);
+    exit(0);
+}
+
+void usage(void) {
+    fprintf(stderr,"Usage: ./redis-server [/path/to/redis.conf] [options]\n");
+    fprintf(stderr,"       ./redis-server - (read config from stdin)\n");
+    fprintf(stderr,"       ./redis-server -v or --version\n");
+    fprintf(stderr,"       ./redis-server -h or --help\n\n");
+    fprintf(stderr,"Examples:\n");
+    fprintf(stderr,"       ./redis-server (run the server with default conf)\n");
+    fprintf(stderr,"       ./redis-server /etc/redis/6379.conf\n");
+    fprintf(stderr,"       ./redis-server --port 7777\n");
+    fprintf(stderr,"       ./redis-server /etc/myredis.conf --loglevel verbose\n");
+    exit(1);
+}
+
+int main(int argc, char **argv)
 {
+#ifdef REDIS_TEST
+    if (argc >= 3 && !strcasecmp(argv[1], "test")) {
+        if (!strcasecmp(argv[2], "cmdlookup")) {
+            initServerConfig();
+            return cmdlookupBenchmark(argc >= 4 ? atoll(argv[3]) : 10000000);
+        } else if (!strcasecmp(argv[2], "sds")) {
+            return sdsBenchmark(argc >= 4 ? atoll(argv[3]) : 10000000);
+        } else if (!strcasecmp(argv[2], "embstr")) {
+            initServerConfig();
+            return stringObjectBenchmark(argc >= 4 ? atoll(argv[3]) : 1000000);
+        } else if (!strcasecmp(argv[2], "zmalloc")) {
+            return zmallocTest(argc >= 4 ? atoll(argv[3]) : 1000000,
+                               argc >= 5 ? atoi(argv[4]) : 8);
+        } else if (!strcasecmp(argv[2], "crc64")) {
+            return crc64Test(argc >= 4 ? atoll(argv[3]) : 100000);
+        }
+        return -1; /* test not found */
+    }
+#endif
+
+    // 生成 CRC64 查找表，之后 fork 出的子进程直接继承
+    crc64_init();
+
 	initServerConfig();
+
+    // 检查用户是否指定了配置文件，或者配置选项
+    if (argc >= 2) {
+        int j = 1; /* First option to parse in argv[] */
+        sds options = sdsempty();
+        char *configfile = NULL;
+
+        /* Handle special options --help and --version */
+        // 处理特殊选项 -h 、-v 和 --help 、--version
+        if (strcmp(argv[1], "-v") == 0 ||
+            strcmp(argv[1], "--version") == 0) version();
+        if (strcmp(argv[1], "--help") == 0 ||
+            strcmp(argv[1], "-h") == 0) usage();
+
+        /* First argument is the config file name? */
+        // 如果第一个参数（argv[1]）不是以 "--" 开头
+        // 那么它应该是一个配置文件
+        if (argv[j][0] != '-' || argv[j][1] != '-')
+            configfile = argv[j++];
+
+        /* All the other options are parsed and conceptually appended to the
+         * configuration file. For instance --port 6380 will generate the
+         * string "port 6380\n" to be parsed after the actual file name
+         * is parsed, if any. */
+        // 对用户给定的其余选项进行分析，并将分析所得的字符串追加稍后载入的配置文件的内容之后
+        // 比如 --port 6380 会被分析为 "port 6380\n"
+        while(j != argc) {
+            if (argv[j][0] == '-' && argv[j][1] == '-') {
+                /* Option name */
+                if (sdslen(options)) options = sdscat(options,"\n");
+                options = sdscat(options,argv[j]+2);
+                options = sdscat(options," ");
+            } else {
+                /* Option argument */
+                options = sdscatrepr(options,argv[j],strlen(argv[j]));
+                options = sdscat(options," ");
+            }
+            j++;
+        }
+        if (configfile) {
+            char abspath[PATH_MAX];
+
+            server.configfile = zstrdup(realpath(configfile,abspath) ?
+                                        abspath : configfile);
+        }
+
+        // 载入配置文件， options 是前面分析出的给定选项
+        loadServerConfig(configfile,options);
+        sdsfree(options);
+    } else {
+        redisLog(REDIS_WARNING, "Warning: no config file specified, using the default config. In order to specify a config file use %s /path/to/redis.conf", argv[0]);
+    }
+
 	initServer();
-    
+
+    // 从 RDB 文件中载入数据
+    aofLoadManifestFromDisk();
+    loadDataFromDisk();
+    aofOpenIfNeededOnServerStart();
+
+    // 运行事件处理器，一直到服务器关闭为止
+    aeSetBeforeSleepProc(server.el,beforeSleep);
     aeMain(server.el);
 	return 0;
 }
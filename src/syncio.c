@@ -0,0 +1,132 @@
+/* Synchronous socket and file I/O operations useful across the core.
+ *
+ * 带超时的同步 I/O 操作
+ *
+ * Redis performs most of the I/O in a nonblocking way, with the exception
+ * of the SYNC command where the slave does it in a blocking way, and
+ * the MIGRATE command that must be blocking in order to be atomic from the
+ * point of view of the two instances (one migrating the key and one receiving
+ * the key). This is why need the following blocking I/O functions.
+ *
+ * Redis 的大部分 I/O 都是非阻塞的，
+ * 只有复制的握手阶段以阻塞的方式执行，这里是它使用的阻塞 I/O 函数。
+ *
+ * All the functions take the timeout in milliseconds.
+ *
+ * 所有函数的超时时间都以毫秒为单位。
+ */
+
+#include "redis.h"
+
+#define REDIS_SYNCIO_RESOLUTION 10 /* Resolution in milliseconds */
+
+/* Write the specified payload to 'fd'. If writing the whole payload will be
+ * done within 'timeout' milliseconds the operation succeeds and 'size' is
+ * returned. Otherwise the operation fails, -1 is returned, and an unspecified
+ * partial write could be performed against the file descriptor.
+ *
+ * 在 timeout 毫秒之内将 ptr 中的 size 个字节写入到 fd ，
+ * 成功返回 size ，超时或者出错返回 -1 。 */
+ssize_t syncWrite(int fd, char *ptr, ssize_t size, long long timeout) {
+    ssize_t nwritten, ret = size;
+    long long start = mstime();
+    long long remaining = timeout;
+
+    while(1) {
+        long long wait = (remaining > REDIS_SYNCIO_RESOLUTION) ?
+                          remaining : REDIS_SYNCIO_RESOLUTION;
+        long long elapsed;
+
+        /* Optimistically try to write before checking if the file descriptor
+         * is actually writable. At worst we get EAGAIN. */
+        nwritten = write(fd,ptr,size);
+        if (nwritten == -1) {
+            if (errno != EAGAIN) return -1;
+        } else {
+            ptr += nwritten;
+            size -= nwritten;
+        }
+        if (size == 0) return ret;
+
+        /* Wait */
+        aeWait(fd,AE_WRITABLE,wait);
+        elapsed = mstime() - start;
+        if (elapsed >= timeout) {
+            errno = ETIMEDOUT;
+            return -1;
+        }
+        remaining = timeout - elapsed;
+    }
+}
+
+/* Read the specified amount of bytes from 'fd'. If all the bytes are read
+ * within 'timeout' milliseconds the operation succeed and 'size' is returned.
+ * Otherwise the operation fails, -1 is returned, and an unspecified amount of
+ * data could be read from the file descriptor.
+ *
+ * 在 timeout 毫秒之内从 fd 读取 size 个字节到 ptr ，
+ * 成功返回 size ，超时或者出错返回 -1 。 */
+ssize_t syncRead(int fd, char *ptr, ssize_t size, long long timeout) {
+    ssize_t nread, totread = 0;
+    long long start = mstime();
+    long long remaining = timeout;
+
+    if (size == 0) return 0;
+    while(1) {
+        long long wait = (remaining > REDIS_SYNCIO_RESOLUTION) ?
+                          remaining : REDIS_SYNCIO_RESOLUTION;
+        long long elapsed;
+
+        /* Optimistically try to read before checking if the file descriptor
+         * is actually readable. At worst we get EAGAIN. */
+        nread = read(fd,ptr,size);
+        if (nread == 0) return -1; /* short read. */
+        if (nread == -1) {
+            if (errno != EAGAIN) return -1;
+        } else {
+            ptr += nread;
+            size -= nread;
+            totread += nread;
+        }
+        if (size == 0) return totread;
+
+        /* Wait */
+        aeWait(fd,AE_READABLE,wait);
+        elapsed = mstime() - start;
+        if (elapsed >= timeout) {
+            errno = ETIMEDOUT;
+            return -1;
+        }
+        remaining = timeout - elapsed;
+    }
+}
+
+/* Read a line making sure that every char will not require more than 'timeout'
+ * milliseconds to be read.
+ *
+ * On success the number of bytes read is returned, otherwise -1.
+ * On success the string is always correctly terminated with a 0 byte.
+ *
+ * 读取一行，"\r\n" 不会被保存到 ptr 中。
+ * 成功返回读取的字节数，出错返回 -1 。 */
+ssize_t syncReadLine(int fd, char *ptr, ssize_t size, long long timeout) {
+    ssize_t nread = 0;
+
+    size--;
+    while(size) {
+        char c;
+
+        if (syncRead(fd,&c,1,timeout) == -1) return -1;
+        if (c == '\n') {
+            *ptr = '\0';
+            if (nread && *(ptr-1) == '\r') *(ptr-1) = '\0';
+            return nread;
+        } else {
+            *ptr++ = c;
+            *ptr = '\0';
+            nread++;
+        }
+        size--;
+    }
+    return nread;
+}
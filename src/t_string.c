@@ -1,16 +1,157 @@
 #include "redis.h"
 
-void setCommand(redisClient *c) {
-    setGenericCommand(c,c->argv[1],c->argv[2]);
-}
+/*-----------------------------------------------------------------------------
+ * String Commands
+ *----------------------------------------------------------------------------*/
+
+/* The setGenericCommand() function implements the SET operation with different
+ * options and variants. This function is called in order to implement the
+ * following commands: SET, SETEX, PSETEX.
+ *
+ * setGenericCommand() 函数实现了 SET 、 SETEX 和 PSETEX 命令。
+ *
+ * 'flags' changes the behavior of the command (NX or XX, see belove).
+ *
+ * flags 参数的值可以是 NX 或 XX ，它们的意义请见下文。
+ *
+ * 'expire' represents an expire to set in form of a Redis object as passed
+ * by the user. It is interpreted according to the specified 'unit'.
+ *
+ * expire 定义了 Redis 对象的过期时间。
+ *
+ * 而这个过期时间的格式由 unit 参数指定。
+ *
+ * 'ok_reply' and 'abort_reply' is what the function will reply to the client
+ * if the operation is performed, or when it is not because of NX or
+ * XX flags.
+ *
+ * ok_reply 和 abort_reply 决定了命令回复的内容，
+ * NX 参数和 XX 参数也会改变回复。
+ *
+ * If ok_reply is NULL "+OK" is used.
+ * If abort_reply is NULL, "$-1" is used.
+ *
+ * 如果 ok_reply 为 NULL ，那么 "+OK" 被返回。
+ * 如果 abort_reply 为 NULL ，那么 "$-1" 被返回。
+ */
+
+#define REDIS_SET_NO_FLAGS 0
+#define REDIS_SET_NX (1<<0)     /* Set if key not exists. */
+#define REDIS_SET_XX (1<<1)     /* Set if key exists. */
+
+void setGenericCommand(redisClient *c, int flags, robj *key, robj *val, robj *expire, int unit, robj *ok_reply, robj *abort_reply) {
 
-void setGenericCommand(redisClient *c, robj *key, robj *val) {
-    setKey(c->db,key,val);//set key=val in db
+    long long milliseconds = 0; /* initialized to avoid any harmness warning */
+
+    // 取出过期时间
+    if (expire) {
+
+        // 取出 expire 参数的值
+        // T = O(N)
+        if (getLongLongFromObjectOrReply(c, expire, &milliseconds, NULL) != REDIS_OK)
+            return;
+
+        // expire 参数的值不正确，或者转换为绝对时间之后会溢出时报错
+        if (milliseconds <= 0 ||
+            (unit == UNIT_SECONDS && milliseconds > LLONG_MAX/1000))
+        {
+            addReplyErrorFormat(c,"invalid expire time in %s",c->cmd->name);
+            return;
+        }
+
+        // 不论输入的过期时间是秒还是毫秒
+        // Redis 实际都以毫秒的形式保存过期时间
+        // 如果输入的过期时间为秒，那么将它转换为毫秒
+        if (unit == UNIT_SECONDS) milliseconds *= 1000;
+
+        if (milliseconds > LLONG_MAX-mstime()) {
+            addReplyErrorFormat(c,"invalid expire time in %s",c->cmd->name);
+            return;
+        }
+    }
+
+    // 如果设置了 NX 或者 XX 参数，那么检查条件是否不符合这两个设置
+    // 在条件不符合时报错，报错的内容由 abort_reply 参数决定
+    if ((flags & REDIS_SET_NX && lookupKeyWrite(c->db,key) != NULL) ||
+        (flags & REDIS_SET_XX && lookupKeyWrite(c->db,key) == NULL))
+    {
+        addReply(c, abort_reply ? abort_reply : shared.nullbulk);
+        return;
+    }
+
+    // 将键值关联到数据库
+    setKey(c->db,key,val);
+
+    // 将数据库设为脏
+    server.dirty++;
+
+    // 为键设置过期时间
+    if (expire) setExpire(c->db,key,mstime()+milliseconds);
 
     // 设置成功，向客户端发送回复
     // 回复的内容由 ok_reply 决定
-    
-    addReply(c, shared.ok);
+    addReply(c, ok_reply ? ok_reply : shared.ok);
+}
+
+/* SET key value [NX] [XX] [EX <seconds>] [PX <milliseconds>]
+ *
+ * EX 和 PX 只能给出其中一个，并且只能给出一次
+ */
+void setCommand(redisClient *c) {
+    int j;
+    robj *expire = NULL;
+    int unit = UNIT_SECONDS;
+    int flags = REDIS_SET_NO_FLAGS;
+
+    // 设置选项参数
+    for (j = 3; j < c->argc; j++) {
+        char *a = c->argv[j]->ptr;
+        robj *next = (j == c->argc-1) ? NULL : c->argv[j+1];
+
+        if ((a[0] == 'n' || a[0] == 'N') &&
+            (a[1] == 'x' || a[1] == 'X') && a[2] == '\0') {
+            flags |= REDIS_SET_NX;
+        } else if ((a[0] == 'x' || a[0] == 'X') &&
+                   (a[1] == 'x' || a[1] == 'X') && a[2] == '\0') {
+            flags |= REDIS_SET_XX;
+        } else if ((a[0] == 'e' || a[0] == 'E') &&
+                   (a[1] == 'x' || a[1] == 'X') && a[2] == '\0' && next &&
+                   expire == NULL) {
+            unit = UNIT_SECONDS;
+            expire = next;
+            j++;
+        } else if ((a[0] == 'p' || a[0] == 'P') &&
+                   (a[1] == 'x' || a[1] == 'X') && a[2] == '\0' && next &&
+                   expire == NULL) {
+            unit = UNIT_MILLISECONDS;
+            expire = next;
+            j++;
+        } else {
+            addReply(c,shared.syntaxerr);
+            return;
+        }
+    }
+
+    // NX 和 XX 不能同时使用
+    if ((flags & REDIS_SET_NX) && (flags & REDIS_SET_XX)) {
+        addReply(c,shared.syntaxerr);
+        return;
+    }
+
+    // 尝试对值对象进行编码
+    c->argv[2] = tryObjectEncoding(c->argv[2]);
+
+    setGenericCommand(c,flags,c->argv[1],c->argv[2],expire,unit,NULL,NULL);
+}
+
+void setexCommand(redisClient *c) {
+    c->argv[3] = tryObjectEncoding(c->argv[3]);
+    setGenericCommand(c,REDIS_SET_NO_FLAGS,c->argv[1],c->argv[3],c->argv[2],UNIT_SECONDS,NULL,NULL);
+}
+
+void psetexCommand(redisClient *c) {
+    c->argv[3] = tryObjectEncoding(c->argv[3]);
+    setGenericCommand(c,REDIS_SET_NO_FLAGS,c->argv[1],c->argv[3],c->argv[2],UNIT_MILLISECONDS,NULL,NULL);
 }
 
 void getCommand(redisClient *c) {
@@ -22,17 +163,16 @@ int getGenericCommand(redisClient *c) {
 
     // 尝试从数据库中取出键 c->argv[1] 对应的值对象
     // 如果键不存在时，向客户端发送回复信息，并返回 NULL
-    if ((o = lookupKeyRead(c,c->argv[1])) == NULL)
-    {
-        redisPanic("getCmd:no key\n");
+    if ((o = lookupKeyRead(c,c->argv[1])) == NULL) {
+        addReply(c,shared.nullbulk);
         return REDIS_OK;
     }
-        
 
     // 值对象存在，检查它的类型
     if (o->type != REDIS_STRING) {
         // 类型错误
-        redisPanic("get type error");
+        addReply(c,shared.wrongtypeerr);
+        return REDIS_ERR;
     } else {
         // 类型正确，向客户端返回对象的值
         addReplyBulk(c,o);
@@ -41,42 +181,271 @@ int getGenericCommand(redisClient *c) {
     }
 }
 
-/* Add a Redis Object as a bulk reply 
+/* Max number of values MGET keeps on the stack before allocating. */
+#define MGET_STACK_VALUES 64
+
+/*
+ * MGET key [key ...]
  *
- * 返回一个 Redis 对象作为回复
+ * All the keys are looked up first (bucket prefetch, then lookups), so that
+ * the exact size of the whole reply is known before writing anything: the
+ * reply is then formatted in place with a single addReplyReserve() call.
+ *
+ * 先批量查找所有键，计算出整个回复的长度，
+ * 然后只预留一次回复空间，直接在其中格式化回复。
  */
-void addReplyBulk(redisClient *c, robj *obj) {
-    addReplyBulkLen(c,obj);
-    addReply(c,obj);
-    addReply(c,shared.crlf);
+void mgetCommand(redisClient *c) {
+    int j, numkeys = c->argc-1;
+    robj *stackvals[MGET_STACK_VALUES], **vals = stackvals;
+    size_t totlen;
+    char *p;
+
+    if (numkeys > MGET_STACK_VALUES) vals = zmalloc(sizeof(robj*)*numkeys);
+
+    // 预取所有键所在的哈希桶
+    for (j = 0; j < numkeys; j++)
+        dictPrefetch(c->db->dict,c->argv[j+1]->ptr);
+
+    // 查找所有键，并计算回复的总长度
+    // *<numkeys>\r\n
+    totlen = 1+digits10(numkeys)+2;
+    for (j = 0; j < numkeys; j++) {
+        robj *o = lookupKeyRead(c,c->argv[j+1]);
+
+        // 键不存在，或者不是字符串，返回空回复
+        if (o == NULL || o->type != REDIS_STRING) {
+            vals[j] = NULL;
+            totlen += 5; /* $-1\r\n */
+        } else {
+            size_t len = stringObjectLen(o);
+
+            vals[j] = o;
+            // $<len>\r\n<value>\r\n
+            totlen += 1+digits10(len)+2+len+2;
+        }
+    }
+
+    // 一次性预留整个回复的空间
+    p = addReplyReserve(c,totlen);
+    if (p != NULL) {
+        *p++ = '*';
+        p += ll2string(p,32,numkeys);
+        *p++ = '\r'; *p++ = '\n';
+        for (j = 0; j < numkeys; j++) {
+            if (vals[j] == NULL) {
+                memcpy(p,"$-1\r\n",5);
+                p += 5;
+            } else if (vals[j]->encoding == REDIS_ENCODING_INT) {
+                // 整数编码的值直接格式化到回复中
+                char buf[32];
+                int len = ll2string(buf,sizeof(buf),(long)vals[j]->ptr);
+
+                *p++ = '$';
+                p += ll2string(p,32,len);
+                *p++ = '\r'; *p++ = '\n';
+                memcpy(p,buf,len);
+                p += len;
+                *p++ = '\r'; *p++ = '\n';
+            } else {
+                size_t len = sdslen(vals[j]->ptr);
+
+                *p++ = '$';
+                p += ll2string(p,32,len);
+                *p++ = '\r'; *p++ = '\n';
+                memcpy(p,vals[j]->ptr,len);
+                p += len;
+                *p++ = '\r'; *p++ = '\n';
+            }
+        }
+    }
+
+    if (vals != stackvals) zfree(vals);
 }
 
-/* Create the length prefix of a bulk reply, example: $2234 */
-void addReplyBulkLen(redisClient *c, robj *obj) {
-    size_t len;
+/*
+ * MSET / MSETNX 命令的实现函数
+ */
+void msetGenericCommand(redisClient *c, int nx) {
+    int j, busykeys = 0;
 
-    if (sdsEncodedObject(obj)) {
-        len = sdslen(obj->ptr);
-    } else {
-        long n = (long)obj->ptr;
+    // 键值参数不是成相成对出现的，格式不正确
+    if ((c->argc % 2) == 0) {
+        addReplyError(c,"wrong number of arguments for MSET");
+        return;
+    }
 
-        /* Compute how many bytes will take this integer as a radix 10 string */
-        len = 1;
-        if (n < 0) {
-            len++;
-            n = -n;
+    /* Handle the NX flag. The MSETNX semantic is to return zero and don't
+     * set nothing at all if at least one already key exists. */
+    // 如果 nx 参数为真，那么检查所有输入键在数据库中是否存在
+    // 只要有一个键是存在的，那么就向客户端发送空回复
+    // 并放弃执行接下来的设置操作
+    if (nx) {
+        for (j = 1; j < c->argc; j += 2) {
+            if (lookupKeyWrite(c->db,c->argv[j]) != NULL) {
+                busykeys++;
+                break;
+            }
         }
-        while((n = n/10) != 0) {
-            len++;
+        // 键存在
+        // 发送空白回复，并放弃执行接下来的设置操作
+        if (busykeys) {
+            addReply(c, shared.czero);
+            return;
         }
     }
 
-    if (len < REDIS_SHARED_BULKHDR_LEN)
-        addReply(c,shared.bulkhdr[len]);
-    else
-        // addReplyLongLongWithPrefix(c,len,'$');
-        redisPanic("addReplyBulkLen() error");
+    // 设置所有键值对
+    for (j = 1; j < c->argc; j += 2) {
+        // 对值对象进行解码
+        c->argv[j+1] = tryObjectEncoding(c->argv[j+1]);
+        setKey(c->db,c->argv[j],c->argv[j+1]);
+    }
+
+    // 将服务器设为脏
+    server.dirty += (c->argc-1)/2;
+
+    addReply(c, nx ? shared.cone : shared.ok);
+}
+
+void msetCommand(redisClient *c) {
+    msetGenericCommand(c,0);
+}
+
+void msetnxCommand(redisClient *c) {
+    msetGenericCommand(c,1);
 }
 
+/*
+ * INCR / DECR / INCRBY / DECRBY 的实现函数
+ *
+ * When the current value is an integer-encoded object owned only by the
+ * keyspace, the new value is written in place into robj->ptr: no object
+ * is allocated or freed. Values in the shared integer range are replaced
+ * by the shared object instead.
+ *
+ * 如果值对象是整数编码并且没有被共享，那么直接在原对象上更新，
+ * 避免分配新的对象。
+ */
+void incrDecrCommand(redisClient *c, long long incr) {
+    long long value, oldvalue;
+    robj *o, *new;
+
+    // 取出值对象
+    o = lookupKeyWrite(c->db,c->argv[1]);
+
+    // 检查对象是否存在，以及类型是否正确
+    if (o != NULL && o->type != REDIS_STRING) {
+        addReply(c,shared.wrongtypeerr);
+        return;
+    }
+
+    // 取出对象的整数值，并保存到 value 参数中
+    if (getLongLongFromObjectOrReply(c,o,&value,NULL) != REDIS_OK) return;
+
+    // 检查加法操作执行之后值释放会溢出
+    // 如果是的话，就向客户端发送一个出错回复，并放弃设置操作
+    oldvalue = value;
+    if ((incr < 0 && oldvalue < 0 && incr < (LLONG_MIN-oldvalue)) ||
+        (incr > 0 && oldvalue > 0 && incr > (LLONG_MAX-oldvalue))) {
+        addReplyError(c,"increment or decrement would overflow");
+        return;
+    }
+
+    // 进行加法计算
+    value += incr;
+
+    // 值对象没有被共享，并且新值可以用 long 表示，在原对象上直接更新
+    if (o && o->refcount == 1 && o->encoding == REDIS_ENCODING_INT &&
+        (value < 0 || value >= REDIS_SHARED_INTEGERS) &&
+        value >= LONG_MIN && value <= LONG_MAX)
+    {
+        new = o;
+        o->ptr = (void*)((long)value);
+    } else {
+        // 用新值创建对象，并添加或覆盖数据库中的旧值
+        new = createStringObjectFromLongLong(value);
+        if (o) {
+            dbOverwrite(c->db,c->argv[1],new);
+        } else {
+            dbAdd(c->db,c->argv[1],new);
+        }
+    }
+
+    // 通知监视这个键的客户端
+    signalModifiedKey(c->db,c->argv[1]);
 
+    // 将服务器设为脏
+    server.dirty++;
 
+    // 回复新值
+    addReplyLongLong(c,value);
+}
+
+void incrCommand(redisClient *c) {
+    incrDecrCommand(c,1);
+}
+
+void decrCommand(redisClient *c) {
+    incrDecrCommand(c,-1);
+}
+
+void incrbyCommand(redisClient *c) {
+    long long incr;
+
+    if (getLongLongFromObjectOrReply(c, c->argv[2], &incr, NULL) != REDIS_OK) return;
+    incrDecrCommand(c,incr);
+}
+
+void decrbyCommand(redisClient *c) {
+    long long incr;
+
+    if (getLongLongFromObjectOrReply(c, c->argv[2], &incr, NULL) != REDIS_OK) return;
+    // LLONG_MIN 取反会溢出
+    if (incr == LLONG_MIN) {
+        addReplyError(c,"decrement would overflow");
+        return;
+    }
+    incrDecrCommand(c,-incr);
+}
+
+/* Add a Redis Object as a bulk reply 
+ *
+ * 返回一个 Redis 对象作为回复
+ *
+ * Values up to REDIS_REPLY_CHUNK_BYTES are written as header + payload +
+ * CRLF into a single addReplyReserve() area. Bigger values are shared with
+ * the reply list by reference count instead of being copied.
+ *
+ * 不大于 REDIS_REPLY_CHUNK_BYTES 的值，回复头、值和 CRLF 一次写入预留的空间；
+ * 更大的值通过引用计数共享，不进行复制。
+ */
+void addReplyBulk(redisClient *c, robj *obj) {
+    size_t len = stringObjectLen(obj);
+    char *p;
+
+    if (len > REDIS_REPLY_CHUNK_BYTES) {
+        addReplyBulkLen(c,obj);
+        addReply(c,obj);
+        addReply(c,shared.crlf);
+        return;
+    }
+
+    // $<len>\r\n<value>\r\n
+    p = addReplyReserve(c,1+digits10(len)+2+len+2);
+    if (p == NULL) return;
+    *p++ = '$';
+    p += ull2string(p,32,len);
+    *p++ = '\r'; *p++ = '\n';
+    if (sdsEncodedObject(obj)) {
+        memcpy(p,obj->ptr,len);
+        p += len;
+    } else {
+        p += ll2string(p,32,(long)obj->ptr);
+    }
+    *p++ = '\r'; *p++ = '\n';
+}
+
+/* Create the length prefix of a bulk reply, example: $2234 */
+void addReplyBulkLen(redisClient *c, robj *obj) {
+    addReplyLongLongWithPrefix(c,stringObjectLen(obj),'$');
+}
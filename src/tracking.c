@@ -0,0 +1,488 @@
+/* Client side caching: keys tracking and invalidation messages.
+ *
+ * 客户端缓存：键的追踪与失效通知
+ *
+ * In the default mode the server remembers, for every key read by a client
+ * with tracking enabled, the IDs of the clients that may have cached it
+ * (server.tracking_table). When the key is modified the clients are sent an
+ * invalidation message and the key is forgotten, so a client is notified
+ * once per read at most.
+ *
+ * 默认模式下，对于开启了追踪的客户端读取过的每个键，服务器记录下
+ * 可能缓存了这个键的客户端的 ID （ server.tracking_table ）。
+ * 键被修改时，服务器向这些客户端发送失效通知，并删除这个键的记录，
+ * 所以每次读取最多只会引起一次通知。
+ *
+ * In broadcast mode (BCAST) nothing is remembered: clients register key
+ * prefixes, stored in a radix tree, and are notified of every modified key
+ * starting with one of them. While commands run the keys are collected per
+ * prefix, then sent in one message per prefix and client before returning
+ * to the event loop.
+ *
+ * 广播模式下服务器不记录读取过的键：客户端注册一些键前缀（保存在基数树中），
+ * 以这些前缀开头的键被修改时客户端都会收到通知。
+ * 命令执行期间被修改的键按照前缀收集起来，在返回事件循环之前，
+ * 每个前缀只向每个客户端发送一条通知。
+ *
+ * The server only speaks RESP2, so the invalidations are delivered as
+ * messages of the __redis__:invalidate Pub/Sub channel to the client given
+ * with REDIRECT, which has to be in Pub/Sub mode. The payload is the array
+ * of the invalidated keys, or a null bulk when the whole dataset is gone.
+ *
+ * 服务器只支持 RESP2 ，所以失效通知以 __redis__:invalidate 频道的消息的形式，
+ * 发送给 REDIRECT 指定的、处于订阅模式的客户端。
+ * 消息的内容是失效的键组成的数组，整个数据库被清空时为空值。
+ *
+ * The tracking table is bounded by tracking-table-max-keys: once it is full
+ * random keys are evicted, and their clients are sent an invalidation as if
+ * the keys were modified, since the server can't tell them apart anymore.
+ *
+ * 被追踪的键的数量受到 tracking-table-max-keys 的限制：
+ * 超出限制时随机删除一些键，并向缓存了这些键的客户端发送失效通知，
+ * 因为服务器之后已经无法在这些键被修改时通知它们了。
+ */
+
+#include "redis.h"
+
+/*
+ * 广播模式下一个前缀的状态
+ */
+typedef struct bcastState {
+
+    // 上次发送通知之后被修改的键，sds 集合
+    dict *keys;
+
+    // 注册了这个前缀的客户端，指针集合
+    dict *clients;
+} bcastState;
+
+/* Tracking table, keys are sds strings, vals are sets of client IDs. */
+static void dictReleaseDestructor(void *privdata, void *val) {
+    DICT_NOTUSED(privdata);
+    dictRelease((dict*)val);
+}
+
+static dictType trackingTableDictType = {
+    dictSdsHash,                /* hash function */
+    NULL,                       /* key dup */
+    NULL,                       /* val dup */
+    dictSdsKeyCompare,          /* key compare */
+    dictSdsDestructor,          /* key destructor */
+    dictReleaseDestructor       /* val destructor */
+};
+
+/*
+ * 初始化服务器的追踪状态
+ */
+void trackingInit(void) {
+    server.tracking_table = dictCreate(&trackingTableDictType,NULL);
+    server.tracking_prefixes = radixCreate();
+    server.tracking_total_prefixes = 0;
+    server.tracking_clients = 0;
+}
+
+/* Return 1 if one of the two strings is a prefix of the other. */
+static int stringsOverlap(const char *a, size_t alen,
+                          const char *b, size_t blen)
+{
+    return memcmp(a,b,alen < blen ? alen : blen) == 0;
+}
+
+/* The same key should not be notified twice to a client because two of its
+ * prefixes match it, so a client can't register prefixes where one is the
+ * prefix of another. Returns 1 if the prefixes are fine, otherwise an error
+ * is sent to the client and 0 is returned.
+ *
+ * 为了避免同一个键因为匹配客户端的两个前缀而被通知两次，
+ * 客户端注册的前缀不能互为前缀。
+ * 前缀没有问题时返回 1 ，否则向客户端回复错误并返回 0 。
+ */
+int checkPrefixCollisionsOrReply(redisClient *c, robj **prefixes,
+                                 size_t numprefix)
+{
+    size_t i, j;
+
+    for (i = 0; i < numprefix; i++) {
+        sds p = prefixes[i]->ptr;
+
+        /* Check input list has no overlap with existing prefixes. */
+        if (c->client_tracking_prefixes) {
+            dictIterator *di = dictGetIterator(c->client_tracking_prefixes);
+            dictEntry *de;
+
+            while((de = dictNext(di)) != NULL) {
+                sds existing = dictGetKey(de);
+
+                if (sdslen(existing) == sdslen(p) &&
+                    memcmp(existing,p,sdslen(p)) == 0) continue;
+                if (stringsOverlap(existing,sdslen(existing),p,sdslen(p))) {
+                    addReplyErrorFormat(c,
+                        "Prefix '%s' overlaps with an existing prefix '%s'. "
+                        "Prefixes for a single client must not overlap.",
+                        p,existing);
+                    dictReleaseIterator(di);
+                    return 0;
+                }
+            }
+            dictReleaseIterator(di);
+        }
+
+        /* Check input has no overlap with itself. */
+        for (j = i + 1; j < numprefix; j++) {
+            sds q = prefixes[j]->ptr;
+
+            if (stringsOverlap(p,sdslen(p),q,sdslen(q))) {
+                addReplyErrorFormat(c,
+                    "Prefix '%s' overlaps with another provided prefix '%s'. "
+                    "Prefixes for a single client must not overlap.",
+                    p,q);
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+/*
+ * 在广播模式下，设置客户端 c 追踪前缀 p
+ */
+static void enableBcastTrackingForPrefix(redisClient *c, const char *p,
+                                         size_t len)
+{
+    radixNode *n = radixLookup(server.tracking_prefixes,p,len,1);
+    bcastState *bs = n->value;
+
+    if (bs == NULL) {
+        bs = zmalloc(sizeof(*bs));
+        bs->keys = dictCreate(&setDictType,NULL);
+        bs->clients = dictCreate(&ptrDictType,NULL);
+        n->value = bs;
+        server.tracking_total_prefixes++;
+    }
+
+    if (dictAdd(bs->clients,c,NULL) == DICT_OK) {
+        if (c->client_tracking_prefixes == NULL)
+            c->client_tracking_prefixes = dictCreate(&setDictType,NULL);
+        dictAdd(c->client_tracking_prefixes,sdsnewlen(p,len),NULL);
+    }
+}
+
+/* Enable the tracking state for the client 'c', and as a side effect allocates
+ * the tracking table if needed. Invalidation messages are sent to the client
+ * with ID 'redirect_to'. In BCAST mode the client is registered for the
+ * given prefixes, or for all the keys if there is none.
+ *
+ * 为客户端 c 开启追踪，失效通知发送给 ID 为 redirect_to 的客户端。
+ * 广播模式下客户端追踪给定的前缀，没有给定前缀时追踪所有键。
+ */
+void enableTracking(redisClient *c, uint64_t redirect_to, int bcast,
+                    robj **prefixes, size_t numprefix)
+{
+    size_t j;
+
+    if (!(c->flags & REDIS_TRACKING)) server.tracking_clients++;
+    c->flags |= REDIS_TRACKING;
+    c->client_tracking_redirection = redirect_to;
+
+    if (bcast) {
+        c->flags |= REDIS_TRACKING_BCAST;
+        if (numprefix == 0) enableBcastTrackingForPrefix(c,"",0);
+        for (j = 0; j < numprefix; j++) {
+            sds p = prefixes[j]->ptr;
+            enableBcastTrackingForPrefix(c,p,sdslen(p));
+        }
+    }
+}
+
+/* Remove the tracking state from the client 'c'. The IDs stored in the
+ * tracking table are not removed: they are discarded lazily when the key
+ * is invalidated and the client turns out not to track keys anymore.
+ *
+ * 关闭客户端 c 的追踪。
+ * 追踪表中的客户端 ID 不会被立即删除，而是在键失效时发现客户端已经关闭追踪，
+ * 然后被惰性地丢弃。
+ */
+void disableTracking(redisClient *c) {
+    if (!(c->flags & REDIS_TRACKING)) return;
+
+    /* In broadcasting mode we need to unsubscribe the client from all the
+     * prefixes, and remove the prefixes nobody tracks anymore. */
+    if (c->flags & REDIS_TRACKING_BCAST) {
+        dictIterator *di = dictGetIterator(c->client_tracking_prefixes);
+        dictEntry *de;
+
+        while((de = dictNext(di)) != NULL) {
+            sds p = dictGetKey(de);
+            radixNode *n = radixLookup(server.tracking_prefixes,p,sdslen(p),0);
+            bcastState *bs;
+
+            redisAssert(n != NULL && n->value != NULL);
+            bs = n->value;
+            dictDelete(bs->clients,c);
+            if (dictSize(bs->clients) == 0) {
+                dictRelease(bs->clients);
+                dictRelease(bs->keys);
+                zfree(bs);
+                n->value = NULL;
+                radixCompact(server.tracking_prefixes,n);
+                server.tracking_total_prefixes--;
+            }
+        }
+        dictReleaseIterator(di);
+        dictRelease(c->client_tracking_prefixes);
+        c->client_tracking_prefixes = NULL;
+    }
+
+    c->flags &= ~(REDIS_TRACKING|REDIS_TRACKING_BCAST);
+    server.tracking_clients--;
+}
+
+/* This function is called after the execution of a readonly command in the
+ * case the client 'c' has keys tracking enabled. It will populate the
+ * tracking invalidation table according to the keys the user fetched, so
+ * that Redis will know what are the clients that should receive an
+ * invalidation message with certain groups of keys are modified.
+ *
+ * 在开启了追踪的客户端执行只读命令之后调用，
+ * 将命令读取的键和客户端的 ID 记录到追踪表中，键被修改时才知道应该通知哪些客户端。
+ */
+void trackingRememberKeys(redisClient *c) {
+    int numkeys, j;
+    int *keys = getKeysFromCommand(c->cmd,c->argv,c->argc,&numkeys);
+
+    if (keys == NULL) return;
+
+    for (j = 0; j < numkeys; j++) {
+        sds sdskey = c->argv[keys[j]]->ptr;
+        dict *ids = dictFetchValue(server.tracking_table,sdskey);
+
+        if (ids == NULL) {
+            ids = dictCreate(&ptrDictType,NULL);
+            dictAdd(server.tracking_table,sdsdup(sdskey),ids);
+        }
+        dictAdd(ids,(void*)(uintptr_t)c->id,NULL);
+    }
+    getKeysFreeResult(keys);
+}
+
+/* Encode an invalidation message for the given keys, or for the whole
+ * dataset if 'keys' is NULL. The message is the same for every receiver.
+ *
+ * 将给定键的失效通知编码成协议格式， keys 为 NULL 时表示整个数据库失效。
+ * 所有接收者收到的消息都是相同的。
+ */
+static robj *createTrackingMessage(sds *keys, unsigned long numkeys) {
+    sds s = sdsnew("*3\r\n$7\r\nmessage\r\n$20\r\n__redis__:invalidate\r\n");
+    unsigned long j;
+
+    if (keys == NULL) {
+        s = sdscatlen(s,"$-1\r\n",5);
+    } else {
+        s = sdscatprintf(s,"*%lu\r\n",numkeys);
+        for (j = 0; j < numkeys; j++) {
+            s = sdscatprintf(s,"$%lu\r\n",(unsigned long)sdslen(keys[j]));
+            s = sdscatlen(s,keys[j],sdslen(keys[j]));
+            s = sdscatlen(s,"\r\n",2);
+        }
+    }
+    return createObject(REDIS_STRING,s);
+}
+
+/* Send an invalidation message on behalf of the tracking client 'c'. The
+ * message is dropped if the redirection client is gone, or is not in Pub/Sub
+ * mode and could not tell the message from a reply.
+ *
+ * 代替开启追踪的客户端 c 发送失效通知。
+ * 如果接收通知的客户端已经断开，或者不在订阅模式（无法区分通知和命令回复），
+ * 那么丢弃这条通知。
+ */
+static void sendTrackingMessage(redisClient *c, robj *msg) {
+    redisClient *target = lookupClientByID(c->client_tracking_redirection);
+
+    if (target == NULL || clientSubscriptionsCount(target) == 0) return;
+    addReplyShared(target,msg);
+}
+
+/* Send the invalidation of 'key' to the clients of the tracking table that
+ * may have cached it, and forget the key.
+ *
+ * 向追踪表中可能缓存了 key 的客户端发送失效通知，并删除 key 的记录。
+ */
+static void trackingInvalidateTrackedKey(sds key) {
+    dictEntry *de = dictFind(server.tracking_table,key);
+    dictIterator *di;
+    robj *msg = NULL;
+
+    if (de == NULL) return;
+
+    di = dictGetIterator(dictGetVal(de));
+    while((de = dictNext(di)) != NULL) {
+        uint64_t id = (uintptr_t)dictGetKey(de);
+        redisClient *c = lookupClientByID(id);
+
+        /* Note that if the client is in BCAST mode, we don't want to
+         * send invalidation messages that were pending in the case
+         * previously the client was not in BCAST mode. This can happen if
+         * TRACKING is enabled normally, and then the client switches to
+         * BCAST mode. */
+        // 客户端已经断开或者关闭了追踪，丢弃这个 ID
+        if (c == NULL || !(c->flags & REDIS_TRACKING) ||
+            c->flags & REDIS_TRACKING_BCAST) continue;
+
+        if (msg == NULL) msg = createTrackingMessage(&key,1);
+        sendTrackingMessage(c,msg);
+    }
+    dictReleaseIterator(di);
+    if (msg) decrRefCount(msg);
+
+    dictDelete(server.tracking_table,key);
+}
+
+/*
+ * 将被修改的键添加到匹配的前缀的待通知键集合中
+ */
+static void trackingRememberKeyToBroadcast(radixNode *n, void *privdata) {
+    bcastState *bs = n->value;
+    sds key = privdata;
+
+    if (dictFind(bs->keys,key) == NULL)
+        dictAdd(bs->keys,sdsdup(key),NULL);
+}
+
+/* This function is called from signalModifiedKey() or other places in Redis
+ * when a key changes value. In the context of keys tracking, our task here
+ * is to send a notification to every client that may have cached the key,
+ * and to queue the key for the broadcast clients of its prefixes.
+ *
+ * 在键被修改时由 signalModifiedKey() 等函数调用：
+ * 向所有可能缓存了这个键的客户端发送通知，并将键加入匹配的广播前缀的待通知集合。
+ */
+void trackingInvalidateKey(robj *key) {
+    if (server.tracking_total_prefixes)
+        radixWalkPrefixes(server.tracking_prefixes,key->ptr,sdslen(key->ptr),
+                          trackingRememberKeyToBroadcast,key->ptr);
+
+    if (dictSize(server.tracking_table))
+        trackingInvalidateTrackedKey(key->ptr);
+}
+
+/* This function is called when the database is flushed: every tracking
+ * client is sent a null invalidation message, meaning that all its cache
+ * must be dropped, and the tracking table is emptied.
+ *
+ * 在数据库被清空时调用：向每个开启追踪的客户端发送空的失效通知，
+ * 表示它应该清空所有缓存，然后清空追踪表。
+ */
+void trackingInvalidateKeysOnFlush(void) {
+    if (server.tracking_clients) {
+        robj *msg = createTrackingMessage(NULL,0);
+        listIter li;
+        listNode *ln;
+
+        listRewind(server.clients,&li);
+        while ((ln = listNext(&li)) != NULL) {
+            redisClient *c = listNodeValue(ln);
+
+            if (c->flags & REDIS_TRACKING) sendTrackingMessage(c,msg);
+        }
+        decrRefCount(msg);
+    }
+
+    if (dictSize(server.tracking_table))
+        dictEmpty(server.tracking_table,NULL);
+}
+
+/* Tracking forces Redis to remember information about which client may have
+ * certain keys. In workloads where there are a lot of reads, but keys are
+ * hardly modified, the amount of information we have to remember server side
+ * could be a lot, with the number of keys being totally not bound.
+ *
+ * So Redis allows the user to configure a maximum number of keys for the
+ * invalidation table. This function makes sure that we don't go over the
+ * specified fill rate: if we are over, we can just evict informations about
+ * a random key, and send invalidation messages to clients like if the key
+ * was modified.
+ *
+ * 追踪表的大小在读多写少的场景下可能无限增长，所以用户可以设置被追踪键的数量上限。
+ * 超出上限时，随机删除一些键，并像键被修改一样向客户端发送失效通知。
+ *
+ * The work done in a single call is bounded, and grows each time the limit
+ * is not reached, so that the table converges even under a high read load.
+ *
+ * 每次调用的工作量是有限的，如果没能回到上限以内，下一次调用的工作量会增加，
+ * 这样即使在大量读取的情况下，追踪表的大小也能回到上限以内。
+ */
+void trackingLimitUsedSlots(void) {
+    static unsigned int timeout_counter = 0;
+    int effort;
+
+    if (server.tracking_table_max_keys == 0) return; /* No limits set. */
+    if (dictSize(server.tracking_table) <=
+        (unsigned long long)server.tracking_table_max_keys)
+    {
+        timeout_counter = 0;
+        return; /* Limit not reached. */
+    }
+
+    /* We have to invalidate a few keys to reach the limit again. The effort
+     * we do here is proportional to the number of times we entered this
+     * function and found that we are still over the limit. */
+    effort = 100 * (timeout_counter+1);
+
+    /* We just remove one key after another by using a random walk. */
+    while (effort--) {
+        dictEntry *de = dictGetRandomKey(server.tracking_table);
+
+        trackingInvalidateTrackedKey(dictGetKey(de));
+        if (dictSize(server.tracking_table) <=
+            (unsigned long long)server.tracking_table_max_keys)
+        {
+            timeout_counter = 0;
+            return; /* Return ASAP: we are again under the limit. */
+        }
+    }
+
+    /* If we reach this point, we were not able to go under the configured
+     * limit using the maximum effort we had for this run. */
+    timeout_counter++;
+}
+
+/*
+ * 将一个前缀收集到的被修改的键，用一条消息通知给注册了这个前缀的所有客户端
+ */
+static void trackingBroadcastPrefix(radixNode *n, void *privdata) {
+    bcastState *bs = n->value;
+    dictIterator *di;
+    dictEntry *de;
+    sds *keys;
+    unsigned long numkeys = 0;
+    robj *msg;
+    REDIS_NOTUSED(privdata);
+
+    if (dictSize(bs->keys) == 0) return;
+
+    keys = zmalloc(sizeof(sds)*dictSize(bs->keys));
+    di = dictGetIterator(bs->keys);
+    while((de = dictNext(di)) != NULL) keys[numkeys++] = dictGetKey(de);
+    dictReleaseIterator(di);
+    msg = createTrackingMessage(keys,numkeys);
+    zfree(keys);
+
+    di = dictGetIterator(bs->clients);
+    while((de = dictNext(di)) != NULL) sendTrackingMessage(dictGetKey(de),msg);
+    dictReleaseIterator(di);
+
+    decrRefCount(msg);
+    dictEmpty(bs->keys,NULL);
+}
+
+/* This function is called from beforeSleep() in order to send to the
+ * broadcast clients the keys modified in their prefixes since the last
+ * call.
+ *
+ * 由 beforeSleep() 调用，将上次调用以来各个前缀中被修改的键发送给广播模式的客户端。
+ */
+void trackingBroadcastInvalidationMessages(void) {
+    if (server.tracking_total_prefixes == 0) return;
+    radixWalk(server.tracking_prefixes,trackingBroadcastPrefix,NULL);
+}
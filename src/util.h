@@ -1,8 +1,16 @@
 #ifndef __REDIS_UTIL_H
 #define __REDIS_UTIL_H
 
+#include <stdint.h>
 #include "sds.h"
 
+int stringmatchlen(const char *p, int plen, const char *s, int slen, int nocase);
+long long memtoll(const char *p, int *err);
+uint32_t digits10(uint64_t v);
+int ll2string(char *s, size_t len, long long value);
+int ull2string(char *s, size_t len, unsigned long long value);
 int string2ll(const char *s, size_t slen, long long *value);
+int string2l(const char *s, size_t slen, long *value);
+void getRandomHexChars(char *p, unsigned int len);
 
 #endif
@@ -0,0 +1 @@
+#define REDIS_VERSION "0.1.0"
@@ -1,16 +1,129 @@
+#include <string.h>
 #include "zmalloc.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
 
 #define PREFIX_SIZE (sizeof(size_t))
 
-static size_t used_memory = 0;
+/* Used memory accounting.
+ *
+ * 已使用内存的统计
+ *
+ * Memory is allocated and released by the main thread and by the bio
+ * threads (lazy free), so a single counter would be a contended atomic
+ * touched by every allocation. Instead every thread owns a counter of its
+ * own, padded to a cache line, and zmalloc_used_memory() sums them.
+ *
+ * 主线程和后台线程都会分配和释放内存，使用单个计数器的话，
+ * 每次分配都要对同一个变量执行有竞争的原子操作。
+ * 所以每个线程拥有自己的计数器（按缓存行对齐），
+ * zmalloc_used_memory() 读取时再把它们加起来。
+ *
+ * A counter is written only by its owner thread, so the update is a plain
+ * relaxed load and store, not a locked read-modify-write; the atomic
+ * accesses only make the concurrent reads in zmalloc_used_memory() well
+ * defined. Threads beyond ZMALLOC_MAX_THREADS share the last slot, which
+ * is updated with real atomic additions.
+ *
+ * 计数器只由它的拥有者写入，所以更新只需要普通的 load 和 store ，
+ * 不需要加锁的读-改-写。超过 ZMALLOC_MAX_THREADS 的线程共享最后一个计数器，
+ * 这个计数器使用原子加法更新。
+ *
+ * A thread may free memory allocated by another one (lazy free does it all
+ * the time), so a single counter can go negative: only the sum is
+ * meaningful.
+ *
+ * The slot of a thread is given back when the thread exits (loader and
+ * CRC threads are started for every RDB load), and the next thread takes
+ * it over together with the value of the counter.
+ *
+ * 线程退出时归还它的计数器（每次载入 RDB 都会创建新的线程），
+ * 之后创建的线程会接管这个计数器以及计数器中的值。 */
+#define ZMALLOC_MAX_THREADS 16
+#define ZMALLOC_SHARED_SLOT ZMALLOC_MAX_THREADS
+#define ZMALLOC_CACHE_LINE 64
 
-#define update_zmalloc_stat_alloc(_n) do { \
-    used_memory += _n; \
-} while(0)
+typedef struct zmallocThreadCounter {
+    long long used;
+    char padding[ZMALLOC_CACHE_LINE-sizeof(long long)];
+} zmallocThreadCounter;
 
-#define update_zmalloc_stat_free(_n) do { \
-    used_memory -= _n; \
-} while(0)
+static zmallocThreadCounter used_memory[ZMALLOC_MAX_THREADS+1]
+    __attribute__((aligned(ZMALLOC_CACHE_LINE)));
+// 从未被使用过的计数器数量
+static int zmalloc_threads = 0;
+// 已经退出的线程归还的计数器
+static int zmalloc_free_slots[ZMALLOC_MAX_THREADS];
+static int zmalloc_free_count = 0;
+static pthread_mutex_t zmalloc_slots_mutex = PTHREAD_MUTEX_INITIALIZER;
+// 线程退出时通过这个 key 的析构函数归还计数器
+static pthread_key_t zmalloc_slot_key;
+static pthread_once_t zmalloc_slot_key_once = PTHREAD_ONCE_INIT;
+// 当前线程使用的计数器，-1 表示还没有分配
+static __thread int zmalloc_thread_slot = -1;
+
+/*
+ * 线程退出时调用，将线程的计数器放回空闲列表
+ */
+static void zmalloc_release_thread_slot(void *value) {
+    int slot = (int)(long)value-1;
+
+    /* Other destructors may still free memory in this thread: from now on
+     * it goes to the shared slot, the released one may have a new owner. */
+    zmalloc_thread_slot = ZMALLOC_SHARED_SLOT;
+
+    pthread_mutex_lock(&zmalloc_slots_mutex);
+    zmalloc_free_slots[zmalloc_free_count++] = slot;
+    pthread_mutex_unlock(&zmalloc_slots_mutex);
+}
+
+static void zmalloc_create_slot_key(void) {
+    pthread_key_create(&zmalloc_slot_key,zmalloc_release_thread_slot);
+}
+
+static int zmalloc_acquire_thread_slot(void) {
+    int slot;
+
+    pthread_once(&zmalloc_slot_key_once,zmalloc_create_slot_key);
+
+    // 优先使用已经退出的线程归还的计数器
+    pthread_mutex_lock(&zmalloc_slots_mutex);
+    if (zmalloc_free_count)
+        slot = zmalloc_free_slots[--zmalloc_free_count];
+    else if (zmalloc_threads < ZMALLOC_MAX_THREADS)
+        slot = zmalloc_threads++;
+    else
+        slot = ZMALLOC_SHARED_SLOT;
+    pthread_mutex_unlock(&zmalloc_slots_mutex);
+
+    // 共享的计数器不需要归还，保存 slot+1 使得值不为 NULL
+    if (slot != ZMALLOC_SHARED_SLOT)
+        pthread_setspecific(zmalloc_slot_key,(void*)(long)(slot+1));
+    return slot;
+}
+
+static inline int zmalloc_get_thread_slot(void) {
+    if (zmalloc_thread_slot == -1)
+        zmalloc_thread_slot = zmalloc_acquire_thread_slot();
+    return zmalloc_thread_slot;
+}
+
+static inline void zmalloc_update_used(long long delta) {
+    int slot = zmalloc_get_thread_slot();
+    long long *counter = &used_memory[slot].used;
+
+    if (slot == ZMALLOC_SHARED_SLOT) {
+        __atomic_add_fetch(counter,delta,__ATOMIC_RELAXED);
+    } else {
+        __atomic_store_n(counter,
+            __atomic_load_n(counter,__ATOMIC_RELAXED)+delta,
+            __ATOMIC_RELAXED);
+    }
+}
+
+#define update_zmalloc_stat_alloc(_n) zmalloc_update_used((long long)(_n))
+#define update_zmalloc_stat_free(_n) zmalloc_update_used(-(long long)(_n))
 
 
 static void zmalloc_default_oom(size_t size) {
@@ -58,6 +171,17 @@ void zfree(void *ptr) {
     free(realptr);
 }
 
+/*
+ * 复制一个 C 字符串，新字符串使用 zmalloc 分配
+ */
+char *zstrdup(const char *s) {
+    size_t l = strlen(s)+1;
+    char *p = zmalloc(l);
+
+    memcpy(p,s,l);
+    return p;
+}
+
 
 void *zrealloc(void *ptr, size_t size) {
 
@@ -74,7 +198,255 @@ void *zrealloc(void *ptr, size_t size) {
     if (!newptr) zmalloc_oom_handler(size);
 
     *((size_t*)newptr) = size;
-    update_zmalloc_stat_free(oldsize);
-    update_zmalloc_stat_alloc(size);
+    update_zmalloc_stat_free(oldsize+PREFIX_SIZE);
+    update_zmalloc_stat_alloc(size+PREFIX_SIZE);
     return (char*)newptr+PREFIX_SIZE;
 }
+
+/*
+ * 返回程序已使用的内存字节数
+ *
+ * The counters are read one by one while other threads keep updating
+ * them, so with concurrent frees of memory allocated elsewhere the sum
+ * may transiently dip below the real value: it is clamped at zero.
+ *
+ * 读取各个计数器的同时其他线程仍在更新，结果可能暂时偏小，所以不会返回负数。
+ */
+size_t zmalloc_used_memory(void) {
+    long long used = 0;
+    int j;
+
+    for (j = 0; j <= ZMALLOC_MAX_THREADS; j++)
+        used += __atomic_load_n(&used_memory[j].used,__ATOMIC_RELAXED);
+    return used > 0 ? (size_t)used : 0;
+}
+
+/* Get the RSS information in an OS-specific way.
+ *
+ * WARNING: the function zmalloc_get_rss() is not designed to be fast
+ * and may not be called in the busy loops where Redis tries to release
+ * memory expiring or swapping out objects.
+ *
+ * For this kind of "fast RSS reporting" usages use instead the
+ * function RedisEstimateRSS() that is a much faster (and less precise)
+ * version of the function.
+ *
+ * 获取进程的常驻内存（RSS），读取 /proc/<pid>/stat 的第 24 个字段
+ */
+size_t zmalloc_get_rss(void) {
+    int page = sysconf(_SC_PAGESIZE);
+    size_t rss;
+    char buf[4096];
+    char filename[256];
+    int fd, count;
+    char *p, *x;
+
+    snprintf(filename,256,"/proc/%d/stat",getpid());
+    if ((fd = open(filename,O_RDONLY)) == -1) return 0;
+    if (read(fd,buf,4096) <= 0) {
+        close(fd);
+        return 0;
+    }
+    close(fd);
+
+    p = buf;
+    count = 23; /* RSS is the 24th field in /proc/<pid>/stat */
+    while(p && count--) {
+        p = strchr(p,' ');
+        if (p) p++;
+    }
+    if (!p) return 0;
+    x = strchr(p,' ');
+    if (!x) return 0;
+    *x = '\0';
+
+    rss = strtoll(p,NULL,10);
+    rss *= page;
+    return rss;
+}
+
+/* Fragmentation = RSS / allocated-bytes
+ *
+ * 内存碎片率：常驻内存和已分配内存之比
+ */
+float zmalloc_get_fragmentation_ratio(size_t rss) {
+    return (float)rss/zmalloc_used_memory();
+}
+
+/* Get the sum of the specified field (converted from kb to bytes) in
+ * /proc/self/smaps. The field must be specified with trailing ":" as it
+ * appears in the smaps output.
+ *
+ * 累加 /proc/self/smaps 中给定字段的值（以字节为单位），
+ * 字段名需要带上结尾的 ":" 。
+ */
+size_t zmalloc_get_smap_bytes_by_field(char *field) {
+    char line[1024];
+    size_t bytes = 0;
+    FILE *fp = fopen("/proc/self/smaps","r");
+    int flen = strlen(field);
+
+    if (!fp) return 0;
+    while(fgets(line,sizeof(line),fp) != NULL) {
+        if (strncmp(line,field,flen) == 0) {
+            char *p = strchr(line,'k');
+            if (p) {
+                *p = '\0';
+                bytes += strtol(line+flen,NULL,10) * 1024;
+            }
+        }
+    }
+    fclose(fp);
+    return bytes;
+}
+
+/*
+ * 进程私有的脏页数量。在 fork() 出来的子进程中调用时，
+ * 就是父子进程写时复制所产生的内存。
+ */
+size_t zmalloc_get_private_dirty(void) {
+    return zmalloc_get_smap_bytes_by_field("Private_Dirty:");
+}
+
+#ifdef REDIS_TEST
+#include <pthread.h>
+#include <sys/time.h>
+
+static long long zmallocTestUstime(void) {
+    struct timeval tv;
+
+    gettimeofday(&tv,NULL);
+    return ((long long)tv.tv_sec)*1000000+tv.tv_usec;
+}
+
+#define ZMALLOC_TEST_BLOCKS 1024
+
+typedef struct zmallocTestThread {
+    pthread_t tid;
+    long long iterations;
+    unsigned int seed;
+    void **blocks;          /* Blocks still allocated when the thread ends. */
+    long long expected;     /* Bytes the thread holds, prefix included. */
+} zmallocTestThread;
+
+/* Random mix of zmalloc, zrealloc and zfree on a private set of blocks,
+ * keeping track of how many bytes the accounting should report. */
+static void *zmallocTestWorker(void *arg) {
+    zmallocTestThread *t = arg;
+    long long j;
+
+    for (j = 0; j < t->iterations; j++) {
+        int idx = rand_r(&t->seed) % ZMALLOC_TEST_BLOCKS;
+        size_t size = 1 + rand_r(&t->seed) % 4096;
+        void *p = t->blocks[idx];
+
+        if (p == NULL) {
+            t->blocks[idx] = zmalloc(size);
+            t->expected += size+PREFIX_SIZE;
+        } else if (rand_r(&t->seed) % 3 == 0) {
+            t->expected -= *((size_t*)((char*)p-PREFIX_SIZE));
+            t->blocks[idx] = zrealloc(p,size);
+            t->expected += size;
+        } else {
+            t->expected -= *((size_t*)((char*)p-PREFIX_SIZE))+PREFIX_SIZE;
+            zfree(p);
+            t->blocks[idx] = NULL;
+        }
+    }
+    return NULL;
+}
+
+/* Cost of the accounting alone: every thread hammers the shared counter,
+ * or its own one. */
+static long long zmalloc_test_shared_counter = 0;
+
+static void *zmallocTestSharedCounter(void *arg) {
+    long long j, iterations = *(long long*)arg;
+    for (j = 0; j < iterations; j++)
+        __atomic_add_fetch(&zmalloc_test_shared_counter,1,__ATOMIC_RELAXED);
+    return NULL;
+}
+
+static void *zmallocTestThreadCounter(void *arg) {
+    long long j, iterations = *(long long*)arg;
+    for (j = 0; j < iterations; j++) zmalloc_update_used(1);
+    for (j = 0; j < iterations; j++) zmalloc_update_used(-1);
+    return NULL;
+}
+
+static long long zmallocTestRun(int numthreads, void *(*fn)(void*),
+                                long long iterations)
+{
+    pthread_t tids[numthreads];
+    long long start = zmallocTestUstime();
+    int j;
+
+    for (j = 0; j < numthreads; j++)
+        pthread_create(&tids[j],NULL,fn,&iterations);
+    for (j = 0; j < numthreads; j++) pthread_join(tids[j],NULL);
+    return zmallocTestUstime()-start;
+}
+
+/*
+ * 多线程分配/释放的压力测试，检查已使用内存的统计是否准确
+ *
+ * Every thread allocates, reallocates and frees random blocks, then the
+ * main thread checks that used memory grew exactly by what the threads
+ * still hold, frees all of it (from a thread that did not allocate it)
+ * and checks that the total is back to the starting value.
+ *
+ * Build with 'make REDIS_CFLAGS=-DREDIS_TEST' and run with
+ * './redis-server test zmalloc [iterations] [threads]'.
+ */
+int zmallocTest(long long iterations, int numthreads) {
+    zmallocTestThread *threads = calloc(numthreads,sizeof(*threads));
+    size_t before, after;
+    long long expected = 0, elapsed;
+    int j, k, failed = 0;
+
+    before = zmalloc_used_memory();
+    elapsed = zmallocTestUstime();
+    for (j = 0; j < numthreads; j++) {
+        threads[j].iterations = iterations;
+        threads[j].seed = j+1;
+        threads[j].blocks = calloc(ZMALLOC_TEST_BLOCKS,sizeof(void*));
+        pthread_create(&threads[j].tid,NULL,zmallocTestWorker,&threads[j]);
+    }
+    for (j = 0; j < numthreads; j++) {
+        pthread_join(threads[j].tid,NULL);
+        expected += threads[j].expected;
+    }
+    elapsed = zmallocTestUstime()-elapsed;
+    printf("%d threads: %.2f ns/op\n", numthreads,
+        (double)elapsed*1000/iterations);
+
+    after = zmalloc_used_memory();
+    printf("used memory: %zu, expected: %zu\n",
+        after-before, (size_t)expected);
+    if ((long long)(after-before) != expected) failed = 1;
+
+    for (j = 0; j < numthreads; j++) {
+        for (k = 0; k < ZMALLOC_TEST_BLOCKS; k++) zfree(threads[j].blocks[k]);
+        free(threads[j].blocks);
+    }
+    free(threads);
+    after = zmalloc_used_memory();
+    printf("after freeing everything: %zu, expected: %zu\n", after, before);
+    if (after != before) failed = 1;
+
+    elapsed = zmallocTestRun(numthreads,zmallocTestSharedCounter,iterations);
+    printf("shared atomic counter: %.2f ns/op\n",
+        (double)elapsed*1000/iterations);
+    elapsed = zmallocTestRun(numthreads,zmallocTestThreadCounter,iterations);
+    printf("per-thread counters:   %.2f ns/op\n",
+        (double)elapsed*1000/(iterations*2));
+    if (zmalloc_used_memory() != before) failed = 1;
+
+    // 所有工作线程都已经退出，只有主线程还持有计数器
+    printf("counters in use: %d\n", zmalloc_threads-zmalloc_free_count);
+    if (zmalloc_threads-zmalloc_free_count != 1) failed = 1;
+
+    printf("%s\n", failed ? "FAILED" : "OK");
+    return failed;
+}
+#endif
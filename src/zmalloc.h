@@ -9,7 +9,18 @@ void *zmalloc(size_t size);
 void *zcalloc(size_t size);
 
 void zfree(void *ptr);
+char *zstrdup(const char *s);
 
 void *zrealloc(void *ptr, size_t size);
 
+size_t zmalloc_used_memory(void);
+size_t zmalloc_get_rss(void);
+float zmalloc_get_fragmentation_ratio(size_t rss);
+size_t zmalloc_get_smap_bytes_by_field(char *field);
+size_t zmalloc_get_private_dirty(void);
+
+#ifdef REDIS_TEST
+int zmallocTest(long long iterations, int numthreads);
+#endif
+
 #endif /* __ZMALLOC_H */
\ No newline at end of file
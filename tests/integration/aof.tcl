@@ -1,275 +1,261 @@
-set defaults { appendonly {yes} appendfilename {appendonly.aof} }
-set server_path [tmpdir server.aof]
-set aof_path "$server_path/appendonly.aof"
+set server_path [file normalize [tmpdir "server.aof-test"]]
+set manifest_path "$server_path/appendonly.aof.manifest"
 
 proc append_to_aof {str} {
     upvar fp fp
     puts -nonewline $fp $str
 }
 
-proc create_aof {code} {
-    upvar fp fp aof_path aof_path
-    set fp [open $aof_path w+]
-    uplevel 1 $code
+# Return the path of the file of the given type ('b' or 'i') listed last
+# by the manifest.
+proc aof_file {type} {
+    upvar manifest_path manifest_path server_path server_path
+    set fp [open $manifest_path r]
+    set path {}
+    foreach line [split [read $fp] "\n"] {
+        if {[lindex $line 5] eq $type} {
+            set path "$server_path/[lindex $line 1]"
+        }
+    }
     close $fp
+    return $path
 }
 
-proc start_server_aof {overrides code} {
-    upvar defaults defaults srv srv server_path server_path
-    set config [concat $defaults $overrides]
-    set srv [start_server [list overrides $config]]
+proc create_aof {code} {
+    upvar fp fp manifest_path manifest_path server_path server_path
+    set fp [open [aof_file i] w+]
     uplevel 1 $code
-    kill_server $srv
+    close $fp
 }
 
-tags {"aof"} {
-    ## Server can start when aof-load-truncated is set to yes and AOF
-    ## is truncated, with an incomplete MULTI block.
-    create_aof {
-        append_to_aof [formatCommand set foo hello]
-        append_to_aof [formatCommand multi]
-        append_to_aof [formatCommand set bar world]
-    }
-
-    start_server_aof [list dir $server_path aof-load-truncated yes] {
-        test "Unfinished MULTI: Server should start if load-truncated is yes" {
-            assert_equal 1 [is_alive $srv]
-        }
-    }
-
-    ## Should also start with truncated AOF without incomplete MULTI block.
-    create_aof {
-        append_to_aof [formatCommand incr foo]
-        append_to_aof [formatCommand incr foo]
-        append_to_aof [formatCommand incr foo]
-        append_to_aof [formatCommand incr foo]
-        append_to_aof [formatCommand incr foo]
-        append_to_aof [string range [formatCommand incr foo] 0 end-1]
-    }
-
-    start_server_aof [list dir $server_path aof-load-truncated yes] {
-        test "Short read: Server should start if load-truncated is yes" {
-            assert_equal 1 [is_alive $srv]
-        }
-
-        test "Truncated AOF loaded: we expect foo to be equal to 5" {
-            set client [redis [dict get $srv host] [dict get $srv port] 0 $::tls]
-            wait_done_loading $client
-            assert {[$client get foo] eq "5"}
-        }
-
-        test "Append a new command after loading an incomplete AOF" {
-            $client incr foo
-        }
-    }
-
-    # Now the AOF file is expected to be correct
-    start_server_aof [list dir $server_path aof-load-truncated yes] {
-        test "Short read + command: Server should start" {
-            assert_equal 1 [is_alive $srv]
-        }
-
-        test "Truncated AOF loaded: we expect foo to be equal to 6 now" {
-            set client [redis [dict get $srv host] [dict get $srv port] 0 $::tls]
-            wait_done_loading $client
-            assert {[$client get foo] eq "6"}
-        }
-    }
-
-    ## Test that the server exits when the AOF contains a format error
-    create_aof {
-        append_to_aof [formatCommand set foo hello]
-        append_to_aof "!!!"
-        append_to_aof [formatCommand set foo hello]
-    }
+proc read_aof {} {
+    upvar manifest_path manifest_path server_path server_path
+    set fp [open [aof_file i] r]
+    set content [read $fp]
+    close $fp
+    return $content
+}
 
-    start_server_aof [list dir $server_path aof-load-truncated yes] {
-        test "Bad format: Server should have logged an error" {
-            set pattern "*Bad file format reading the append only file*"
-            set retry 10
-            while {$retry} {
-                set result [exec tail -1 < [dict get $srv stdout]]
-                if {[string match $pattern $result]} {
-                    break
-                }
-                incr retry -1
-                after 1000
-            }
-            if {$retry == 0} {
-                error "assertion:expected error not found on config file"
-            }
-        }
+proc wait_for_aof_rewrite {} {
+    wait_for_condition 50 100 {
+        [s aof_rewrite_in_progress] == 0 && [s aof_rewrite_scheduled] == 0
+    } else {
+        fail "AOF rewrite did not terminate"
     }
+}
 
-    ## Test the server doesn't start when the AOF contains an unfinished MULTI
-    create_aof {
-        append_to_aof [formatCommand set foo hello]
-        append_to_aof [formatCommand multi]
-        append_to_aof [formatCommand set bar world]
-    }
+proc aof_sizes {} {
+    upvar manifest_path manifest_path server_path server_path
+    expr {[file size [aof_file b]] + [file size [aof_file i]]}
+}
 
-    start_server_aof [list dir $server_path aof-load-truncated no] {
-        test "Unfinished MULTI: Server should have logged an error" {
-            set pattern "*Unexpected end of file reading the append only file*"
-            set retry 10
-            while {$retry} {
-                set result [exec tail -1 < [dict get $srv stdout]]
-                if {[string match $pattern $result]} {
-                    break
-                }
-                incr retry -1
-                after 1000
-            }
-            if {$retry == 0} {
-                error "assertion:expected error not found on config file"
-            }
-        }
+start_server {tags {"aof"}} {
+    set orig_dir [lindex [r config get dir] 1]
+    r config set dir $server_path
+    r flushall
+
+    test {CONFIG SET appendonly yes writes a base file in background} {
+        r set foo bar
+        r set num 12
+        r config set appendonly yes
+        assert_equal 1 [s aof_enabled]
+        r set during rewrite
+        wait_for_aof_rewrite
+        assert_equal ok [s aof_last_bgrewrite_status]
+        assert_equal 1 [s aof_incr_files]
+        assert_equal [file size [aof_file b]] [s aof_base_size]
+        r debug loadaof
+        list [r get foo] [r get num] [r get during] [r dbsize]
+    } {bar 12 rewrite 3}
+
+    test {Writes reach the incr file before the reply} {
+        r set newkey val
+        r incr num
+        set content [read_aof]
+        assert_match "*newkey*" $content
+        assert_match "*incr*num*" $content
+        assert_equal 0 [s aof_buffer_length]
+        assert_equal [aof_sizes] [s aof_current_size]
     }
 
-    ## Test that the server exits when the AOF contains a short read
-    create_aof {
-        append_to_aof [formatCommand set foo hello]
-        append_to_aof [string range [formatCommand set bar world] 0 end-1]
+    test {Relative expires are stored as absolute PEXPIREAT} {
+        r setex volatile 100 v
+        r set other x ex 200
+        r expire foo 300
+        assert_match "*PEXPIREAT*volatile*" [read_aof]
+        r debug loadaof
+        assert_range [r ttl volatile] 90 100
+        assert_range [r ttl other] 190 200
+        assert_range [r ttl foo] 290 300
+        r get other
+    } {x}
+
+    test {Reads and failed writes are not logged} {
+        set size [s aof_current_size]
+        r get foo
+        r exists foo
+        r set foo baz nx
+        assert_equal $size [s aof_current_size]
     }
 
-    start_server_aof [list dir $server_path aof-load-truncated no] {
-        test "Short read: Server should have logged an error" {
-            set pattern "*Unexpected end of file reading the append only file*"
-            set retry 10
-            while {$retry} {
-                set result [exec tail -1 < [dict get $srv stdout]]
-                if {[string match $pattern $result]} {
-                    break
-                }
-                incr retry -1
-                after 1000
-            }
-            if {$retry == 0} {
-                error "assertion:expected error not found on config file"
-            }
+    test {DEBUG LOADAOF restores keys in the right database} {
+        r select 5
+        r set dbkey five
+        r select 9
+        r set dbkey nine
+        r debug loadaof
+        r select 5
+        set v5 [r get dbkey]
+        r select 9
+        list $v5 [r get dbkey]
+    } {five nine}
+
+    test {A transaction is logged between MULTI and EXEC} {
+        r multi
+        r set tx1 a
+        r incr num
+        r exec
+        assert_match "*MULTI*tx1*incr*num*exec*" [read_aof]
+        r debug loadaof
+        r get tx1
+    } {a}
+
+    test {Truncated AOF is loaded when aof-load-truncated is yes} {
+        r config set aof-load-truncated yes
+        create_aof {
+            append_to_aof [formatCommand select 9]
+            append_to_aof [formatCommand set foo hello]
+            append_to_aof "*3\r\n\$3\r\nSET\r\n\$3\r\nbar\r\n"
         }
-    }
-
-    ## Test that redis-check-aof indeed sees this AOF is not valid
-    test "Short read: Utility should confirm the AOF is not valid" {
-        catch {
-            exec src/redis-check-aof $aof_path
-        } result
-        assert_match "*not valid*" $result
-    }
-
-    test "Short read: Utility should be able to fix the AOF" {
-        set result [exec src/redis-check-aof --fix $aof_path << "y\n"]
-        assert_match "*Successfully truncated AOF*" $result
-    }
-
-    ## Test that the server can be started using the truncated AOF
-    start_server_aof [list dir $server_path aof-load-truncated no] {
-        test "Fixed AOF: Server should have been started" {
-            assert_equal 1 [is_alive $srv]
+        r debug loadaof
+        assert_equal [aof_sizes] [s aof_current_size]
+        list [r get foo] [r exists bar]
+    } {hello 0}
+
+    test {A huge argument count at the end of the AOF is a truncation} {
+        create_aof {
+            append_to_aof [formatCommand select 9]
+            append_to_aof [formatCommand set foo hello]
+            append_to_aof "*2000000000\r\n\$3\r\nSET\r\n"
         }
-
-        test "Fixed AOF: Keyspace should contain values that were parseable" {
-            set client [redis [dict get $srv host] [dict get $srv port] 0 $::tls]
-            wait_done_loading $client
-            assert_equal "hello" [$client get foo]
-            assert_equal "" [$client get bar]
+        r debug loadaof
+        assert_equal [aof_sizes] [s aof_current_size]
+        r get foo
+    } {hello}
+
+    test {AOF ending inside a transaction is truncated before the MULTI} {
+        create_aof {
+            append_to_aof [formatCommand select 9]
+            append_to_aof [formatCommand set foo hello]
+            append_to_aof [formatCommand multi]
+            append_to_aof [formatCommand set bar 1]
         }
-    }
-
-    ## Test that SPOP (that modifies the client's argc/argv) is correctly free'd
-    create_aof {
-        append_to_aof [formatCommand sadd set foo]
-        append_to_aof [formatCommand sadd set bar]
-        append_to_aof [formatCommand spop set]
-    }
-
-    start_server_aof [list dir $server_path aof-load-truncated no] {
-        test "AOF+SPOP: Server should have been started" {
-            assert_equal 1 [is_alive $srv]
+        r debug loadaof
+        assert_equal [aof_sizes] [s aof_current_size]
+        assert_no_match "*multi*" [read_aof]
+        list [r get foo] [r exists bar]
+    } {hello 0}
+
+    test {BGREWRITEAOF switches to a new base and removes the old files} {
+        set old_base [aof_file b]
+        set old_incr [aof_file i]
+        for {set j 0} {$j < 100} {incr j} {
+            r set counter $j
         }
-
-        test "AOF+SPOP: Set should have 1 member" {
-            set client [redis [dict get $srv host] [dict get $srv port] 0 $::tls]
-            wait_done_loading $client
-            assert_equal 1 [$client scard set]
+        assert_match {*started*} [r bgrewriteaof]
+        r set after rewrite
+        wait_for_aof_rewrite
+        assert_equal ok [s aof_last_bgrewrite_status]
+        assert {[aof_file b] ne $old_base}
+        assert {[aof_file i] ne $old_incr}
+        wait_for_condition 50 100 {
+            ![file exists $old_base] && ![file exists $old_incr]
+        } else {
+            fail "history files were not removed"
         }
-    }
-
-    ## Uses the alsoPropagate() API.
-    create_aof {
-        append_to_aof [formatCommand sadd set foo]
-        append_to_aof [formatCommand sadd set bar]
-        append_to_aof [formatCommand sadd set gah]
-        append_to_aof [formatCommand spop set 2]
-    }
-
-    start_server_aof [list dir $server_path] {
-        test "AOF+SPOP: Server should have been started" {
-            assert_equal 1 [is_alive $srv]
+        assert_match "*after*" [read_aof]
+        assert_equal [aof_sizes] [s aof_current_size]
+        r debug loadaof
+        list [r get counter] [r get after] [r get foo]
+    } {99 rewrite hello}
+
+    test {AOF replay of a rewritten base reports commands per second} {
+        r flushall
+        for {set j 0} {$j < 1000} {incr j} {
+            r set key:$j $j
+            if {$j % 100 == 0} {r expire key:$j 1000}
         }
-
-        test "AOF+SPOP: Set should have 1 member" {
-            set client [redis [dict get $srv host] [dict get $srv port] 0 $::tls]
-            wait_done_loading $client
-            assert_equal 1 [$client scard set]
+        r bgrewriteaof
+        wait_for_aof_rewrite
+        r set after rewrite
+        r debug loadaof
+        assert_equal 1001 [r dbsize]
+        assert_equal 999 [r get key:999]
+        assert_range [r ttl key:500] 990 1000
+        assert {[s aof_last_load_commands] >= 1011}
+        assert {[s aof_last_load_commands_per_sec] > 0}
+        set v [r get after]
+        r flushall
+        set v
+    } {rewrite}
+
+    test {BGREWRITEAOF is scheduled while BGSAVE is in progress} {
+        r bgsave
+        set reply [r bgrewriteaof]
+        wait_for_aof_rewrite
+        assert_equal ok [s aof_last_bgrewrite_status]
+        set reply
+    } {*scheduled*}
+
+    test {AOF is rewritten automatically when it grows} {
+        set base [aof_file b]
+        r config set auto-aof-rewrite-min-size 1
+        r config set auto-aof-rewrite-percentage 100
+        for {set j 0} {$j < 200} {incr j} {
+            r set counter $j
         }
-    }
-
-    ## Test that EXPIREAT is loaded correctly
-    create_aof {
-        append_to_aof [formatCommand rpush list foo]
-        append_to_aof [formatCommand expireat list 1000]
-        append_to_aof [formatCommand rpush list bar]
-    }
-
-    start_server_aof [list dir $server_path aof-load-truncated no] {
-        test "AOF+EXPIRE: Server should have been started" {
-            assert_equal 1 [is_alive $srv]
+        wait_for_condition 50 100 {
+            [aof_file b] ne $base
+        } else {
+            fail "automatic AOF rewrite not triggered"
         }
-
-        test "AOF+EXPIRE: List should be empty" {
-            set client [redis [dict get $srv host] [dict get $srv port] 0 $::tls]
-            wait_done_loading $client
-            assert_equal 0 [$client llen list]
+        r config set auto-aof-rewrite-percentage 0
+        r config set auto-aof-rewrite-min-size 64mb
+        wait_for_aof_rewrite
+        assert_error {*Invalid argument*} {r config set auto-aof-rewrite-percentage -1}
+        r get counter
+    } {199}
+
+    test {appendfsync policies and write/fsync stats} {
+        foreach policy {always no everysec} {
+            r config set appendfsync $policy
+            assert_equal $policy [lindex [r config get appendfsync] 1]
+            r set foo $policy
         }
-    }
-
-    start_server {overrides {appendonly {yes} appendfilename {appendonly.aof}}} {
-        test {Redis should not try to convert DEL into EXPIREAT for EXPIRE -1} {
-            r set x 10
-            r expire x -1
+        assert_equal everysec [s aof_fsync_policy]
+        assert_error {*Invalid argument*} {r config set appendfsync sometimes}
+        set writes [s aof_writes]
+        r set foo bar
+        assert {[s aof_writes] > $writes}
+        wait_for_condition 50 100 {
+            [s aof_fsyncs] > 0 && [s aof_pending_bio_fsync] == 0
+        } else {
+            fail "everysec fsync never completed"
         }
+        assert {[s aof_max_fsync_usec] >= [s aof_avg_fsync_usec]}
+        assert_equal ok [s aof_last_write_status]
     }
 
-    start_server {overrides {appendonly {yes} appendfilename {appendonly.aof} appendfsync always}} {
-        test {AOF fsync always barrier issue} {
-            set rd [redis_deferring_client]
-            # Set a sleep when aof is flushed, so that we have a chance to look
-            # at the aof size and detect if the response of an incr command
-            # arrives before the data was written (and hopefully fsynced)
-            # We create a big reply, which will hopefully not have room in the
-            # socket buffers, and will install a write handler, then we sleep
-            # a big and issue the incr command, hoping that the last portion of
-            # the output buffer write, and the processing of the incr will happen
-            # in the same event loop cycle.
-            # Since the socket buffers and timing are unpredictable, we fuzz this
-            # test with slightly different sizes and sleeps a few times.
-            for {set i 0} {$i < 10} {incr i} {
-                r debug aof-flush-sleep 0
-                r del x
-                r setrange x [expr {int(rand()*5000000)+10000000}] x
-                r debug aof-flush-sleep 500000
-                set aof [file join [lindex [r config get dir] 1] appendonly.aof]
-                set size1 [file size $aof]
-                $rd get x
-                after [expr {int(rand()*30)}]
-                $rd incr new_value
-                $rd read
-                $rd read
-                set size2 [file size $aof]
-                assert {$size1 != $size2}
-            }
-        }
-    }
+    test {CONFIG SET appendonly no stops logging} {
+        r config set appendonly no
+        assert_equal 0 [s aof_enabled]
+        set size [file size [aof_file i]]
+        r set foo after
+        assert_equal $size [file size [aof_file i]]
+        r get foo
+    } {after}
+
+    r select 0
+    r flushall
+    r config set dir $orig_dir
 }
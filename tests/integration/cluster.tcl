@@ -0,0 +1,168 @@
+# The cluster nodes are spawned on free ports with cluster-enabled set, the
+# server the suite runs against is not part of the cluster.
+proc start_cluster_node {path} {
+    file mkdir $path
+    set port [find_available_port $::baseport $::portcount]
+    set pid [exec src/redis-server --port $port --dir $path \
+        --cluster-enabled yes >> $path/stdout 2>> $path/stderr &]
+    wait_for_condition 50 100 {
+        ![catch {close [socket 127.0.0.1 $port]}]
+    } else {
+        fail "Cluster node did not start"
+    }
+    list $pid $port
+}
+
+proc cluster_info_field {node field} {
+    if {[regexp "\r\n$field:(.*?)\r\n" "\r\n[$node cluster info]" -> value]} {
+        return $value
+    }
+}
+
+start_server {tags {"cluster"}} {
+    set path [file normalize [tmpdir "server.cluster"]]
+    lassign [start_cluster_node $path/a] pid1 port1
+    lassign [start_cluster_node $path/b] pid2 port2
+    set n1 [redis 127.0.0.1 $port1]
+    set n2 [redis 127.0.0.1 $port2]
+    set id1 [$n1 cluster myid]
+    set id2 [$n2 cluster myid]
+
+    test {CLUSTER KEYSLOT hashes the key or its hash tag} {
+        list [$n1 cluster keyslot 123456789] [$n1 cluster keyslot foo] \
+             [$n1 cluster keyslot bar] \
+             [expr {[$n1 cluster keyslot {{user1}.name}] ==
+                    [$n1 cluster keyslot user1]}]
+    } {12739 12182 5061 1}
+
+    test {Keys in unassigned slots are rejected} {
+        catch {$n1 set foo bar} err
+        list $err [cluster_info_field $n1 cluster_state]
+    } {{CLUSTERDOWN Hash slot not served} fail}
+
+    test {The cluster is ok once every slot is assigned} {
+        $n1 cluster addslotsrange 0 8191
+        $n2 cluster addslotsrange 8192 16383
+        $n1 cluster meet 127.0.0.1 $port2
+        $n2 cluster meet 127.0.0.1 $port1
+        list [cluster_info_field $n1 cluster_state] \
+             [cluster_info_field $n2 cluster_state] \
+             [cluster_info_field $n1 cluster_known_nodes]
+    } {ok ok 2}
+
+    test {CLUSTER ADDSLOTS refuses busy slots} {
+        catch {$n1 cluster addslots 100} err
+        set err
+    } {*already busy*}
+
+    test {Keys of another node are redirected with MOVED} {
+        $n1 set bar 1
+        catch {$n1 set foo 1} err
+        list $err [$n2 set foo 1] [$n2 get foo]
+    } [list "MOVED 12182 127.0.0.1:$port2" OK 1]
+
+    test {Keys of a multi-key command must hash to the same slot} {
+        catch {$n1 mset bar 1 foo 2} err
+        list $err [$n1 mset {{bar}a} 1 {{bar}b} 2] [$n1 mget {{bar}a} bar]
+    } {{CROSSSLOT Keys in request don't hash to the same slot} OK {1 1}}
+
+    test {The keys of a transaction must hash to the same slot} {
+        $n1 multi
+        $n1 set bar 1
+        $n1 set "{user1}:tx" 1
+        catch {$n1 exec} err
+        list $err [$n1 exists "{user1}:tx"] [$n1 ping]
+    } {{CROSSSLOT Keys in request don't hash to the same slot} 0 PONG}
+
+    test {Keys are indexed by hash slot} {
+        $n1 del {{bar}a}
+        list [$n1 cluster countkeysinslot 5061] \
+             [lsort [$n1 cluster getkeysinslot 5061 10]] \
+             [llength [$n1 cluster getkeysinslot 5061 1]]
+    } {2 {bar {{bar}b}} 1}
+
+    test {The slot index survives DEBUG RELOAD} {
+        $n1 debug reload
+        $n1 cluster countkeysinslot 5061
+    } {2}
+
+    test {CLUSTER SLOTS and NODES describe the slot map} {
+        set slots [$n1 cluster slots]
+        set nodes [$n1 cluster nodes]
+        list $slots [regexp "$id1 127.0.0.1:$port1 myself,master .* 0-8191\n" \
+                             $nodes] \
+                    [regexp "$id2 127.0.0.1:$port2 master .* 8192-16383\n" \
+                             $nodes]
+    } [list [list [list 0 8191 [list 127.0.0.1 $port1 $id1]] \
+                  [list 8192 16383 [list 127.0.0.1 $port2 $id2]]] 1 1]
+
+    test {A migrating slot sends missing keys to the target with ASK} {
+        $n1 cluster setslot 5061 migrating $id2
+        $n2 cluster setslot 5061 importing $id1
+        catch {$n1 get {{bar}new}} err1
+        catch {$n2 set {{bar}new} 1} err2
+        $n2 asking
+        list [$n1 get bar] $err1 $err2 [$n2 set {{bar}new} 1]
+    } [list 1 "ASK 5061 127.0.0.1:$port2" "MOVED 5061 127.0.0.1:$port1" OK]
+
+    test {ASKING is valid for the next command only} {
+        $n2 asking
+        $n2 get {{bar}new}
+        catch {$n2 get {{bar}new}} err
+        set err
+    } "MOVED 5061 127.0.0.1:$port1"
+
+    test {A slot holding keys can't be given away} {
+        catch {$n1 cluster setslot 5061 node $id2} err
+        set err
+    } {*still hold keys*}
+
+    test {SETSLOT NODE completes the migration} {
+        $n1 del bar {{bar}b}
+        $n1 cluster setslot 5061 node $id2
+        $n2 cluster setslot 5061 node $id2
+        catch {$n1 get {{bar}new}} err
+        list $err [$n2 get {{bar}new}] [$n1 cluster countkeysinslot 5061] \
+             [regexp {\[5061} [$n1 cluster nodes]]
+    } [list "MOVED 5061 127.0.0.1:$port2" 1 0 0]
+
+    test {FLUSHALL empties the slot index} {
+        $n2 flushall
+        list [$n2 cluster countkeysinslot 12182] [$n2 get foo]
+    } {0 {}}
+
+    test {A slot is moved in batches with GETKEYSINSLOT and MIGRATE KEYS} {
+        for {set j 0} {$j < 250} {incr j} {
+            $n1 set "{user1}:$j" $j
+        }
+        $n1 pexpire "{user1}:0" 100000
+        $n2 cluster setslot 8106 importing $id1
+        $n1 cluster setslot 8106 migrating $id2
+        set batches 0
+        while {[llength [set keys [$n1 cluster getkeysinslot 8106 100]]]} {
+            $n1 migrate 127.0.0.1 $port2 "" 0 5000 keys {*}$keys
+            incr batches
+        }
+        catch {$n1 get "{user1}:7"} err
+        $n1 cluster setslot 8106 node $id2
+        $n2 cluster setslot 8106 node $id2
+        list $batches $err [$n1 cluster countkeysinslot 8106] \
+             [$n2 cluster countkeysinslot 8106] [$n2 get "{user1}:249"] \
+             [expr {[$n2 pttl "{user1}:0"] > 90000}]
+    } [list 3 "ASK 8106 127.0.0.1:$port2" 0 250 249 1]
+
+    test {Only DB 0 is available in cluster mode} {
+        catch {$n1 select 1} err
+        set err
+    } {*not allowed in cluster mode*}
+
+    test {CLUSTER FORGET unassigns the slots of the node} {
+        $n1 cluster forget $id2
+        list [cluster_info_field $n1 cluster_state] \
+             [cluster_info_field $n1 cluster_known_nodes]
+    } {fail 1}
+
+    $n1 close
+    $n2 close
+    exec kill -9 $pid1 $pid2
+}
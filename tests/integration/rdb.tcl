@@ -1,191 +1,106 @@
-set server_path [tmpdir "server.rdb-encoding-test"]
-
-# Copy RDB with different encodings in server path
-exec cp tests/assets/encodings.rdb $server_path
-
-start_server [list overrides [list "dir" $server_path "dbfilename" "encodings.rdb"]] {
-  test "RDB encoding loading test" {
-    r select 0
-    csvdump r
-  } {"0","compressible","string","aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
-"0","hash","hash","a","1","aa","10","aaa","100","b","2","bb","20","bbb","200","c","3","cc","30","ccc","300","ddd","400","eee","5000000000",
-"0","hash_zipped","hash","a","1","b","2","c","3",
-"0","list","list","1","2","3","a","b","c","100000","6000000000","1","2","3","a","b","c","100000","6000000000","1","2","3","a","b","c","100000","6000000000",
-"0","list_zipped","list","1","2","3","a","b","c","100000","6000000000",
-"0","number","string","10"
-"0","set","set","1","100000","2","3","6000000000","a","b","c",
-"0","set_zipped_1","set","1","2","3","4",
-"0","set_zipped_2","set","100000","200000","300000","400000",
-"0","set_zipped_3","set","1000000000","2000000000","3000000000","4000000000","5000000000","6000000000",
-"0","string","string","Hello World"
-"0","zset","zset","a","1","b","2","c","3","aa","10","bb","20","cc","30","aaa","100","bbb","200","ccc","300","aaaa","1000","cccc","123456789","bbbb","5000000000",
-"0","zset_zipped","zset","a","1","b","2","c","3",
-}
-}
-
-set server_path [tmpdir "server.rdb-startup-test"]
-
-start_server [list overrides [list "dir" $server_path] keep_persistence true] {
-    test {Server started empty with non-existing RDB file} {
-        r debug digest
-    } {0000000000000000000000000000000000000000}
-    # Save an RDB file, needed for the next test.
-    r save
-}
-
-start_server [list overrides [list "dir" $server_path] keep_persistence true] {
-    test {Server started empty with empty RDB file} {
-        r debug digest
-    } {0000000000000000000000000000000000000000}
-}
-
-start_server [list overrides [list "dir" $server_path] keep_persistence true] {
-    test {Test RDB stream encoding} {
-        for {set j 0} {$j < 1000} {incr j} {
-            if {rand() < 0.9} {
-                r xadd stream * foo $j
-            } else {
-                r xadd stream * bar $j
-            }
-        }
-        r xgroup create stream mygroup 0
-        r xreadgroup GROUP mygroup Alice COUNT 1 STREAMS stream >
-        set digest [r debug digest]
+set server_path [file normalize [tmpdir "server.rdb-test"]]
+
+start_server {tags {"rdb"}} {
+    set orig_dir [lindex [r config get dir] 1]
+    r config set dir $server_path
+    r flushall
+
+    test {DEBUG RELOAD preserves strings, integers and expires} {
+        r set foo bar
+        r set small 12
+        r set big 123456789012
+        r set neg -70000
+        r set empty {}
+        r set long [string repeat x 1000]
+        r setex volatile 100 val
         r debug reload
-        set newdigest [r debug digest]
-        assert {$digest eq $newdigest}
-        r del stream
-    }
-}
-
-# Helper function to start a server and kill it, just to check the error
-# logged.
-set defaults {}
-proc start_server_and_kill_it {overrides code} {
-    upvar defaults defaults srv srv server_path server_path
-    set config [concat $defaults $overrides]
-    set srv [start_server [list overrides $config keep_persistence true]]
-    uplevel 1 $code
-    kill_server $srv
-}
-
-# Make the RDB file unreadable
-file attributes [file join $server_path dump.rdb] -permissions 0222
-
-# Detect root account (it is able to read the file even with 002 perm)
-set isroot 0
-catch {
-    open [file join $server_path dump.rdb]
-    set isroot 1
-}
-
-# Now make sure the server aborted with an error
-if {!$isroot} {
-    start_server_and_kill_it [list "dir" $server_path] {
-        test {Server should not start if RDB file can't be open} {
-            wait_for_condition 50 100 {
-                [string match {*Fatal error loading*} \
-                    [exec tail -1 < [dict get $srv stdout]]]
-            } else {
-                fail "Server started even if RDB was unreadable!"
-            }
-        }
+        assert_equal bar [r get foo]
+        assert_equal 12 [r get small]
+        assert_equal int [r object encoding small]
+        assert_equal 123456789012 [r get big]
+        assert_equal -70000 [r get neg]
+        assert_equal {} [r get empty]
+        assert_equal [string repeat x 1000] [r get long]
+        assert_equal val [r get volatile]
+        assert_range [r ttl volatile] 90 100
+        assert_equal 0 [s rdb_changes_since_last_save]
     }
-}
-
-# Fix permissions of the RDB file.
-file attributes [file join $server_path dump.rdb] -permissions 0666
 
-# Corrupt its CRC64 checksum.
-set filesize [file size [file join $server_path dump.rdb]]
-set fd [open [file join $server_path dump.rdb] r+]
-fconfigure $fd -translation binary
-seek $fd -8 end
-puts -nonewline $fd "foobar00"; # Corrupt the checksum
-close $fd
-
-# Now make sure the server aborted with an error
-start_server_and_kill_it [list "dir" $server_path] {
-    test {Server should not start if RDB is corrupted} {
-        wait_for_condition 50 100 {
-            [string match {*CRC error*} \
-                [exec tail -10 < [dict get $srv stdout]]]
-        } else {
-            fail "Server started even if RDB was corrupted!"
-        }
-    }
-}
-
-start_server {} {
-    test {Test FLUSHALL aborts bgsave} {
-        # 1000 keys with 1ms sleep per key shuld take 1 second
-        r config set rdb-key-save-delay 1000
-        r debug populate 1000
-        r bgsave
-        assert_equal [s rdb_bgsave_in_progress] 1
+    test {Keys already expired are not saved} {
         r flushall
-        # wait half a second max
-        wait_for_condition 5 100 {
-            [s rdb_bgsave_in_progress] == 0
-        } else {
-            fail "bgsave not aborted"
+        r set persistent 1
+        r psetex shortlived 50 1
+        after 100
+        r debug set-active-expire 0
+        r debug reload
+        r debug set-active-expire 1
+        r dbsize
+    } {1}
+
+    test {SAVE updates LASTSAVE and resets the dirty counter} {
+        r set foo bar
+        assert {[s rdb_changes_since_last_save] > 0}
+        set before [r lastsave]
+        after 1100
+        r save
+        assert {[r lastsave] > $before}
+        assert_equal 0 [s rdb_changes_since_last_save]
+        file exists $server_path/dump.rdb
+    } {1}
+
+    test {BGSAVE completes and records fork time} {
+        for {set j 0} {$j < 1000} {incr j} {
+            r set key:$j $j
         }
-        # veirfy that bgsave failed, by checking that the change counter is still high
-        assert_lessthan 999 [s rdb_changes_since_last_save]
-        # make sure the server is still writable
-        r set x xx
-    }
-
-    test {bgsave resets the change counter} {
-        r config set rdb-key-save-delay 0
         r bgsave
         wait_for_condition 50 100 {
             [s rdb_bgsave_in_progress] == 0
         } else {
-            fail "bgsave not done"
-        }
-        assert_equal [s rdb_changes_since_last_save] 0
-    }
-}
-
-test {client freed during loading} {
-    start_server [list overrides [list key-load-delay 10 rdbcompression no]] {
-        # create a big rdb that will take long to load. it is important
-        # for keys to be big since the server processes events only once in 2mb.
-        # 100mb of rdb, 100k keys will load in more than 1 second
-        r debug populate 100000 key 1000
-
-        restart_server 0 false
-
-        # make sure it's still loading
-        assert_equal [s loading] 1
-
-        # connect and disconnect 10 clients
-        set clients {}
-        for {set j 0} {$j < 10} {incr j} {
-            lappend clients [redis_deferring_client]
-        }
-        foreach rd $clients {
-            $rd debug log bla
-        }
-        foreach rd $clients {
-            $rd read
-        }
-        foreach rd $clients {
-            $rd close
+            fail "BGSAVE did not terminate"
         }
+        assert_equal ok [s rdb_last_bgsave_status]
+        assert {[s latest_fork_usec] > 0}
+        r debug reload
+        r get key:999
+    } {999}
 
-        # make sure the server freed the clients
-        wait_for_condition 100 100 {
-            [s connected_clients] < 3
-        } else {
-            fail "clients didn't disconnect"
+    test {DEBUG RELOAD of many chunks keeps every key and expire} {
+        r flushall
+        for {set j 0} {$j < 20000} {incr j} {
+            r set key:$j [expr {$j % 2 ? $j : "value:$j"}]
+            if {$j % 1000 == 0} {r expire key:$j 1000}
         }
-
-        # make sure it's still loading
-        assert_equal [s loading] 1
-
-        # no need to keep waiting for loading to complete
-        exec kill [srv 0 pid]
+        r debug reload
+        assert_equal 20000 [r dbsize]
+        assert_equal value:19998 [r get key:19998]
+        assert_equal 19999 [r get key:19999]
+        assert_range [r ttl key:5000] 990 1000
+        assert_equal -1 [r ttl key:5001]
+        assert_equal 20000 [s rdb_last_load_keys_loaded]
+        assert {[s rdb_last_load_keys_per_sec] > 0}
     }
+
+    test {CONFIG SET/GET rdb-load-threads} {
+        set orig [lindex [r config get rdb-load-threads] 1]
+        r config set rdb-load-threads 0
+        r debug reload
+        r config set rdb-load-threads $orig
+        assert_equal 1 [s rdb_last_load_threads]
+        assert_error {*Invalid argument*} {r config set rdb-load-threads -1}
+        r dbsize
+    } {20000}
+
+    test {CONFIG SET/GET save} {
+        set orig_save [lindex [r config get save] 1]
+        r config set save "100 5 20 1000"
+        assert_equal {100 5 20 1000} [lindex [r config get save] 1]
+        r config set save ""
+        assert_equal {} [lindex [r config get save] 1]
+        catch {r config set save "100"} e
+        r config set save $orig_save
+        set e
+    } {*Invalid argument*}
+
+    r flushall
+    r config set dir $orig_dir
 }
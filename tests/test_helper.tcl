@@ -14,6 +14,19 @@ source tests/support/util.tcl
 set ::all_tests {
     
     unit/type/string
+    unit/type/incr
+    unit/info
+    unit/expire
+    unit/maxmemory
+    unit/lazyfree
+    unit/dump
+    unit/multi
+    unit/pubsub
+    unit/tracking
+    integration/rdb
+    integration/aof
+    integration/replication
+    integration/cluster
     
 }
 # Index to the next test to run in the ::all_tests list.
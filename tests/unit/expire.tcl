@@ -20,14 +20,6 @@ start_server {tags {"expire"}} {
         } {{} 0}
     }
 
-    test {EXPIRE - write on expire should work} {
-        r del x
-        r lpush x foo
-        r expire x 1000
-        r lpush x bar
-        r lrange x 0 -1
-    } {bar foo}
-
     test {EXPIREAT - Check for EXPIRE alike behavior} {
         r del x
         r set x foo
@@ -88,7 +80,7 @@ start_server {tags {"expire"}} {
         list $a $b
     } {somevalue {}}
 
-    test {PEXPIRE/PSETEX/PEXPIREAT can set sub-second expires} {
+    test {PEXPIRE/PSETEX can set sub-second expires} {
         # This test is very likely to do a false positive if the
         # server is under pressure, so if it does not work give it a few more
         # chances.
@@ -107,23 +99,14 @@ start_server {tags {"expire"}} {
             after 120
             set d [r get x]
 
-            r set x somevalue
-            set now [r time]
-            r pexpireat x [expr ([lindex $now 0]*1000)+([lindex $now 1]/1000)+200]
-            after 20
-            set e [r get x]
-            after 220
-            set f [r get x]
-
             if {$a eq {somevalue} && $b eq {} &&
-                $c eq {somevalue} && $d eq {} &&
-                $e eq {somevalue} && $f eq {}} break
+                $c eq {somevalue} && $d eq {}} break
         }
         if {$::verbose} {
             puts "sub-second expire test attempts: $j"
         }
-        list $a $b $c $d $e $f
-    } {somevalue {} somevalue {} somevalue {}}
+        list $a $b $c $d
+    } {somevalue {} somevalue {}}
 
     test {TTL returns time to live in seconds} {
         r del x
@@ -192,58 +175,91 @@ start_server {tags {"expire"}} {
         r exists foo
     } {0}
 
-    test {5 keys in, 5 keys out} {
-        r flushdb
-        r set a c
-        r expire a 5
-        r set t c
-        r set e c
-        r set s c
-        r set foo b
-        lsort [r keys *]
-    } {a e foo s t}
-
     test {EXPIRE with empty string as TTL should report an error} {
         r set foo bar
         catch {r expire foo ""} e
         set e
     } {*not an integer*}
 
-    test {SET - use EX/PX option, TTL should not be reseted after loadaof} {
-        r config set appendonly yes
-        r set foo bar EX 100
-        after 2000
-        r debug loadaof
-        set ttl [r ttl foo]
-        assert {$ttl <= 98 && $ttl > 90}
-
-        r set foo bar PX 100000
-        after 2000
-        r debug loadaof
-        set ttl [r ttl foo]
-        assert {$ttl <= 98 && $ttl > 90}
-    }
-
     test {SET command will remove expire} {
         r set foo bar EX 100
         r set foo bar
         r ttl foo
     } {-1}
 
-    test {SET - use KEEPTTL option, TTL should not be removed} {
+    test {SET - use EX/PX option} {
+        r del foo
         r set foo bar EX 100
-        r set foo bar KEEPTTL
         set ttl [r ttl foo]
         assert {$ttl <= 100 && $ttl > 90}
+        r set foo bar PX 100000
+        set pttl [r pttl foo]
+        assert {$pttl <= 100000 && $pttl > 90000}
     }
 
-    test {SET - use KEEPTTL option, TTL should not be removed after loadaof} {
-        r config set appendonly yes
-        r set foo bar EX 100
-        r set foo bar2 KEEPTTL
-        after 2000
-        r debug loadaof
-        set ttl [r ttl foo]
-        assert {$ttl <= 98 && $ttl > 90}
+    test {SET - NX and XX options} {
+        r del foo
+        set a [r set foo bar XX]
+        set b [r set foo bar NX]
+        set c [r set foo baz NX]
+        set d [r set foo baz XX]
+        list $a $b $c $d [r get foo]
+    } {{} OK {} OK baz}
+
+    test {SET - invalid expire and option combinations} {
+        catch {r set foo bar EX 0} e1
+        catch {r set foo bar NX XX} e2
+        catch {r set foo bar EX} e3
+        list $e1 $e2 $e3
+    } {*invalid expire* *syntax error* *syntax error*}
+
+    test {SET - EX and PX can't be used together} {
+        r del foo
+        catch {r set foo bar EX 100 PX 100000} e1
+        catch {r set foo bar PX 100000 EX 100} e2
+        list $e1 $e2 [r exists foo]
+    } {{*syntax error*} {*syntax error*} 0}
+
+    test {SET and EXPIRE refuse expire times that overflow} {
+        r set foo bar
+        catch {r set foo bar EX 9223372036854775807} e1
+        catch {r set foo bar PX 9223372036854775807} e2
+        catch {r setex foo 9223372036854775807 bar} e3
+        catch {r expire foo 9223372036854775807} e4
+        catch {r pexpire foo 9223372036854775807} e5
+        catch {r expireat foo -9223372036854775807} e6
+        assert_match {*invalid expire*} $e1
+        assert_match {*invalid expire*} $e2
+        assert_match {*invalid expire*} $e3
+        assert_match {*invalid expire*} $e4
+        assert_match {*invalid expire*} $e5
+        assert_match {*invalid expire*} $e6
+        list [r get foo] [r ttl foo]
+    } {bar -1}
+
+    test {DEL against expired key} {
+        r debug set-active-expire 0
+        r del foo
+        r psetex foo 100 bar
+        after 200
+        set deleted [r del foo]
+        r debug set-active-expire 1
+        list $deleted [r exists foo]
+    } {0 0}
+
+    test {Active expiry collects a large number of volatile keys} {
+        r flushdb
+        for {set j 0} {$j < 5000} {incr j} {
+            r psetex key:$j 100 a
+        }
+        for {set j 0} {$j < 1000} {incr j} {
+            r set persistent:$j a
+        }
+        wait_for_condition 50 100 {
+            [r dbsize] == 1000
+        } else {
+            fail "volatile keys were not actively expired"
+        }
+        assert_match "*:keys=1000,expires=0,*" [r info keyspace]
     }
 }
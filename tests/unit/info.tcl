@@ -0,0 +1,46 @@
+start_server {tags {"info"}} {
+    test {INFO contains the default sections} {
+        set info [r info]
+        assert_match "*# Server*" $info
+        assert_match "*# Clients*" $info
+        assert_match "*# Memory*" $info
+        assert_match "*# Stats*" $info
+        assert_match "*# Keyspace*" $info
+    }
+
+    test {INFO stats counts processed commands and traffic} {
+        set before [s total_commands_processed]
+        r set infokey bar
+        r get infokey
+        set after [s total_commands_processed]
+        assert {$after - $before >= 3}
+        assert {[s total_net_input_bytes] > 0}
+        assert {[s total_net_output_bytes] > 0}
+    }
+
+    test {INFO memory reports used memory and RSS} {
+        assert {[s used_memory] > 0}
+        assert {[s used_memory_rss] > 0}
+        assert {[s used_memory_peak] >= [s used_memory] || [s used_memory_peak] > 0}
+    }
+
+    test {INFO memory formats terabyte sized values} {
+        r config set maxmemory 2000000000000
+        set tb [s maxmemory_human]
+        r config set maxmemory 2000000000000000000
+        set huge [s maxmemory_human]
+        r config set maxmemory 0
+        list $tb $huge
+    } {1.82T 2000000000000000000B}
+
+    test {INFO keyspace reports key count for db0} {
+        r set infokey bar
+        assert_match "*db0:keys=*" [r info keyspace]
+    }
+
+    test {INFO with a single section} {
+        set info [r info clients]
+        assert_match "*connected_clients:*" $info
+        assert {![string match "*# Memory*" $info]}
+    }
+}
@@ -1,33 +1,30 @@
 start_server {tags {"lazyfree"}} {
     test "UNLINK can reclaim memory in background" {
         set orig_mem [s used_memory]
-        set args {}
-        for {set i 0} {$i < 100000} {incr i} {
-            lappend args $i
-        }
-        r sadd myset {*}$args
-        assert {[r scard myset] == 100000}
+        r set bigkey [string repeat x 5000000]
         set peak_mem [s used_memory]
-        assert {[r unlink myset] == 1}
+        assert {[r unlink bigkey] == 1}
         assert {$peak_mem > $orig_mem+1000000}
+        # The query buffer that received the value is not shrunk, so only
+        # the value itself is expected to go away.
         wait_for_condition 50 100 {
-            [s used_memory] < $peak_mem &&
-            [s used_memory] < $orig_mem*2
+            [s used_memory] < $peak_mem-4000000
         } else {
             fail "Memory is not reclaimed by UNLINK"
         }
+        assert {[r exists bigkey] == 0}
     }
 
     test "FLUSHDB ASYNC can reclaim memory in background" {
+        r flushall
         set orig_mem [s used_memory]
-        set args {}
-        for {set i 0} {$i < 100000} {incr i} {
-            lappend args $i
+        for {set i 0} {$i < 20} {incr i} {
+            r set key$i [string repeat x 100000]
         }
-        r sadd myset {*}$args
-        assert {[r scard myset] == 100000}
+        assert {[r dbsize] == 20}
         set peak_mem [s used_memory]
         r flushdb async
+        assert {[r dbsize] == 0}
         assert {$peak_mem > $orig_mem+1000000}
         wait_for_condition 50 100 {
             [s used_memory] < $peak_mem &&
@@ -36,4 +33,74 @@ start_server {tags {"lazyfree"}} {
             fail "Memory is not reclaimed by FLUSHDB ASYNC"
         }
     }
+
+    test "FLUSHALL ASYNC can reclaim memory in background" {
+        set orig_mem [s used_memory]
+        r set bigkey [string repeat x 5000000]
+        r setex volatile 100 [string repeat y 100000]
+        set peak_mem [s used_memory]
+        r flushall async
+        assert {[r dbsize] == 0}
+        wait_for_condition 50 100 {
+            [s used_memory] < $peak_mem &&
+            [s used_memory] < $orig_mem*2 &&
+            [s lazyfree_pending_objects] == 0
+        } else {
+            fail "Memory is not reclaimed by FLUSHALL ASYNC"
+        }
+    }
+
+    test "FLUSHALL with a wrong argument is a syntax error" {
+        catch {r flushall foo} e
+        set e
+    } {ERR*syntax*}
+
+    test "Overwriting a big value reclaims the old one" {
+        r set bigkey [string repeat x 5000000]
+        set peak_mem [s used_memory]
+        r set bigkey small
+        wait_for_condition 50 100 {
+            [s used_memory] < $peak_mem-1000000
+        } else {
+            fail "Memory is not reclaimed by the overwrite"
+        }
+        r get bigkey
+    } {small}
+
+    test "A pending big reply survives FLUSHALL ASYNC" {
+        set payload [string repeat z 5000000]
+        r set bigkey $payload
+        set rd [redis [srv 0 host] [srv 0 port] 1 $::tls]
+        $rd get bigkey
+        $rd flushall async
+        assert {[$rd read] eq $payload}
+        assert {[$rd read] eq {OK}}
+        $rd close
+        r exists bigkey
+    } {0}
+
+    test "A value queued in MULTI survives FLUSHALL ASYNC" {
+        set payload [string repeat q 5000000]
+        r multi
+        r set bigkey $payload
+        r flushall async
+        r set bigkey2 $payload
+        r exec
+        wait_for_condition 50 100 {
+            [s lazyfree_pending_objects] == 0
+        } else {
+            fail "FLUSHALL ASYNC did not complete"
+        }
+        list [r exists bigkey] [string equal [r get bigkey2] $payload]
+    } {0 1}
+
+    test "DEL is synchronous when lazyfree-lazy-user-del is no" {
+        r config set lazyfree-lazy-user-del no
+        assert {[r config get lazyfree-lazy-user-del] eq {lazyfree-lazy-user-del no}}
+        set orig_mem [s used_memory]
+        r set bigkey [string repeat x 5000000]
+        assert {[r del bigkey] == 1}
+        assert {[s used_memory] < $orig_mem+1000000}
+        r config set lazyfree-lazy-user-del yes
+    } {OK}
 }
@@ -188,30 +188,6 @@ start_server {tags {"pubsub"}} {
         $rd1 close
     }
 
-    test "PubSub messages with CLIENT REPLY OFF" {
-        set rd [redis_deferring_client]
-        $rd hello 3
-        $rd read ;# Discard the hello reply
-
-        # Test that the subscribe/psubscribe notification is ok
-        $rd client reply off
-        assert_equal {1} [subscribe $rd channel]
-        assert_equal {2} [psubscribe $rd ch*]
-
-        # Test that the publish notification is ok
-        $rd client reply off
-        assert_equal 2 [r publish channel hello]
-        assert_equal {message channel hello} [$rd read]
-        assert_equal {pmessage ch* channel hello} [$rd read]
-
-        # Test that the unsubscribe/punsubscribe notification is ok
-        $rd client reply off
-        assert_equal {1} [unsubscribe $rd channel]
-        assert_equal {0} [punsubscribe $rd ch*]
-
-        $rd close
-    }
-
     test "PUNSUBSCRIBE from non-subscribed channels" {
         set rd1 [redis_deferring_client]
         assert_equal {0 0 0} [punsubscribe $rd1 {foo.* bar.* quux.*}]
@@ -247,172 +223,117 @@ start_server {tags {"pubsub"}} {
         concat $reply1 $reply2
     } {punsubscribe {} 0 unsubscribe {} 0}
 
-    ### Keyspace events notification tests
+    ### Pattern index and shared messages
 
-    test "Keyspace notifications: we receive keyspace notifications" {
-        r config set notify-keyspace-events KA
-        set rd1 [redis_deferring_client]
-        $rd1 CLIENT REPLY OFF ;# Make sure it works even if replies are silenced
-        assert_equal {1} [psubscribe $rd1 *]
-        r set foo bar
-        assert_equal {pmessage * __keyspace@9__:foo set} [$rd1 read]
-        $rd1 close
+    proc __consume_pmessages {client count} {
+        set patterns {}
+        for {set i 0} {$i < $count} {incr i} {
+            set msg [$client read]
+            assert_equal pmessage [lindex $msg 0]
+            lappend patterns [lindex $msg 1]
+        }
+        lsort $patterns
     }
 
-    test "Keyspace notifications: we receive keyevent notifications" {
-        r config set notify-keyspace-events EA
+    test "PSUBSCRIBE patterns sharing a literal prefix" {
         set rd1 [redis_deferring_client]
-        $rd1 CLIENT REPLY SKIP ;# Make sure it works even if replies are silenced
-        assert_equal {1} [psubscribe $rd1 *]
-        r set foo bar
-        assert_equal {pmessage * __keyevent@9__:set foo} [$rd1 read]
-        $rd1 close
-    }
+        psubscribe $rd1 {news.* news.sport.* news.s* new? * n\[ae\]ws.* \\*x}
 
-    test "Keyspace notifications: we can receive both kind of events" {
-        r config set notify-keyspace-events KEA
-        set rd1 [redis_deferring_client]
-        $rd1 CLIENT REPLY ON ;# Just coverage
-        assert_equal {OK} [$rd1 read]
-        assert_equal {1} [psubscribe $rd1 *]
-        r set foo bar
-        assert_equal {pmessage * __keyspace@9__:foo set} [$rd1 read]
-        assert_equal {pmessage * __keyevent@9__:set foo} [$rd1 read]
-        $rd1 close
-    }
+        assert_equal 5 [r publish news.sport.tennis hello]
+        set res [list [__consume_pmessages $rd1 5]]
+        assert_equal 2 [r publish news hello]
+        lappend res [__consume_pmessages $rd1 2]
+        assert_equal 2 [r publish *x hello]
+        lappend res [__consume_pmessages $rd1 2]
+        assert_equal 1 [r publish nets.sport hello]
+        lappend res [__consume_pmessages $rd1 1]
 
-    test "Keyspace notifications: we are able to mask events" {
-        r config set notify-keyspace-events KEl
-        r del mylist
-        set rd1 [redis_deferring_client]
-        assert_equal {1} [psubscribe $rd1 *]
-        r set foo bar
-        r lpush mylist a
-        # No notification for set, because only list commands are enabled.
-        assert_equal {pmessage * __keyspace@9__:mylist lpush} [$rd1 read]
-        assert_equal {pmessage * __keyevent@9__:lpush mylist} [$rd1 read]
         $rd1 close
-    }
+        set res
+    } [list [lsort {news.* news.sport.* news.s* * n[ae]ws.*}] \
+            [lsort {new? *}] [lsort {* \\*x}] {*}]
 
-    test "Keyspace notifications: general events test" {
-        r config set notify-keyspace-events KEg
+    test "PUNSUBSCRIBE keeps the other patterns of the same prefix" {
         set rd1 [redis_deferring_client]
-        assert_equal {1} [psubscribe $rd1 *]
-        r set foo bar
-        r expire foo 1
-        r del foo
-        assert_equal {pmessage * __keyspace@9__:foo expire} [$rd1 read]
-        assert_equal {pmessage * __keyevent@9__:expire foo} [$rd1 read]
-        assert_equal {pmessage * __keyspace@9__:foo del} [$rd1 read]
-        assert_equal {pmessage * __keyevent@9__:del foo} [$rd1 read]
-        $rd1 close
-    }
+        psubscribe $rd1 {foo.* foo.bar.* foo.baz.* foo.b*}
+        punsubscribe $rd1 {foo.* foo.b*}
 
-    test "Keyspace notifications: list events test" {
-        r config set notify-keyspace-events KEl
-        r del mylist
-        set rd1 [redis_deferring_client]
-        assert_equal {1} [psubscribe $rd1 *]
-        r lpush mylist a
-        r rpush mylist a
-        r rpop mylist
-        assert_equal {pmessage * __keyspace@9__:mylist lpush} [$rd1 read]
-        assert_equal {pmessage * __keyevent@9__:lpush mylist} [$rd1 read]
-        assert_equal {pmessage * __keyspace@9__:mylist rpush} [$rd1 read]
-        assert_equal {pmessage * __keyevent@9__:rpush mylist} [$rd1 read]
-        assert_equal {pmessage * __keyspace@9__:mylist rpop} [$rd1 read]
-        assert_equal {pmessage * __keyevent@9__:rpop mylist} [$rd1 read]
-        $rd1 close
-    }
+        assert_equal 1 [r publish foo.bar.1 hello]
+        set res [list [__consume_pmessages $rd1 1]]
+        assert_equal 1 [r publish foo.baz.1 hello]
+        lappend res [__consume_pmessages $rd1 1]
+        assert_equal 0 [r publish foo.1 hello]
 
-    test "Keyspace notifications: set events test" {
-        r config set notify-keyspace-events Ks
-        r del myset
-        set rd1 [redis_deferring_client]
-        assert_equal {1} [psubscribe $rd1 *]
-        r sadd myset a b c d
-        r srem myset x
-        r sadd myset x y z
-        r srem myset x
-        assert_equal {pmessage * __keyspace@9__:myset sadd} [$rd1 read]
-        assert_equal {pmessage * __keyspace@9__:myset sadd} [$rd1 read]
-        assert_equal {pmessage * __keyspace@9__:myset srem} [$rd1 read]
-        $rd1 close
-    }
+        psubscribe $rd1 {foo.*}
+        assert_equal 2 [r publish foo.bar.1 hello]
+        lappend res [__consume_pmessages $rd1 2]
 
-    test "Keyspace notifications: zset events test" {
-        r config set notify-keyspace-events Kz
-        r del myzset
-        set rd1 [redis_deferring_client]
-        assert_equal {1} [psubscribe $rd1 *]
-        r zadd myzset 1 a 2 b
-        r zrem myzset x
-        r zadd myzset 3 x 4 y 5 z
-        r zrem myzset x
-        assert_equal {pmessage * __keyspace@9__:myzset zadd} [$rd1 read]
-        assert_equal {pmessage * __keyspace@9__:myzset zadd} [$rd1 read]
-        assert_equal {pmessage * __keyspace@9__:myzset zrem} [$rd1 read]
+        punsubscribe $rd1
+        assert_equal 0 [r publish foo.bar.1 hello]
         $rd1 close
-    }
+        set res
+    } {foo.bar.* foo.baz.* {foo.* foo.bar.*}}
 
-    test "Keyspace notifications: hash events test" {
-        r config set notify-keyspace-events Kh
-        r del myhash
+    test "PUBSUB NUMPAT counts distinct patterns" {
         set rd1 [redis_deferring_client]
-        assert_equal {1} [psubscribe $rd1 *]
-        r hmset myhash yes 1 no 0
-        r hincrby myhash yes 10
-        assert_equal {pmessage * __keyspace@9__:myhash hset} [$rd1 read]
-        assert_equal {pmessage * __keyspace@9__:myhash hincrby} [$rd1 read]
-        $rd1 close
-    }
+        set rd2 [redis_deferring_client]
+        psubscribe $rd1 {chan.* other.*}
+        psubscribe $rd2 {chan.*}
+        set res [r pubsub numpat]
 
-    test "Keyspace notifications: expired events (triggered expire)" {
-        r config set notify-keyspace-events Ex
-        r del foo
-        set rd1 [redis_deferring_client]
-        assert_equal {1} [psubscribe $rd1 *]
-        r psetex foo 100 1
+        $rd1 close
+        $rd2 close
         wait_for_condition 50 100 {
-            [r exists foo] == 0
+            [r pubsub numpat] == 0
         } else {
-            fail "Key does not expire?!"
+            fail "Patterns of closed clients are still subscribed"
         }
-        assert_equal {pmessage * __keyevent@9__:expired foo} [$rd1 read]
-        $rd1 close
-    }
+        set res
+    } {2}
 
-    test "Keyspace notifications: expired events (background expire)" {
-        r config set notify-keyspace-events Ex
-        r del foo
+    test "PUBSUB CHANNELS lists the active channels" {
         set rd1 [redis_deferring_client]
-        assert_equal {1} [psubscribe $rd1 *]
-        r psetex foo 100 1
-        assert_equal {pmessage * __keyevent@9__:expired foo} [$rd1 read]
+        subscribe $rd1 {chan1 chan2 other}
+        set res [list [lsort [r pubsub channels chan*]] \
+                      [llength [r pubsub channels]]]
         $rd1 close
-    }
+        set res
+    } {{chan1 chan2} 3}
+
+    test "A big message is delivered whole to every subscriber" {
+        set payload [string repeat abcdefghij 20000]
+        set clients {}
+        for {set j 0} {$j < 10} {incr j} {
+            set rd [redis_deferring_client]
+            subscribe $rd {bigchan}
+            lappend clients $rd
+        }
+        set rdp [redis_deferring_client]
+        psubscribe $rdp {big*}
+
+        assert_equal 11 [r publish bigchan $payload]
+        assert_equal 11 [r publish bigchan small]
+        set res {}
+        foreach rd $clients {
+            lappend res [expr {[$rd read] eq [list message bigchan $payload]}]
+            lappend res [lindex [$rd read] 2]
+            $rd close
+        }
+        lappend res [expr {[$rdp read] eq [list pmessage big* bigchan $payload]}]
+        lappend res [lindex [$rdp read] 3]
+        $rdp close
+        lsort -unique $res
+    } {1 small}
 
-    test "Keyspace notifications: evicted events" {
-        r config set notify-keyspace-events Ee
-        r config set maxmemory-policy allkeys-lru
-        r flushdb
+    test "Only Pub/Sub commands are allowed in subscribed mode" {
         set rd1 [redis_deferring_client]
-        assert_equal {1} [psubscribe $rd1 *]
-        r set foo bar
-        r config set maxmemory 1
-        assert_equal {pmessage * __keyevent@9__:evicted foo} [$rd1 read]
-        r config set maxmemory 0
+        subscribe $rd1 {somechannel}
+        $rd1 get foo
+        catch {$rd1 read} err
+        unsubscribe $rd1 {somechannel}
+        $rd1 get foo
+        set res [list $err [$rd1 read]]
         $rd1 close
-    }
-
-    test "Keyspace notifications: test CONFIG GET/SET of event flags" {
-        r config set notify-keyspace-events gKE
-        assert_equal {gKE} [lindex [r config get notify-keyspace-events] 1]
-        r config set notify-keyspace-events {$lshzxeKE}
-        assert_equal {$lshzxeKE} [lindex [r config get notify-keyspace-events] 1]
-        r config set notify-keyspace-events KA
-        assert_equal {AK} [lindex [r config get notify-keyspace-events] 1]
-        r config set notify-keyspace-events EA
-        assert_equal {AE} [lindex [r config get notify-keyspace-events] 1]
-    }
+        set res
+    } {{ERR only (P)SUBSCRIBE / (P)UNSUBSCRIBE / PING / QUIT allowed in this context} {}}
 }
@@ -3,4 +3,94 @@ start_server {tags {"string"}} {
         r set x foobar
         r get x
     } {foobar}
+
+    test {Command names are case insensitive} {
+        r SeT x barfoo
+        r GET x
+    } {barfoo}
+
+    test {Unknown commands are rejected with an error} {
+        catch {r nosuchcommand foo} e
+        set e
+    } {ERR unknown command*}
+
+    test {Wrong arity is rejected with an error} {
+        catch {r get} e
+        set e
+    } {ERR wrong number of arguments*}
+
+    test {GET against non existing key} {
+        r get nosuchkey
+    } {}
+
+    test {Very big payload in GET/SET} {
+        set buf [string repeat "abcd" 1000000]
+        r set foo $buf
+        r get foo
+    } [string repeat "abcd" 1000000]
+
+    test {MGET} {
+        r set foo BAR
+        r set bar FOO
+        r mget foo bar
+    } {BAR FOO}
+
+    test {MGET against non existing key} {
+        r mget foo baazz bar
+    } {BAR {} FOO}
+
+    test {MGET with a reply bigger than the static buffer} {
+        set big [string repeat x 10000]
+        r set big1 $big
+        r set big2 $big
+        set res [r mget big1 nosuchkey big2 foo]
+        list [string length [lindex $res 0]] [lindex $res 1] \
+             [string length [lindex $res 2]] [lindex $res 3]
+    } {10000 {} 10000 BAR}
+
+    test {MSET base case} {
+        r mset x 10 y "foo bar" z "x x x x x x x\n\n\r\n"
+        r mget x y z
+    } [list 10 {foo bar} "x x x x x x x\n\n\r\n"]
+
+    test {MSET wrong number of args} {
+        catch {r mset x 10 y "foo bar" z} err
+        format $err
+    } {*wrong number*}
+
+    test {MSETNX with already existent key} {
+        list [r msetnx x1 xxx y2 yyy x 20] [r get x1] [r get y2]
+    } {0 {} {}}
+
+    test {MSETNX with not existing keys} {
+        list [r msetnx x1 xxx y2 yyy] [r get x1] [r get y2]
+    } {1 xxx yyy}
+
+    test {Short strings are embedded, long strings are raw} {
+        r set short [string repeat x 44]
+        r set long [string repeat x 45]
+        r set num 123456
+        list [r object encoding short] [r object encoding long] \
+             [r object encoding num] [r get short] [r get long]
+    } [list embstr raw int [string repeat x 44] [string repeat x 45]]
+
+    test {GET replies for every length from 0 to 300 bytes} {
+        set err {}
+        for {set len 0} {$len <= 300} {incr len} {
+            set val [string repeat a $len]
+            r set foo $val
+            if {[r get foo] ne $val} {
+                set err "mismatch at length $len"
+                break
+            }
+        }
+        set err
+    } {}
+
+    test {GET of integer encoded values} {
+        r set foo -9223372036854775808
+        r set bar 9223372036854775807
+        r set baz 1234567
+        list [r get foo] [r get bar] [r get baz] [r mget foo bar baz]
+    } {-9223372036854775808 9223372036854775807 1234567 {-9223372036854775808 9223372036854775807 1234567}}
 }